@@ -19,6 +19,12 @@ fi
 echo "Embedding JavaScript code..."
 node scripts/embed-js.js
 
+# Pack bundled resources into the ROM image linked into the kernel
+if [ ! -f "build/rom.img" ]; then
+    echo "Packing ROM image..."
+    node scripts/embed-rom.js
+fi
+
 # Build the kernel
 echo "Building kernel..."
 cd src/kernel
@@ -1,69 +1,132 @@
 #!/usr/bin/env node
 /**
  * embed-rom.js
- * Reads files from resources/ and generates src/os/fs/romfs.ts.
- * The generated file exports installRomFiles(fs) which writes each file
- * into the normal in-memory filesystem at boot — exactly like the files
- * written in initializeDefaultFS().
+ * Packs files from resources/ into the binary ROM image build/rom.img,
+ * which src/kernel/romfs_image.s links into the kernel.  At boot
+ * src/os/fs/romfs.ts mounts it at /rom and exposes each file at its
+ * install path as a zero-copy view of the image — nothing is parsed or
+ * copied, however large the resources are.
  *
  * Run via: npm run embed:rom
  *
  * Manifest:
  *   resources/bible.txt  →  /home/user/bible.txt
+ *
+ * Image layout — see the header of src/os/fs/romfs.ts:
+ *   32-byte header, then 24-byte entries (breadth-first: every directory's
+ *   children are contiguous and sorted by name bytes), the name table, and
+ *   file data with every file starting on a 4 KB boundary.
  */
 
 const fs   = require('fs');
 const path = require('path');
 
 const RESOURCES_DIR = path.join(__dirname, '..', 'resources');
-const OUTPUT        = path.join(__dirname, '..', 'src', 'os', 'fs', 'romfs.ts');
+const OUTPUT        = path.join(__dirname, '..', 'build', 'rom.img');
 
-// Map of local filename → install path inside the OS filesystem
+// Map of local filename → install path inside the OS filesystem.
+// text: normalise CRLF line endings to LF.
 const ROM_MANIFEST = [
-  { file: 'bible.txt', installPath: '/home/user/bible.txt' },
+  { file: 'bible.txt', installPath: '/home/user/bible.txt', text: true },
 ];
 
-console.log('Generating ROM filesystem installer (romfs.ts)...');
+const MAGIC       = 'JSOSROM1';
+const VERSION     = 1;
+const HEADER_SIZE = 32;
+const ENTRY_SIZE  = 24;
+const TYPE_FILE   = 1;
+const TYPE_DIR    = 2;
+const ALIGN       = 4096;
+
+console.log('Packing ROM image (build/rom.img)...');
+
+// ── Directory tree from the manifest ────────────────────────────────────────
+
+function newDir(name) { return { name, dir: true, children: new Map(), mtime: 0 }; }
+const root = newDir('');
 
-const entries = [];
 for (const entry of ROM_MANIFEST) {
   const localPath = path.join(RESOURCES_DIR, entry.file);
   if (!fs.existsSync(localPath)) {
     console.warn(`  (skip) ${entry.file} not found in resources/`);
     continue;
   }
-  const raw = fs.readFileSync(localPath, 'utf8');
-  const content = raw
-    .replace(/\r\n/g, '\n')
-    .replace(/\\/g,  '\\\\')
-    .replace(/`/g,   '\\`')
-    .replace(/\$\{/g, '\\${');
-  entries.push({ installPath: entry.installPath, content });
-  console.log(`  + ${entry.installPath}  (${(raw.length / 1024).toFixed(1)} KB)`);
+  let data = fs.readFileSync(localPath);
+  if (entry.text) data = Buffer.from(data.toString('utf8').replace(/\r\n/g, '\n'), 'utf8');
+  const mtime = Math.floor(fs.statSync(localPath).mtimeMs / 1000);
+  const parts = entry.installPath.split('/').filter(Boolean);
+  let cur = root;
+  for (const p of parts.slice(0, -1)) {
+    if (!cur.children.has(p)) cur.children.set(p, newDir(p));
+    cur = cur.children.get(p);
+    if (!cur.dir) throw new Error(`${entry.installPath}: ${p} is a file`);
+    cur.mtime = Math.max(cur.mtime, mtime);
+  }
+  cur.children.set(parts[parts.length - 1], { name: parts[parts.length - 1], dir: false, data, mtime });
+  console.log(`  + ${entry.installPath}  (${(data.length / 1024).toFixed(1)} KB)`);
 }
 
-const installLines = entries.map(e =>
-  `  fs.writeFile('${e.installPath}', \`${e.content}\`);`
-).join('\n\n');
+// ── Breadth-first entry order, children sorted by name bytes ───────────────
 
-const ts = `/**
- * JSOS ROM File Installer — auto-generated by scripts/embed-rom.js
- *
- * DO NOT EDIT.  Regenerate with:  npm run embed:rom
- *
- * Writes bundled resource files into the in-memory filesystem at boot,
- * exactly like the files installed in initializeDefaultFS().
- *
- * Installed paths:
-${entries.map(e => ` *   ${e.installPath}`).join('\n')}
- */
-import type { FileSystem } from './filesystem.js';
+const byBytes = (a, b) => Buffer.compare(Buffer.from(a.name, 'utf8'), Buffer.from(b.name, 'utf8'));
+const order = [root];
+root.parent = 0;
+for (let i = 0; i < order.length; i++) {
+  const n = order[i];
+  if (!n.dir) continue;
+  const kids = Array.from(n.children.values()).sort(byBytes);
+  n.first = order.length;
+  n.count = kids.length;
+  for (const k of kids) { k.parent = i; order.push(k); }
+}
+
+// ── Name table and data layout ──────────────────────────────────────────────
 
-export function installRomFiles(fs: FileSystem): void {
-${installLines || '  // no resources embedded'}
+const names = [];
+let namesLen = 0;
+for (const n of order) {
+  const b = Buffer.from(n.name, 'utf8');
+  if (b.length > 0xffff) throw new Error(`name too long: ${n.name}`);
+  n.nameOff = namesLen;
+  n.nameLen = b.length;
+  names.push(b);
+  namesLen += b.length;
 }
-`;
+const entOff   = HEADER_SIZE;
+const namesOff = entOff + order.length * ENTRY_SIZE;
+const alignUp  = (v) => Math.ceil(v / ALIGN) * ALIGN;
+let dataEnd = alignUp(namesOff + namesLen);
+for (const n of order) {
+  if (n.dir) continue;
+  n.dataOff = dataEnd;
+  dataEnd = alignUp(dataEnd + n.data.length);
+}
+const imageLen = dataEnd;
+
+// ── Write ───────────────────────────────────────────────────────────────────
+
+const img = Buffer.alloc(imageLen);
+img.write(MAGIC, 0, 'latin1');
+img.writeUInt32LE(VERSION, 8);
+img.writeUInt32LE(order.length, 12);
+img.writeUInt32LE(entOff, 16);
+img.writeUInt32LE(namesOff, 20);
+img.writeUInt32LE(namesLen, 24);
+img.writeUInt32LE(imageLen, 28);
+order.forEach((n, i) => {
+  const o = entOff + i * ENTRY_SIZE;
+  img.writeUInt32LE(n.parent, o);
+  img.writeUInt32LE(n.nameOff, o + 4);
+  img.writeUInt16LE(n.nameLen, o + 8);
+  img.writeUInt16LE(n.dir ? TYPE_DIR : TYPE_FILE, o + 10);
+  img.writeUInt32LE(n.dir ? n.first : n.dataOff, o + 12);
+  img.writeUInt32LE(n.dir ? n.count : n.data.length, o + 16);
+  img.writeUInt32LE(n.mtime >>> 0, o + 20);
+  if (!n.dir) n.data.copy(img, n.dataOff);
+});
+Buffer.concat(names).copy(img, namesOff);
 
-fs.writeFileSync(OUTPUT, ts, 'utf8');
-const kb = (fs.statSync(OUTPUT).size / 1024).toFixed(1);
-console.log(`Done. ${OUTPUT} written (${kb} KB, ${entries.length} file(s) embedded).`);
+fs.mkdirSync(path.dirname(OUTPUT), { recursive: true });
+fs.writeFileSync(OUTPUT, img);
+const files = order.filter(n => !n.dir).length;
+console.log(`Done. ${OUTPUT} written (${(imageLen / 1024).toFixed(1)} KB, ${files} file(s), ${order.length} entries).`);
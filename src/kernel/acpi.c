@@ -3,7 +3,8 @@
  *
  * Detects the RSDP, walks the RSDT/XSDT to find the FADT, extracts the
  * PM1 control register addresses + SLP_TYP values for S5 shutdown, and
- * provides acpi_shutdown() / acpi_reboot().
+ * provides acpi_shutdown() / acpi_reboot().  The MADT is scanned for the
+ * LAPIC IDs of every enabled processor (consumed by smp.c).
  *
  * C code — hardware access only; no OS policy.
  */
@@ -89,6 +90,26 @@ static void _parse_fadt(uint32_t fadt_addr) {
     }
 }
 
+/* MADT: collect the LAPIC ID of every enabled processor (type-0 entries).
+ * Processors beyond ACPI_MAX_CPUS are ignored. */
+static void _parse_madt(uint32_t madt_addr) {
+    if (!madt_addr) return;
+    acpi_madt_t *m = (acpi_madt_t *)madt_addr;
+    acpi_info.madt_address = madt_addr;
+    uint8_t *p   = (uint8_t *)m + sizeof(acpi_madt_t);
+    uint8_t *end = (uint8_t *)m + m->hdr.length;
+    while (p + 2 <= end) {
+        uint8_t type = p[0], len = p[1];
+        if (len < 2 || p + len > end) break;
+        if (type == 0 && len >= sizeof(acpi_madt_lapic_t)) {
+            acpi_madt_lapic_t *l = (acpi_madt_lapic_t *)p;
+            if ((l->flags & 1u) && acpi_info.cpu_count < ACPI_MAX_CPUS)
+                acpi_info.cpu_apic_ids[acpi_info.cpu_count++] = l->apic_id;
+        }
+        p += len;
+    }
+}
+
 /* Walk RSDT (32-bit physical addresses after the header) */
 static void _walk_rsdt(uint32_t rsdt_addr) {
     if (!rsdt_addr) return;
@@ -101,6 +122,8 @@ static void _walk_rsdt(uint32_t rsdt_addr) {
         if (!entry) continue;
         if (memcmp(entry->signature, "FACP", 4) == 0)
             _parse_fadt(ptrs[i]);
+        else if (memcmp(entry->signature, "APIC", 4) == 0)
+            _parse_madt(ptrs[i]);
     }
 }
 
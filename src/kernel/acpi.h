@@ -6,6 +6,7 @@
  *   2. BIOS ROM area 0xE0000–0xFFFFF: search on 16-byte boundaries.
  *
  * Also supports the Multiboot2 RSDP tag (types 14 and 15) as a fast path.
+ * The MADT ("APIC") is parsed for the processor list used by SMP bring-up.
  *
  * C code — direct physical memory access, no OS logic.
  */
@@ -78,6 +79,23 @@ typedef struct {
     /* ... many more fields follow ... */
 } __attribute__((packed)) acpi_fadt_t;
 
+/* MADT ("APIC" signature) header + Processor Local APIC entry (type 0) */
+typedef struct {
+    acpi_sdt_hdr_t hdr;
+    uint32_t lapic_address;  /* physical LAPIC MMIO base */
+    uint32_t flags;          /* bit 0 = PC-AT compatible dual 8259 present */
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct {
+    uint8_t  type;           /* 0 = Processor Local APIC */
+    uint8_t  length;
+    uint8_t  acpi_cpu_id;
+    uint8_t  apic_id;
+    uint32_t flags;          /* bit 0 = enabled, bit 1 = online capable */
+} __attribute__((packed)) acpi_madt_lapic_t;
+
+#define ACPI_MAX_CPUS  8     /* matches SMP_MAX_CPUS in smp.h */
+
 /** ACPI state populated by acpi_init(). */
 typedef struct {
     uint32_t rsdp_address;     /* physical address of RSDP (0 = not found) */
@@ -92,6 +110,9 @@ typedef struct {
     int      slp_valid;        /* 1 if S5 shutdown values were found       */
     uint32_t pm_tmr_blk;       /* PM timer I/O port (0 if absent, item 52) */
     uint8_t  pm_tmr_32;        /* 1 = 32-bit timer; 0 = 24-bit timer       */
+    uint32_t madt_address;     /* MADT physical address (0 = not found)    */
+    uint32_t cpu_count;        /* enabled processors listed in the MADT    */
+    uint8_t  cpu_apic_ids[ACPI_MAX_CPUS]; /* LAPIC ID per processor        */
 } acpi_info_t;
 
 extern acpi_info_t acpi_info;
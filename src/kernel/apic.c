@@ -53,6 +53,14 @@ void apic_init(void)
     outb(0x21, 0xFF);   /* master */
     io_wait();
 
+    apic_enable_local();
+}
+
+/* Software-enable the LAPIC of the calling CPU.  Split out of apic_init() so
+ * application processors can enable their own LAPIC without touching the
+ * (shared) 8259 PIC masks. */
+void apic_enable_local(void)
+{
     /* Enable this LAPIC via the Spurious Interrupt Vector Register */
     _lapic_wr(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VEC);
 
@@ -111,10 +119,17 @@ void apic_timer_calibrate(void)
 }
 
 void apic_timer_start_periodic(uint32_t ms)
+{
+    apic_timer_start_periodic_vec(ms, (uint8_t)APIC_TIMER_VECTOR);
+}
+
+/* All LAPIC timers share the bus clock, so the BSP's calibration is valid on
+ * every CPU; APs pass their own vector so their ticks never reach IRQ0. */
+void apic_timer_start_periodic_vec(uint32_t ms, uint8_t vector)
 {
     if (!_ticks_per_ms) return;   /* not calibrated */
     _lapic_wr(LAPIC_TIMER_DCR, LAPIC_DCR_DIV16);
-    _lapic_wr(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    _lapic_wr(LAPIC_LVT_TIMER, (uint32_t)vector | LAPIC_TIMER_PERIODIC);
     _lapic_wr(LAPIC_TIMER_ICR, _ticks_per_ms * ms);
 }
 
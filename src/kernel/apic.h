@@ -66,6 +66,7 @@
 
 /* Local APIC (item 24) */
 void     apic_init(void);                       /* enable LAPIC, mask PIC 8259 */
+void     apic_enable_local(void);               /* enable this CPU's LAPIC only (APs) */
 void     apic_eoi(void);                        /* send end-of-interrupt */
 uint32_t apic_local_id(void);                   /* read ID field */
 uint32_t apic_base_addr(void);                  /* physical base from MSR */
@@ -73,6 +74,7 @@ uint32_t apic_base_addr(void);                  /* physical base from MSR */
 /* APIC timer (item 49) */
 void     apic_timer_calibrate(void);            /* calibrate ticks/ms using PIT */
 void     apic_timer_start_periodic(uint32_t ms);/* arm periodic mode */
+void     apic_timer_start_periodic_vec(uint32_t ms, uint8_t vector); /* per-CPU timer */
 void     apic_timer_stop(void);                 /* mask LVT_TIMER */
 uint32_t apic_timer_ticks_per_ms(void);         /* cached calibration result */
 
@@ -185,19 +185,25 @@ int ata_write28(uint32_t lba, uint8_t count, const uint16_t *buf) {
 /* ── IRQ-driven PIO transfers (item 78) ─────────────────────────────────── */
 /*
  * The ATA device raises IRQ14 (primary bus) when a PIO data transfer is
- * ready.  We use a simple volatile semaphore: irq_handler sets it, callers
- * spin-wait (hlt) until it fires.
+ * ready.  irq_handler sets a flag and wakes _ata_wq; callers block in
+ * kwait_until(), so other kernel threads run — or the CPU halts —
+ * while the drive works.  The flag is cleared before each command is issued
+ * and consumed by each wait, so an IRQ that fires before the wait starts is
+ * never lost.
  */
 
 #include "irq.h"
+#include "kthread.h"
 
 static volatile int _ata_irq_fired = 0;
 static int          _irq_mode      = 0;
+static kwaitq_t     _ata_wq        = KWAITQ_INIT;
 
 static void _ata_irq14_handler(void) {
     /* Read status to clear the interrupt at the drive side */
     (void)inb(ATA_STATUS);
     _ata_irq_fired = 1;
+    kwaitq_wake_all(&_ata_wq);
 }
 
 void ata_enable_irq(void) {
@@ -208,12 +214,21 @@ void ata_enable_irq(void) {
     _irq_mode = 1;
 }
 
-static int _ata_wait_irq(void) {
-    int timeout = 5000; /* 5 seconds worth of 1 ms sleeps */
+static int _ata_irq_cond(void *arg) {
+    (void)arg;
+    return _ata_irq_fired;
+}
+
+/* Call before issuing a command whose completion is awaited by IRQ. */
+static void _ata_arm_irq(void) {
     _ata_irq_fired = 0;
-    while (!_ata_irq_fired && --timeout > 0)
-        __asm__ volatile ("hlt");
-    return _ata_irq_fired ? 0 : -1;
+}
+
+static int _ata_wait_irq(void) {
+    /* 5 s timeout */
+    if (!kwait_until(&_ata_wq, _ata_irq_cond, NULL, 5000)) return -1;
+    _ata_irq_fired = 0;     /* consume: the next sector raises a new IRQ */
+    return 0;
 }
 
 int ata_read28_irq(uint32_t lba, uint8_t count, uint16_t *buf) {
@@ -225,6 +240,7 @@ int ata_read28_irq(uint32_t lba, uint8_t count, uint16_t *buf) {
     outb(ATA_LBA_LO,       (uint8_t)( lba        & 0xFF));
     outb(ATA_LBA_MID,      (uint8_t)((lba >>  8) & 0xFF));
     outb(ATA_LBA_HI,       (uint8_t)((lba >> 16) & 0xFF));
+    _ata_arm_irq();
     outb(ATA_COMMAND,      ATA_CMD_READ_PIO);
 
     for (int s = 0; s < count; s++) {
@@ -257,6 +273,7 @@ int ata_write28_irq(uint32_t lba, uint8_t count, const uint16_t *buf) {
         for (int i = 0; i < 256; i++) outw(ATA_DATA, src[i]);
         ata_delay400ns();
         /* cache flush generates another IRQ/completion */
+        _ata_arm_irq();
         outb(ATA_COMMAND, ATA_CMD_CACHE_FLUSH);
         if (_ata_wait_irq() != 0) return -1;
     }
@@ -327,6 +344,7 @@ int ata_dma_read28(uint32_t lba, uint8_t count,
     outb(ATA_LBA_LO,       (uint8_t)( lba        & 0xFF));
     outb(ATA_LBA_MID,      (uint8_t)((lba >>  8) & 0xFF));
     outb(ATA_LBA_HI,       (uint8_t)((lba >> 16) & 0xFF));
+    _ata_arm_irq();
     outb(ATA_COMMAND,      0xC8u); /* READ DMA */
 
     /* Start DMA (bit 0 = start, read direction = bit 3 clear) */
@@ -387,53 +405,70 @@ int ata_is_atapi(void) {
     return _atapi_detected;
 }
 
+/* Wait out BSY after a PACKET phase change.  Returns the status byte, or
+ * 0xFF on timeout. */
+static uint8_t atapi_wait_phase(void) {
+    int timeout = 0x100000;
+    uint8_t status;
+    ata_delay400ns();
+    while ((status = inb(ATA_STATUS)) & ATA_SR_BSY) {
+        if (--timeout <= 0) return 0xFF;
+    }
+    return status;
+}
+
 int ata_atapi_send_packet(const uint8_t *packet12,
-                          void *data_in, uint16_t buf_len) {
+                          void *data_in, uint32_t buf_len) {
     if (!packet12) return -1;
+    if (buf_len > ATAPI_MAX_TRANSFER) buf_len = ATAPI_MAX_TRANSFER;
+
+    /* Byte count limit: the most the device may move per DRQ block.  Larger
+     * transfers arrive as several DRQ blocks, drained in the loop below. */
+    uint32_t limit = buf_len > ATAPI_DRQ_LIMIT ? ATAPI_DRQ_LIMIT : buf_len;
+    if (limit == 0) limit = ATAPI_DRQ_LIMIT;
 
     /* Select master, DMA=0, OVL=0 */
     outb(ATA_DRIVE_HEAD, 0xA0u);
-    for (int i = 0; i < 4; i++) inb(ATA_ALT_STATUS);
+    ata_delay400ns();
 
-    /* Write maximum byte count for PIO transfer */
-    outb(ATA_FEATURES,     0x00u);   /* no DMA */
+    outb(ATA_FEATURES,     0x00u);   /* PIO data phase */
     outb(ATA_SECTOR_COUNT, 0x00u);
     outb(ATA_LBA_LO,       0x00u);
-    outb(ATA_LBA_MID,      (uint8_t)( buf_len       & 0xFFu));
-    outb(ATA_LBA_HI,       (uint8_t)((buf_len >> 8) & 0xFFu));
+    outb(ATA_LBA_MID,      (uint8_t)( limit       & 0xFFu));
+    outb(ATA_LBA_HI,       (uint8_t)((limit >> 8) & 0xFFu));
 
     /* Issue PACKET command */
     outb(ATA_COMMAND, 0xA0u);
-    for (int i = 0; i < 4; i++) inb(ATA_ALT_STATUS);
 
     /* Wait for DRQ (device ready for packet) */
-    int timeout = 100000;
-    uint8_t status;
-    do {
-        status = inb(ATA_STATUS);
-        if (status & 0x01u) return -1;  /* ERR set */
-    } while ((status & ATA_SR_BSY) && --timeout > 0);
-    if (timeout == 0 || !(status & ATA_SR_DRQ)) return -1;
+    uint8_t status = atapi_wait_phase();
+    if (status == 0xFF || (status & ATA_SR_ERR) || !(status & ATA_SR_DRQ)) return -1;
 
     /* Write the 12-byte command packet as 6 × 16-bit words */
     const uint16_t *pw = (const uint16_t *)packet12;
     for (int i = 0; i < 6; i++) outw(ATA_DATA, pw[i]);
 
-    if (!data_in || buf_len == 0) return 0;   /* non-data command */
-
-    /* Wait for DRQ with data available */
-    timeout = 100000;
-    do {
-        status = inb(ATA_STATUS);
-        if (status & 0x01u) return -1;
-    } while ((status & ATA_SR_BSY) && --timeout > 0);
-    if (timeout == 0 || !(status & ATA_SR_DRQ)) return -1;
-
-    /* Read PIO data */
-    uint16_t actual = (uint16_t)((inb(ATA_LBA_HI) << 8) | inb(ATA_LBA_MID));
-    uint16_t to_read = (actual < buf_len) ? actual : buf_len;
-    uint16_t *dst = (uint16_t *)data_in;
-    for (uint16_t i = 0; i < to_read / 2; i++) dst[i] = inw(ATA_DATA);
-
-    return 0;
+    /* Data phase: one DRQ block per iteration until the device drops DRQ
+     * and enters the status phase. */
+    uint8_t *dst = (uint8_t *)data_in;
+    uint32_t got = 0;
+    for (;;) {
+        status = atapi_wait_phase();
+        if (status == 0xFF || (status & ATA_SR_ERR)) return -1;
+        if (!(status & ATA_SR_DRQ)) break;
+
+        uint32_t actual = ((uint32_t)inb(ATA_LBA_HI) << 8) | inb(ATA_LBA_MID);
+        uint32_t words  = (actual + 1) / 2;
+        for (uint32_t i = 0; i < words; i++) {
+            uint16_t w = inw(ATA_DATA);
+            if (dst && got + 1 < buf_len) {
+                dst[got] = (uint8_t)w; dst[got + 1] = (uint8_t)(w >> 8);
+                got += 2;
+            } else if (dst && got < buf_len) {
+                dst[got++] = (uint8_t)w;
+            }
+            /* anything past buf_len is drained and dropped */
+        }
+    }
+    return (int)got;
 }
@@ -77,6 +77,11 @@ int  ata_dma_read28 (uint32_t lba, uint8_t count,
  * Returns 0 on success, -1 on error/timeout or no ATAPI device.
  */
 
+/** Largest data phase of one packet: 32 CD sectors. */
+#define ATAPI_MAX_TRANSFER  65536u
+/** Byte count limit programmed per DRQ block (31 sectors, even). */
+#define ATAPI_DRQ_LIMIT     0xF800u
+
 /**
  * Detect whether the primary master is an ATAPI device (CD-ROM, DVD, etc.).
  * Returns 1 if ATAPI, 0 if ATA, -1 if nothing present.
@@ -85,11 +90,14 @@ int ata_is_atapi(void);
 
 /**
  * Send a 12-byte ATAPI command packet to the primary master ATAPI device.
- * If `data_in` is non-NULL, read up to `buf_len` bytes of PIO data response.
- * If `data_in` is NULL, this is a non-data command.
- * Returns 0 on success, -1 on DRQ timeout or error.
+ * If `data_in` is non-NULL, read up to `buf_len` bytes (at most
+ * ATAPI_MAX_TRANSFER) of PIO data response straight into it, across as many
+ * DRQ blocks as the device splits the transfer into; surplus bytes are
+ * drained.  If `data_in` is NULL, this is a non-data command.
+ * Returns the number of bytes stored, or -1 on timeout or error (CHECK
+ * CONDITION: the caller issues REQUEST SENSE).
  */
 int ata_atapi_send_packet(const uint8_t *packet12,
-                          void *data_in, uint16_t buf_len);
+                          void *data_in, uint32_t buf_len);
 
 #endif /* ATA_H */
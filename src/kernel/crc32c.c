@@ -0,0 +1,89 @@
+/*
+ * crc32c.c — CRC-32C register update (see crc32c.h)
+ *
+ * The hardware path feeds the SSE4.2 CRC32 instruction four bytes at a time
+ * (the kernel is 32-bit, so there is no 8-byte form) after aligning the
+ * pointer.  The software path is slicing-by-8: eight 256-entry tables built
+ * on first use, eight input bytes per step.
+ */
+
+#include "crc32c.h"
+#include "cpuid.h"
+#include <string.h>
+
+#define CRC32C_POLY 0x82F63B78u
+
+static uint32_t _tables[8][256];
+static int      _tables_ready;
+
+static void build_tables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1u) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        _tables[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = _tables[t - 1][i];
+            _tables[t][i] = _tables[0][prev & 0xFFu] ^ (prev >> 8);
+        }
+    }
+    _tables_ready = 1;
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, uint32_t len) {
+    if (!_tables_ready) build_tables();
+    while (len && ((uintptr_t)p & 3u)) {
+        crc = _tables[0][(crc ^ *p++) & 0xFFu] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = _tables[7][ lo        & 0xFFu] ^ _tables[6][(lo >>  8) & 0xFFu] ^
+              _tables[5][(lo >> 16) & 0xFFu] ^ _tables[4][ lo >> 24        ] ^
+              _tables[3][ hi        & 0xFFu] ^ _tables[2][(hi >>  8) & 0xFFu] ^
+              _tables[1][(hi >> 16) & 0xFFu] ^ _tables[0][ hi >> 24        ];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = _tables[0][(crc ^ *p++) & 0xFFu] ^ (crc >> 8);
+    return crc;
+}
+
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *p, uint32_t len) {
+    while (len && ((uintptr_t)p & 3u)) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(*p));
+        p++;
+        len--;
+    }
+    while (len >= 16) {
+        uint32_t w0, w1, w2, w3;
+        memcpy(&w0, p, 4); memcpy(&w1, p + 4, 4);
+        memcpy(&w2, p + 8, 4); memcpy(&w3, p + 12, 4);
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(w0));
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(w1));
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(w2));
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(w3));
+        p += 16;
+        len -= 16;
+    }
+    while (len >= 4) {
+        uint32_t w;
+        memcpy(&w, p, 4);
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(w));
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(*p));
+        p++;
+    }
+    return crc;
+}
+
+uint32_t crc32c_update(uint32_t crc, const uint8_t *p, uint32_t len) {
+    return cpuid_features.sse42 ? crc32c_hw(crc, p, len) : crc32c_sw(crc, p, len);
+}
@@ -0,0 +1,22 @@
+/*
+ * JSOS CRC-32C kernel
+ *
+ * Castagnoli CRC-32 for the filesystems' metadata and data checksums
+ * (ext4 metadata_csum, JBD2, the copy-on-write filesystem in fs/cowfs.ts).
+ * Uses the SSE4.2 CRC32 instruction when the CPU has it and slicing-by-8
+ * tables otherwise.  JS reaches it through kernel.crc32c(crc, buf, off, len);
+ * fs/crc.ts keeps a table-driven fallback that produces identical values.
+ *
+ * Same convention as fs/crc.ts: a raw register update — the caller seeds
+ * (usually ~0) and no final inversion is applied.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+
+/** Update `crc` with `len` bytes at `p`. */
+uint32_t crc32c_update(uint32_t crc, const uint8_t *p, uint32_t len);
+
+#endif /* CRC32C_H */
@@ -0,0 +1,414 @@
+/*
+ * imgcodec.c — JPEG IDCT / colour conversion and PNG unfiltering (see imgcodec.h)
+ *
+ * The 8×8 IDCT is the AAN scaled transform with 8-bit butterfly constants,
+ * as in libjpeg's "ifast", leaving five multiplies per 1-D pass.  The AAN
+ * scale factors are folded into dequantisation, but unlike ifast the
+ * product keeps all 14 scale bits and is rounded to AAN_FRAC fraction bits
+ * afterwards — ifast's 2-bit multipliers fall apart at high quality, where
+ * quantisers are 1-2.  Columns and rows whose AC terms are all zero — most
+ * of them in real images — short-cut to the DC value.
+ * Reduced sizes use a direct n-point transform with 12-bit constants.
+ *
+ * The SSE2 paths use GCC vector types and the ia32 builtins directly so the
+ * freestanding build needs no intrinsics headers; they are compiled with
+ * target("sse2") and picked at run time from cpuid_features, like crc32c.c.
+ * Results are bit-identical to the scalar paths.
+ */
+
+#include "imgcodec.h"
+#include "cpuid.h"
+#include <string.h>
+
+static inline uint8_t clamp8(int32_t v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/* ── JPEG inverse DCT ─────────────────────────────────────────────────── */
+
+/* AAN scale factors × 2^14: 16384 · C(u) · C(v) · cos terms of the
+ * factored 8-point transform (libjpeg jddctmgr.c). */
+static const uint16_t _aan_scales[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+     8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+     4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247,
+};
+
+#define FIX_1_082392200  277
+#define FIX_1_414213562  362
+#define FIX_1_847759065  473
+#define FIX_2_613125930  669
+#define AAN_MUL(v, k)    (((v) * (k)) >> 8)
+
+/* Fraction bits carried through both passes.  With 8-bit samples every
+ * intermediate stays below 2^30. */
+#define AAN_FRAC         6
+#define AAN_DEQ(c, q)    (((c) * (q) + (1 << (13 - AAN_FRAC))) >> (14 - AAN_FRAC))
+
+/* Final descale: the fraction bits plus the 8× of the two passes, rounded,
+ * with the +128 level shift folded in. */
+#define AAN_SHIFT        (AAN_FRAC + 3)
+#define AAN_BIAS         ((1 << (AAN_SHIFT - 1)) + (128 << AAN_SHIFT))
+
+static void idct8(const int16_t *in, const int32_t *q, uint8_t *out, uint32_t stride) {
+    int32_t ws[64];
+
+    for (int x = 0; x < 8; x++) {
+        const int16_t *ip = in + x;
+        const int32_t *qp = q + x;
+        int32_t *wp = ws + x;
+        if (!(ip[8] | ip[16] | ip[24] | ip[32] | ip[40] | ip[48] | ip[56])) {
+            int32_t dc = AAN_DEQ(ip[0], qp[0]);
+            for (int k = 0; k < 64; k += 8) wp[k] = dc;
+            continue;
+        }
+        int32_t t0 = AAN_DEQ(ip[0], qp[0]), t1 = AAN_DEQ(ip[16], qp[16]);
+        int32_t t2 = AAN_DEQ(ip[32], qp[32]), t3 = AAN_DEQ(ip[48], qp[48]);
+        int32_t t10 = t0 + t2, t11 = t0 - t2;
+        int32_t t13 = t1 + t3, t12 = AAN_MUL(t1 - t3, FIX_1_414213562) - t13;
+        t0 = t10 + t13; t3 = t10 - t13;
+        t1 = t11 + t12; t2 = t11 - t12;
+
+        int32_t t4 = AAN_DEQ(ip[8], qp[8]), t5 = AAN_DEQ(ip[24], qp[24]);
+        int32_t t6 = AAN_DEQ(ip[40], qp[40]), t7 = AAN_DEQ(ip[56], qp[56]);
+        int32_t z13 = t6 + t5, z10 = t6 - t5, z11 = t4 + t7, z12 = t4 - t7;
+        t7 = z11 + z13;
+        t11 = AAN_MUL(z11 - z13, FIX_1_414213562);
+        int32_t z5 = AAN_MUL(z10 + z12, FIX_1_847759065);
+        t10 = AAN_MUL(z12, FIX_1_082392200) - z5;
+        t12 = AAN_MUL(z10, -FIX_2_613125930) + z5;
+        t6 = t12 - t7; t5 = t11 - t6; t4 = t10 + t5;
+
+        wp[0]  = t0 + t7; wp[56] = t0 - t7;
+        wp[8]  = t1 + t6; wp[48] = t1 - t6;
+        wp[16] = t2 + t5; wp[40] = t2 - t5;
+        wp[32] = t3 + t4; wp[24] = t3 - t4;
+    }
+
+    for (int y = 0; y < 8; y++) {
+        const int32_t *wp = ws + y * 8;
+        uint8_t *op = out + y * stride;
+        int32_t dc = wp[0] + AAN_BIAS;
+        if (!(wp[1] | wp[2] | wp[3] | wp[4] | wp[5] | wp[6] | wp[7])) {
+            uint8_t v = clamp8(dc >> AAN_SHIFT);
+            for (int k = 0; k < 8; k++) op[k] = v;
+            continue;
+        }
+        int32_t t10 = dc + wp[4], t11 = dc - wp[4];
+        int32_t t13 = wp[2] + wp[6], t12 = AAN_MUL(wp[2] - wp[6], FIX_1_414213562) - t13;
+        int32_t t0 = t10 + t13, t3 = t10 - t13, t1 = t11 + t12, t2 = t11 - t12;
+
+        int32_t z13 = wp[5] + wp[3], z10 = wp[5] - wp[3];
+        int32_t z11 = wp[1] + wp[7], z12 = wp[1] - wp[7];
+        int32_t t7 = z11 + z13;
+        t11 = AAN_MUL(z11 - z13, FIX_1_414213562);
+        int32_t z5 = AAN_MUL(z10 + z12, FIX_1_847759065);
+        t10 = AAN_MUL(z12, FIX_1_082392200) - z5;
+        t12 = AAN_MUL(z10, -FIX_2_613125930) + z5;
+        int32_t t6 = t12 - t7, t5 = t11 - t6, t4 = t10 + t5;
+
+        op[0] = clamp8((t0 + t7) >> AAN_SHIFT); op[7] = clamp8((t0 - t7) >> AAN_SHIFT);
+        op[1] = clamp8((t1 + t6) >> AAN_SHIFT); op[6] = clamp8((t1 - t6) >> AAN_SHIFT);
+        op[2] = clamp8((t2 + t5) >> AAN_SHIFT); op[5] = clamp8((t2 - t5) >> AAN_SHIFT);
+        op[4] = clamp8((t3 + t4) >> AAN_SHIFT); op[3] = clamp8((t3 - t4) >> AAN_SHIFT);
+    }
+}
+
+/* 0.5 · C(u) · cos((2x+1)uπ/2n) × 2^12 for n = 4 and 2, indexed [u*n + x]. */
+static const int16_t _idct4[16] = {
+    1448,  1448,  1448,  1448,
+    1892,   784,  -784, -1892,
+    1448, -1448, -1448,  1448,
+     784, -1892,  1892,  -784,
+};
+static const int16_t _idct2[4] = {
+    1448,  1448,
+    1448, -1448,
+};
+
+/* n-point IDCT of the top-left n×n coefficients: rows keep 3 fraction
+ * bits, columns descale by 15 with the level shift folded into the bias. */
+static void idct_reduced(const int16_t *in, const uint16_t *qt, uint8_t *out,
+                         uint32_t stride, int n) {
+    const int16_t *t = n == 4 ? _idct4 : _idct2;
+    int32_t tmp[16];
+    for (int v = 0; v < n; v++) {
+        for (int x = 0; x < n; x++) {
+            int32_t s = 0;
+            for (int u = 0; u < n; u++) s += in[v * 8 + u] * qt[v * 8 + u] * t[u * n + x];
+            tmp[v * n + x] = (s + (1 << 8)) >> 9;
+        }
+    }
+    for (int x = 0; x < n; x++) {
+        for (int y = 0; y < n; y++) {
+            int32_t s = (1 << 14) + (128 << 15);
+            for (int v = 0; v < n; v++) s += tmp[v * n + x] * t[v * n + y];
+            out[y * stride + x] = clamp8(s >> 15);
+        }
+    }
+}
+
+void jpeg_idct_band(int16_t *coef, const uint16_t *qt, uint8_t *plane,
+                    uint32_t stride, uint32_t blocks_w, uint32_t blocks_h,
+                    uint32_t n) {
+    int32_t q[64];
+    if (n == 8) {
+        /* Quantisers past 15 bits only ever scale zero or ±1 coefficients;
+         * clamping keeps the product in int32. */
+        for (int i = 0; i < 64; i++) q[i] = (int32_t)(qt[i] > 0x7FFF ? 0x7FFF : qt[i]) * _aan_scales[i];
+    }
+    for (uint32_t by = 0; by < blocks_h; by++) {
+        const int16_t *blk = coef + by * blocks_w * 64;
+        uint8_t *row = plane + by * n * stride;
+        for (uint32_t bx = 0; bx < blocks_w; bx++, blk += 64, row += n) {
+            if (n == 8) {
+                idct8(blk, q, row, stride);
+            } else if (n == 1) {
+                *row = clamp8(((blk[0] * qt[0] + 4) >> 3) + 128);
+            } else {
+                idct_reduced(blk, qt, row, stride, (int)n);
+            }
+        }
+    }
+    memset(coef, 0, blocks_w * blocks_h * 64 * sizeof(int16_t));
+}
+
+/* ── SSE2 helpers ─────────────────────────────────────────────────────── */
+
+typedef char      v16qi __attribute__((vector_size(16)));
+typedef short     v8hi  __attribute__((vector_size(16)));
+typedef int       v4si  __attribute__((vector_size(16)));
+
+#define SSE2 __attribute__((target("sse2"), always_inline)) static inline
+
+/* -ffreestanding turns off the memcpy builtin; spell it out so these stay
+ * single MOVD/MOVQ/MOVDQU instructions. */
+SSE2 v16qi load8(const uint8_t *p) { v16qi v = {0}; __builtin_memcpy(&v, p, 8); return v; }
+SSE2 v16qi load4(const uint8_t *p) { v16qi v = {0}; __builtin_memcpy(&v, p, 4); return v; }
+SSE2 v16qi load3(const uint8_t *p) { v16qi v = {0}; __builtin_memcpy(&v, p, 3); return v; }
+SSE2 v16qi load16(const uint8_t *p) { v16qi v; __builtin_memcpy(&v, p, 16); return v; }
+SSE2 void store16(uint8_t *p, v16qi v) { __builtin_memcpy(p, &v, 16); }
+
+/* One 3- or 4-byte pixel. */
+SSE2 v16qi load_px(const uint8_t *p, uint32_t bpp) { return bpp == 4 ? load4(p) : load3(p); }
+SSE2 void store_px(uint8_t *p, v16qi v, uint32_t bpp) {
+    if (bpp == 4) __builtin_memcpy(p, &v, 4);
+    else __builtin_memcpy(p, &v, 3);
+}
+
+/* Bytes 0-7 of `b`, zero-extended to eight 16-bit lanes. */
+SSE2 v8hi widen8(v16qi b) {
+    v16qi z = {0};
+    return (v8hi)__builtin_ia32_punpcklbw128(b, z);
+}
+
+SSE2 v8hi abs16(v8hi x) {
+    v8hi z = {0};
+    return __builtin_ia32_pmaxsw128(x, z - x);
+}
+
+/* ── YCbCr → RGB ──────────────────────────────────────────────────────── */
+
+/* 14-bit fixed point so each product pair fits PMADDWD: rounding is folded
+ * in as the second half of a (chroma, 1) pair. */
+#define YCC_R_CR   22970    /* 1.40200 */
+#define YCC_G_CB   (-5638)  /* -0.34414 */
+#define YCC_G_CR   (-11700) /* -0.71414 */
+#define YCC_B_CB   29032    /* 1.77200 */
+#define YCC_HALF   8192
+
+static inline uint32_t ycc_pixel(int32_t y, int32_t cb, int32_t cr) {
+    cb -= 128;
+    cr -= 128;
+    int32_t r = y + ((YCC_R_CR * cr + YCC_HALF) >> 14);
+    int32_t g = y + ((YCC_G_CB * cb + YCC_G_CR * cr + YCC_HALF) >> 14);
+    int32_t b = y + ((YCC_B_CB * cb + YCC_HALF) >> 14);
+    return 0xFF000000u | ((uint32_t)clamp8(r) << 16) | ((uint32_t)clamp8(g) << 8) | clamp8(b);
+}
+
+/* Eight pixels of one row; returns how many pixels were converted. */
+__attribute__((target("sse2")))
+static uint32_t ycc_row_sse2(uint32_t *out, uint32_t w, const uint8_t *y,
+                             const uint8_t *cb, const uint8_t *cr, uint32_t hs) {
+    const v8hi one    = { 1, 1, 1, 1, 1, 1, 1, 1 };
+    const v8hi k_r    = { YCC_R_CR, YCC_HALF, YCC_R_CR, YCC_HALF, YCC_R_CR, YCC_HALF, YCC_R_CR, YCC_HALF };
+    const v8hi k_b    = { YCC_B_CB, YCC_HALF, YCC_B_CB, YCC_HALF, YCC_B_CB, YCC_HALF, YCC_B_CB, YCC_HALF };
+    const v8hi k_g    = { YCC_G_CB, YCC_G_CR, YCC_G_CB, YCC_G_CR, YCC_G_CB, YCC_G_CR, YCC_G_CB, YCC_G_CR };
+    const v4si half   = { YCC_HALF, YCC_HALF, YCC_HALF, YCC_HALF };
+    const v16qi alpha = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+    uint32_t x = 0;
+    for (; x + 8 <= w; x += 8) {
+        v16qi cb8, cr8;
+        if (hs == 2) {
+            cb8 = load4(cb + (x >> 1)); cb8 = __builtin_ia32_punpcklbw128(cb8, cb8);
+            cr8 = load4(cr + (x >> 1)); cr8 = __builtin_ia32_punpcklbw128(cr8, cr8);
+        } else {
+            cb8 = load8(cb + x);
+            cr8 = load8(cr + x);
+        }
+        v8hi Y  = widen8(load8(y + x));
+        v8hi Cb = widen8(cb8) - 128;
+        v8hi Cr = widen8(cr8) - 128;
+
+        v4si lo, hi;
+        lo = __builtin_ia32_pmaddwd128(__builtin_ia32_punpcklwd128(Cr, one), k_r);
+        hi = __builtin_ia32_pmaddwd128(__builtin_ia32_punpckhwd128(Cr, one), k_r);
+        v8hi R = Y + __builtin_ia32_packssdw128(__builtin_ia32_psradi128(lo, 14),
+                                                __builtin_ia32_psradi128(hi, 14));
+        lo = __builtin_ia32_pmaddwd128(__builtin_ia32_punpcklwd128(Cb, Cr), k_g) + half;
+        hi = __builtin_ia32_pmaddwd128(__builtin_ia32_punpckhwd128(Cb, Cr), k_g) + half;
+        v8hi G = Y + __builtin_ia32_packssdw128(__builtin_ia32_psradi128(lo, 14),
+                                                __builtin_ia32_psradi128(hi, 14));
+        lo = __builtin_ia32_pmaddwd128(__builtin_ia32_punpcklwd128(Cb, one), k_b);
+        hi = __builtin_ia32_pmaddwd128(__builtin_ia32_punpckhwd128(Cb, one), k_b);
+        v8hi B = Y + __builtin_ia32_packssdw128(__builtin_ia32_psradi128(lo, 14),
+                                                __builtin_ia32_psradi128(hi, 14));
+
+        /* Saturate to bytes, then interleave B,G,R,A into little-endian ARGB. */
+        v16qi r8 = __builtin_ia32_packuswb128(R, R);
+        v16qi g8 = __builtin_ia32_packuswb128(G, G);
+        v16qi b8 = __builtin_ia32_packuswb128(B, B);
+        v8hi bg = (v8hi)__builtin_ia32_punpcklbw128(b8, g8);
+        v8hi ra = (v8hi)__builtin_ia32_punpcklbw128(r8, alpha);
+        store16((uint8_t *)(out + x),     (v16qi)__builtin_ia32_punpcklwd128(bg, ra));
+        store16((uint8_t *)(out + x + 4), (v16qi)__builtin_ia32_punpckhwd128(bg, ra));
+    }
+    return x;
+}
+
+void jpeg_ycc_rows(uint32_t *out, uint32_t w, uint32_t h,
+                   const uint8_t *y, uint32_t y_stride,
+                   const uint8_t *cb, const uint8_t *cr, uint32_t c_stride,
+                   uint32_t hs, uint32_t vs) {
+    int sse2 = cpuid_features.sse2;
+    for (uint32_t row = 0; row < h; row++, out += w, y += y_stride) {
+        if (!cb) {
+            for (uint32_t x = 0; x < w; x++) out[x] = 0xFF000000u | y[x] * 0x010101u;
+            continue;
+        }
+        const uint8_t *cbr = cb + (row / vs) * c_stride;
+        const uint8_t *crr = cr + (row / vs) * c_stride;
+        uint32_t x = sse2 ? ycc_row_sse2(out, w, y, cbr, crr, hs) : 0;
+        for (; x < w; x++) out[x] = ycc_pixel(y[x], cbr[x / hs], crr[x / hs]);
+    }
+}
+
+/* ── PNG unfilter ─────────────────────────────────────────────────────── */
+
+static inline uint8_t paeth(int a, int b, int c) {
+    int pa = b - c, pb = a - c, pc = pa + pb;
+    if (pa < 0) pa = -pa;
+    if (pb < 0) pb = -pb;
+    if (pc < 0) pc = -pc;
+    return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+/* One row; `prev` is NULL for the first row of an image or pass. */
+static void unfilter_row(int ft, const uint8_t *s, uint8_t *d, const uint8_t *prev,
+                         uint32_t n, uint32_t bpp) {
+    uint32_t i;
+    uint32_t lead = bpp < n ? bpp : n;
+    switch (prev ? ft : ft == 2 ? 0 : ft == 4 ? 1 : ft) {
+    case 1:
+        for (i = 0; i < lead; i++) d[i] = s[i];
+        for (; i < n; i++) d[i] = (uint8_t)(s[i] + d[i - bpp]);
+        break;
+    case 2:
+        for (i = 0; i < n; i++) d[i] = (uint8_t)(s[i] + prev[i]);
+        break;
+    case 3:
+        if (!prev) {
+            for (i = 0; i < lead; i++) d[i] = s[i];
+            for (; i < n; i++) d[i] = (uint8_t)(s[i] + (d[i - bpp] >> 1));
+            break;
+        }
+        for (i = 0; i < lead; i++) d[i] = (uint8_t)(s[i] + (prev[i] >> 1));
+        for (; i < n; i++) d[i] = (uint8_t)(s[i] + ((d[i - bpp] + prev[i]) >> 1));
+        break;
+    case 4:
+        for (i = 0; i < lead; i++) d[i] = (uint8_t)(s[i] + prev[i]);
+        for (; i < n; i++) d[i] = (uint8_t)(s[i] + paeth(d[i - bpp], prev[i], prev[i - bpp]));
+        break;
+    default:
+        memcpy(d, s, n);
+    }
+}
+
+/* SSE2 rows for filters that vectorise: Up across 16 bytes, and Sub, Avg
+ * and Paeth one 3- or 4-byte pixel per step with the channels in parallel
+ * (the same scheme as libpng's filter_sse2_intrinsics.c).  Returns 0 when
+ * the row needs the scalar path. */
+__attribute__((target("sse2")))
+static int unfilter_row_sse2(int ft, const uint8_t *s, uint8_t *d, const uint8_t *prev,
+                             uint32_t n, uint32_t bpp) {
+    uint32_t i = 0;
+    if (ft == 2) {
+        for (; i + 16 <= n; i += 16) store16(d + i, load16(s + i) + load16(prev + i));
+        for (; i < n; i++) d[i] = (uint8_t)(s[i] + prev[i]);
+        return 1;
+    }
+    if ((bpp != 3 && bpp != 4) || ft < 1 || ft > 4) return 0;
+
+    v16qi a = {0}, x;
+    v8hi a16 = {0}, b16 = {0}, c16, x16;
+    for (; i + bpp <= n; i += bpp) {
+        x = load_px(s + i, bpp);
+        switch (ft) {
+        case 1:
+            a = x + a;
+            store_px(d + i, a, bpp);
+            break;
+        case 3: {
+            v16qi b = load_px(prev + i, bpp);
+            v16qi avg = __builtin_ia32_pavgb128(a, b);
+            v16qi lsb = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+            avg -= (a ^ b) & lsb;       /* PAVGB rounds up; PNG floors */
+            a = x + avg;
+            store_px(d + i, a, bpp);
+            break;
+        }
+        case 4: {
+            c16 = b16;
+            b16 = widen8(load_px(prev + i, bpp));
+            x16 = widen8(x);
+            v8hi pa = b16 - c16, pb = a16 - c16, pc = pa + pb;
+            pa = abs16(pa); pb = abs16(pb); pc = abs16(pc);
+            v8hi m = __builtin_ia32_pminsw128(pc, __builtin_ia32_pminsw128(pa, pb));
+            v8hi ta = (v8hi)(m == pa), tb = (v8hi)(m == pb);
+            v8hi near = (ta & a16) | (~ta & ((tb & b16) | (~tb & c16)));
+            a16 = (x16 + near) & 0xFF;
+            v16qi out = __builtin_ia32_packuswb128(a16, a16);
+            store_px(d + i, out, bpp);
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+    /* Scalar tail with the same predictors. */
+    for (; i < n; i++) {
+        int l = i >= bpp ? d[i - bpp] : 0;
+        int up = prev[i], ul = i >= bpp ? prev[i - bpp] : 0;
+        d[i] = (uint8_t)(s[i] + (ft == 1 ? l : ft == 3 ? (l + up) >> 1 : paeth(l, up, ul)));
+    }
+    return 1;
+}
+
+void png_unfilter(const uint8_t *src, uint8_t *dst, uint32_t stride,
+                  uint32_t rows, uint32_t bpp, const uint8_t *prev) {
+    int sse2 = cpuid_features.sse2;
+    if (bpp == 0) bpp = 1;
+    for (uint32_t r = 0; r < rows; r++) {
+        int ft = src[0];
+        if (!(sse2 && prev && unfilter_row_sse2(ft, src + 1, dst, prev, stride, bpp)))
+            unfilter_row(ft, src + 1, dst, prev, stride, bpp);
+        prev = dst;
+        src += stride + 1;
+        dst += stride;
+    }
+}
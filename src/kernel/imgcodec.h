@@ -0,0 +1,55 @@
+/*
+ * JSOS image codec kernels
+ *
+ * The per-pixel inner loops of the browser's JPEG and PNG decoders
+ * (apps/browser/img-jpeg.ts, img-png.ts): the JPEG inverse DCT with fused
+ * dequantisation, YCbCr→RGB conversion with chroma upsampling, and PNG
+ * scanline unfiltering.  Everything else — marker parsing, Huffman and
+ * inflate — stays in JS.  JS reaches these through kernel.jpegIdct,
+ * kernel.jpegColor and kernel.pngUnfilter, and keeps integer fallbacks that
+ * produce the same bytes, so a decode looks the same with or without them.
+ *
+ * Colour conversion and unfiltering use SSE2 when the CPU has it.
+ */
+
+#ifndef IMGCODEC_H
+#define IMGCODEC_H
+
+#include <stdint.h>
+
+/**
+ * Inverse-DCT a band of blocks_w × blocks_h coefficient blocks into `plane`.
+ * Block (bx, by) holds 64 quantised coefficients in natural (row-major)
+ * order at coef[(by * blocks_w + bx) * 64] and lands at
+ * plane[by * n * stride + bx * n] as n × n samples; n is 8 (AAN integer
+ * IDCT) or 4, 2, 1 (reduced-size IDCT for DCT-domain downscaling).
+ * `qt` is the quantisation table in natural order.  The coefficients are
+ * zeroed afterwards so the band can be refilled directly.
+ */
+void jpeg_idct_band(int16_t *coef, const uint16_t *qt, uint8_t *plane,
+                    uint32_t stride, uint32_t blocks_w, uint32_t blocks_h,
+                    uint32_t n);
+
+/**
+ * Convert w × h pixels to 0xFFRRGGBB at out[row * w + x].  Chroma sample
+ * (x / hs, row / vs) pairs with luma sample (x, row); hs and vs are 1 or 2.
+ * With cb == NULL the luma plane is written as greyscale.
+ */
+void jpeg_ycc_rows(uint32_t *out, uint32_t w, uint32_t h,
+                   const uint8_t *y, uint32_t y_stride,
+                   const uint8_t *cb, const uint8_t *cr, uint32_t c_stride,
+                   uint32_t hs, uint32_t vs);
+
+/**
+ * Undo PNG filtering for `rows` scanlines.  `src` holds one filter-type
+ * byte followed by `stride` filtered bytes per row; `dst` receives the
+ * reconstructed rows back to back.  `prev` is the reconstructed row above
+ * the first, or NULL to take it as zero (start of an image or of an Adam7
+ * pass); a streaming decoder passes the last row it produced.  `bpp` is the
+ * filter distance in bytes (1 for sub-byte depths).  Unknown filter types
+ * are copied through unchanged.
+ */
+void png_unfilter(const uint8_t *src, uint8_t *dst, uint32_t stride,
+                  uint32_t rows, uint32_t bpp, const uint8_t *prev);
+
+#endif /* IMGCODEC_H */
@@ -0,0 +1,78 @@
+/*
+ * initrd.c — Multiboot2 initramfs module lookup (see initrd.h)
+ */
+
+#include "initrd.h"
+#include "memory.h"
+#include "platform.h"
+#include <string.h>
+
+#define MB2_TAG_MODULE 3u
+
+static const uint8_t *_initrd;
+static uint32_t       _initrd_len;
+
+/* sbrk() hands out [_heap_start, _heap_end) lazily (linker.ld) */
+extern char _heap_start[], _heap_end[];
+
+/*
+ * Module tag:
+ *   +0  type (3)   +4 size
+ *   +8  mod_start  +12 mod_end (exclusive)
+ *   +16 NUL-terminated command line
+ */
+void initrd_init(uint32_t mb2_info_addr) {
+    _initrd = NULL;
+    _initrd_len = 0;
+    if (!mb2_info_addr) return;
+
+    uint8_t  *p   = (uint8_t *)mb2_info_addr;
+    uint32_t  tot = *(uint32_t *)p;
+    uint8_t  *end = p + tot;
+    p += 8;
+
+    uint32_t first_start = 0, first_end = 0, modules = 0;
+    while (p < end) {
+        uint32_t type = *(uint32_t *)p;
+        uint32_t size = *(uint32_t *)(p + 4);
+        if (type == 0) break;
+        if (type == MB2_TAG_MODULE && size >= 16) {
+            uint32_t ms = *(uint32_t *)(p + 8);
+            uint32_t me = *(uint32_t *)(p + 12);
+            const char *cmd = size > 16 ? (const char *)(p + 16) : "";
+            if (me > ms) {
+                if (modules++ == 0) { first_start = ms; first_end = me; }
+                if (!_initrd && strstr(cmd, "initramfs")) {
+                    _initrd = (const uint8_t *)(uintptr_t)ms;
+                    _initrd_len = me - ms;
+                }
+            }
+        }
+        p += (size + 7u) & ~7u;
+    }
+    if (!_initrd && modules == 1) {
+        _initrd = (const uint8_t *)(uintptr_t)first_start;
+        _initrd_len = first_end - first_start;
+    }
+    if (!_initrd) return;
+
+    /* The heap window is NOLOAD, so GRUB may have placed the module inside
+     * it; sbrk() would then hand those bytes out.  Drop the module rather
+     * than read it while the heap overwrites it. */
+    uintptr_t ms = (uintptr_t)_initrd, me = ms + _initrd_len;
+    if (ms < (uintptr_t)_heap_end && me > (uintptr_t)_heap_start) {
+        platform_boot_print("[BOOT] initramfs module overlaps the heap window, ignored\n");
+        _initrd = NULL;
+        _initrd_len = 0;
+        return;
+    }
+    /* Only covers the low range memory.c tracks; frames from 2.5 GB up are
+     * reserved by physalloc.ts through kernel.getInitramfsRange(). */
+    memory_reserve_region((uint32_t)ms, _initrd_len);
+    platform_boot_print("[BOOT] initramfs module found\n");
+}
+
+const uint8_t *initrd_data(uint32_t *len) {
+    *len = _initrd_len;
+    return _initrd;
+}
@@ -0,0 +1,28 @@
+/*
+ * JSOS initramfs module
+ *
+ * GRUB loads the initramfs as a Multiboot2 module (tag type 3):
+ *
+ *   module2 /boot/initramfs.cpio.gz initramfs
+ *
+ * initrd_init() records the first module whose command line contains
+ * "initramfs" (or the only module, if there is just one).  The bytes stay
+ * where GRUB put them and JS reads them in place through
+ * kernel.getInitramfs().  A module inside the kernel heap window is
+ * ignored; one in the JS frame allocator's range is reserved there
+ * (physalloc.ts, via kernel.getInitramfsRange()).  Compressed (gzip / lz4) images
+ * are unpacked by fs/initramfs.ts, not here.
+ */
+
+#ifndef INITRD_H
+#define INITRD_H
+
+#include <stdint.h>
+
+/** Scan the Multiboot2 info for the initramfs module.  Safe with 0. */
+void initrd_init(uint32_t mb2_info_addr);
+
+/** Module bytes, or NULL (and *len = 0) when none was loaded. */
+const uint8_t *initrd_data(uint32_t *len);
+
+#endif /* INITRD_H */
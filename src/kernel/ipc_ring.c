@@ -0,0 +1,105 @@
+/*
+ * ipc_ring.c — Variable-length lock-free message rings (see ipc_ring.h)
+ *
+ * Memory ordering: the producer fills a record and then publishes it with
+ * a release store of `head`; the consumer reads `head` with acquire before
+ * touching the record.  Symmetrically, the consumer releases `tail` only
+ * after it is done with every payload in the batch, and the producer
+ * acquires `tail` before reusing that space.
+ */
+
+#include "ipc_ring.h"
+#include <malloc.h>
+#include <string.h>
+
+#define ALIGN8(n)  (((n) + 7u) & ~7u)
+
+int ipc_ring_init(ipc_ring_t *r, uint32_t bytes)
+{
+    uint32_t size = IPC_RING_MIN_BYTES;
+    if (bytes > IPC_RING_MAX_BYTES) bytes = IPC_RING_MAX_BYTES;
+    while (size < bytes) size <<= 1u;
+
+    memset(r, 0, sizeof(*r));
+    r->buf = (uint8_t *)memalign(64u, size);
+    if (!r->buf) return -1;
+    r->size = size;
+    return 0;
+}
+
+void ipc_ring_free(ipc_ring_t *r)
+{
+    if (r->buf) free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
+
+int ipc_ring_write(ipc_ring_t *r, uint32_t type, const void *data, uint32_t len)
+{
+    if (!r->buf) return -1;
+    if (len > ipc_ring_max_msg(r)) return -2;
+
+    uint32_t mask = r->size - 1u;
+    uint32_t need = IPC_RING_HDR + ALIGN8(len);
+    uint32_t head = r->head;
+    uint32_t off  = head & mask;
+    uint32_t pad  = (r->size - off < need) ? r->size - off : 0u;
+
+    if (head + pad + need - r->tail_cache > r->size) {
+        r->tail_cache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        if (head + pad + need - r->tail_cache > r->size) return -1;
+    }
+
+    if (pad) {
+        uint32_t *ph = (uint32_t *)(r->buf + off);
+        ph[0] = pad - IPC_RING_HDR;
+        ph[1] = IPC_MSG_PAD;
+        head += pad;
+        off   = 0u;
+    }
+    uint32_t *h = (uint32_t *)(r->buf + off);
+    h[0] = len;
+    h[1] = type;
+    if (len) memcpy(r->buf + off + IPC_RING_HDR, data, len);
+
+    __atomic_store_n(&r->head, head + need, __ATOMIC_RELEASE);
+    r->sent++;
+    __atomic_store_n(&r->doorbell, 1u, __ATOMIC_RELEASE);
+    return 0;
+}
+
+uint32_t ipc_ring_read_begin(ipc_ring_t *r)
+{
+    return r->tail;
+}
+
+int ipc_ring_next(ipc_ring_t *r, uint32_t *cursor, uint32_t *type,
+                  const uint8_t **data, uint32_t *len)
+{
+    if (!r->buf) return 0;
+    uint32_t mask = r->size - 1u;
+    uint32_t cur  = *cursor;
+
+    for (;;) {
+        if (cur == r->head_cache) {
+            r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+            if (cur == r->head_cache) { *cursor = cur; return 0; }
+        }
+        const uint32_t *h = (const uint32_t *)(r->buf + (cur & mask));
+        if (h[1] == IPC_MSG_PAD) {          /* skip to the start of the buffer */
+            cur += IPC_RING_HDR + h[0];
+            continue;
+        }
+        *len   = h[0];
+        *type  = h[1];
+        *data  = (const uint8_t *)h + IPC_RING_HDR;
+        *cursor = cur + IPC_RING_HDR + ALIGN8(h[0]);
+        return 1;
+    }
+}
+
+void ipc_ring_read_end(ipc_ring_t *r, uint32_t cursor, uint32_t nmsgs)
+{
+    if (cursor == r->tail) return;
+    __atomic_store_n(&r->tail, cursor, __ATOMIC_RELEASE);
+    r->received += nmsgs;
+}
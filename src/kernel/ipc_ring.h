@@ -0,0 +1,94 @@
+/*
+ * ipc_ring.h — Variable-length lock-free message rings
+ *
+ * Used for parent ↔ child runtime IPC (kernel.procSend / postMessage).
+ * One ring carries messages in one direction: exactly one producer and one
+ * consumer, which may run on different CPUs (see smp.h).
+ *
+ * Layout: a power-of-two byte buffer of records
+ *
+ *   [ u32 len ][ u32 type ][ payload … padded to 8 bytes ]
+ *
+ * `head` and `tail` are free-running byte counters; `head - tail` is the
+ * number of bytes in flight.  A record never straddles the end of the
+ * buffer: when it would, the producer writes an IPC_MSG_PAD record to fill
+ * the remainder and starts again at offset 0.  Because of that the largest
+ * payload is half the ring (ipc_ring_max_msg) — it is then guaranteed to
+ * fit once the consumer has caught up, whatever the current offset.
+ *
+ * Producer and consumer indices live on separate cache lines; each side
+ * keeps a cached copy of the other's index and only re-reads it (acquire)
+ * when the cached value says the ring is full / empty.
+ *
+ * ARCHITECTURE CONSTRAINT: C provides the byte transport; message framing
+ * beyond string/binary (JSON, structured clone) is done in TypeScript.
+ */
+#ifndef IPC_RING_H
+#define IPC_RING_H
+
+#include <stdint.h>
+
+#define IPC_RING_DEFAULT_BYTES  (128u * 1024u)
+#define IPC_RING_MIN_BYTES      (4u * 1024u)
+#define IPC_RING_MAX_BYTES      (16u * 1024u * 1024u)
+
+#define IPC_MSG_STRING   0u          /* UTF-8 text                         */
+#define IPC_MSG_BINARY   1u          /* raw bytes (ArrayBuffer)            */
+#define IPC_MSG_PAD      0xFFFFFFFFu /* filler up to the end of the buffer */
+
+#define IPC_RING_HDR     8u
+
+typedef struct {
+    /* producer-owned line */
+    volatile uint32_t head __attribute__((aligned(64)));
+    uint32_t          tail_cache;
+    volatile uint32_t sent;          /* messages published                 */
+    volatile uint32_t doorbell;      /* set on publish, cleared by reader  */
+    /* consumer-owned line */
+    volatile uint32_t tail __attribute__((aligned(64)));
+    uint32_t          head_cache;
+    volatile uint32_t received;      /* messages consumed                  */
+    /* read-only after init */
+    uint8_t          *buf  __attribute__((aligned(64)));
+    uint32_t          size;          /* bytes, power of two                */
+} ipc_ring_t;
+
+/* Allocate a ring of `bytes` (rounded up to a power of two and clamped to
+ * [IPC_RING_MIN_BYTES, IPC_RING_MAX_BYTES]).  Returns 0 or -1 on OOM. */
+int      ipc_ring_init(ipc_ring_t *r, uint32_t bytes);
+void     ipc_ring_free(ipc_ring_t *r);
+
+/* Largest payload ipc_ring_write() will ever accept for this ring. */
+static inline uint32_t ipc_ring_max_msg(const ipc_ring_t *r)
+{
+    return r->size ? r->size / 2u - IPC_RING_HDR : 0u;
+}
+
+/* Messages published but not yet consumed (approximate across CPUs). */
+static inline uint32_t ipc_ring_count(const ipc_ring_t *r)
+{
+    return r->sent - r->received;
+}
+
+/* Bytes in flight (records + padding). */
+static inline uint32_t ipc_ring_used(const ipc_ring_t *r)
+{
+    return r->head - r->tail;
+}
+
+/* ── Producer ───────────────────────────────────────────────────────────── */
+/* Copy one message in and publish it.
+ * Returns 0 on success, -1 if the ring is currently full (retry later),
+ * -2 if len > ipc_ring_max_msg() (it would never fit). */
+int ipc_ring_write(ipc_ring_t *r, uint32_t type, const void *data, uint32_t len);
+
+/* ── Consumer ───────────────────────────────────────────────────────────── */
+/* Batched read: begin → next… → end.  Payload pointers returned by next()
+ * stay valid until end(), which publishes the new tail once for the whole
+ * batch. */
+uint32_t ipc_ring_read_begin(ipc_ring_t *r);
+int      ipc_ring_next(ipc_ring_t *r, uint32_t *cursor, uint32_t *type,
+                       const uint8_t **data, uint32_t *len);   /* 1 = got one */
+void     ipc_ring_read_end(ipc_ring_t *r, uint32_t cursor, uint32_t nmsgs);
+
+#endif /* IPC_RING_H */
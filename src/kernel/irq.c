@@ -3,6 +3,8 @@
 #include "keyboard.h"
 #include "mouse.h"
 #include "platform.h"
+#include "smp.h"
+#include "pagetable.h"
 #include <stddef.h>
 #include <setjmp.h>
 
@@ -72,6 +74,14 @@ void exception_dispatch(exception_frame_t *f) {
         "#SX Security Exception",   "Reserved-31"
     };
 
+    /* Copy-on-write write fault (fork / zygote clones): copy the
+     * page and retry the instruction. */
+    if (f->vector == 14) {
+        uint32_t cr2;
+        __asm__ volatile("mov %%cr2, %0" : "=r"(cr2));
+        if (pt_handle_fault(cr2, f->error_code)) return;
+    }
+
     const char *name = (f->vector < 32) ? _names[f->vector] : "Unknown";
 
     platform_serial_puts("\n\n*** KERNEL EXCEPTION ***  ");
@@ -127,6 +137,11 @@ void exception_dispatch(exception_frame_t *f) {
         if (kprobes_db_handler(f->eip, &f->eflags)) return;
     }
 
+    /* Faults on an application processor never touch the BSP's recovery
+     * buffers below — smp.c owns per-CPU recovery (item 31). */
+    if (smp_cpu_index() != 0)
+        smp_ap_exception(f->vector);
+
     /* JS execution fault recovery — vectors 0(#DE), 6(#UD), 13(#GP), 14(#PF).
      * If kernel.evalGuarded() set the recovery flag before executing untrusted
      * JS, longjmp() back instead of halting.  The C stack between the setjmp
@@ -252,6 +267,14 @@ static void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags
     idt[num].flags   = flags;
 }
 
+void irq_set_gate(uint8_t vector, void (*stub)(void)) {
+    idt_set_gate(vector, (uint32_t)stub, 0x08, 0x8E);
+}
+
+void irq_load_idt(void) {
+    __asm__ volatile ("lidt (%0)" : : "r"(&idtp));
+}
+
 /* Remap the PIC to use IRQ 32-47 instead of 0-15 */
 static void pic_remap(void) {
     uint8_t mask1, mask2;
@@ -429,6 +452,10 @@ void irq_uninstall_handler(int irq) {
     }
 }
 
+irq_handler_t irq_get_handler(int irq) {
+    return (irq >= 0 && irq < IRQ_COUNT) ? irq_handlers[irq] : NULL;
+}
+
 void irq_send_eoi(int irq) {
     if (irq >= 8) {
         outb(PIC2_COMMAND, PIC_EOI);
@@ -33,6 +33,15 @@ void irq_install_handler(int irq, irq_handler_t handler);
 /* Remove a handler for a specific IRQ */
 void irq_uninstall_handler(int irq);
 
+/* Handler currently installed for an IRQ, or NULL (used to chain handlers) */
+irq_handler_t irq_get_handler(int irq);
+
+/* Install a ring-0 interrupt gate for `vector` (used for LAPIC vectors). */
+void irq_set_gate(uint8_t vector, void (*stub)(void));
+
+/* Load the shared IDT on the calling CPU (application processors). */
+void irq_load_idt(void);
+
 /* Send End-Of-Interrupt signal to PIC */
 void irq_send_eoi(int irq);
 
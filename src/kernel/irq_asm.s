@@ -112,6 +112,26 @@ IRQ_STUB 13
 IRQ_STUB 14
 IRQ_STUB 15
 
+; ── SMP per-CPU vectors (items 31, 49) ────────────────────────────────────
+; LAPIC-sourced interrupts on application processors.  The C handlers send
+; the LAPIC EOI themselves (the 8259 never sees these vectors).
+extern smp_timer_dispatch
+extern smp_wake_dispatch
+global smp_timer_stub
+global smp_wake_stub
+
+smp_timer_stub:
+    pusha
+    call smp_timer_dispatch
+    popa
+    iret
+
+smp_wake_stub:
+    pusha
+    call smp_wake_dispatch
+    popa
+    iret
+
 ; GDT for protected mode (required for IDT to work)
 global gdt_flush
 global gdt_start
@@ -9,9 +9,12 @@
 #include "cpuid.h"
 #include "cmdline.h"
 #include "acpi.h"
+#include "smp.h"     /* item 31 */
 #include "quickjs_binding.h"
 #include "secboot.h"   /* item 13 */
 #include "pxe.h"       /* item 17 */
+#include "kthread.h"
+#include "initrd.h"
 
 #if !defined(__i386__)
 #error "This kernel needs to be compiled with a ix86-elf compiler"
@@ -53,6 +56,9 @@ int main(void) {
     /* ── PXE / netboot detection (item 17) ──────────────────────────────── */
     pxe_init(_multiboot2_ptr);
 
+    /* ── initramfs module — after the page bitmap exists ────────────────── */
+    initrd_init(_multiboot2_ptr);
+
     platform_boot_print("[BOOT] Loading GDT...\n");
     gdt_flush();
 
@@ -86,6 +92,10 @@ int main(void) {
         platform_boot_print(buf);
     }
 
+    /* ── Kernel threads: adopt the boot stack as thread 0 ───────────────── */
+    kthread_init();
+    platform_boot_print("[BOOT] Kernel threads ready\n");
+
     platform_boot_print("[BOOT] Initializing keyboard...\n");
     keyboard_initialize();
 
@@ -96,6 +106,12 @@ int main(void) {
     platform_boot_print("[BOOT] Initializing ACPI...\n");
     acpi_init(_multiboot2_ptr);
 
+    /* ── SMP: start application processors (item 31) ──────────────────── */
+    if (!cmdline_has("nosmp")) {
+        uint32_t ncpu = smp_init();
+        if (ncpu > 1) platform_boot_print("[BOOT] SMP: application processors online\n");
+    }
+
     /* Parse multiboot2 info for framebuffer address before QuickJS starts */
     platform_fb_init(_multiboot2_ptr);
 
@@ -0,0 +1,465 @@
+/*
+ * kthread.c — Kernel threads, wait queues and IRQ wake-ups (see kthread.h)
+ */
+
+#include "kthread.h"
+#include "memory.h"
+#include "timer.h"
+#include "irq.h"
+#include "smp.h"
+#include "platform.h"
+#include <malloc.h>
+#include <string.h>
+
+#define EFLAGS_IF        0x200u
+#define KT_GUARD_WORD    0x4B475244u   /* "DRGK" */
+#define KT_GUARD_CHECK   16u           /* words next to the stack checked per switch */
+#define KT_IRQ_BINDINGS  8
+
+struct kthread {
+    uint8_t      fpu[512];             /* FXSAVE area (first: 16-byte aligned) */
+    uint32_t     esp;                  /* saved stack pointer while switched out */
+    uint32_t     stack;                /* lowest usable byte, 0 = boot stack   */
+    uint8_t      state;
+    uint8_t      overflowed;
+    char         name[KTHREAD_NAME_LEN];
+    kthread_fn_t fn;
+    void        *arg;
+    kwaitq_t    *wq;                   /* queue blocked on, or NULL            */
+    kthread_t   *wq_next;
+    kthread_t   *rq_next;
+    uint32_t     deadline;             /* wake tick while blocked, 0 = none    */
+    uint32_t     switches;
+    uint32_t     wakeups;
+    uint64_t     tsc_run;
+    uint64_t     tsc_in;
+} __attribute__((aligned(16)));
+
+/* Implemented in kthread_asm.s */
+extern void kthread_switch(uint32_t *save_esp, uint32_t next_esp);
+
+static kthread_t  _kt[KTHREAD_MAX];
+static kthread_t *_kt_cur;
+static kthread_t *_rq_head, *_rq_tail;
+static int        _kt_ready;
+static uint32_t   _kt_switches;
+
+/* ── Run queue (FIFO; callers hold interrupts off) ───────────────────────── */
+
+static void _rq_push(kthread_t *t)
+{
+    t->rq_next = NULL;
+    if (_rq_tail) _rq_tail->rq_next = t; else _rq_head = t;
+    _rq_tail = t;
+}
+
+static kthread_t *_rq_pop(void)
+{
+    kthread_t *t = _rq_head;
+    if (t) {
+        _rq_head = t->rq_next;
+        if (!_rq_head) _rq_tail = NULL;
+        t->rq_next = NULL;
+    }
+    return t;
+}
+
+/* Unlink a thread that is being reaped (see _kt_reap). */
+static void _rq_remove(kthread_t *t)
+{
+    kthread_t *prev = NULL;
+    for (kthread_t *r = _rq_head; r; prev = r, r = r->rq_next) {
+        if (r != t) continue;
+        if (prev) prev->rq_next = r->rq_next; else _rq_head = r->rq_next;
+        if (_rq_tail == r) _rq_tail = prev;
+        r->rq_next = NULL;
+        break;
+    }
+}
+
+/* ── Wait-queue membership ───────────────────────────────────────────────── */
+
+static void _wq_remove(kthread_t *t)
+{
+    kwaitq_t *q = t->wq;
+    if (!q) return;
+    kthread_t *prev = NULL;
+    for (kthread_t *w = q->head; w; prev = w, w = w->wq_next) {
+        if (w != t) continue;
+        if (prev) prev->wq_next = w->wq_next; else q->head = w->wq_next;
+        if (q->tail == w) q->tail = prev;
+        break;
+    }
+    t->wq = NULL;
+    t->wq_next = NULL;
+}
+
+/* Blocked → ready.  Interrupts off. */
+static void _wake(kthread_t *t)
+{
+    if (t->state != KT_BLOCKED) return;
+    _wq_remove(t);
+    t->deadline = 0;
+    t->state = KT_READY;
+    t->wakeups++;
+    _rq_push(t);
+}
+
+/* ── Switching ───────────────────────────────────────────────────────────── */
+
+static int _guard_intact(const kthread_t *t)
+{
+    if (!t->stack) return 1;
+    const uint32_t *g = (const uint32_t *)(uintptr_t)(t->stack - KT_GUARD_CHECK * 4u);
+    for (uint32_t i = 0; i < KT_GUARD_CHECK; i++)
+        if (g[i] != KT_GUARD_WORD) return 0;
+    return 1;
+}
+
+static void _switch_to(kthread_t *next)
+{
+    kthread_t *prev = _kt_cur;
+    if (!_guard_intact(prev) && !prev->overflowed) {
+        /* The frame we are about to save may itself be damaged; keep the
+         * thread off the run queue for good. */
+        prev->overflowed = 1;
+        prev->state = KT_DEAD;
+        platform_serial_puts("[KTHREAD] stack overflow in ");
+        platform_serial_puts(prev->name);
+        platform_serial_puts(" - thread stopped\n");
+    }
+    fpu_save(prev->fpu);
+    uint64_t now = timer_read_tsc();
+    prev->tsc_run += now - prev->tsc_in;
+    next->tsc_in = now;
+    next->state = KT_RUNNING;
+    next->switches++;
+    _kt_switches++;
+    _kt_cur = next;
+    kthread_switch(&prev->esp, next->esp);
+    /* Resumed: _kt_cur is this thread again. */
+    fpu_restore(_kt_cur->fpu);
+}
+
+/*
+ * Give the CPU to the next ready thread.  The caller has interrupts off and
+ * has already taken itself out of the RUNNING state (queued it, or blocked
+ * it).  With nothing ready the CPU halts here, on the caller's stack, until
+ * an interrupt makes some thread ready — possibly the caller itself.
+ */
+static void _schedule(void)
+{
+    for (;;) {
+        kthread_t *next = _rq_pop();
+        if (next && next->state == KT_DEAD) continue;   /* stopped while queued */
+        if (next) {
+            if (next == _kt_cur) next->state = KT_RUNNING;
+            else _switch_to(next);
+            return;
+        }
+        __asm__ volatile("sti; hlt; cli" ::: "memory");
+    }
+}
+
+/* Block the running thread on `q` (may be NULL) until woken or `deadline`. */
+static void _sleep_on(kwaitq_t *q, uint32_t deadline)
+{
+    kthread_t *t = _kt_cur;
+    t->state = KT_BLOCKED;
+    t->deadline = deadline ? deadline : 1u;     /* 0 means "no deadline" */
+    if (q) {
+        t->wq = q;
+        t->wq_next = NULL;
+        if (q->tail) q->tail->wq_next = t; else q->head = t;
+        q->tail = t;
+    }
+    _schedule();
+    _wq_remove(t);
+    t->deadline = 0;
+}
+
+static int _schedulable(uint32_t flags)
+{
+    return _kt_ready && (flags & EFLAGS_IF) && smp_cpu_index() == 0;
+}
+
+/* ── Thread lifecycle ────────────────────────────────────────────────────── */
+
+static void _name(kthread_t *t, const char *name)
+{
+    uint32_t i = 0;
+    for (; name && name[i] && i < KTHREAD_NAME_LEN - 1u; i++) t->name[i] = name[i];
+    t->name[i] = 0;
+}
+
+/*
+ * Return dead threads' slots and stacks.  A thread cannot free the stack it
+ * is still running on, so this runs later, from kthread_create, for every
+ * dead thread other than the current one.  Slots reserved by a create in
+ * progress are KT_DEAD with no stack yet and are left alone.
+ */
+static void _kt_reap(void)
+{
+    uint32_t fl = kthread_irq_save();
+    for (int i = 1; i < KTHREAD_MAX; i++) {
+        kthread_t *t = &_kt[i];
+        if (t->state != KT_DEAD || !t->stack || t == _kt_cur) continue;
+        _rq_remove(t);                   /* an overflowed thread may still be */
+        _wq_remove(t);                   /* queued where it was stopped       */
+        free((void *)(uintptr_t)(t->stack - PAGE_SIZE));
+        t->stack = 0;
+        t->state = KT_UNUSED;
+    }
+    kthread_irq_restore(fl);
+}
+
+static void _kt_exit(void)
+{
+    kthread_irq_save();
+    _kt_cur->state = KT_DEAD;
+    _schedule();                         /* never returns here */
+    for (;;) __asm__ volatile("hlt");
+}
+
+/* First code a new thread runs (kthread_switch "returns" here). */
+static void _kt_entry(void)
+{
+    __asm__ volatile("fninit");
+    __asm__ volatile("sti" ::: "memory");
+    _kt_cur->fn(_kt_cur->arg);
+    _kt_exit();
+}
+
+void kthread_init(void)
+{
+    if (_kt_ready) return;
+    memset(_kt, 0, sizeof(_kt));
+    kthread_t *m = &_kt[0];
+    _name(m, "main");
+    m->state = KT_RUNNING;
+    fpu_save(m->fpu);
+    m->tsc_in = timer_read_tsc();
+    _kt_cur = m;
+    _kt_ready = 1;
+}
+
+int kthread_create(const char *name, kthread_fn_t fn, void *arg)
+{
+    if (!_kt_ready || !fn || smp_cpu_index() != 0) return -1;
+    _kt_reap();
+    uint32_t fl = kthread_irq_save();
+    int id = -1;
+    for (int i = 1; i < KTHREAD_MAX; i++)
+        if (_kt[i].state == KT_UNUSED) { id = i; break; }
+    if (id < 0) { kthread_irq_restore(fl); return -1; }
+    kthread_t *t = &_kt[id];
+    t->state = KT_DEAD;                  /* reserve the slot */
+    t->stack = 0;
+    kthread_irq_restore(fl);
+
+    /* Guard page plus stack from the heap, as smp.c does for AP stacks:
+     * raw frames from alloc_pages can alias the kernel image and heap. */
+    uint8_t *mem = memalign(PAGE_SIZE, (KTHREAD_STACK_PAGES + 1u) * PAGE_SIZE);
+    if (!mem) { t->state = KT_UNUSED; return -1; }
+    uint32_t base = (uint32_t)(uintptr_t)mem + PAGE_SIZE;
+
+    uint32_t *guard = (uint32_t *)(uintptr_t)mem;
+    for (uint32_t i = 0; i < PAGE_SIZE / 4u; i++) guard[i] = KT_GUARD_WORD;
+
+    /* Initial frame, matching kthread_switch's pops (see kthread_asm.s). */
+    uint32_t *sp = (uint32_t *)(uintptr_t)(base + KTHREAD_STACK_PAGES * PAGE_SIZE);
+    *--sp = 0;                                   /* _kt_entry's return slot */
+    *--sp = (uint32_t)(uintptr_t)_kt_entry;      /* ret                     */
+    *--sp = 0;                                   /* ebp                     */
+    *--sp = 0;                                   /* ebx                     */
+    *--sp = 0;                                   /* esi                     */
+    *--sp = 0;                                   /* edi                     */
+    *--sp = 0x002u;                              /* eflags: IF clear        */
+
+    memset(t->fpu, 0, sizeof(t->fpu));
+    _name(t, name);
+    t->esp        = (uint32_t)(uintptr_t)sp;
+    t->stack      = base;
+    t->fn         = fn;
+    t->arg        = arg;
+    t->overflowed = 0;
+    t->switches = t->wakeups = 0;
+    t->tsc_run = 0;
+
+    fl = kthread_irq_save();
+    t->state = KT_READY;
+    _rq_push(t);
+    kthread_irq_restore(fl);
+    return id;
+}
+
+void kthread_yield(void)
+{
+    if (!_kt_ready || !_rq_head || smp_cpu_index() != 0) return;
+    uint32_t fl = kthread_irq_save();
+    if (_rq_head) {
+        _kt_cur->state = KT_READY;
+        _rq_push(_kt_cur);
+        _schedule();
+    }
+    kthread_irq_restore(fl);
+}
+
+void kthread_idle(void)
+{
+    kthread_yield();
+    __asm__ volatile("hlt");
+    kthread_yield();
+}
+
+void kthread_sleep(uint32_t ms)
+{
+    uint32_t fl = kthread_irq_save();
+    if (!_schedulable(fl)) {
+        kthread_irq_restore(fl);
+        timer_sleep(ms);
+        return;
+    }
+    uint32_t deadline = timer_get_ticks() + MS_TO_TICKS(ms);
+    while ((int32_t)(timer_get_ticks() - deadline) < 0)
+        _sleep_on(NULL, deadline);
+    kthread_irq_restore(fl);
+}
+
+int kthread_current(void)
+{
+    return _kt_ready ? (int)(_kt_cur - _kt) : 0;
+}
+
+uint32_t kthread_switch_count(void) { return _kt_switches; }
+
+int kthread_info(int id, kthread_info_t *out)
+{
+    if (id < 0 || id >= KTHREAD_MAX || _kt[id].state == KT_UNUSED) return -1;
+    const kthread_t *t = &_kt[id];
+    uint64_t run = t->tsc_run;
+    if (t == _kt_cur) run += timer_read_tsc() - t->tsc_in;
+    uint32_t mhz = timer_tsc_hz() / 1000000u;
+    memcpy(out->name, t->name, KTHREAD_NAME_LEN);
+    out->state       = t->state;
+    out->stack_base  = t->stack;
+    out->stack_bytes = t->stack ? KTHREAD_STACK_PAGES * PAGE_SIZE : 0;
+    out->switches    = t->switches;
+    out->wakeups     = t->wakeups;
+    out->run_us      = mhz ? (uint32_t)(run / mhz) : 0;
+    out->overflowed  = t->overflowed || !_guard_intact(t);
+    return 0;
+}
+
+/* ── Wait queues ─────────────────────────────────────────────────────────── */
+
+void kwaitq_wake_all(kwaitq_t *q)
+{
+    uint32_t fl = kthread_irq_save();
+    while (q->head) _wake(q->head);
+    kthread_irq_restore(fl);
+}
+
+/* Poll fallback: no scheduler to sleep in, so spin for at most `ms`. */
+static int _spin_until(int (*cond)(void *), void *arg, uint32_t ms)
+{
+    uint32_t mhz = timer_tsc_hz() / 1000000u;
+    if (mhz) {
+        uint64_t end = timer_read_tsc() + (uint64_t)ms * 1000u * mhz;
+        while (!cond(arg)) {
+            if (timer_read_tsc() >= end) return 0;
+            __asm__ volatile("pause");
+        }
+        return 1;
+    }
+    for (uint32_t n = ms * 1000u; n; n--) {
+        if (cond(arg)) return 1;
+        __asm__ volatile("pause");
+    }
+    return cond(arg);
+}
+
+int kwait_until(kwaitq_t *q, int (*cond)(void *), void *arg, uint32_t ms)
+{
+    if (cond(arg)) return 1;
+    uint32_t fl = kthread_irq_save();
+    if (!_schedulable(fl)) {
+        kthread_irq_restore(fl);
+        return _spin_until(cond, arg, ms);
+    }
+    uint32_t deadline = timer_get_ticks() + MS_TO_TICKS(ms);
+    int ok;
+    for (;;) {
+        if ((ok = cond(arg)) != 0) break;
+        if ((int32_t)(timer_get_ticks() - deadline) >= 0) break;
+        _sleep_on(q, deadline);
+    }
+    kthread_irq_restore(fl);
+    return ok;
+}
+
+void kthread_timer_tick(uint32_t now)
+{
+    if (!_kt_ready) return;
+    for (int i = 0; i < KTHREAD_MAX; i++) {
+        kthread_t *t = &_kt[i];
+        if (t->state == KT_BLOCKED && t->deadline &&
+            (int32_t)(now - t->deadline) >= 0)
+            _wake(t);
+    }
+}
+
+/* ── IRQ routing ─────────────────────────────────────────────────────────── */
+
+typedef struct {
+    uint8_t   irq;
+    kwaitq_t *q;
+    void    (*ack)(void);
+} kt_irq_binding_t;
+
+static kt_irq_binding_t _kt_irq_bind[KT_IRQ_BINDINGS];
+static int              _kt_irq_nbind;
+static irq_handler_t    _kt_irq_prev[IRQ_COUNT];
+static uint8_t          _kt_irq_hooked[IRQ_COUNT];
+
+static void _kt_irq(int irq)
+{
+    if (_kt_irq_prev[irq]) _kt_irq_prev[irq]();
+    for (int i = 0; i < _kt_irq_nbind; i++) {
+        kt_irq_binding_t *b = &_kt_irq_bind[i];
+        if (b->irq != irq) continue;
+        if (b->ack) b->ack();
+        kwaitq_wake_all(b->q);
+    }
+}
+
+#define KT_IRQ_STUB(n) static void _kt_irq##n(void) { _kt_irq(n); }
+KT_IRQ_STUB(0)  KT_IRQ_STUB(1)  KT_IRQ_STUB(2)  KT_IRQ_STUB(3)
+KT_IRQ_STUB(4)  KT_IRQ_STUB(5)  KT_IRQ_STUB(6)  KT_IRQ_STUB(7)
+KT_IRQ_STUB(8)  KT_IRQ_STUB(9)  KT_IRQ_STUB(10) KT_IRQ_STUB(11)
+KT_IRQ_STUB(12) KT_IRQ_STUB(13) KT_IRQ_STUB(14) KT_IRQ_STUB(15)
+
+static const irq_handler_t _kt_irq_stubs[IRQ_COUNT] = {
+    _kt_irq0,  _kt_irq1,  _kt_irq2,  _kt_irq3,
+    _kt_irq4,  _kt_irq5,  _kt_irq6,  _kt_irq7,
+    _kt_irq8,  _kt_irq9,  _kt_irq10, _kt_irq11,
+    _kt_irq12, _kt_irq13, _kt_irq14, _kt_irq15,
+};
+
+int kthread_irq_bind(uint8_t irq, kwaitq_t *q, void (*ack)(void))
+{
+    if (irq == 0 || irq == 2 || irq >= IRQ_COUNT || !q) return -1;
+    uint32_t fl = kthread_irq_save();
+    if (_kt_irq_nbind >= KT_IRQ_BINDINGS) { kthread_irq_restore(fl); return -1; }
+    kt_irq_binding_t *b = &_kt_irq_bind[_kt_irq_nbind++];
+    b->irq = irq;
+    b->q   = q;
+    b->ack = ack;
+    if (!_kt_irq_hooked[irq]) {
+        _kt_irq_prev[irq]   = irq_get_handler(irq);
+        _kt_irq_hooked[irq] = 1;
+        irq_install_handler(irq, _kt_irq_stubs[irq]);
+    }
+    kthread_irq_restore(fl);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * kthread.h — Kernel threads with their own stacks
+ *
+ * A kernel thread is a C function running on its own stack, taken from the
+ * kernel heap with a guard page below it.  Thread 0 is the boot stack, which runs QuickJS and
+ * therefore all TypeScript; every other thread is driver code that never
+ * touches a JSContext (QuickJS is not re-entrant).
+ *
+ * Switching (kthread_switch in kthread_asm.s) saves the callee-saved
+ * registers and EFLAGS on the outgoing stack and swaps ESP; the FXSAVE area
+ * of each thread is saved / restored around it (fpu_save / fpu_restore).
+ *
+ * Scheduling is cooperative and BSP-only: a thread runs until it blocks,
+ * sleeps or yields.  IRQ handlers never switch stacks — they only move
+ * sleepers to the run queue (kwaitq_wake_all, kthread_timer_tick).  Thread 0
+ * reaches the scheduler at its idle points (kernel.yield, kernel.sleep,
+ * key waits) and whenever a driver call it made blocks in kwait_until(), so
+ * a disk DMA wait lets the network thread run — or halts the CPU — instead
+ * of spinning.
+ *
+ * Overflow check: the kernel's identity map uses 4 MB pages, so a 4 KB
+ * guard page cannot be unmapped.  The guard page below each stack is filled
+ * with a pattern instead and checked at every switch; a thread that has
+ * run into it is reported and never scheduled again.
+ */
+#ifndef KTHREAD_H
+#define KTHREAD_H
+
+#include <stdint.h>
+
+#define KTHREAD_MAX          16
+#define KTHREAD_STACK_PAGES  4        /* 16 KB, plus one guard page below */
+#define KTHREAD_NAME_LEN     16
+
+/* Thread states */
+#define KT_UNUSED   0
+#define KT_READY    1
+#define KT_RUNNING  2
+#define KT_BLOCKED  3
+#define KT_DEAD     4
+
+typedef struct kthread kthread_t;
+typedef void (*kthread_fn_t)(void *arg);
+
+/* A wait queue: threads blocked until an event (usually an IRQ) occurs. */
+typedef struct {
+    kthread_t *head;
+    kthread_t *tail;
+} kwaitq_t;
+
+#define KWAITQ_INIT  { 0, 0 }
+
+typedef struct {
+    char     name[KTHREAD_NAME_LEN];
+    uint8_t  state;
+    uint32_t stack_base;     /* lowest usable byte (0 for the boot stack)  */
+    uint32_t stack_bytes;
+    uint32_t switches;       /* times switched in                          */
+    uint32_t wakeups;        /* times woken from a wait queue or sleep     */
+    uint32_t run_us;         /* time on CPU (TSC-based)                    */
+    int      overflowed;     /* guard pattern was found damaged            */
+} kthread_info_t;
+
+/* ── FXSAVE helpers (512-byte, 16-byte-aligned area) ─────────────────── */
+
+static inline void fpu_save(void *area)
+{
+    __asm__ volatile("fxsave (%0)" :: "r"(area) : "memory");
+}
+
+static inline void fpu_restore(void *area)
+{
+    __asm__ volatile("fxrstor (%0)" :: "r"(area) : "memory");
+}
+
+/* ── Interrupt flag helpers ─────────────────────────────────────────── */
+
+static inline uint32_t kthread_irq_save(void)
+{
+    uint32_t f;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(f) :: "memory");
+    return f;
+}
+
+static inline void kthread_irq_restore(uint32_t f)
+{
+    if (f & 0x200u) __asm__ volatile("sti" ::: "memory");
+}
+
+/* ── Threads ────────────────────────────────────────────────────────── */
+
+/* Adopt the boot stack as thread 0.  Call once, before any other kthread_*. */
+void kthread_init(void);
+
+/* Start fn(arg) on a new stack.  Returns the thread id, or -1. */
+int  kthread_create(const char *name, kthread_fn_t fn, void *arg);
+
+/* Let every other runnable thread run once; returns to the caller. */
+void kthread_yield(void);
+
+/* Thread 0 idle point: run ready threads, halt until the next interrupt,
+ * run whatever that woke.  Replaces a bare `hlt` in wait loops. */
+void kthread_idle(void);
+
+/* Block the calling thread for `ms` milliseconds (other threads run). */
+void kthread_sleep(uint32_t ms);
+
+/* Id of the running thread (0 = boot / QuickJS). */
+int  kthread_current(void);
+
+/* Fill `out` for thread `id`.  Returns 0, or -1 for an unused slot. */
+int  kthread_info(int id, kthread_info_t *out);
+
+/* Total context switches since boot. */
+uint32_t kthread_switch_count(void);
+
+/* ── Wait queues ────────────────────────────────────────────────────── */
+
+/* Wake every thread blocked on `q`.  Safe from IRQ handlers. */
+void kwaitq_wake_all(kwaitq_t *q);
+
+/* Block until cond(arg) is true or `ms` elapse; 1 = condition met, 0 = timed
+ * out.  The condition is re-tested with interrupts off before each sleep, so
+ * a wake-up between test and sleep is never lost.  Outside a schedulable
+ * context (an AP, interrupts disabled, before kthread_init) it polls. */
+int  kwait_until(kwaitq_t *q, int (*cond)(void *), void *arg, uint32_t ms);
+
+/* Route IRQ line `irq` to `q`: on every interrupt, ack() (may be NULL) runs
+ * and then `q` is woken.  A handler already installed on the line keeps
+ * running first, so shared PCI lines keep working.  Returns 0, or -1 for
+ * an unusable line (0, 2, > 15) or a full binding table. */
+int  kthread_irq_bind(uint8_t irq, kwaitq_t *q, void (*ack)(void));
+
+/* IRQ0 hook: wake sleepers whose deadline has passed. */
+void kthread_timer_tick(uint32_t now);
+
+#endif /* KTHREAD_H */
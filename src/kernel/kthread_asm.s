@@ -0,0 +1,38 @@
+; kthread_asm.s - Kernel-thread stack switch
+;
+;     void kthread_switch(uint32_t *save_esp, uint32_t next_esp);
+;
+; Pushes the callee-saved registers and EFLAGS on the current stack, stores
+; ESP in *save_esp, loads next_esp and pops the same frame off the other
+; thread's stack.  The caller-saved registers (EAX, ECX, EDX) are dead
+; across a call under cdecl, so they are not preserved.  FPU/SSE state is
+; handled in C (fpu_save / fpu_restore in kthread.c).
+;
+; Frame at a saved ESP (lowest address first):
+;     eflags, edi, esi, ebx, ebp, return address
+;
+; kthread_create() builds the same frame on a fresh stack with the return
+; address pointing at the thread entry, so the first switch "returns" into
+; the new thread.
+
+global kthread_switch
+
+section .text
+bits 32
+
+kthread_switch:
+    mov  eax, [esp + 4]         ; save_esp
+    mov  edx, [esp + 8]         ; next_esp
+    push ebp
+    push ebx
+    push esi
+    push edi
+    pushfd
+    mov  [eax], esp
+    mov  esp, edx
+    popfd
+    pop  edi
+    pop  esi
+    pop  ebx
+    pop  ebp
+    ret
@@ -0,0 +1,162 @@
+/*
+ * lz4.c — LZ4 block compressor / decompressor (see lz4.h)
+ *
+ * The compressor is the classic single-probe greedy matcher: a 4096-entry
+ * hash of the next 4 bytes, with the search step growing by one for every
+ * 64 misses so incompressible data is skipped quickly.  The decompressor
+ * copies in 8-byte strides when there is slack on both sides and falls back
+ * to byte copies near the end of the buffers and for overlapping matches
+ * with offset < 8.
+ */
+
+#include "lz4.h"
+#include <string.h>
+
+#define HASH_LOG       12u
+#define MIN_MATCH      4u
+#define MF_LIMIT       12u   /* last match must start this far from the end */
+#define LAST_LITERALS  5u    /* the block ends with at least 5 literals */
+#define MAX_DISTANCE   65535u
+#define SKIP_TRIGGER   6u
+
+static uint32_t _hash_table[1u << HASH_LOG];
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32u - HASH_LOG);
+}
+
+/* Write a length continuation (the part beyond the 4-bit token field). */
+static inline uint8_t *put_len(uint8_t *op, uint32_t len) {
+    while (len >= 255u) { *op++ = 255u; len -= 255u; }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+int lz4_compress_block(const uint8_t *src, uint32_t src_len,
+                       uint8_t *dst, uint32_t dst_cap) {
+    const uint8_t *ip = src, *anchor = src;
+    const uint8_t *iend = src + src_len;
+    const uint8_t *mflimit = src_len > MF_LIMIT ? iend - MF_LIMIT : src;
+    const uint8_t *matchlimit = iend - LAST_LITERALS;
+    uint8_t *op = dst, *oend = dst + dst_cap;
+
+    if (src_len > MF_LIMIT) {
+        memset(_hash_table, 0xff, sizeof(_hash_table));
+        ip++;
+        while (ip < mflimit) {
+            /* find a match */
+            const uint8_t *ref;
+            uint32_t attempts = 1u << SKIP_TRIGGER;
+            for (;;) {
+                uint32_t h = hash4(read32(ip));
+                uint32_t cand = _hash_table[h];
+                _hash_table[h] = (uint32_t)(ip - src);
+                ref = src + cand;
+                if (cand != 0xffffffffu && (uint32_t)(ip - ref) <= MAX_DISTANCE &&
+                    read32(ref) == read32(ip)) break;
+                ip += attempts++ >> SKIP_TRIGGER;
+                if (ip >= mflimit) goto last_literals;
+            }
+            /* extend backwards over pending literals */
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) { ip--; ref--; }
+
+            uint32_t lit = (uint32_t)(ip - anchor);
+            /* token + lit length + literals + offset + worst-case match length */
+            if ((uint32_t)(oend - op) < 1u + lit / 255u + 1u + lit + 2u + LAST_LITERALS + 1u + src_len / 255u)
+                return -1;
+            uint8_t *token = op++;
+            if (lit >= 15u) { *token = 15u << 4; op = put_len(op, lit - 15u); }
+            else *token = (uint8_t)(lit << 4);
+            memcpy(op, anchor, lit);
+            op += lit;
+
+            uint32_t off = (uint32_t)(ip - ref);
+            *op++ = (uint8_t)off;
+            *op++ = (uint8_t)(off >> 8);
+
+            /* extend forwards */
+            const uint8_t *mp = ip + MIN_MATCH, *rp = ref + MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) { mp++; rp++; }
+            uint32_t mlen = (uint32_t)(mp - ip) - MIN_MATCH;
+            if (mlen >= 15u) { *token |= 15u; op = put_len(op, mlen - 15u); }
+            else *token |= (uint8_t)mlen;
+
+            ip = mp;
+            anchor = ip;
+            if (ip >= mflimit) break;
+            /* seed the table with the position just before the new anchor */
+            _hash_table[hash4(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+last_literals:;
+    uint32_t lit = (uint32_t)(iend - anchor);
+    if ((uint32_t)(oend - op) < 1u + lit / 255u + 1u + lit) return -1;
+    if (lit >= 15u) { *op++ = 15u << 4; op = put_len(op, lit - 15u); }
+    else *op++ = (uint8_t)(lit << 4);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return (int)(op - dst);
+}
+
+int lz4_decompress_block(const uint8_t *src, uint32_t src_len,
+                         uint8_t *dst, uint32_t dst_cap) {
+    const uint8_t *ip = src, *iend = src + src_len;
+    uint8_t *op = dst, *oend = dst + dst_cap;
+
+    while (ip < iend) {
+        uint32_t token = *ip++;
+
+        /* literals */
+        uint32_t lit = token >> 4;
+        if (lit == 15u) {
+            uint32_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                lit += b;
+            } while (b == 255u);
+        }
+        if (lit > (uint32_t)(iend - ip) || lit > (uint32_t)(oend - op)) return -1;
+        if (lit <= 16u && (uint32_t)(iend - ip) >= 16u && (uint32_t)(oend - op) >= 16u) {
+            memcpy(op, ip, 16);                 /* short literal run: one stride */
+        } else {
+            memcpy(op, ip, lit);
+        }
+        ip += lit; op += lit;
+        if (ip == iend) break;                  /* last sequence has no match */
+
+        /* match */
+        if ((uint32_t)(iend - ip) < 2u) return -1;
+        uint32_t off = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        if (off == 0 || off > (uint32_t)(op - dst)) return -1;
+        uint32_t mlen = token & 15u;
+        if (mlen == 15u) {
+            uint32_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                mlen += b;
+            } while (b == 255u);
+        }
+        mlen += MIN_MATCH;
+        if (mlen > (uint32_t)(oend - op)) return -1;
+
+        const uint8_t *ref = op - off;
+        uint8_t *mend = op + mlen;
+        if (off >= 8u && (uint32_t)(oend - mend) >= 8u) {
+            do { memcpy(op, ref, 8); op += 8; ref += 8; } while (op < mend);
+            op = mend;
+        } else {
+            while (op < mend) *op++ = *ref++;
+        }
+    }
+    return (int)(op - dst);
+}
@@ -0,0 +1,38 @@
+/*
+ * JSOS LZ4 block codec
+ *
+ * Native fast path for the LZ4 block format used by the compressed block
+ * device (fs/fscompression.ts) and the initramfs loader.  Raw blocks only —
+ * frame headers and checksums stay in TypeScript.  JS reaches these through
+ * kernel.lz4Compress(src, dst) / kernel.lz4Decompress(src, dst), which work
+ * on caller-owned buffers; the TypeScript codec is the fallback and is
+ * format-identical.
+ *
+ * Not reentrant: the compressor's hash table is static.  JS callers are
+ * serialised (single CPU, cooperative kthreads).
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stdint.h>
+
+/** Worst-case compressed size of `n` input bytes. */
+#define LZ4_COMPRESS_BOUND(n)  ((n) + (n) / 255u + 16u)
+
+/**
+ * Compress `src_len` bytes into `dst` (capacity `dst_cap`).
+ * Returns the compressed length, or -1 if it would not fit.
+ */
+int lz4_compress_block(const uint8_t *src, uint32_t src_len,
+                       uint8_t *dst, uint32_t dst_cap);
+
+/**
+ * Decompress one block into `dst` (capacity `dst_cap`).  Every offset and
+ * length is bounds-checked.  Returns the decompressed length, or -1 on
+ * malformed input or overflow of `dst`.
+ */
+int lz4_decompress_block(const uint8_t *src, uint32_t src_len,
+                         uint8_t *dst, uint32_t dst_cap);
+
+#endif /* LZ4_H */
@@ -0,0 +1,301 @@
+/*
+ * pagetable.c — Bulk x86 page-table primitives (see pagetable.h)
+ *
+ * Every range operation walks one page table at a time: it resolves the PDE
+ * once and then runs a tight loop over that table's PTEs, so mapping or
+ * cloning 100 MB (25 600 pages, 25 tables) is a few hundred microseconds of
+ * straight-line C instead of tens of thousands of JS→C calls.
+ */
+
+#include "pagetable.h"
+#include "memory.h"
+#include <malloc.h>
+#include <string.h>
+
+#define PT_ENTRIES   1024u
+#define PT_FRAME(e)  ((e) & 0xFFFFF000u)
+#define PDE_TABLE_FLAGS  (PT_PRESENT | PT_WRITE | PT_USER)  /* PTEs decide */
+#define FLUSH_PAGES_MAX  32u   /* beyond this, reload CR3 instead of INVLPG */
+
+static uint16_t   _frame_refs[1u << 20];   /* every 4 KB frame of the 32-bit space */
+static pt_stats_t _stats;
+
+/* ── Frames ──────────────────────────────────────────────────────────────── */
+
+static uint32_t _frame_alloc(void)
+{
+    uint8_t *p = (uint8_t *)memalign(PAGE_SIZE, PAGE_SIZE);
+    if (!p) return 0;
+    memset(p, 0, PAGE_SIZE);
+    _frame_refs[PHYS_TO_PAGE((uintptr_t)p)] = 1;
+    _stats.frames++;
+    return (uint32_t)(uintptr_t)p;
+}
+
+/* Reference counts are atomic: COW clones of one zygote arena fault on
+ * shared frames from whichever CPU runs them. */
+static void _frame_get(uint32_t phys)
+{
+    __atomic_add_fetch(&_frame_refs[PHYS_TO_PAGE(phys)], 1, __ATOMIC_RELAXED);
+}
+
+static void _frame_put(uint32_t phys)
+{
+    uint16_t *r = &_frame_refs[PHYS_TO_PAGE(phys)];
+    if (__atomic_load_n(r, __ATOMIC_RELAXED) &&
+        __atomic_sub_fetch(r, 1, __ATOMIC_ACQ_REL) == 0) {
+        free((void *)(uintptr_t)phys);
+        _stats.frames--;
+    }
+}
+
+/* Drop whatever a PTE referenced. */
+static void _pte_release(uint32_t pte)
+{
+    if ((pte & PT_PRESENT) && (pte & PT_OWNED)) _frame_put(PT_FRAME(pte));
+}
+
+/* ── Tables ──────────────────────────────────────────────────────────────── */
+
+/* Page table covering `va`, or NULL (no table and !create, a 4 MB PDE in
+ * the way, or out of memory — *blocked is set for the latter two). */
+static uint32_t *_table(uint32_t *pd, uint32_t va, int create, int *blocked)
+{
+    uint32_t pde = pd[va >> 22];
+    if (pde & PT_PRESENT) {
+        if (pde & PT_HUGE) { if (blocked) *blocked = 1; return NULL; }
+        return (uint32_t *)(uintptr_t)PT_FRAME(pde);
+    }
+    if (!create) return NULL;
+    uint32_t *t = (uint32_t *)memalign(PAGE_SIZE, PAGE_SIZE);
+    if (!t) { if (blocked) *blocked = 1; return NULL; }
+    memset(t, 0, PAGE_SIZE);
+    pd[va >> 22] = (uint32_t)(uintptr_t)t | PDE_TABLE_FLAGS;
+    _stats.tables++;
+    return t;
+}
+
+/* Pages from `va` to the end of its page table, capped at `left`. */
+static uint32_t _span(uint32_t va, uint32_t left)
+{
+    uint32_t n = PT_ENTRIES - ((va >> 12) & (PT_ENTRIES - 1u));
+    return n < left ? n : left;
+}
+
+static void _flush(const uint32_t *pd, uint32_t va, uint32_t npages)
+{
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    if ((cr3 & 0xFFFFF000u) != (uint32_t)(uintptr_t)pd) return;
+    if (npages > FLUSH_PAGES_MAX) { memory_tlb_flush_all(); return; }
+    for (uint32_t i = 0; i < npages; i++) memory_tlb_flush_local(va + i * PAGE_SIZE);
+}
+
+/* ── Map / unmap ─────────────────────────────────────────────────────────── */
+
+int pt_map_range(uint32_t *pd, uint32_t va, uint32_t phys, uint32_t npages, uint32_t flags)
+{
+    uint32_t bits = (flags & PT_USER_FLAGS) | PT_PRESENT;
+    uint32_t v = va & 0xFFFFF000u, p = phys & 0xFFFFF000u, left = npages;
+    while (left) {
+        int blocked = 0;
+        uint32_t *t = _table(pd, v, 1, &blocked);
+        if (!t) { pt_unmap_range(pd, va & 0xFFFFF000u, npages - left); return -1; }
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        for (uint32_t k = 0; k < n; k++, p += PAGE_SIZE) {
+            _pte_release(t[i + k]);
+            t[i + k] = p | bits;
+        }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    _flush(pd, va & 0xFFFFF000u, npages);
+    return (int)npages;
+}
+
+int pt_map_anon(uint32_t *pd, uint32_t va, uint32_t npages, uint32_t flags)
+{
+    uint32_t bits = (flags & PT_USER_FLAGS) | PT_PRESENT | PT_OWNED;
+    uint32_t v = va & 0xFFFFF000u, left = npages;
+    while (left) {
+        int blocked = 0;
+        uint32_t *t = _table(pd, v, 1, &blocked);
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        for (uint32_t k = 0; t && k < n; k++) {
+            uint32_t f = _frame_alloc();
+            if (!f) { t = NULL; left -= k; break; }
+            _pte_release(t[i + k]);
+            t[i + k] = f | bits;
+        }
+        if (!t) { pt_unmap_range(pd, va & 0xFFFFF000u, npages - left); return -1; }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    _flush(pd, va & 0xFFFFF000u, npages);
+    return (int)npages;
+}
+
+int pt_unmap_range(uint32_t *pd, uint32_t va, uint32_t npages)
+{
+    uint32_t v = va & 0xFFFFF000u, left = npages;
+    int done = 0;
+    while (left) {
+        uint32_t *t = _table(pd, v, 0, NULL);
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        for (uint32_t k = 0; t && k < n; k++) {
+            if (!(t[i + k] & PT_PRESENT)) continue;
+            _pte_release(t[i + k]);
+            t[i + k] = 0;
+            done++;
+        }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    _flush(pd, va & 0xFFFFF000u, npages);
+    return done;
+}
+
+int pt_protect_range(uint32_t *pd, uint32_t va, uint32_t npages, uint32_t flags)
+{
+    uint32_t want = flags & PT_USER_FLAGS;
+    uint32_t v = va & 0xFFFFF000u, left = npages;
+    int done = 0;
+    while (left) {
+        uint32_t *t = _table(pd, v, 0, NULL);
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        for (uint32_t k = 0; t && k < n; k++) {
+            uint32_t e = t[i + k];
+            if (!(e & PT_PRESENT)) continue;
+            e = (e & ~(PT_USER_FLAGS | PT_COW)) | want;
+            /* A frame still shared with another directory stays read-only
+             * until its first write fault copies it. */
+            if ((want & PT_WRITE) && (e & PT_OWNED) &&
+                _frame_refs[PHYS_TO_PAGE(PT_FRAME(e))] > 1)
+                e = (e & ~PT_WRITE) | PT_COW;
+            t[i + k] = e;
+            done++;
+        }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    _flush(pd, va & 0xFFFFF000u, npages);
+    return done;
+}
+
+/* ── Copy-on-write ───────────────────────────────────────────────────────── */
+
+/* Everything runs in ring 0, and with CR0.WP clear supervisor writes ignore
+ * the R/W bit — a COW share would be written through.  Set it before the
+ * first share exists. */
+static void _wp_enable(void)
+{
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    if (!(cr0 & 0x10000u))
+        __asm__ volatile("mov %0, %%cr0" :: "r"(cr0 | 0x10000u) : "memory");
+}
+
+int pt_clone_cow(uint32_t *dst, uint32_t *src, uint32_t va, uint32_t npages)
+{
+    uint32_t v = va & 0xFFFFF000u, left = npages;
+    int done = 0;
+    _wp_enable();
+    while (left) {
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        uint32_t *s = _table(src, v, 0, NULL);
+        if (s) {
+            int blocked = 0;
+            uint32_t *d = _table(dst, v, 1, &blocked);
+            if (!d) return -1;
+            for (uint32_t k = 0; k < n; k++) {
+                uint32_t e = s[i + k];
+                if (!(e & PT_PRESENT)) continue;
+                if (e & PT_OWNED) {
+                    _frame_get(PT_FRAME(e));
+                    if (e & PT_WRITE) {
+                        e = (e & ~PT_WRITE) | PT_COW;
+                        s[i + k] = e;
+                        _stats.cow_shared++;
+                    }
+                }
+                _pte_release(d[i + k]);
+                d[i + k] = e;
+                done++;
+            }
+        }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    _flush(src, va & 0xFFFFF000u, npages);   /* parent lost write access */
+    _flush(dst, va & 0xFFFFF000u, npages);
+    return done;
+}
+
+int pt_cow_fault(uint32_t *pd, uint32_t va)
+{
+    uint32_t *t = _table(pd, va, 0, NULL);
+    if (!t) return 0;
+    uint32_t *pte = &t[(va >> 12) & (PT_ENTRIES - 1u)];
+    uint32_t e = *pte;
+    if (!(e & PT_PRESENT) || !(e & PT_COW)) return 0;
+
+    uint32_t old = PT_FRAME(e);
+    if (__atomic_load_n(&_frame_refs[PHYS_TO_PAGE(old)], __ATOMIC_ACQUIRE) == 1) {
+        *pte = (e & ~PT_COW) | PT_WRITE;              /* last sharer: reclaim */
+        _stats.cow_reuses++;
+    } else {
+        uint32_t f = _frame_alloc();
+        if (!f) return -1;
+        memcpy((void *)(uintptr_t)f, (const void *)(uintptr_t)old, PAGE_SIZE);
+        _frame_put(old);
+        *pte = f | (e & 0xFFFu & ~PT_COW) | PT_WRITE;
+        _stats.cow_copies++;
+    }
+    _flush(pd, va & 0xFFFFF000u, 1);
+    return 1;
+}
+
+int pt_handle_fault(uint32_t va, uint32_t err)
+{
+    if ((err & 3u) != 3u) return 0;                  /* not a write to a present page */
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return pt_cow_fault((uint32_t *)(uintptr_t)(cr3 & 0xFFFFF000u), va) == 1;
+}
+
+/* ── Queries / teardown ──────────────────────────────────────────────────── */
+
+uint32_t pt_query(const uint32_t *pd, uint32_t va)
+{
+    uint32_t pde = pd[va >> 22];
+    if (!(pde & PT_PRESENT)) return 0;
+    if (pde & PT_HUGE) return pde;
+    const uint32_t *t = (const uint32_t *)(uintptr_t)PT_FRAME(pde);
+    return t[(va >> 12) & (PT_ENTRIES - 1u)];
+}
+
+uint32_t pt_count(const uint32_t *pd, uint32_t va, uint32_t npages)
+{
+    uint32_t v = va & 0xFFFFF000u, left = npages, n_present = 0;
+    while (left) {
+        uint32_t pde = pd[v >> 22];
+        uint32_t n = _span(v, left), i = (v >> 12) & (PT_ENTRIES - 1u);
+        if ((pde & PT_PRESENT) && !(pde & PT_HUGE)) {
+            const uint32_t *t = (const uint32_t *)(uintptr_t)PT_FRAME(pde);
+            for (uint32_t k = 0; k < n; k++) n_present += t[i + k] & PT_PRESENT;
+        }
+        v += n * PAGE_SIZE; left -= n;
+    }
+    return n_present;
+}
+
+void pt_release_all(uint32_t *pd)
+{
+    for (uint32_t d = 0; d < PT_ENTRIES; d++) {
+        uint32_t pde = pd[d];
+        if (!(pde & PT_PRESENT) || (pde & PT_HUGE)) continue;
+        uint32_t *t = (uint32_t *)(uintptr_t)PT_FRAME(pde);
+        for (uint32_t k = 0; k < PT_ENTRIES; k++) _pte_release(t[k]);
+        free(t);
+        _stats.tables--;
+        pd[d] = 0;
+    }
+    _flush(pd, 0, FLUSH_PAGES_MAX + 1u);
+}
+
+void pt_get_stats(pt_stats_t *out) { *out = _stats; }
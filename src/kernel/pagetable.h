@@ -0,0 +1,88 @@
+/*
+ * pagetable.h — Bulk x86 page-table primitives
+ *
+ * Two-level 32-bit paging: a page directory of 1024 PDEs, each either a
+ * 4 MB identity page (PS set — the kernel's RAM / MMIO maps, never split
+ * here) or a pointer to a page table of 1024 PTEs.  These routines walk and
+ * edit those tables directly, a range at a time, so process/vmm.ts no
+ * longer drives one setPageEntry() call per page.
+ *
+ * Page tables and anonymous frames come from the heap (memalign), which is
+ * identity-mapped, so a table's virtual address is its physical address.
+ *
+ * Frame ownership: frames allocated by pt_map_anon() / pt_cow_fault() carry
+ * PT_OWNED and a per-frame reference count; pt_clone_cow() shares them
+ * read-only between directories (PT_COW) and the first write fault copies.
+ * Frames mapped with pt_map_range() (MMIO, physical windows) are not owned
+ * and are never freed here.
+ *
+ * ARCHITECTURE CONSTRAINT: C edits page tables; which ranges exist (the
+ * VMA tree), their permissions and fork policy live in process/vmm.ts.
+ */
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include <stdint.h>
+
+#define PT_PRESENT   0x001u
+#define PT_WRITE     0x002u
+#define PT_USER      0x004u
+#define PT_PCD       0x010u
+#define PT_ACCESSED  0x020u
+#define PT_DIRTY     0x040u
+#define PT_HUGE      0x080u   /* PDE only: 4 MB page                         */
+#define PT_COW       0x200u   /* AVL: write-protected copy-on-write share    */
+#define PT_OWNED     0x400u   /* AVL: frame refcounted and freed by us       */
+
+/* Flags callers may request for a mapping */
+#define PT_USER_FLAGS  (PT_WRITE | PT_USER | PT_PCD)
+
+typedef struct {
+    uint32_t tables;        /* page tables currently allocated            */
+    uint32_t frames;        /* owned frames currently allocated           */
+    uint32_t cow_shared;    /* PTEs write-protected by pt_clone_cow()     */
+    uint32_t cow_copies;    /* write faults that copied a frame           */
+    uint32_t cow_reuses;    /* write faults on a frame with one owner     */
+} pt_stats_t;
+
+/* All range functions take a page-aligned `va` and a page count and return
+ * the number of pages affected, or -1 (a 4 MB identity PDE is in the way,
+ * or out of memory — partial work is undone). */
+
+/* Map `npages` consecutive physical frames starting at `phys`. */
+int pt_map_range(uint32_t *pd, uint32_t va, uint32_t phys, uint32_t npages, uint32_t flags);
+
+/* Map `npages` fresh zeroed frames. */
+int pt_map_anon(uint32_t *pd, uint32_t va, uint32_t npages, uint32_t flags);
+
+/* Remove mappings, dropping owned frames' references. */
+int pt_unmap_range(uint32_t *pd, uint32_t va, uint32_t npages);
+
+/* Replace the PT_USER_FLAGS of every present page (COW shares stay
+ * write-protected until they fault). */
+int pt_protect_range(uint32_t *pd, uint32_t va, uint32_t npages, uint32_t flags);
+
+/* Copy the range from `src` into `dst` for fork(): owned writable frames
+ * become PT_COW in both, everything else is shared as is. */
+int pt_clone_cow(uint32_t *dst, uint32_t *src, uint32_t va, uint32_t npages);
+
+/* Write fault at `va`: 1 = resolved (copied or reclaimed), 0 = not a COW
+ * page, -1 = out of memory. */
+int pt_cow_fault(uint32_t *pd, uint32_t va);
+
+/* #PF hook: resolve a write fault on a COW page of the directory in CR3.
+ * `err` is the CPU error code.  Returns 1 if the access can be retried. */
+int pt_handle_fault(uint32_t va, uint32_t err);
+
+/* Raw PTE for `va` (a PS PDE is reported as-is), 0 if unmapped. */
+uint32_t pt_query(const uint32_t *pd, uint32_t va);
+
+/* Present 4 KB pages in the range. */
+uint32_t pt_count(const uint32_t *pd, uint32_t va, uint32_t npages);
+
+/* Drop every 4 KB mapping and page table of `pd` (4 MB PDEs are kept). */
+void pt_release_all(uint32_t *pd);
+
+void pt_get_stats(pt_stats_t *out);
+
+#endif /* PAGETABLE_H */
@@ -279,18 +279,6 @@ void platform_fb_get_info(fb_info_t *out) {
  */
 /* ── TSS (Task State Segment) — Phase 5 ─────────────────────────────────── */
 
-typedef struct __attribute__((packed)) {
-    uint32_t prev_tss;
-    uint32_t esp0;            /* kernel ESP on ring-3 → ring-0 transition */
-    uint32_t ss0;             /* kernel SS (= 0x10, data segment)          */
-    uint32_t esp1; uint32_t ss1;
-    uint32_t esp2; uint32_t ss2;
-    uint32_t cr3, eip, eflags;
-    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
-    uint32_t es, cs, ss, ds, fs, gs, ldt;
-    uint16_t trap, iomap_base;
-} tss_t;
-
 static tss_t kernel_tss;
 
 void platform_tss_init(void) {
@@ -320,8 +308,8 @@ void platform_tss_set_esp0(uint32_t kernel_stack_top) {
  */
 extern uint8_t gdt_start[];   /* defined in irq_asm.s */
 
-void platform_gdt_install_tss(void) {
-    uint32_t base  = (uint32_t)(uintptr_t)&kernel_tss;
+void platform_gdt_encode_tss(uint8_t *entry, const tss_t *tss) {
+    uint32_t base  = (uint32_t)(uintptr_t)tss;
     uint32_t limit = (uint32_t)sizeof(tss_t) - 1;
 
     /* GDT entry format (8 bytes):
@@ -333,8 +321,6 @@ void platform_gdt_install_tss(void) {
      * [55:52] flags: G=0, D/B=0, L=0, AVL=0
      * [63:56] base[31:24]
      */
-    uint8_t *entry = gdt_start + 0x28;   /* slot 5 */
-
     entry[0] = (uint8_t)(limit & 0xFF);
     entry[1] = (uint8_t)((limit >> 8) & 0xFF);
     entry[2] = (uint8_t)(base & 0xFF);
@@ -343,6 +329,10 @@ void platform_gdt_install_tss(void) {
     entry[5] = 0x89;   /* P=1, DPL=0, S=0, type=9 (32-bit avail. TSS) */
     entry[6] = (uint8_t)((limit >> 16) & 0x0F);  /* limit[19:16], flags=0 */
     entry[7] = (uint8_t)((base >> 24) & 0xFF);
+}
+
+void platform_gdt_install_tss(void) {
+    platform_gdt_encode_tss(gdt_start + 0x28, &kernel_tss);   /* slot 5 */
 
     /* Load Task Register with TSS selector 0x28 */
     __asm__ volatile("ltr %%ax" :: "a"((uint16_t)0x28));
@@ -86,10 +86,25 @@ void platform_fb_get_info(fb_info_t *out);
  * Used so the CPU knows which kernel stack to switch to on ring-3→ring-0
  * transitions (Phase 6+).  Phase 5 initialises the structure; Phase 9 loads TR.
  */
+typedef struct __attribute__((packed)) {
+    uint32_t prev_tss;
+    uint32_t esp0;            /* kernel ESP on ring-3 → ring-0 transition */
+    uint32_t ss0;             /* kernel SS (= 0x10, data segment)          */
+    uint32_t esp1; uint32_t ss1;
+    uint32_t esp2; uint32_t ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs, ldt;
+    uint16_t trap, iomap_base;
+} tss_t;
+
 void platform_tss_init(void);
 void platform_tss_set_esp0(uint32_t kernel_stack_top);
 /* Install the TSS into GDT slot 5 (0x28) and execute ltr.  [Phase 9] */
 void platform_gdt_install_tss(void);
+/* Encode an 8-byte 32-bit-available-TSS descriptor for `tss` at `entry`.
+ * Shared with smp.c, which builds one TSS descriptor per CPU. */
+void platform_gdt_encode_tss(uint8_t *entry, const tss_t *tss);
 void platform_fb_blit(const uint32_t *src, int x, int y, int w, int h);
 void platform_fb_blit_strided(const uint32_t *src, int srcStride,
                               int x, int y, int w, int h);
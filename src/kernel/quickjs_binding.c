@@ -18,6 +18,17 @@
 #include "io.h"
 #include "embedded_js.h"
 #include "ata.h"
+#include "smp.h"
+#include "ipc_ring.h"
+#include "uring.h"
+#include "pagetable.h"
+#include "zygote.h"
+#include "kthread.h"
+#include "initrd.h"
+#include "lz4.h"
+#include "crc32c.h"
+#include "imgcodec.h"
+#include "raster.h"
 #include <setjmp.h>
 
 /* Recovery globals declared in irq.c */
@@ -32,6 +43,7 @@ extern volatile int  _js_in_page_eval;
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <malloc.h>
 
 /* Match QuickJS's MALLOC_OVERHEAD for consistent GC threshold accounting */
 #ifndef MALLOC_OVERHEAD
@@ -73,13 +85,11 @@ static JSContext *ctx = NULL;
  * Each slot is an independent QuickJS runtime (separate GC, heap, globals).
  * Up to 16 concurrent child processes; up to 1 GB heap each (JS_SetMemoryLimit soft cap;
  * no pre-allocation — pages come from the shared 2 GB NOLOAD _sbrk window lazily).
- * IPC is done via ring-buffer message queues in BSS (parent ↔ child).
+ * IPC is done via variable-length lock-free byte rings (ipc_ring.h), one
+ * per direction, allocated with the child and sized by procCreate().
  */
-#define JSPROC_MAX       16
-#define JSPROC_MSGSLOTS  8
-#define JSPROC_MSGSIZE   2048
-
-typedef struct { char data[JSPROC_MSGSIZE]; int len; } ProcMsg_t;
+#define JSPROC_MAX         16
+#define JSPROC_RESULT_MAX  2048   /* eval/slice result strings, not IPC */
 
 typedef struct {
     JSRuntime  *rt;
@@ -87,18 +97,56 @@ typedef struct {
     uint8_t     used;
     uint8_t     tainted;          /* set after CPU fault — heap is corrupted, do not execute */
     uint32_t    width, height;    /* render surface dimensions set by procSetDimensions */
-    /* parent → child */
-    ProcMsg_t   inbox[JSPROC_MSGSLOTS];
-    int         inbox_r, inbox_w, inbox_cnt;
-    /* child → parent */
-    ProcMsg_t   outbox[JSPROC_MSGSLOTS];
-    int         outbox_r, outbox_w, outbox_cnt;
+    uint32_t   *pd;               /* zygote clone: directory holding its heap;
+                                   * NULL = heap on the shared kernel heap */
+    ipc_ring_t  inbox;            /* parent → child */
+    ipc_ring_t  outbox;           /* child → parent */
     /* Per-child slice deadline (PIT ticks); 0 = disabled */
     volatile uint32_t slice_deadline;
+    /* SMP (item 31): eval queued on an application processor */
+    volatile uint8_t  ap_state;   /* JSPROC_AP_* */
+    uint8_t           ap_cpu;     /* CPU the work was queued on          */
+    char             *ap_code;    /* malloc'd source; freed by the AP     */
+    char              ap_result[JSPROC_RESULT_MAX + 8]; /* "done:…"/"error:…"/"timeout" */
 } JSProc_t;
 
+#define JSPROC_AP_IDLE     0
+#define JSPROC_AP_QUEUED   1
+#define JSPROC_AP_RUNNING  2
+#define JSPROC_AP_DONE     3
+
 static JSProc_t _procs[JSPROC_MAX];
-static int      _cur_proc = -1;   /* -1 = main runtime; ≥0 = child slot index */
+/* Child slot currently executing on each CPU: -1 = main runtime (BSP) or
+ * idle AP; ≥0 = child slot index.  Per-CPU so the child-side kernel API
+ * resolves the right slot when children run concurrently on APs. */
+static int      _cur_proc_cpu[SMP_MAX_CPUS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+#define _cur_proc (_cur_proc_cpu[smp_cpu_index()])
+
+/* A child whose eval is queued on / running on an AP belongs to that CPU;
+ * every BSP-side entry point that touches its runtime must back off. */
+static inline int _proc_on_ap(int id) {
+    uint8_t st = __atomic_load_n(&_procs[id].ap_state, __ATOMIC_ACQUIRE);
+    return st == JSPROC_AP_QUEUED || st == JSPROC_AP_RUNNING;
+}
+
+/* Zygote clones keep their heap at the same virtual address in
+ * private directories: load the child's directory around every call into
+ * its runtime.  _proc_pd_enter returns the CR3 to hand to _proc_pd_leave;
+ * fault-recovery paths restore it the same way. */
+static inline uint32_t _cr3_read(void) {
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+static inline void _cr3_load(uint32_t cr3) {
+    if (_cr3_read() != cr3) __asm__ volatile("mov %0, %%cr3" :: "r"(cr3) : "memory");
+}
+static inline uint32_t _proc_pd_enter(int id) {
+    uint32_t old = _cr3_read();
+    if (_procs[id].pd) _cr3_load((uint32_t)(uintptr_t)_procs[id].pd);
+    return old;
+}
+static inline void _proc_pd_leave(uint32_t old) { _cr3_load(old); }
 
 /* Pending JIT request from a child runtime — stored by _jit_hook_child,
  * consumed by js_proc_pending_jit() from the TypeScript tick loop.
@@ -161,20 +209,195 @@ static ProcWinCmdBuf_t _proc_wincmds[JSPROC_MAX];
  * those TS callbacks through the stable main-runtime context pointer `ctx'. */
 static JSValue _fs_bridge_obj; /* initialised to JS_UNDEFINED in quickjs_initialize() */
 
-/* ── Phase 10: Shared memory buffers ──────────────────────────────────────
- * Static BSS slabs mapped as ArrayBuffers into any runtime that calls
- * sharedBufferOpen(id).  Because the memory is BSS (stable address, never
- * moved by QuickJS GC), both parent and child see the same physical bytes
- * with zero serialisation overhead.
+/* ── Shared memory objects ───────────────────────────────────────────────
+ * Page-aligned regions carved from the kernel heap (memalign — never moved
+ * by any GC), optionally named, mapped as zero-copy ArrayBuffers into any
+ * runtime that calls sharedBufferOpen(id).
+ *
+ * References are counted per runtime (owner 0 = main, 1..16 = child id+1):
+ *   holds[o]  handles from sharedBufferCreate / shmCreate / shmOpen
+ *   maps[o]   live ArrayBuffers; dropped by the ArrayBuffer free callback
+ *   xfer      a bufferTransfer() hand-off not yet accepted
+ * The region is freed when all of them reach zero.  procDestroy drops the
+ * child's holds (and, for a tainted child whose GC will never run, its
+ * maps), so a dying process cannot pin memory.  Unlike POSIX a name does
+ * not keep the region alive.
+ *
+ * Ids carry a generation so a stale id (or a late free callback) can never
+ * touch a recycled slot:  id = gen << 6 | slot.
  */
-#define SHARED_BUF_MAX    8
-#define SHARED_BUF_BYTES  (256 * 1024)   /* 256 KB per slot; 8 slots = 2 MB BSS */
+#define SHM_MAX        64
+#define SHM_SLOT_BITS  6
+#define SHM_NAME_MAX   32
+#define SHM_PAGE       4096u
+#define SHM_MAX_BYTES  (256u * 1024u * 1024u)
+#define SHM_OWNERS     (JSPROC_MAX + 1)
+
+typedef struct {
+    uint8_t  *base;
+    uint32_t  size;               /* requested bytes (ArrayBuffer length)   */
+    uint32_t  alloc;              /* rounded up to whole pages              */
+    uint16_t  gen;
+    uint8_t   used;
+    uint8_t   xfer_owner;         /* owner whose bufferTransfer is pending  */
+    uint32_t  xfer;               /* 0 or 1                                 */
+    uint16_t  holds[SHM_OWNERS];
+    uint32_t  maps[SHM_OWNERS];
+    char      name[SHM_NAME_MAX]; /* "" = anonymous                         */
+} ShmObj_t;
+
+static ShmObj_t       _shm[SHM_MAX];
+static smp_spinlock_t _shm_lock;  /* children on APs map/unmap concurrently */
+
+static inline int _shm_owner(void) { return _cur_proc + 1; }
+
+static inline int32_t _shm_id(int slot) {
+    return (int32_t)(((uint32_t)_shm[slot].gen << SHM_SLOT_BITS) | (uint32_t)slot);
+}
+
+/* Resolve an id to its slot, or -1.  Caller holds _shm_lock. */
+static int _shm_slot(int32_t id) {
+    if (id < 0) return -1;
+    int slot = id & (SHM_MAX - 1);
+    if (!_shm[slot].used || _shm[slot].gen != (uint16_t)((uint32_t)id >> SHM_SLOT_BITS))
+        return -1;
+    return slot;
+}
+
+static int _shm_find_name(const char *name) {
+    for (int i = 0; i < SHM_MAX; i++)
+        if (_shm[i].used && _shm[i].name[0] && strcmp(_shm[i].name, name) == 0)
+            return i;
+    return -1;
+}
 
-static uint8_t  _sbufs[SHARED_BUF_MAX][SHARED_BUF_BYTES] __attribute__((aligned(4096)));
-static uint8_t  _sbuf_used[SHARED_BUF_MAX];
-static uint32_t _sbuf_sizes[SHARED_BUF_MAX];
+static uint32_t _shm_refs(const ShmObj_t *o) {
+    uint32_t n = o->xfer;
+    for (int i = 0; i < SHM_OWNERS; i++) n += o->holds[i] + o->maps[i];
+    return n;
+}
+
+/* Free the region if nothing references it any more.  Caller holds the
+ * lock; returns the memory to free after unlocking (or NULL). */
+static void *_shm_maybe_free(int slot) {
+    ShmObj_t *o = &_shm[slot];
+    if (_shm_refs(o) != 0) return NULL;
+    void *mem = o->base;
+    uint16_t gen = o->gen;
+    memset(o, 0, sizeof(*o));
+    o->gen = (uint16_t)(gen + 1u);
+    return mem;
+}
+
+/* New region with one hold for the calling runtime.  Returns slot or -1. */
+static int _shm_alloc(uint32_t size, const char *name) {
+    if (size == 0) size = 4;
+    if (size > SHM_MAX_BYTES) return -1;
+    uint32_t alloc = (size + SHM_PAGE - 1u) & ~(SHM_PAGE - 1u);
+    uint8_t *mem = (uint8_t *)memalign(SHM_PAGE, alloc);
+    if (!mem) return -1;
+    memset(mem, 0, alloc);
+    smp_spin_lock(&_shm_lock);
+    int slot = -1;
+    if (!(name && name[0] && _shm_find_name(name) >= 0)) {
+        for (int i = 0; i < SHM_MAX; i++)
+            if (!_shm[i].used) { slot = i; break; }
+    }
+    if (slot >= 0) {
+        ShmObj_t *o = &_shm[slot];
+        o->used  = 1;
+        o->base  = mem;
+        o->size  = size;
+        o->alloc = alloc;
+        o->holds[_shm_owner()] = 1;
+        if (name) {
+            strncpy(o->name, name, SHM_NAME_MAX - 1);
+            o->name[SHM_NAME_MAX - 1] = '\0';
+        }
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (slot < 0) free(mem);
+    return slot;
+}
+
+/* ArrayBuffer free callback: opaque = owner << 24 | id. */
+static void _shm_unmap(JSRuntime *rt, void *opaque, void *ptr) {
+    (void)rt; (void)ptr;
+    uint32_t v = (uint32_t)(uintptr_t)opaque;
+    int owner = (int)(v >> 24);
+    void *mem = NULL;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot((int32_t)(v & 0xFFFFFFu));
+    if (slot >= 0 && owner < SHM_OWNERS && _shm[slot].maps[owner]) {
+        _shm[slot].maps[owner]--;
+        mem = _shm_maybe_free(slot);
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (mem) free(mem);
+}
+
+/* Wrap a region the caller has already counted in maps[owner]. */
+static JSValue _shm_wrap(JSContext *c, int owner, int32_t id,
+                         uint8_t *base, uint32_t size) {
+    void *opaque = (void *)(uintptr_t)(((uint32_t)owner << 24) | (uint32_t)id);
+    JSValue ab = JS_NewArrayBuffer(c, base, size, _shm_unmap, opaque, 0);
+    if (JS_IsException(ab)) _shm_unmap(NULL, opaque, base);
+    return ab;
+}
+
+/* Map region `id` into the calling runtime.  JS_NULL for a stale id. */
+static JSValue _shm_map(JSContext *c, int32_t id) {
+    int owner = _shm_owner();
+    uint8_t *base = NULL;
+    uint32_t size = 0;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot(id);
+    if (slot >= 0) {
+        _shm[slot].maps[owner]++;
+        base = _shm[slot].base;
+        size = _shm[slot].size;
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (!base) return JS_NULL;
+    return _shm_wrap(c, owner, id, base, size);
+}
+
+/* Drop one hold of the calling runtime.  Returns 0, or -1 if it had none. */
+static int _shm_close(int32_t id) {
+    int owner = _shm_owner(), rc = -1;
+    void *mem = NULL;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot(id);
+    if (slot >= 0 && _shm[slot].holds[owner]) {
+        _shm[slot].holds[owner]--;
+        mem = _shm_maybe_free(slot);
+        rc = 0;
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (mem) free(mem);
+    return rc;
+}
+
+/* procDestroy: forget every reference owned by child `id`. */
+static void _shm_release_proc(int id, int tainted) {
+    int owner = id + 1;
+    for (int i = 0; i < SHM_MAX; i++) {
+        void *mem = NULL;
+        smp_spin_lock(&_shm_lock);
+        ShmObj_t *o = &_shm[i];
+        if (o->used) {
+            o->holds[owner] = 0;
+            if (tainted) o->maps[owner] = 0;
+            if (o->xfer && o->xfer_owner == owner) o->xfer = 0;
+            mem = _shm_maybe_free(i);
+        }
+        smp_spin_unlock(&_shm_lock);
+        if (mem) free(mem);
+    }
+}
 
-/* No-op free: BSS is never heap-freed — QuickJS must not touch the pointer. */
+/* No-op free for ArrayBuffers over static BSS (per-app render buffers):
+ * QuickJS must never hand that pointer to the allocator. */
 static void _sbuf_no_free(JSRuntime *rt, void *opaque, void *ptr) {
     (void)rt; (void)opaque; (void)ptr;
 }
@@ -338,7 +561,7 @@ static JSValue js_wait_key_ex(JSContext *c, JSValueConst this_val, int argc, JSV
             JS_SetPropertyStr(c, obj, "ext", JS_NewInt32(c, 0));
             return obj;
         }
-        __asm__ volatile ("hlt");
+        kthread_idle();     /* let driver threads run, then halt */
     }
 }
 
@@ -377,7 +600,7 @@ static JSValue js_sleep(JSContext *c, JSValueConst this_val, int argc, JSValueCo
                 JS_FreeValue(c, r);
             }
         }
-        __asm__ volatile ("hlt");
+        kthread_idle();     /* driver threads run here instead of a bare hlt */
     }
     return JS_UNDEFINED;
 }
@@ -893,9 +1116,11 @@ static void *_fallback_alloc(size_t size) {
     /* 8-byte align all allocations */
     size = (size + 7u) & ~7u;
     if (size == 0) size = 8;
+    smp_heap_lock();                    /* APs share the bump pointer */
     uint32_t off = _fallback_offset;
-    if (off + size > FALLBACK_HEAP_SIZE) return NULL;   /* OOM */
+    if (off + size > FALLBACK_HEAP_SIZE) { smp_heap_unlock(); return NULL; }  /* OOM */
     _fallback_offset = off + (uint32_t)size;
+    smp_heap_unlock();
     return _fallback_arena + off;
 }
 
@@ -903,6 +1128,9 @@ static void *_fallback_alloc(size_t size) {
 void *__wrap__malloc_r(struct _reent *r, size_t size)
 {
     if (_heap_broken) return _fallback_alloc(size);
+    /* Application processors must not touch the BSP's _js_fault_buf;
+     * a fault here is recovered per-CPU by smp_ap_exception(). */
+    if (smp_cpu_index() != 0) return __real__malloc_r(r, size);
 
     jmp_buf _saved;
     int _act = _js_fault_active;
@@ -912,6 +1140,7 @@ void *__wrap__malloc_r(struct _reent *r, size_t size)
         /* _malloc_r faulted — use per-call fallback, keep dlmalloc for future calls.
          * Only switch to full fallback after 50+ total faults. */
         __asm__ volatile("sti");
+        smp_heap_lock_reset_if_owner();   /* faulted inside newlib's lock */
         _js_fault_active = _act;
         memcpy(_js_fault_buf, _saved, sizeof(jmp_buf));
         _free_faults++;
@@ -944,6 +1173,7 @@ void __wrap__free_r(struct _reent *r, void *ptr)
     if (p >= a && p < a + FALLBACK_HEAP_SIZE) return;
 
     if (_heap_broken) return;  /* leak — can't return to broken dlmalloc */
+    if (smp_cpu_index() != 0) { __real__free_r(r, ptr); return; }
 
     jmp_buf _saved;
     int _act = _js_fault_active;
@@ -954,6 +1184,7 @@ void __wrap__free_r(struct _reent *r, void *ptr)
          * Don't immediately switch to fallback: dlmalloc often works fine
          * for OTHER chunks.  Only switch after 3 consecutive free faults. */
         __asm__ volatile("sti");
+        smp_heap_lock_reset_if_owner();   /* faulted inside newlib's lock */
         _js_fault_active = _act;
         memcpy(_js_fault_buf, _saved, sizeof(jmp_buf));
         _free_faults++;
@@ -1008,6 +1239,7 @@ void *__wrap__realloc_r(struct _reent *r, void *ptr, size_t size)
         }
         return n;
     }
+    if (smp_cpu_index() != 0) return __real__realloc_r(r, ptr, size);
 
     jmp_buf _saved;
     int _act = _js_fault_active;
@@ -1017,6 +1249,7 @@ void *__wrap__realloc_r(struct _reent *r, void *ptr, size_t size)
         /* _realloc_r faulted — heap metadata is corrupted around this chunk.
          * Use same tolerance as _free_r — count faults before fallback. */
         __asm__ volatile("sti");
+        smp_heap_lock_reset_if_owner();   /* faulted inside newlib's lock */
         _js_fault_active = _act;
         memcpy(_js_fault_buf, _saved, sizeof(jmp_buf));
         _free_faults++;
@@ -1593,7 +1826,31 @@ static JSValue js_enable_paging(JSContext *c, JSValueConst this_val,
  */
 #define MAX_USER_PDS 32
 static uint32_t _user_pds[MAX_USER_PDS][1024] __attribute__((aligned(4096)));
-static uint8_t  _user_pd_used[MAX_USER_PDS];
+static uint8_t  _user_pd_used[MAX_USER_PDS];   /* PD_USED_* */
+
+#define PD_USED_JS      1   /* cloneAddressSpace(): TypeScript owns it        */
+#define PD_USED_KERNEL  2   /* zygote / zygote clone: never visible to JS    */
+
+/* Claim a slot and copy the kernel's 4 MB PDEs into it.  Small-page tables
+ * belong to the directory that built them (pagetable.c), so they are not
+ * shared.  Returns NULL when all slots are taken. */
+static uint32_t *_pd_alloc(uint8_t owner) {
+    int slot = -1;
+    for (int i = 0; i < MAX_USER_PDS; i++) {
+        if (!_user_pd_used[i]) { slot = i; break; }
+    }
+    if (slot < 0) return NULL;
+    _user_pd_used[slot] = owner;
+    for (int i = 0; i < 1024; i++)
+        _user_pds[slot][i] = (paging_pd[i] & PT_HUGE) ? paging_pd[i] : 0u;
+    return _user_pds[slot];
+}
+
+/* Drop every mapping in `pd` and return its slot.  Not while it is in CR3. */
+static void _pd_free(uint32_t *pd) {
+    pt_release_all(pd);
+    _user_pd_used[(pd - _user_pds[0]) / 1024] = 0;
+}
 
 /*
  * kernel.cloneAddressSpace() → number
@@ -1606,21 +1863,162 @@ static uint8_t  _user_pd_used[MAX_USER_PDS];
 static JSValue js_clone_address_space(JSContext *c, JSValueConst this_val,
                                        int argc, JSValueConst *argv) {
     (void)this_val; (void)argc; (void)argv;
-    /* Find a free slot */
-    int slot = -1;
-    for (int i = 0; i < MAX_USER_PDS; i++) {
-        if (!_user_pd_used[i]) { slot = i; break; }
-    }
-    if (slot < 0) return JS_NewInt32(c, 0);   /* out of PD slots */
+    uint32_t *pd = _pd_alloc(PD_USED_JS);
+    if (!pd) return JS_NewInt32(c, 0);   /* out of PD slots */
+    return JS_NewInt32(c, (int32_t)(uint32_t)(uintptr_t)pd);
+}
 
-    _user_pd_used[slot] = 1;
+/* ── Bulk page-table primitives ──────────────────────────────────────────
+ *
+ * `pd` is 0 for the kernel directory or a cloneAddressSpace() address.
+ * Ranges are (va, npages); see pagetable.h for the semantics.
+ */
 
-    /* Eager copy: duplicate all present kernel PDEs (huge pages) */
-    for (int i = 0; i < 1024; i++)
-        _user_pds[slot][i] = paging_pd[i];
+/* Resolve a directory handle, or NULL if it names no live directory. */
+static uint32_t *_pd_resolve(JSContext *c, JSValueConst v) {
+    uint32_t phys = 0;
+    JS_ToUint32(c, &phys, v);
+    if (phys == 0 || phys == (uint32_t)(uintptr_t)paging_pd) return paging_pd;
+    for (int i = 0; i < MAX_USER_PDS; i++)
+        if (_user_pd_used[i] == PD_USED_JS && (uint32_t)(uintptr_t)_user_pds[i] == phys)
+            return _user_pds[i];
+    return NULL;
+}
+
+/* kernel.ptMapRange(pd, va, phys, npages, flags) → pages mapped, or -1 */
+static JSValue js_pt_map_range(JSContext *c, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 5) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0, phys = 0, n = 0, flags = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    JS_ToUint32(c, &phys, argv[2]);
+    JS_ToUint32(c, &n, argv[3]);
+    JS_ToUint32(c, &flags, argv[4]);
+    if (!pd) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_map_range(pd, va, phys, n, flags));
+}
+
+/* kernel.ptMapAnon(pd, va, npages, flags) → pages mapped, or -1 */
+static JSValue js_pt_map_anon(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 4) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0, n = 0, flags = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    JS_ToUint32(c, &n, argv[2]);
+    JS_ToUint32(c, &flags, argv[3]);
+    if (!pd) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_map_anon(pd, va, n, flags));
+}
+
+/* kernel.ptUnmapRange(pd, va, npages) → pages unmapped, or -1 */
+static JSValue js_pt_unmap_range(JSContext *c, JSValueConst this_val,
+                                  int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 3) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0, n = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    JS_ToUint32(c, &n, argv[2]);
+    if (!pd) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_unmap_range(pd, va, n));
+}
+
+/* kernel.ptProtectRange(pd, va, npages, flags) → pages changed, or -1 */
+static JSValue js_pt_protect_range(JSContext *c, JSValueConst this_val,
+                                    int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 4) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0, n = 0, flags = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    JS_ToUint32(c, &n, argv[2]);
+    JS_ToUint32(c, &flags, argv[3]);
+    if (!pd) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_protect_range(pd, va, n, flags));
+}
+
+/* kernel.ptCloneCow(dstPd, srcPd, va, npages) → pages shared, or -1 */
+static JSValue js_pt_clone_cow(JSContext *c, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 4) return JS_NewInt32(c, -1);
+    uint32_t *dst = _pd_resolve(c, argv[0]);
+    uint32_t *src = _pd_resolve(c, argv[1]);
+    uint32_t va = 0, n = 0;
+    JS_ToUint32(c, &va, argv[2]);
+    JS_ToUint32(c, &n, argv[3]);
+    if (!dst || !src || dst == src) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_clone_cow(dst, src, va, n));
+}
+
+/* kernel.ptCowFault(pd, va) → 1 resolved, 0 not a COW page, -1 OOM */
+static JSValue js_pt_cow_fault(JSContext *c, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 2) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    if (!pd) return JS_NewInt32(c, -1);
+    return JS_NewInt32(c, pt_cow_fault(pd, va));
+}
+
+/* kernel.ptQuery(pd, va) → raw PTE (0 = unmapped) */
+static JSValue js_pt_query(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 2) return JS_NewUint32(c, 0);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    return JS_NewUint32(c, pd ? pt_query(pd, va) : 0u);
+}
+
+/* kernel.ptCount(pd, va, npages) → present 4 KB pages in the range */
+static JSValue js_pt_count(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 3) return JS_NewUint32(c, 0);
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    uint32_t va = 0, n = 0;
+    JS_ToUint32(c, &va, argv[1]);
+    JS_ToUint32(c, &n, argv[2]);
+    return JS_NewUint32(c, pd ? pt_count(pd, va, n) : 0u);
+}
+
+/* kernel.ptStats() → {tables, frames, cowShared, cowCopies, cowReuses} */
+static JSValue js_pt_stats(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    pt_stats_t st;
+    pt_get_stats(&st);
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "tables",    JS_NewUint32(c, st.tables));
+    JS_SetPropertyStr(c, o, "frames",    JS_NewUint32(c, st.frames));
+    JS_SetPropertyStr(c, o, "cowShared", JS_NewUint32(c, st.cow_shared));
+    JS_SetPropertyStr(c, o, "cowCopies", JS_NewUint32(c, st.cow_copies));
+    JS_SetPropertyStr(c, o, "cowReuses", JS_NewUint32(c, st.cow_reuses));
+    return o;
+}
 
-    uint32_t phys = (uint32_t)(uintptr_t)_user_pds[slot];
-    return JS_NewInt32(c, (int32_t)phys);
+/*
+ * kernel.freeAddressSpace(pd) → bool
+ * Releases every small-page mapping and table of a cloneAddressSpace()
+ * directory and returns its slot.  Refused while the directory is in CR3.
+ */
+static JSValue js_free_address_space(JSContext *c, JSValueConst this_val,
+                                      int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_FALSE;
+    uint32_t *pd = _pd_resolve(c, argv[0]);
+    if (!pd || pd == paging_pd) return JS_FALSE;
+    if ((_cr3_read() & 0xFFFFF000u) == (uint32_t)(uintptr_t)pd) return JS_FALSE;
+    _pd_free(pd);
+    return JS_TRUE;
 }
 
 /*
@@ -1741,6 +2139,19 @@ static JSValue js_net_mac_address(JSContext *c, JSValueConst this_val,
     return arr;
 }
 
+/*
+ * kernel.netWaitRx(ms) → boolean
+ * Block until netRecvFrame() has a frame or `ms` pass.  The knetrxd kernel
+ * thread and the NIC's IRQ do the waking; no polling loop in JS.
+ */
+static JSValue js_net_wait_rx(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    (void)this_val;
+    uint32_t ms = 0;
+    if (argc > 0) JS_ToUint32(c, &ms, argv[0]);
+    return JS_NewBool(c, virtio_net_wait_rx(ms));
+}
+
 static JSValue js_net_debug_rx_used_idx(JSContext *c, JSValueConst this_val,
                                          int argc, JSValueConst *argv) {
     (void)this_val; (void)argc; (void)argv;
@@ -1806,9 +2217,9 @@ static JSValue js_get_page_fault_addr(JSContext *c, JSValueConst this_val,
 /*
  * The registered JS function is called cooperatively at yield points.
  * It is NOT called from the IRQ0 ISR directly (QuickJS is not re-entrant).
- * TypeScript's ThreadManager registers its tick() here so C can invoke it
- * in future phases via js_scheduler_tick() when proper per-thread C stacks
- * are in place.
+ * TypeScript's ThreadManager registers its tick() here.  Its threads stay
+ * logical; C stacks belong to the kernel threads of kthread.c,
+ * which run driver code and are scheduled from js_yield / js_sleep.
  * (_scheduler_hook is forward-declared near js_sleep above.)
  */
 
@@ -1838,9 +2249,37 @@ static JSValue js_yield(JSContext *c, JSValueConst this_val,
         }
         JS_FreeValue(c, r);
     }
+    /* Then give ready kernel threads their turn. */
+    kthread_yield();
     return JS_UNDEFINED;
 }
 
+/* kernel.kthreadList() → [{ id, name, state, stack, stackBytes, switches,
+ * wakeups, runUs, overflowed }]  — C kernel threads. */
+static JSValue js_kthread_list(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    static const char *const states[] = { "unused", "ready", "running", "blocked", "dead" };
+    JSValue arr = JS_NewArray(c);
+    uint32_t n = 0;
+    for (int id = 0; id < KTHREAD_MAX; id++) {
+        kthread_info_t ki;
+        if (kthread_info(id, &ki) != 0) continue;
+        JSValue o = JS_NewObject(c);
+        JS_SetPropertyStr(c, o, "id",         JS_NewInt32(c, id));
+        JS_SetPropertyStr(c, o, "name",       JS_NewString(c, ki.name));
+        JS_SetPropertyStr(c, o, "state",      JS_NewString(c, states[ki.state <= KT_DEAD ? ki.state : 0]));
+        JS_SetPropertyStr(c, o, "stack",      JS_NewUint32(c, ki.stack_base));
+        JS_SetPropertyStr(c, o, "stackBytes", JS_NewUint32(c, ki.stack_bytes));
+        JS_SetPropertyStr(c, o, "switches",   JS_NewUint32(c, ki.switches));
+        JS_SetPropertyStr(c, o, "wakeups",    JS_NewUint32(c, ki.wakeups));
+        JS_SetPropertyStr(c, o, "runUs",      JS_NewUint32(c, ki.run_us));
+        JS_SetPropertyStr(c, o, "overflowed", JS_NewBool(c, ki.overflowed));
+        JS_SetPropertyUint32(c, arr, n++, o);
+    }
+    return arr;
+}
+
 /* kernel.schedTick() — returns the number of IRQ0 ticks that fired since the
  * last call and resets the counter to zero.  JS can poll this to decide when
  * to call kernel.yield() without a hard sleep.                               */
@@ -1992,68 +2431,486 @@ static JSValue js_ata_write(JSContext *c, JSValueConst this_val,
 
 /* ── Phase 10: Child runtime IPC + parent management functions ──────────── */
 
-/* Inside a child runtime: push a message to the parent outbox */
+/* Message payloads are either strings (IPC_MSG_STRING, UTF-8) or raw bytes
+ * (IPC_MSG_BINARY) taken from an ArrayBuffer or any typed-array view.  Both
+ * are copied into the ring once and copied out once on receive; nothing is
+ * truncated — a message that can never fit is rejected instead. */
+
+/* Borrow the bytes of an ArrayBuffer / typed array.  NULL if `v` is neither
+ * (or is detached); the pending exception from the probe is discarded. */
+static const uint8_t *_ipc_value_bytes(JSContext *c, JSValueConst v, size_t *len) {
+    if (!JS_IsObject(v)) return NULL;
+    uint8_t *buf = JS_GetArrayBuffer(c, len, v);
+    if (buf) return buf;
+    JS_FreeValue(c, JS_GetException(c));
+    size_t off = 0, blen = 0, bpe = 0, ablen = 0;
+    JSValue ab = JS_GetTypedArrayBuffer(c, v, &off, &blen, &bpe);
+    if (JS_IsException(ab)) { JS_FreeValue(c, JS_GetException(c)); return NULL; }
+    buf = JS_GetArrayBuffer(c, &ablen, ab);
+    JS_FreeValue(c, ab);              /* the view keeps the buffer alive */
+    if (!buf) { JS_FreeValue(c, JS_GetException(c)); return NULL; }
+    *len = blen;
+    return buf + off;
+}
+
+/* Encode one JS value into `r`.  Returns the ipc_ring_write() status, or -3
+ * if the value could not be converted. */
+static int _ipc_ring_send(JSContext *c, ipc_ring_t *r, JSValueConst v) {
+    size_t len = 0;
+    if (!JS_IsString(v)) {
+        const uint8_t *bytes = _ipc_value_bytes(c, v, &len);
+        if (bytes) {
+            if (len > ipc_ring_max_msg(r)) return -2;
+            return ipc_ring_write(r, IPC_MSG_BINARY, bytes, (uint32_t)len);
+        }
+    }
+    const char *str = JS_ToCStringLen(c, &len, v);
+    if (!str) { JS_FreeValue(c, JS_GetException(c)); return -3; }
+    int rc = (len > ipc_ring_max_msg(r))
+           ? -2 : ipc_ring_write(r, IPC_MSG_STRING, str, (uint32_t)len);
+    JS_FreeCString(c, str);
+    return rc;
+}
+
+/* Send every element of `arr` in order; stops at the first one that does
+ * not fit.  Returns the number sent. */
+static int32_t _ipc_ring_send_array(JSContext *c, ipc_ring_t *r, JSValueConst arr) {
+    uint32_t n = 0;
+    JSValue lv = JS_GetPropertyStr(c, arr, "length");
+    JS_ToUint32(c, &n, lv);
+    JS_FreeValue(c, lv);
+    int32_t sent = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        JSValue el = JS_GetPropertyUint32(c, arr, i);
+        int rc = _ipc_ring_send(c, r, el);
+        JS_FreeValue(c, el);
+        if (rc != 0) break;
+        sent++;
+    }
+    return sent;
+}
+
+static JSValue _ipc_msg_value(JSContext *c, uint32_t type,
+                              const uint8_t *data, uint32_t len) {
+    if (type == IPC_MSG_BINARY) return JS_NewArrayBufferCopy(c, data, len);
+    return JS_NewStringLen(c, (const char *)data, len);
+}
+
+/* Pop one message → string | ArrayBuffer, or null if the ring is empty. */
+static JSValue _ipc_ring_recv(JSContext *c, ipc_ring_t *r) {
+    uint32_t cur = ipc_ring_read_begin(r), type = 0, len = 0;
+    const uint8_t *data = NULL;
+    if (!ipc_ring_next(r, &cur, &type, &data, &len)) {
+        ipc_ring_read_end(r, cur, 0);     /* may still retire padding */
+        return JS_NULL;
+    }
+    JSValue ret = _ipc_msg_value(c, type, data, len);
+    ipc_ring_read_end(r, cur, 1);
+    return ret;
+}
+
+/* Drain up to `max` messages (0 = all) into an array, publishing the new
+ * tail once for the whole batch. */
+static JSValue _ipc_ring_recv_batch(JSContext *c, ipc_ring_t *r, uint32_t max) {
+    JSValue arr = JS_NewArray(c);
+    uint32_t cur = ipc_ring_read_begin(r), type = 0, len = 0, n = 0;
+    const uint8_t *data = NULL;
+    while ((max == 0 || n < max) && ipc_ring_next(r, &cur, &type, &data, &len)) {
+        JS_SetPropertyUint32(c, arr, n, _ipc_msg_value(c, type, data, len));
+        n++;
+    }
+    ipc_ring_read_end(r, cur, n);
+    return arr;
+}
+
+static JSProc_t *_child_self(void) {
+    if (_cur_proc < 0 || _cur_proc >= JSPROC_MAX || !_procs[_cur_proc].used)
+        return NULL;
+    return &_procs[_cur_proc];
+}
+
+/* Inside a child runtime: kernel.postMessage(msg) → bool.
+ * msg is a string, ArrayBuffer or typed array; false if the outbox is full
+ * (retry after the parent drains) or msg exceeds maxMessageBytes(). */
 static JSValue js_proc_post_msg(JSContext *c, JSValueConst this_val,
                                 int argc, JSValueConst *argv) {
     (void)this_val;
-    if (_cur_proc < 0 || _cur_proc >= JSPROC_MAX || !_procs[_cur_proc].used)
-        return JS_FALSE;
-    if (argc < 1) return JS_FALSE;
-    JSProc_t *p = &_procs[_cur_proc];
-    if (p->outbox_cnt >= JSPROC_MSGSLOTS) return JS_FALSE;
-    const char *msg = JS_ToCString(c, argv[0]);
-    if (!msg) return JS_FALSE;
-    ProcMsg_t *slot = &p->outbox[p->outbox_w];
-    int n = (int)strlen(msg);
-    if (n >= JSPROC_MSGSIZE) n = JSPROC_MSGSIZE - 1;
-    memcpy(slot->data, msg, (size_t)n);
-    slot->data[n] = '\0';
-    slot->len = n;
-    JS_FreeCString(c, msg);
-    p->outbox_w = (p->outbox_w + 1) % JSPROC_MSGSLOTS;
-    p->outbox_cnt++;
-    return JS_TRUE;
+    JSProc_t *p = _child_self();
+    if (!p || argc < 1) return JS_FALSE;
+    return JS_NewBool(c, _ipc_ring_send(c, &p->outbox, argv[0]) == 0);
+}
+
+/* Inside a child runtime: kernel.postMessages([msg, …]) → number posted */
+static JSValue js_proc_post_msgs(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val;
+    JSProc_t *p = _child_self();
+    if (!p || argc < 1) return JS_NewInt32(c, 0);
+    return JS_NewInt32(c, _ipc_ring_send_array(c, &p->outbox, argv[0]));
 }
 
-/* Inside a child runtime: receive a message from the parent inbox */
+/* Inside a child runtime: kernel.pollMessage() → string | ArrayBuffer | null */
 static JSValue js_proc_poll_msg(JSContext *c, JSValueConst this_val,
                                 int argc, JSValueConst *argv) {
     (void)this_val; (void)argc; (void)argv;
-    if (_cur_proc < 0 || _cur_proc >= JSPROC_MAX || !_procs[_cur_proc].used)
-        return JS_NULL;
-    JSProc_t *p = &_procs[_cur_proc];
-    if (p->inbox_cnt == 0) return JS_NULL;
-    ProcMsg_t *slot = &p->inbox[p->inbox_r];
-    JSValue ret = JS_NewStringLen(c, slot->data, (size_t)slot->len);
-    p->inbox_r = (p->inbox_r + 1) % JSPROC_MSGSLOTS;
-    p->inbox_cnt--;
-    return ret;
+    JSProc_t *p = _child_self();
+    if (!p) return JS_NULL;
+    return _ipc_ring_recv(c, &p->inbox);
+}
+
+/* Inside a child runtime: kernel.pollMessages(max?) → [msg, …] */
+static JSValue js_proc_poll_msgs(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val;
+    JSProc_t *p = _child_self();
+    if (!p) return JS_NewArray(c);
+    uint32_t max = 0;
+    if (argc >= 1) JS_ToUint32(c, &max, argv[0]);
+    return _ipc_ring_recv_batch(c, &p->inbox, max);
+}
+
+/* Inside a child runtime: kernel.messagesPending() → number waiting in the
+ * inbox.  Reading it clears the inbox doorbell. */
+static JSValue js_proc_msgs_pending(JSContext *c, JSValueConst this_val,
+                                    int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    JSProc_t *p = _child_self();
+    if (!p) return JS_NewInt32(c, 0);
+    __atomic_store_n(&p->inbox.doorbell, 0u, __ATOMIC_RELAXED);
+    return JS_NewInt32(c, (int32_t)ipc_ring_count(&p->inbox));
+}
+
+/* Inside a child runtime: kernel.maxMessageBytes() → largest payload */
+static JSValue js_proc_max_msg(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    JSProc_t *p = _child_self();
+    return JS_NewInt32(c, p ? (int32_t)ipc_ring_max_msg(&p->outbox) : 0);
 }
 
 /* ── Shared buffer accessors (callable from both parent and child) ──────── */
 
-/* kernel.sharedBufferOpen(id) → ArrayBuffer backed by BSS (zero-copy).
- * Works from any runtime — the same physical bytes are visible everywhere. */
+/* kernel.sharedBufferOpen(id) → ArrayBuffer over the region (zero-copy).
+ * Works from any runtime — the same physical bytes are visible everywhere.
+ * The mapping keeps the region alive until the ArrayBuffer is collected. */
 static JSValue js_shared_buf_open(JSContext *c, JSValueConst this_val,
                                    int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 1) return JS_NULL;
-    int32_t id = 0;
+    int32_t id = -1;
     JS_ToInt32(c, &id, argv[0]);
-    if (id < 0 || id >= SHARED_BUF_MAX || !_sbuf_used[id]) return JS_NULL;
-    return JS_NewArrayBuffer(c, _sbufs[id], (size_t)_sbuf_sizes[id],
-                             _sbuf_no_free, NULL, 0);
+    return _shm_map(c, id);
 }
 
-/* kernel.sharedBufferSize(id) → byte length of the slot, or 0. */
+/* kernel.sharedBufferSize(id) → byte length of the region, or 0. */
 static JSValue js_shared_buf_size(JSContext *c, JSValueConst this_val,
                                    int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 1) return JS_NewInt32(c, 0);
-    int32_t id = 0;
+    int32_t id = -1;
+    JS_ToInt32(c, &id, argv[0]);
+    uint32_t size = 0;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot(id);
+    if (slot >= 0) size = _shm[slot].size;
+    smp_spin_unlock(&_shm_lock);
+    return JS_NewUint32(c, size);
+}
+
+/* kernel.sharedBufferCreate(size?) → id or -1 — anonymous region, one hold
+ * for the calling runtime.  Pass the id to another runtime to share it. */
+static JSValue js_shared_buf_create(JSContext *c, JSValueConst this_val,
+                                     int argc, JSValueConst *argv) {
+    (void)this_val;
+    uint32_t size = 4096;
+    if (argc >= 1) JS_ToUint32(c, &size, argv[0]);
+    int slot = _shm_alloc(size, NULL);
+    return JS_NewInt32(c, slot < 0 ? -1 : _shm_id(slot));
+}
+
+/* kernel.sharedBufferRelease(id) — drop one hold of the calling runtime.
+ * Memory is returned once no hold, mapping or pending transfer remains. */
+static JSValue js_shared_buf_release(JSContext *c, JSValueConst this_val,
+                                      int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_FALSE;
+    int32_t id = -1;
+    JS_ToInt32(c, &id, argv[0]);
+    return JS_NewBool(c, _shm_close(id) == 0);
+}
+
+/* kernel.shmCreate(name, size) → id, or -1 if the name exists / no memory */
+static JSValue js_shm_create(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 2) return JS_NewInt32(c, -1);
+    uint32_t size = 0;
+    JS_ToUint32(c, &size, argv[1]);
+    const char *name = JS_ToCString(c, argv[0]);
+    if (!name) return JS_NewInt32(c, -1);
+    int slot = name[0] ? _shm_alloc(size, name) : -1;
+    JS_FreeCString(c, name);
+    return JS_NewInt32(c, slot < 0 ? -1 : _shm_id(slot));
+}
+
+/* kernel.shmOpen(name) → id (takes a hold), or -1 */
+static JSValue js_shm_open(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NewInt32(c, -1);
+    const char *name = JS_ToCString(c, argv[0]);
+    if (!name) return JS_NewInt32(c, -1);
+    int32_t id = -1;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_find_name(name);
+    if (slot >= 0) {
+        _shm[slot].holds[_shm_owner()]++;
+        id = _shm_id(slot);
+    }
+    smp_spin_unlock(&_shm_lock);
+    JS_FreeCString(c, name);
+    return JS_NewInt32(c, id);
+}
+
+/* kernel.shmUnlink(name) → bool — remove the name; existing holds and
+ * mappings stay valid until released. */
+static JSValue js_shm_unlink(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_FALSE;
+    const char *name = JS_ToCString(c, argv[0]);
+    if (!name) return JS_FALSE;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_find_name(name);
+    if (slot >= 0) _shm[slot].name[0] = '\0';
+    smp_spin_unlock(&_shm_lock);
+    JS_FreeCString(c, name);
+    return JS_NewBool(c, slot >= 0);
+}
+
+/* kernel.bufferTransfer(ab) → transfer id, or -1.
+ * Detaches `ab` in the calling runtime; another runtime claims the bytes
+ * with bufferAccept(id).  An ArrayBuffer that is itself a region mapping
+ * (sharedBufferOpen / bufferAccept) moves without copying; any other
+ * ArrayBuffer is copied once into a fresh region. */
+static JSValue js_buffer_transfer(JSContext *c, JSValueConst this_val,
+                                   int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NewInt32(c, -1);
+    size_t len = 0;
+    uint8_t *ptr = JS_GetArrayBuffer(c, &len, argv[0]);
+    if (!ptr) { JS_FreeValue(c, JS_GetException(c)); return JS_NewInt32(c, -1); }
+    int owner = _shm_owner(), found = 0;
+    int32_t id = -1;
+    smp_spin_lock(&_shm_lock);
+    for (int i = 0; i < SHM_MAX; i++) {
+        ShmObj_t *o = &_shm[i];
+        if (!o->used || o->base != ptr || o->size != len || !o->maps[owner]) continue;
+        found = 1;
+        if (!o->xfer) { o->xfer = 1; o->xfer_owner = (uint8_t)owner; id = _shm_id(i); }
+        break;
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (found && id < 0) return JS_NewInt32(c, -1);   /* already in flight */
+    if (!found) {
+        int slot = _shm_alloc((uint32_t)len, NULL);
+        if (slot < 0) return JS_NewInt32(c, -1);
+        memcpy(_shm[slot].base, ptr, len);
+        smp_spin_lock(&_shm_lock);
+        _shm[slot].holds[owner] = 0;
+        _shm[slot].xfer = 1;
+        _shm[slot].xfer_owner = (uint8_t)owner;
+        id = _shm_id(slot);
+        smp_spin_unlock(&_shm_lock);
+    }
+    JS_DetachArrayBuffer(c, argv[0]);
+    return JS_NewInt32(c, id);
+}
+
+/* kernel.bufferAccept(id) → ArrayBuffer, or null if `id` is not a pending
+ * transfer.  The receiving runtime now holds the only reference. */
+static JSValue js_buffer_accept(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NULL;
+    int32_t id = -1;
     JS_ToInt32(c, &id, argv[0]);
-    if (id < 0 || id >= SHARED_BUF_MAX || !_sbuf_used[id]) return JS_NewInt32(c, 0);
-    return JS_NewUint32(c, _sbuf_sizes[id]);
+    int owner = _shm_owner();
+    uint8_t *base = NULL;
+    uint32_t size = 0;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot(id);
+    if (slot >= 0 && _shm[slot].xfer) {
+        _shm[slot].xfer = 0;               /* the transfer ref becomes a mapping */
+        _shm[slot].maps[owner]++;
+        base = _shm[slot].base;
+        size = _shm[slot].size;
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (!base) return JS_NULL;
+    return _shm_wrap(c, owner, id, base, size);
+}
+
+/* kernel.shmList() → [{id, name, size, refs}] */
+static JSValue js_shm_list(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    JSValue arr = JS_NewArray(c);
+    uint32_t n = 0;
+    smp_spin_lock(&_shm_lock);
+    for (int i = 0; i < SHM_MAX; i++) {
+        ShmObj_t *o = &_shm[i];
+        if (!o->used) continue;
+        JSValue e = JS_NewObject(c);
+        JS_SetPropertyStr(c, e, "id",   JS_NewInt32(c, _shm_id(i)));
+        JS_SetPropertyStr(c, e, "name", JS_NewString(c, o->name));
+        JS_SetPropertyStr(c, e, "size", JS_NewUint32(c, o->size));
+        JS_SetPropertyStr(c, e, "refs", JS_NewUint32(c, _shm_refs(o)));
+        JS_SetPropertyUint32(c, arr, n++, e);
+    }
+    smp_spin_unlock(&_shm_lock);
+    return arr;
+}
+
+/* ── io_uring rings ───────────────────────────────────────────────────────
+ *
+ * A ring lives in a shared region the kernel allocates (and keeps one hold
+ * on) so TypeScript can map it with sharedBufferOpen() and write SQEs / read
+ * CQEs with no call at all; uringEnter() is the only transition per batch.
+ * Registered buffers are ordinary shared regions; the ring takes its own
+ * hold on each so a buffer cannot vanish while SQEs still name it.
+ * Main runtime only: the drivers are not safe to enter from an AP.
+ */
+#define URING_RINGS 8
+
+typedef struct {
+    uring_t  u;
+    int      used;
+    int32_t  shm;                        /* ring region id          */
+    int32_t  buf_shm[URING_MAX_BUFS];    /* registered ids, or -1   */
+} URing_t;
+
+static URing_t _urings[URING_RINGS];
+
+static URing_t *_uring_get(JSContext *c, JSValueConst v) {
+    int32_t r = -1;
+    JS_ToInt32(c, &r, v);
+    if (r < 0 || r >= URING_RINGS || !_urings[r].used) return NULL;
+    return &_urings[r];
+}
+
+/* kernel.uringSetup(entries) → {ring, shm, entries, sqeOff, cqeOff} or null.
+ * `entries` is rounded up to a power of two in [8, 4096]; the CQ is twice
+ * as deep.  Map the ring with sharedBufferOpen(shm) — do not release it. */
+static JSValue js_uring_setup(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val;
+    uint32_t want = 64, entries = URING_MIN_ENTRIES;
+    if (argc >= 1) JS_ToUint32(c, &want, argv[0]);
+    if (want > URING_MAX_ENTRIES) want = URING_MAX_ENTRIES;
+    while (entries < want) entries <<= 1u;
+
+    int r = -1;
+    for (int i = 0; i < URING_RINGS; i++)
+        if (!_urings[i].used) { r = i; break; }
+    if (r < 0) return JS_NULL;
+    int slot = _shm_alloc(uring_region_bytes(entries), NULL);
+    if (slot < 0) return JS_NULL;
+
+    URing_t *ur = &_urings[r];
+    uring_setup(&ur->u, _shm[slot].base, entries);
+    ur->used = 1;
+    ur->shm  = _shm_id(slot);
+    for (uint32_t i = 0; i < URING_MAX_BUFS; i++) ur->buf_shm[i] = -1;
+
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "ring",    JS_NewInt32(c, r));
+    JS_SetPropertyStr(c, o, "shm",     JS_NewInt32(c, ur->shm));
+    JS_SetPropertyStr(c, o, "entries", JS_NewUint32(c, entries));
+    JS_SetPropertyStr(c, o, "sqeOff",  JS_NewUint32(c, ur->u.hdr->sqe_off));
+    JS_SetPropertyStr(c, o, "cqeOff",  JS_NewUint32(c, ur->u.hdr->cqe_off));
+    return o;
+}
+
+/* Drop the ring's hold on fixed buffer `idx`, if any. */
+static void _uring_unregister(URing_t *ur, uint32_t idx) {
+    if (ur->buf_shm[idx] >= 0) _shm_close(ur->buf_shm[idx]);
+    ur->buf_shm[idx] = -1;
+    uring_register_buf(&ur->u, idx, NULL, 0);
+}
+
+/* kernel.uringRegisterBuffer(ring, idx, shmId) → bool.
+ * shmId < 0 unregisters slot `idx`. */
+static JSValue js_uring_register_buffer(JSContext *c, JSValueConst this_val,
+                                         int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 3) return JS_FALSE;
+    URing_t *ur = _uring_get(c, argv[0]);
+    uint32_t idx = 0;
+    int32_t id = -1;
+    JS_ToUint32(c, &idx, argv[1]);
+    JS_ToInt32(c, &id, argv[2]);
+    if (!ur || idx >= URING_MAX_BUFS) return JS_FALSE;
+    _uring_unregister(ur, idx);
+    if (id < 0) return JS_TRUE;
+
+    uint8_t *base = NULL;
+    uint32_t size = 0;
+    smp_spin_lock(&_shm_lock);
+    int slot = _shm_slot(id);
+    if (slot >= 0) {
+        _shm[slot].holds[_shm_owner()]++;
+        base = _shm[slot].base;
+        size = _shm[slot].size;
+    }
+    smp_spin_unlock(&_shm_lock);
+    if (!base) return JS_FALSE;
+    ur->buf_shm[idx] = id;
+    uring_register_buf(&ur->u, idx, base, size);
+    return JS_TRUE;
+}
+
+/* kernel.uringEnter(ring, toSubmit) → SQEs consumed, or -1 for a bad ring.
+ * Every consumed SQE has its CQE posted when this returns. */
+static JSValue js_uring_enter(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NewInt32(c, -1);
+    URing_t *ur = _uring_get(c, argv[0]);
+    uint32_t n = 0xFFFFFFFFu;
+    if (argc >= 2) JS_ToUint32(c, &n, argv[1]);
+    if (!ur) return JS_NewInt32(c, -1);
+    return JS_NewUint32(c, uring_enter(&ur->u, n));
+}
+
+/* kernel.uringInfo(ring) → {enters, sqes, driverCalls, sqDropped, cqOverflow} */
+static JSValue js_uring_info(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NULL;
+    URing_t *ur = _uring_get(c, argv[0]);
+    if (!ur) return JS_NULL;
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "enters",      JS_NewUint32(c, ur->u.enters));
+    JS_SetPropertyStr(c, o, "sqes",        JS_NewUint32(c, ur->u.sqes_done));
+    JS_SetPropertyStr(c, o, "driverCalls", JS_NewUint32(c, ur->u.driver_calls));
+    JS_SetPropertyStr(c, o, "sqDropped",   JS_NewUint32(c, ur->u.hdr->sq_dropped));
+    JS_SetPropertyStr(c, o, "cqOverflow",  JS_NewUint32(c, ur->u.hdr->cq_overflow));
+    return o;
+}
+
+/* kernel.uringDestroy(ring) → bool — drops the ring's holds on its region
+ * and every registered buffer; live mappings keep the bytes until GC. */
+static JSValue js_uring_destroy(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_FALSE;
+    URing_t *ur = _uring_get(c, argv[0]);
+    if (!ur) return JS_FALSE;
+    for (uint32_t i = 0; i < URING_MAX_BUFS; i++) _uring_unregister(ur, i);
+    _shm_close(ur->shm);
+    memset(ur, 0, sizeof(*ur));
+    return JS_TRUE;
 }
 
 /* Forward declarations for child-only APIs defined later in this translation unit */
@@ -2071,6 +2928,10 @@ static JSValue js_child_set_interval(JSContext *, JSValueConst, int, JSValueCons
 static JSValue js_child_clear_interval(JSContext *, JSValueConst, int, JSValueConst *);
 static JSValue js_child_poll_event(JSContext *, JSValueConst, int, JSValueConst *);
 static JSValue js_child_window_command(JSContext *, JSValueConst, int, JSValueConst *);
+static JSValue js_jpeg_idct(JSContext *, JSValueConst, int, JSValueConst *);
+static JSValue js_jpeg_color(JSContext *, JSValueConst, int, JSValueConst *);
+static JSValue js_png_unfilter(JSContext *, JSValueConst, int, JSValueConst *);
+static JSValue js_span_blend(JSContext *, JSValueConst, int, JSValueConst *);
 
 /* Minimal kernel API exposed inside child runtimes */
 static const JSCFunctionListEntry js_child_kernel_funcs[] = {
@@ -2081,10 +2942,25 @@ static const JSCFunctionListEntry js_child_kernel_funcs[] = {
     JS_CFUNC_DEF("getMemoryInfo",   0, js_mem_info),
     JS_CFUNC_DEF("heapStats",      0, js_heap_stats),
     JS_CFUNC_DEF("postMessage",     1, js_proc_post_msg),
+    JS_CFUNC_DEF("postMessages",    1, js_proc_post_msgs),
     JS_CFUNC_DEF("pollMessage",     0, js_proc_poll_msg),
+    JS_CFUNC_DEF("pollMessages",    1, js_proc_poll_msgs),
+    JS_CFUNC_DEF("messagesPending", 0, js_proc_msgs_pending),
+    JS_CFUNC_DEF("maxMessageBytes", 0, js_proc_max_msg),
     /* Shared memory — same physical bytes as parent */
-    JS_CFUNC_DEF("sharedBufferOpen", 1, js_shared_buf_open),
-    JS_CFUNC_DEF("sharedBufferSize", 1, js_shared_buf_size),
+    JS_CFUNC_DEF("sharedBufferOpen",    1, js_shared_buf_open),
+    JS_CFUNC_DEF("sharedBufferSize",    1, js_shared_buf_size),
+    JS_CFUNC_DEF("sharedBufferCreate",  1, js_shared_buf_create),
+    JS_CFUNC_DEF("sharedBufferRelease", 1, js_shared_buf_release),
+    JS_CFUNC_DEF("shmCreate",           2, js_shm_create),
+    JS_CFUNC_DEF("shmOpen",             1, js_shm_open),
+    JS_CFUNC_DEF("shmUnlink",           1, js_shm_unlink),
+    JS_CFUNC_DEF("bufferTransfer",      1, js_buffer_transfer),
+    JS_CFUNC_DEF("bufferAccept",        1, js_buffer_accept),
+    /* Image decode kernels for the browser's decode pool */
+    JS_CFUNC_DEF("jpegIdct",            8, js_jpeg_idct),
+    JS_CFUNC_DEF("jpegColor",          11, js_jpeg_color),
+    JS_CFUNC_DEF("pngUnfilter",         8, js_png_unfilter),
     /* Phase A/B: render surface + dimensions */
     JS_CFUNC_DEF("getRenderBuffer", 0, js_child_get_render_buf),
     JS_CFUNC_DEF("getWidth",        0, js_child_get_width),
@@ -2106,19 +2982,11 @@ static const JSCFunctionListEntry js_child_kernel_funcs[] = {
     JS_CFUNC_DEF("windowCommand",   1, js_child_window_command),
 };
 
-/* kernel.procCreate() → id (0-7) or -1 if all slots are occupied */
-static JSValue js_proc_create(JSContext *c, JSValueConst this_val,
-                               int argc, JSValueConst *argv) {
-    (void)this_val; (void)argc; (void)argv;
-    int id = -1;
-    for (int i = 0; i < JSPROC_MAX; i++)
-        if (!_procs[i].used) { id = i; break; }
-    if (id < 0) return JS_NewInt32(c, -1);
-    JSProc_t *p = &_procs[id];
-    memset(p, 0, sizeof(*p));
-    p->rt = JS_NewRuntime2(&jsos_malloc_funcs, NULL);
-    if (!p->rt) return JS_NewInt32(c, -1);
-    JS_SetMemoryLimit(p->rt, 1u * 1024u * 1024u * 1024u); /* 1 GB per child.
+/* Limits, context and child-side globals (kernel API, console, Date) for a
+ * new child runtime — shared by procCreate and zygoteCreate.  Returns the
+ * context, or NULL. */
+static JSContext *_proc_new_context(JSRuntime *r) {
+    JS_SetMemoryLimit(r, 1u * 1024u * 1024u * 1024u); /* 1 GB per child.
                                                     * Covers heavy tabs: Gmail, Google Docs,
                                                     * Maps, SPAs, video editors (100 MB–1 GB).
                                                     * Hard ceiling on 32-bit i686: x86 without
@@ -2132,25 +3000,25 @@ static JSValue js_proc_create(JSContext *c, JSValueConst this_val,
                                                     * (~1-1.3 GB real peak). If sbrk exhausts
                                                     * the window, that child gets ENOMEM —
                                                     * kernel continues unaffected. */
-    JS_SetGCThreshold(p->rt, 64u * 1024u * 1024u);  /* GC at 64 MB — on 32-bit i686, 256 MB
+    JS_SetGCThreshold(r, 64u * 1024u * 1024u);  /* GC at 64 MB — on 32-bit i686, 256 MB
                                                     * allowed massive garbage accumulation that
                                                     * made GC cycles slow and increased the
                                                     * window for heap corruption.  64 MB keeps
                                                     * the live set compact while still giving
                                                     * headroom for React/Vue reconciliation. */
-    JS_SetMaxStackSize(p->rt, 512 * 1024);        /* 512 KB — deep component trees (React,
+    JS_SetMaxStackSize(r, 512 * 1024);        /* 512 KB — deep component trees (React,
                                                     * Angular), recursive HTML parser, deeply
                                                     * nested JS eval all need headroom. */
-    p->ctx = JS_NewContext(p->rt);
-    if (!p->ctx) { JS_FreeRuntime(p->rt); p->rt = NULL; return JS_NewInt32(c, -1); }
+    JSContext *x = JS_NewContext(r);
+    if (!x) return NULL;
     /* Inject minimal child kernel API */
-    JSValue global = JS_GetGlobalObject(p->ctx);
-    JSValue kobj   = JS_NewObject(p->ctx);
-    JS_SetPropertyFunctionList(p->ctx, kobj, js_child_kernel_funcs,
+    JSValue global = JS_GetGlobalObject(x);
+    JSValue kobj   = JS_NewObject(x);
+    JS_SetPropertyFunctionList(x, kobj, js_child_kernel_funcs,
         sizeof(js_child_kernel_funcs) / sizeof(js_child_kernel_funcs[0]));
-    JS_SetPropertyStr(p->ctx, global, "kernel", kobj);
+    JS_SetPropertyStr(x, global, "kernel", kobj);
     /* Inject console stub so child code can use console.log() */
-    JS_Eval(p->ctx,
+    JS_Eval(x,
         "var console={log:function(){var a=Array.prototype.slice.call(arguments);"
         "kernel.serialPut(a.join(' '));},"
         "error:function(){var a=Array.prototype.slice.call(arguments);"
@@ -2165,26 +3033,36 @@ static JSValue js_proc_create(JSContext *c, JSValueConst this_val,
         "kernel.serialPut('[W] '+a.join(' '));}}"),
         "<boot>", JS_EVAL_TYPE_GLOBAL);
     /* Inject Date.now() using kernel uptime */
-    JS_Eval(p->ctx,
+    JS_Eval(x,
         "var Date={now:function(){return kernel.getUptime();}}",
         strlen("var Date={now:function(){return kernel.getUptime();}}"),
         "<boot>", JS_EVAL_TYPE_GLOBAL);
-    JS_FreeValue(p->ctx, global);
+    JS_FreeValue(x, global);
+    return x;
+}
+
+/* Per-slot state for child `id` once p->rt / p->ctx are in place. */
+static void _proc_slot_init(int id) {
+    JSProc_t *p = &_procs[id];
     /* Initialise per-proc BSS state */
     memset(&_proc_timers[id], 0, sizeof(_proc_timers[id]));
     memset(&_proc_event_queues[id], 0, sizeof(_proc_event_queues[id]));
     memset(&_proc_wincmds[id], 0, sizeof(_proc_wincmds[id]));
     _proc_timer_next_id[id] = 0;
-    _procs[id].width  = 0;
-    _procs[id].height = 0;
+    p->width  = 0;
+    p->height = 0;
     /* Arm the time-slice interrupt handler on the child runtime.
      * _proc_interrupt_cb uses the proc id (passed as opaque) to read
      * the per-child slice_deadline from JSProc_t. */
+    uint32_t cr3 = _proc_pd_enter(id);
     JS_SetInterruptHandler(p->rt, _proc_interrupt_cb, (void *)(intptr_t)id);
+    _proc_pd_leave(cr3);
     /* Arm the JIT hook so hot functions in the child defer compilation to
-     * the main-runtime tick loop (procPendingJIT / _serviceChildJIT).     */
+     * the main-runtime tick loop (procPendingJIT / _serviceChildJIT).
+     * Zygote clones run interpreted: their bytecode lives in a private
+     * directory the BSP-side JIT service cannot see. */
 #ifdef JSOS_JIT_HOOK
-    JS_SetJITHook(p->rt, _jit_hook_child);
+    if (!p->pd) JS_SetJITHook(p->rt, _jit_hook_child);
 #endif
     /* Reset any leftover JIT allocation slab for this slot */
     jit_proc_reset(id);
@@ -2192,11 +3070,223 @@ static JSValue js_proc_create(JSContext *c, JSValueConst this_val,
     p->used = 1;
     p->tainted = 0;
     p->slice_deadline = 0;
-    return JS_NewInt32(c, id);
 }
 
-/* kernel.procEval(id, code) → result string (or error string on exception) */
-static JSValue js_proc_eval(JSContext *c, JSValueConst this_val,
+/* kernel.procCreate(ringBytes?) → id (0-15) or -1 if all slots are occupied.
+ * ringBytes sizes each IPC ring (default IPC_RING_DEFAULT_BYTES); the
+ * largest single message is half of it. */
+static JSValue js_proc_create(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val;
+    int id = -1;
+    for (int i = 0; i < JSPROC_MAX; i++)
+        if (!_procs[i].used) { id = i; break; }
+    if (id < 0) return JS_NewInt32(c, -1);
+    uint32_t ring_bytes = IPC_RING_DEFAULT_BYTES;
+    if (argc >= 1 && JS_IsNumber(argv[0])) {
+        int32_t rb = 0;
+        JS_ToInt32(c, &rb, argv[0]);
+        if (rb > 0) ring_bytes = (uint32_t)rb;
+    }
+    JSProc_t *p = &_procs[id];
+    memset(p, 0, sizeof(*p));
+    if (ipc_ring_init(&p->inbox, ring_bytes) < 0) return JS_NewInt32(c, -1);
+    if (ipc_ring_init(&p->outbox, ring_bytes) < 0) {
+        ipc_ring_free(&p->inbox);
+        return JS_NewInt32(c, -1);
+    }
+    p->rt = JS_NewRuntime2(&jsos_malloc_funcs, NULL);
+    if (!p->rt) {
+        ipc_ring_free(&p->inbox); ipc_ring_free(&p->outbox);
+        return JS_NewInt32(c, -1);
+    }
+    p->ctx = _proc_new_context(p->rt);
+    if (!p->ctx) {
+        JS_FreeRuntime(p->rt); p->rt = NULL;
+        ipc_ring_free(&p->inbox); ipc_ring_free(&p->outbox);
+        return JS_NewInt32(c, -1);
+    }
+    _proc_slot_init(id);
+    return JS_NewInt32(c, id);
+}
+
+/* ── Zygote runtimes ─────────────────────────────────────────────────────
+ *
+ * kernel.zygoteCreate(code) → zygote id (0-3), or -1
+ *   Builds a child runtime inside its own page directory with every
+ *   allocation in the fixed arena window (zygote.h), runs `code` and its
+ *   pending jobs, collects garbage and freezes the result.  -1 when paging
+ *   is off, slots are exhausted or `code` throws.
+ * kernel.zygoteSpawn(zid, ringBytes?) → child id (same space as procCreate)
+ *   A new directory that shares the frozen arena copy-on-write.  The child
+ *   starts with everything `code` built; nothing is re-evaluated.
+ * kernel.zygoteDestroy(zid) — drop the zygote; spawned children keep the
+ *   frames they share with it.
+ * kernel.zygoteInfo(zid) → {pages, usedBytes, spawns} or null
+ */
+typedef struct {
+    uint8_t    used;
+    uint32_t  *pd;
+    JSRuntime *rt;
+    JSContext *ctx;
+    uint32_t   pages;         /* mapped arena pages — the range clones share */
+    uint32_t   used_bytes;
+    uint32_t   spawns;
+} Zygote_t;
+
+static Zygote_t _zygotes[ZYGOTE_MAX];
+
+static JSValue js_zygote_create(JSContext *c, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NewInt32(c, -1);
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    if (!(cr0 & 0x80000000u)) return JS_NewInt32(c, -1);   /* needs paging */
+    int zid = -1;
+    for (int i = 0; i < ZYGOTE_MAX; i++)
+        if (!_zygotes[i].used) { zid = i; break; }
+    if (zid < 0) return JS_NewInt32(c, -1);
+    uint32_t *pd = _pd_alloc(PD_USED_KERNEL);
+    if (!pd) return JS_NewInt32(c, -1);
+    const char *code = JS_ToCString(c, argv[0]);
+    if (!code) { _pd_free(pd); return JS_NewInt32(c, -1); }
+
+    Zygote_t *z = &_zygotes[zid];
+    memset(z, 0, sizeof(*z));
+    int ok = 0;
+    uint32_t cr3 = _cr3_read();
+    /* Arm fault recovery — save/restore for nesting */
+    jmp_buf _saved_fault_buf;
+    int _saved_fault_active = _js_fault_active;
+    memcpy(_saved_fault_buf, _js_fault_buf, sizeof(jmp_buf));
+    _js_fault_active = 1;
+    _js_fault_vector = 0;
+    if (setjmp(_js_fault_buf) != 0) {
+        __asm__ volatile("sti");
+        _js_fault_active = _saved_fault_active;
+        memcpy(_js_fault_buf, _saved_fault_buf, sizeof(jmp_buf));
+        _cr3_load(cr3);
+        _pd_free(pd);
+        platform_serial_puts("[kernel] zygoteCreate: CPU fault during start-up\n");
+        return JS_NewInt32(c, -1);
+    }
+    _cr3_load((uint32_t)(uintptr_t)pd);
+    if (zy_arena_init() == 0)
+        z->rt = JS_NewRuntime2(&zy_malloc_funcs, zy_arena_opaque());
+    if (z->rt) z->ctx = _proc_new_context(z->rt);
+    if (z->ctx) {
+        JS_SetMemoryLimit(z->rt, ZYGOTE_VA_SIZE);
+        JS_UpdateStackTop(z->rt);
+        JSValue r = JS_Eval(z->ctx, code, strlen(code), "<zygote>", JS_EVAL_TYPE_GLOBAL);
+        ok = !JS_IsException(r);
+        JS_FreeValue(z->ctx, r);
+        JSContext *job_ctx = NULL;
+        while (ok && JS_ExecutePendingJob(z->rt, &job_ctx) > 0) {}
+        JS_RunGC(z->rt);
+        z->pages      = zy_arena_pages();
+        z->used_bytes = zy_arena_used();
+    }
+    _cr3_load(cr3);
+    _js_fault_active = _saved_fault_active;
+    memcpy(_js_fault_buf, _saved_fault_buf, sizeof(jmp_buf));
+    JS_FreeCString(c, code);
+    if (!ok) {
+        _pd_free(pd);                       /* the whole heap goes with it */
+        return JS_NewInt32(c, -1);
+    }
+    z->pd   = pd;
+    z->used = 1;
+    return JS_NewInt32(c, zid);
+}
+
+static Zygote_t *_zygote_arg(JSContext *c, JSValueConst v) {
+    int32_t zid = -1;
+    JS_ToInt32(c, &zid, v);
+    if (zid < 0 || zid >= ZYGOTE_MAX || !_zygotes[zid].used) return NULL;
+    return &_zygotes[zid];
+}
+
+static JSValue js_zygote_spawn(JSContext *c, JSValueConst this_val,
+                               int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NewInt32(c, -1);
+    Zygote_t *z = _zygote_arg(c, argv[0]);
+    if (!z) return JS_NewInt32(c, -1);
+    int id = -1;
+    for (int i = 0; i < JSPROC_MAX; i++)
+        if (!_procs[i].used) { id = i; break; }
+    if (id < 0) return JS_NewInt32(c, -1);
+    uint32_t ring_bytes = IPC_RING_DEFAULT_BYTES;
+    if (argc >= 2 && JS_IsNumber(argv[1])) {
+        int32_t rb = 0;
+        JS_ToInt32(c, &rb, argv[1]);
+        if (rb > 0) ring_bytes = (uint32_t)rb;
+    }
+    JSProc_t *p = &_procs[id];
+    memset(p, 0, sizeof(*p));
+    uint32_t *pd = _pd_alloc(PD_USED_KERNEL);
+    if (!pd) return JS_NewInt32(c, -1);
+    if (pt_clone_cow(pd, z->pd, ZYGOTE_VA_BASE, z->pages) < 0) {
+        _pd_free(pd);
+        return JS_NewInt32(c, -1);
+    }
+    if (ipc_ring_init(&p->inbox, ring_bytes) < 0) { _pd_free(pd); return JS_NewInt32(c, -1); }
+    if (ipc_ring_init(&p->outbox, ring_bytes) < 0) {
+        ipc_ring_free(&p->inbox);
+        _pd_free(pd);
+        return JS_NewInt32(c, -1);
+    }
+    p->rt  = z->rt;                         /* same addresses in every clone */
+    p->ctx = z->ctx;
+    p->pd  = pd;
+    _proc_slot_init(id);
+    z->spawns++;
+    return JS_NewInt32(c, id);
+}
+
+static JSValue js_zygote_destroy(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_FALSE;
+    Zygote_t *z = _zygote_arg(c, argv[0]);
+    if (!z) return JS_FALSE;
+    _pd_free(z->pd);
+    memset(z, 0, sizeof(*z));
+    return JS_TRUE;
+}
+
+static JSValue js_zygote_info(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NULL;
+    Zygote_t *z = _zygote_arg(c, argv[0]);
+    if (!z) return JS_NULL;
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "pages",     JS_NewUint32(c, z->pages));
+    JS_SetPropertyStr(c, o, "usedBytes", JS_NewUint32(c, z->used_bytes));
+    JS_SetPropertyStr(c, o, "spawns",    JS_NewUint32(c, z->spawns));
+    return o;
+}
+
+/* Main-side bindings that run child argv[0]'s JS go through here so the
+ * child's directory is in CR3 for the whole call, result marshalling
+ * included (zygote clones). */
+typedef JSValue (*_proc_fn_t)(JSContext *, JSValueConst, int, JSValueConst *);
+static JSValue _proc_call_in(_proc_fn_t fn, JSContext *c, JSValueConst this_val,
+                             int argc, JSValueConst *argv) {
+    int32_t id = -1;
+    if (argc >= 1) JS_ToInt32(c, &id, argv[0]);
+    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used || !_procs[id].pd || _proc_on_ap(id))
+        return fn(c, this_val, argc, argv);
+    uint32_t cr3 = _proc_pd_enter(id);
+    JSValue r = fn(c, this_val, argc, argv);
+    _proc_pd_leave(cr3);
+    return r;
+}
+
+/* kernel.procEval(id, code) → result string (or error string on exception) */
+static JSValue _proc_eval_in(JSContext *c, JSValueConst this_val,
                              int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 2) return JS_NewString(c, "undefined");
@@ -2206,6 +3296,7 @@ static JSValue js_proc_eval(JSContext *c, JSValueConst this_val,
         return JS_NewString(c, "Error: invalid process id");
     /* Tainted children must not execute — heap is corrupted from a prior fault */
     if (_procs[id].tainted) return JS_NewString(c, "Error: tainted child runtime");
+    if (_proc_on_ap(id)) return JS_NewString(c, "Error: child is running on another CPU");
     const char *code = JS_ToCString(c, argv[1]);
     if (!code) return JS_NewString(c, "undefined");
 
@@ -2264,8 +3355,14 @@ static JSValue js_proc_eval(JSContext *c, JSValueConst this_val,
     return ret;
 }
 
+/* kernel.procEval(id, code) */
+static JSValue js_proc_eval(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    return _proc_call_in(_proc_eval_in, c, this_val, argc, argv);
+}
+
 /* kernel.procTick(id) → number of pending async jobs executed */
-static JSValue js_proc_tick(JSContext *c, JSValueConst this_val,
+static JSValue _proc_tick_in(JSContext *c, JSValueConst this_val,
                              int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 1) return JS_NewInt32(c, 0);
@@ -2274,6 +3371,7 @@ static JSValue js_proc_tick(JSContext *c, JSValueConst this_val,
     if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_NewInt32(c, 0);
     /* Tainted children must not execute — heap is corrupted from a prior fault */
     if (_procs[id].tainted) return JS_NewInt32(c, -1);
+    if (_proc_on_ap(id)) return JS_NewInt32(c, 0);   /* the AP drains its own jobs */
     /* Arm fault recovery — save/restore for nesting */
     jmp_buf _saved_fault_buf;
     int _saved_fault_active = _js_fault_active;
@@ -2310,45 +3408,89 @@ static JSValue js_proc_tick(JSContext *c, JSValueConst this_val,
     return JS_NewInt32(c, count);
 }
 
-/* kernel.procSend(id, msg) → bool — push string message into child inbox */
+/* kernel.procTick(id) */
+static JSValue js_proc_tick(JSContext *c, JSValueConst this_val,
+                            int argc, JSValueConst *argv) {
+    return _proc_call_in(_proc_tick_in, c, this_val, argc, argv);
+}
+
+static JSProc_t *_proc_arg(JSContext *c, int argc, JSValueConst *argv) {
+    if (argc < 1) return NULL;
+    int32_t id = 0;
+    JS_ToInt32(c, &id, argv[0]);
+    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return NULL;
+    return &_procs[id];
+}
+
+/* kernel.procSend(id, msg) → bool — push a string / ArrayBuffer / typed
+ * array into the child inbox.  false = full (retry) or too large. */
 static JSValue js_proc_send(JSContext *c, JSValueConst this_val,
                              int argc, JSValueConst *argv) {
     (void)this_val;
-    if (argc < 2) return JS_FALSE;
-    int32_t id = 0;
-    JS_ToInt32(c, &id, argv[0]);
-    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_FALSE;
-    JSProc_t *p = &_procs[id];
-    if (p->inbox_cnt >= JSPROC_MSGSLOTS) return JS_FALSE;
-    const char *msg = JS_ToCString(c, argv[1]);
-    if (!msg) return JS_FALSE;
-    ProcMsg_t *slot = &p->inbox[p->inbox_w];
-    int n = (int)strlen(msg);
-    if (n >= JSPROC_MSGSIZE) n = JSPROC_MSGSIZE - 1;
-    memcpy(slot->data, msg, (size_t)n);
-    slot->data[n] = '\0';
-    slot->len = n;
-    JS_FreeCString(c, msg);
-    p->inbox_w = (p->inbox_w + 1) % JSPROC_MSGSLOTS;
-    p->inbox_cnt++;
-    return JS_TRUE;
+    JSProc_t *p = _proc_arg(c, argc, argv);
+    if (!p || argc < 2) return JS_FALSE;
+    return JS_NewBool(c, _ipc_ring_send(c, &p->inbox, argv[1]) == 0);
 }
 
-/* kernel.procRecv(id) → string from child outbox, or null if empty */
+/* kernel.procSendBatch(id, [msg, …]) → number queued (stops when full) */
+static JSValue js_proc_send_batch(JSContext *c, JSValueConst this_val,
+                                   int argc, JSValueConst *argv) {
+    (void)this_val;
+    JSProc_t *p = _proc_arg(c, argc, argv);
+    if (!p || argc < 2) return JS_NewInt32(c, 0);
+    return JS_NewInt32(c, _ipc_ring_send_array(c, &p->inbox, argv[1]));
+}
+
+/* kernel.procRecv(id) → string | ArrayBuffer from child outbox, or null */
 static JSValue js_proc_recv(JSContext *c, JSValueConst this_val,
                              int argc, JSValueConst *argv) {
     (void)this_val;
-    if (argc < 1) return JS_NULL;
-    int32_t id = 0;
-    JS_ToInt32(c, &id, argv[0]);
-    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_NULL;
-    JSProc_t *p = &_procs[id];
-    if (p->outbox_cnt == 0) return JS_NULL;
-    ProcMsg_t *slot = &p->outbox[p->outbox_r];
-    JSValue ret = JS_NewStringLen(c, slot->data, (size_t)slot->len);
-    p->outbox_r = (p->outbox_r + 1) % JSPROC_MSGSLOTS;
-    p->outbox_cnt--;
-    return ret;
+    JSProc_t *p = _proc_arg(c, argc, argv);
+    if (!p) return JS_NULL;
+    return _ipc_ring_recv(c, &p->outbox);
+}
+
+/* kernel.procRecvBatch(id, max?) → [msg, …] drained in one pass */
+static JSValue js_proc_recv_batch(JSContext *c, JSValueConst this_val,
+                                   int argc, JSValueConst *argv) {
+    (void)this_val;
+    JSProc_t *p = _proc_arg(c, argc, argv);
+    if (!p) return JS_NewArray(c);
+    uint32_t max = 0;
+    if (argc >= 2) JS_ToUint32(c, &max, argv[1]);
+    return _ipc_ring_recv_batch(c, &p->outbox, max);
+}
+
+/* kernel.procDoorbell() → bitmask of children that posted since the last
+ * call (bit i = proc id i).  Lets the scheduler skip idle outboxes instead
+ * of polling every child each tick. */
+static JSValue js_proc_doorbell(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    uint32_t mask = 0;
+    for (int i = 0; i < JSPROC_MAX; i++) {
+        if (!_procs[i].used) continue;
+        if (__atomic_exchange_n(&_procs[i].outbox.doorbell, 0u, __ATOMIC_ACQ_REL))
+            mask |= 1u << i;
+    }
+    return JS_NewUint32(c, mask);
+}
+
+/* kernel.procRingInfo(id) → {size, maxMessage, inCount, inBytes, outCount,
+ * outBytes} or null */
+static JSValue js_proc_ring_info(JSContext *c, JSValueConst this_val,
+                                  int argc, JSValueConst *argv) {
+    (void)this_val;
+    JSProc_t *p = _proc_arg(c, argc, argv);
+    if (!p) return JS_NULL;
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "size",       JS_NewUint32(c, p->inbox.size));
+    JS_SetPropertyStr(c, o, "maxMessage", JS_NewUint32(c, ipc_ring_max_msg(&p->inbox)));
+    JS_SetPropertyStr(c, o, "inCount",    JS_NewUint32(c, ipc_ring_count(&p->inbox)));
+    JS_SetPropertyStr(c, o, "inBytes",    JS_NewUint32(c, ipc_ring_used(&p->inbox)));
+    JS_SetPropertyStr(c, o, "outCount",   JS_NewUint32(c, ipc_ring_count(&p->outbox)));
+    JS_SetPropertyStr(c, o, "outBytes",   JS_NewUint32(c, ipc_ring_used(&p->outbox)));
+    return o;
 }
 
 /* kernel.procDestroy(id) — free the child runtime and release the slot */
@@ -2359,7 +3501,27 @@ static JSValue js_proc_destroy(JSContext *c, JSValueConst this_val,
     int32_t id = 0;
     JS_ToInt32(c, &id, argv[0]);
     if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_UNDEFINED;
-    if (_procs[id].tainted) {
+    /* Cannot free a runtime an AP is executing; the caller retries once
+     * procRunResult() has reported completion. */
+    if (_proc_on_ap(id)) return JS_FALSE;
+    int was_tainted = _procs[id].tainted;
+    if (_procs[id].pd) {
+        /* Zygote clone: the heap is private pages in its own directory, so
+         * dropping the directory frees the runtime wholesale — no
+         * finalizers run, hence shared-memory maps are cleared as for a
+         * tainted child. */
+        for (int i = 0; i < MAX_TIMERS; i++)
+            _proc_timers[id][i].active = 0;
+        _pd_free(_procs[id].pd);
+        ipc_ring_free(&_procs[id].inbox);
+        ipc_ring_free(&_procs[id].outbox);
+        _procs[id].pd   = NULL;
+        _procs[id].ctx  = NULL;
+        _procs[id].rt   = NULL;
+        _procs[id].used = 0;
+        _procs[id].tainted = 0;
+        was_tainted = 1;
+    } else if (was_tainted) {
         /* Child heap is corrupted — do NOT call JS_FreeValue/JS_FreeContext/
          * JS_FreeRuntime, as those walk corrupted object graphs and crash.
          * Intentionally leak the runtime (one-time per-crash cost). */
@@ -2369,6 +3531,10 @@ static JSValue js_proc_destroy(JSContext *c, JSValueConst this_val,
         _procs[id].rt   = NULL;
         _procs[id].used = 0;
         _procs[id].tainted = 0;
+        /* Rings live on the shared heap next to the corrupted runtime —
+         * leak them too rather than trust the neighbouring chunk headers. */
+        memset(&_procs[id].inbox,  0, sizeof(_procs[id].inbox));
+        memset(&_procs[id].outbox, 0, sizeof(_procs[id].outbox));
         platform_serial_puts("[kernel] procDestroy: tainted child leaked\n");
     } else {
         /* Free timer callbacks BEFORE FreeContext so JSValues are still valid */
@@ -2381,10 +3547,14 @@ static JSValue js_proc_destroy(JSContext *c, JSValueConst this_val,
         }
         JS_FreeContext(_procs[id].ctx);
         JS_FreeRuntime(_procs[id].rt);
+        ipc_ring_free(&_procs[id].inbox);
+        ipc_ring_free(&_procs[id].outbox);
         _procs[id].ctx  = NULL;
         _procs[id].rt   = NULL;
         _procs[id].used = 0;
     }
+    /* Drop the child's shared-memory holds (its mappings went with the GC) */
+    _shm_release_proc(id, was_tainted);
     /* Clear JIT slab + pending requests for this slot */
     _jit_proc_pending[id].pending = 0;
     _jit_proc_pending[id].bc_addr = 0;
@@ -2406,7 +3576,7 @@ static JSValue js_proc_alive(JSContext *c, JSValueConst this_val,
     return JS_NewBool(c, _procs[id].used);
 }
 
-/* kernel.procList() → [{id, inboxCount, outboxCount}, ...] */
+/* kernel.procList() → [{id, inboxCount, outboxCount, cpu}, ...] */
 static JSValue js_proc_list(JSContext *c, JSValueConst this_val,
                              int argc, JSValueConst *argv) {
     (void)this_val; (void)argc; (void)argv;
@@ -2416,8 +3586,12 @@ static JSValue js_proc_list(JSContext *c, JSValueConst this_val,
         if (!_procs[i].used) continue;
         JSValue obj = JS_NewObject(c);
         JS_SetPropertyStr(c, obj, "id",          JS_NewInt32(c, i));
-        JS_SetPropertyStr(c, obj, "inboxCount",  JS_NewInt32(c, _procs[i].inbox_cnt));
-        JS_SetPropertyStr(c, obj, "outboxCount", JS_NewInt32(c, _procs[i].outbox_cnt));
+        JS_SetPropertyStr(c, obj, "inboxCount",
+            JS_NewInt32(c, (int32_t)ipc_ring_count(&_procs[i].inbox)));
+        JS_SetPropertyStr(c, obj, "outboxCount",
+            JS_NewInt32(c, (int32_t)ipc_ring_count(&_procs[i].outbox)));
+        JS_SetPropertyStr(c, obj, "cpu",
+            JS_NewInt32(c, _proc_on_ap(i) ? (int)_procs[i].ap_cpu : 0));
         JS_SetPropertyUint32(c, arr, (uint32_t)idx++, obj);
         JS_FreeValue(c, obj);
     }
@@ -2439,7 +3613,7 @@ static JSValue js_proc_list(JSContext *c, JSValueConst this_val,
  *
  * maxMs ≤ 0 disables the deadline (equivalent to procEval).
  */
-static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
+static JSValue _proc_eval_slice_in(JSContext *c, JSValueConst this_val,
                                    int argc, JSValueConst *argv) {
     (void)this_val;
     if (argc < 2) return JS_NewString(c, "done:undefined");
@@ -2450,6 +3624,8 @@ static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
         return JS_NewString(c, "error:invalid process id");
     if (_procs[id].tainted)
         return JS_NewString(c, "error:child runtime quarantined after fault");
+    if (_proc_on_ap(id))
+        return JS_NewString(c, "error:child is running on another CPU");
     const char *code = JS_ToCString(c, argv[1]);
     if (!code) return JS_NewString(c, "error:null code");
     /* Arm fault recovery — save/restore for nesting */
@@ -2497,12 +3673,12 @@ static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
         if (is_timeout) {
             ret = JS_NewString(c, "timeout");
         } else {
-            static char _es[JSPROC_MSGSIZE + 8];
+            static char _es[JSPROC_RESULT_MAX + 8];
             _es[0]='e';_es[1]='r';_es[2]='r';_es[3]='o';_es[4]='r';_es[5]=':';
             int n = 6;
             if (err) {
                 int el = (int)strlen(err);
-                if (el > JSPROC_MSGSIZE) el = JSPROC_MSGSIZE;
+                if (el > JSPROC_RESULT_MAX) el = JSPROC_RESULT_MAX;
                 memcpy(_es + 6, err, (size_t)el); n += el;
             }
             _es[n] = '\0';
@@ -2518,12 +3694,12 @@ static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
         return JS_NewString(c, "done:undefined");
     }
     const char *str = JS_ToCString(_procs[id].ctx, result);
-    static char _rs[JSPROC_MSGSIZE + 8];
+    static char _rs[JSPROC_RESULT_MAX + 8];
     _rs[0]='d';_rs[1]='o';_rs[2]='n';_rs[3]='e';_rs[4]=':';
     int sn = 5;
     if (str) {
         int sl = (int)strlen(str);
-        if (sl > JSPROC_MSGSIZE) sl = JSPROC_MSGSIZE;
+        if (sl > JSPROC_RESULT_MAX) sl = JSPROC_RESULT_MAX;
         memcpy(_rs + 5, str, (size_t)sl); sn += sl;
         JS_FreeCString(_procs[id].ctx, str);
     }
@@ -2532,42 +3708,170 @@ static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
     return JS_NewString(c, _rs);
 }
 
-/* ── Phase 10: Shared buffer create / release (parent only) ──────────────
+/* kernel.procEvalSlice(id, code, maxMs) */
+static JSValue js_proc_eval_slice(JSContext *c, JSValueConst this_val,
+                                  int argc, JSValueConst *argv) {
+    return _proc_call_in(_proc_eval_slice_in, c, this_val, argc, argv);
+}
+
+/* ── SMP: run a child runtime on an application processor (item 31) ─────
  *
- * kernel.sharedBufferCreate(size?) → id (0-7) or -1
- * Allocates a BSS slab.  size is clamped to SHARED_BUF_BYTES (256 KB).
- * Both parent and child call sharedBufferOpen(id) to get their ArrayBuffer.
+ * kernel.procRunOn(id, cpu, code, maxMs?) → CPU index the eval was queued
+ *   on, or -1.  cpu ≤ 0 picks the least-loaded AP.  The child's runtime is
+ *   owned by that AP until the result is collected: the BSP-side procEval /
+ *   procTick / serviceTimers / procDestroy back off while it is queued or
+ *   running.  After the eval the AP drains the child's pending jobs, so
+ *   promise continuations run on the same CPU.
+ * kernel.procRunResult(id) → null while queued/running, otherwise the same
+ *   "done:…" / "error:…" / "timeout" string procEvalSlice returns; collecting
+ *   it returns the child to the BSP.
+ *
+ * Each child is an isolated QuickJS runtime, so APs never share JS heaps;
+ * the only shared structures are the newlib heap (spin-locked in
+ * syscalls.c) and the IPC rings (ipc_ring.h, lock-free SPSC).
  */
-static JSValue js_shared_buf_create(JSContext *c, JSValueConst this_val,
-                                     int argc, JSValueConst *argv) {
+static void _proc_ap_fmt(JSProc_t *p, const char *prefix, const char *text) {
+    size_t pl = strlen(prefix), tl = text ? strlen(text) : 0u;
+    if (tl > JSPROC_RESULT_MAX) tl = JSPROC_RESULT_MAX;
+    memcpy(p->ap_result, prefix, pl);
+    if (tl) memcpy(p->ap_result + pl, text, tl);
+    p->ap_result[pl + tl] = '\0';
+}
+
+/* Runs on the AP (smp_work_fn_t). */
+static void _proc_ap_job(void *arg) {
+    int id = (int)(intptr_t)arg;
+    JSProc_t *p = &_procs[id];
+    __atomic_store_n(&p->ap_state, JSPROC_AP_RUNNING, __ATOMIC_RELEASE);
+    uint32_t cr3 = _proc_pd_enter(id);
+
+    if (SMP_FAULT_TRY() != 0) {
+        __asm__ volatile("sti");
+        JS_ResetAfterFault(p->ctx, NULL);
+        _proc_pd_leave(cr3);
+        p->slice_deadline = 0;
+        _cur_proc = -1;
+        p->tainted = 1;                 /* same quarantine as procEval     */
+        p->ap_code = NULL;              /* leaked: heap may be inconsistent */
+        _proc_ap_fmt(p, "error:", "CPU fault in child runtime");
+        platform_serial_puts("[kernel] AP fault recovered, child quarantined\n");
+        __atomic_store_n(&p->ap_state, JSPROC_AP_DONE, __ATOMIC_RELEASE);
+        return;
+    }
+
+    _cur_proc = id;
+    JS_UpdateStackTop(p->rt);
+    JSValue result = JS_Eval(p->ctx, p->ap_code, strlen(p->ap_code),
+                             "<smp>", JS_EVAL_TYPE_GLOBAL);
+    p->slice_deadline = 0;
+    if (JS_IsException(result)) {
+        JSValue exc = JS_GetException(p->ctx);
+        const char *err = JS_ToCString(p->ctx, exc);
+        if (err && strstr(err, "interrupted") != NULL) _proc_ap_fmt(p, "timeout", NULL);
+        else                                          _proc_ap_fmt(p, "error:", err);
+        if (err) JS_FreeCString(p->ctx, err);
+        JS_FreeValue(p->ctx, exc);
+    } else {
+        const char *str = JS_IsUndefined(result) ? NULL : JS_ToCString(p->ctx, result);
+        _proc_ap_fmt(p, "done:", str ? str : "undefined");
+        if (str) JS_FreeCString(p->ctx, str);
+    }
+    JS_FreeValue(p->ctx, result);
+
+    int count = 0;
+    JSContext *job_ctx = NULL;
+    while (JS_ExecutePendingJob(p->rt, &job_ctx) > 0 && count < 32) count++;
+
+    smp_fault_disarm();
+    _proc_pd_leave(cr3);
+    _cur_proc = -1;
+    free(p->ap_code);
+    p->ap_code = NULL;
+    __atomic_store_n(&p->ap_state, JSPROC_AP_DONE, __ATOMIC_RELEASE);
+}
+
+static JSValue js_proc_run_on(JSContext *c, JSValueConst this_val,
+                              int argc, JSValueConst *argv) {
     (void)this_val;
-    int32_t size = SHARED_BUF_BYTES;
-    if (argc >= 1) JS_ToInt32(c, &size, argv[0]);
-    if (size <= 0) size = 4;
-    if (size > SHARED_BUF_BYTES) size = SHARED_BUF_BYTES;
-    for (int i = 0; i < SHARED_BUF_MAX; i++) {
-        if (!_sbuf_used[i]) {
-            memset(_sbufs[i], 0, (size_t)size);
-            _sbuf_used[i]  = 1;
-            _sbuf_sizes[i] = (uint32_t)size;
-            return JS_NewInt32(c, i);
-        }
+    if (argc < 3) return JS_NewInt32(c, -1);
+    int32_t id = 0, cpu = 0, max_ms = 0;
+    JS_ToInt32(c, &id,  argv[0]);
+    JS_ToInt32(c, &cpu, argv[1]);
+    if (argc >= 4) JS_ToInt32(c, &max_ms, argv[3]);
+    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used || _procs[id].tainted)
+        return JS_NewInt32(c, -1);
+    JSProc_t *p = &_procs[id];
+    if (p->ap_state != JSPROC_AP_IDLE) return JS_NewInt32(c, -1);
+    if (smp_cpu_count() < 2) return JS_NewInt32(c, -1);
+
+    size_t len = 0;
+    const char *code = JS_ToCStringLen(c, &len, argv[2]);
+    if (!code) return JS_NewInt32(c, -1);
+    p->ap_code = (char *)malloc(len + 1);
+    if (!p->ap_code) { JS_FreeCString(c, code); return JS_NewInt32(c, -1); }
+    memcpy(p->ap_code, code, len + 1);
+    JS_FreeCString(c, code);
+
+    p->slice_deadline = (max_ms > 0)
+        ? timer_get_ticks() + MS_TO_TICKS((uint32_t)max_ms) : 0;
+    p->ap_state = JSPROC_AP_QUEUED;
+    int where = (cpu > 0)
+        ? (smp_submit((uint32_t)cpu, _proc_ap_job, (void *)(intptr_t)id) == 0 ? cpu : -1)
+        : smp_submit_any(_proc_ap_job, (void *)(intptr_t)id);
+    if (where < 0) {
+        free(p->ap_code);
+        p->ap_code = NULL;
+        p->slice_deadline = 0;
+        p->ap_state = JSPROC_AP_IDLE;
+        return JS_NewInt32(c, -1);
     }
-    return JS_NewInt32(c, -1);
+    p->ap_cpu = (uint8_t)where;
+    return JS_NewInt32(c, where);
 }
 
-/* kernel.sharedBufferRelease(id) — free the slot; the bytes stay in BSS. */
-static JSValue js_shared_buf_release(JSContext *c, JSValueConst this_val,
-                                      int argc, JSValueConst *argv) {
-    (void)this_val; (void)c;
-    if (argc < 1) return JS_UNDEFINED;
+static JSValue js_proc_run_result(JSContext *c, JSValueConst this_val,
+                                  int argc, JSValueConst *argv) {
+    (void)this_val;
+    if (argc < 1) return JS_NULL;
     int32_t id = 0;
     JS_ToInt32(c, &id, argv[0]);
-    if (id >= 0 && id < SHARED_BUF_MAX) {
-        _sbuf_used[id]  = 0;
-        _sbuf_sizes[id] = 0;
+    if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_NULL;
+    JSProc_t *p = &_procs[id];
+    if (__atomic_load_n(&p->ap_state, __ATOMIC_ACQUIRE) != JSPROC_AP_DONE)
+        return JS_NULL;
+    JSValue ret = JS_NewString(c, p->ap_result);
+    p->ap_state = JSPROC_AP_IDLE;
+    p->ap_cpu   = 0;
+    return ret;
+}
+
+/* kernel.smpCpuCount() → online CPUs (BSP included) */
+static JSValue js_smp_cpu_count(JSContext *c, JSValueConst this_val,
+                                int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    return JS_NewUint32(c, smp_cpu_count());
+}
+
+/* kernel.smpInfo() → [{cpu, apicId, online, busy, ticks, jobsDone, queued}] */
+static JSValue js_smp_info(JSContext *c, JSValueConst this_val,
+                           int argc, JSValueConst *argv) {
+    (void)this_val; (void)argc; (void)argv;
+    JSValue arr = JS_NewArray(c);
+    uint32_t idx = 0;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        smp_cpu_info_t inf;
+        if (smp_get_info(i, &inf) != 0 || !inf.online) continue;
+        JSValue o = JS_NewObject(c);
+        JS_SetPropertyStr(c, o, "cpu",      JS_NewUint32(c, i));
+        JS_SetPropertyStr(c, o, "apicId",   JS_NewUint32(c, inf.apic_id));
+        JS_SetPropertyStr(c, o, "online",   JS_NewBool(c, inf.online));
+        JS_SetPropertyStr(c, o, "busy",     JS_NewBool(c, inf.busy));
+        JS_SetPropertyStr(c, o, "ticks",    JS_NewUint32(c, inf.ticks));
+        JS_SetPropertyStr(c, o, "jobsDone", JS_NewUint32(c, inf.jobs_done));
+        JS_SetPropertyStr(c, o, "queued",   JS_NewUint32(c, inf.queued));
+        JS_SetPropertyUint32(c, arr, idx++, o);
     }
-    return JS_UNDEFINED;
+    return arr;
 }
 
 /* ── Phase 11: JIT compiler primitives ───────────────────────────────────
@@ -3052,6 +4356,9 @@ static int _jit_hook_child(JSRuntime *rt, JSContext *hook_ctx,
      * disposed.  Attempting to JIT-compile their bytecode risks reading
      * from unmapped child heap addresses → CPU fault with no recovery. */
     if (_js_in_page_eval) return 0;
+    /* Children on an AP never request JIT: the BSP would patch bytecode
+     * that is executing concurrently on another CPU. */
+    if (smp_cpu_index() != 0) return 0;
     /* Identify which child slot owns this runtime */
     for (int i = 0; i < JSPROC_MAX; i++) {
         if (_procs[i].used && _procs[i].rt == rt) {
@@ -3148,6 +4455,7 @@ static JSValue js_jit_proc_alloc(JSContext *c, JSValueConst this_val,
  * Runs in the MAIN context — safe because cooperative scheduling. */
 static JSValue _fs_bridge_call(const char *method, const char *arg) {
     if (JS_IsUndefined(_fs_bridge_obj)) return JS_NULL;
+    if (smp_cpu_index() != 0) return JS_NULL;   /* main ctx belongs to the BSP */
     JSValue fn = JS_GetPropertyStr(ctx, _fs_bridge_obj, method);
     if (!JS_IsFunction(ctx, fn)) { JS_FreeValue(ctx, fn); return JS_NULL; }
     JSValue arg_v = JS_NewString(ctx, arg ? arg : "");
@@ -3246,13 +4554,14 @@ static JSValue js_proc_dequeue_window_cmd(JSContext *c, JSValueConst this_val,
 }
 
 /* ── Main-side: kernel.serviceTimers(id) — fire expired timers for child id ── */
-static JSValue js_service_timers(JSContext *c, JSValueConst this_val,
+static JSValue _service_timers_in(JSContext *c, JSValueConst this_val,
                                   int argc, JSValueConst *argv) {
     (void)this_val; (void)c;
     if (argc < 1) return JS_UNDEFINED;
     int32_t id = 0; JS_ToInt32(c, &id, argv[0]);
     if (id < 0 || id >= JSPROC_MAX || !_procs[id].used) return JS_UNDEFINED;
     if (_procs[id].tainted) return JS_UNDEFINED;  /* quarantined */
+    if (_proc_on_ap(id)) return JS_UNDEFINED;     /* retried next tick */
     /* Arm fault recovery — save/restore for nesting */
     jmp_buf _saved_fault_buf;
     int _saved_fault_active = _js_fault_active;
@@ -3312,6 +4621,12 @@ static JSValue js_service_timers(JSContext *c, JSValueConst this_val,
     return JS_UNDEFINED;
 }
 
+/* kernel.serviceTimers(id) */
+static JSValue js_service_timers(JSContext *c, JSValueConst this_val,
+                                 int argc, JSValueConst *argv) {
+    return _proc_call_in(_service_timers_in, c, this_val, argc, argv);
+}
+
 /* ── Child-side: kernel.getRenderBuffer() → ArrayBuffer pointing at BSS slab ── */
 static JSValue js_child_get_render_buf(JSContext *c, JSValueConst this_val,
                                        int argc, JSValueConst *argv) {
@@ -3366,6 +4681,7 @@ static JSValue js_child_fs_write_file(JSContext *c, JSValueConst this_val,
     const char *path = JS_ToCString(c, argv[0]);
     const char *cont = JS_ToCString(c, argv[1]);
     if (!path || !cont) { JS_FreeCString(c,path); JS_FreeCString(c,cont); return JS_FALSE; }
+    if (smp_cpu_index() != 0) { JS_FreeCString(c,path); JS_FreeCString(c,cont); return JS_FALSE; }
     /* encode as "path\x00content" and use writeFile with two args via JSON hack */
     JSValue path_v = JS_NewString(ctx, path);
     JSValue cont_v = JS_NewString(ctx, cont);
@@ -3706,6 +5022,248 @@ static JSValue js_uptime_us(JSContext *c, JSValueConst _t,
     return JS_NewFloat64(c, (double)timer_uptime_us());
 }
 
+/* kernel.romImage() → ArrayBuffer over the linked-in ROM image.
+ * The buffer aliases .rodata (romfs_image.s): no copy, no free callback, so
+ * every call returns a fresh view of the same bytes.  JS treats it as
+ * read-only.  null if the image is empty. */
+extern const uint8_t rom_image_start[];
+extern const uint8_t rom_image_end[];
+
+static JSValue js_rom_image(JSContext *c, JSValueConst _t,
+                            int _ac, JSValueConst *_av) {
+    (void)_t; (void)_ac; (void)_av;
+    size_t len = (size_t)(rom_image_end - rom_image_start);
+    if (len == 0) return JS_NULL;
+    return JS_NewArrayBuffer(c, (uint8_t *)rom_image_start, len, NULL, NULL, 0);
+}
+
+/* kernel.getInitramfs() → ArrayBuffer over the GRUB initramfs module,
+ * in place like romImage(); null when none was loaded. */
+static JSValue js_get_initramfs(JSContext *c, JSValueConst _t,
+                                int _ac, JSValueConst *_av) {
+    (void)_t; (void)_ac; (void)_av;
+    uint32_t len;
+    const uint8_t *p = initrd_data(&len);
+    if (!p || !len) return JS_NULL;
+    return JS_NewArrayBuffer(c, (uint8_t *)p, len, NULL, NULL, 0);
+}
+
+/* kernel.getInitramfsRange() → { addr, len } physical bytes of the module
+ * (identity-mapped), or null; lets physalloc.ts keep its frames. */
+static JSValue js_get_initramfs_range(JSContext *c, JSValueConst _t,
+                                      int _ac, JSValueConst *_av) {
+    (void)_t; (void)_ac; (void)_av;
+    uint32_t len;
+    const uint8_t *p = initrd_data(&len);
+    if (!p || !len) return JS_NULL;
+    JSValue o = JS_NewObject(c);
+    JS_SetPropertyStr(c, o, "addr", JS_NewUint32(c, (uint32_t)(uintptr_t)p));
+    JS_SetPropertyStr(c, o, "len",  JS_NewUint32(c, len));
+    return o;
+}
+
+/* kernel.lz4Compress(src, dst) / kernel.lz4Decompress(src, dst) → bytes
+ * written to `dst`, or -1.  Both arguments are ArrayBuffers or
+ * typed-array views; nothing is allocated or copied on the JS side. */
+static JSValue js_lz4_block(JSContext *c, int argc, JSValueConst *argv, int compress) {
+    if (argc < 2) return JS_ThrowTypeError(c, "lz4(src, dst)");
+    size_t slen = 0, dlen = 0;
+    const uint8_t *src = _ipc_value_bytes(c, argv[0], &slen);
+    uint8_t *dst = (uint8_t *)_ipc_value_bytes(c, argv[1], &dlen);
+    if (!src || !dst) return JS_ThrowTypeError(c, "src and dst must be ArrayBuffers or typed arrays");
+    int n = compress
+          ? lz4_compress_block(src, (uint32_t)slen, dst, (uint32_t)dlen)
+          : lz4_decompress_block(src, (uint32_t)slen, dst, (uint32_t)dlen);
+    return JS_NewInt32(c, n);
+}
+
+static JSValue js_lz4_compress(JSContext *c, JSValueConst _t,
+                               int argc, JSValueConst *argv) {
+    (void)_t;
+    return js_lz4_block(c, argc, argv, 1);
+}
+
+static JSValue js_lz4_decompress(JSContext *c, JSValueConst _t,
+                                 int argc, JSValueConst *argv) {
+    (void)_t;
+    return js_lz4_block(c, argc, argv, 0);
+}
+
+/* kernel.crc32c(crc, buf, off?, len?) → updated CRC-32C register.
+ * `buf` is an ArrayBuffer or typed-array view; SSE4.2 when available. */
+static JSValue js_crc32c(JSContext *c, JSValueConst _t,
+                         int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 2) return JS_ThrowTypeError(c, "crc32c(crc, buf, off?, len?)");
+    uint32_t crc = 0, off = 0, len;
+    size_t blen = 0;
+    if (JS_ToUint32(c, &crc, argv[0])) return JS_EXCEPTION;
+    const uint8_t *buf = _ipc_value_bytes(c, argv[1], &blen);
+    if (!buf) return JS_ThrowTypeError(c, "buf must be an ArrayBuffer or typed array");
+    if (argc >= 3 && JS_ToUint32(c, &off, argv[2])) return JS_EXCEPTION;
+    if (off > blen) off = (uint32_t)blen;
+    len = (uint32_t)blen - off;
+    if (argc >= 4 && !JS_IsUndefined(argv[3])) {
+        uint32_t want = 0;
+        if (JS_ToUint32(c, &want, argv[3])) return JS_EXCEPTION;
+        if (want < len) len = want;
+    }
+    return JS_NewUint32(c, crc32c_update(crc, buf + off, len));
+}
+
+/* ── Image decode kernels ───────────────────────────────────────────────
+ * Buffers are ArrayBuffers or typed-array views; offsets and strides are in
+ * elements of the view's natural type (bytes, except Uint32 for jpegColor's
+ * output).  Every span is checked against the buffer before the kernel
+ * runs, so a bad call throws RangeError instead of writing out of bounds. */
+
+/* Read argv[from .. from+count) as uint32s; absent arguments read as 0. */
+static int _img_u32_args(JSContext *c, int argc, JSValueConst *argv,
+                         int from, int count, uint32_t *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = 0;
+        if (from + i < argc && !JS_IsUndefined(argv[from + i]) &&
+            JS_ToUint32(c, &out[i], argv[from + i])) return -1;
+    }
+    return 0;
+}
+
+/* rows × stride-spaced rows of `width` units (each `unit` bytes) starting
+ * at element `off` fit inside `len` bytes. */
+static int _img_span_ok(size_t len, uint32_t off, uint32_t rows, uint32_t stride,
+                        uint32_t width, uint32_t unit) {
+    if (!rows || !width) return (uint64_t)off * unit <= len;
+    uint64_t end = ((uint64_t)off + (uint64_t)(rows - 1) * stride + width) * unit;
+    return width <= stride && end <= len;
+}
+
+/* kernel.jpegIdct(coef, qt, plane, planeOff, stride, blocksW, blocksH, n)
+ * IDCT a band of blocksW×blocksH blocks (Int16 natural-order coefficients,
+ * 64 per block) into n×n samples each (n = 8, 4, 2, 1) and clear `coef`. */
+static JSValue js_jpeg_idct(JSContext *c, JSValueConst _t,
+                            int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 8) return JS_ThrowTypeError(c, "jpegIdct(coef, qt, plane, planeOff, stride, blocksW, blocksH, n)");
+    size_t clen = 0, qlen = 0, plen = 0;
+    int16_t *coef = (int16_t *)_ipc_value_bytes(c, argv[0], &clen);
+    const uint16_t *qt = (const uint16_t *)_ipc_value_bytes(c, argv[1], &qlen);
+    uint8_t *plane = (uint8_t *)_ipc_value_bytes(c, argv[2], &plen);
+    if (!coef || !qt || !plane) return JS_ThrowTypeError(c, "coef, qt and plane must be ArrayBuffers or typed arrays");
+    uint32_t a[5];   /* planeOff, stride, blocksW, blocksH, n */
+    if (_img_u32_args(c, argc, argv, 3, 5, a)) return JS_EXCEPTION;
+    uint32_t n = a[4];
+    if (n != 1 && n != 2 && n != 4 && n != 8) return JS_ThrowRangeError(c, "n must be 1, 2, 4 or 8");
+    if (((uintptr_t)coef | (uintptr_t)qt) & 1u || qlen < 128 ||
+        a[2] > 4096 || a[3] > 16 || (uint64_t)a[2] * a[3] * 128 > clen ||
+        !_img_span_ok(plen, a[0], a[3] * n, a[1], a[2] * n, 1))
+        return JS_ThrowRangeError(c, "jpegIdct: buffer too small");
+    jpeg_idct_band(coef, qt, plane + a[0], a[1], a[2], a[3], n);
+    return JS_UNDEFINED;
+}
+
+/* kernel.jpegColor(out, outOff, w, h, Y, yStride, Cb?, Cr?, cStride?, hs?, vs?)
+ * Write w×h 0xFFRRGGBB pixels at out[outOff + row*w + x]; chroma is
+ * upsampled by hs×vs (1 or 2).  Without Cb/Cr the luma is greyscale. */
+static JSValue js_jpeg_color(JSContext *c, JSValueConst _t,
+                             int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 6) return JS_ThrowTypeError(c, "jpegColor(out, outOff, w, h, Y, yStride, Cb?, Cr?, cStride?, hs?, vs?)");
+    size_t olen = 0, ylen = 0, cblen = 0, crlen = 0;
+    uint32_t *out = (uint32_t *)_ipc_value_bytes(c, argv[0], &olen);
+    const uint8_t *y = _ipc_value_bytes(c, argv[4], &ylen);
+    if (!out || !y) return JS_ThrowTypeError(c, "out and Y must be ArrayBuffers or typed arrays");
+    uint32_t a[3], b[4];   /* outOff, w, h; yStride, cStride, hs, vs */
+    if (_img_u32_args(c, argc, argv, 1, 3, a) || _img_u32_args(c, argc, argv, 5, 1, b) ||
+        _img_u32_args(c, argc, argv, 8, 3, b + 1)) return JS_EXCEPTION;
+    uint32_t w = a[1], h = a[2];
+    if (((uintptr_t)out & 3u) || w > 16384 || h > 16384 ||
+        !_img_span_ok(olen, a[0], 1, w * h, w * h, 4) ||
+        !_img_span_ok(ylen, 0, h, b[0], w, 1))
+        return JS_ThrowRangeError(c, "jpegColor: buffer too small");
+    const uint8_t *cb = NULL, *cr = NULL;
+    if (argc >= 8 && JS_IsObject(argv[6])) {
+        cb = _ipc_value_bytes(c, argv[6], &cblen);
+        cr = _ipc_value_bytes(c, argv[7], &crlen);
+        if (!cb || !cr) return JS_ThrowTypeError(c, "Cb and Cr must be ArrayBuffers or typed arrays");
+        uint32_t hs = b[2], vs = b[3];
+        if ((hs != 1 && hs != 2) || (vs != 1 && vs != 2)) return JS_ThrowRangeError(c, "hs and vs must be 1 or 2");
+        uint32_t cw = (w + hs - 1) / hs, ch = (h + vs - 1) / vs;
+        if (!_img_span_ok(cblen, 0, ch, b[1], cw, 1) || !_img_span_ok(crlen, 0, ch, b[1], cw, 1))
+            return JS_ThrowRangeError(c, "jpegColor: chroma buffer too small");
+    }
+    jpeg_ycc_rows(out + a[0], w, h, y, b[0], cb, cr, b[1], b[2], b[3]);
+    return JS_UNDEFINED;
+}
+
+/* kernel.pngUnfilter(src, srcOff, dst, dstOff, stride, rows, bpp) → offset
+ * in `src` just past the last row.  Each source row is a filter-type byte
+ * and `stride` filtered bytes; `dst` receives the rows back to back. */
+static JSValue js_png_unfilter(JSContext *c, JSValueConst _t,
+                               int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 7) return JS_ThrowTypeError(c, "pngUnfilter(src, srcOff, dst, dstOff, stride, rows, bpp, cont?)");
+    size_t slen = 0, dlen = 0;
+    const uint8_t *src = _ipc_value_bytes(c, argv[0], &slen);
+    uint8_t *dst = (uint8_t *)_ipc_value_bytes(c, argv[2], &dlen);
+    if (!src || !dst) return JS_ThrowTypeError(c, "src and dst must be ArrayBuffers or typed arrays");
+    uint32_t so, a[4];   /* stride, rows, bpp after dstOff */
+    if (_img_u32_args(c, argc, argv, 1, 1, &so) || _img_u32_args(c, argc, argv, 3, 4, a)) return JS_EXCEPTION;
+    uint32_t stride = a[1], rows = a[2], bpp = a[3];
+    if (bpp < 1 || bpp > 8) return JS_ThrowRangeError(c, "bpp must be 1-8");
+    if (stride >= 0x1000000u || !_img_span_ok(slen, so, rows, stride + 1, stride + 1, 1) ||
+        !_img_span_ok(dlen, a[0], rows, stride, stride, 1))
+        return JS_ThrowRangeError(c, "pngUnfilter: buffer too small");
+    /* cont: the row above dst[dstOff] is the one just before it */
+    int cont = argc > 7 && JS_ToBool(c, argv[7]);
+    if (cont && a[0] < stride) return JS_ThrowRangeError(c, "pngUnfilter: no row above dstOff");
+    png_unfilter(src + so, dst + a[0], stride, rows, bpp, cont ? dst + a[0] - stride : NULL);
+    return JS_NewUint32(c, so + rows * (stride + 1));
+}
+
+/* kernel.spanBlend(dst, width, spans, count, color, paint?, mask?)
+ * Source-over `count` coverage spans (Int32 quads y, x, len, coverage) onto
+ * the 32-bit surface `dst`, `width` pixels per row.  `paint`
+ * supplies one source word per covered pixel in span order instead of
+ * `color`; `mask` is a per-pixel coverage byte map of the same surface. */
+static JSValue js_span_blend(JSContext *c, JSValueConst _t,
+                             int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 5) return JS_ThrowTypeError(c, "spanBlend(dst, width, spans, count, color, paint?, mask?)");
+    size_t dlen = 0, slen = 0, plen = 0, mlen = 0;
+    uint32_t *dst = (uint32_t *)_ipc_value_bytes(c, argv[0], &dlen);
+    const int32_t *spans = (const int32_t *)_ipc_value_bytes(c, argv[2], &slen);
+    if (!dst || !spans) return JS_ThrowTypeError(c, "dst and spans must be ArrayBuffers or typed arrays");
+    uint32_t width, b[2];   /* count, color */
+    if (_img_u32_args(c, argc, argv, 1, 1, &width) || _img_u32_args(c, argc, argv, 3, 2, b)) return JS_EXCEPTION;
+    const uint32_t *paint = NULL;
+    const uint8_t *mask = NULL;
+    if (argc > 5 && JS_IsObject(argv[5])) {
+        paint = (const uint32_t *)_ipc_value_bytes(c, argv[5], &plen);
+        if (!paint) return JS_ThrowTypeError(c, "paint must be an ArrayBuffer or typed array");
+    }
+    if (argc > 6 && JS_IsObject(argv[6])) {
+        mask = _ipc_value_bytes(c, argv[6], &mlen);
+        if (!mask) return JS_ThrowTypeError(c, "mask must be an ArrayBuffer or typed array");
+    }
+    uint32_t count = b[0];
+    if (((uintptr_t)dst | (uintptr_t)spans | (uintptr_t)paint) & 3u || (uint64_t)count * 16 > slen)
+        return JS_ThrowRangeError(c, "spanBlend: buffer too small");
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const int32_t *sp = spans + i * 4;
+        if (sp[0] < 0 || sp[1] < 0 || sp[2] < 0 || sp[3] < 0 || sp[3] > 255 ||
+            (uint64_t)sp[1] + (uint32_t)sp[2] > width)
+            return JS_ThrowRangeError(c, "spanBlend: span outside the surface");
+        uint64_t end = (uint64_t)(uint32_t)sp[0] * width + (uint32_t)sp[1] + (uint32_t)sp[2];
+        if (end * 4 > dlen || (mask && end > mlen))
+            return JS_ThrowRangeError(c, "spanBlend: span outside the surface");
+        total += (uint32_t)sp[2];
+    }
+    if (paint && total * 4 > plen) return JS_ThrowRangeError(c, "spanBlend: paint buffer too small");
+    span_blend(dst, width, spans, count, b[1], paint, mask);
+    return JS_UNDEFINED;
+}
+
 /* kernel.rdrand() → one 32-bit hardware random word via RDRAND CPU instruction (item 348)
  * Returns a Uint32.  Falls back to TSC-derived value if RDRAND is not available or fails. */
 static JSValue js_rdrand(JSContext *c, JSValueConst _t,
@@ -3783,6 +5341,26 @@ static JSValue js_ata_is_atapi(JSContext *c, JSValueConst _t,
     return JS_NewInt32(c, ata_is_atapi());
 }
 
+/* kernel.atapiPacket(packet, buf?) → bytes transferred, or -1.
+ * `packet` is the 12-byte CDB; the data phase (up to 64 KB, any number of
+ * DRQ blocks) lands directly in `buf` — an ArrayBuffer or typed array. */
+static JSValue js_atapi_packet(JSContext *c, JSValueConst _t,
+                               int argc, JSValueConst *argv) {
+    (void)_t;
+    if (argc < 1) return JS_ThrowTypeError(c, "atapiPacket(packet, buf?)");
+    size_t plen = 0, blen = 0;
+    const uint8_t *cdb = _ipc_value_bytes(c, argv[0], &plen);
+    if (!cdb || plen < 12) return JS_ThrowTypeError(c, "packet must be 12 bytes");
+    uint8_t packet[12];
+    memcpy(packet, cdb, 12);
+    uint8_t *buf = NULL;
+    if (argc > 1 && !JS_IsUndefined(argv[1]) && !JS_IsNull(argv[1])) {
+        buf = (uint8_t *)_ipc_value_bytes(c, argv[1], &blen);
+        if (!buf) return JS_ThrowTypeError(c, "buf must be an ArrayBuffer or typed array");
+    }
+    return JS_NewInt32(c, ata_atapi_send_packet(packet, buf, (uint32_t)blen));
+}
+
 /* kernel.virtioBlkPresent() → boolean (item 81) */
 static JSValue js_virtio_blk_present(JSContext *c, JSValueConst _t,
                                       int _ac, JSValueConst *_av) {
@@ -4051,7 +5629,7 @@ static JSValue js_fpu_save(JSContext *c, JSValueConst _t, int _ac, JSValueConst
     uint32_t addr;
     if (JS_ToUint32(c, &addr, av[0])) return JS_EXCEPTION;
     if (!addr || (addr & 0xF)) return JS_NewBool(c, 0);    /* must be 16-byte aligned */
-    __asm__ volatile("fxsave (%0)" :: "r"((void *)(uintptr_t)addr) : "memory");
+    fpu_save((void *)(uintptr_t)addr);
     return JS_NewBool(c, 1);
 }
 
@@ -4061,7 +5639,7 @@ static JSValue js_fpu_restore(JSContext *c, JSValueConst _t, int _ac, JSValueCon
     uint32_t addr;
     if (JS_ToUint32(c, &addr, av[0])) return JS_EXCEPTION;
     if (!addr || (addr & 0xF)) return JS_NewBool(c, 0);    /* must be 16-byte aligned */
-    __asm__ volatile("fxrstor (%0)" :: "r"((void *)(uintptr_t)addr) : "memory");
+    fpu_restore((void *)(uintptr_t)addr);
     return JS_NewBool(c, 1);
 }
 
@@ -4252,10 +5830,22 @@ static const JSCFunctionListEntry js_kernel_funcs[] = {
     JS_CFUNC_DEF("registerSchedulerHook", 1, js_register_scheduler_hook),
     JS_CFUNC_DEF("yield",                 0, js_yield),
     JS_CFUNC_DEF("schedTick",             0, js_sched_tick),
+    JS_CFUNC_DEF("kthreadList",           0, js_kthread_list),
     JS_CFUNC_DEF("drainJobs",             0, js_drain_jobs),
     JS_CFUNC_DEF("tssSetESP0",            1, js_tss_set_esp0),
     /* Process primitives (Phase 6) */
     JS_CFUNC_DEF("cloneAddressSpace",  0, js_clone_address_space),
+    JS_CFUNC_DEF("freeAddressSpace",   1, js_free_address_space),
+    /* Bulk page-table primitives */
+    JS_CFUNC_DEF("ptMapRange",     5, js_pt_map_range),
+    JS_CFUNC_DEF("ptMapAnon",      4, js_pt_map_anon),
+    JS_CFUNC_DEF("ptUnmapRange",   3, js_pt_unmap_range),
+    JS_CFUNC_DEF("ptProtectRange", 4, js_pt_protect_range),
+    JS_CFUNC_DEF("ptCloneCow",     4, js_pt_clone_cow),
+    JS_CFUNC_DEF("ptCowFault",     2, js_pt_cow_fault),
+    JS_CFUNC_DEF("ptQuery",        2, js_pt_query),
+    JS_CFUNC_DEF("ptCount",        3, js_pt_count),
+    JS_CFUNC_DEF("ptStats",        0, js_pt_stats),
     JS_CFUNC_DEF("jumpToUserMode",     2, js_jump_to_user_mode),
     JS_CFUNC_DEF("getPageFaultAddr",   0, js_get_page_fault_addr),
     /* Network (Phase 7) */
@@ -4264,25 +5854,52 @@ static const JSCFunctionListEntry js_kernel_funcs[] = {
     JS_CFUNC_DEF("netRecvFrame",  0, js_net_recv_frame),
     JS_CFUNC_DEF("netMacAddress", 0, js_net_mac_address),
     JS_CFUNC_DEF("netPciAddr",    0, js_net_pci_addr),
+    JS_CFUNC_DEF("netWaitRx",     1, js_net_wait_rx),
     JS_CFUNC_DEF("netDebugRxIdx", 0, js_net_debug_rx_used_idx),
     JS_CFUNC_DEF("netDebugInfo",   0, js_net_debug_info),
     JS_CFUNC_DEF("netDebugStatus", 0, js_net_debug_status),
     JS_CFUNC_DEF("netDebugQueues", 0, js_net_debug_queues),
     /* Multi-process (Phase 10) */
-    JS_CFUNC_DEF("procCreate",    0, js_proc_create),
+    JS_CFUNC_DEF("procCreate",    1, js_proc_create),
+    /* Zygote runtimes — COW clones of a pre-initialised heap */
+    JS_CFUNC_DEF("zygoteCreate",  1, js_zygote_create),
+    JS_CFUNC_DEF("zygoteSpawn",   2, js_zygote_spawn),
+    JS_CFUNC_DEF("zygoteDestroy", 1, js_zygote_destroy),
+    JS_CFUNC_DEF("zygoteInfo",    1, js_zygote_info),
     JS_CFUNC_DEF("procEval",      2, js_proc_eval),
     JS_CFUNC_DEF("procEvalSlice", 3, js_proc_eval_slice),
     JS_CFUNC_DEF("procTick",      1, js_proc_tick),
     JS_CFUNC_DEF("procSend",      2, js_proc_send),
+    JS_CFUNC_DEF("procSendBatch", 2, js_proc_send_batch),
     JS_CFUNC_DEF("procRecv",      1, js_proc_recv),
+    JS_CFUNC_DEF("procRecvBatch", 2, js_proc_recv_batch),
+    JS_CFUNC_DEF("procDoorbell",  0, js_proc_doorbell),
+    JS_CFUNC_DEF("procRingInfo",  1, js_proc_ring_info),
     JS_CFUNC_DEF("procDestroy",   1, js_proc_destroy),
     JS_CFUNC_DEF("procAlive",     1, js_proc_alive),
     JS_CFUNC_DEF("procList",      0, js_proc_list),
+    /* SMP (item 31) */
+    JS_CFUNC_DEF("procRunOn",     4, js_proc_run_on),
+    JS_CFUNC_DEF("procRunResult", 1, js_proc_run_result),
+    JS_CFUNC_DEF("smpCpuCount",   0, js_smp_cpu_count),
+    JS_CFUNC_DEF("smpInfo",       0, js_smp_info),
     /* Shared memory (Phase 10) */
     JS_CFUNC_DEF("sharedBufferCreate",  1, js_shared_buf_create),
     JS_CFUNC_DEF("sharedBufferOpen",    1, js_shared_buf_open),
     JS_CFUNC_DEF("sharedBufferRelease", 1, js_shared_buf_release),
     JS_CFUNC_DEF("sharedBufferSize",    1, js_shared_buf_size),
+    JS_CFUNC_DEF("shmCreate",           2, js_shm_create),
+    JS_CFUNC_DEF("shmOpen",             1, js_shm_open),
+    JS_CFUNC_DEF("shmUnlink",           1, js_shm_unlink),
+    JS_CFUNC_DEF("shmList",             0, js_shm_list),
+    JS_CFUNC_DEF("bufferTransfer",      1, js_buffer_transfer),
+    JS_CFUNC_DEF("bufferAccept",        1, js_buffer_accept),
+    /* io_uring SQ/CQ rings */
+    JS_CFUNC_DEF("uringSetup",          1, js_uring_setup),
+    JS_CFUNC_DEF("uringRegisterBuffer", 3, js_uring_register_buffer),
+    JS_CFUNC_DEF("uringEnter",          2, js_uring_enter),
+    JS_CFUNC_DEF("uringInfo",           1, js_uring_info),
+    JS_CFUNC_DEF("uringDestroy",        1, js_uring_destroy),
     /* JIT compiler primitives (Phase 11) */
     JS_CFUNC_DEF("jitAlloc",     1, js_jit_alloc),
     JS_CFUNC_DEF("jitWrite",     2, js_jit_write),
@@ -4331,6 +5948,7 @@ static const JSCFunctionListEntry js_kernel_funcs[] = {
     JS_CFUNC_DEF("hpetFreq",            0, js_hpet_freq),
     /* ATAPI (item 80) */
     JS_CFUNC_DEF("ataIsAtapi",          0, js_ata_is_atapi),
+    JS_CFUNC_DEF("atapiPacket",         2, js_atapi_packet),
     /* VirtIO-BLK (item 81) */
     JS_CFUNC_DEF("virtioBlkPresent",    0, js_virtio_blk_present),
     JS_CFUNC_DEF("virtioBlkSectors",    0, js_virtio_blk_sectors),
@@ -4395,6 +6013,18 @@ static const JSCFunctionListEntry js_kernel_funcs[] = {
     JS_CFUNC_DEF("fpuRestore",          1, js_fpu_restore),
     /* Hardware RDRAND instruction (item 348) */
     JS_CFUNC_DEF("rdrand",              0, js_rdrand),
+    /* Linked-in ROM image */
+    JS_CFUNC_DEF("romImage",            0, js_rom_image),
+    /* GRUB initramfs module */
+    JS_CFUNC_DEF("getInitramfs",        0, js_get_initramfs),
+    JS_CFUNC_DEF("getInitramfsRange",   0, js_get_initramfs_range),
+    JS_CFUNC_DEF("lz4Compress",         2, js_lz4_compress),
+    JS_CFUNC_DEF("lz4Decompress",       2, js_lz4_decompress),
+    JS_CFUNC_DEF("crc32c",              4, js_crc32c),
+    JS_CFUNC_DEF("jpegIdct",            8, js_jpeg_idct),
+    JS_CFUNC_DEF("jpegColor",          11, js_jpeg_color),
+    JS_CFUNC_DEF("pngUnfilter",         8, js_png_unfilter),
+    JS_CFUNC_DEF("spanBlend",           7, js_span_blend),
 };
 
 /*  Initialization  */
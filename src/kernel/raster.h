@@ -0,0 +1,35 @@
+/*
+ * JSOS span compositing kernel
+ *
+ * The inner loop of the browser's shared scanline rasterizer
+ * (apps/browser/raster.ts): Canvas2D, SVG and CSS gradients all turn their
+ * geometry into coverage spans in JS and hand the spans here to be
+ * composited.  JS reaches it through kernel.spanBlend and keeps a fallback
+ * with the same integer arithmetic, so a frame looks the same with or
+ * without it.
+ *
+ * Solid spans over opaque pixels use SSE2 when the CPU has it.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdint.h>
+
+/**
+ * Composite `count` spans into the width-pixel-wide surface `dst` with
+ * straight-alpha source-over.  Span i is spans[4i .. 4i+3] = y, x, len,
+ * coverage (0-255) and covers dst[y * width + x .. + len).
+ *
+ * Pixels are 32-bit words with alpha in the top byte; the other three
+ * channels are treated alike, so RGBA and BGRA surfaces both work as long
+ * as the source uses the same order.  The source is `color`, or with
+ * `paint` one word per covered pixel taken in span order.  `mask`, when
+ * given, holds one coverage byte per surface pixel and scales each pixel's
+ * coverage (clip paths).  The caller has bounds-checked every span.
+ */
+void span_blend(uint32_t *dst, uint32_t width, const int32_t *spans,
+                uint32_t count, uint32_t color, const uint32_t *paint,
+                const uint8_t *mask);
+
+#endif /* RASTER_H */
@@ -0,0 +1,16 @@
+; romfs_image.s - Bundled-resource ROM image
+;
+; Links build/rom.img (written by scripts/embed-rom.js, `npm run embed:rom`)
+; into .rodata, page aligned so the image's 4 KB-aligned file data is page
+; aligned in memory too.  quickjs_binding.c hands the bytes between
+; rom_image_start and rom_image_end to JS as one ArrayBuffer
+; (kernel.romImage()); nothing is copied or parsed at boot.
+
+global rom_image_start
+global rom_image_end
+
+section .rodata align=4096
+
+rom_image_start:
+    incbin "../../build/rom.img"
+rom_image_end:
@@ -0,0 +1,367 @@
+/*
+ * smp.c — Application-processor bring-up and per-CPU work queues
+ *
+ * Items implemented:
+ *   31  SMP: INIT-SIPI-SIPI startup, per-CPU GDT/TSS/stack, wake IPIs
+ *   49  Per-CPU LAPIC timers (vector SMP_TIMER_VECTOR on every AP)
+ *
+ * Boot sequence (BSP, from kernel.c after acpi_init):
+ *   1. Processor list comes from the ACPI MADT (acpi_info.cpu_apic_ids).
+ *   2. The real-mode trampoline is copied to SMP_TRAMPOLINE_ADDR.
+ *   3. For each AP: build its GDT + TSS, allocate a page-aligned stack,
+ *      patch the trampoline parameters, send INIT, wait 10 ms, then up to
+ *      two STARTUP IPIs, and wait for the AP to mark itself online.
+ *      APs are started one at a time, so the single parameter block in the
+ *      trampoline is never shared by two starting CPUs.
+ *
+ * Work queues:
+ *   Every AP owns a single-producer / single-consumer ring of smp_work_t.
+ *   The BSP publishes an item with a release store of `head`; the AP
+ *   consumes with an acquire load and publishes `tail` back.  No locks —
+ *   head and tail live on separate cache lines.  After publishing, the BSP
+ *   sends SMP_WAKE_VECTOR to the AP; an idle AP sits in `sti; hlt` so the
+ *   IPI (or its periodic LAPIC tick) is what makes it re-check the ring.
+ *
+ * The BSP keeps using the 8259 PIC and the PIT; only APs enable their
+ * LAPIC (apic_enable_local masks LINT0, which would cut the BSP off from
+ * ExtINT delivery).
+ *
+ * ARCHITECTURE CONSTRAINT: C provides mechanism only.  Which child
+ * runtime runs on which CPU is decided in TypeScript (jsprocess.ts).
+ */
+
+#include "smp.h"
+#include "acpi.h"
+#include "apic.h"
+#include "irq.h"
+#include "memory.h"
+#include "platform.h"
+#include "timer.h"
+#include <malloc.h>
+#include <stddef.h>
+#include <string.h>
+
+/* ── Trampoline (smp_trampoline.s) ──────────────────────────────────────── */
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_tramp_params[];
+extern uint8_t gdt_start[];             /* irq_asm.s — BSP GDT */
+extern void    smp_timer_stub(void);    /* irq_asm.s */
+extern void    smp_wake_stub(void);     /* irq_asm.s */
+
+typedef struct {
+    uint32_t cr3;       /* 0 = leave paging off                              */
+    uint32_t cr4;
+    uint32_t stack;     /* initial ESP                                       */
+    uint32_t cpu;       /* logical CPU index passed to smp_ap_entry          */
+    uint32_t entry;     /* &smp_ap_entry                                     */
+} __attribute__((packed)) smp_tramp_params_t;
+
+/* GDT slots 0..4 mirror the BSP (null, kcode, kdata, ucode, udata).
+ * CPU n puts its TSS at slot 5+n (selector 0x28 + 8n), which is what lets
+ * smp_cpu_index() recover n from the task register. */
+#define SMP_GDT_ENTRIES  (5u + SMP_MAX_CPUS)
+#define SMP_TIMER_MS     10u     /* AP tick period: wakes idle APs too       */
+#define SMP_START_WAIT_MS 200u
+
+/* ── Per-CPU state ──────────────────────────────────────────────────────── */
+typedef struct {
+    uint64_t          gdt[SMP_GDT_ENTRIES] __attribute__((aligned(8)));
+    tss_t             tss;
+    uint32_t          stack_top;
+    uint8_t           apic_id;
+    volatile uint32_t online;
+    volatile uint32_t busy;
+    volatile uint32_t ticks;
+    volatile uint32_t jobs_done;
+    /* recovery point armed by SMP_FAULT_TRY() on this CPU */
+    jmp_buf           fault_buf;
+    volatile int      fault_armed;
+    /* SPSC ring: BSP writes head, AP writes tail */
+    volatile uint32_t head __attribute__((aligned(64)));
+    volatile uint32_t tail __attribute__((aligned(64)));
+    smp_work_t        ring[SMP_WORK_SLOTS];
+} smp_cpu_t;
+
+static smp_cpu_t         _cpus[SMP_MAX_CPUS] __attribute__((aligned(64)));
+static volatile uint32_t _online = 1;
+
+/* ── Heap lock (newlib __malloc_lock hook) ──────────────────────────────── */
+#define SMP_NO_OWNER 0xFFFFFFFFu
+
+static smp_spinlock_t    _heap_spin;
+static volatile uint32_t _heap_owner = SMP_NO_OWNER;
+static uint32_t          _heap_depth;
+
+void smp_heap_lock(void)
+{
+    uint32_t me = smp_cpu_index();
+    if (_heap_owner == me) { _heap_depth++; return; }
+    smp_spin_lock(&_heap_spin);
+    _heap_owner = me;
+    _heap_depth = 1;
+}
+
+void smp_heap_unlock(void)
+{
+    if (_heap_depth == 0 || _heap_owner != smp_cpu_index()) return;
+    if (--_heap_depth == 0) {
+        _heap_owner = SMP_NO_OWNER;
+        smp_spin_unlock(&_heap_spin);
+    }
+}
+
+void smp_heap_lock_reset_if_owner(void)
+{
+    if (_heap_owner != smp_cpu_index()) return;
+    _heap_depth = 0;
+    _heap_owner = SMP_NO_OWNER;
+    smp_spin_unlock(&_heap_spin);
+}
+
+/* ── Fault recovery ─────────────────────────────────────────────────────── */
+
+jmp_buf *smp_fault_arm(void)
+{
+    smp_cpu_t *c = &_cpus[smp_cpu_index()];
+    c->fault_armed = 1;
+    return &c->fault_buf;
+}
+
+void smp_fault_disarm(void)
+{
+    _cpus[smp_cpu_index()].fault_armed = 0;
+}
+
+void smp_ap_exception(uint32_t vector)
+{
+    uint32_t   me = smp_cpu_index();
+    smp_cpu_t *c  = &_cpus[me];
+
+    /* A fault inside malloc would otherwise leave every CPU spinning. */
+    smp_heap_lock_reset_if_owner();
+
+    if (c->fault_armed &&
+        (vector == 0 || vector == 6 || vector == 13 || vector == 14)) {
+        c->fault_armed = 0;
+        /* IF stays clear; the recovery site re-enables interrupts. */
+        longjmp(c->fault_buf, (int)vector + 1);
+    }
+
+    platform_serial_puts("[SMP] unrecoverable fault on AP — CPU taken offline\n");
+    c->busy   = 0;
+    c->online = 0;
+    __atomic_fetch_sub(&_online, 1u, __ATOMIC_RELAXED);
+    for (;;) __asm__ volatile("cli; hlt");
+}
+
+/* ── Interrupt handlers (called from irq_asm.s stubs) ───────────────────── */
+
+void smp_timer_dispatch(void)
+{
+    _cpus[smp_cpu_index()].ticks++;
+    apic_eoi();
+}
+
+void smp_wake_dispatch(void)
+{
+    /* Nothing to do: returning from hlt is the whole point. */
+    apic_eoi();
+}
+
+/* ── AP side ────────────────────────────────────────────────────────────── */
+
+static void smp_ap_loop(smp_cpu_t *c) __attribute__((noreturn));
+static void smp_ap_loop(smp_cpu_t *c)
+{
+    for (;;) {
+        __asm__ volatile("cli");
+        uint32_t tail = c->tail;
+        if (tail == __atomic_load_n(&c->head, __ATOMIC_ACQUIRE)) {
+            /* sti's one-instruction shadow covers hlt: a wake IPI that
+             * arrives after the check above still terminates the hlt. */
+            __asm__ volatile("sti; hlt");
+            continue;
+        }
+        __asm__ volatile("sti");
+        smp_work_t w = c->ring[tail & (SMP_WORK_SLOTS - 1u)];
+        __atomic_store_n(&c->tail, tail + 1u, __ATOMIC_RELEASE);
+
+        c->busy = 1;
+        w.fn(w.arg);
+        c->busy = 0;
+        c->jobs_done++;
+    }
+}
+
+void smp_ap_entry(uint32_t cpu) __attribute__((noreturn));
+void smp_ap_entry(uint32_t cpu)
+{
+    smp_cpu_t *c = &_cpus[cpu];
+
+    struct { uint16_t limit; uint32_t base; } __attribute__((packed)) gdtr = {
+        (uint16_t)(sizeof(c->gdt) - 1u), (uint32_t)c->gdt
+    };
+    __asm__ volatile(
+        "lgdt %0\n\t"
+        "mov $0x10, %%ax\n\t"
+        "mov %%ax, %%ds\n\t"
+        "mov %%ax, %%es\n\t"
+        "mov %%ax, %%fs\n\t"
+        "mov %%ax, %%gs\n\t"
+        "mov %%ax, %%ss\n\t"
+        "ljmp $0x08, $1f\n"
+        "1:"
+        : : "m"(gdtr) : "eax", "memory");
+    __asm__ volatile("ltr %%ax" : : "a"((uint16_t)(0x28u + 8u * cpu)));
+
+    irq_load_idt();
+
+    /* FPU/SSE exactly as crt0.s does for the BSP (CR4 came from the BSP). */
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~(1u << 2);      /* EM off */
+    cr0 |=  (1u << 1);      /* MP on  */
+    __asm__ volatile("mov %0, %%cr0; fninit" : : "r"(cr0));
+
+    apic_enable_local();
+    apic_timer_start_periodic_vec(SMP_TIMER_MS, (uint8_t)SMP_TIMER_VECTOR);
+
+    __atomic_store_n(&c->online, 1u, __ATOMIC_RELEASE);
+    smp_ap_loop(c);
+}
+
+/* ── BSP side ───────────────────────────────────────────────────────────── */
+
+static void _build_gdt(uint32_t cpu)
+{
+    smp_cpu_t *c = &_cpus[cpu];
+    memset(c->gdt, 0, sizeof(c->gdt));
+    memcpy(c->gdt, gdt_start, 5u * sizeof(uint64_t));
+
+    memset(&c->tss, 0, sizeof(c->tss));
+    c->tss.ss0        = 0x10;
+    c->tss.esp0       = c->stack_top;
+    c->tss.iomap_base = (uint16_t)sizeof(tss_t);
+    platform_gdt_encode_tss((uint8_t *)&c->gdt[5u + cpu], &c->tss);
+}
+
+static int _start_ap(uint32_t cpu, uint8_t apic_id)
+{
+    smp_cpu_t *c = &_cpus[cpu];
+    c->apic_id = apic_id;
+
+    /* Page-aligned block from the shared heap.  Not alloc_page_guarded():
+     * the physical page allocator only fences off the first 4 MB, and the
+     * kernel image (render surfaces in .bss) plus the sbrk window sit
+     * above that, so a raw page allocation can alias live kernel memory. */
+    uint32_t stack = (uint32_t)memalign(PAGE_SIZE, SMP_AP_STACK_PAGES * PAGE_SIZE);
+    if (!stack) return 0;
+    c->stack_top = stack + SMP_AP_STACK_PAGES * PAGE_SIZE;
+    _build_gdt(cpu);
+
+    volatile smp_tramp_params_t *tp = (volatile smp_tramp_params_t *)
+        (SMP_TRAMPOLINE_ADDR + (uint32_t)(smp_tramp_params - smp_trampoline_start));
+    uint32_t cr0, cr3, cr4;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    tp->cr3   = (cr0 & 0x80000000u) ? cr3 : 0u;
+    tp->cr4   = cr4;
+    tp->stack = c->stack_top;
+    tp->cpu   = cpu;
+    tp->entry = (uint32_t)smp_ap_entry;
+
+    apic_send_init_ipi(apic_id);
+    timer_sleep(10);
+    for (int i = 0; i < 2 && !c->online; i++) {
+        apic_send_startup_ipi(apic_id, (uint8_t)(SMP_TRAMPOLINE_ADDR >> 12));
+        timer_sleep(1);
+    }
+    uint32_t deadline = timer_get_ms() + SMP_START_WAIT_MS;
+    while (!__atomic_load_n(&c->online, __ATOMIC_ACQUIRE) && timer_get_ms() < deadline)
+        __asm__ volatile("pause");
+    return (int)c->online;
+}
+
+uint32_t smp_init(void)
+{
+    _cpus[0].apic_id = (uint8_t)apic_local_id();
+    _cpus[0].online  = 1;
+    _online = 1;
+
+    if (acpi_info.cpu_count < 2u) {
+        platform_serial_puts("[SMP] single processor\n");
+        return 1;
+    }
+
+    /* AP timers reuse the BSP's bus-clock calibration. */
+    if (!apic_timer_ticks_per_ms()) apic_timer_calibrate();
+
+    irq_set_gate((uint8_t)SMP_TIMER_VECTOR, smp_timer_stub);
+    irq_set_gate((uint8_t)SMP_WAKE_VECTOR,  smp_wake_stub);
+
+    memcpy((void *)SMP_TRAMPOLINE_ADDR, smp_trampoline_start,
+           (size_t)(smp_trampoline_end - smp_trampoline_start));
+
+    uint32_t next = 1;
+    for (uint32_t i = 0; i < acpi_info.cpu_count && next < SMP_MAX_CPUS; i++) {
+        uint8_t id = acpi_info.cpu_apic_ids[i];
+        if (id == _cpus[0].apic_id) continue;
+        if (_start_ap(next, id)) {
+            next++;
+            _online = next;
+        } else {
+            platform_serial_puts("[SMP] AP did not respond to STARTUP IPI\n");
+        }
+    }
+    return _online;
+}
+
+uint32_t smp_cpu_count(void)
+{
+    return _online;
+}
+
+int smp_submit(uint32_t cpu, smp_work_fn_t fn, void *arg)
+{
+    if (cpu == 0 || cpu >= SMP_MAX_CPUS || !fn) return -1;
+    smp_cpu_t *c = &_cpus[cpu];
+    if (!c->online) return -1;
+
+    uint32_t head = c->head;
+    if (head - __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) >= SMP_WORK_SLOTS)
+        return -1;
+    c->ring[head & (SMP_WORK_SLOTS - 1u)].fn  = fn;
+    c->ring[head & (SMP_WORK_SLOTS - 1u)].arg = arg;
+    __atomic_store_n(&c->head, head + 1u, __ATOMIC_RELEASE);
+
+    apic_send_ipi(c->apic_id, (uint8_t)SMP_WAKE_VECTOR);
+    return 0;
+}
+
+int smp_submit_any(smp_work_fn_t fn, void *arg)
+{
+    uint32_t best = 0, best_load = 0xFFFFFFFFu;
+    for (uint32_t i = 1; i < SMP_MAX_CPUS; i++) {
+        smp_cpu_t *c = &_cpus[i];
+        if (!c->online) continue;
+        uint32_t load = (c->head - c->tail) + c->busy;
+        if (load < best_load) { best = i; best_load = load; }
+    }
+    if (!best) return -1;
+    return smp_submit(best, fn, arg) == 0 ? (int)best : -1;
+}
+
+int smp_get_info(uint32_t cpu, smp_cpu_info_t *out)
+{
+    if (cpu >= SMP_MAX_CPUS || !out) return -1;
+    smp_cpu_t *c = &_cpus[cpu];
+    out->apic_id   = c->apic_id;
+    out->online    = (uint8_t)c->online;
+    out->busy      = (uint8_t)c->busy;
+    out->ticks     = cpu == 0 ? timer_get_ticks() : c->ticks;
+    out->jobs_done = c->jobs_done;
+    out->queued    = c->head - c->tail;
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * smp.h — Symmetric multiprocessing: AP bring-up + per-CPU work queues
+ *
+ * Items implemented here:
+ *   31  SMP: INIT-SIPI-SIPI application-processor startup
+ *   49  Per-CPU LAPIC timers
+ *
+ * Each application processor (AP) gets its own GDT (with a private TSS
+ * descriptor), a private kernel stack and a LAPIC timer, then parks in
+ * smp_ap_loop() pulling work items from a lock-free single-producer /
+ * single-consumer ring owned by that CPU.  The BSP is the only producer;
+ * the AP is the only consumer.  A wake IPI (SMP_WAKE_VECTOR) is the
+ * doorbell that gets a halted AP to re-check its ring.
+ *
+ * ARCHITECTURE CONSTRAINT: C provides the mechanism (startup, queues,
+ * IPIs).  Which child runtime runs where is decided in TypeScript.
+ */
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include <setjmp.h>
+
+#define SMP_MAX_CPUS        8u       /* BSP + up to 7 APs                     */
+#define SMP_TRAMPOLINE_ADDR 0x8000u  /* real-mode entry page (SIPI vector 08) */
+#define SMP_AP_STACK_PAGES  160u     /* 640 KB: QuickJS child stack is 512 KB */
+#define SMP_WORK_SLOTS      64u      /* per-CPU ring size, power of two       */
+
+#define SMP_TIMER_VECTOR    0x40u    /* per-AP LAPIC timer                    */
+#define SMP_WAKE_VECTOR     0x41u    /* doorbell IPI: "your ring has work"    */
+
+/* Unit of work handed to an AP.  fn runs on the AP's stack with IF=1. */
+typedef void (*smp_work_fn_t)(void *arg);
+
+typedef struct {
+    smp_work_fn_t fn;
+    void         *arg;
+} smp_work_t;
+
+/* Per-CPU statistics snapshot (kernel.smpInfo()). */
+typedef struct {
+    uint8_t  apic_id;
+    uint8_t  online;
+    uint8_t  busy;         /* 1 while a work item is executing             */
+    uint32_t ticks;        /* LAPIC timer ticks (APs) / PIT ticks (BSP)     */
+    uint32_t jobs_done;
+    uint32_t queued;       /* items waiting in this CPU's ring              */
+} smp_cpu_info_t;
+
+/* Discover processors from the ACPI MADT and start every AP.
+ * Call after acpi_init(), irq_initialize() and timer_initialize().
+ * Returns the number of online CPUs (1 when no AP could be started). */
+uint32_t smp_init(void);
+
+/* Number of CPUs currently online (BSP included). */
+uint32_t smp_cpu_count(void);
+
+/* Logical index of the calling CPU: 0 = BSP, 1..n = APs.
+ * Derived from the task register, so it is a single `str` instruction. */
+static inline uint32_t smp_cpu_index(void)
+{
+    uint16_t tr;
+    __asm__ volatile("str %0" : "=r"(tr));
+    return (tr > 0x28u) ? (uint32_t)(tr - 0x28u) >> 3u : 0u;
+}
+
+/* Queue fn(arg) on CPU `cpu` (1..n).  Returns 0 on success, -1 if the CPU is
+ * offline or its ring is full.  BSP only (single-producer rings). */
+int  smp_submit(uint32_t cpu, smp_work_fn_t fn, void *arg);
+
+/* Queue on the online AP with the fewest pending items.  Returns the chosen
+ * CPU index, or -1 if no AP is online or every ring is full. */
+int  smp_submit_any(smp_work_fn_t fn, void *arg);
+
+/* Fill *out for CPU `cpu`.  Returns 0, or -1 for an invalid index. */
+int  smp_get_info(uint32_t cpu, smp_cpu_info_t *out);
+
+/* ── Per-CPU fault recovery ─────────────────────────────────────────────── */
+/* A work function may arm a recovery point with SMP_FAULT_TRY(); a CPU
+ * exception (#DE/#UD/#GP/#PF) on that AP then longjmps back to it instead
+ * of using the BSP-owned _js_fault_buf.  Faults with no armed recovery
+ * point take the AP offline (it parks in cli;hlt).
+ *
+ *   if (SMP_FAULT_TRY() != 0) { ...recovered, IF is clear... }
+ *   ...work...
+ *   smp_fault_disarm();
+ */
+jmp_buf *smp_fault_arm(void);
+void     smp_fault_disarm(void);
+#define  SMP_FAULT_TRY()  setjmp(*smp_fault_arm())
+
+/* Called by exception_dispatch() for faults taken on an AP.  Never returns. */
+void smp_ap_exception(uint32_t vector) __attribute__((noreturn));
+
+/* ── Spinlocks ──────────────────────────────────────────────────────────── */
+typedef struct { volatile uint32_t locked; } smp_spinlock_t;
+
+static inline void smp_spin_lock(smp_spinlock_t *l)
+{
+    while (__atomic_exchange_n(&l->locked, 1u, __ATOMIC_ACQUIRE))
+        while (__atomic_load_n(&l->locked, __ATOMIC_RELAXED))
+            __asm__ volatile("pause");
+}
+
+static inline void smp_spin_unlock(smp_spinlock_t *l)
+{
+    __atomic_store_n(&l->locked, 0u, __ATOMIC_RELEASE);
+}
+
+/* Recursive heap lock used by newlib's __malloc_lock hook (syscalls.c).
+ * Force-released by fault recovery when the faulting CPU owns it. */
+void smp_heap_lock(void);
+void smp_heap_unlock(void);
+void smp_heap_lock_reset_if_owner(void);
+
+#endif /* SMP_H */
@@ -0,0 +1,83 @@
+; smp_trampoline.s - Application-processor real-mode entry (item 31)
+;
+; smp_init() copies [smp_trampoline_start, smp_trampoline_end) to physical
+; SMP_TRAMPOLINE_ADDR (0x8000) and fills in smp_tramp_params before sending
+; INIT-SIPI-SIPI.  A started AP begins executing at 0x0800:0000 in 16-bit
+; real mode, switches to flat 32-bit protected mode with a private
+; temporary GDT, optionally enables paging with the BSP's CR3, loads its
+; own stack and calls the C entry point:
+;
+;     void smp_ap_entry(uint32_t cpu);
+;
+; The code is copied, so every absolute reference goes through REL(), which
+; rebases a label onto the copy at TRAMP_BASE.
+
+%define TRAMP_BASE 0x8000
+%define REL(x) (TRAMP_BASE + (x) - smp_trampoline_start)
+
+global smp_trampoline_start
+global smp_trampoline_end
+global smp_tramp_params
+
+section .text
+
+bits 16
+smp_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    lgdt [REL(tramp_gdtr)]
+    mov eax, cr0
+    or  eax, 1                      ; CR0.PE
+    mov cr0, eax
+    jmp dword 0x08:REL(tramp_pm)
+
+bits 32
+tramp_pm:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov eax, [REL(tp_cr4)]          ; OSFXSR/OSXMMEXCPT (+PSE/PAE) as on BSP
+    mov cr4, eax
+    mov eax, [REL(tp_cr3)]
+    test eax, eax
+    jz  .no_paging
+    mov cr3, eax
+    mov eax, cr0
+    or  eax, 0x80000000             ; CR0.PG
+    mov cr0, eax
+.no_paging:
+    mov esp, [REL(tp_stack)]
+    push dword [REL(tp_cpu)]
+    mov eax, [REL(tp_entry)]
+    call eax                        ; smp_ap_entry(cpu) - never returns
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+align 8
+tramp_gdt:
+    dq 0x0000000000000000           ; null
+    dq 0x00CF9A000000FFFF           ; 0x08 flat code, ring 0
+    dq 0x00CF92000000FFFF           ; 0x10 flat data, ring 0
+tramp_gdtr:
+    dw tramp_gdtr - tramp_gdt - 1
+    dd REL(tramp_gdt)
+
+; Patched by smp.c for each AP (layout = smp_tramp_params_t).
+align 4
+smp_tramp_params:
+tp_cr3:   dd 0
+tp_cr4:   dd 0
+tp_stack: dd 0
+tp_cpu:   dd 0
+tp_entry: dd 0
+smp_trampoline_end:
@@ -9,6 +9,7 @@
 #include <stddef.h>
 #include <setjmp.h>
 #include "platform.h"
+#include "smp.h"
 
 #undef errno
 extern int errno;
@@ -34,6 +35,13 @@ void abort(void)
     for(;;) __asm__ volatile("hlt");
 }
 
+/* newlib calls these around every malloc/free/realloc.  The default hooks
+ * are no-ops; once application processors are online the heap is shared,
+ * so route them through the recursive SMP heap lock (item 31). */
+struct _reent;
+void __malloc_lock(struct _reent *r)   { (void)r; smp_heap_lock(); }
+void __malloc_unlock(struct _reent *r) { (void)r; smp_heap_unlock(); }
+
 // Environment variables
 char *__env[1] = { 0 };
 char **environ = __env;
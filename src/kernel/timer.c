@@ -3,6 +3,7 @@
 #include "irq.h"
 #include "io.h"
 #include "watchdog.h"
+#include "kthread.h"
 #include <stddef.h>
 
 /* PIT ports */
@@ -26,6 +27,7 @@ static void timer_irq_handler(void) {
     timer_ticks++;
     _preempt_counter++;
     watchdog_tick();    /* decrement watchdog countdown every ms (item 107) */
+    kthread_timer_tick(timer_ticks);   /* wake timed-out kernel-thread sleepers */
 }
 
 void timer_initialize(uint32_t frequency_hz) {
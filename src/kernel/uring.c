@@ -0,0 +1,304 @@
+/*
+ * uring.c — io_uring-style SQ/CQ dispatcher (see uring.h)
+ *
+ * uring_enter() walks the published SQEs in order.  Runs of virtio-blk
+ * SQEs are gathered into one virtio_blk_submit() batch (one queue notify);
+ * physically contiguous neighbours — next sector, next bytes of the same
+ * fixed buffer — are merged into a single request first.  Everything else
+ * is handed to its driver one SQE at a time.
+ *
+ * IO_LINK: an SQE carrying the flag ends the batch it is in, so its result
+ * is known before its successor is looked at.  If it failed, every SQE up
+ * to and including the end of the chain completes with -ECANCELED.
+ *
+ * Memory ordering: sq_tail is read with acquire before any SQE is copied
+ * out; CQEs are written before a release store of cq_tail, and sq_head is
+ * released only once the consumed SQEs' CQEs are visible.
+ */
+
+#include "uring.h"
+#include "virtio_blk.h"
+#include "virtio_net.h"
+#include "ata.h"
+#include <string.h>
+
+#define U_EIO        5
+#define U_EAGAIN    11
+#define U_EFAULT    14
+#define U_ENODEV    19
+#define U_EINVAL    22
+#define U_ENOSYS    38
+#define U_ECANCELED 125
+
+#define SECTOR           512u
+#define MERGE_MAX_SECT   256u       /* 128 KB per merged virtio request */
+#define NET_FRAME_MAX    1514u
+
+static uint8_t _uring_rx[NET_FRAME_MAX];
+
+uint32_t uring_region_bytes(uint32_t entries)
+{
+    return URING_HDR_BYTES + entries * URING_SQE_BYTES
+                           + 2u * entries * URING_CQE_BYTES;
+}
+
+void uring_setup(uring_t *u, void *mem, uint32_t entries)
+{
+    uint8_t *base = (uint8_t *)mem;
+    memset(u, 0, sizeof(*u));
+    u->hdr  = (uring_hdr_t *)base;
+    u->sqes = (uring_sqe_t *)(base + URING_HDR_BYTES);
+    u->cqes = (uring_cqe_t *)(base + URING_HDR_BYTES + entries * URING_SQE_BYTES);
+
+    u->sq_mask = entries - 1u;
+    u->cq_mask = entries * 2u - 1u;
+    u->hdr->sq_entries = entries;
+    u->hdr->sq_mask    = entries - 1u;
+    u->hdr->sqe_off    = URING_HDR_BYTES;
+    u->hdr->cq_entries = entries * 2u;
+    u->hdr->cq_mask    = entries * 2u - 1u;
+    u->hdr->cqe_off    = URING_HDR_BYTES + entries * URING_SQE_BYTES;
+}
+
+int uring_register_buf(uring_t *u, uint32_t idx, uint8_t *base, uint32_t size)
+{
+    if (idx >= URING_MAX_BUFS) return -1;
+    u->bufs[idx].base = base;
+    u->bufs[idx].size = base ? size : 0u;
+    return 0;
+}
+
+/* ── Helpers ─────────────────────────────────────────────────────────────── */
+
+static void _post(uring_t *u, const uring_sqe_t *s, int32_t res)
+{
+    uring_hdr_t *h = u->hdr;
+    uring_cqe_t *c = &u->cqes[h->cq_tail & u->cq_mask];
+    c->user_data    = s->user_data;
+    c->user_data_hi = s->user_data_hi;
+    c->res          = res;
+    c->flags        = 0;
+    /* CQE contents before the tail that publishes them */
+    __atomic_store_n(&h->cq_tail, h->cq_tail + 1u, __ATOMIC_RELEASE);
+    u->sqes_done++;
+    if (res == -U_EINVAL || res == -U_EFAULT) h->sq_dropped++;
+}
+
+/* Resolve an SQE's fixed-buffer range.  NULL if it is out of bounds. */
+static uint8_t *_buf(uring_t *u, const uring_sqe_t *s)
+{
+    if (s->buf_index >= URING_MAX_BUFS) return 0;
+    const uring_buf_t *b = &u->bufs[s->buf_index];
+    if (!b->base || s->addr > b->size || s->len > b->size - s->addr) return 0;
+    return b->base + s->addr;
+}
+
+/* Checks shared by every block SQE; 0 when it may be issued. */
+static int32_t _blk_check(uring_t *u, const uring_sqe_t *s)
+{
+    if (s->opcode == URING_OP_FSYNC) return 0;
+    if (s->opcode != URING_OP_READ_FIXED && s->opcode != URING_OP_WRITE_FIXED)
+        return -U_EINVAL;
+    if (s->len == 0 || (s->len % SECTOR) != 0) return -U_EINVAL;
+    if (!_buf(u, s)) return -U_EFAULT;
+    return 0;
+}
+
+static int _is_vblk(const uring_sqe_t *s)
+{
+    return (s->flags & URING_SQE_FIXED_FILE) && s->fd == URING_DEV_VIRTIO_BLK;
+}
+
+/* ── Per-device execution ────────────────────────────────────────────────── */
+
+static int32_t _do_ata(uring_t *u, const uring_sqe_t *s)
+{
+    int32_t err = _blk_check(u, s);
+    if (err) return err;
+    if (!ata_present()) return -U_ENODEV;
+    if (s->opcode == URING_OP_FSYNC) return 0;     /* PIO writes complete synchronously */
+
+    uint32_t lba   = s->off_lo;
+    uint32_t nsect = s->len / SECTOR;
+    if (s->off_hi || lba + nsect > (1u << 28) || lba + nsect < lba) return -U_EINVAL;
+
+    uint8_t *p = _buf(u, s);
+    u->driver_calls++;
+    while (nsect) {
+        uint8_t n = (uint8_t)(nsect > 8u ? 8u : nsect);
+        int rc = (s->opcode == URING_OP_READ_FIXED)
+               ? ata_read28(lba, n, (uint16_t *)p)
+               : ata_write28(lba, n, (const uint16_t *)p);
+        if (rc != 0) return -U_EIO;
+        lba += n; nsect -= n; p += (uint32_t)n * SECTOR;
+    }
+    return (int32_t)s->len;
+}
+
+static int32_t _do_net(uring_t *u, const uring_sqe_t *s)
+{
+    if (!virtio_net_ready) return -U_ENODEV;
+    if (s->opcode != URING_OP_SEND && s->opcode != URING_OP_RECV) return -U_EINVAL;
+    if (s->len == 0) return -U_EINVAL;
+    uint8_t *p = _buf(u, s);
+    if (!p) return -U_EFAULT;
+
+    u->driver_calls++;
+    if (s->opcode == URING_OP_SEND) {
+        if (s->len > NET_FRAME_MAX) return -U_EINVAL;
+        virtio_net_send(p, (uint16_t)s->len);
+        return (int32_t)s->len;
+    }
+    uint16_t n = virtio_net_recv(_uring_rx);
+    if (n == 0) return -U_EAGAIN;
+    if (n > s->len) n = (uint16_t)s->len;      /* truncated, like recv(2) */
+    memcpy(p, _uring_rx, n);
+    return (int32_t)n;
+}
+
+static int32_t _do_one(uring_t *u, const uring_sqe_t *s)
+{
+    if (s->opcode == URING_OP_NOP) return 0;
+    if (!(s->flags & URING_SQE_FIXED_FILE)) return -U_EINVAL;
+    switch (s->fd) {
+    case URING_DEV_ATA: return _do_ata(u, s);
+    case URING_DEV_NET: return _do_net(u, s);
+    default:            return -U_ENOSYS;
+    }
+}
+
+/* ── virtio-blk batches ──────────────────────────────────────────────────── */
+
+/*
+ * Gather up to `max` SQEs starting at sq index `head` into at most
+ * VBLK_MAX_BATCH requests, submit them with one notify and post every CQE.
+ * Stops early at a non-virtio SQE or after an IO_LINK SQE.  Returns the
+ * number of SQEs consumed (>= 1).
+ */
+static uint32_t _vblk_batch(uring_t *u, uint32_t head, uint32_t max)
+{
+    virtio_blk_req_t reqs[VBLK_MAX_BATCH];
+    uint16_t         first[VBLK_MAX_BATCH];   /* SQE offset of each request */
+    uint16_t         nsqe[VBLK_MAX_BATCH];
+    int32_t          early[VBLK_MAX_BATCH];   /* validation error, or 0     */
+    uint32_t         nreq = 0, taken = 0;
+
+    while (taken < max) {
+        const uring_sqe_t *s = &u->sqes[(head + taken) & u->sq_mask];
+        if (!_is_vblk(s)) break;
+
+        /* Merge into the previous request when physically contiguous. */
+        if (nreq) {
+            virtio_blk_req_t *r = &reqs[nreq - 1u];
+            const uring_sqe_t *prev = &u->sqes[(head + taken - 1u) & u->sq_mask];
+            uint32_t want = (s->opcode == URING_OP_READ_FIXED) ? VIRTIO_BLK_T_IN
+                          : (s->opcode == URING_OP_WRITE_FIXED) ? VIRTIO_BLK_T_OUT : 0xFFu;
+            uint64_t sector = ((uint64_t)s->off_hi << 32) | s->off_lo;
+            if (!early[nreq - 1u] && r->type == want && _blk_check(u, s) == 0 &&
+                sector == r->sector + r->count &&
+                _buf(u, s) == (uint8_t *)r->buf + r->count * SECTOR &&
+                r->count + s->len / SECTOR <= MERGE_MAX_SECT &&
+                !(prev->flags & URING_SQE_IO_LINK)) {
+                r->count += s->len / SECTOR;
+                nsqe[nreq - 1u]++;
+                taken++;
+                if (s->flags & URING_SQE_IO_LINK) break;
+                continue;
+            }
+        }
+        if (nreq == VBLK_MAX_BATCH) break;
+
+        virtio_blk_req_t *r = &reqs[nreq];
+        early[nreq] = _blk_check(u, s);
+        first[nreq] = (uint16_t)taken;
+        nsqe[nreq]  = 1u;
+        r->sector   = ((uint64_t)s->off_hi << 32) | s->off_lo;
+        r->buf      = _buf(u, s);
+        r->count    = (s->opcode == URING_OP_FSYNC) ? 0u : s->len / SECTOR;
+        r->type     = (s->opcode == URING_OP_READ_FIXED)  ? VIRTIO_BLK_T_IN
+                    : (s->opcode == URING_OP_WRITE_FIXED) ? VIRTIO_BLK_T_OUT
+                                                          : VIRTIO_BLK_T_FLUSH;
+        r->result   = 0;
+        nreq++;
+        taken++;
+        if (s->flags & URING_SQE_IO_LINK) break;
+    }
+
+    /* Submit only the requests that passed validation, in order. */
+    virtio_blk_req_t live[VBLK_MAX_BATCH];
+    uint32_t nlive = 0;
+    for (uint32_t i = 0; i < nreq; i++)
+        if (!early[i]) live[nlive++] = reqs[i];
+    if (nlive) {
+        if (virtio_blk_present()) {
+            virtio_blk_submit(live, nlive);
+            u->driver_calls++;
+        } else {
+            for (uint32_t i = 0; i < nlive; i++) live[i].result = -2;
+        }
+    }
+
+    for (uint32_t i = 0, li = 0; i < nreq; i++) {
+        int32_t rc = early[i];
+        if (!rc) {
+            int32_t r = live[li++].result;
+            rc = (r == 0) ? 0 : (r == -2) ? -U_ENODEV : -U_EIO;
+        }
+        for (uint32_t k = 0; k < nsqe[i]; k++) {
+            const uring_sqe_t *s = &u->sqes[(head + first[i] + k) & u->sq_mask];
+            _post(u, s, rc ? rc : (s->opcode == URING_OP_FSYNC ? 0 : (int32_t)s->len));
+        }
+    }
+    return taken;
+}
+
+/* ── Dispatcher ──────────────────────────────────────────────────────────── */
+
+uint32_t uring_enter(uring_t *u, uint32_t to_submit)
+{
+    uring_hdr_t *h = u->hdr;
+    uint32_t tail  = __atomic_load_n(&h->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t head  = h->sq_head;
+    uint32_t done  = 0;
+
+    u->enters++;
+    if (tail - head > u->sq_mask + 1u) tail = head + u->sq_mask + 1u;   /* corrupt tail */
+
+    while (done < to_submit && head != tail) {
+        uint32_t used = h->cq_tail - __atomic_load_n(&h->cq_head, __ATOMIC_ACQUIRE);
+        uint32_t room = (used < u->cq_mask + 1u) ? u->cq_mask + 1u - used : 0u;
+        if (room == 0) { h->cq_overflow++; break; }
+
+        const uring_sqe_t *s = &u->sqes[head & u->sq_mask];
+        uint32_t n;
+
+        if (u->link_failed) {
+            _post(u, s, -U_ECANCELED);
+            u->link_failed = (s->flags & URING_SQE_IO_LINK) != 0;
+            n = 1;
+        } else if (_is_vblk(s)) {
+            uint32_t max = to_submit - done;
+            if (max > tail - head) max = tail - head;
+            if (max > room) max = room;
+            n = _vblk_batch(u, head, max);
+            /* A batch ends at its only possible link head; check it. */
+            const uring_sqe_t *last = &u->sqes[(head + n - 1u) & u->sq_mask];
+            if (last->flags & URING_SQE_IO_LINK) {
+                const uring_cqe_t *c = &u->cqes[(h->cq_tail - 1u) & u->cq_mask];
+                u->link_failed = c->res < 0;
+            }
+        } else {
+            int32_t rc = _do_one(u, s);
+            _post(u, s, rc);
+            u->link_failed = rc < 0 && (s->flags & URING_SQE_IO_LINK);
+            n = 1;
+        }
+        head += n;
+        done += n;
+        __atomic_store_n(&h->sq_head, head, __ATOMIC_RELEASE);
+    }
+    /* A chain never spans submissions: once the SQ is drained, the next
+     * SQE starts fresh.  Left set when the CQ filled mid-chain. */
+    if (head == tail) u->link_failed = 0;
+    return done;
+}
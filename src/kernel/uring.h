@@ -0,0 +1,129 @@
+/*
+ * uring.h — io_uring-style submission/completion rings
+ *
+ * One ring is a single shared-memory region (a kernel.sharedBufferCreate
+ * region, so TypeScript maps it zero-copy):
+ *
+ *   [ uring_hdr_t  128 B ][ SQE array: entries × 32 B ][ CQE array: 2·entries × 16 B ]
+ *
+ * TypeScript fills SQEs and publishes them by advancing sq_tail, then makes
+ * one kernel.uringEnter() call for the whole batch.  The dispatcher below
+ * consumes SQEs, hands them to the block / net drivers in batches, writes
+ * one CQE per SQE and advances cq_tail.  TypeScript reaps CQEs straight
+ * from shared memory (advancing cq_head) without another call, so a batch
+ * costs one JS→C transition whatever its size.
+ *
+ * Buffers: I/O goes to and from registered ("fixed") buffers only —
+ * page-aligned shared regions whose address the kernel resolves once at
+ * registration.  An SQE names one with buf_index plus a byte offset (addr).
+ *
+ * Devices are addressed through a fixed file table (fd = URING_DEV_*).
+ *
+ * Completion is polled: the drivers spin on the device's status, so every
+ * CQE for a batch exists when uringEnter() returns.
+ *
+ * ARCHITECTURE CONSTRAINT: C provides the ring transport and the driver
+ * hand-off; request building, buffer policy and Promise plumbing live in
+ * process/asyncio.ts.
+ */
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+
+#define URING_MIN_ENTRIES   8u
+#define URING_MAX_ENTRIES   4096u
+#define URING_MAX_BUFS      16u
+#define URING_HDR_BYTES     128u
+#define URING_SQE_BYTES     32u
+#define URING_CQE_BYTES     16u
+
+/* Opcodes (same numbering as IoUringOp in process/asyncio.ts) */
+#define URING_OP_NOP          0u
+#define URING_OP_READ_FIXED   3u
+#define URING_OP_WRITE_FIXED  4u
+#define URING_OP_FSYNC        7u
+#define URING_OP_RECV        10u
+#define URING_OP_SEND        11u
+
+/* SQE flags */
+#define URING_SQE_FIXED_FILE  0x01u  /* fd is a URING_DEV_* device           */
+#define URING_SQE_IO_LINK     0x04u  /* next SQE runs only if this succeeds  */
+
+/* Fixed file table */
+#define URING_DEV_ATA         0
+#define URING_DEV_VIRTIO_BLK  1
+#define URING_DEV_NET         2
+
+typedef struct {
+    /* submission side: tail written by TS, head by the kernel */
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    uint32_t          sq_mask;
+    uint32_t          sq_entries;
+    volatile uint32_t sq_dropped;    /* malformed SQEs (failed -EINVAL/-EFAULT) */
+    uint32_t          sqe_off;       /* byte offset of the SQE array         */
+    uint32_t          _pad0[10];
+    /* completion side: tail written by the kernel, head by TS */
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t          cq_mask;
+    uint32_t          cq_entries;
+    volatile uint32_t cq_overflow;   /* submissions deferred for lack of CQ room */
+    uint32_t          cqe_off;
+    uint32_t          _pad1[10];
+} uring_hdr_t;
+
+typedef struct {
+    uint8_t  opcode;
+    uint8_t  flags;
+    uint16_t buf_index;
+    int32_t  fd;
+    uint32_t off_lo;        /* starting sector for block devices          */
+    uint32_t off_hi;
+    uint32_t addr;          /* byte offset inside the registered buffer   */
+    uint32_t len;           /* bytes                                      */
+    uint32_t user_data;     /* echoed in the CQE                          */
+    uint32_t user_data_hi;
+} uring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    uint32_t user_data_hi;
+    int32_t  res;           /* bytes / 0, or -errno                       */
+    uint32_t flags;
+} uring_cqe_t;
+
+typedef struct {
+    uint8_t  *base;
+    uint32_t  size;
+} uring_buf_t;
+
+typedef struct {
+    uring_hdr_t *hdr;
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+    uint32_t     sq_mask;       /* private copies: the shared header is   */
+    uint32_t     cq_mask;       /* writable from TypeScript               */
+    uring_buf_t  bufs[URING_MAX_BUFS];
+    int          link_failed;   /* rest of the current IO_LINK chain is cancelled */
+    /* statistics */
+    uint32_t     enters;
+    uint32_t     sqes_done;
+    uint32_t     driver_calls;  /* device hand-offs (a merged run counts once) */
+} uring_t;
+
+/* Bytes of shared memory needed for `entries` SQEs (a power of two). */
+uint32_t uring_region_bytes(uint32_t entries);
+
+/* Lay the ring out over `mem` (zeroed, at least uring_region_bytes()). */
+void uring_setup(uring_t *u, void *mem, uint32_t entries);
+
+/* Fixed buffer table.  Returns 0, or -1 for a bad index. */
+int  uring_register_buf(uring_t *u, uint32_t idx, uint8_t *base, uint32_t size);
+
+/* Consume up to `to_submit` published SQEs (fewer if the CQ is short of
+ * room) and post their CQEs.  Returns the number of SQEs consumed. */
+uint32_t uring_enter(uring_t *u, uint32_t to_submit);
+
+#endif /* URING_H */
@@ -3,8 +3,13 @@
  *
  * Follows the same legacy virtio pattern as virtio_net.c.
  * Queue size: 64 descriptors.
- * Single transfer in-flight at a time (no async pipelining — TypeScript
- * scheduler handles concurrency above this layer).
+ * virtio_blk_transfer() keeps one request in flight; virtio_blk_submit()
+ * posts a whole batch (up to 21 chains) behind one queue notify for the
+ * io_uring dispatcher (uring.c).
+ *
+ * Completion: when the PCI interrupt line can be bound (kthread_irq_bind)
+ * the caller sleeps on a wait queue until the device's IRQ; without
+ * one it spin-polls the status bytes as before.
  */
 
 #include "virtio_blk.h"
@@ -12,6 +17,7 @@
 #include "io.h"
 #include "platform.h"
 #include "memory.h"
+#include "kthread.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -78,12 +84,44 @@ static uint16_t _used_idx_last  = 0;  /* last used.idx we've seen            */
 
 /* Header + status buffers for transfer (one in-flight at a time) */
 static virtio_blk_req_hdr_t _req_hdr;
-static uint8_t              _req_status;
+static volatile uint8_t     _req_status;
+
+/* IRQ-driven completion */
+static kwaitq_t _vblk_wq        = KWAITQ_INIT;
+static int      _vblk_irq_bound = 0;
+
+#define VBLK_TIMEOUT_MS  500u
+
+static void _vblk_irq_ack(void) {
+    /* Reading ISR status deasserts the (level-triggered) line */
+    (void)inb((uint16_t)(_vblk_iobase + VBLK_ISR_STATUS));
+}
+
+static int _vblk_status_done(void *arg) {
+    return *(volatile uint8_t *)arg != 0xFFu;
+}
+
+/* A chain whose wait timed out still owns its descriptors and buffers
+ * until the device moves it to the used ring. */
+static int _vblk_busy(void) {
+    return *(volatile uint16_t *)&_used->idx != _avail->idx;
+}
+
+/* Wait for the device to write *status.  Returns 0 on completion. */
+static int _vblk_wait(volatile uint8_t *status) {
+    if (_vblk_irq_bound)
+        return kwait_until(&_vblk_wq, _vblk_status_done, (void *)status,
+                           VBLK_TIMEOUT_MS) ? 0 : -1;
+    int timeout = 500000;
+    while (*status == 0xFFu && --timeout > 0)
+        __asm__ volatile("pause");
+    return *status == 0xFFu ? -1 : 0;
+}
 
 int virtio_blk_init(void) {
     /* Find PCI vendor=0x1AF4 device=0x1001 (legacy virtio-blk) */
     pci_device_t dev;
-    if (pci_find_device(0x1AF4, 0x1001, &dev) != 0) {
+    if (!pci_find_device(0x1AF4, 0x1001, &dev)) {
         platform_serial_puts("[VBLK] No virtio-blk device found\n");
         return -1;
     }
@@ -129,7 +167,10 @@ int virtio_blk_init(void) {
     _vblk_present  = 1;
     _avail_idx     = 0;
     _used_idx_last = 0;
-    platform_serial_puts("[VBLK] virtio-blk ready\n");
+    _vblk_irq_bound = dev.irq_line != 0xFFu &&
+                      kthread_irq_bind(dev.irq_line, &_vblk_wq, _vblk_irq_ack) == 0;
+    platform_serial_puts(_vblk_irq_bound ? "[VBLK] virtio-blk ready (IRQ)\n"
+                                         : "[VBLK] virtio-blk ready (polled)\n");
     return 0;
 }
 
@@ -141,7 +182,7 @@ uint16_t virtio_blk_io_base(void) { return _vblk_iobase; }
 
 int virtio_blk_transfer(uint32_t type, uint64_t sector,
                         void *buf, uint32_t count) {
-    if (!_vblk_present || !buf || count == 0) return -1;
+    if (!_vblk_present || !buf || count == 0 || _vblk_busy()) return -1;
 
     /* Build 3-descriptor chain: [header] → [data] → [status] */
     _req_hdr.type   = type;
@@ -167,7 +208,7 @@ int virtio_blk_transfer(uint32_t type, uint64_t sector,
     _desc[d1].next  = d2;
 
     /* Descriptor 2: status byte (device writes result) */
-    _desc[d2].addr  = (uint64_t)(uint32_t)&_req_status;
+    _desc[d2].addr  = (uint64_t)(uint32_t)(uintptr_t)&_req_status;
     _desc[d2].len   = 1;
     _desc[d2].flags = VRING_F_WRITE;
     _desc[d2].next  = 0;
@@ -182,11 +223,68 @@ int virtio_blk_transfer(uint32_t type, uint64_t sector,
     /* Kick queue 0 */
     outw((uint16_t)(_vblk_iobase + VBLK_QUEUE_NOTIFY), 0);
 
-    /* Spin-poll used ring for completion (timeout ~500ms at PIT 1kHz) */
-    int timeout = 500000;
-    while (_req_status == 0xFFu && --timeout > 0)
-        __asm__ volatile("pause");
-
-    if (timeout == 0 || _req_status != VIRTIO_BLK_S_OK) return -1;
+    /* Sleep until the completion IRQ (or spin-poll without one) */
+    if (_vblk_wait(&_req_status) != 0 || _req_status != VIRTIO_BLK_S_OK) return -1;
     return 0;
 }
+
+/* ── Batched submission ────────────────────────────────────────────────── */
+
+static virtio_blk_req_hdr_t _batch_hdr[VBLK_MAX_BATCH];
+static volatile uint8_t     _batch_status[VBLK_MAX_BATCH];
+
+int virtio_blk_submit(virtio_blk_req_t *reqs, uint32_t n) {
+    if (n > VBLK_MAX_BATCH) n = VBLK_MAX_BATCH;
+    if (!_vblk_present || _vblk_busy()) {
+        for (uint32_t i = 0; i < n; i++) reqs[i].result = -1;
+        return 0;
+    }
+    if (n == 0) return 0;
+
+    /* The queue is idle (checked above), so chain i can own
+     * descriptors 3i .. 3i+2 outright. */
+    for (uint32_t i = 0; i < n; i++) {
+        virtio_blk_req_t *r = &reqs[i];
+        uint16_t d0 = (uint16_t)(i * 3u), d1 = (uint16_t)(d0 + 1u), d2 = (uint16_t)(d0 + 2u);
+
+        _batch_hdr[i].type   = r->type;
+        _batch_hdr[i].ioprio = 0;
+        _batch_hdr[i].sector = r->sector;
+        _batch_status[i]     = 0xFFu;
+
+        _desc[d0].addr  = (uint64_t)(uint32_t)&_batch_hdr[i];
+        _desc[d0].len   = sizeof(_batch_hdr[i]);
+        _desc[d0].flags = VRING_F_NEXT;
+        if (r->type == VIRTIO_BLK_T_FLUSH || r->count == 0) {
+            _desc[d0].next = d2;                 /* header → status only */
+        } else {
+            _desc[d0].next  = d1;
+            _desc[d1].addr  = (uint64_t)(uint32_t)r->buf;
+            _desc[d1].len   = r->count * 512u;
+            _desc[d1].flags = (uint16_t)(VRING_F_NEXT |
+                               (r->type == VIRTIO_BLK_T_IN ? VRING_F_WRITE : 0));
+            _desc[d1].next  = d2;
+        }
+        _desc[d2].addr  = (uint64_t)(uint32_t)&_batch_status[i];
+        _desc[d2].len   = 1;
+        _desc[d2].flags = VRING_F_WRITE;
+        _desc[d2].next  = 0;
+
+        _avail->ring[(uint16_t)(_avail->idx + i) % VBLK_QUEUE_SIZE_DEF] = d0;
+    }
+    __asm__ volatile("" ::: "memory");
+    _avail->idx = (uint16_t)(_avail->idx + n);
+
+    /* One kick for the whole batch */
+    outw((uint16_t)(_vblk_iobase + VBLK_QUEUE_NOTIFY), 0);
+
+    /* Wait on every status byte in turn; later ones are usually done by
+     * the time the earlier ones are. */
+    int ok = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        (void)_vblk_wait(&_batch_status[i]);
+        reqs[i].result = (_batch_status[i] == VIRTIO_BLK_S_OK) ? 0 : -1;
+        if (reqs[i].result == 0) ok++;
+    }
+    return ok;
+}
@@ -80,7 +80,8 @@ uint64_t virtio_blk_sector_count(void);
  * sector   : starting LBA
  * buf      : data buffer (must be valid physical memory)
  * count    : number of 512-byte sectors
- * Returns 0 on success, -1 on error.
+ * Returns 0 on success, -1 on error (or while a timed-out request is
+ * still outstanding).
  *
  * NOTE: TypeScript implements the async multi-request queue;
  * this function provides the single-shot synchronous transfer primitive.
@@ -88,6 +89,26 @@ uint64_t virtio_blk_sector_count(void);
 int virtio_blk_transfer(uint32_t type, uint64_t sector,
                         void *buf, uint32_t count);
 
+/** One request of a batch (virtio_blk_submit). */
+typedef struct {
+    uint32_t type;      /* VIRTIO_BLK_T_IN / _OUT / _FLUSH                 */
+    uint64_t sector;
+    void    *buf;       /* unused for FLUSH                                */
+    uint32_t count;     /* 512-byte sectors; 0 for FLUSH                   */
+    int32_t  result;    /* out: 0 on success, -1 on error / timeout        */
+} virtio_blk_req_t;
+
+#define VBLK_MAX_BATCH  21u   /* 64 descriptors / 3 per request chain      */
+
+/**
+ * Post up to VBLK_MAX_BATCH requests as independent descriptor chains with
+ * a single queue notify, then poll until every status byte is written.
+ * Fills each req->result; returns the number that succeeded.  Fails every
+ * request while an earlier, timed-out request is still on the queue.
+ * (io_uring dispatcher)
+ */
+int virtio_blk_submit(virtio_blk_req_t *reqs, uint32_t n);
+
 /** Convenience wrappers */
 static inline int virtio_blk_read (uint64_t sector, void *buf, uint32_t n)
     { return virtio_blk_transfer(VIRTIO_BLK_T_IN,  sector, buf, n); }
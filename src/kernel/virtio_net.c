@@ -6,6 +6,10 @@
  *   - Probes PCI for vendor=0x1AF4 device=0x1000
  *   - Initialises the two split-ring virtqueues
  *   - Provides virtio_net_send() and virtio_net_recv()
+ *   - Runs the "knetrxd" kernel thread: it sleeps on the device's
+ *     IRQ wait queue, moves arrived frames into a backlog ring and returns
+ *     their descriptors to the device at once, then wakes readers blocked
+ *     in virtio_net_wait_rx()
  *
  * Ring layout (QUEUE_SIZE = 64):
  *   [ desc[64] (1024 B) | avail (132 B) | padding (2940 B) | used (518 B) ]
@@ -16,6 +20,7 @@
 #include "pci.h"
 #include "io.h"
 #include "platform.h"
+#include "kthread.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -154,6 +159,21 @@ static uint16_t  io_base  = 0;   /* BAR0 I/O port base */
 static uint16_t  rx_last_used = 0;
 static uint16_t  tx_next_desc = 0;   /* round-robin TX slot */
 
+/* ── RX thread + backlog ─────────────────────────────────────────────────── */
+#define RX_BACKLOG   128            /* frames (power of two)                    */
+#define RX_FRAME_MAX 1514
+
+static uint8_t   rx_backlog[RX_BACKLOG][RX_FRAME_MAX];
+static uint16_t  rx_backlog_len[RX_BACKLOG];
+static volatile uint32_t rx_bl_head = 0;   /* next frame to hand out          */
+static volatile uint32_t rx_bl_tail = 0;   /* next free slot                  */
+
+static kwaitq_t  rx_irq_wq   = KWAITQ_INIT; /* knetrxd: device has frames    */
+static kwaitq_t  rx_ready_wq = KWAITQ_INIT; /* readers: a frame is available */
+static int       rx_thread   = -1;
+
+static void _rx_thread_start(uint8_t irq_line);
+
 /* ── Helpers ─────────────────────────────────────────────────────────────── */
 static inline uint32_t va_to_pfn(const void *p)
 {
@@ -256,6 +276,7 @@ int virtio_net_init(void)
          VSTAT_ACKNOWLEDGE | VSTAT_DRIVER | VSTAT_DRIVER_OK);
 
     virtio_net_ready = 1;
+    _rx_thread_start(nic.irq_line);
     return 1;
 }
 
@@ -321,10 +342,9 @@ uint32_t virtio_net_debug_queues(void) {
     return ((uint32_t)sz0 << 16) | sz1;
 }
 
-uint16_t virtio_net_recv(uint8_t *buf)
+/* Pop one frame straight off the device's used ring (0 = none). */
+static uint16_t _rx_take(uint8_t *buf)
 {
-    if (!virtio_net_ready) return 0;
-
     /* Memory barrier: ensure we see the device's latest writes */
     __asm__ volatile ("" ::: "memory");
 
@@ -362,3 +382,93 @@ recycle:
     if (total <= (uint32_t)VNHDR_LEN) return 0;
     return (uint16_t)(total - VNHDR_LEN);
 }
+
+static int _rx_device_pending(void)
+{
+    __asm__ volatile ("" ::: "memory");
+    return *(volatile uint16_t*)&rx_vq.used.idx != rx_last_used;
+}
+
+static int _rx_backlog_full(void)
+{
+    return rx_bl_tail - rx_bl_head >= RX_BACKLOG;
+}
+
+/* knetrxd sleeps until the device has frames and the backlog has room */
+static int _rx_work(void *arg)
+{
+    (void)arg;
+    return _rx_device_pending() && !_rx_backlog_full();
+}
+
+static int _rx_available(void *arg)
+{
+    (void)arg;
+    return rx_bl_head != rx_bl_tail || _rx_device_pending();
+}
+
+static void _rx_irq_ack(void)
+{
+    /* Clear-on-read; deasserts the shared level-triggered line */
+    (void)inb(io_base + VPIO_ISR_STATUS);
+}
+
+static void _rx_thread(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        /* The timeout only guards against a missed edge; IRQs drive this. */
+        kwait_until(&rx_irq_wq, _rx_work, NULL, 1000);
+        int got = 0;
+        while (!_rx_backlog_full()) {
+            uint32_t slot = rx_bl_tail % RX_BACKLOG;
+            uint16_t n = _rx_take(rx_backlog[slot]);
+            if (n == 0) {
+                if (!_rx_device_pending()) break;
+                continue;                            /* dropped runt frame */
+            }
+            rx_backlog_len[slot] = n;
+            rx_bl_tail++;
+            got = 1;
+        }
+        if (got) kwaitq_wake_all(&rx_ready_wq);
+    }
+}
+
+/* Bind the NIC's IRQ and start knetrxd; without either RX stays polled. */
+static void _rx_thread_start(uint8_t irq_line)
+{
+    if (irq_line == 0xFF || rx_thread >= 0) return;
+    if (kthread_irq_bind(irq_line, &rx_irq_wq, _rx_irq_ack) != 0) return;
+    rx_thread = kthread_create("knetrxd", _rx_thread, NULL);
+}
+
+uint16_t virtio_net_recv(uint8_t *buf)
+{
+    if (!virtio_net_ready) return 0;
+
+    /* Backlog first: every frame in it is older than any still on the ring */
+    if (rx_bl_head != rx_bl_tail) {
+        int was_full = _rx_backlog_full();
+        uint32_t slot = rx_bl_head % RX_BACKLOG;
+        uint16_t n = rx_backlog_len[slot];
+        memcpy(buf, rx_backlog[slot], n);
+        rx_bl_head++;
+        if (was_full) kwaitq_wake_all(&rx_irq_wq);
+        return n;
+    }
+    return _rx_take(buf);
+}
+
+int virtio_net_wait_rx(uint32_t ms)
+{
+    if (!virtio_net_ready) return 0;
+    if (rx_thread >= 0)
+        return kwait_until(&rx_ready_wq, _rx_available, NULL, ms);
+    /* No RX interrupt: poll once per tick */
+    for (uint32_t t = 0; !_rx_available(NULL); t++) {
+        if (t >= ms) return 0;
+        kthread_sleep(1);
+    }
+    return 1;
+}
@@ -31,6 +31,13 @@ void virtio_net_send(const uint8_t *frame, uint16_t len);
  */
 uint16_t virtio_net_recv(uint8_t *buf);
 
+/**
+ * Block until a frame is ready for virtio_net_recv() or `ms` milliseconds
+ * pass.  Other kernel threads run — or the CPU halts — meanwhile.
+ * Returns 1 if a frame is ready, 0 on timeout.
+ */
+int virtio_net_wait_rx(uint32_t ms);
+
 /**
  * Debug: return the current value of rx_vq.used.idx (how many RX frames QEMU has placed).
  */
@@ -0,0 +1,243 @@
+/*
+ * zygote.c — Arena allocator for zygote child runtimes (see zygote.h)
+ *
+ * Blocks carry an 8-byte header [u32 size][u16 class][u16 magic]:
+ *
+ *   small  (≤ 64 KB incl. header): 44 size classes — 16-byte steps up to
+ *          128 B, then four steps per power of two — each with a LIFO free
+ *          list.  Carved from the bump pointer; never returned to the map.
+ *   large: whole pages, first fit from freed runs, else the bump pointer.
+ *          Freed runs are kept in address order and merged with their
+ *          neighbours; each keeps only its first page mapped (it holds the
+ *          run header) — the rest goes back to the frame pool and is
+ *          re-mapped on reuse.
+ *
+ * The arena is mapped 64 KB at a time with pt_map_anon() on the directory
+ * in CR3, i.e. the clone that is growing.
+ */
+
+#include "zygote.h"
+#include "pagetable.h"
+#include "memory.h"
+#include <string.h>
+
+#define ZY_MAGIC         0x5A59u      /* "ZY" */
+#define ZY_HDR           8u
+#define ZY_CLASSES       44u
+#define ZY_SMALL_MAX     65536u       /* largest small block, header included */
+#define ZY_LARGE         0xFFFFu      /* class field of a page run          */
+#define ZY_GROW_PAGES    16u
+#define ZY_OVERHEAD      8u           /* MALLOC_OVERHEAD in quickjs.c       */
+
+typedef struct zy_free  { struct zy_free *next; } zy_free_t;
+typedef struct zy_run   { struct zy_run *next; uint32_t pages; } zy_run_t;
+
+typedef struct {
+    uint32_t   magic;
+    uint32_t   brk;                   /* next unallocated byte              */
+    uint32_t   mapped;                /* end of the mapped prefix           */
+    uint32_t   used;                  /* bytes in live blocks               */
+    zy_free_t *free[ZY_CLASSES];
+    zy_run_t  *runs;                  /* freed page runs (first fit)        */
+} zy_arena_t;
+
+#define ARENA ((zy_arena_t *)(uintptr_t)ZYGOTE_VA_BASE)
+
+static uint32_t *_cur_pd(void)
+{
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return (uint32_t *)(uintptr_t)(cr3 & 0xFFFFF000u);
+}
+
+/* ── Size classes ────────────────────────────────────────────────────────── */
+
+static uint32_t _cls_size(uint32_t c)
+{
+    if (c < 8u) return (c + 1u) << 4;
+    uint32_t p = 7u + (c - 8u) / 4u, sub = (c - 8u) % 4u + 1u;
+    return (1u << p) + sub * (1u << (p - 2u));
+}
+
+/* Class for a block of n bytes (header included), n ≤ ZY_SMALL_MAX. */
+static uint32_t _cls_of(uint32_t n)
+{
+    if (n <= 128u) return n ? (n - 1u) >> 4 : 0u;
+    uint32_t p = 31u - (uint32_t)__builtin_clz(n - 1u);    /* 2^p < n ≤ 2^(p+1) */
+    uint32_t q = 1u << (p - 2u);
+    return 8u + (p - 7u) * 4u + (n - (1u << p) + q - 1u) / q - 1u;
+}
+
+/* ── Arena growth ────────────────────────────────────────────────────────── */
+
+static int _grow(zy_arena_t *a, uint32_t end)
+{
+    if (end <= a->mapped) return 0;
+    if (end > ZYGOTE_VA_BASE + ZYGOTE_VA_SIZE || end < a->mapped) return -1;
+    uint32_t pages = (end - a->mapped + PAGE_SIZE - 1u) / PAGE_SIZE;
+    pages = (pages + ZY_GROW_PAGES - 1u) & ~(ZY_GROW_PAGES - 1u);
+    uint32_t room = (ZYGOTE_VA_BASE + ZYGOTE_VA_SIZE - a->mapped) / PAGE_SIZE;
+    if (pages > room) pages = room;
+    if (pt_map_anon(_cur_pd(), a->mapped, pages, PT_WRITE) < 0) return -1;
+    a->mapped += pages * PAGE_SIZE;
+    return 0;
+}
+
+static uint32_t *_bump(zy_arena_t *a, uint32_t bytes, uint32_t align)
+{
+    uint32_t at = (a->brk + align - 1u) & ~(align - 1u);
+    if (at + bytes < at || _grow(a, at + bytes) < 0) return NULL;
+    a->brk = at + bytes;
+    return (uint32_t *)(uintptr_t)at;
+}
+
+int zy_arena_init(void)
+{
+    zy_arena_t *a;
+    if (pt_map_anon(_cur_pd(), ZYGOTE_VA_BASE, ZY_GROW_PAGES, PT_WRITE) < 0) return -1;
+    a = ARENA;
+    memset(a, 0, sizeof(*a));
+    a->magic  = ZY_MAGIC;
+    a->mapped = ZYGOTE_VA_BASE + ZY_GROW_PAGES * PAGE_SIZE;
+    a->brk    = (ZYGOTE_VA_BASE + (uint32_t)sizeof(*a) + 15u) & ~15u;
+    return 0;
+}
+
+uint32_t zy_arena_pages(void) { return (ARENA->mapped - ZYGOTE_VA_BASE) / PAGE_SIZE; }
+uint32_t zy_arena_used(void)  { return ARENA->used; }
+void    *zy_arena_opaque(void) { return ARENA; }
+
+/* ── Blocks ──────────────────────────────────────────────────────────────── */
+
+static size_t _usable(const uint32_t *h)
+{
+    uint32_t cls = h[1] & 0xFFFFu;
+    return cls == ZY_LARGE ? h[0] * PAGE_SIZE - ZY_HDR : _cls_size(cls) - ZY_HDR;
+}
+
+static uint32_t *_alloc_run(zy_arena_t *a, uint32_t pages)
+{
+    zy_run_t **pp = &a->runs;
+    for (zy_run_t *r = *pp; r; pp = &r->next, r = *pp) {
+        if (r->pages < pages) continue;
+        uint32_t base = (uint32_t)(uintptr_t)r, have = r->pages;
+        zy_run_t *next = r->next;
+        if (have > pages) {                      /* keep the tail as a run */
+            uint32_t tail = base + pages * PAGE_SIZE;
+            if (pt_map_anon(_cur_pd(), tail, 1, PT_WRITE) < 0) return NULL;
+            zy_run_t *t = (zy_run_t *)(uintptr_t)tail;
+            t->pages = have - pages;
+            t->next  = next;                         /* keeps address order */
+            next = t;
+        }
+        if (pages > 1 && pt_map_anon(_cur_pd(), base + PAGE_SIZE, pages - 1u, PT_WRITE) < 0)
+            return NULL;
+        *pp = next;
+        return (uint32_t *)(uintptr_t)base;
+    }
+    return _bump(a, pages * PAGE_SIZE, PAGE_SIZE);
+}
+
+/* Return a page run to the address-ordered run list, merging it with its
+ * neighbours so the window does not fragment.  Only the first page of a
+ * free run stays mapped. */
+static void _free_run(zy_arena_t *a, zy_run_t *r, uint32_t pages)
+{
+    uint32_t *pd = _cur_pd();
+    uint32_t at = (uint32_t)(uintptr_t)r;
+    if (pages > 1) pt_unmap_range(pd, at + PAGE_SIZE, pages - 1u);
+    zy_run_t *prev = NULL, *next = a->runs;
+    while (next && (uint32_t)(uintptr_t)next < at) { prev = next; next = next->next; }
+    if (prev && (uint32_t)(uintptr_t)prev + prev->pages * PAGE_SIZE == at) {
+        prev->pages += pages;                        /* r's header page goes */
+        pt_unmap_range(pd, at, 1);
+        r = prev;
+    } else {
+        r->pages = pages;
+        r->next  = next;
+        if (prev) prev->next = r; else a->runs = r;
+    }
+    if (next && (uint32_t)(uintptr_t)r + r->pages * PAGE_SIZE == (uint32_t)(uintptr_t)next) {
+        r->pages += next->pages;
+        r->next   = next->next;
+        pt_unmap_range(pd, (uint32_t)(uintptr_t)next, 1);
+    }
+}
+
+static void *zy_malloc(JSMallocState *s, size_t size)
+{
+    zy_arena_t *a = (zy_arena_t *)s->opaque;
+    uint32_t *h;
+    if (size > ZYGOTE_VA_SIZE || s->malloc_size + size > s->malloc_limit) return NULL;
+    uint32_t n = (uint32_t)size + ZY_HDR;
+    if (n <= ZY_SMALL_MAX) {
+        uint32_t cls = _cls_of(n);
+        zy_free_t *f = a->free[cls];
+        if (f) {
+            a->free[cls] = f->next;
+            h = (uint32_t *)f;
+        } else {
+            h = _bump(a, _cls_size(cls), 16u);
+            if (!h) return NULL;
+        }
+        h[0] = _cls_size(cls);
+        h[1] = cls | (ZY_MAGIC << 16);
+    } else {
+        uint32_t pages = (n + PAGE_SIZE - 1u) / PAGE_SIZE;
+        h = _alloc_run(a, pages);
+        if (!h) return NULL;
+        h[0] = pages;
+        h[1] = ZY_LARGE | (ZY_MAGIC << 16);
+    }
+    size_t us = _usable(h);
+    a->used += (uint32_t)us;
+    s->malloc_count++;
+    s->malloc_size += us + ZY_OVERHEAD;
+    return h + 2;
+}
+
+static void zy_free(JSMallocState *s, void *ptr)
+{
+    if (!ptr) return;
+    zy_arena_t *a = (zy_arena_t *)s->opaque;
+    uint32_t *h = (uint32_t *)ptr - 2;
+    if ((h[1] >> 16) != ZY_MAGIC) return;           /* not ours: leak, don't corrupt */
+    size_t us = _usable(h);
+    a->used -= (uint32_t)us;
+    s->malloc_count--;
+    s->malloc_size -= us + ZY_OVERHEAD;
+    uint32_t cls = h[1] & 0xFFFFu;
+    h[1] = 0;
+    if (cls == ZY_LARGE) {
+        _free_run(a, (zy_run_t *)h, h[0]);
+    } else {
+        zy_free_t *f = (zy_free_t *)h;
+        f->next = a->free[cls];
+        a->free[cls] = f;
+    }
+}
+
+static void *zy_realloc(JSMallocState *s, void *ptr, size_t size)
+{
+    if (!ptr) return size ? zy_malloc(s, size) : NULL;
+    if (!size) { zy_free(s, ptr); return NULL; }
+    size_t old = _usable((uint32_t *)ptr - 2);
+    if (size <= old) return ptr;
+    void *np = zy_malloc(s, size);
+    if (!np) return NULL;
+    memcpy(np, ptr, old);
+    zy_free(s, ptr);
+    return np;
+}
+
+static size_t zy_malloc_usable_size(const void *ptr)
+{
+    return ptr ? _usable((const uint32_t *)ptr - 2) : 0;
+}
+
+const JSMallocFunctions zy_malloc_funcs = {
+    zy_malloc,
+    zy_free,
+    zy_realloc,
+    zy_malloc_usable_size,
+};
@@ -0,0 +1,48 @@
+/*
+ * zygote.h — Copy-on-write child runtimes from a pre-initialised heap
+ *
+ * A zygote is a child QuickJS runtime built once, inside its own page
+ * directory, whose every allocation comes from an arena at the fixed
+ * virtual window [ZYGOTE_VA_BASE, ZYGOTE_VA_BASE + ZYGOTE_VA_SIZE).  Once
+ * its start-up code has run, the zygote is frozen.  A new child is a fresh
+ * page directory with the arena range shared copy-on-write
+ * (pt_clone_cow) — the JSRuntime / JSContext pointers are valid unchanged
+ * because the arena sits at the same virtual address in every clone, so no
+ * pointer fixups are needed.  Spawning costs one page-table walk; pages are
+ * copied only when a clone writes them (pt_handle_fault).
+ *
+ * The allocator keeps all of its state inside the arena (header at
+ * ZYGOTE_VA_BASE), so each clone inherits a consistent heap and then grows
+ * it independently in its own directory.
+ *
+ * Code touching a clone's heap must run with that clone's directory in
+ * CR3; quickjs_binding.c brackets every entry into a child runtime.
+ *
+ * Zygote start-up code should not acquire kernel-side resources (shared
+ * buffers, render surfaces): those would be shared by every clone.
+ */
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <stdint.h>
+#include "quickjs.h"
+
+#define ZYGOTE_VA_BASE   0xA0000000u
+#define ZYGOTE_VA_SIZE   0x20000000u      /* 512 MB per clone */
+#define ZYGOTE_MAX       4
+
+/* Format an empty arena at ZYGOTE_VA_BASE in the directory currently in CR3
+ * (which must not map the window yet).  Returns 0 or -1 on OOM. */
+int      zy_arena_init(void);
+
+/* Pages currently mapped by the arena — the range a clone must share. */
+uint32_t zy_arena_pages(void);
+
+/* Bytes handed out and not freed (diagnostics). */
+uint32_t zy_arena_used(void);
+
+/* QuickJS allocator over the arena; pass zy_arena_opaque() as the opaque. */
+extern const JSMallocFunctions zy_malloc_funcs;
+void    *zy_arena_opaque(void);
+
+#endif /* ZYGOTE_H */
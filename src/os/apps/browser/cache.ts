@@ -6,7 +6,8 @@
  *
  *  textMeasureCache      — text width memoisation
  *  computedStyleCache    — per-element CSS computed style (generation-based)
- *  imageBitmapCache      — URLs → decoded RGBA pixel arrays
+ *  imageBitmapCache      — URLs → decoded RGBA pixel arrays (byte-budgeted
+ *                          LRU; kept across navigation, flushed on hard reload)
  *  layoutResultCache     — content fingerprint → LayoutResult
  *  cssRuleBuckets        — O(1) selector pre-indexing by tag/class/id
  *  objectPool            — reusable RenderedSpan / RenderedLine objects
@@ -132,6 +133,12 @@ export function flushStyleCache(): void {
 // Avoids re-decoding the same JPEG/PNG on every render frame.
 // The cache also stores a scaled copy at (destW, destH) so resize operations
 // don't repeat.
+//
+// Originals and scaled copies are separate LRU entries charged
+// against one byte budget (w × h × 4 each), so a page full of thumbnails
+// cannot pin an unbounded number of full-resolution bitmaps.  Map insertion
+// order is the recency list: a hit re-inserts the entry at the tail and
+// eviction walks from the head.
 
 interface BitmapEntry {
   w:    number;
@@ -139,46 +146,87 @@ interface BitmapEntry {
   data: Uint32Array;
 }
 
-interface ScaledEntry {
-  w:    number;
-  h:    number;
-  data: Uint32Array;
-}
-
-interface ImageEntry {
-  original: BitmapEntry | null;
-  // scaled copies keyed by "w×h"
-  scaled: Map<string, ScaledEntry>;
+var _imageCache = new Map<string, BitmapEntry>();
+var _imageBytes  = 0;
+var _imageBudget = 32 * 1024 * 1024;
+var _imageHits   = 0;
+var _imageTotal  = 0;
+var _imageEvicts = 0;
+
+function _imagePut(key: string, e: BitmapEntry): void {
+  var old = _imageCache.get(key);
+  if (old) { _imageBytes -= old.data.byteLength; _imageCache.delete(key); }
+  // A bitmap larger than the whole budget is not worth keeping
+  if (e.data.byteLength > _imageBudget) return;
+  _imageCache.set(key, e);
+  _imageBytes += e.data.byteLength;
+  _imageEvict();
+}
+
+function _imageGet(key: string): BitmapEntry | null {
+  _imageTotal++;
+  var e = _imageCache.get(key);
+  if (!e) return null;
+  _imageHits++;
+  _imageCache.delete(key);
+  _imageCache.set(key, e);
+  return e;
+}
+
+function _imageEvict(): void {
+  if (_imageBytes <= _imageBudget) return;
+  var it = _imageCache.keys();
+  while (_imageBytes > _imageBudget) {
+    var k = it.next();
+    if (k.done) break;
+    var e = _imageCache.get(k.value)!;
+    _imageCache.delete(k.value);
+    _imageBytes -= e.data.byteLength;
+    _imageEvicts++;
+  }
 }
 
-var _imageCache = new Map<string, ImageEntry>();
-
 /** Store the decoded original bitmap for a URL. */
 export function storeImageBitmap(url: string, w: number, h: number, data: Uint32Array): void {
-  var entry = _imageCache.get(url);
-  if (!entry) { entry = { original: null, scaled: new Map() }; _imageCache.set(url, entry); }
-  entry.original = { w, h, data };
+  _imagePut(url, { w, h, data });
 }
 
 /** Retrieve the decoded original bitmap, or null if not cached. */
 export function getImageBitmap(url: string): BitmapEntry | null {
-  return _imageCache.get(url)?.original ?? null;
+  return _imageGet(url);
 }
 
 /** Store a scaled copy. */
 export function storeScaledImage(url: string, destW: number, destH: number, data: Uint32Array): void {
-  var entry = _imageCache.get(url);
-  if (!entry) { entry = { original: null, scaled: new Map() }; _imageCache.set(url, entry); }
-  entry.scaled.set(destW + 'x' + destH, { w: destW, h: destH, data });
+  _imagePut(url + '|' + destW + 'x' + destH, { w: destW, h: destH, data });
 }
 
 /** Retrieve a pre-scaled copy, or null. */
 export function getScaledImage(url: string, destW: number, destH: number): Uint32Array | null {
-  return _imageCache.get(url)?.scaled.get(destW + 'x' + destH)?.data ?? null;
+  var e = _imageGet(url + '|' + destW + 'x' + destH);
+  return e ? e.data : null;
+}
+
+/** Set the image cache byte budget (evicts immediately if over). */
+export function setImageCacheBudget(bytes: number): void {
+  _imageBudget = Math.max(0, bytes);
+  _imageEvict();
 }
 
-/** Flush image cache on navigation. */
-export function flushImageCache(): void { _imageCache.clear(); }
+/** Image cache occupancy and hit/eviction counters. */
+export function imageCacheStats(): { entries: number; bytes: number; budget: number; hits: number; total: number; evictions: number } {
+  return { entries: _imageCache.size, bytes: _imageBytes, budget: _imageBudget,
+           hits: _imageHits, total: _imageTotal, evictions: _imageEvicts };
+}
+
+/** Drop every cached bitmap (hard reload). */
+export function flushImageCache(): void {
+  _imageCache.clear();
+  _imageBytes  = 0;
+  _imageHits   = 0;
+  _imageTotal  = 0;
+  _imageEvicts = 0;
+}
 
 // ── Layout Result Cache ─────────────────────────────────────────────────────
 //
@@ -568,18 +616,19 @@ export function cacheStats(): Record<string, unknown> {
     textCache:    textCacheStats(),
     layoutCache:  { hits: _layoutHits, total: _layoutTotal },
     styleCache:   { hits: _styleCacheHits, total: _styleCacheTotal },
-    imageCache:   { entries: _imageCache.size },
+    imageCache:   imageCacheStats(),
     spanPool:     { pooled: _spanPool.length, outstanding: _spansOut },
     linePool:     { pooled: _linePool.length, outstanding: _linesOut },
   };
 }
 
 // ── Flush all caches on page navigation ──────────────────────────────────────
+// Decoded images are bounded by their own budget and stay cached so Back and
+// shared assets (logos, sprites) don't decode again; _hardReload() drops them.
 
 export function flushAllCaches(): void {
   flushTextCache();
   flushStyleCache();
-  flushImageCache();
   flushLayoutCache();
   _spanPool.length = 0;
   _linePool.length = 0;
@@ -4,12 +4,21 @@
  * Implements:
  *   - Item 491: <canvas> 2D rendering context wired to the OS framebuffer
  *   - Item 915: Canvas 2D drawImage() blitting from decoded bitmap cache
+ *   - Vector:    anti-aliased fills, strokes and clips through the shared
+ *     scanline rasterizer (raster.ts); gradients and patterns are per-pixel
+ *     paint shaders composited by kernel.spanBlend
  *
  * Design: Each HTMLCanvasElement owns a software CanvasRenderingContext2D that
  * draws into a Uint8Array (RGBA). When flush() is called the buffer is copied
  * to the OS framebuffer via the browser's render pipeline.
  */
 
+import {
+  FlatPath, ScanRasterizer, SpanBuffer, strokePath, blendSpans, paintSpans,
+  rampLUT, spansToMask,
+} from './raster.js';
+import type { FillRule } from './raster.js';
+
 // ── Types ────────────────────────────────────────────────────────────────────
 
 export interface CanvasGradientStop { offset: number; color: string; }
@@ -62,11 +71,27 @@ export class CanvasGradient {
   // radial params
   cx0 = 0; cy0 = 0; r0 = 0; cx1 = 0; cy1 = 0; r1 = 0;
 
+  private _lut: Uint32Array | null = null;
+  private _lutAlpha = 1;
+
   constructor(type: 'linear' | 'radial') { this.type = type; }
 
   addColorStop(offset: number, color: string): void {
     this.stops.push({ offset, color });
     this.stops.sort((a, b) => a.offset - b.offset);
+    this._lut = null;
+  }
+
+  /** 256-entry colour ramp in framebuffer word order (0xAABBGGRR). */
+  lut(alpha: number): Uint32Array {
+    if (!this._lut || this._lutAlpha !== alpha) {
+      this._lut = rampLUT(this.stops.map(s => {
+        const c = parseColor(s.color);
+        return { pos: Math.max(0, Math.min(1, s.offset)), color: ((c.a << 24) | (c.b << 16) | (c.g << 8) | c.r) >>> 0 };
+      }), alpha);
+      this._lutAlpha = alpha;
+    }
+    return this._lut;
   }
 
   sampleAt(t: number): RGBA {
@@ -137,6 +162,14 @@ function mulM(a: Mat2D, b: Mat2D): Mat2D {
 function applyM(m: Mat2D, x: number, y: number): [number,number] {
   return [m[0]*x + m[2]*y + m[4], m[1]*x + m[3]*y + m[5]];
 }
+function invertM(m: Mat2D): Mat2D | null {
+  const det = m[0]*m[3] - m[1]*m[2];
+  if (!det) return null;
+  return [
+    m[3]/det, -m[1]/det, -m[2]/det, m[0]/det,
+    (m[2]*m[5] - m[3]*m[4])/det, (m[1]*m[4] - m[0]*m[5])/det,
+  ];
+}
 
 // ── ImageBitmap cache (Item 915) ──────────────────────────────────────────────
 
@@ -217,8 +250,11 @@ export class CanvasRenderingContext2D {
   private _h: number;
   private _path = new Path2D();
   private _transform: Mat2D = identM();
-  private _stack: Array<{ transform: Mat2D; fillStyle: typeof this.fillStyle; strokeStyle: typeof this.strokeStyle; lineWidth: number; globalAlpha: number; font: string }> = [];
-  private _clip: Uint8Array | null = null; // 1-bit mask
+  private _stack: Array<{ transform: Mat2D; fillStyle: typeof this.fillStyle; strokeStyle: typeof this.strokeStyle; lineWidth: number; globalAlpha: number; font: string; clip: Uint8Array | null }> = [];
+  private _clip: Uint8Array | null = null; // coverage mask, 0-255 per pixel
+  private _fb32: Uint32Array;              // _fb as little-endian 0xAABBGGRR words
+  private _ras: ScanRasterizer | null = null;
+  private _spans = new SpanBuffer();
 
   readonly canvas: { width: number; height: number };
 
@@ -226,6 +262,7 @@ export class CanvasRenderingContext2D {
     this._w = width;
     this._h = height;
     this._fb = framebuffer ?? new Uint8Array(width * height * 4);
+    this._fb32 = new Uint32Array(this._fb.buffer, this._fb.byteOffset, width * height);
     this.canvas = { width, height };
   }
 
@@ -239,6 +276,7 @@ export class CanvasRenderingContext2D {
       lineWidth: this.lineWidth,
       globalAlpha: this.globalAlpha,
       font: this.font,
+      clip: this._clip,
     });
   }
 
@@ -251,6 +289,7 @@ export class CanvasRenderingContext2D {
     this.lineWidth = s.lineWidth;
     this.globalAlpha = s.globalAlpha;
     this.font = s.font;
+    this._clip = s.clip;
   }
 
   setTransform(a: number, b: number, c: number, d: number, e: number, f: number): void {
@@ -312,20 +351,23 @@ export class CanvasRenderingContext2D {
 
   // ── Clip ────────────────────────────────────────────────────────────────
 
-  clip(_path?: Path2D | 'nonzero' | 'evenodd'): void {
-    // Rasterise current path as clip mask
-    this._clip = new Uint8Array(this._w * this._h);
-    const p = (_path instanceof Path2D) ? _path : this._path;
-    this._rasterizeMask(p, this._clip);
+  clip(path?: Path2D | FillRule, rule?: FillRule): void {
+    // Anti-aliased coverage mask, intersected with the current clip
+    const p = (path instanceof Path2D) ? path : this._path;
+    const spans = this._spans;
+    spans.reset();
+    this._raster().addPath(this._flatten(p));
+    this._raster().sweep(typeof path === 'string' ? path : (rule ?? 'nonzero'), spans);
+    this._clip = spansToMask(spans, this._w, this._h, this._clip);
   }
 
   // ── Draw ─────────────────────────────────────────────────────────────────
 
   fillRect(x: number, y: number, w: number, h: number): void {
-    const [tx, ty] = applyM(this._transform, x, y);
-    const [tx2, ty2] = applyM(this._transform, x+w, y+h);
-    const x0 = Math.min(tx,tx2), y0 = Math.min(ty,ty2), x1 = Math.max(tx,tx2), y1 = Math.max(ty,ty2);
-    this._fillRectRaw(x0, y0, x1-x0, y1-y0, this._resolveStyle(this.fillStyle, x0, y0, x1-x0, y1-y0));
+    const fp = new FlatPath(this._transform);
+    fp.rect(x, y, w, h);
+    this._raster().addPath(fp);
+    this._drawRaster('nonzero', this.fillStyle);
   }
 
   strokeRect(x: number, y: number, w: number, h: number): void {
@@ -345,17 +387,18 @@ export class CanvasRenderingContext2D {
     }
   }
 
-  fill(path?: Path2D | 'nonzero' | 'evenodd'): void {
+  fill(path?: Path2D | FillRule, rule?: FillRule): void {
     const p = (path instanceof Path2D) ? path : this._path;
-    const bounds = this._pathBounds(p);
-    if (!bounds) return;
-    const col = this._resolveStyle(this.fillStyle, bounds.x, bounds.y, bounds.w, bounds.h);
-    this._rasterizeAndFill(p, col);
+    this._raster().addPath(this._flatten(p));
+    this._drawRaster(typeof path === 'string' ? path : (rule ?? 'nonzero'), this.fillStyle);
   }
 
   stroke(path?: Path2D): void {
-    const p = path ?? this._path;
-    this._strokePath(p);
+    // Stroked in device space; the width follows the transform's area scale
+    const m = this._transform;
+    const hw = this.lineWidth / 2 * Math.sqrt(Math.abs(m[0]*m[3] - m[1]*m[2]));
+    strokePath(this._flatten(path ?? this._path), this._raster(), hw, this.lineJoin, this.lineCap, this.miterLimit);
+    this._drawRaster('nonzero', this.strokeStyle);
   }
 
   // ── Text ─────────────────────────────────────────────────────────────────
@@ -541,157 +584,109 @@ export class CanvasRenderingContext2D {
     return { r:0, g:0, b:0, a:255 };
   }
 
-  private _fillRectRaw(x: number, y: number, w: number, h: number, color: RGBA): void {
-    const x0 = Math.round(x), y0 = Math.round(y);
-    const x1 = Math.round(x+w), y1 = Math.round(y+h);
-    for (let py = Math.max(0,y0); py < Math.min(this._h, y1); py++) {
-      for (let px = Math.max(0,x0); px < Math.min(this._w, x1); px++) {
-        if (this._clip && !this._clip[py*this._w+px]) continue;
-        blendPixel(this._fb, (py*this._w+px)*4, color.r, color.g, color.b, color.a);
-      }
-    }
+  private _raster(): ScanRasterizer {
+    if (!this._ras) this._ras = new ScanRasterizer(this._w, this._h);
+    return this._ras;
   }
 
-  private _pathBounds(p: Path2D): { x: number; y: number; w: number; h: number } | null {
-    let minX=Infinity, minY=Infinity, maxX=-Infinity, maxY=-Infinity;
+  /** Flatten `p` through the current transform. */
+  private _flatten(p: Path2D): FlatPath {
+    const fp = new FlatPath(this._transform);
     for (const cmd of p._cmds) {
-      if (cmd.type === 'M' || cmd.type === 'L') {
-        const [tx,ty] = applyM(this._transform, cmd.args[0], cmd.args[1]);
-        minX=Math.min(minX,tx); minY=Math.min(minY,ty); maxX=Math.max(maxX,tx); maxY=Math.max(maxY,ty);
-      }
-      if (cmd.type === 'A') {
-        const [tx,ty] = applyM(this._transform, cmd.args[0], cmd.args[1]);
-        const r = cmd.args[2];
-        minX=Math.min(minX,tx-r); minY=Math.min(minY,ty-r); maxX=Math.max(maxX,tx+r); maxY=Math.max(maxY,ty+r);
-      }
-    }
-    if (!isFinite(minX)) return null;
-    return { x:minX, y:minY, w:maxX-minX, h:maxY-minY };
-  }
-
-  private _rasterizeAndFill(p: Path2D, color: RGBA): void {
-    // Scanline fill using edge table
-    const bounds = this._pathBounds(p);
-    if (!bounds) return;
-    const segments = this._pathToSegments(p);
-    const y0 = Math.max(0, Math.floor(bounds.y));
-    const y1 = Math.min(this._h-1, Math.ceil(bounds.y + bounds.h));
-
-    for (let py = y0; py <= y1; py++) {
-      const xIntersections: number[] = [];
-      for (const seg of segments) {
-        const { x1: sx1, y1: sy1, x2: sx2, y2: sy2 } = seg;
-        if ((sy1 <= py && sy2 > py) || (sy2 <= py && sy1 > py)) {
-          const t = (py - sy1) / (sy2 - sy1);
-          xIntersections.push(sx1 + t * (sx2 - sx1));
-        }
-      }
-      xIntersections.sort((a,b) => a-b);
-      for (let k = 0; k+1 < xIntersections.length; k += 2) {
-        const xStart = Math.max(0, Math.round(xIntersections[k]));
-        const xEnd   = Math.min(this._w-1, Math.round(xIntersections[k+1]));
-        for (let px = xStart; px <= xEnd; px++) {
-          if (this._clip && !this._clip[py*this._w+px]) continue;
-          blendPixel(this._fb, (py*this._w+px)*4, color.r, color.g, color.b, color.a);
-        }
+      const a = cmd.args;
+      switch (cmd.type) {
+        case 'M': fp.moveTo(a[0], a[1]); break;
+        case 'L': fp.lineTo(a[0], a[1]); break;
+        case 'Q': fp.quadTo(a[0], a[1], a[2], a[3]); break;
+        case 'B': fp.cubicTo(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+        case 'A': fp.ellipse(a[0], a[1], a[2], a[2], 0, a[3], a[4], !!a[5]); break;
+        case 'Z': fp.close(); break;
       }
     }
+    return fp;
   }
 
-  private _rasterizeMask(p: Path2D, mask: Uint8Array): void {
-    const bounds = this._pathBounds(p);
-    if (!bounds) return;
-    const segments = this._pathToSegments(p);
-    const y0 = Math.max(0, Math.floor(bounds.y));
-    const y1 = Math.min(this._h-1, Math.ceil(bounds.y + bounds.h));
-    for (let py = y0; py <= y1; py++) {
-      const xIntersections: number[] = [];
-      for (const seg of segments) {
-        const { x1: sx1, y1: sy1, x2: sx2, y2: sy2 } = seg;
-        if ((sy1 <= py && sy2 > py) || (sy2 <= py && sy1 > py)) {
-          const t = (py - sy1) / (sy2 - sy1);
-          xIntersections.push(sx1 + t * (sx2 - sx1));
-        }
-      }
-      xIntersections.sort((a,b) => a-b);
-      for (let k = 0; k+1 < xIntersections.length; k += 2) {
-        const xStart = Math.max(0, Math.round(xIntersections[k]));
-        const xEnd   = Math.min(this._w-1, Math.round(xIntersections[k+1]));
-        for (let px = xStart; px <= xEnd; px++) mask[py*this._w+px] = 1;
-      }
+  /** Sweep the rasterizer's edges and composite them with `style`. */
+  private _drawRaster(rule: FillRule, style: string | CanvasGradient | CanvasPattern): void {
+    const spans = this._spans;
+    spans.reset();
+    this._raster().sweep(rule, spans);
+    if (!spans.count) return;
+    if (typeof style === 'string') {
+      const c = parseColor(style);
+      const a = Math.round(c.a * this.globalAlpha);
+      blendSpans(this._fb32, this._w, spans, ((a << 24) | (c.b << 16) | (c.g << 8) | c.r) >>> 0, null, this._clip);
+      return;
     }
-  }
-
-  private _strokePath(p: Path2D): void {
-    const color = this._resolveStyle(this.strokeStyle, 0, 0, this._w, this._h);
-    const segs = this._pathToSegments(p);
-    for (const seg of segs) {
-      this._drawLine(seg.x1, seg.y1, seg.x2, seg.y2, color, this.lineWidth);
+    // Shaders see pixel centres mapped back to user space
+    const inv = invertM(this._transform);
+    if (!inv) return;
+    const paint = style instanceof CanvasGradient
+      ? this._gradientPaint(style, inv, spans)
+      : this._patternPaint(style, inv, spans);
+    blendSpans(this._fb32, this._w, spans, 0, paint, this._clip);
+  }
+
+  private _gradientPaint(g: CanvasGradient, inv: Mat2D, spans: SpanBuffer): Uint32Array {
+    const lut = g.lut(this.globalAlpha);
+    if (g.type === 'linear') {
+      const dx = g.x1 - g.x0, dy = g.y1 - g.y0, l2 = dx*dx + dy*dy;
+      return paintSpans(spans, (y, x, len, out, off) => {
+        if (!l2) { out.fill(lut[0], off, off + len); return; }
+        const u = inv[0]*(x + 0.5) + inv[2]*(y + 0.5) + inv[4];
+        const v = inv[1]*(x + 0.5) + inv[3]*(y + 0.5) + inv[5];
+        let t = ((u - g.x0)*dx + (v - g.y0)*dy) / l2;
+        const step = (inv[0]*dx + inv[1]*dy) / l2;
+        for (let i = 0; i < len; i++, t += step) {
+          out[off + i] = lut[t <= 0 ? 0 : t >= 1 ? 255 : (t * 255 + 0.5) | 0];
+        }
+      });
     }
-  }
-
-  private _drawLine(x1: number, y1: number, x2: number, y2: number, color: RGBA, lw: number): void {
-    // Bresenham's with width
-    const dx = Math.abs(x2-x1), dy = Math.abs(y2-y1);
-    const sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
-    let err = dx - dy;
-    let cx = Math.round(x1), cy = Math.round(y1);
-    const hw = Math.ceil(lw / 2);
-
-    while (true) {
-      for (let oy = -hw; oy <= hw; oy++) {
-        for (let ox = -hw; ox <= hw; ox++) {
-          const px2 = cx+ox, py2 = cy+oy;
-          if (px2 < 0 || px2 >= this._w || py2 < 0 || py2 >= this._h) continue;
-          blendPixel(this._fb, (py2*this._w+px2)*4, color.r, color.g, color.b, color.a);
+    // Two-circle radial gradient: largest t with |p − c(t)| = r(t) ≥ 0
+    const cdx = g.cx1 - g.cx0, cdy = g.cy1 - g.cy0, dr = g.r1 - g.r0;
+    const qa = cdx*cdx + cdy*cdy - dr*dr;
+    return paintSpans(spans, (y, x, len, out, off) => {
+      for (let i = 0; i < len; i++) {
+        const px = x + i + 0.5, py = y + 0.5;
+        const pdx = inv[0]*px + inv[2]*py + inv[4] - g.cx0;
+        const pdy = inv[1]*px + inv[3]*py + inv[5] - g.cy0;
+        const qb = pdx*cdx + pdy*cdy + g.r0*dr, qc = pdx*pdx + pdy*pdy - g.r0*g.r0;
+        let t: number;
+        if (Math.abs(qa) < 1e-9) {
+          t = qb ? qc / (2*qb) : -1;
+          if (g.r0 + t*dr < 0) { out[off + i] = 0; continue; }
+        } else {
+          const disc = qb*qb - qa*qc;
+          if (disc < 0) { out[off + i] = 0; continue; }
+          const sq = Math.sqrt(disc);
+          const ta = (qb + sq) / qa, tb = (qb - sq) / qa;
+          t = Math.max(ta, tb);
+          if (g.r0 + t*dr < 0) t = Math.min(ta, tb);
+          if (g.r0 + t*dr < 0) { out[off + i] = 0; continue; }
         }
+        out[off + i] = lut[t <= 0 ? 0 : t >= 1 ? 255 : (t * 255 + 0.5) | 0];
       }
-      if (cx === Math.round(x2) && cy === Math.round(y2)) break;
-      const e2 = 2*err;
-      if (e2 > -dy) { err -= dy; cx += sx; }
-      if (e2 < dx)  { err += dx; cy += sy; }
-    }
+    });
   }
 
-  private _pathToSegments(p: Path2D): Array<{x1:number;y1:number;x2:number;y2:number}> {
-    const segs: Array<{x1:number;y1:number;x2:number;y2:number}> = [];
-    let cx = 0, cy = 0, startX = 0, startY = 0;
-    for (const cmd of p._cmds) {
-      switch (cmd.type) {
-        case 'M': {
-          const [tx,ty] = applyM(this._transform, cmd.args[0], cmd.args[1]);
-          cx=tx; cy=ty; startX=tx; startY=ty; break;
-        }
-        case 'L': {
-          const [tx,ty] = applyM(this._transform, cmd.args[0], cmd.args[1]);
-          segs.push({x1:cx,y1:cy,x2:tx,y2:ty}); cx=tx; cy=ty; break;
-        }
-        case 'Z':
-          segs.push({x1:cx,y1:cy,x2:startX,y2:startY}); cx=startX; cy=startY; break;
-        case 'A': {
-          // Approximate arc with line segments
-          const [ax,ay,r,sa,ea,acw] = cmd.args;
-          const [tax,tay] = applyM(this._transform, ax, ay);
-          let angle = sa;
-          const step = (Math.PI/2) / Math.max(1, r/4);
-          const end = acw ? (ea < sa ? ea : ea - Math.PI*2) : (ea > sa ? ea : ea + Math.PI*2);
-          const dir = acw ? -1 : 1;
-          let prevX = tax + r * Math.cos(angle), prevY = tay + r * Math.sin(angle);
-          for (let steps = 0; steps < 100; steps++) {
-            angle += dir * step;
-            if ((dir > 0 && angle >= end) || (dir < 0 && angle <= end)) { angle = end; }
-            const nx = tax + r * Math.cos(angle), ny = tay + r * Math.sin(angle);
-            segs.push({x1:prevX,y1:prevY,x2:nx,y2:ny});
-            prevX=nx; prevY=ny;
-            if (angle === end) break;
-          }
-          cx=tax + r*Math.cos(ea); cy=tay + r*Math.sin(ea);
-          break;
-        }
-        default: break;
+  private _patternPaint(pat: CanvasPattern, inv: Mat2D, spans: SpanBuffer): Uint32Array {
+    const img = pat.image, iw = img.width, ih = img.height, src = img.data;
+    const rx = pat.repetition === 'repeat' || pat.repetition === 'repeat-x';
+    const ry = pat.repetition === 'repeat' || pat.repetition === 'repeat-y';
+    const ga = this.globalAlpha;
+    return paintSpans(spans, (y, x, len, out, off) => {
+      for (let i = 0; i < len; i++) {
+        const px = x + i + 0.5, py = y + 0.5;
+        let u = Math.floor(inv[0]*px + inv[2]*py + inv[4]);
+        let v = Math.floor(inv[1]*px + inv[3]*py + inv[5]);
+        if (rx) u = ((u % iw) + iw) % iw;
+        if (ry) v = ((v % ih) + ih) % ih;
+        if (u < 0 || u >= iw || v < 0 || v >= ih) { out[off + i] = 0; continue; }
+        const si = (v * iw + u) * 4;
+        const a = ga < 1 ? Math.round(src[si+3] * ga) : src[si+3];
+        out[off + i] = ((a << 24) | (src[si+2] << 16) | (src[si+1] << 8) | src[si]) >>> 0;
       }
-    }
-    return segs;
+    });
   }
 
   private _drawText(text: string, x: number, y: number, color: RGBA): void {
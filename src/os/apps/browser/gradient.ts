@@ -8,8 +8,11 @@
  *  - repeating-linear-gradient() / repeating-radial-gradient()
  *
  * Rendering strategy:
- *   For linear gradients   → one canvas.fillRect() call per scan-line (h calls).
- *   For radial/conic       → per-pixel via canvas.setPixel().
+ *   The stops are baked into a 256-entry colour ramp once per gradient and
+ *   each kind is a paint shader that maps a pixel to a ramp index.  The box,
+ *   clipped to the canvas and its clip rect, is one span per row that
+ *   raster.ts composites source-over (kernel.spanBlend when available), so
+ *   translucent stops blend with what is already drawn.
  *   All colour-stop interpolation done in linear sRGB (approximate).
  *
  * @module gradient
@@ -17,6 +20,7 @@
 
 import { parseCSSColor } from './css.js';
 import type { Canvas } from '../../ui/canvas.js';
+import { SpanBuffer, blendSpans, paintSpans, rampLUT } from './raster.js';
 
 // ── Types ────────────────────────────────────────────────────────────────────
 
@@ -296,38 +300,20 @@ export function parseGradient(val: string): ParsedGradient | null {
 
 // ── Colour interpolation ──────────────────────────────────────────────────────
 
-/** Sample colour at normalised position t ∈ [0,1] given colour stops. */
-function sampleStops(stops: ColorStop[], t: number): number {
-  if (stops.length === 0) return 0xFF888888;
-  if (t <= stops[0].pos)  return stops[0].color;
-  if (t >= stops[stops.length - 1].pos) return stops[stops.length - 1].color;
-
-  for (var i = 0; i < stops.length - 1; i++) {
-    var a = stops[i], b = stops[i + 1];
-    if (t >= a.pos && t <= b.pos) {
-      var f = (t - a.pos) / (b.pos - a.pos || 1);
-      return lerpARGB(a.color, b.color, f);
-    }
-  }
-  return stops[stops.length - 1].color;
-}
-
-function lerpARGB(a: number, b: number, t: number): number {
-  var aa = (a >>> 24) & 0xFF, ra = (a >>> 16) & 0xFF, ga = (a >>> 8) & 0xFF, ba2 = a & 0xFF;
-  var ab = (b >>> 24) & 0xFF, rb = (b >>> 16) & 0xFF, gb = (b >>> 8) & 0xFF, bb2 = b & 0xFF;
-  var A = aa + (ab - aa) * t | 0;
-  var R = ra + (rb - ra) * t | 0;
-  var G = ga + (gb - ga) * t | 0;
-  var B = ba2 + (bb2 - ba2) * t | 0;
-  return ((A << 24) | (R << 16) | (G << 8) | B) >>> 0;
-}
-
 function normT(t: number, repeating: boolean): number {
   if (!repeating) return Math.max(0, Math.min(1, t));
   t = t % 1;
   return t < 0 ? t + 1 : t;
 }
 
+/** Ramp index for normalised t ∈ [0,1]. */
+function lutIndex(t: number): number {
+  return (t * 255 + 0.5) | 0;
+}
+
+/** Paint shader: writes `len` ramp colours for box-relative row/col. */
+type GradientShader = (row: number, col: number, len: number, out: Uint32Array, off: number) => void;
+
 // ── Rasterisers ───────────────────────────────────────────────────────────────
 
 /**
@@ -348,15 +334,33 @@ export function renderGradient(
   if (w <= 0 || h <= 0 || gradient.stops.length === 0) return;
 
   var { stops, repeating } = gradient;
+  var lut = rampLUT(stops);
+  var shade: GradientShader;
 
   if (gradient.kind === 'linear' || gradient.kind === 'repeating-linear') {
-    _renderLinear(canvas, x, y, w, h, gradient.angle, stops, repeating);
+    shade = _linearShader(w, h, gradient.angle, lut, repeating);
   } else if (gradient.kind === 'radial' || gradient.kind === 'repeating-radial') {
-    _renderRadial(canvas, x, y, w, h, gradient.cx, gradient.cy, gradient.shape, stops, repeating);
+    shade = _radialShader(w, h, gradient.cx, gradient.cy, gradient.shape, lut, repeating);
   } else {
     // conic
-    _renderConic(canvas, x, y, w, h, gradient.angle, gradient.cx, gradient.cy, stops, repeating);
+    shade = _conicShader(gradient.angle, w, h, gradient.cx, gradient.cy, lut);
+  }
+
+  // Visible part of the box: one full-coverage span per row
+  x = Math.floor(x); y = Math.floor(y);
+  var x0 = Math.max(0, x), y0 = Math.max(0, y);
+  var x1 = Math.min(canvas.width, x + w), y1 = Math.min(canvas.height, y + h);
+  var clip = canvas.saveClipRect();
+  if (clip) {
+    x0 = Math.max(x0, clip.x1); y0 = Math.max(y0, clip.y1);
+    x1 = Math.min(x1, clip.x2); y1 = Math.min(y1, clip.y2);
   }
+  if (x1 <= x0 || y1 <= y0) return;
+  var spans = new SpanBuffer();
+  for (var py = y0; py < y1; py++) spans.push(py, x0, x1 - x0, 255);
+
+  var paint = paintSpans(spans, function(sy, sx, len, out, off) { shade(sy - y, sx - x, len, out, off); });
+  blendSpans(canvas.getBuffer(), canvas.width, spans, 0, paint);
 }
 
 /**
@@ -375,15 +379,14 @@ export function renderGradientCSS(
   return true;
 }
 
-// ── Linear gradient rasteriser ────────────────────────────────────────────────
+// ── Linear gradient shader ────────────────────────────────────────────────────
 
-function _renderLinear(
-  canvas: Canvas,
-  x: number, y: number, w: number, h: number,
+function _linearShader(
+  w: number, h: number,
   angleDeg: number,
-  stops: ColorStop[],
+  lut: Uint32Array,
   repeating: boolean,
-): void {
+): GradientShader {
   // Convert angle to radians. CSS 0° = top, clockwise.
   // We need the gradient-line direction.
   var a = ((angleDeg - 90) * Math.PI) / 180;
@@ -394,29 +397,13 @@ function _renderLinear(
   var lineLen = Math.abs(w * cos) + Math.abs(h * sin);
   if (lineLen < 1) lineLen = 1;
 
-  // For each scan line, compute the average t for the scan line's centre
-  // (linear gradients are uniform across perpendicular lines, so per-row
-  // is exact for horizontal/vertical and approximate for diagonals —
-  // we use per-pixel for full accuracy).
-
-  for (var row = 0; row < h; row++) {
-    var py = y + row;
-    // Sample at multiple x positions? For performance use start-of-row and
-    // end-of-row and check if they differ by more than 1 colour stop band.
-    var tLeft  = _linearT(0,     row, w, h, cos, sin, lineLen);
-    var tRight = _linearT(w - 1, row, w, h, cos, sin, lineLen);
-
-    if (Math.abs(tLeft - tRight) < 0.005) {
-      // Solid horizontal band — one fillRect call
-      canvas.fillRect(x, py, w, 1, sampleStops(stops, normT((tLeft + tRight) / 2, repeating)));
-    } else {
-      // Need per-pixel (diagonal gradient)
-      for (var col = 0; col < w; col++) {
-        var t = normT(_linearT(col, row, w, h, cos, sin, lineLen), repeating);
-        canvas.setPixel(x + col, py, sampleStops(stops, t));
-      }
-    }
-  }
+  // t is linear along a row: step it instead of projecting every pixel
+  var step = sin / lineLen;
+  return function(row, col, len, out, off) {
+    var t = _linearT(col, row, w, h, cos, sin, lineLen);
+    if (!repeating && step === 0) { out.fill(lut[lutIndex(normT(t, false))], off, off + len); return; }
+    for (var i = 0; i < len; i++, t += step) out[off + i] = lut[lutIndex(normT(t, repeating))];
+  };
 }
 
 function _linearT(px: number, py: number, w: number, h: number, cos: number, sin: number, lineLen: number): number {
@@ -427,16 +414,15 @@ function _linearT(px: number, py: number, w: number, h: number, cos: number, sin
   return 0.5 + proj / lineLen;
 }
 
-// ── Radial gradient rasteriser ────────────────────────────────────────────────
+// ── Radial gradient shader ────────────────────────────────────────────────────
 
-function _renderRadial(
-  canvas: Canvas,
-  x: number, y: number, w: number, h: number,
+function _radialShader(
+  w: number, h: number,
   normCx: number, normCy: number,
   shape: 'circle' | 'ellipse',
-  stops: ColorStop[],
+  lut: Uint32Array,
   repeating: boolean,
-): void {
+): GradientShader {
   var cxPx = normCx * w;
   var cyPx = normCy * h;
 
@@ -447,40 +433,36 @@ function _renderRadial(
   if (rx < 1) rx = 1;
   if (ry < 1) ry = 1;
 
-  for (var row = 0; row < h; row++) {
-    var py = y + row;
-    for (var col = 0; col < w; col++) {
-      var nx = (col - cxPx) / rx;
-      var ny = (row - cyPx) / ry;
+  return function(row, col, len, out, off) {
+    var ny = (row - cyPx) / ry;
+    for (var i = 0; i < len; i++) {
+      var nx = (col + i - cxPx) / rx;
       var t  = Math.sqrt(nx * nx + ny * ny);
-      canvas.setPixel(x + col, py, sampleStops(stops, normT(t, repeating)));
+      out[off + i] = lut[lutIndex(normT(t, repeating))];
     }
-  }
+  };
 }
 
-// ── Conic gradient rasteriser ─────────────────────────────────────────────────
+// ── Conic gradient shader ─────────────────────────────────────────────────────
 
-function _renderConic(
-  canvas: Canvas,
-  x: number, y: number, w: number, h: number,
+function _conicShader(
   fromDeg: number,
+  w: number, h: number,
   normCx: number, normCy: number,
-  stops: ColorStop[],
-  _repeating: boolean,
-): void {
+  lut: Uint32Array,
+): GradientShader {
   var cxPx = normCx * w;
   var cyPx = normCy * h;
   var fromRad = (fromDeg * Math.PI) / 180;
 
-  for (var row = 0; row < h; row++) {
-    var py = y + row;
-    for (var col = 0; col < w; col++) {
-      var dx = col - cxPx;
-      var dy = row - cyPx;
+  return function(row, col, len, out, off) {
+    var dy = row - cyPx;
+    for (var i = 0; i < len; i++) {
+      var dx = col + i - cxPx;
       var angle = Math.atan2(dy, dx) - fromRad;
       // Normalise to [0,1]
       var t = ((angle / (2 * Math.PI)) % 1 + 1) % 1;
-      canvas.setPixel(x + col, py, sampleStops(stops, t));
+      out[off + i] = lut[lutIndex(t)];
     }
-  }
+  };
 }
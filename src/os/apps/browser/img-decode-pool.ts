@@ -0,0 +1,638 @@
+/**
+ * img-decode-pool.ts — Off-main-runtime image decoding
+ *
+ * PNG and JPEG decodes run in a small pool of child runtimes instead of the
+ * browser's own runtime, so an image-heavy page keeps scrolling while it
+ * loads and the decoders' temporaries never touch the main GC heap.
+ *
+ *   imageDecodePool.decode(bytes, tw, th, maxW, function(img, natW, natH) { … });
+ *   imageDecodePool.tick();   // once per frame (BrowserApp.tick)
+ *
+ * Each request carries a target size.  The worker decodes straight to it:
+ * JPEG drops to the smallest DCT scale (1/2, 1/4, 1/8) that still covers
+ * the target, then both formats are box-filtered down to exactly tw × th.
+ * tw = th = 0 keeps the natural size, shrunk to fit maxW when maxW > 0.
+ *
+ * Transport is zero-copy in both directions: the encoded bytes go to the
+ * worker in a kernel region (bufferTransfer / bufferAccept), and the worker
+ * writes pixels into a region of its own that moves back the same way, so
+ * the Uint32Array the browser blits is the memory the worker filled.  Only
+ * a tiny JSON header crosses the IPC ring.
+ *
+ * Workers run on application processors (JSProcess.runOn) when the machine
+ * has them.  On a single CPU one job per frame runs on the BSP, still in
+ * the child runtime.  If no child runtime can be created, or the kernel is
+ * out of shared regions, the same decode code runs inline, one job per
+ * frame.
+ *
+ * GIF first frames go through the same path (gifCodec); WebP keeps its
+ * synchronous decoder.
+ *
+ * Streaming: stream() opens a decode that is fed bytes while the
+ * response is still arriving.  It is pinned to one worker, which keeps the
+ * codec's ImageStream across feeds and writes rows straight into a shared
+ * region the browser maps on the first reply; each reply names the output
+ * rows that changed, so the page repaints only that band of the image.
+ *
+ *   var h = imageDecodePool.stream(tw, th, maxW, function(img, natW, natH, y0, y1, done) { … });
+ *   h.feed(chunk, false); … h.feed(lastChunk, true);
+ */
+
+import { os } from '../../core/sdk.js';
+import { JSProcess } from '../../process/jsprocess.js';
+import { transferableBuffer, bufferTransfer, bufferAccept } from '../../ipc/ipc.js';
+import { jpegCodec } from './img-jpeg.js';
+import { pngCodec } from './img-png.js';
+import { gifCodec } from './img-gif.js';
+import type { DecodedImage, ImageStream } from './types.js';
+
+declare var kernel: import('../../core/kernel.js').KernelAPI;
+
+// ── Decode-to-target (runs in workers and inline) ───────────────────────────
+//
+// Self-contained like the codecs: the worker source is built from
+// imageJobs.toString().
+
+export function imageJobs(jpeg: ReturnType<typeof jpegCodec>, png: ReturnType<typeof pngCodec>,
+                          gif: ReturnType<typeof gifCodec>) {
+  // Box-filter (shrink) / nearest (grow) resample into dst, rows [y0, y1)
+  function resample(src: Uint32Array, sw: number, sh: number, dst: Uint32Array, dw: number, dh: number,
+                    y0?: number, y1?: number): void {
+    var x0 = new Int32Array(dw + 1);
+    for (var x = 0; x <= dw; x++) x0[x] = Math.floor(x * sw / dw);
+    var yEnd = y1 === undefined ? dh : y1;
+    for (var y = y0 || 0; y < yEnd; y++) {
+      var ya = Math.floor(y * sh / dh), yb = Math.floor((y + 1) * sh / dh);
+      if (yb <= ya) yb = ya + 1;
+      for (var x2 = 0; x2 < dw; x2++) {
+        var xa = x0[x2], xb = x0[x2 + 1];
+        if (xb <= xa) xb = xa + 1;
+        if (yb - ya === 1 && xb - xa === 1) { dst[y * dw + x2] = src[ya * sw + xa]; continue; }
+        var a = 0, r = 0, g = 0, b = 0;
+        for (var sy = ya; sy < yb; sy++) {
+          var row = sy * sw;
+          for (var sx = xa; sx < xb; sx++) {
+            var p = src[row + sx];
+            a += p >>> 24; r += (p >>> 16) & 0xFF; g += (p >>> 8) & 0xFF; b += p & 0xFF;
+          }
+        }
+        var n = (yb - ya) * (xb - xa);
+        dst[y * dw + x2] = (((a / n + 0.5) | 0) << 24 | ((r / n + 0.5) | 0) << 16 |
+                            ((g / n + 0.5) | 0) << 8 | ((b / n + 0.5) | 0)) >>> 0;
+      }
+    }
+  }
+
+  // Output size for a natural size and request
+  function goal(nw: number, nh: number, tw: number, th: number, mw: number): { w: number; h: number } {
+    if (tw > 0 && th > 0) return { w: tw, h: th };
+    if (mw > 0 && nw > mw) return { w: mw, h: Math.max(1, Math.round(nh * mw / nw)) };
+    return { w: nw, h: nh };
+  }
+
+  function isGif(raw: Uint8Array): boolean { return raw[0] === 0x47 && raw[1] === 0x49 && raw[2] === 0x46; }
+
+  /**
+   * Decode PNG/JPEG/GIF `raw` to the requested size.  The returned pixels
+   * are always allocated through `alloc`, so the caller decides where they
+   * live.
+   */
+  function decode(raw: Uint8Array, tw: number, th: number, mw: number,
+                  alloc: (n: number) => Uint32Array): { w: number; h: number; nw: number; nh: number; data: Uint32Array; scale: number } | null {
+    var isJpeg = raw[0] === 0xFF && raw[1] === 0xD8;
+    var isPng  = raw[0] === 0x89 && raw[1] === 0x50;
+    if (!isJpeg && !isPng && !isGif(raw)) return null;
+    var dim = isJpeg ? jpeg.probe(raw) : isPng ? png.probe(raw) : gif.probe(raw);
+    if (!dim || dim.w <= 0 || dim.h <= 0) return null;
+    var g = goal(dim.w, dim.h, tw, th, mw);
+    var s = isJpeg ? jpeg.scaleFor(dim.w, dim.h, g.w, g.h) : 1;
+    var direct = Math.ceil(dim.w / s) === g.w && Math.ceil(dim.h / s) === g.h;
+    var img = isJpeg ? jpeg.decode(raw, s, direct ? alloc : undefined)
+            : isPng  ? png.decode(raw, direct ? alloc : undefined)
+                     : gif.decode(raw, direct ? alloc : undefined);
+    if (!img || !img.data) return null;
+    var out = img.data;
+    if (!direct) {
+      out = alloc(g.w * g.h);
+      resample(img.data, img.w, img.h, out, g.w, g.h);
+    }
+    return { w: g.w, h: g.h, nw: dim.w, nh: dim.h, data: out, scale: s };
+  }
+
+  /**
+   * Streaming decode().  Output geometry is fixed once the header
+   * is in, when `alloc` is called for the tw × th (or natural) pixels; after
+   * each push() [y0, y1) are the output rows that changed.  Rows of a scaled
+   * image are resampled as their source rows arrive.
+   */
+  function open(tw: number, th: number, mw: number, alloc: (n: number) => Uint32Array) {
+    var src: ImageStream | null = null;
+    var head: Uint8Array | null = null;
+    var direct = true;
+    var live = {
+      w: 0, h: 0, nw: 0, nh: 0, scale: 1, data: null as Uint32Array | null,
+      y0: 0, y1: 0, done: false, failed: false, push: push,
+    };
+
+    function pick(w: number, h: number): number {
+      var g = goal(w, h, tw, th, mw);
+      return (live.scale = jpeg.scaleFor(w, h, g.w, g.h));
+    }
+
+    // Called by the codec once the header is in
+    function out(n: number): Uint32Array {
+      var s = src!, g = goal(s.nw, s.nh, tw, th, mw);
+      live.w = g.w; live.h = g.h; live.nw = s.nw; live.nh = s.nh;
+      live.data = alloc(g.w * g.h);
+      direct = s.w === g.w && s.h === g.h;
+      return direct ? live.data : new Uint32Array(n);
+    }
+
+    function push(bytes: Uint8Array, fin: boolean): void {
+      if (live.done) return;
+      if (!src) {
+        // Pick the codec from the signature
+        if (head) { var hb = new Uint8Array(head.length + bytes.length); hb.set(head); hb.set(bytes, head.length); bytes = hb; }
+        if (bytes.length < 4 && !fin) { head = bytes; return; }
+        head = null;
+        src = bytes[0] === 0xFF && bytes[1] === 0xD8 ? jpeg.stream(pick, out)
+            : bytes[0] === 0x89 && bytes[1] === 0x50 ? png.stream(out)
+            : isGif(bytes) ? gif.stream(out) : null;
+        if (!src) { live.failed = live.done = true; return; }
+      }
+      src.push(bytes, fin);
+      if (src.y1 > src.y0 && live.data) {
+        var a = src.y0, b = src.y1;
+        if (!direct) {
+          a = Math.floor(a * live.h / src.h);
+          b = Math.min(live.h, Math.floor(b * live.h / src.h) + 1);
+          resample(src.data!, src.w, src.h, live.data, live.w, live.h, a, b);
+        }
+        if (live.y1 <= live.y0) { live.y0 = a; live.y1 = b; }
+        else { if (a < live.y0) live.y0 = a; if (b > live.y1) live.y1 = b; }
+      }
+      src.y0 = src.y1 = 0;
+      live.done = src.done;
+      live.failed = src.failed;
+    }
+
+    return live;
+  }
+
+  // Open streams in this worker: id → decoder and its output region
+  var streams: { [id: number]: { d: ReturnType<typeof open>; ab: ArrayBuffer | null; shm: number } } = {};
+
+  // One stream message.  {id, op: 'feed', buf, len, fin, tw, th, mw} replies
+  // {id, ok, shm, w, h, nw, nh, scale, y0, y1, done}; `shm` is the output
+  // region, held until the last reply, which instead carries it as transfer
+  // id `buf`.  {id, op: 'close'} drops the stream without a reply.
+  function feed(k: any, job: any): void {
+    var st = streams[job.id];
+    if (job.op === 'close') {
+      if (st && st.shm >= 0) k.sharedBufferRelease(st.shm);
+      delete streams[job.id];
+      return;
+    }
+    if (!st) {
+      var ns = { d: null as any, ab: null as ArrayBuffer | null, shm: -1 };
+      ns.d = open(job.tw, job.th, job.mw, function(n: number) {
+        var id = k.sharedBufferCreate(n * 4);
+        var ab = id >= 0 ? k.sharedBufferOpen(id) : null;
+        if (!ab) { if (id >= 0) k.sharedBufferRelease(id); ns.ab = new ArrayBuffer(n * 4); }
+        else { ns.ab = ab; ns.shm = id; }
+        return new Uint32Array(ns.ab!);
+      });
+      st = streams[job.id] = ns;
+    }
+    var d = st.d;
+    var inAb = job.buf >= 0 ? k.bufferAccept(job.buf) : null;
+    try { d.push(inAb ? new Uint8Array(inAb, 0, job.len) : new Uint8Array(0), job.fin); }
+    catch (_e) { d.failed = d.done = true; }
+    inAb = null;
+    // Without a region the rows cannot be shown while they arrive
+    var ok = !d.failed && (!d.data || st.shm >= 0);
+    var r: any = { id: job.id, ok: ok, shm: st.shm, w: d.w, h: d.h, nw: d.nw, nh: d.nh, scale: d.scale,
+                   y0: d.y0, y1: d.y1, done: d.done || !ok };
+    d.y0 = d.y1 = 0;
+    if (r.done) {
+      if (ok && st.ab) r.buf = k.bufferTransfer(st.ab);
+      if (st.shm >= 0) k.sharedBufferRelease(st.shm);
+      delete streams[job.id];
+    }
+    k.postMessage(JSON.stringify(r));
+  }
+
+  // Worker side: answer every queued job.  Request {id, buf, len, tw, th, mw};
+  // reply {id, ok, buf, w, h, nw, nh, scale} with `buf` a transfer id.
+  function serve(): number {
+    var k: any = kernel;   // the child runtime's kernel object
+    var done = 0;
+    var raw: any;
+    while ((raw = k.pollMessage()) !== null) {
+      var job = JSON.parse(raw);
+      if (job.op) { feed(k, job); done++; continue; }
+      var inAb = k.bufferAccept(job.buf);
+      var outAb: ArrayBuffer | null = null;
+      var r = null;
+      if (inAb) {
+        try {
+          r = decode(new Uint8Array(inAb, 0, job.len), job.tw, job.th, job.mw, function(n: number) {
+            var id = k.sharedBufferCreate(n * 4);
+            if (id >= 0) { outAb = k.sharedBufferOpen(id); k.sharedBufferRelease(id); }
+            if (!outAb) outAb = new ArrayBuffer(n * 4);
+            return new Uint32Array(outAb);
+          });
+        } catch (_e) { r = null; }
+      }
+      inAb = null;
+      var x = r && outAb ? k.bufferTransfer(outAb) : -1;
+      k.postMessage(JSON.stringify(r && x >= 0
+        ? { id: job.id, ok: true, buf: x, w: r.w, h: r.h, nw: r.nw, nh: r.nh, scale: r.scale }
+        : { id: job.id, ok: false, shm: !!r }));
+      done++;
+    }
+    return done;
+  }
+
+  return { decode: decode, open: open, resample: resample, serve: serve };
+}
+
+// ── Pool ────────────────────────────────────────────────────────────────────
+
+export type ImageDecodeCallback = (img: DecodedImage | null, natW: number, natH: number) => void;
+
+/**
+ * Progress of a streamed decode: output rows [y0, y1) of `img` changed.
+ * `img` keeps its identity between calls except that the last one may hand
+ * over a new array for the same pixels.  img === null with done set means
+ * the stream failed and the caller should decode the whole body instead.
+ */
+export type ImageStreamCallback = (img: DecodedImage | null, natW: number, natH: number,
+                                   y0: number, y1: number, done: boolean) => void;
+
+/** Caller's end of a streamed decode. */
+export interface ImageStreamHandle {
+  /** Queue bytes; `last` ends the stream. */
+  feed(bytes: Uint8Array, last: boolean): void;
+  /** Abandon the decode; no further callbacks. */
+  cancel(): void;
+}
+
+interface DecodeJob {
+  id:    number;
+  bytes: Uint8Array;
+  tw:    number;
+  th:    number;
+  mw:    number;
+  cb:    ImageDecodeCallback;
+  t0:    number;
+  /** A worker could not take it (no regions, crash): decode in this runtime. */
+  inline?: boolean;
+}
+
+interface StreamJob {
+  id:      number;
+  tw:      number;
+  th:      number;
+  mw:      number;
+  cb:      ImageStreamCallback;
+  t0:      number;
+  /** Bytes not yet handed to the decoder. */
+  chunks:  Uint8Array[];
+  queued:  number;
+  fin:     boolean;
+  sentFin: boolean;
+  /** Worker holding the decoder, once the first feed went out. */
+  worker:  DecodeWorker | null;
+  /** Decoding in this runtime (no worker, or it had no region). */
+  live:    ReturnType<ReturnType<typeof imageJobs>['open']> | null;
+  img:     DecodedImage | null;
+  ended:   boolean;
+}
+
+interface DecodeWorker {
+  proc: JSProcess;
+  job:  DecodeJob | null;
+  /** Stream whose feed is in flight. */
+  feed: StreamJob | null;
+}
+
+/** Results smaller than this are copied out so they don't pin a kernel region. */
+var _COPY_BELOW = 64 * 1024;
+/** AP deadline for one job; a decoder stuck longer than this is abandoned. */
+var _JOB_MAX_MS = 10000;
+/** Streams open at once; each holds a kernel region and its decoder state. */
+var _MAX_STREAMS = 4;
+
+export class ImageDecodePool {
+  private _workers: DecodeWorker[] = [];
+  private _queue:   DecodeJob[] = [];
+  private _streams: StreamJob[] = [];
+  private _inline:  ReturnType<typeof imageJobs> | null = null;
+  private _started  = false;
+  private _nextId   = 1;
+
+  readonly stats = {
+    submitted: 0, worker: 0, inline: 0, failed: 0,
+    bytesIn: 0, pixelsOut: 0, dctScaled: 0, totalMs: 0,
+    streams: 0, feeds: 0,
+  };
+
+  /** Queue `bytes` for decoding; `cb` runs from a later tick(). */
+  decode(bytes: Uint8Array, tw: number, th: number, maxW: number, cb: ImageDecodeCallback): void {
+    this.stats.submitted++;
+    this.stats.bytesIn += bytes.length;
+    this._queue.push({ id: this._nextId++, bytes, tw: tw | 0, th: th | 0, mw: maxW | 0, cb, t0: Date.now() });
+  }
+
+  /**
+   * Open a streamed decode, or null when _MAX_STREAMS are already
+   * open — decode() the whole body then.  Same target rules as decode().
+   */
+  stream(tw: number, th: number, maxW: number, cb: ImageStreamCallback): ImageStreamHandle | null {
+    if (this._streams.length >= _MAX_STREAMS) return null;
+    var st: StreamJob = { id: this._nextId++, tw: tw | 0, th: th | 0, mw: maxW | 0, cb, t0: Date.now(),
+                          chunks: [], queued: 0, fin: false, sentFin: false, worker: null, live: null, img: null, ended: false };
+    this._streams.push(st);
+    this.stats.streams++;
+    var self = this;
+    return {
+      feed: function(bytes: Uint8Array, last: boolean): void {
+        if (st.ended || st.fin) return;
+        if (bytes.length) { st.chunks.push(bytes); st.queued += bytes.length; self.stats.bytesIn += bytes.length; }
+        st.fin = last;
+      },
+      cancel: function(): void { self._endStream(st, false); },
+    };
+  }
+
+  /** Jobs queued or in flight. */
+  get pending(): number {
+    var n = this._queue.length + this._streams.length;
+    for (var i = 0; i < this._workers.length; i++) if (this._workers[i].job) n++;
+    return n;
+  }
+
+  /** Worker runtimes currently alive. */
+  get workerCount(): number { return this._workers.length; }
+
+  /**
+   * Collect finished jobs and hand out queued ones.  At most one decode runs
+   * on the BSP per call (in a worker when there is no AP, otherwise inline
+   * as the last resort), so a frame is never charged for more than one.
+   */
+  tick(): void {
+    if (!this.pending) return;
+    if (!this._started) this._start();
+    var bspUsed = false, starved = false;
+
+    for (var i = 0; i < this._workers.length; i++) {
+      var w = this._workers[i];
+      var busy = !!(w.job || w.feed);
+      if (busy && w.proc.runningOn > 0) {
+        var rr = w.proc.runResult();
+        if (!rr) continue;
+        this._collect(w, rr.status);
+      } else if (busy && !bspUsed) {
+        bspUsed = true;
+        var rs = w.proc.evalSlice('__imgServe()', 0);
+        this._collect(w, rs.status);
+      }
+      if (!w.proc.alive) { this._dropWorker(w); this._workers.splice(i--, 1); continue; }
+      // Stream bytes first: a page is waiting on those pixels right now
+      if (!w.job && !w.feed && !this._feedNext(w) && this._queue.length && !this._dispatch(w)) starved = true;
+    }
+
+    if (!bspUsed) {
+      var st = this._nextInlineStream();
+      if (st) this._feedInline(st);
+      else if (this._queue.length && (!this._workers.length || starved || this._queue[0].inline)) {
+        this._runInline(this._queue.shift()!);
+      }
+    }
+  }
+
+  /** Stop the workers; queued jobs fall back to inline decoding. */
+  shutdown(): void {
+    for (var i = 0; i < this._workers.length; i++) {
+      var w = this._workers[i];
+      if (w.job) this._queue.unshift(w.job);
+      this._dropWorker(w);
+      try { os.wm.unregisterManagedProc(w.proc.id); } catch (_) {}
+      w.proc.terminate();
+    }
+    this._workers = [];
+  }
+
+  private _start(): void {
+    this._started = true;
+    var cpus = typeof kernel.smpCpuCount === 'function' ? kernel.smpCpuCount() : 1;
+    var n = Math.max(1, Math.min(3, cpus - 1));
+    var src =
+      'var __imgJobs = (' + imageJobs.toString() + ')((' + jpegCodec.toString() + ')(), (' +
+      pngCodec.toString() + ')(), (' + gifCodec.toString() + ')());\n' +
+      'function __imgServe() { return __imgJobs.serve(); }\n';
+    for (var i = 0; i < n; i++) {
+      try {
+        var p = JSProcess.spawnWarm(src, 'imgdecode' + i);
+        try { os.wm.registerManagedProc(p.id); } catch (_) {}
+        this._workers.push({ proc: p, job: null, feed: null });
+      } catch (_e) {
+        break;   // out of runtime slots — decode with what we have
+      }
+    }
+  }
+
+  /** Hand the head of the queue to `w`.  False when it has to stay here. */
+  private _dispatch(w: DecodeWorker): boolean {
+    var job = this._queue[0];
+    if (job.inline) return false;
+    var ab = transferableBuffer(job.bytes.length);
+    new Uint8Array(ab).set(job.bytes);
+    var x = bufferTransfer(ab);
+    if (x < 0) { job.inline = true; return false; }   // out of kernel regions
+    if (!w.proc.send({ id: job.id, buf: x, len: job.bytes.length, tw: job.tw, th: job.th, mw: job.mw })) {
+      bufferAccept(x);   // reclaim the region
+      return false;
+    }
+    this._queue.shift();
+    w.job = job;
+    // Without an AP the job waits for the next BSP slot in tick()
+    w.proc.runOn('__imgServe()', 0, _JOB_MAX_MS);
+    return true;
+  }
+
+  private _collect(w: DecodeWorker, status: string): void {
+    if (w.feed) { this._collectFeed(w, status); return; }
+    var job = w.job!;
+    w.job = null;
+    var msgs = w.proc.recvAll();
+    var reply: any = null;
+    for (var i = 0; i < msgs.length; i++) if (msgs[i] && msgs[i].id === job.id) reply = msgs[i];
+    if (!reply || (!reply.ok && reply.shm)) {
+      // The worker threw before replying, or had no region for the pixels:
+      // give the image one try here.  A timeout means the decoder itself is
+      // too slow and would only stall this runtime instead.
+      if (status === 'timeout') { this._finish(job, null, 0, 0); return; }
+      job.inline = true;
+      this._queue.unshift(job);
+      return;
+    }
+    if (!reply.ok) { this._finish(job, null, 0, 0); return; }
+    var out = bufferAccept(reply.buf);
+    if (!out) { this._finish(job, null, reply.nw, reply.nh); return; }
+    var data = new Uint32Array(out);
+    if (data.byteLength < _COPY_BELOW) data = data.slice();
+    this.stats.worker++;
+    if (reply.scale > 1) this.stats.dctScaled++;
+    this._finish(job, { w: reply.w, h: reply.h, data }, reply.nw, reply.nh);
+  }
+
+  // ── Streams ───────────────────────────────────────────────────────────────
+
+  /** Send `w` the pending bytes of a stream pinned to it, or of a new one. */
+  private _feedNext(w: DecodeWorker): boolean {
+    for (var i = 0; i < this._streams.length; i++) {
+      var st = this._streams[i];
+      if (st.live || st.sentFin || (st.worker && st.worker !== w) || (!st.queued && !st.fin)) continue;
+      var x = -1;
+      if (st.queued) {
+        var ab = transferableBuffer(st.queued);
+        var u8 = new Uint8Array(ab), off = 0;
+        for (var c = 0; c < st.chunks.length; c++) { u8.set(st.chunks[c], off); off += st.chunks[c].length; }
+        x = bufferTransfer(ab);
+        if (x < 0) return false;   // out of kernel regions: try next frame
+      }
+      if (!w.proc.send({ id: st.id, op: 'feed', buf: x, len: st.queued, fin: st.fin,
+                         tw: st.tw, th: st.th, mw: st.mw })) {
+        if (x >= 0) bufferAccept(x);
+        return false;
+      }
+      st.chunks = []; st.queued = 0;
+      st.sentFin = st.fin;
+      st.worker = w;
+      w.feed = st;
+      this.stats.feeds++;
+      w.proc.runOn('__imgServe()', 0, _JOB_MAX_MS);
+      return true;
+    }
+    return false;
+  }
+
+  private _collectFeed(w: DecodeWorker, status: string): void {
+    var st = w.feed!;
+    w.feed = null;
+    var msgs = w.proc.recvAll();
+    var r: any = null;
+    for (var i = 0; i < msgs.length; i++) if (msgs[i] && msgs[i].id === st.id) r = msgs[i];
+    if (st.ended) {
+      if (r && r.buf >= 0) bufferAccept(r.buf);   // cancelled: reclaim the region
+      return;
+    }
+    if (!r || !r.ok) {
+      // Crash, timeout or no region: the caller decodes the full body
+      this._endStream(st, true);
+      return;
+    }
+    if (r.done && r.buf !== undefined) {
+      var out = r.buf >= 0 ? bufferAccept(r.buf) : null;
+      if (out && (!st.img || out.byteLength < _COPY_BELOW)) {
+        // Small results are copied out so they don't pin a kernel region;
+        // a large one keeps the view already mapped
+        var data = new Uint32Array(out);
+        if (data.byteLength < _COPY_BELOW) data = data.slice();
+        st.img = { w: r.w, h: r.h, data };
+        r.y0 = 0; r.y1 = r.h;
+      }
+    } else if (!st.img && r.shm >= 0) {
+      var view = kernel.sharedBufferOpen(r.shm);
+      if (view) st.img = { w: r.w, h: r.h, data: new Uint32Array(view) };
+    }
+    if (r.done && r.scale > 1) this.stats.dctScaled++;
+    this._progress(st, r.nw, r.nh, r.y0, r.y1, r.done);
+  }
+
+  // Streams that decode in this runtime: no worker could be started
+  private _nextInlineStream(): StreamJob | null {
+    if (this._workers.length) return null;
+    for (var i = 0; i < this._streams.length; i++) {
+      var st = this._streams[i];
+      if (!st.worker && !st.sentFin && (st.queued || st.fin)) return st;
+    }
+    return null;
+  }
+
+  private _feedInline(st: StreamJob): void {
+    if (!this._inline) this._inline = imageJobs(jpegCodec(), pngCodec(), gifCodec());
+    if (!st.live) st.live = this._inline.open(st.tw, st.th, st.mw, function(n) { return new Uint32Array(n); });
+    var d = st.live;
+    var chunks = st.chunks;
+    st.chunks = []; st.queued = 0;
+    st.sentFin = st.fin;
+    try {
+      for (var i = 0; i < chunks.length; i++) d.push(chunks[i], st.fin && i === chunks.length - 1);
+      if (st.fin && !chunks.length) d.push(new Uint8Array(0), true);
+    } catch (_e) { d.failed = d.done = true; }
+    if (d.failed) { this._endStream(st, true); return; }
+    if (d.data && !st.img) st.img = { w: d.w, h: d.h, data: d.data };
+    var y0 = d.y0, y1 = d.y1;
+    d.y0 = d.y1 = 0;
+    if (d.done && d.scale > 1) this.stats.dctScaled++;
+    this._progress(st, d.nw, d.nh, y0, y1, d.done);
+  }
+
+  private _progress(st: StreamJob, nw: number, nh: number, y0: number, y1: number, done: boolean): void {
+    if (done) {
+      if (!st.img) { this._endStream(st, true); return; }   // never got past the header
+      this._streams.splice(this._streams.indexOf(st), 1);
+      st.ended = true;
+      this.stats.pixelsOut += st.img.w * st.img.h;
+      if (st.live) this.stats.inline++; else this.stats.worker++;
+      this.stats.totalMs += Date.now() - st.t0;
+    }
+    if (!st.img || (y1 <= y0 && !done)) return;
+    try { st.cb(st.img, nw, nh, y0, y1, done); } catch (_) {}
+  }
+
+  /** Close a stream early; `failed` tells the caller to decode the whole body. */
+  private _endStream(st: StreamJob, failed: boolean): void {
+    if (st.ended) return;
+    st.ended = true;
+    var i = this._streams.indexOf(st);
+    if (i >= 0) this._streams.splice(i, 1);
+    if (st.worker && st.worker.proc.alive) st.worker.proc.send({ id: st.id, op: 'close' });
+    if (failed) {
+      this.stats.failed++;
+      try { st.cb(null, 0, 0, 0, 0, true); } catch (_) {}
+    }
+  }
+
+  // A worker went away: its streams lost their decoders
+  private _dropWorker(w: DecodeWorker): void {
+    var lost = this._streams.filter(function(st) { return st.worker === w; });
+    w.feed = null;
+    for (var i = 0; i < lost.length; i++) { lost[i].worker = null; this._endStream(lost[i], true); }
+  }
+
+  private _runInline(job: DecodeJob): void {
+    if (!this._inline) this._inline = imageJobs(jpegCodec(), pngCodec(), gifCodec());
+    var r = null;
+    try {
+      r = this._inline.decode(job.bytes, job.tw, job.th, job.mw, function(n) { return new Uint32Array(n); });
+    } catch (_e) { r = null; }
+    if (r) {
+      this.stats.inline++;
+      if (r.scale > 1) this.stats.dctScaled++;
+    }
+    this._finish(job, r ? { w: r.w, h: r.h, data: r.data } : null, r ? r.nw : 0, r ? r.nh : 0);
+  }
+
+  private _finish(job: DecodeJob, img: DecodedImage | null, nw: number, nh: number): void {
+    if (img) this.stats.pixelsOut += img.w * img.h;
+    else this.stats.failed++;
+    this.stats.totalMs += Date.now() - job.t0;
+    try { job.cb(img, nw, nh); } catch (_) {}
+  }
+}
+
+export var imageDecodePool = new ImageDecodePool();
@@ -12,9 +12,12 @@
  *  - Frame disposal methods: 0/1 (leave), 2 (restore background), 3 (restore previous)
  *  - Animation: frame delays encoded in GCE
  *  - Output: GIFFrame[] with per-frame pixel data (0xAARRGGBB Uint32Array)
+ *
+ * gifCodec() is the browser's path: a self-contained first-frame decoder
+ * that streams rows as the bytes arrive.
  */
 
-import type { DecodedImage } from './types.js';
+import type { DecodedImage, ImageStream } from './types.js';
 
 // ── Types ─────────────────────────────────────────────────────────────────────
 
@@ -363,6 +366,253 @@ function _decodeGIF(bytes: Uint8Array): GIFResult | null {
   return { w: canvasW, h: canvasH, frames, loopCount };
 }
 
+// ── Streaming first-frame codec ──────────────────────────────────────────────
+// The browser shows the first frame of a GIF.  Like jpegCodec/pngCodec this
+// closure has no outside references, so the image decode pool can ship
+// gifCodec.toString() to its workers.
+
+export function gifCodec() {
+  function probe(raw: Uint8Array): { w: number; h: number } | null {
+    if (raw.length < 10 || raw[0] !== 0x47 || raw[1] !== 0x49 || raw[2] !== 0x46 || raw[3] !== 0x38) return null;
+    return { w: raw[6] | (raw[7] << 8), h: raw[8] | (raw[9] << 8) };
+  }
+
+  /**
+   * Decode the first frame incrementally.  LZW codes are consumed a byte at
+   * a time as sub-blocks arrive, and every completed row is written to the
+   * canvas and marked.  Interlaced rows are drawn as blocks down to the next
+   * pass so the picture fills in coarse-to-fine.
+   */
+  function stream(alloc?: (n: number) => Uint32Array): ImageStream {
+    var buf = new Uint8Array(0), len = 0, pos = 0;
+    var whole = false, last = false;
+    var state = 0;                 // 0 screen descriptor, 1 blocks, 2 image data
+    var gct: Uint8Array | null = null, gctSize = 0;
+    var transp = -1;               // from the GCE before the frame
+    var sawFrame = false;
+
+    // Frame
+    var fx = 0, fy = 0, fw = 0, fh = 0, interlaced = false;
+    var pal = new Uint32Array(256);
+    var idx = new Uint8Array(0);
+    var rowsOut = 0;               // rows written, in stream order
+    var blockLeft = 0;             // bytes left in the current data sub-block
+
+    // LZW: string k = string prefix[k] followed by suffix[k]
+    var prefix = new Uint16Array(4096), suffix = new Uint8Array(4096);
+    var first = new Uint8Array(4096), lenOf = new Uint16Array(4096);
+    var minSize = 0, clear = 0, eoi = 0, size = 0, mask = 0, next = 0, prev = -1;
+    var bits = 0, nbits = 0, ip = 0;
+
+    var s: ImageStream = { w: 0, h: 0, nw: 0, nh: 0, data: null, y0: 0, y1: 0,
+                           done: false, failed: false, push: push };
+
+    function mark(a: number, b: number): void {
+      if (s.y1 <= s.y0) { s.y0 = a; s.y1 = b; return; }
+      if (a < s.y0) s.y0 = a;
+      if (b > s.y1) s.y1 = b;
+    }
+
+    function palette(src: Uint8Array, off: number, n: number): void {
+      pal.fill(0);
+      for (var i = 0; i < n; i++) {
+        if (i === transp) continue;
+        pal[i] = (0xFF000000 | (src[off + i * 3] << 16) | (src[off + i * 3 + 1] << 8) | src[off + i * 3 + 2]) >>> 0;
+      }
+    }
+
+    // Canvas row and block height of stream row r
+    var _blk = 1;
+    function rowOf(r: number): number {
+      if (!interlaced) { _blk = 1; return r; }
+      var n1 = (fh + 7) >> 3;
+      if (r < n1) { _blk = 8; return r * 8; }
+      r -= n1;
+      var n2 = (fh + 3) >> 3;
+      if (r < n2) { _blk = 4; return 4 + r * 8; }
+      r -= n2;
+      var n3 = (fh + 1) >> 2;
+      if (r < n3) { _blk = 2; return 2 + r * 4; }
+      _blk = 1;
+      return 1 + (r - n3) * 2;
+    }
+
+    // Write stream rows up to `upto` (pixel count) onto the canvas
+    function rows(upto: number): void {
+      var out = s.data!, cw = s.w, ch = s.h;
+      var x1 = Math.min(fw, cw - fx);
+      while (rowsOut * fw < upto && rowsOut < fh) {
+        var r = rowsOut, n = Math.min(fw, upto - r * fw);
+        if (n < fw) x1 = Math.min(x1, n);
+        var y = rowOf(r), cy = fy + y;
+        if (cy < ch && x1 > 0) {
+          var o = cy * cw + fx, ii = r * fw;
+          // The first frame goes onto an empty canvas, so transparent pixels
+          // are stored as 0 rather than skipped (that also clears the rows a
+          // coarser interlace pass replicated into)
+          for (var x = 0; x < x1; x++) out[o + x] = pal[idx[ii + x]];
+          var bh = whole ? 1 : Math.min(_blk, fh - y, ch - cy);
+          for (var by = 1; by < bh; by++) out.copyWithin(o + by * cw, o, o + x1);
+          mark(cy, cy + Math.max(1, bh));
+        }
+        if (n < fw) break;
+        rowsOut++;
+      }
+    }
+
+    function finish(): void {
+      if (state === 2) rows(ip);
+      s.failed = !sawFrame;
+      s.done = true;
+    }
+
+    function lzwReset(): void {
+      size = minSize + 1;
+      mask = (1 << size) - 1;
+      next = eoi + 1;
+      prev = -1;
+    }
+
+    // Feed image data bytes; false once the frame is complete
+    function lzw(from: number, to: number): boolean {
+      var total = fw * fh;
+      for (var p = from; p < to; p++) {
+        bits |= buf[p] << nbits;
+        nbits += 8;
+        while (nbits >= size) {
+          var code = bits & mask;
+          bits >>>= size;
+          nbits -= size;
+          if (code === clear) { lzwReset(); continue; }
+          if (code === eoi) return false;
+          if (prev < 0) {
+            if (code > clear) return false;
+            if (ip < total) idx[ip] = code;
+            ip++;
+            prev = code;
+            continue;
+          }
+          if (code > next || (code === next && next >= 4096)) return false;   // corrupt
+          if (next < 4096) {
+            prefix[next] = prev;
+            suffix[next] = code < next ? first[code] : first[prev];
+            first[next] = first[prev];
+            lenOf[next] = lenOf[prev] + 1;
+            next++;
+            if (next > mask && size < 12) { size++; mask = (1 << size) - 1; }
+          }
+          var l = lenOf[code], end = ip + l, q = end, k = code;
+          while (q > ip) {
+            q--;
+            if (q < total) idx[q] = suffix[k];
+            k = prefix[k];
+          }
+          ip = end;
+          prev = code;
+          if (ip >= total) return false;
+        }
+      }
+      return true;
+    }
+
+    // Length of the sub-block chain at p, or -1 when it is not all here
+    function chain(p: number): number {
+      var q = p;
+      while (q < len) {
+        if (buf[q] === 0) return q + 1 - p;
+        q += buf[q] + 1;
+      }
+      return -1;
+    }
+
+    function push(bytes: Uint8Array, fin: boolean): void {
+      if (s.done) return;
+      if (len === 0 && fin) { buf = bytes; len = bytes.length; whole = true; }
+      else if (bytes.length) {
+        if (len + bytes.length > buf.length) {
+          var b2 = new Uint8Array(Math.max(buf.length * 2, len + bytes.length, 4096));
+          b2.set(buf.subarray(0, len));
+          buf = b2;
+        }
+        buf.set(bytes, len);
+        len += bytes.length;
+      }
+      last = fin;
+
+      while (!s.done) {
+        if (state === 0) {
+          if (len < 13) break;
+          var dim = probe(buf);
+          if (!dim || dim.w <= 0 || dim.h <= 0 || dim.w > 4096 || dim.h > 4096) { s.failed = s.done = true; return; }
+          var packed = buf[10];
+          gctSize = packed & 0x80 ? 2 << (packed & 7) : 0;
+          if (len < 13 + gctSize * 3) break;
+          gct = buf.slice(13, 13 + gctSize * 3);
+          s.w = s.nw = dim.w; s.h = s.nh = dim.h;
+          s.data = alloc ? alloc(dim.w * dim.h) : new Uint32Array(dim.w * dim.h);
+          if (alloc) s.data.fill(0);
+          pos = 13 + gctSize * 3;
+          state = 1;
+        } else if (state === 1) {
+          if (pos >= len) break;
+          var b = buf[pos];
+          if (b === 0x21) {
+            if (pos + 2 > len) break;
+            var cl = chain(pos + 2);
+            if (cl < 0) break;
+            // Graphic Control Extension: transparent colour of the frame
+            if (buf[pos + 1] === 0xF9 && buf[pos + 2] >= 4) transp = buf[pos + 3] & 1 ? buf[pos + 6] : -1;
+            pos += 2 + cl;
+          } else if (b === 0x2C) {
+            if (pos + 11 > len) break;
+            var ip2 = buf[pos + 9];
+            var lct = ip2 & 0x80 ? 2 << (ip2 & 7) : 0;
+            if (pos + 11 + lct * 3 > len) break;
+            fx = buf[pos + 1] | (buf[pos + 2] << 8); fy = buf[pos + 3] | (buf[pos + 4] << 8);
+            fw = buf[pos + 5] | (buf[pos + 6] << 8); fh = buf[pos + 7] | (buf[pos + 8] << 8);
+            interlaced = (ip2 & 0x40) !== 0;
+            if (lct) palette(buf, pos + 10, lct); else if (gct) palette(gct, 0, gctSize);
+            minSize = buf[pos + 10 + lct * 3];
+            pos += 11 + lct * 3;
+            sawFrame = true;
+            if (minSize < 2 || minSize > 11 || fw * fh <= 0 || fx >= s.w || fy >= s.h) { finish(); return; }
+            clear = 1 << minSize; eoi = clear + 1;
+            for (var i = 0; i < clear; i++) { suffix[i] = first[i] = i; lenOf[i] = 1; }
+            lzwReset();
+            idx = new Uint8Array(fw * fh);
+            state = 2;
+          } else {
+            finish();   // trailer, or garbage
+          }
+        } else {
+          if (pos >= len) break;
+          if (blockLeft === 0) {
+            blockLeft = buf[pos++];
+            if (blockLeft === 0) { finish(); return; }
+          }
+          var end = Math.min(len, pos + blockLeft);
+          var more = lzw(pos, end);
+          blockLeft -= end - pos;
+          pos = end;
+          if (!more) { finish(); return; }
+          rows(ip);
+        }
+      }
+      if (last && !s.done) finish();
+    }
+
+    return s;
+  }
+
+  function decode(raw: Uint8Array, alloc?: (n: number) => Uint32Array): DecodedImage | null {
+    var s = stream(alloc);
+    s.push(raw, true);
+    return s.data && !s.failed ? { w: s.w, h: s.h, data: s.data } : null;
+  }
+
+  return { decode: decode, stream: stream, probe: probe };
+}
+
 /**
  * Decode a GIF and return the first frame as a static DecodedImage,
  * compatible with the img-png.ts / img-jpeg.ts API.
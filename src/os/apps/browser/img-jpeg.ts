@@ -1,403 +1,914 @@
 /**
- * img-jpeg.ts — Baseline JPEG decoder (SOF0)
+ * img-jpeg.ts — Baseline and progressive JPEG decoder (SOF0/1/2)
  *
  * Supports:
  *   • 8-bit YCbCr and greyscale
+ *   • Progressive scans (spectral selection, successive approximation)
  *   • 4:4:4, 4:2:2, 4:2:0 chroma subsampling
- *   • Standard JFIF/EXIF markers
+ *   • Standard JFIF/EXIF markers, restart intervals (DRI / RSTn)
+ *   • DCT-domain downscaling to 1/2, 1/4 and 1/8 size
+ *
+ * Decoding runs one MCU row at a time: Huffman decode into a coefficient
+ * band, integer IDCT of the band, then colour conversion of that strip.
+ * The IDCT and colour loops use kernel.jpegIdct / kernel.jpegColor when
+ * present and identical integer JS otherwise.  Progressive and
+ * multi-scan images keep their coefficients and run the same band pipeline
+ * once the scans are in.  stream() decodes incrementally as bytes arrive.
  *
  * Returns DecodedImage { w, h, data: Uint32Array(w*h) } of 0xFFRRGGBB pixels.
  */
 
+import type { ImageStream } from './types.js';
+
 export interface DecodedImage { w: number; h: number; data: Uint32Array; }
 
-// ── Zigzag scan order ─────────────────────────────────────────────────────
-// Maps zigzag index → natural matrix index (row*8+col)
-const ZZ = new Uint8Array([
-   0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
-  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
-  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
-  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
-]);
-
-// ── IDCT cosine lookup ────────────────────────────────────────────────────
-// ICOS[u*8+x] = C(u) * cos((2x+1)*u*pi/16)  (floating point, computed once)
-const ICOS = new Float32Array(64);
-(function () {
-  const SQRT2_INV = 0.7071067811865476;
-  for (var u = 0; u < 8; u++) {
-    var cu = u === 0 ? SQRT2_INV : 1.0;
+declare var kernel: import('../../core/kernel.js').KernelAPI;
+
+// ── Codec ─────────────────────────────────────────────────────────────────
+// The whole decoder is one closure with no outside references, so the
+// image decode pool can evaluate jpegCodec.toString() in a child runtime.
+
+export function jpegCodec(jsOnly?: boolean) {
+  // Kernel pixel loops when this runtime has them; jsOnly forces
+  // the JS versions (bench.imgdecode compares the two).
+  var _k: any = !jsOnly && typeof kernel !== 'undefined' ? kernel : null;
+  var native = !!_k && typeof _k.jpegIdct === 'function' && typeof _k.jpegColor === 'function';
+
+  // ── Zigzag scan order ─────────────────────────────────────────────────────
+  // Maps zigzag index → natural matrix index (row*8+col)
+  const ZZ = new Uint8Array([
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+  ]);
+
+  // ── Inverse DCT ───────────────────────────────────────────────────────────
+  // Integer transforms, bit-identical to kernel.jpegIdct (src/kernel/
+  // imgcodec.c), which is used instead when the kernel provides it.
+  //
+  // 8×8 is the AAN scaled IDCT with 8-bit butterfly constants.  The AAN
+  // scale factors (×2^14) are folded into dequantisation and the product is
+  // rounded to AAN_FRAC fraction bits; columns or rows with no AC energy
+  // short-cut to their DC value.
+  const AAN_SCALES = new Uint16Array([
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+     8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+     4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247,
+  ]);
+  // Fraction bits through both passes; the final descale adds the 8× of
+  // the two passes, rounded, with the +128 level shift folded in.
+  const AAN_FRAC  = 6;
+  const DEQ_ROUND = 1 << (13 - AAN_FRAC), DEQ_SHIFT = 14 - AAN_FRAC;
+  const AAN_SHIFT = AAN_FRAC + 3;
+  const AAN_BIAS  = (1 << (AAN_SHIFT - 1)) + (128 << AAN_SHIFT);
+
+  var _ws = new Int32Array(64);
+  var _aanQ = new Int32Array(64);
+
+  function clamp8(v: number): number { return v < 0 ? 0 : v > 255 ? 255 : v; }
+
+  function idct8(c: Int16Array, ci: number, q: Int32Array, out: Uint8Array, oi: number, stride: number): void {
+    var ws = _ws;
     for (var x = 0; x < 8; x++) {
-      ICOS[u * 8 + x] = cu * Math.cos((2 * x + 1) * u * Math.PI / 16);
+      var p = ci + x;
+      if ((c[p + 8] | c[p + 16] | c[p + 24] | c[p + 32] | c[p + 40] | c[p + 48] | c[p + 56]) === 0) {
+        var dc = (c[p] * q[x] + DEQ_ROUND) >> DEQ_SHIFT;
+        ws[x] = ws[x + 8] = ws[x + 16] = ws[x + 24] = ws[x + 32] = ws[x + 40] = ws[x + 48] = ws[x + 56] = dc;
+        continue;
+      }
+      var t0 = (c[p] * q[x] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t1 = (c[p + 16] * q[x + 16] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t2 = (c[p + 32] * q[x + 32] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t3 = (c[p + 48] * q[x + 48] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t10 = t0 + t2, t11 = t0 - t2;
+      var t13 = t1 + t3, t12 = (((t1 - t3) * 362) >> 8) - t13;
+      t0 = t10 + t13; t3 = t10 - t13;
+      t1 = t11 + t12; t2 = t11 - t12;
+
+      var t4 = (c[p + 8] * q[x + 8] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t5 = (c[p + 24] * q[x + 24] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t6 = (c[p + 40] * q[x + 40] + DEQ_ROUND) >> DEQ_SHIFT;
+      var t7 = (c[p + 56] * q[x + 56] + DEQ_ROUND) >> DEQ_SHIFT;
+      var z13 = t6 + t5, z10 = t6 - t5, z11 = t4 + t7, z12 = t4 - t7;
+      t7 = z11 + z13;
+      t11 = ((z11 - z13) * 362) >> 8;
+      var z5 = ((z10 + z12) * 473) >> 8;
+      t10 = ((z12 * 277) >> 8) - z5;
+      t12 = ((z10 * -669) >> 8) + z5;
+      t6 = t12 - t7; t5 = t11 - t6; t4 = t10 + t5;
+
+      ws[x]      = t0 + t7; ws[x + 56] = t0 - t7;
+      ws[x + 8]  = t1 + t6; ws[x + 48] = t1 - t6;
+      ws[x + 16] = t2 + t5; ws[x + 40] = t2 - t5;
+      ws[x + 32] = t3 + t4; ws[x + 24] = t3 - t4;
+    }
+    for (var y = 0; y < 64; y += 8, oi += stride) {
+      var d0 = ws[y] + AAN_BIAS;
+      if ((ws[y + 1] | ws[y + 2] | ws[y + 3] | ws[y + 4] | ws[y + 5] | ws[y + 6] | ws[y + 7]) === 0) {
+        var v = clamp8(d0 >> AAN_SHIFT);
+        out[oi] = out[oi + 1] = out[oi + 2] = out[oi + 3] = out[oi + 4] = out[oi + 5] = out[oi + 6] = out[oi + 7] = v;
+        continue;
+      }
+      var e10 = d0 + ws[y + 4], e11 = d0 - ws[y + 4];
+      var e13 = ws[y + 2] + ws[y + 6], e12 = (((ws[y + 2] - ws[y + 6]) * 362) >> 8) - e13;
+      var e0 = e10 + e13, e3 = e10 - e13, e1 = e11 + e12, e2 = e11 - e12;
+
+      var y13 = ws[y + 5] + ws[y + 3], y10 = ws[y + 5] - ws[y + 3];
+      var y11 = ws[y + 1] + ws[y + 7], y12 = ws[y + 1] - ws[y + 7];
+      var e7 = y11 + y13;
+      e11 = ((y11 - y13) * 362) >> 8;
+      var y5 = ((y10 + y12) * 473) >> 8;
+      e10 = ((y12 * 277) >> 8) - y5;
+      e12 = ((y10 * -669) >> 8) + y5;
+      var e6 = e12 - e7, e5 = e11 - e6, e4 = e10 + e5;
+
+      out[oi]     = clamp8((e0 + e7) >> AAN_SHIFT); out[oi + 7] = clamp8((e0 - e7) >> AAN_SHIFT);
+      out[oi + 1] = clamp8((e1 + e6) >> AAN_SHIFT); out[oi + 6] = clamp8((e1 - e6) >> AAN_SHIFT);
+      out[oi + 2] = clamp8((e2 + e5) >> AAN_SHIFT); out[oi + 5] = clamp8((e2 - e5) >> AAN_SHIFT);
+      out[oi + 4] = clamp8((e3 + e4) >> AAN_SHIFT); out[oi + 3] = clamp8((e3 - e4) >> AAN_SHIFT);
     }
   }
-})();
 
-// 2D separable IDCT — coeff[v*8+u] (dequantized), out[y*8+x] (0-255 + level shift)
-function idct2d(coeff: Int16Array, out: Uint8Array): void {
-  var tmp = new Float32Array(64);
-  // Row-wise 1D IDCT: for each row v, transform over u → x
-  for (var v = 0; v < 8; v++) {
-    for (var x = 0; x < 8; x++) {
-      var s = 0.0;
-      for (var u = 0; u < 8; u++) s += ICOS[u * 8 + x] * coeff[v * 8 + u];
-      tmp[v * 8 + x] = s * 0.5;
+  // Reduced IDCT for DCT-domain downscaling: the top-left n×n coefficients
+  // through an n-point inverse transform give the block at 1/(8/n) size,
+  // with DC mapping to the block mean.  Constants are
+  // 0.5·C(u)·cos((2x+1)uπ/2n) × 2^12; rows keep 3 fraction bits.
+  const IDCT4 = new Int16Array([
+    1448,  1448,  1448,  1448,
+    1892,   784,  -784, -1892,
+    1448, -1448, -1448,  1448,
+     784, -1892,  1892,  -784,
+  ]);
+  const IDCT2 = new Int16Array([1448, 1448, 1448, -1448]);
+  var _tmpR = new Int32Array(16);
+
+  function idctReduced(c: Int16Array, ci: number, qt: Uint16Array, out: Uint8Array, oi: number, stride: number, n: number): void {
+    var t = n === 4 ? IDCT4 : IDCT2;
+    var tmp = _tmpR;
+    for (var v = 0; v < n; v++) {
+      for (var x = 0; x < n; x++) {
+        var s = 0;
+        for (var u = 0; u < n; u++) s += c[ci + v * 8 + u] * qt[v * 8 + u] * t[u * n + x];
+        tmp[v * n + x] = (s + 256) >> 9;
+      }
+    }
+    for (var x2 = 0; x2 < n; x2++) {
+      for (var y = 0; y < n; y++) {
+        var s2 = (1 << 14) + (128 << 15);
+        for (var v2 = 0; v2 < n; v2++) s2 += tmp[v2 * n + x2] * t[v2 * n + y];
+        out[oi + y * stride + x2] = clamp8(s2 >> 15);
+      }
     }
   }
-  // Column-wise 1D IDCT: for each col x, transform over v → y
-  for (var x2 = 0; x2 < 8; x2++) {
-    for (var y = 0; y < 8; y++) {
-      var s2 = 0.0;
-      for (var v2 = 0; v2 < 8; v2++) s2 += ICOS[v2 * 8 + y] * tmp[v2 * 8 + x2];
-      var val = Math.round(s2 * 0.5) + 128; // level-shift
-      out[y * 8 + x2] = val < 0 ? 0 : val > 255 ? 255 : val;
+
+  // Same contract as kernel.jpegIdct: blocksW×blocksH natural-order blocks
+  // at coef[(by*blocksW + bx)*64] → n×n samples at plane[off + by*n*stride
+  // + bx*n]; the coefficients are cleared for the next band.
+  function idctBandJS(coef: Int16Array, qt: Uint16Array, plane: Uint8Array, off: number,
+                    stride: number, blocksW: number, blocksH: number, n: number): void {
+    if (n === 8) for (var i = 0; i < 64; i++) _aanQ[i] = Math.min(qt[i], 0x7FFF) * AAN_SCALES[i];
+    var ci = 0;
+    for (var by = 0; by < blocksH; by++) {
+      var oi = off + by * n * stride;
+      for (var bx = 0; bx < blocksW; bx++, ci += 64, oi += n) {
+        if (n === 8) idct8(coef, ci, _aanQ, plane, oi, stride);
+        else if (n === 1) plane[oi] = clamp8(((coef[ci] * qt[0] + 4) >> 3) + 128);
+        else idctReduced(coef, ci, qt, plane, oi, stride, n);
+      }
     }
+    coef.fill(0, 0, blocksW * blocksH * 64);
   }
-}
 
-// ── Huffman table ─────────────────────────────────────────────────────────
-interface HuffTable {
-  // Lookup map: packed key (length<<16|code) → symbol (0-255)
-  map: Map<number, number>;
-  // minCode[len], maxCode[len], offset[len] for fast range check
-  minCode: Int32Array;  // 17 entries [1..16]
-  maxCode: Int32Array;
-  offset:  Int32Array;
-  vals:    Uint8Array;
-}
+  var idctBand: typeof idctBandJS = native ? _k.jpegIdct : idctBandJS;
+
+  // ── Huffman table ─────────────────────────────────────────────────────────
+  interface HuffTable {
+    // 9-bit lookahead: (length << 8 | symbol) for codes up to 9 bits, else 0
+    look:    Uint16Array;
+    // maxCode[len], valOff[len] = index in vals of code 0 of that length
+    maxCode: Int32Array;  // 17 entries [1..16], -1 when there are none
+    valOff:  Int32Array;
+    vals:    Uint8Array;
+  }
 
-function buildHuff(bits: Uint8Array, vals: Uint8Array): HuffTable {
-  var minCode = new Int32Array(17);
-  var maxCode = new Int32Array(17).fill(-1);
-  var offset  = new Int32Array(17);
-  var code = 0;
-  var vi   = 0;
-  var map  = new Map<number, number>();
-
-  for (var len = 1; len <= 16; len++) {
-    var count = bits[len - 1];
-    if (count > 0) {
-      minCode[len] = code;
-      for (var k = 0; k < count; k++) {
-        map.set((len << 16) | (code++), vals[vi++]);
+  const LOOK_BITS = 9;
+
+  function buildHuff(bits: Uint8Array, vals: Uint8Array): HuffTable {
+    var maxCode = new Int32Array(17).fill(-1);
+    var valOff  = new Int32Array(17);
+    var look    = new Uint16Array(1 << LOOK_BITS);
+    var code = 0;
+    var vi   = 0;
+
+    for (var len = 1; len <= 16; len++) {
+      var count = bits[len - 1];
+      valOff[len] = vi - code;
+      for (var k = 0; k < count; k++, code++, vi++) {
+        if (len <= LOOK_BITS) {
+          var shift = LOOK_BITS - len;
+          var first = code << shift;
+          for (var j = 0; j < (1 << shift); j++) look[first + j] = (len << 8) | vals[vi];
+        }
       }
-      maxCode[len] = code - 1;
-      offset[len]  = vi - count;
-    } else {
-      minCode[len] = 0x7FFFFFFF;
+      if (count > 0) maxCode[len] = code - 1;
+      code <<= 1;
     }
-    code <<= 1;
+
+    return { look, maxCode, valOff, vals };
   }
 
-  return { map, minCode, maxCode, offset, vals };
-}
+  // ── Bit reader (MSB-first, with FF00 byte stuffing) ───────────────────────
+  interface BitReader {
+    data: Uint8Array;
+    pos:  number;  // byte position
+    buf:  number;  // current bit buffer
+    blen: number;  // bits available in buf
+    end:  number;  // bytes of data received so far
+    last: boolean; // no more data will come
+  }
 
-// ── Bit reader (MSB-first, with FF00 byte stuffing) ───────────────────────
-interface BitReader {
-  data: Uint8Array;
-  pos:  number;  // byte position
-  buf:  number;  // current bit buffer
-  blen: number;  // bits available in buf
-}
+  // Thrown when a streaming decode runs out of input
+  var _NEED = -1;
 
-function makeBR(data: Uint8Array, start: number): BitReader {
-  return { data, pos: start, buf: 0, blen: 0 };
-}
+  function makeBR(data: Uint8Array, start: number): BitReader {
+    return { data, pos: start, buf: 0, blen: 0, end: data.length, last: true };
+  }
 
-function readBits(br: BitReader, n: number): number {
-  while (br.blen < n) {
-    if (br.pos >= br.data.length) { br.buf = (br.buf << 8) | 0xFF; br.blen += 8; continue; }
-    var b = br.data[br.pos++];
-    if (b === 0xFF) {
-      var next = br.data[br.pos];
-      if (next === 0x00) { br.pos++; }     // byte stuffing: FF00 → FF
-      else if (next >= 0xD0 && next <= 0xD7) { /* restart marker, skip */ }
-      else { /* unexpected marker — stop reading */ br.blen += n; return 0; }
+  // Top up the bit buffer to at least n (≤ 16) bits.  At a marker (RST or
+  // otherwise) zero bits are fed without consuming it; past the end of the
+  // data, one bits — or, while more data is still to come, throw _NEED.
+  function fill(br: BitReader, n: number): void {
+    while (br.blen < n) {
+      var b = 0xFF;
+      if (br.pos < br.end) {
+        b = br.data[br.pos];
+        if (b !== 0xFF) br.pos++;
+        else if (br.pos + 1 >= br.end && !br.last) throw _NEED;
+        else if (br.data[br.pos + 1] === 0x00) br.pos += 2;  // byte stuffing: FF00 → FF
+        else b = 0;
+      } else if (!br.last) {
+        throw _NEED;
+      }
+      br.buf  = (br.buf << 8) | b;
+      br.blen += 8;
     }
-    br.buf  = (br.buf << 8) | b;
-    br.blen += 8;
   }
-  br.blen -= n;
-  return (br.buf >>> br.blen) & ((1 << n) - 1);
-}
 
-function readHuff(br: BitReader, ht: HuffTable): number {
-  var code = 0;
-  for (var len = 1; len <= 16; len++) {
-    code = (code << 1) | readBits(br, 1);
-    if (code <= ht.maxCode[len] && code >= ht.minCode[len]) {
-      var sym = ht.map.get((len << 16) | code);
-      return sym !== undefined ? sym : -1;
+  function readBits(br: BitReader, n: number): number {
+    if (br.blen < n) fill(br, n);
+    br.blen -= n;
+    return (br.buf >>> br.blen) & ((1 << n) - 1);
+  }
+
+  function readHuff(br: BitReader, ht: HuffTable): number {
+    if (br.blen < 16) fill(br, 16);
+    var e = ht.look[(br.buf >>> (br.blen - LOOK_BITS)) & ((1 << LOOK_BITS) - 1)];
+    if (e !== 0) { br.blen -= e >> 8; return e & 0xFF; }
+    for (var len = LOOK_BITS + 1; len <= 16; len++) {
+      var code = (br.buf >>> (br.blen - len)) & ((1 << len) - 1);
+      if (code <= ht.maxCode[len]) {
+        br.blen -= len;
+        return ht.vals[ht.valOff[len] + code];
+      }
     }
+    return -1;
   }
-  return -1;
-}
 
-// Extend (sign-extend) a value with `nBits` bits
-function extend(v: number, nBits: number): number {
-  if (nBits === 0) return 0;
-  return v < (1 << (nBits - 1)) ? v - (1 << nBits) + 1 : v;
-}
+  // Drop buffered bits and step over the next RSTn marker
+  function restart(br: BitReader): void {
+    br.buf = 0; br.blen = 0;
+    var d = br.data;
+    while (br.pos + 1 < br.end && !(d[br.pos] === 0xFF && d[br.pos + 1] >= 0xD0 && d[br.pos + 1] <= 0xD7)) br.pos++;
+    if (br.pos + 1 >= br.end && !br.last) throw _NEED;
+    br.pos += 2;
+  }
 
-// Decode one 8×8 block of coefficients from the bit stream
-function decodeBlock(
-  br: BitReader,
-  htDC: HuffTable,
-  htAC: HuffTable,
-  prevDC: { val: number }
-): Int16Array {
-  var coeff = new Int16Array(64);
-
-  // DC coefficient
-  var dcCat = readHuff(br, htDC);
-  if (dcCat < 0) return coeff;
-  var dcDiff = dcCat > 0 ? extend(readBits(br, dcCat), dcCat) : 0;
-  prevDC.val += dcDiff;
-  coeff[0] = prevDC.val;
-
-  // AC coefficients (positions 1..63 in zigzag order)
-  var i = 1;
-  while (i < 64) {
-    var acSym = readHuff(br, htAC);
-    if (acSym < 0) break;
-    if (acSym === 0x00) break;         // EOB
-    if (acSym === 0xF0) { i += 16; continue; }  // ZRL: 16 zeros
-    var run  = (acSym >> 4) & 0xF;
-    var size = acSym & 0xF;
-    i += run;
-    if (i >= 64) break;
-    coeff[ZZ[i]] = extend(readBits(br, size), size);
-    i++;
+  // Extend (sign-extend) a value with `nBits` bits
+  function extend(v: number, nBits: number): number {
+    if (nBits === 0) return 0;
+    return v < (1 << (nBits - 1)) ? v - (1 << nBits) + 1 : v;
   }
-  return coeff;
-}
 
-// ── YCbCr → RGB ───────────────────────────────────────────────────────────
-function ycbcr2rgb(Y: number, Cb: number, Cr: number): number {
-  Cb -= 128; Cr -= 128;
-  var r = Y + 1.40200 * Cr;
-  var g = Y - 0.34414 * Cb - 0.71414 * Cr;
-  var b = Y + 1.77200 * Cb;
-  var ri = r < 0 ? 0 : r > 255 ? 255 : r | 0;
-  var gi = g < 0 ? 0 : g > 255 ? 255 : g | 0;
-  var bi = b < 0 ? 0 : b > 255 ? 255 : b | 0;
-  return 0xFF000000 | (ri << 16) | (gi << 8) | bi;
-}
+  // Decode one 8×8 block into coef[ci..ci+63] in natural order.  The band
+  // is all zeros on entry (idctBand clears it after each MCU row).
+  function decodeBlock(
+    br: BitReader,
+    htDC: HuffTable,
+    htAC: HuffTable,
+    prevDC: Int32Array,
+    pc: number,
+    coef: Int16Array,
+    ci: number
+  ): void {
+    // DC coefficient
+    var dcCat = readHuff(br, htDC);
+    if (dcCat < 0) return;
+    var dcDiff = dcCat > 0 ? extend(readBits(br, dcCat), dcCat) : 0;
+    prevDC[pc] += dcDiff;
+    coef[ci] = prevDC[pc];
+
+    // AC coefficients (positions 1..63 in zigzag order)
+    var i = 1;
+    while (i < 64) {
+      var acSym = readHuff(br, htAC);
+      if (acSym < 0) break;
+      if (acSym === 0x00) break;         // EOB
+      if (acSym === 0xF0) { i += 16; continue; }  // ZRL: 16 zeros
+      var run  = (acSym >> 4) & 0xF;
+      var size = acSym & 0xF;
+      i += run;
+      if (i >= 64) break;
+      coef[ci + ZZ[i]] = extend(readBits(br, size), size);
+      i++;
+    }
+  }
 
-// ── Public entry point ────────────────────────────────────────────────────
+  // ── YCbCr → RGB ───────────────────────────────────────────────────────────
+  // 14-bit fixed point, identical to kernel.jpegColor: 1.402, -0.34414,
+  // -0.71414 and 1.772, rounded.
+  function ycbcr2rgb(Y: number, Cb: number, Cr: number): number {
+    Cb -= 128; Cr -= 128;
+    var r = Y + ((22970 * Cr + 8192) >> 14);
+    var g = Y + ((-5638 * Cb - 11700 * Cr + 8192) >> 14);
+    var b = Y + ((29032 * Cb + 8192) >> 14);
+    var ri = r < 0 ? 0 : r > 255 ? 255 : r;
+    var gi = g < 0 ? 0 : g > 255 ? 255 : g;
+    var bi = b < 0 ? 0 : b > 255 ? 255 : b;
+    return (0xFF000000 | (ri << 16) | (gi << 8) | bi) >>> 0;
+  }
 
-export function decodeJPEG(bytes: Uint8Array): DecodedImage | null {
-  try { return _decodeJPEG(bytes); } catch (_e) { return null; }
-}
+  // Same contract as kernel.jpegColor: w×h pixels at out[off + row*w + x],
+  // chroma (x/hs, row/vs); greyscale without Cb/Cr.
+  function colorRowsJS(out: Uint32Array, off: number, w: number, h: number,
+                     Yp: Uint8Array, yStride: number, Cbp?: Uint8Array, Crp?: Uint8Array,
+                     cStride?: number, hs?: number, vs?: number): void {
+    for (var row = 0; row < h; row++, off += w) {
+      var yi = row * yStride;
+      if (!Cbp || !Crp) {
+        for (var x = 0; x < w; x++) out[off + x] = (0xFF000000 | (Yp[yi + x] * 0x010101)) >>> 0;
+        continue;
+      }
+      var ci = ((row / vs!) | 0) * cStride!;
+      if (hs === 2) {
+        for (var x2 = 0; x2 < w; x2++) out[off + x2] = ycbcr2rgb(Yp[yi + x2], Cbp[ci + (x2 >> 1)], Crp[ci + (x2 >> 1)]);
+      } else {
+        for (var x3 = 0; x3 < w; x3++) out[off + x3] = ycbcr2rgb(Yp[yi + x3], Cbp[ci + x3], Crp[ci + x3]);
+      }
+    }
+  }
+
+  var colorRows: typeof colorRowsJS = native ? _k.jpegColor : colorRowsJS;
+
+  // Frame size from the SOF header, without decoding
+  function probeJPEG(raw: Uint8Array): { w: number; h: number } | null {
+    if (raw[0] !== 0xFF || raw[1] !== 0xD8) return null;
+    var i = 2;
+    while (i + 8 < raw.length) {
+      if (raw[i] !== 0xFF) { i++; continue; }
+      var marker = raw[i + 1];
+      if (marker === 0xFF || marker === 0x00 || (marker >= 0xD0 && marker <= 0xD8)) { i++; continue; }
+      if (marker >= 0xC0 && marker <= 0xCF && marker !== 0xC4 && marker !== 0xC8 && marker !== 0xCC) {
+        return { w: (raw[i + 7] << 8) | raw[i + 8], h: (raw[i + 5] << 8) | raw[i + 6] };
+      }
+      i += 2 + ((raw[i + 2] << 8) | raw[i + 3]);
+    }
+    return null;
+  }
 
-function _decodeJPEG(raw: Uint8Array): DecodedImage | null {
-  if (raw[0] !== 0xFF || raw[1] !== 0xD8) return null;  // not JPEG
-
-  // Tables
-  var qtables: Uint16Array[] = [];          // up to 4 quantization tables (64 values each)
-  var htDC: (HuffTable | null)[] = [null, null, null, null];
-  var htAC: (HuffTable | null)[] = [null, null, null, null];
-
-  // Frame info
-  var imgW = 0, imgH = 0;
-  var numComp = 0;
-  // Per-component: id, H-sampling, V-sampling, qtable index
-  var compId   = new Uint8Array(4);
-  var compH    = new Uint8Array(4);  // horizontal sampling factor
-  var compV    = new Uint8Array(4);  // vertical sampling factor
-  var compQt   = new Uint8Array(4);  // quantization table selector
-  // Scan component mapping to DC/AC tables
-  var scanDC   = new Uint8Array(4);
-  var scanAC   = new Uint8Array(4);
-
-  var i = 2;  // skip SOI
-
-  function readU16(): number {
-    var v = (raw[i] << 8) | raw[i + 1]; i += 2; return v;
+  // Largest DCT scale (1, 2, 4 or 8) whose output still covers tw×th
+  function scaleFor(w: number, h: number, tw: number, th: number): number {
+    var s = 8;
+    while (s > 1 && (Math.ceil(w / s) < tw || Math.ceil(h / s) < th)) s >>= 1;
+    return s;
   }
 
-  // ── Marker scan ────────────────────────────────────────────────────────
-  outer: while (i < raw.length - 1) {
-    // Seek next FF xx marker
-    if (raw[i] !== 0xFF) { i++; continue; }
-    var marker = raw[i + 1]; i += 2;
-    if (marker === 0x00 || (marker >= 0xD0 && marker <= 0xD7)) continue; // stuffing / RST
-    if (marker === 0xD9) break; // EOI
-
-    // Segment length (includes the 2 length bytes)
-    var segStart = i;
-    var segLen   = (raw[i] << 8) | raw[i + 1];
-    var segEnd   = segStart + segLen;
-
-    if (marker === 0xC0) {
-      // SOF0 — baseline DCT frame header
-      i += 2; // skip length
-      var precision = raw[i++]; if (precision !== 8) return null;
-      imgH = readU16(); imgW = readU16();
-      numComp = raw[i++];
+  // ── Incremental decoder ───────────────────────────────────────────────────
+
+  /**
+   * Streaming JPEG decoder.  push() appends bytes; segments are
+   * parsed once complete and entropy-coded data is decoded an MCU row at a
+   * time.  When the input runs out mid-row the row is rolled back (bit
+   * reader, DC predictors, restart and EOB counters) and retried on the
+   * next push.
+   *
+   * A baseline interleaved scan goes straight from Huffman decode to pixels,
+   * one strip per MCU row.  Progressive frames (SOF2) and sequential frames
+   * split over several scans keep every coefficient and repaint the whole
+   * image after each scan, so a progressive picture sharpens as its scans
+   * arrive.  `pick(w, h)` chooses the DCT scale once the frame size is known.
+   */
+  function stream(pick: (w: number, h: number) => number,
+                  alloc?: (n: number) => Uint32Array): ImageStream {
+    var buf = new Uint8Array(0), len = 0, pos = 2;
+    var whole = false, last = false;
+
+    // Tables
+    var qtables: Uint16Array[] = [];          // up to 4 quantization tables (64 values each)
+    var htDC: (HuffTable | null)[] = [null, null, null, null];
+    var htAC: (HuffTable | null)[] = [null, null, null, null];
+
+    // Frame info
+    var imgW = 0, imgH = 0;
+    var numComp = 0;
+    var progressive = false;
+    // Per-component: id, H-sampling, V-sampling, qtable index
+    var compId   = new Uint8Array(4);
+    var compH    = new Uint8Array(4);  // horizontal sampling factor
+    var compV    = new Uint8Array(4);  // vertical sampling factor
+    var compQt   = new Uint8Array(4);  // quantization table selector
+    var restartInterval = 0;                  // MCUs between RSTn markers (DRI)
+
+    // Output geometry (see frame())
+    var n = 8, outW = 0, outH = 0, maxH = 1, maxV = 1, mcuCols = 0, mcuRows = 0, stripH = 0;
+    var planes: Uint8Array[] = [], planePitch: number[] = [];
+    var bands: Int16Array[] = [], bandW: number[] = [], compN: number[] = [];
+    var ratH: number[] = [], ratV: number[] = [];
+    var ycc = false, direct = false;
+    // Whole-image coefficients, natural order (progressive / multi-scan)
+    var coefs: Int16Array[] | null = null;
+
+    // Current scan
+    var scanning = false;
+    var scanComps: number[] = [];             // component indices in the scan
+    var scanDC = new Uint8Array(4), scanAC = new Uint8Array(4);
+    var ss = 0, se = 63, ah = 0, al = 0;
+    var br: BitReader = makeBR(buf, 0);
+    var prevDC = new Int32Array(4);
+    var mcuLeft = 0, eobrun = 0;
+    var unitRow = 0, unitRows = 0;            // MCU rows (or block rows) of the scan
+    var unitCol = 0, unitCols = 0;
+    var painted = 0;                          // scans repainted so far
+    var scansDone = 0;
+    // Coefficients a refinement scan made nonzero since the last checkpoint
+    var newNZ: number[] = [];
+
+    var s: ImageStream = { w: 0, h: 0, nw: 0, nh: 0, data: null, y0: 0, y1: 0,
+                           done: false, failed: false, push: push };
+
+    function mark(a: number, b: number): void {
+      if (s.y1 <= s.y0) { s.y0 = a; s.y1 = b; return; }
+      if (a < s.y0) s.y0 = a;
+      if (b > s.y1) s.y1 = b;
+    }
+
+    function frame(p: number): boolean {
+      var precision = buf[p]; if (precision !== 8) return false;
+      imgH = (buf[p + 1] << 8) | buf[p + 2];
+      imgW = (buf[p + 3] << 8) | buf[p + 4];
+      numComp = buf[p + 5];
+      if (numComp < 1 || numComp > 4) return false;
       for (var ci = 0; ci < numComp; ci++) {
-        compId[ci] = raw[i++];
-        var sf = raw[i++];
+        compId[ci] = buf[p + 6 + ci * 3];
+        var sf = buf[p + 7 + ci * 3];
         compH[ci] = (sf >> 4) & 0xF;
         compV[ci] = sf & 0xF;
-        compQt[ci] = raw[i++];
+        compQt[ci] = buf[p + 8 + ci * 3];
+        if (compH[ci] < 1 || compH[ci] > 4 || compV[ci] < 1 || compV[ci] > 4) return false;
+      }
+      if (imgW <= 0 || imgH <= 0) return false;
+      var scale = pick(imgW, imgH);
+      if (scale !== 1 && scale !== 2 && scale !== 4 && scale !== 8) scale = 1;
+      // Output is 1/scale of the frame: each 8×8 block yields an n×n block
+      n = 8 / scale;
+      outW = Math.ceil(imgW / scale); outH = Math.ceil(imgH / scale);
+      if (imgW > 16384 || imgH > 16384 || outW > 4096 || outH > 4096) return false;
+
+      // ── Determine max sampling factors ────────────────────────────────────
+      for (var c = 0; c < numComp; c++) {
+        if (compH[c] > maxH) maxH = compH[c];
+        if (compV[c] > maxV) maxV = compV[c];
+      }
+      // MCU size in pixels
+      mcuCols = Math.ceil(imgW / (maxH * 8));
+      mcuRows = Math.ceil(imgH / (maxV * 8));
+
+      // Per component, one MCU row at a time: a coefficient band of
+      // (mcuCols·H)×V blocks and the sample strip it inverse-transforms into.
+      // Subsampled chroma is reduced less than luma so it keeps output
+      // resolution where it can, instead of being averaged over the MCU.
+      for (var c2 = 0; c2 < numComp; c2++) {
+        var nc = n;
+        var up = Math.min(maxH / compH[c2], maxV / compV[c2]);
+        while (nc < 8 && up >= 2) { nc <<= 1; up /= 2; }
+        compN.push(nc);
+        var bw = mcuCols * compH[c2];
+        bandW.push(bw);
+        bands.push(new Int16Array(bw * compV[c2] * 64));
+        planePitch.push(bw * nc);
+        planes.push(new Uint8Array(bw * nc * compV[c2] * nc));
       }
-    } else if (marker === 0xC4) {
-      // DHT — define Huffman table
-      i += 2; // skip length
-      while (i < segEnd) {
-        var htInfo = raw[i++];
-        var htClass = (htInfo >> 4) & 0xF;  // 0=DC, 1=AC
-        var htId    = htInfo & 0xF;
-        var bits    = raw.slice(i, i + 16); i += 16;
-        var count   = 0; for (var k = 0; k < 16; k++) count += bits[k];
-        var vals    = raw.slice(i, i + count); i += count;
-        var ht      = buildHuff(bits, vals);
-        if (htClass === 0) htDC[htId] = ht; else htAC[htId] = ht;
+
+      // Sample → pixel mapping.  The kernels take luma at output resolution
+      // with Cb and Cr sharing one 1× or 2× upsampling; anything else goes
+      // through the general nearest-neighbour loop.
+      stripH = maxV * n;
+      for (var c4 = 0; c4 < numComp; c4++) {
+        ratH.push(maxH * n / (compH[c4] * compN[c4]));
+        ratV.push(maxV * n / (compV[c4] * compN[c4]));
+      }
+      ycc = numComp >= 3;
+      direct = ratH[0] === 1 && ratV[0] === 1 &&
+        (!ycc || (ratH[1] === ratH[2] && ratV[1] === ratV[2] && planePitch[1] === planePitch[2] &&
+                  (ratH[1] === 1 || ratH[1] === 2) && (ratV[1] === 1 || ratV[1] === 2)));
+
+      s.nw = imgW; s.nh = imgH;
+      s.w = outW; s.h = outH;
+      s.data = alloc ? alloc(outW * outH) : new Uint32Array(outW * outH);
+      return true;
+    }
+
+    // IDCT MCU row `mr` from the bands (dequantised in the transform,
+    // reduced to n×n when scaling; a missing table leaves the strip grey)
+    // and assemble its strip of the final image
+    function strip(mr: number): void {
+      for (var ci4 = 0; ci4 < numComp; ci4++) {
+        var qt2 = qtables[compQt[ci4]];
+        if (!qt2) { bands[ci4].fill(0); planes[ci4].fill(128); continue; }
+        idctBand(bands[ci4], qt2, planes[ci4], 0, planePitch[ci4], bandW[ci4], compV[ci4], compN[ci4]);
+      }
+      var out = s.data!;
+      var y0 = mr * stripH;
+      var rows = Math.min(stripH, outH - y0);
+      if (rows <= 0) return;
+      if (direct && !ycc) {
+        colorRows(out, y0 * outW, outW, rows, planes[0], planePitch[0]);
+      } else if (direct) {
+        colorRows(out, y0 * outW, outW, rows, planes[0], planePitch[0],
+                   planes[1], planes[2], planePitch[1], ratH[1], ratV[1]);
+      } else {
+        for (var ly = 0; ly < rows; ly++) {
+          var o = (y0 + ly) * outW;
+          var yRow  = Math.floor(ly / ratV[0]) * planePitch[0];
+          if (!ycc) {
+            for (var gx = 0; gx < outW; gx++) {
+              var g = planes[0][yRow + Math.floor(gx / ratH[0])];
+              out[o + gx] = (0xFF000000 | (g << 16) | (g << 8) | g) >>> 0;
+            }
+            continue;
+          }
+          var cbRow = Math.floor(ly / ratV[1]) * planePitch[1];
+          var crRow = Math.floor(ly / ratV[2]) * planePitch[2];
+          for (var px = 0; px < outW; px++) {
+            out[o + px] = ycbcr2rgb(planes[0][yRow + Math.floor(px / ratH[0])],
+                                    planes[1][cbRow + Math.floor(px / ratH[1])],
+                                    planes[2][crRow + Math.floor(px / ratH[2])]);
+          }
+        }
       }
-    } else if (marker === 0xDB) {
-      // DQT — define quantization table
-      i += 2; // skip length
-      while (i < segEnd) {
-        var qtInfo  = raw[i++];
-        var qtPrec  = (qtInfo >> 4) & 0xF;
-        var qtId    = qtInfo & 0xF;
-        var qt      = new Uint16Array(64);
-        for (var q = 0; q < 64; q++) {
-          qt[ZZ[q]] = qtPrec === 0 ? raw[i++] : ((raw[i++] << 8) | raw[i++]);
+      mark(y0, y0 + rows);
+    }
+
+    // Repaint every MCU row from the whole-image coefficients
+    function paintAll(): void {
+      for (var mr = 0; mr < mcuRows; mr++) {
+        for (var c = 0; c < numComp; c++) {
+          var sz = bands[c].length;
+          bands[c].set(coefs![c].subarray(mr * sz, mr * sz + sz));
         }
-        qtables[qtId] = qt;
+        strip(mr);
       }
-    } else if (marker === 0xDA) {
-      // SOS — start of scan
-      i += 2; // skip length
-      var scanComps = raw[i++];
-      for (var sc = 0; sc < scanComps; sc++) {
-        var scanCompId = raw[i++];
-        var tablesSel  = raw[i++];
+      painted = scansDone;
+    }
+
+    function scanStart(p: number, segEnd: number): boolean {
+      var count = buf[p];
+      scanComps = [];
+      for (var sc = 0; sc < count; sc++) {
+        var scanCompId = buf[p + 1 + sc * 2];
+        var tablesSel  = buf[p + 2 + sc * 2];
         // find component index
         var ci2 = 0;
         for (var j = 0; j < numComp; j++) { if (compId[j] === scanCompId) { ci2 = j; break; } }
         scanDC[ci2] = (tablesSel >> 4) & 0xF;
         scanAC[ci2] = tablesSel & 0xF;
+        scanComps.push(ci2);
+      }
+      var q = p + 1 + count * 2;
+      ss = buf[q]; se = buf[q + 1]; ah = buf[q + 2] >> 4; al = buf[q + 2] & 15;
+      if (!progressive) { ss = 0; se = 63; ah = al = 0; }
+      if (ss > se || se > 63) return false;
+      // Anything but a single interleaved sequential scan keeps coefficients
+      if (!coefs && (progressive || count < numComp || (count === 1 && compH[scanComps[0]] * compV[scanComps[0]] > 1))) {
+        if (imgW * imgH > 8 * 1024 * 1024) return false;
+        coefs = [];
+        for (var c = 0; c < numComp; c++) coefs.push(new Int16Array(bands[c].length * mcuRows));
+      }
+      // A non-interleaved scan covers only the component's own blocks
+      if (count === 1) {
+        var c1 = scanComps[0];
+        unitCols = Math.ceil(Math.ceil(imgW * compH[c1] / maxH) / 8);
+        unitRows = Math.ceil(Math.ceil(imgH * compV[c1] / maxV) / 8);
+      } else {
+        unitCols = mcuCols;
+        unitRows = mcuRows;
       }
-      i += 3; // Ss, Se, Ah/Al (baseline: 0, 63, 0)
-      // `i` now points to compressed scan data — break out to decode
-      break outer;
-    } else {
-      i = segEnd; // skip unknown segment
+      br = makeBR(buf, segEnd);
+      br.end = len; br.last = last;
+      prevDC.fill(0);
+      mcuLeft = restartInterval;
+      eobrun = 0;
+      unitRow = unitCol = 0;
+      scanning = true;
+      return true;
     }
 
-    if (i < segEnd) i = segEnd;
-  }
+    // ── Progressive block decoders (ITU T.81 G.1.2) ──────────────────────
+    function dcFirst(coef: Int16Array, bi: number, c: number): void {
+      var ht = htDC[scanDC[c]];
+      var t = ht ? readHuff(br, ht) : 0;
+      if (t < 0) t = 0;
+      prevDC[c] += t > 0 ? extend(readBits(br, t), t) : 0;
+      coef[bi] = prevDC[c] << al;
+    }
 
-  if (imgW <= 0 || imgH <= 0 || numComp === 0) return null;
-  if (imgW > 4096 || imgH > 4096) return null;
+    function dcRefine(coef: Int16Array, bi: number): void {
+      if (readBits(br, 1)) coef[bi] |= 1 << al;
+    }
 
-  // ── Determine max sampling factors ────────────────────────────────────
-  var maxH = 1, maxV = 1;
-  for (var c = 0; c < numComp; c++) {
-    if (compH[c] > maxH) maxH = compH[c];
-    if (compV[c] > maxV) maxV = compV[c];
-  }
+    function acFirst(coef: Int16Array, bi: number, c: number): void {
+      if (eobrun > 0) { eobrun--; return; }
+      var ht = htAC[scanAC[c]];
+      if (!ht) return;
+      for (var k = ss; k <= se; k++) {
+        var rs = readHuff(br, ht);
+        if (rs < 0) rs = 0;
+        var r = rs >> 4, sz = rs & 15;
+        if (sz) {
+          k += r;
+          if (k > 63) break;
+          coef[bi + ZZ[k]] = extend(readBits(br, sz), sz) * (1 << al);
+        } else if (r === 15) {
+          k += 15;
+        } else {
+          eobrun = (1 << r) - 1;
+          if (r) eobrun += readBits(br, r);
+          break;
+        }
+      }
+    }
 
-  // MCU size in pixels
-  var mcuW = maxH * 8;
-  var mcuH = maxV * 8;
-  var mcuCols = Math.ceil(imgW / mcuW);
-  var mcuRows = Math.ceil(imgH / mcuH);
-
-  // Allocate per-component sample planes
-  var planes: Uint8Array[] = [];
-  var planePitch: number[] = [];
-  var planeH: number[] = [];
-  for (var c2 = 0; c2 < numComp; c2++) {
-    var pw2 = mcuCols * compH[c2] * 8;
-    var ph2 = mcuRows * compV[c2] * 8;
-    planes.push(new Uint8Array(pw2 * ph2));
-    planePitch.push(pw2);
-    planeH.push(ph2);
-  }
+    function acRefine(coef: Int16Array, bi: number, c: number): void {
+      var p1 = 1 << al, m1 = -1 << al;
+      var k = ss, z = 0;
+      var ht = htAC[scanAC[c]];
+      if (!ht) return;
+      if (eobrun <= 0) {
+        for (; k <= se; k++) {
+          var rs = readHuff(br, ht);
+          if (rs < 0) rs = 0;
+          var r = rs >> 4, v = 0;
+          if (rs & 15) {
+            v = readBits(br, 1) ? p1 : m1;
+          } else if (r !== 15) {
+            eobrun = 1 << r;
+            if (r) eobrun += readBits(br, r);
+            break;
+          }
+          // Skip r zero coefficients, refining the nonzero ones passed
+          for (; k <= se; k++) {
+            z = bi + ZZ[k];
+            if (coef[z] !== 0) {
+              if (readBits(br, 1) && (coef[z] & p1) === 0) coef[z] += coef[z] >= 0 ? p1 : m1;
+            } else if (--r < 0) {
+              break;
+            }
+          }
+          if (v && k <= se) { z = bi + ZZ[k]; coef[z] = v; newNZ.push(c, z); }
+        }
+      }
+      if (eobrun > 0) {
+        for (; k <= se; k++) {
+          z = bi + ZZ[k];
+          if (coef[z] !== 0 && readBits(br, 1) && (coef[z] & p1) === 0) coef[z] += coef[z] >= 0 ? p1 : m1;
+        }
+        eobrun--;
+      }
+    }
 
-  // ── Decode scan ──────────────────────────────────────────────────────
-  var br  = makeBR(raw, i);
-  var prevDC: { val: number }[] = [];
-  for (var c3 = 0; c3 < numComp; c3++) prevDC.push({ val: 0 });
-
-  var blockBuf = new Uint8Array(64);
-  var deqCoeff = new Int16Array(64);
-
-  for (var mr = 0; mr < mcuRows; mr++) {
-    for (var mc = 0; mc < mcuCols; mc++) {
-      // Decode each component's blocks in this MCU
-      for (var ci3 = 0; ci3 < numComp; ci3++) {
-        var hf = compH[ci3];
-        var vf = compV[ci3];
-        var qt2 = qtables[compQt[ci3]];
-        var dc  = htDC[scanDC[ci3]];
-        var ac  = htAC[scanAC[ci3]];
-        if (!dc || !ac || !qt2) continue;
-
-        for (var bv = 0; bv < vf; bv++) {
-          for (var bh = 0; bh < hf; bh++) {
-            // Decode block into zigzag coefficients
-            var rawCoeff = decodeBlock(br, dc, ac, prevDC[ci3]);
-            // Dequantize
-            for (var qi = 0; qi < 64; qi++) deqCoeff[qi] = rawCoeff[qi] * qt2[qi];
-            // IDCT
-            idct2d(deqCoeff, blockBuf);
-            // Place into plane
-            var plane  = planes[ci3];
-            var pitch  = planePitch[ci3];
-            var px0    = (mc * hf + bh) * 8;
-            var py0    = (mr * vf + bv) * 8;
-            for (var by = 0; by < 8; by++) {
-              var dst  = (py0 + by) * pitch + px0;
-              var src2 = by * 8;
-              for (var bx = 0; bx < 8; bx++) {
-                plane[dst + bx] = blockBuf[src2 + bx];
+    // One block of the current scan at coefs[c][bi] (or the band in the
+    // streaming baseline case)
+    function unit(c: number, coef: Int16Array, bi: number): void {
+      if (!progressive) {
+        var dc = htDC[scanDC[c]], ac = htAC[scanAC[c]];
+        if (dc && ac) decodeBlock(br, dc, ac, prevDC, c, coef, bi);
+      } else if (ss === 0) {
+        if (ah === 0) dcFirst(coef, bi, c); else dcRefine(coef, bi);
+      } else {
+        if (ah === 0) acFirst(coef, bi, c); else acRefine(coef, bi, c);
+      }
+    }
+
+    // Decode scan rows until the scan ends or the input runs out
+    function scanRows(): boolean {
+      var single = scanComps.length === 1;
+      var cpPos = 0, cpBuf = 0, cpLen = 0, cpLeft = 0, cpEob = 0;
+      var cpDC0 = 0, cpDC1 = 0, cpDC2 = 0, cpDC3 = 0;
+      try {
+        while (unitRow < unitRows) {
+          for (; unitCol < unitCols; unitCol++) {
+            // Checkpoint: a unit cut short by the end of input is redone
+            cpPos = br.pos; cpBuf = br.buf; cpLen = br.blen;
+            cpDC0 = prevDC[0]; cpDC1 = prevDC[1]; cpDC2 = prevDC[2]; cpDC3 = prevDC[3];
+            cpLeft = mcuLeft; cpEob = eobrun;
+            newNZ.length = 0;
+            if (restartInterval) {
+              if (mcuLeft === 0) {
+                restart(br);
+                prevDC.fill(0);
+                eobrun = 0;
+                mcuLeft = restartInterval;
+              }
+              mcuLeft--;
+            }
+            var u = unitCol;
+            if (single) {
+              var c1 = scanComps[0];
+              var bi1 = (unitRow * bandW[c1] + u) * 64;
+              if (coefs) unit(c1, coefs[c1], bi1);
+              else unit(c1, bands[c1], bi1 - unitRow * bands[c1].length);
+              continue;
+            }
+            // Decode each component's blocks in this MCU
+            for (var sc = 0; sc < scanComps.length; sc++) {
+              var c = scanComps[sc];
+              var hf = compH[c], vf = compV[c];
+              var coef = coefs ? coefs[c] : bands[c];
+              var base = coefs ? unitRow * bands[c].length : 0;
+              for (var bv = 0; bv < vf; bv++) {
+                var bi = base + (bv * bandW[c] + u * hf) * 64;
+                for (var bh = 0; bh < hf; bh++, bi += 64) unit(c, coef, bi);
               }
             }
           }
+          if (!coefs) strip(unitRow);
+          unitRow++;
+          unitCol = 0;
         }
+      } catch (e) {
+        if (e !== _NEED) throw e;
+        // Redoing the unit rewrites the same coefficients, except that a
+        // refinement scan must not see the ones it has just made nonzero
+        br.pos = cpPos; br.buf = cpBuf; br.blen = cpLen;
+        prevDC[0] = cpDC0; prevDC[1] = cpDC1; prevDC[2] = cpDC2; prevDC[3] = cpDC3;
+        mcuLeft = cpLeft; eobrun = cpEob;
+        for (var zi = 0; zi < newNZ.length; zi += 2) coefs![newNZ[zi]][newNZ[zi + 1]] = 0;
+        return false;
       }
+      return true;
     }
-  }
 
-  // ── Assemble final image ─────────────────────────────────────────────
-  var out = new Uint32Array(imgW * imgH);
-
-  if (numComp === 1) {
-    // Greyscale
-    var gPlane = planes[0];
-    var gPitch = planePitch[0];
-    for (var py3 = 0; py3 < imgH; py3++) {
-      for (var px3 = 0; px3 < imgW; px3++) {
-        var g = gPlane[py3 * gPitch + px3];
-        out[py3 * imgW + px3] = 0xFF000000 | (g << 16) | (g << 8) | g;
+    // ── Marker scan ────────────────────────────────────────────────────────
+    // Returns false when it has to wait for more input
+    function segments(): boolean {
+      while (pos < len - 1) {
+        // Seek next FF xx marker
+        if (buf[pos] !== 0xFF) { pos++; continue; }
+        var marker = buf[pos + 1];
+        if (marker === 0xFF) { pos++; continue; }
+        if (marker === 0x00 || (marker >= 0xD0 && marker <= 0xD7)) { pos += 2; continue; } // stuffing / RST
+        if (marker === 0xD9) { finish(); return true; } // EOI
+
+        // Segment length (includes the 2 length bytes)
+        if (pos + 4 > len) break;
+        var segLen = (buf[pos + 2] << 8) | buf[pos + 3];
+        var p = pos + 4, segEnd = pos + 2 + segLen;
+        if (segEnd > len && !last) break;
+
+        if (marker === 0xC0 || marker === 0xC1 || marker === 0xC2) {
+          // SOF0/1 — sequential Huffman frame, SOF2 — progressive
+          if (s.data) { fail(); return true; }
+          progressive = marker === 0xC2;
+          if (!frame(p)) { fail(); return true; }
+        } else if ((marker >= 0xC3 && marker <= 0xCF) && marker !== 0xC4 && marker !== 0xC8 && marker !== 0xCC) {
+          fail(); return true;   // lossless, hierarchical or arithmetic-coded
+        } else if (marker === 0xC4) {
+          // DHT — define Huffman table
+          while (p < segEnd) {
+            var htInfo = buf[p++];
+            var htClass = (htInfo >> 4) & 0xF;  // 0=DC, 1=AC
+            var htId    = htInfo & 0xF;
+            var bits    = buf.slice(p, p + 16); p += 16;
+            var count   = 0; for (var k = 0; k < 16; k++) count += bits[k];
+            var vals    = buf.slice(p, p + count); p += count;
+            var ht      = buildHuff(bits, vals);
+            if (htClass === 0) htDC[htId] = ht; else htAC[htId] = ht;
+          }
+        } else if (marker === 0xDB) {
+          // DQT — define quantization table
+          while (p < segEnd) {
+            var qtInfo  = buf[p++];
+            var qtPrec  = (qtInfo >> 4) & 0xF;
+            var qtId    = qtInfo & 0xF;
+            var qt      = new Uint16Array(64);
+            for (var q = 0; q < 64; q++) {
+              qt[ZZ[q]] = qtPrec === 0 ? buf[p++] : ((buf[p++] << 8) | buf[p++]);
+            }
+            qtables[qtId] = qt;
+          }
+        } else if (marker === 0xDD) {
+          // DRI — define restart interval
+          restartInterval = (buf[p] << 8) | buf[p + 1];
+        } else if (marker === 0xDA) {
+          // SOS — start of scan; `segEnd` is where the entropy-coded data begins
+          if (!s.data || !scanStart(p, segEnd)) { fail(); return true; }
+          pos = segEnd;
+          return true;
+        }
+        pos = segEnd;   // skip unknown segment
       }
+      if (last) finish();
+      return false;
+    }
+
+    // Step over what is left of the scan to the next marker
+    function scanEnd(): boolean {
+      var d = buf, i = br.pos;
+      while (i + 1 < len && !(d[i] === 0xFF && d[i + 1] !== 0 && (d[i + 1] < 0xD0 || d[i + 1] > 0xD7))) i++;
+      if (i + 1 >= len && !last) return false;
+      pos = i;
+      return true;
+    }
+
+    // An image that got at least one scan keeps what it has
+    function fail(): void { s.failed = scansDone === 0; s.done = true; }
+
+    function finish(): void {
+      if (coefs && painted !== scansDone) paintAll();
+      s.done = true;
     }
-  } else {
-    // YCbCr (3 or 4 components — use first 3)
-    var yPlane  = planes[0]; var yPitch  = planePitch[0];
-    var cbPlane = planes[1]; var cbPitch = planePitch[1];
-    var crPlane = planes[2]; var crPitch = planePitch[2];
-
-    // Upsample ratios for Cb/Cr relative to Y
-    var cbScaleH = maxH / compH[1];
-    var cbScaleV = maxV / compV[1];
-    var crScaleH = maxH / compH[2];
-    var crScaleV = maxV / compV[2];
-
-    for (var py4 = 0; py4 < imgH; py4++) {
-      for (var px4 = 0; px4 < imgW; px4++) {
-        var Y   = yPlane [py4 * yPitch  + px4];
-        var Cb  = cbPlane[Math.floor(py4 / cbScaleV) * cbPitch + Math.floor(px4 / cbScaleH)];
-        var Cr  = crPlane[Math.floor(py4 / crScaleV) * crPitch + Math.floor(px4 / crScaleH)];
-        out[py4 * imgW + px4] = ycbcr2rgb(Y, Cb, Cr);
+
+    function push(bytes: Uint8Array, fin: boolean): void {
+      if (s.done) return;
+      if (len === 0 && fin) { buf = bytes; len = bytes.length; whole = true; }
+      else if (bytes.length) {
+        if (len + bytes.length > buf.length) {
+          var b2 = new Uint8Array(Math.max(buf.length * 2, len + bytes.length, 4096));
+          b2.set(buf.subarray(0, len));
+          buf = b2;
+        }
+        buf.set(bytes, len);
+        len += bytes.length;
+      }
+      last = fin;
+      if (len < 2) { if (last) s.failed = s.done = true; return; }
+      if (buf[0] !== 0xFF || buf[1] !== 0xD8) { s.failed = s.done = true; return; }  // not JPEG
+
+      while (!s.done) {
+        if (!scanning) {
+          if (!segments()) return;
+          continue;
+        }
+        br.data = buf; br.end = len; br.last = last;
+        if (unitRow < unitRows && !scanRows()) return;
+        if (!scanEnd()) return;
+        scanning = false;
+        scansDone++;
+        // Show each completed scan of a progressive image as it arrives
+        if (coefs && !whole) paintAll();
       }
     }
+
+    return s;
+  }
+
+  function _decodeJPEG(raw: Uint8Array, scale: number, alloc?: (n: number) => Uint32Array): DecodedImage | null {
+    var s = stream(function() { return scale; }, alloc);
+    s.push(raw, true);
+    return s.data && !s.failed ? { w: s.w, h: s.h, data: s.data } : null;
   }
 
-  return { w: imgW, h: imgH, data: out };
+  return {
+    decode: function(raw: Uint8Array, scale?: number, alloc?: (n: number) => Uint32Array): DecodedImage | null {
+      try { return _decodeJPEG(raw, scale || 1, alloc); } catch (_e) { return null; }
+    },
+    stream: function(pick: (w: number, h: number) => number, alloc?: (n: number) => Uint32Array): ImageStream {
+      return stream(pick, alloc);
+    },
+    probe: probeJPEG,
+    scaleFor: scaleFor,
+    native: native,
+  };
+}
+
+var _jpeg = jpegCodec();
+
+// ── Public entry point ────────────────────────────────────────────────────
+
+export function decodeJPEG(bytes: Uint8Array): DecodedImage | null {
+  return _jpeg.decode(bytes, 1);
+}
+
+/**
+ * Decode at 1/scale of the frame size (scale 1, 2, 4 or 8) in the DCT
+ * domain: only the low-frequency coefficients are inverse-transformed, so
+ * a 1/8 decode costs one multiply per block instead of a full IDCT.
+ */
+export function decodeJPEGScaled(bytes: Uint8Array, scale: number): DecodedImage | null {
+  return _jpeg.decode(bytes, scale);
 }
@@ -2,461 +2,586 @@
  * img-png.ts — Pure TypeScript PNG decoder
  *
  * Supports:
- *  - DEFLATE inflate (non-compressed, fixed Huffman, dynamic Huffman blocks)
+ *  - DEFLATE inflate (stored, fixed and dynamic Huffman blocks) into a
+ *    growable Uint8Array with flat lookup tables
  *  - zlib header stripping
- *  - PNG filter reconstruction (None, Sub, Up, Average, Paeth)
+ *  - PNG filter reconstruction (None, Sub, Up, Average, Paeth), done by
+ *    kernel.pngUnfilter (SSE2) when present, else an identical JS loop
  *  - Color types: Greyscale(0), RGB(2), Palette(3), Greyscale+Alpha(4), RGBA(6)
- *  - Bit depth: 1, 2, 4, 8 (16-bit downsampled to 8-bit)
+ *  - Bit depth: 1, 2, 4, 8 packed per the spec (16-bit downsampled to 8-bit)
+ *  - Adam7 interlacing
  *  - Output: DecodedImage { w, h, data: Uint32Array (0xAARRGGBB) }
  *
  * Limitations (acceptable for JSOS Browser):
- *  - Interlaced (Adam7) PNGs: displays as corrupted (rare in practice)
  *  - Max image size: limited by QuickJS heap (set to ~2048×2048 in index.ts)
  *  - No tRNS chunk yet (palette transparency)
  */
 
-import type { DecodedImage } from './types.js';
+import type { DecodedImage, ImageStream } from './types.js';
 
-// ── LIT/LENGTH and DISTANCE tables ───────────────────────────────────────────
+declare var kernel: import('../../core/kernel.js').KernelAPI;
 
-// RFC 1951 — length codes 257-285
-var _LEN_BASE  = [3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258];
-var _LEN_EXTRA = [0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0];
-// Distance codes 0-29
-var _DIST_BASE  = [1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577];
-var _DIST_EXTRA = [0,0,0,0,1,1,2,2,3,3,  4, 4, 5, 5,  6,  6,  7,  7,  8,  8,   9,   9,  10,  10,  11,  11,  12,   12,   13,   13];
-// Code-length alphabet order
-var _CL_ORDER = [16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15];
+// ── Codec ─────────────────────────────────────────────────────────────────────
+// Everything below is one self-contained closure so the image decode pool can
+// ship pngCodec.toString() to a child runtime.
 
-// ── Bit reader ────────────────────────────────────────────────────────────────
+export function pngCodec(jsOnly?: boolean) {
+  // Kernel unfilter when this runtime has it; jsOnly forces the
+  // JS loop (bench.imgdecode compares the two).
+  var _k: any = !jsOnly && typeof kernel !== 'undefined' ? kernel : null;
+  var native = !!_k && typeof _k.pngUnfilter === 'function';
 
-function makeBR(buf: Uint8Array, start: number): { rb: () => number; rbs: (n: number) => number; align: () => void; r8: () => number; r16le: () => number; pos: () => number } {
-  var _pos = start;
-  var _bit = 0;
+  // ── LIT/LENGTH and DISTANCE tables ───────────────────────────────────────────
 
-  function rb(): number {
-    if (_pos >= buf.length) return 0;
-    var b = (buf[_pos]! >> _bit) & 1;
-    _bit++;
-    if (_bit === 8) { _bit = 0; _pos++; }
-    return b;
-  }
-  function rbs(n: number): number {
-    var r = 0;
-    for (var i = 0; i < n; i++) r |= rb() << i;
-    return r;
-  }
-  function align(): void { if (_bit > 0) { _bit = 0; _pos++; } }
-  function r8(): number { align(); return buf[_pos++] ?? 0; }
-  function r16le(): number { var v = (buf[_pos] ?? 0) | ((buf[_pos + 1] ?? 0) << 8); _pos += 2; return v; }
-  function pos(): number { return _pos; }
-
-  return { rb, rbs, align, r8, r16le, pos };
-}
-
-// ── Huffman table builder ─────────────────────────────────────────────────────
-
-type HuffDecoder = (rb: () => number) => number;
+  // RFC 1951 — length codes 257-285
+  var _LEN_BASE  = [3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258];
+  var _LEN_EXTRA = [0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0];
+  // Distance codes 0-29
+  var _DIST_BASE  = [1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577];
+  var _DIST_EXTRA = [0,0,0,0,1,1,2,2,3,3,  4, 4, 5, 5,  6,  6,  7,  7,  8,  8,   9,   9,  10,  10,  11,  11,  12,   12,   13,   13];
+  // Code-length alphabet order
+  var _CL_ORDER = [16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15];
 
-function buildHuff(lengths: number[]): HuffDecoder {
-  var maxLen = 0;
-  for (var i = 0; i < lengths.length; i++) if ((lengths[i] ?? 0) > maxLen) maxLen = lengths[i]!;
-  if (maxLen === 0) return function(_rb) { return -1; };
+  // ── Huffman table builder ─────────────────────────────────────────────────────
 
-  // Count codes per length
-  var blCount = new Int32Array(maxLen + 2);
-  for (var i2 = 0; i2 < lengths.length; i2++) { var l = lengths[i2] ?? 0; if (l > 0) blCount[l]++; }
+  /** Flat decode table indexed by the next `bits` input bits (LSB-first):
+   *  entry = symbol << 4 | code length, 0 for an invalid code. */
+  interface Huff { table: Int32Array; mask: number; }
 
-  // First code for each bit length
-  var nextCode = new Int32Array(maxLen + 2);
-  var code = 0;
-  for (var bits = 1; bits <= maxLen; bits++) {
-    code = (code + blCount[bits - 1]!) << 1;
-    nextCode[bits] = code;
+  function buildHuff(lens: Uint8Array, off: number, n: number): Huff {
+    var max = 0;
+    var count = new Int32Array(16);
+    for (var i = 0; i < n; i++) {
+      var l = lens[off + i];
+      count[l]++;
+      if (l > max) max = l;
+    }
+    var size = 1 << max;
+    var table = new Int32Array(size);
+    var next = new Int32Array(16);
+    var code = 0;
+    count[0] = 0;
+    for (var b = 1; b <= max; b++) {
+      code = (code + count[b - 1]) << 1;
+      next[b] = code;
+    }
+    for (var sym = 0; sym < n; sym++) {
+      var len = lens[off + sym];
+      if (!len) continue;
+      var c = next[len]++;
+      var rev = 0;
+      for (var k = 0; k < len; k++) { rev = (rev << 1) | (c & 1); c >>= 1; }
+      for (var j = rev; j < size; j += 1 << len) table[j] = (sym << 4) | len;
+    }
+    return { table: table, mask: size - 1 };
   }
 
-  // Build lookup: (len << 20 | code) -> symbol
-  // We use a flat Uint32Array keyed by a hash for speed
-  var table = new Map<number, number>();
-  for (var sym = 0; sym < lengths.length; sym++) {
-    var ll = lengths[sym] ?? 0;
-    if (ll === 0) continue;
-    var kk = (ll << 20) | nextCode[ll]!;
-    table.set(kk, sym);
-    nextCode[ll]!++;
+  var _fixedLit:  Huff | null = null;
+  var _fixedDist: Huff | null = null;
+
+  // ── DEFLATE inflate ───────────────────────────────────────────────────────────
+
+  /** Inflate state, complete at every symbol boundary so a stream can stop
+   *  when its input runs dry and resume when more arrives. */
+  interface Inflater {
+    out:   Uint8Array;
+    op:    number;
+    pos:   number;           // next input byte
+    bb:    number;           // LSB-first bit buffer
+    cnt:   number;
+    mode:  number;           // 0 block header, 1 stored, 2 Huffman, 3 finished
+    left:  number;           // stored bytes still to copy
+    last:  number;           // BFINAL of the current block
+    lit:   Huff | null;
+    dist:  Huff | null;
   }
 
-  return function(rb3: () => number): number {
-    var c3 = 0;
-    for (var b3 = 1; b3 <= maxLen; b3++) {
-      c3 = (c3 << 1) | rb3();
-      var sym3 = table.get((b3 << 20) | c3);
-      if (sym3 !== undefined) return sym3;
-    }
-    return -1;
-  };
-}
+  var _NEED = -1;            // thrown when a symbol straddles the end of the input
 
-// ── DEFLATE inflate ───────────────────────────────────────────────────────────
+  /** Output goes to one buffer of `size` bytes, grown by doubling when
+   *  the stream turns out longer.  Input starts past the zlib header. */
+  function inflater(size: number): Inflater {
+    return { out: new Uint8Array(Math.max(1, size)), op: 0, pos: 2, bb: 0, cnt: 0,
+             mode: 0, left: 0, last: 0, lit: null, dist: null };
+  }
 
-/**
- * Decompress a zlib-wrapped DEFLATE stream (as used by PNG IDAT chunks).
- * Input: concatenated IDAT byte array starting with the 2-byte zlib header.
- * Output: raw decompressed bytes as Uint8Array.
- */
-export function inflate(data: Uint8Array): Uint8Array {
-  // zlib header: CMF + FLG (2 bytes)
-  var br = makeBR(data, 2);
-  var out: number[] = [];
-
-  // Fixed Huffman literal table (lengths from RFC 1951 §3.2.6)
-  var fixLitLengths = new Array<number>(288);
-  for (var i = 0;   i < 144; i++) fixLitLengths[i] = 8;
-  for (var i2 = 144; i2 < 256; i2++) fixLitLengths[i2] = 9;
-  for (var i3 = 256; i3 < 280; i3++) fixLitLengths[i3] = 7;
-  for (var i4 = 280; i4 < 288; i4++) fixLitLengths[i4] = 8;
-  var fixDistLengths = new Array<number>(32).fill(5);
-
-  var fixLitTable:  HuffDecoder | null = null;
-  var fixDistTable: HuffDecoder | null = null;
-
-  function decodeBlock(litDec: HuffDecoder, distDec: HuffDecoder): void {
-    while (true) {
-      var sym = litDec(br.rb);
-      if (sym < 0) break;
-      if (sym < 256) {
-        out.push(sym);
-      } else if (sym === 256) {
-        break; // end of block
-      } else {
-        // Length symbol 257-285
-        var li   = sym - 257;
-        var len  = (_LEN_BASE[li]  ?? 3) + br.rbs(_LEN_EXTRA[li]  ?? 0);
-        var dsym = distDec(br.rb);
-        var dist = (_DIST_BASE[dsym] ?? 1) + br.rbs(_DIST_EXTRA[dsym] ?? 0);
-        var start = out.length - dist;
-        for (var ci = 0; ci < len; ci++) {
-          out.push(out[start + (ci % dist)] ?? 0);
+  /**
+   * Decode data[st.pos, end) into st.out.  With `final` false, running out
+   * of input rolls back to the last symbol (or block header) boundary and
+   * returns false; call again once more bytes are in `data`.  Returns true
+   * when the stream has ended: final block done, or truncated/corrupt input
+   * when `final` is set, keeping whatever decoded.
+   */
+  function inflateRun(st: Inflater, data: Uint8Array, end: number, final: boolean): boolean {
+    if (st.mode === 3) return true;
+    var out = st.out, op = st.op;
+    var pos = st.pos, bb = st.bb, cnt = st.cnt;
+    var cpPos = pos, cpBb = bb, cpCnt = cnt;   // last resumable point
+
+    function grow(n: number): void {
+      if (op + n <= out.length) return;
+      var o2 = new Uint8Array(Math.max(out.length * 2, op + n));
+      o2.set(out.subarray(0, op));
+      out = o2;
+    }
+    // Make at least n (≤ 16) bits available; past the end of the final
+    // input up to 4 zero bytes pad the last symbol, then false
+    function need(n: number): boolean {
+      while (cnt < n) {
+        if (pos >= end) {
+          if (!final) throw _NEED;
+          if (pos >= end + 4) return false;
         }
+        bb |= (pos < end ? data[pos] : 0) << cnt;
+        pos++;
+        cnt += 8;
       }
+      return true;
+    }
+    function bits(n: number): number {
+      if (n === 0) return 0;
+      if (!need(n)) throw 0;
+      var v = bb & ((1 << n) - 1);
+      bb >>>= n; cnt -= n;
+      return v;
+    }
+    function sym(h: Huff): number {
+      need(15);
+      var e = h.table[bb & h.mask];
+      var len = e & 15;
+      if (!len || len > cnt) throw 0;
+      bb >>>= len; cnt -= len;
+      return e >> 4;
     }
-  }
 
-  var bfinal = 0;
-  while (!bfinal) {
-    bfinal = br.rb();
-    var btype = br.rbs(2);
-
-    if (btype === 0) {
-      // Non-compressed
-      br.align();
-      var len2  = br.r16le();
-      /* nlen = */ br.r16le();
-      for (var j = 0; j < len2; j++) out.push(br.r8());
-    } else if (btype === 1) {
-      // Fixed Huffman
-      if (!fixLitTable)  fixLitTable  = buildHuff(fixLitLengths);
-      if (!fixDistTable) fixDistTable = buildHuff(fixDistLengths);
-      decodeBlock(fixLitTable, fixDistTable);
-    } else if (btype === 2) {
-      // Dynamic Huffman
-      var hlit  = br.rbs(5) + 257;
-      var hdist = br.rbs(5) + 1;
-      var hclen = br.rbs(4) + 4;
-
-      var clLens = new Array<number>(19).fill(0);
-      for (var ki = 0; ki < hclen; ki++) clLens[_CL_ORDER[ki]!] = br.rbs(3);
-      var clDec = buildHuff(clLens);
-
-      var lengths: number[] = [];
-      while (lengths.length < hlit + hdist) {
-        var cs = clDec(br.rb);
-        if (cs < 16) {
-          lengths.push(cs);
-        } else if (cs === 16) {
-          var cnt16 = br.rbs(2) + 3;
-          var prev  = lengths[lengths.length - 1] ?? 0;
-          for (var r = 0; r < cnt16; r++) lengths.push(prev);
-        } else if (cs === 17) {
-          var cnt17 = br.rbs(3) + 3;
-          for (var r2 = 0; r2 < cnt17; r2++) lengths.push(0);
-        } else if (cs === 18) {
-          var cnt18 = br.rbs(7) + 11;
-          for (var r3 = 0; r3 < cnt18; r3++) lengths.push(0);
+    try {
+      for (;;) {
+        if (st.mode === 0) {
+          cpPos = pos; cpBb = bb; cpCnt = cnt;
+          var bfinal = bits(1);
+          var btype = bits(2);
+          if (btype === 0) {
+            // Non-compressed: realign to the byte holding the next unread bit
+            bb >>>= cnt & 7; cnt -= cnt & 7;
+            var len2 = bits(16);
+            /* nlen = */ bits(16);
+            pos -= cnt >> 3; bb = 0; cnt = 0;
+            st.left = len2;
+            st.mode = 1;
+          } else if (btype === 1) {
+            if (!_fixedLit) {
+              var fl = new Uint8Array(288);
+              for (var fi = 0; fi < 288; fi++) fl[fi] = fi < 144 ? 8 : fi < 256 ? 9 : fi < 280 ? 7 : 8;
+              _fixedLit  = buildHuff(fl, 0, 288);
+              _fixedDist = buildHuff(new Uint8Array(30).fill(5), 0, 30);
+            }
+            st.lit = _fixedLit; st.dist = _fixedDist;
+            st.mode = 2;
+          } else if (btype === 2) {
+            var hlit  = bits(5) + 257;
+            var hdist = bits(5) + 1;
+            var hclen = bits(4) + 4;
+            var cl = new Uint8Array(19);
+            for (var ki = 0; ki < hclen; ki++) cl[_CL_ORDER[ki]] = bits(3);
+            var clh = buildHuff(cl, 0, 19);
+            var lens = new Uint8Array(320);
+            var j = 0;
+            while (j < hlit + hdist) {
+              var cs = sym(clh);
+              if (cs < 16) { lens[j++] = cs; continue; }
+              var rep = 0, val = 0;
+              if (cs === 16) { val = j > 0 ? lens[j - 1] : 0; rep = 3 + bits(2); }
+              else if (cs === 17) rep = 3 + bits(3);
+              else rep = 11 + bits(7);
+              if (j + rep > hlit + hdist) throw 0;
+              while (rep-- > 0) lens[j++] = val;
+            }
+            st.lit  = buildHuff(lens, 0, hlit);
+            st.dist = buildHuff(lens, hlit, hdist);
+            st.mode = 2;
+          } else {
+            throw 0;  // reserved block type
+          }
+          st.last = bfinal;
         }
-      }
 
-      decodeBlock(
-        buildHuff(lengths.slice(0, hlit)),
-        buildHuff(lengths.slice(hlit, hlit + hdist)),
-      );
+        if (st.mode === 1) {
+          var take = Math.min(st.left, end - pos);
+          grow(take);
+          out.set(data.subarray(pos, pos + take), op);
+          op += take; pos += take; st.left -= take;
+          cpPos = pos; cpBb = 0; cpCnt = 0;
+          if (st.left > 0) {
+            if (final) throw 0;
+            break;
+          }
+        } else {
+          var lit = st.lit!, dist = st.dist!;
+          for (;;) {
+            cpPos = pos; cpBb = bb; cpCnt = cnt;
+            var s = sym(lit);
+            if (s < 256) {
+              if (op >= out.length) grow(1);
+              out[op++] = s;
+            } else if (s === 256) {
+              break;
+            } else {
+              s -= 257;
+              if (s >= 29) throw 0;
+              var n = _LEN_BASE[s] + bits(_LEN_EXTRA[s]);
+              var ds = sym(dist);
+              if (ds >= 30) throw 0;
+              var d = _DIST_BASE[ds] + bits(_DIST_EXTRA[ds]);
+              if (d > op) throw 0;
+              grow(n);
+              var from = op - d;
+              if (d >= n) out.copyWithin(op, from, from + n);
+              else for (var ci = 0; ci < n; ci++) out[op + ci] = out[from + ci];
+              op += n;
+            }
+          }
+        }
+        st.mode = st.last ? 3 : 0;
+        if (st.mode === 3) break;
+      }
+    } catch (e) {
+      if (e === _NEED) { pos = cpPos; bb = cpBb; cnt = cpCnt; }
+      else st.mode = 3;   // truncated or corrupt: keep what was decoded
     }
-    // btype === 3 is an error — skip
-  }
-
-  return new Uint8Array(out);
-}
 
-// ── PNG helpers ───────────────────────────────────────────────────────────────
+    st.out = out; st.op = op;
+    st.pos = pos; st.bb = bb; st.cnt = cnt;
+    return st.mode === 3;
+  }
 
-function u32be(b: Uint8Array, o: number): number {
-  return (((b[o] ?? 0) << 24) | ((b[o+1] ?? 0) << 16) | ((b[o+2] ?? 0) << 8) | (b[o+3] ?? 0)) >>> 0;
-}
+  /**
+   * Decompress a zlib-wrapped DEFLATE stream (as used by PNG IDAT chunks).
+   * Input: concatenated IDAT byte array starting with the 2-byte zlib header.
+   * Output: raw decompressed bytes as Uint8Array, written into one buffer of
+   * `sizeHint` bytes when the caller knows the size (PNG does), grown by
+   * doubling otherwise.  A truncated stream yields the bytes decoded so far.
+   */
+  function inflate(data: Uint8Array, sizeHint?: number): Uint8Array {
+    var st = inflater(sizeHint && sizeHint > 0 ? sizeHint : Math.max(1024, data.length * 4));
+    inflateRun(st, data, data.length, true);
+    return st.op === st.out.length ? st.out : st.out.subarray(0, st.op);
+  }
 
-function paethPredictor(a: number, b: number, c: number): number {
-  var p  = a + b - c;
-  var pa = Math.abs(p - a);
-  var pb = Math.abs(p - b);
-  var pc = Math.abs(p - c);
-  if (pa <= pb && pa <= pc) return a;
-  if (pb <= pc)             return b;
-  return c;
-}
+  // ── PNG helpers ───────────────────────────────────────────────────────────────
 
-// ── Public: decodePNG ─────────────────────────────────────────────────────────
+  function u32be(b: Uint8Array, o: number): number {
+    return (((b[o] ?? 0) << 24) | ((b[o+1] ?? 0) << 16) | ((b[o+2] ?? 0) << 8) | (b[o+3] ?? 0)) >>> 0;
+  }
 
-/**
- * Decode a PNG bytestream into a DecodedImage.
- * Returns null on any parse error.
- */
-export function decodePNG(bytes: Uint8Array): DecodedImage | null {
-  try {
-    return _decodePNG(bytes);
-  } catch (_e) {
-    return null;
+  function paeth(a: number, b: number, c: number): number {
+    var pa = b - c, pb = a - c, pc = pa + pb;
+    if (pa < 0) pa = -pa;
+    if (pb < 0) pb = -pb;
+    if (pc < 0) pc = -pc;
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
   }
-}
 
-function _decodePNG(bytes: Uint8Array): DecodedImage | null {
-  // Check PNG signature (first 8 bytes)
-  if (bytes.length < 8) return null;
-  if (bytes[0] !== 0x89 || bytes[1] !== 0x50 || bytes[2] !== 0x4E || bytes[3] !== 0x47) return null;
-
-  var w = 0, h = 0, bitDepth = 8, colorType = 2, interlace = 0;
-  var palette: number[] = [];
-  var idatBufs: Uint8Array[] = [];
-
-  var pos = 8; // skip signature
-
-  while (pos + 8 <= bytes.length) {
-    var chunkLen  = u32be(bytes, pos);     pos += 4;
-    var chunkType = String.fromCharCode(
-      bytes[pos]! & 0x7F, bytes[pos+1]! & 0x7F,
-      bytes[pos+2]! & 0x7F, bytes[pos+3]! & 0x7F);
-    pos += 4;
-
-    if (chunkType === 'IHDR') {
-      if (chunkLen < 13) return null;
-      w         = u32be(bytes, pos);
-      h         = u32be(bytes, pos + 4);
-      bitDepth  = bytes[pos + 8] ?? 8;
-      colorType = bytes[pos + 9] ?? 2;
-      interlace = bytes[pos + 12] ?? 0; // [Item 476] 0=none, 1=Adam7
-    } else if (chunkType === 'PLTE') {
-      for (var pi = 0; pi < chunkLen; pi++) palette.push(bytes[pos + pi] ?? 0);
-    } else if (chunkType === 'IDAT') {
-      idatBufs.push(bytes.slice(pos, pos + chunkLen));
-    } else if (chunkType === 'IEND') {
-      break;
+  // Same contract as kernel.pngUnfilter: `rows` scanlines of filter byte +
+  // `stride` bytes from src[so], reconstructed back to back into dst[doff];
+  // the row above the first is zero, or with `cont` the row before
+  // dst[doff].  Returns the offset after the last row.
+  function unfilterJS(src: Uint8Array, so: number, dst: Uint8Array, doff: number,
+                      stride: number, rows: number, bpp: number, cont?: boolean): number {
+    var lead = Math.min(bpp, stride);
+    for (var r = 0; r < rows; r++, so += stride + 1, doff += stride) {
+      var ft = src[so], s = so + 1, d = doff, p = doff - stride, i = 0;
+      if (r === 0 && !cont) ft = ft === 2 ? 0 : ft === 4 ? 1 : ft === 3 ? 5 : ft;
+      switch (ft) {
+        case 1:
+          for (; i < lead; i++) dst[d + i] = src[s + i];
+          for (; i < stride; i++) dst[d + i] = (src[s + i] + dst[d + i - bpp]) & 0xFF;
+          break;
+        case 2:
+          for (; i < stride; i++) dst[d + i] = (src[s + i] + dst[p + i]) & 0xFF;
+          break;
+        case 3:
+          for (; i < lead; i++) dst[d + i] = (src[s + i] + (dst[p + i] >> 1)) & 0xFF;
+          for (; i < stride; i++) dst[d + i] = (src[s + i] + ((dst[d + i - bpp] + dst[p + i]) >> 1)) & 0xFF;
+          break;
+        case 4:
+          for (; i < lead; i++) dst[d + i] = (src[s + i] + dst[p + i]) & 0xFF;
+          for (; i < stride; i++) dst[d + i] = (src[s + i] + paeth(dst[d + i - bpp], dst[p + i], dst[p + i - bpp])) & 0xFF;
+          break;
+        case 5:   // Average on the first row: left neighbour only
+          for (; i < lead; i++) dst[d + i] = src[s + i];
+          for (; i < stride; i++) dst[d + i] = (src[s + i] + (dst[d + i - bpp] >> 1)) & 0xFF;
+          break;
+        default:
+          dst.set(src.subarray(s, s + stride), d);
+      }
     }
+    return so;
+  }
 
-    pos += chunkLen + 4; // data + CRC
-    if (pos > bytes.length) break;
+  var unfilter: typeof unfilterJS = native ? _k.pngUnfilter : unfilterJS;
+
+  // Convert one reconstructed scanline of `w` pixels at line[lo] to
+  // 0xAARRGGBB, writing px[po], px[po + step], ...  16-bit samples keep
+  // their high byte; sub-byte greys are scaled up to 8 bits.
+  function convertRow(line: Uint8Array, lo: number, w: number, ct: number, bd: number,
+                      pal: Uint32Array | null, px: Uint32Array, po: number, step: number): void {
+    var x: number, v: number;
+    if (bd < 8) {
+      var mask = (1 << bd) - 1, mul = 255 / mask;
+      for (x = 0; x < w; x++, po += step) {
+        var bit = x * bd;
+        v = (line[lo + (bit >> 3)] >> (8 - bd - (bit & 7))) & mask;
+        if (ct === 3) px[po] = pal ? pal[v] : 0xFF000000;
+        else { v *= mul; px[po] = (0xFF000000 | (v << 16) | (v << 8) | v) >>> 0; }
+      }
+      return;
+    }
+    var sb = bd === 16 ? 2 : 1;   // bytes per sample
+    switch (ct) {
+      case 0:  // Greyscale
+        for (x = 0; x < w; x++, lo += sb, po += step) {
+          v = line[lo];
+          px[po] = (0xFF000000 | (v << 16) | (v << 8) | v) >>> 0;
+        }
+        break;
+      case 2:  // RGB
+        for (x = 0; x < w; x++, lo += 3 * sb, po += step)
+          px[po] = (0xFF000000 | (line[lo] << 16) | (line[lo + sb] << 8) | line[lo + 2 * sb]) >>> 0;
+        break;
+      case 3:  // Palette
+        for (x = 0; x < w; x++, lo++, po += step) px[po] = pal ? pal[line[lo]] : 0xFF000000;
+        break;
+      case 4:  // Greyscale + Alpha
+        for (x = 0; x < w; x++, lo += 2 * sb, po += step) {
+          v = line[lo];
+          px[po] = ((line[lo + sb] << 24) | (v << 16) | (v << 8) | v) >>> 0;
+        }
+        break;
+      case 6:  // RGBA
+        for (x = 0; x < w; x++, lo += 4 * sb, po += step)
+          px[po] = ((line[lo + 3 * sb] << 24) | (line[lo] << 16) | (line[lo + sb] << 8) | line[lo + 2 * sb]) >>> 0;
+        break;
+    }
   }
 
-  if (w === 0 || h === 0 || idatBufs.length === 0) return null;
+  // [Item 476] Adam7 pass parameters: [xOrigin, yOrigin, xStep, yStep]
+  var _A7 = [
+    [0, 0, 8, 8], [4, 0, 8, 8], [0, 4, 4, 8],
+    [2, 0, 4, 4], [0, 2, 2, 4], [1, 0, 2, 2], [0, 1, 1, 2],
+  ];
+  // Block each Adam7 pass's pixel stands for until later passes arrive
+  var _A7_BLOCK = [[8, 8], [4, 8], [4, 4], [2, 4], [2, 2], [1, 2], [1, 1]];
+
+  /**
+   * Incremental PNG decoder.  Chunks are parsed as they complete,
+   * IDAT payloads feed a resumable inflater, and every scanline the inflated
+   * data covers is unfiltered and converted straight away.  While an Adam7
+   * image is still arriving each pass's pixels are drawn as blocks, so the
+   * picture sharpens pass by pass.
+   */
+  function stream(alloc?: (n: number) => Uint32Array): ImageStream {
+    var buf = new Uint8Array(0), len = 0, pos = 8;
+    var idatLeft = 0;                       // payload bytes of the IDAT being read
+    var zbuf = new Uint8Array(0), zlen = 0; // concatenated IDAT payloads
+    var z: Inflater | null = null;
+    var bitDepth = 8, colorType = 2, interlace = 0, bitsPP = 8, bpp = 1;
+    var palette: Uint32Array | null = null;
+    var passes: number[][] = [];
+    var rawSize = 0;
+    var pass = 0, passRow = 0, rawPos = 0;
+    var lines: Uint8Array | null = null;    // current pass, unfiltered
+    var whole = false;                      // the first push was the whole file
+
+    var s: ImageStream = { w: 0, h: 0, nw: 0, nh: 0, data: null, y0: 0, y1: 0,
+                           done: false, failed: false, push: push };
+
+    function mark(a: number, b: number): void {
+      if (s.y1 <= s.y0) { s.y0 = a; s.y1 = b; return; }
+      if (a < s.y0) s.y0 = a;
+      if (b > s.y1) s.y1 = b;
+    }
 
-  // Clamp image size
-  if (w > 2048 || h > 2048) return null;
+    function append(dst: Uint8Array, n: number, src: Uint8Array, so: number, m: number): Uint8Array {
+      if (n + m > dst.length) {
+        var d2 = new Uint8Array(Math.max(dst.length * 2, n + m, 4096));
+        d2.set(dst.subarray(0, n));
+        dst = d2;
+      }
+      dst.set(src.subarray(so, so + m), n);
+      return dst;
+    }
 
-  // Concatenate IDAT chunks
-  var totalLen = 0;
-  for (var di = 0; di < idatBufs.length; di++) totalLen += idatBufs[di]!.length;
-  var idat = new Uint8Array(totalLen);
-  var off2 = 0;
-  for (var di2 = 0; di2 < idatBufs.length; di2++) {
-    idat.set(idatBufs[di2]!, off2);
-    off2 += idatBufs[di2]!.length;
-  }
+    function header(o: number, clen: number): boolean {
+      if (clen < 13) return false;
+      var w = u32be(buf, o), h = u32be(buf, o + 4);
+      bitDepth  = buf[o + 8];
+      colorType = buf[o + 9];
+      interlace = buf[o + 12];   // [Item 476] 0=none, 1=Adam7
+      // Clamp image size
+      if (w === 0 || h === 0 || w > 2048 || h > 2048) return false;
+      var channels = colorType === 0 || colorType === 3 ? 1 : colorType === 4 ? 2 : colorType === 6 ? 4 : 3;
+      bitsPP = channels * bitDepth;
+      bpp = Math.max(1, bitsPP >> 3);          // filter distance in bytes
+      // Scanline layout: one pass, or seven Adam7 passes back to back
+      passes = interlace === 1 ? _A7 : [[0, 0, 1, 1]];
+      rawSize = 0;
+      for (var ps = 0; ps < passes.length; ps++) {
+        var pw0 = Math.ceil((w - passes[ps][0]) / passes[ps][2]);
+        var ph0 = Math.ceil((h - passes[ps][1]) / passes[ps][3]);
+        if (pw0 > 0 && ph0 > 0) rawSize += ph0 * (((pw0 * bitsPP + 7) >> 3) + 1);
+      }
+      s.w = s.nw = w; s.h = s.nh = h;
+      s.data = alloc ? alloc(w * h) : new Uint32Array(w * h);
+      z = inflater(rawSize);
+      return true;
+    }
 
-  // Decompress IDAT
-  var raw: Uint8Array;
-  try { raw = inflate(idat); } catch (_e) { return null; }
-
-  // Bytes per pixel
-  var bypp = getBypp(colorType, bitDepth);
-  var stride = Math.ceil(w * bypp);
-
-  // [Item 476] Adam7 interlaced PNG support
-  // For interlaced images, deinterlace first into a full linear filtered buffer,
-  // then fall through to normal pixel conversion.
-  var filtered = new Uint8Array(h * stride);
-
-  if (interlace === 1) {
-    // Adam7 pass parameters: [xOrigin, yOrigin, xStep, yStep]
-    var _A7 = [
-      [0, 0, 8, 8], [4, 0, 8, 8], [0, 4, 4, 8],
-      [2, 0, 4, 4], [0, 2, 2, 4], [1, 0, 2, 2], [0, 1, 1, 2],
-    ];
-    var rawPos = 0;
-    for (var pass = 0; pass < 7; pass++) {
-      var xOrig = _A7[pass]![0] ?? 0;
-      var yOrig = _A7[pass]![1] ?? 0;
-      var xStep = _A7[pass]![2] ?? 1;
-      var yStep = _A7[pass]![3] ?? 1;
-
-      var passW = Math.ceil((w - xOrig) / xStep);
-      var passH = Math.ceil((h - yOrig) / yStep);
-      if (passW <= 0 || passH <= 0) continue;
-
-      var passStride = Math.ceil(passW * bypp);
-      // Temporary buffer for this pass's filtered data
-      var passBuf = new Uint8Array(passH * passStride);
-
-      for (var pRow = 0; pRow < passH; pRow++) {
-        var fB = raw[rawPos++] ?? 0;
-        var pOff = pRow * passStride;
-        for (var pCol = 0; pCol < passStride; pCol++) {
-          var pBpp = Math.max(1, Math.floor(bypp));
-          var pA = pCol >= pBpp ? passBuf[pOff + pCol - pBpp]! : 0;
-          var pB = pRow > 0 ? passBuf[(pRow - 1) * passStride + pCol]! : 0;
-          var pC = (pRow > 0 && pCol >= pBpp) ? passBuf[(pRow - 1) * passStride + pCol - pBpp]! : 0;
-          var pX = raw[rawPos++] ?? 0;
-          var pR: number;
-          switch (fB) {
-            case 1: pR = (pX + pA) & 0xFF; break;
-            case 2: pR = (pX + pB) & 0xFF; break;
-            case 3: pR = (pX + Math.floor((pA + pB) / 2)) & 0xFF; break;
-            case 4: pR = (pX + paethPredictor(pA, pB, pC)) & 0xFF; break;
-            default: pR = pX;
-          }
-          passBuf[pOff + pCol] = pR;
+    // Unfilter and convert every row the inflated data covers; at the end
+    // of the data (`flush`) missing rows decode from zeros
+    function emit(flush: boolean): void {
+      var px = s.data!, w = s.w, h = s.h, zs = z!;
+      var avail = zs.op;
+      if (flush && avail < rawSize) {
+        // Short stream: the remaining rows decode from zeros
+        if (zs.out.length < rawSize) {
+          var r2 = new Uint8Array(rawSize);
+          r2.set(zs.out.subarray(0, avail));
+          zs.out = r2;
+        } else {
+          zs.out.fill(0, avail, rawSize);
         }
+        avail = rawSize;
       }
-
-      // Scatter pass pixels back to full image buffer
-      for (var prY = 0; prY < passH; prY++) {
-        for (var prX = 0; prX < passW; prX++) {
-          var srcOff2 = prY * passStride + Math.round(prX * bypp);
-          var dstX = xOrig + prX * xStep;
-          var dstY = yOrig + prY * yStep;
-          var dstOff = dstY * stride + Math.round(dstX * bypp);
-          var pLen = Math.ceil(bypp);
-          for (var pi2 = 0; pi2 < pLen; pi2++) {
-            filtered[dstOff + pi2] = passBuf[srcOff2 + pi2] ?? 0;
+      var raw = zs.out;
+      for (; pass < passes.length; pass++, passRow = 0, lines = null) {
+        var xOrig = passes[pass][0], yOrig = passes[pass][1];
+        var xStep = passes[pass][2], yStep = passes[pass][3];
+        var passW = Math.ceil((w - xOrig) / xStep);
+        var passH = Math.ceil((h - yOrig) / yStep);
+        if (passW <= 0 || passH <= 0) continue;
+        var stride = (passW * bitsPP + 7) >> 3;
+        var n = Math.min(passH - passRow, Math.floor((avail - rawPos) / (stride + 1)));
+        if (n > 0) {
+          if (!lines) lines = new Uint8Array(passH * stride);
+          rawPos = unfilter(raw, rawPos, lines, passRow * stride, stride, n, bpp, passRow > 0);
+          var bw = 1, bh = 1;
+          if (interlace === 1 && !whole) { bw = _A7_BLOCK[pass][0]; bh = _A7_BLOCK[pass][1]; }
+          for (var r = passRow; r < passRow + n; r++) {
+            var y = yOrig + r * yStep;
+            convertRow(lines, r * stride, passW, colorType, bitDepth, palette, px, y * w + xOrig, xStep);
+            if (bw > 1 || bh > 1) block(px, w, h, y, xOrig, xStep, bw, bh);
           }
+          mark(yOrig + passRow * yStep, Math.min(h, yOrig + (passRow + n - 1) * yStep + bh));
+          passRow += n;
         }
+        if (passRow < passH) break;
       }
+      if (pass >= passes.length) s.done = true;
     }
-  } else {
-    // Non-interlaced: Apply PNG filter functions row by row
-    for (var row = 0; row < h; row++) {
-      var fByte  = raw[row * (stride + 1)] ?? 0;
-      var inOff  = row * (stride + 1) + 1;
-      var outOff = row * stride;
-
-      for (var col = 0; col < stride; col++) {
-        var bpp = Math.max(1, Math.floor(bypp));
-        var a   = col >= bpp ? filtered[outOff + col - bpp]! : 0;
-        var b   = row  > 0  ? filtered[(row - 1) * stride + col]! : 0;
-        var c   = (row > 0 && col >= bpp) ? filtered[(row - 1) * stride + col - bpp]! : 0;
-        var x   = raw[inOff + col] ?? 0;
-        var result: number;
-        switch (fByte) {
-          case 0:  result = x; break;
-          case 1:  result = (x + a)                           & 0xFF; break;
-          case 2:  result = (x + b)                           & 0xFF; break;
-          case 3:  result = (x + Math.floor((a + b) / 2))    & 0xFF; break;
-          case 4:  result = (x + paethPredictor(a, b, c))    & 0xFF; break;
-          default: result = x;
-        }
-        filtered[outOff + col] = result;
+
+    // Spread row y of an Adam7 pass over the bw × bh blocks its pixels lead
+    function block(px: Uint32Array, w: number, h: number, y: number,
+                   x0: number, step: number, bw: number, bh: number): void {
+      var y1 = Math.min(h, y + bh);
+      for (var x = x0; x < w; x += step) {
+        var v = px[y * w + x], x1 = Math.min(w, x + bw);
+        for (var yy = y; yy < y1; yy++) px.fill(v, yy * w + x, yy * w + x1);
       }
     }
-  }
-
-  // Convert to 0xAARRGGBB pixel array
-  var pixels = new Uint32Array(w * h);
 
-  for (var py = 0; py < h; py++) {
-    for (var px = 0; px < w; px++) {
-      var pp = py * stride + px * bypp;
-      var pr = 0, pg = 0, pb_v = 0, pa = 255;
-
-      switch (colorType) {
-        case 0: { // Greyscale
-          pr = pg = pb_v = scaled(filtered[pp] ?? 0, bitDepth);
-          break;
+    function push(bytes: Uint8Array, last: boolean): void {
+      if (s.done || s.failed) return;
+      if (len === 0 && last) { buf = bytes; len = bytes.length; whole = true; }
+      else if (bytes.length) { buf = append(buf, len, bytes, 0, bytes.length); len += bytes.length; }
+      // Check PNG signature (first 8 bytes)
+      if (len < 8) { if (last) s.failed = true; return; }
+      if (buf[0] !== 0x89 || buf[1] !== 0x50 || buf[2] !== 0x4E || buf[3] !== 0x47) { s.failed = true; return; }
+
+      var ended = false;
+      while (!ended) {
+        if (idatLeft > 0) {
+          var m = Math.min(idatLeft, len - pos);
+          if (m <= 0) break;
+          zbuf = append(zbuf, zlen, buf, pos, m);
+          zlen += m; pos += m; idatLeft -= m;
+          if (idatLeft === 0) pos += 4;        // CRC
+          continue;
         }
-        case 2: { // RGB
-          if (bitDepth === 16) {
-            pr   = filtered[pp]   ?? 0;
-            pg   = filtered[pp+2] ?? 0;
-            pb_v = filtered[pp+4] ?? 0;
-          } else {
-            pr   = filtered[pp]   ?? 0;
-            pg   = filtered[pp+1] ?? 0;
-            pb_v = filtered[pp+2] ?? 0;
-          }
-          break;
+        if (pos + 8 > len) break;
+        var chunkLen  = u32be(buf, pos);
+        var chunkType = String.fromCharCode(
+          buf[pos + 4] & 0x7F, buf[pos + 5] & 0x7F, buf[pos + 6] & 0x7F, buf[pos + 7] & 0x7F);
+        if (chunkType === 'IDAT') {
+          if (!z) { s.failed = true; return; }
+          pos += 8; idatLeft = chunkLen;
+          if (!idatLeft) pos += 4;
+          continue;
         }
-        case 3: { // Palette
-          var idx = filtered[pp] ?? 0;
-          pr   = palette[idx * 3]     ?? 0;
-          pg   = palette[idx * 3 + 1] ?? 0;
-          pb_v = palette[idx * 3 + 2] ?? 0;
-          break;
-        }
-        case 4: { // Greyscale + Alpha
-          pr = pg = pb_v = scaled(filtered[pp] ?? 0, bitDepth);
-          pa = scaled(filtered[pp + (bitDepth === 16 ? 2 : 1)] ?? 255, bitDepth);
-          break;
-        }
-        case 6: { // RGBA
-          if (bitDepth === 16) {
-            pr   = filtered[pp]   ?? 0;
-            pg   = filtered[pp+2] ?? 0;
-            pb_v = filtered[pp+4] ?? 0;
-            pa   = filtered[pp+6] ?? 255;
-          } else {
-            pr   = filtered[pp]   ?? 0;
-            pg   = filtered[pp+1] ?? 0;
-            pb_v = filtered[pp+2] ?? 0;
-            pa   = filtered[pp+3] ?? 255;
+        if (chunkType === 'IEND') { ended = true; break; }
+        if (pos + 12 + chunkLen > len && !(last && chunkType !== 'IHDR')) break;
+        var o = pos + 8;
+        if (chunkType === 'IHDR') {
+          if (z || !header(o, chunkLen)) { s.failed = true; return; }
+        } else if (chunkType === 'PLTE') {
+          palette = new Uint32Array(256).fill(0xFF000000);
+          for (var pi = 0; pi < 256 && pi * 3 + 2 < chunkLen; pi++) {
+            var pp = o + pi * 3;
+            palette[pi] = (0xFF000000 | ((buf[pp] ?? 0) << 16) | ((buf[pp + 1] ?? 0) << 8) | (buf[pp + 2] ?? 0)) >>> 0;
           }
-          break;
         }
+        pos += chunkLen + 12;   // length + type + data + CRC
       }
 
-      pixels[py * w + px] = ((pa & 0xFF) << 24 | (pr & 0xFF) << 16 | (pg & 0xFF) << 8 | (pb_v & 0xFF)) >>> 0;
+      var fin = last || ended;
+      if (!z) { if (fin) s.failed = true; return; }
+      if (zlen === 0 && !fin) return;
+      if (zlen === 0) { s.failed = true; return; }
+      inflateRun(z, zbuf, zlen, fin);
+      emit(fin);
     }
+
+    return s;
   }
 
-  return { w, h, data: pixels };
-}
+  function _decodePNG(bytes: Uint8Array, alloc?: (n: number) => Uint32Array): DecodedImage | null {
+    var s = stream(alloc);
+    s.push(bytes, true);
+    return s.data ? { w: s.w, h: s.h, data: s.data } : null;
+  }
 
-/** Return bytes-per-pixel for the given PNG color type and bit depth. */
-function getBypp(colorType: number, bitDepth: number): number {
-  var channels: number;
-  switch (colorType) {
-    case 0: channels = 1; break;   // Greyscale
-    case 2: channels = 3; break;   // RGB
-    case 3: channels = 1; break;   // Palette (1 byte per pixel index)
-    case 4: channels = 2; break;   // Greyscale+Alpha
-    case 6: channels = 4; break;   // RGBA
-    default: channels = 3;
+  // Image size from the IHDR chunk, without inflating
+  function probePNG(bytes: Uint8Array): { w: number; h: number } | null {
+    if (bytes.length < 24 || bytes[0] !== 0x89 || bytes[1] !== 0x50) return null;
+    if (bytes[12] !== 0x49 || bytes[13] !== 0x48 || bytes[14] !== 0x44 || bytes[15] !== 0x52) return null;
+    return { w: u32be(bytes, 16), h: u32be(bytes, 20) };
   }
-  if (bitDepth === 16) return channels * 2;
-  if (bitDepth < 8)   return 1;  // Sub-byte (1/2/4 bpp packed, we treat as 1 byte/pixel for simplicity)
-  return channels;
+
+  return {
+    decode: function(bytes: Uint8Array, alloc?: (n: number) => Uint32Array): DecodedImage | null {
+      try { return _decodePNG(bytes, alloc); } catch (_e) { return null; }
+    },
+    probe: probePNG,
+    stream: stream,
+    inflate: inflate,
+    native: native,
+  };
 }
 
-/** Scale a bitDepth-bit value to 8 bits. */
-function scaled(v: number, bitDepth: number): number {
-  if (bitDepth === 8)  return v;
-  if (bitDepth === 16) return v; // already read the high byte
-  if (bitDepth === 4)  return v * 17;
-  if (bitDepth === 2)  return v * 85;
-  if (bitDepth === 1)  return v * 255;
-  return v;
+var _png = pngCodec();
+
+// ── Public API ────────────────────────────────────────────────────────────────
+
+/**
+ * Decompress a zlib-wrapped DEFLATE stream (as used by PNG IDAT chunks).
+ */
+export function inflate(data: Uint8Array): Uint8Array {
+  return _png.inflate(data);
+}
+
+/**
+ * Decode a PNG bytestream into a DecodedImage.
+ * Returns null on any parse error.
+ */
+export function decodePNG(bytes: Uint8Array): DecodedImage | null {
+  return _png.decode(bytes);
 }
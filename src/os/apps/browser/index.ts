@@ -39,12 +39,12 @@ import { parseURL, urlEncode, encodeFormData, decodeBMP, readPNGDimensions, deco
 import { parseHTML, parseHTMLFromTokens, tokenise, fastExtractFromTokens } from './html.js';
 import { parseStylesheet, buildSheetIndex, type CSSRule, type RuleIndex, resetCSSVars, setViewport, flushCSSMatchCache, getCSSMatchCacheStats, flushSheetCache } from './stylesheet.js';
 import { decodePNG }    from './img-png.js';
-import { decodeJPEG }   from './img-jpeg.js';
 import { layoutNodes }  from './layout.js';
 import { aboutJsosHTML, aboutJstestHTML, errorHTML, jsonViewerHTML } from './pages.js';
 import { createPageJS, getBlobURLContent, type PageJS } from './jsruntime.js';
 import { JITBrowserEngine } from './jit-browser.js';
-import { flushAllCaches } from './cache.js';
+import { flushAllCaches, flushImageCache, getImageBitmap, getScaledImage, storeImageBitmap, storeScaledImage } from './cache.js';
+import { imageDecodePool, type ImageStreamHandle } from './img-decode-pool.js';
 import { renderGradientCSS } from './gradient.js';
 import { parseCSP, type CSPPolicy } from './csp.js';
 import { TileRenderer, textAtlas } from './render.js';
@@ -169,7 +169,7 @@ interface TabState {
   hoverHref:     string;
   forms:         FormState[];
   focusedWidget: number;
-  imgCache:      Map<string, DecodedImage | null>;
+  imgFailed:     Set<string>;   // image URLs that failed to load or decode
   imgsFetching:  boolean;
   pageJS:        PageJS | null;
   jsStartMs:     number;
@@ -239,8 +239,13 @@ export class BrowserApp implements App {
   private _widgets:       PositionedWidget[]  = [];
   private _focusedWidget  = -1;
 
-  // Image cache: maps src URL → decoded image (null = fetch failed / unsupported)
-  private _imgCache    = new Map<string, DecodedImage | null>();
+  // Image URLs that failed to load or decode.  Decoded pixels live in the
+  // budgeted imageBitmapCache (cache.ts), keyed by URL and target size.
+  private _imgFailed   = new Set<string>();
+  // Image decodes in flight (see _imgKey) so a relayout doesn't resubmit them
+  private _imgDecoding = new Set<string>();
+  // Natural size of every decoded image, to find width-capped copies again
+  private _imgNatural  = new Map<string, { w: number; h: number }>();
   private _imgsFetching = false;
   // Background-image cache: URL → decoded (item 386)
   private _bgImageMap  = new Map<string, DecodedImage | null>();
@@ -287,7 +292,7 @@ export class BrowserApp implements App {
       url, title: url, history: [{ url, title: url }], histIdx: 0,
       pageLines: [], widgets: [], scrollY: 0, maxScrollY: 0,
       loading: false, status: '', hoverHref: '', forms: [],
-      focusedWidget: -1, imgCache: new Map(), imgsFetching: false,
+      focusedWidget: -1, imgFailed: new Set(), imgsFetching: false,
       pageJS: null, jsStartMs: 0, pageSource: '', pageBaseURL: '',
       bgImageMap: new Map(),
     };
@@ -303,7 +308,7 @@ export class BrowserApp implements App {
       loading: this._loading, status: this._status,
       hoverHref: this._hoverHref, forms: this._forms,
       focusedWidget: this._focusedWidget,
-      imgCache: this._imgCache, imgsFetching: this._imgsFetching,
+      imgFailed: this._imgFailed, imgsFetching: this._imgsFetching,
       pageJS: this._pageJS, jsStartMs: this._jsStartMs,
       pageSource: this._pageSource, pageBaseURL: this._pageBaseURL,
       favicon: this._tabs[this._curTab]?.favicon,
@@ -325,7 +330,7 @@ export class BrowserApp implements App {
     this._loading = t.loading; this._status = t.status;
     this._hoverHref = t.hoverHref; this._forms = t.forms;
     this._focusedWidget = t.focusedWidget;
-    this._imgCache = t.imgCache; this._imgsFetching = t.imgsFetching;
+    this._imgFailed = t.imgFailed; this._imgsFetching = t.imgsFetching;
     this._pageJS = t.pageJS; this._jsStartMs = t.jsStartMs;
     this._pageSource = t.pageSource; this._pageBaseURL = t.pageBaseURL;
     this._bgImageMap = t.bgImageMap ?? new Map();
@@ -715,6 +720,8 @@ export class BrowserApp implements App {
   // Drives JS timers, RAF, transitions, animations, child IPC — all the
   // expensive logic that doesn't need to happen inside the rendering pass.
   tick(): void {
+    // Hand out / collect off-runtime image decodes
+    imageDecodePool.tick();
     if (this._pageJS) {
       var nowMs = Date.now() - this._jsStartMs;
       this._pageJS.tick(nowMs);
@@ -2080,6 +2087,98 @@ export class BrowserApp implements App {
 
   // ── Image fetching ────────────────────────────────────────────────────────
 
+  /**
+   * Size to decode an <img> at: its laid-out box when the page
+   * gave it one (width/height attributes or CSS), otherwise natural size
+   * capped to the space left on the line.
+   */
+  private _imgTarget(wp: PositionedWidget): { tw: number; th: number; mw: number } {
+    var sized = !!((wp.imgNatW && wp.imgNatH) || (wp.cssWidth && wp.cssWidth > 0) ||
+                   (wp.cssHeight && wp.cssHeight > 0));
+    if (sized) return { tw: wp.pw, th: wp.ph, mw: 0 };
+    var cw = this._win ? this._win.canvas.width : 800;
+    return { tw: 0, th: 0, mw: Math.max(16, cw - wp.px - CONTENT_PAD) };
+  }
+
+  private _imgKey(src: string, t: { tw: number; th: number; mw: number }): string {
+    return src + '|' + t.tw + 'x' + t.th + '|' + t.mw;
+  }
+
+  /** Decoded bitmap for `src` at target `t` from the image cache, or null. */
+  private _imgCached(src: string, t: { tw: number; th: number; mw: number }): DecodedImage | null {
+    if (t.tw > 0) {
+      var d = getScaledImage(src, t.tw, t.th);
+      return d ? { w: t.tw, h: t.th, data: d } : null;
+    }
+    var nat = this._imgNatural.get(src);
+    if (nat && nat.w > t.mw) {
+      var ch = Math.max(1, Math.round(nat.h * t.mw / nat.w));
+      var c = getScaledImage(src, t.mw, ch);
+      return c ? { w: t.mw, h: ch, data: c } : null;
+    }
+    var o = getImageBitmap(src);
+    return o && o.w <= t.mw ? o : null;
+  }
+
+  /** Submit PNG/JPEG/GIF bytes to the decode pool; the result fills every matching widget. */
+  private _decodeImage(src: string, bytes: Uint8Array, t: { tw: number; th: number; mw: number }): void {
+    var self = this;
+    var key  = this._imgKey(src, t);
+    this._imgDecoding.add(key);
+    imageDecodePool.decode(bytes, t.tw, t.th, t.mw, function(img, natW, natH) {
+      self._imgDecoding.delete(key);
+      if (img && img.data) {
+        self._imgNatural.set(src, { w: natW, h: natH });
+        if (t.tw === 0 && img.w === natW) storeImageBitmap(src, img.w, img.h, img.data);
+        else storeScaledImage(src, img.w, img.h, img.data);
+      } else {
+        self._imgFailed.add(src);
+      }
+      self._applyImage(src, t, img);
+    });
+  }
+
+  /** Hand a finished decode to the current page's widgets waiting on it. */
+  private _applyImage(src: string, t: { tw: number; th: number; mw: number }, img: DecodedImage | null): void {
+    var key = this._imgKey(src, t);
+    for (var i = 0; i < this._widgets.length; i++) {
+      var wg = this._widgets[i];
+      if (wg.kind !== 'img' || wg.imgLoaded || wg.imgSrc !== src) continue;
+      if (this._imgKey(src, this._imgTarget(wg)) !== key) continue;
+      if (img && img.data) { wg.imgData = img.data; wg.pw = img.w; wg.ph = img.h; }
+      wg.imgLoaded = true;
+    }
+    this._dirty = true;
+  }
+
+  /**
+   * Show rows [y0, y1) of a streamed image in the widgets waiting
+   * on it, damaging only that band of each; a widget's first rows damage
+   * its whole box.  `img` null withdraws a partial image again.
+   */
+  private _imgRows(src: string, t: { tw: number; th: number; mw: number },
+                   img: DecodedImage | null, y0: number, y1: number): void {
+    var key = this._imgKey(src, t);
+    var cy  = TAB_BAR_H + TOOLBAR_H, ch = this._contentH();
+    for (var i = 0; i < this._widgets.length; i++) {
+      var wg = this._widgets[i];
+      if (wg.kind !== 'img' || wg.imgSrc !== src) continue;
+      if (this._imgKey(src, this._imgTarget(wg)) !== key) continue;
+      if (!img) {
+        if (wg.imgLoaded && wg.imgData) { wg.imgLoaded = false; wg.imgData = null; this._dirty = true; }
+        continue;
+      }
+      var wy = cy + wg.py - this._scrollY;
+      if (!wg.imgLoaded || wg.imgData !== img.data) {
+        wg.imgData = img.data; wg.pw = img.w; wg.ph = img.h;
+        wg.imgLoaded = true;
+        y0 = 0; y1 = img.h;
+      }
+      var a = Math.max(cy, wy + y0), b = Math.min(cy + ch, wy + y1);
+      if (b > a) { this._expandDamage(wg.px, a, wg.pw, b - a); this._dirty = true; }
+    }
+  }
+
   private _fetchImages(): void {
     this._imgsFetching = true;
     var pendingCount   = 0;
@@ -2091,7 +2190,18 @@ export class BrowserApp implements App {
       var src = wp.imgSrc || '';
       if (!src) { wp.imgLoaded = true; wp.imgData = null; continue; }
 
-      // Inline data: images — decode immediately without a network fetch
+      if (this._imgFailed.has(src)) { wp.imgLoaded = true; continue; }
+      var tgt    = this._imgTarget(wp);
+      var cached = this._imgCached(src, tgt);
+      if (cached) {
+        wp.imgData = cached.data; wp.pw = cached.w; wp.ph = cached.h;
+        wp.imgLoaded = true;
+        continue;
+      }
+      // Already being fetched or decoded — _applyImage() will fill it in
+      if (this._imgDecoding.has(this._imgKey(src, tgt))) continue;
+
+      // Inline data: images — no network fetch; PNG/JPEG/GIF still decode off-runtime
       if (src.startsWith('data:')) {
         var comma     = src.indexOf(',');
         var meta      = comma > 5 ? src.slice(5, comma) : '';
@@ -2099,55 +2209,76 @@ export class BrowserApp implements App {
         var isBase64  = meta.indexOf(';base64') >= 0;
         var rawBytes  = isBase64 ? decodeBase64(dataStr) : Array.from(dataStr).map(c => c.charCodeAt(0));
         var decoded: DecodedImage | null = decodeBMP(rawBytes);
+        if (!decoded && rawBytes.length > 8 &&
+            ((rawBytes[0] === 0x89 && rawBytes[1] === 0x50) || (rawBytes[0] === 0xFF && rawBytes[1] === 0xD8) ||
+             (rawBytes[0] === 0x47 && rawBytes[1] === 0x49))) {
+          this._decodeImage(src, new Uint8Array(rawBytes), tgt);
+          continue;
+        }
         if (!decoded) {
-          // Try PNG
-          if (rawBytes.length > 8 && rawBytes[0] === 0x89 && rawBytes[1] === 0x50) {
-            try { decoded = decodePNG(new Uint8Array(rawBytes)); } catch (_e) {}
-          }
-          // Try JPEG
-          if (!decoded && rawBytes.length > 3 && rawBytes[0] === 0xFF && rawBytes[1] === 0xD8) {
-            try { decoded = decodeJPEG(new Uint8Array(rawBytes)); } catch (_e) {}
-          }
-          if (!decoded) {
-            var pngDim0 = readPNGDimensions(rawBytes);
-            if (pngDim0) {
-              wp.imgNatW = pngDim0.w; wp.pw = Math.min(pngDim0.w, 600);
-              wp.imgNatH = pngDim0.h; wp.ph = Math.round(pngDim0.h * wp.pw / pngDim0.w);
-            }
+          var pngDim0 = readPNGDimensions(rawBytes);
+          if (pngDim0) {
+            wp.imgNatW = pngDim0.w; wp.pw = Math.min(pngDim0.w, 600);
+            wp.imgNatH = pngDim0.h; wp.ph = Math.round(pngDim0.h * wp.pw / pngDim0.w);
           }
+          this._imgFailed.add(src);
+        }
+        if (decoded) {
+          wp.imgData = decoded.data; wp.pw = decoded.w; wp.ph = decoded.h;
+          if (decoded.data) storeImageBitmap(src, decoded.w, decoded.h, decoded.data);
         }
-        if (decoded) { wp.imgData = decoded.data; wp.pw = decoded.w; wp.ph = decoded.h; }
         wp.imgLoaded = true;
-        this._imgCache.set(src, decoded);
         this._dirty = true;
         continue;
       }
 
-      if (this._imgCache.has(src)) {
-        var cached = this._imgCache.get(src)!;
-        if (cached) { wp.imgData = cached.data; wp.pw = cached.w; wp.ph = cached.h; }
-        wp.imgLoaded = true;
-        continue;
-      }
-
       pendingCount++;
       var resolved = this._resolveHref(src);
-      var self = this;
-      (function(ww: typeof wp, srcURL: string, rawSrc: string) {
+      this._imgDecoding.add(this._imgKey(src, tgt));
+      (function(ww: typeof wp, srcURL: string, rawSrc: string, t: { tw: number; th: number; mw: number }) {
+        // Rows paint while the body is still arriving: a stream
+        // opens on the first bytes when they look like PNG, JPEG or GIF
+        var key = self._imgKey(rawSrc, t);
+        var sh: ImageStreamHandle | null = null, fed = 0, whole: number[] | null = null;
+        function onRows(img: DecodedImage | null, natW: number, natH: number, y0: number, y1: number, done: boolean): void {
+          if (!img) {
+            // Corrupt data or no decoder: decode the whole body instead
+            sh = null;
+            self._imgRows(rawSrc, t, null, 0, 0);
+            if (whole) { self._imgDecoding.delete(key); self._decodeImage(rawSrc, new Uint8Array(whole), t); }
+            return;
+          }
+          self._imgNatural.set(rawSrc, { w: natW, h: natH });
+          self._imgRows(rawSrc, t, img, y0, y1);
+          if (!done) return;
+          self._imgDecoding.delete(key);
+          if (t.tw === 0 && img.w === natW) storeImageBitmap(rawSrc, img.w, img.h, img.data);
+          else storeScaledImage(rawSrc, img.w, img.h, img.data);
+        }
         os.fetchAsync(srcURL, function(resp: FetchResponse | null, _err?: string) {
+          if (sh) {
+            if (resp && resp.status === 200 && fed === resp.body.length) {
+              whole = resp.body;
+              sh.feed(new Uint8Array(0), true);
+              return;
+            }
+            // Retried or redirected underneath us: start over from the body
+            sh.cancel(); sh = null;
+            self._imgRows(rawSrc, t, null, 0, 0);
+          }
+          self._imgDecoding.delete(key);
           if (resp && resp.status === 200 && resp.body.length >= 2) {
-            var imgDecoded: DecodedImage | null = null;
             var b0 = resp.body[0] ?? 0;
             var b1 = resp.body[1] ?? 0;
+            if ((b0 === 0x89 && b1 === 0x50) || (b0 === 0xFF && b1 === 0xD8) || (b0 === 0x47 && b1 === 0x49)) {
+              // PNG / JPEG / GIF — decoded to the widget's size in the decode pool
+              self._decodeImage(rawSrc, new Uint8Array(resp.body), t);
+              return;
+            }
+            var imgDecoded: DecodedImage | null = null;
             if (b0 === 0x42 && b1 === 0x4D) {
               // BMP — full pixel decode
               imgDecoded = decodeBMP(resp.body);
-            } else if (b0 === 0x89 && b1 === 0x50) {
-              // PNG — full decode using inline TypeScript PNG decoder
-              try { imgDecoded = decodePNG(new Uint8Array(resp.body)); } catch (_e) {}
-            } else if (b0 === 0xFF && b1 === 0xD8) {
-              // JPEG — full decode using inline TypeScript JPEG decoder
-              try { imgDecoded = decodeJPEG(new Uint8Array(resp.body)); } catch (_e) {}
             } else {
               // Other — read dimensions only, show sized placeholder
               var pDim = readPNGDimensions(resp.body);
@@ -2156,15 +2287,29 @@ export class BrowserApp implements App {
                 ww.imgNatH = pDim.h; ww.ph = Math.round(pDim.h * ww.pw / pDim.w);
               }
             }
-            self._imgCache.set(rawSrc, imgDecoded);
-            if (imgDecoded) { ww.imgData = imgDecoded.data; ww.pw = imgDecoded.w; ww.ph = imgDecoded.h; }
+            if (imgDecoded) {
+              ww.imgData = imgDecoded.data; ww.pw = imgDecoded.w; ww.ph = imgDecoded.h;
+              if (imgDecoded.data) storeImageBitmap(rawSrc, imgDecoded.w, imgDecoded.h, imgDecoded.data);
+            } else {
+              self._imgFailed.add(rawSrc);
+            }
           } else {
-            self._imgCache.set(rawSrc, null);
+            self._imgFailed.add(rawSrc);
           }
           ww.imgLoaded = true;
           self._dirty  = true;
+        }, {
+          onBody: function(chunk: Uint8Array, _total: number): void {
+            if (fed === 0 && chunk.length >= 4 &&
+                ((chunk[0] === 0x89 && chunk[1] === 0x50) || (chunk[0] === 0xFF && chunk[1] === 0xD8) ||
+                 (chunk[0] === 0x47 && chunk[1] === 0x49 && chunk[2] === 0x46 && chunk[3] === 0x38))) {
+              sh = imageDecodePool.stream(t.tw, t.th, t.mw, onRows);   // null: all streams busy
+            }
+            fed += chunk.length;
+            if (sh) sh.feed(chunk, false);
+          },
         });
-      })(wp, resolved, src);
+      })(wp, resolved, src, tgt);
     }
 
     // ── Also fetch CSS background-image url() sources (item 386) ──────────────
@@ -2174,23 +2319,30 @@ export class BrowserApp implements App {
       if (_bgUrl && !this._bgImageMap.has(_bgUrl)) bgUrlSet.add(_bgUrl);
     }
     bgUrlSet.forEach(function(rawBgUrl) {
+      // Tiled at natural size, so decoded at natural size
+      var bgCached = getImageBitmap(rawBgUrl);
+      if (bgCached) { self._bgImageMap.set(rawBgUrl, bgCached); self._dirty = true; return; }
       var resolvedBg = self._resolveHref(rawBgUrl);
       pendingCount++;
+      // Placeholder until the bytes arrive and decode (keeps relayouts from refetching)
+      self._bgImageMap.set(rawBgUrl, null);
       (function(bgSrc: string) {
         os.fetchAsync(resolvedBg, function(resp: FetchResponse | null) {
           var bgDec: DecodedImage | null = null;
           if (resp && resp.status === 200) {
             var _bb = resp.body || [];
             var _b0 = _bb[0] ?? 0, _b1 = _bb[1] ?? 0;
-            if (_b0 === 0x89 && _b1 === 0x50) {
-              try { bgDec = decodePNG(new Uint8Array(_bb)); } catch (_e) {}
-            } else if (_b0 === 0xFF && _b1 === 0xD8) {
-              try { bgDec = decodeJPEG(new Uint8Array(_bb)); } catch (_e) {}
+            if ((_b0 === 0x89 && _b1 === 0x50) || (_b0 === 0xFF && _b1 === 0xD8)) {
+              imageDecodePool.decode(new Uint8Array(_bb), 0, 0, 0, function(img) {
+                if (img && img.data) storeImageBitmap(bgSrc, img.w, img.h, img.data);
+                self._bgImageMap.set(bgSrc, img);
+                self._dirty = true;
+              });
             } else {
               bgDec = decodeBMP(_bb);
+              self._bgImageMap.set(bgSrc, bgDec);
             }
           }
-          self._bgImageMap.set(bgSrc, bgDec);
           pendingCount--;
           if (pendingCount === 0) { self._imgsFetching = false; }
           self._dirty = true;
@@ -2266,8 +2418,10 @@ export class BrowserApp implements App {
     // Flush all browser-level caches (layout, style, fetch, image, etc.)
     flushAllCaches();
     flushCSSMatchCache();
-    // Also clear the local image cache for this tab
-    this._imgCache.clear();
+    // Also drop decoded bitmaps and this tab's failed-image list
+    flushImageCache();
+    this._imgFailed.clear();
+    this._imgNatural.clear();
     // Re-navigate from scratch
     this._startFetch(this._pageURL);
   }
@@ -0,0 +1,663 @@
+/**
+ * raster.ts — Shared scanline rasterizer for the browser's vector drawing
+ *
+ * Canvas2D (canvas2d.ts), SVG (svg.ts) and CSS gradients (gradient.ts) all
+ * draw through here:
+ *
+ *  - FlatPath        device-space polyline builder.  Quadratic and cubic
+ *                    Béziers are flattened with Wang's formula and arcs by
+ *                    their chord error, both to a tenth of a pixel, after
+ *                    the transform so the tolerance holds at any zoom
+ *  - ScanRasterizer  active-edge-table scan conversion with exact-area
+ *                    anti-aliasing: each row's edge pieces deposit signed
+ *                    cover and area into sparse cells, as FreeType's smooth
+ *                    rasterizer and stb_truetype do, and one left-to-right
+ *                    sweep over the touched cells yields coverage spans
+ *                    under the non-zero or even-odd rule
+ *  - strokePath      outlines a path as quads, joins and caps that the
+ *                    rasterizer fills non-zero, so overlaps never cancel
+ *  - blendSpans      source-over compositing of spans: kernel.spanBlend
+ *                    when present, else a JS loop with the same arithmetic
+ *  - rampLUT         256-entry gradient colour table for paint shaders
+ *
+ * Spans are Int32 quads [y, x, len, coverage 0-255], left to right within
+ * a row and rows top to bottom; a shader fills one source word per covered
+ * pixel in that order (paintSpans).  Cells are floats rather than
+ * FreeType's 24.8 fixed point — JS numbers make that the cheaper choice.
+ */
+
+declare var kernel: import('../../core/kernel.js').KernelAPI;
+
+export type FillRule = 'nonzero' | 'evenodd';
+export type LineJoin = 'miter' | 'round' | 'bevel';
+export type LineCap  = 'butt' | 'round' | 'square';
+
+/** 2-D affine [a, b, c, d, e, f]: x' = a·x + c·y + e, y' = b·x + d·y + f. */
+export type Affine = number[];
+
+/** Flattening tolerance, device pixels (chord sag stays under it). */
+var TOL = 0.1;
+/** Segment caps per Bézier and per arc. */
+var MAX_BEZIER_SEGS = 100;
+var MAX_ARC_SEGS    = 256;
+
+/** Segments for an arc of `sweep` radians and device radius r. */
+function arcSegments(r: number, sweep: number): number {
+  var step = r > TOL ? 2 * Math.acos(1 - TOL / r) : Math.PI / 2;
+  var n = Math.ceil(Math.abs(sweep) / step);
+  return n < 1 ? 1 : n > MAX_ARC_SEGS ? MAX_ARC_SEGS : n;
+}
+
+// ── FlatPath ──────────────────────────────────────────────────────────────────
+
+/**
+ * A path flattened to device-space polylines.  Coordinates passed in are in
+ * user space and go through the matrix given at construction.  Follows the
+ * canvas rules for current points: lineTo with no current point is a
+ * moveTo, and drawing after close() starts a new contour at the old start.
+ */
+export class FlatPath {
+  /** Device-space points, x/y interleaved. */
+  pts: number[] = [];
+  /** Point index where each contour starts. */
+  starts: number[] = [];
+  /** Whether each contour was closed explicitly (strokes join the ends). */
+  closed: boolean[] = [];
+
+  private _m: Affine | null;
+  private _scale: number;
+  private _state = 0;                 // 0 no current point, 1 open contour, 2 just closed
+  private _cx = 0; private _cy = 0;   // current point, user space
+  private _sx = 0; private _sy = 0;   // contour start, user space
+
+  constructor(m?: Affine | null) {
+    this._m = m && !(m[0] === 1 && m[1] === 0 && m[2] === 0 && m[3] === 1 && m[4] === 0 && m[5] === 0) ? m : null;
+    this._scale = m ? Math.sqrt(Math.max(m[0] * m[0] + m[1] * m[1], m[2] * m[2] + m[3] * m[3])) : 1;
+  }
+
+  get hasCurrentPoint(): boolean { return this._state !== 0; }
+  get currentX(): number { return this._cx; }
+  get currentY(): number { return this._cy; }
+
+  private _push(x: number, y: number): void {
+    var m = this._m;
+    if (m) this.pts.push(m[0] * x + m[2] * y + m[4], m[1] * x + m[3] * y + m[5]);
+    else this.pts.push(x, y);
+  }
+
+  /** Re-open after close(): the next segment starts a contour at the old start. */
+  private _reopen(): void {
+    if (this._state === 2) this.moveTo(this._sx, this._sy);
+  }
+
+  moveTo(x: number, y: number): void {
+    this.starts.push(this.pts.length >> 1);
+    this.closed.push(false);
+    this._push(x, y);
+    this._state = 1;
+    this._cx = this._sx = x;
+    this._cy = this._sy = y;
+  }
+
+  lineTo(x: number, y: number): void {
+    if (this._state === 0) { this.moveTo(x, y); return; }
+    this._reopen();
+    this._push(x, y);
+    this._cx = x; this._cy = y;
+  }
+
+  quadTo(x1: number, y1: number, x: number, y: number): void {
+    if (this._state === 0) this.moveTo(x1, y1);
+    this._reopen();
+    var p = this.pts, i = p.length - 2;
+    var x0 = p[i], y0 = p[i + 1];
+    this._push(x1, y1); this._push(x, y);
+    var dx1 = p[i + 2], dy1 = p[i + 3], dx2 = p[i + 4], dy2 = p[i + 5];
+    p.length = i + 2;
+    // Wang's formula, degree 2: n = sqrt(2·1/8 · |P0 − 2P1 + P2| / tol)
+    var ddx = x0 - 2 * dx1 + dx2, ddy = y0 - 2 * dy1 + dy2;
+    var n = Math.ceil(Math.sqrt(0.25 * Math.sqrt(ddx * ddx + ddy * ddy) / TOL));
+    if (n > MAX_BEZIER_SEGS) n = MAX_BEZIER_SEGS;
+    for (var k = 1; k < n; k++) {
+      var t = k / n, mt = 1 - t;
+      var a = mt * mt, b = 2 * mt * t, c = t * t;
+      p.push(a * x0 + b * dx1 + c * dx2, a * y0 + b * dy1 + c * dy2);
+    }
+    p.push(dx2, dy2);
+    this._cx = x; this._cy = y;
+  }
+
+  cubicTo(x1: number, y1: number, x2: number, y2: number, x: number, y: number): void {
+    if (this._state === 0) this.moveTo(x1, y1);
+    this._reopen();
+    var p = this.pts, i = p.length - 2;
+    var x0 = p[i], y0 = p[i + 1];
+    this._push(x1, y1); this._push(x2, y2); this._push(x, y);
+    var ax = p[i + 2], ay = p[i + 3], bx = p[i + 4], by = p[i + 5], ex = p[i + 6], ey = p[i + 7];
+    p.length = i + 2;
+    // Wang's formula, degree 3: n = sqrt(3·2/8 · max|second difference| / tol)
+    var d1x = x0 - 2 * ax + bx, d1y = y0 - 2 * ay + by;
+    var d2x = ax - 2 * bx + ex, d2y = ay - 2 * by + ey;
+    var dd = Math.max(Math.sqrt(d1x * d1x + d1y * d1y), Math.sqrt(d2x * d2x + d2y * d2y));
+    var n = Math.ceil(Math.sqrt(0.75 * dd / TOL));
+    if (n > MAX_BEZIER_SEGS) n = MAX_BEZIER_SEGS;
+    for (var k = 1; k < n; k++) {
+      var t = k / n, mt = 1 - t;
+      var a = mt * mt * mt, b = 3 * mt * mt * t, c = 3 * mt * t * t, d = t * t * t;
+      p.push(a * x0 + b * ax + c * bx + d * ex, a * y0 + b * ay + c * by + d * ey);
+    }
+    p.push(ex, ey);
+    this._cx = x; this._cy = y;
+  }
+
+  close(): void {
+    if (this._state !== 1) return;
+    this.closed[this.closed.length - 1] = true;
+    this._state = 2;
+    this._cx = this._sx; this._cy = this._sy;
+  }
+
+  rect(x: number, y: number, w: number, h: number): void {
+    this.moveTo(x, y); this.lineTo(x + w, y); this.lineTo(x + w, y + h); this.lineTo(x, y + h);
+    this.close();
+  }
+
+  /**
+   * Canvas ellipse(): centre, radii, rotation, start/end angle and
+   * direction.  The current point is joined to the arc's start by a line.
+   */
+  ellipse(cx: number, cy: number, rx: number, ry: number, rot: number,
+          a0: number, a1: number, ccw: boolean): void {
+    var TAU = 2 * Math.PI, sweep = a1 - a0;
+    if (!ccw && sweep >= TAU) sweep = TAU;
+    else if (ccw && -sweep >= TAU) sweep = -TAU;
+    else {
+      sweep %= TAU;
+      if (!ccw && sweep < 0) sweep += TAU;
+      if (ccw && sweep > 0) sweep -= TAU;
+    }
+    var cr = Math.cos(rot), sr = Math.sin(rot);
+    var c0 = Math.cos(a0), s0 = Math.sin(a0);
+    this.lineTo(cx + rx * c0 * cr - ry * s0 * sr, cy + rx * c0 * sr + ry * s0 * cr);
+    this._arc(cx, cy, rx, ry, cr, sr, a0, sweep);
+  }
+
+  /** SVG elliptical arc from the current point to (x, y) (SVG 1.1 F.6.5). */
+  svgArc(rx: number, ry: number, xrotDeg: number, large: boolean, sweep: boolean,
+         x: number, y: number): void {
+    var x1 = this._cx, y1 = this._cy;
+    if (this._state === 0) { this.moveTo(x, y); return; }
+    if (x1 === x && y1 === y) return;
+    rx = Math.abs(rx); ry = Math.abs(ry);
+    if (rx === 0 || ry === 0) { this.lineTo(x, y); return; }
+    var phi = xrotDeg * Math.PI / 180, cp = Math.cos(phi), sp = Math.sin(phi);
+    var hx = (x1 - x) / 2, hy = (y1 - y) / 2;
+    var x1p = cp * hx + sp * hy, y1p = -sp * hx + cp * hy;
+    var lam = (x1p * x1p) / (rx * rx) + (y1p * y1p) / (ry * ry);
+    if (lam > 1) { var sl = Math.sqrt(lam); rx *= sl; ry *= sl; }
+    var rx2 = rx * rx, ry2 = ry * ry;
+    var den = rx2 * y1p * y1p + ry2 * x1p * x1p;
+    var coef = den ? Math.sqrt(Math.max(0, (rx2 * ry2 - den) / den)) : 0;
+    if (large === sweep) coef = -coef;
+    var cxp = coef * rx * y1p / ry, cyp = -coef * ry * x1p / rx;
+    var cx = cp * cxp - sp * cyp + (x1 + x) / 2;
+    var cy = sp * cxp + cp * cyp + (y1 + y) / 2;
+    var ux = (x1p - cxp) / rx, uy = (y1p - cyp) / ry;
+    var vx = (-x1p - cxp) / rx, vy = (-y1p - cyp) / ry;
+    var t0 = Math.atan2(uy, ux);
+    var dt = Math.atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+    if (!sweep && dt > 0) dt -= 2 * Math.PI;
+    else if (sweep && dt < 0) dt += 2 * Math.PI;
+    this._reopen();
+    this._arc(cx, cy, rx, ry, cp, sp, t0, dt);
+    // Land exactly on the endpoint so following relative commands line up
+    var p = this.pts;
+    p.length -= 2;
+    this._push(x, y);
+    this._cx = x; this._cy = y;
+  }
+
+  /** Arc points after the start, angles t0 .. t0 + dt. */
+  private _arc(cx: number, cy: number, rx: number, ry: number, cr: number, sr: number,
+               t0: number, dt: number): void {
+    var n = arcSegments(Math.max(rx, ry) * this._scale, dt);
+    var x = 0, y = 0;
+    for (var k = 1; k <= n; k++) {
+      var t = t0 + dt * k / n, ct = Math.cos(t), st = Math.sin(t);
+      x = cx + rx * ct * cr - ry * st * sr;
+      y = cy + rx * ct * sr + ry * st * cr;
+      this._push(x, y);
+    }
+    this._cx = x; this._cy = y;
+  }
+}
+
+// ── Spans ─────────────────────────────────────────────────────────────────────
+
+/** Growable list of [y, x, len, coverage] spans. */
+export class SpanBuffer {
+  data = new Int32Array(1024);
+  count = 0;
+
+  reset(): void { this.count = 0; }
+
+  push(y: number, x: number, len: number, cov: number): void {
+    var d = this.data, i = this.count * 4;
+    // Merge with the previous span when it ends here at the same coverage
+    if (i && d[i - 4] === y && d[i - 3] + d[i - 2] === x && d[i - 1] === cov) { d[i - 2] += len; return; }
+    if (i + 4 > d.length) {
+      var nd = new Int32Array(d.length * 2);
+      nd.set(d);
+      this.data = d = nd;
+    }
+    d[i] = y; d[i + 1] = x; d[i + 2] = len; d[i + 3] = cov;
+    this.count++;
+  }
+
+  /** Covered pixels, i.e. the paint words a shader must supply. */
+  pixels(): number {
+    var n = 0, d = this.data;
+    for (var i = 0; i < this.count; i++) n += d[i * 4 + 2];
+    return n;
+  }
+}
+
+// ── ScanRasterizer ────────────────────────────────────────────────────────────
+
+function coverage(v: number, evenOdd: boolean): number {
+  if (v < 0) v = -v;
+  if (evenOdd) { v %= 2; if (v > 1) v = 2 - v; }
+  else if (v > 1) v = 1;
+  return (v * 255 + 0.5) | 0;
+}
+
+/**
+ * Scan converter for a width × height surface.  Add edges with addPath /
+ * addPoly, then sweep() once to turn them into spans; the edge list is
+ * cleared by the sweep so the rasterizer can be reused.
+ */
+export class ScanRasterizer {
+  readonly width:  number;
+  readonly height: number;
+
+  /** x0, y0, x1, y1, dx/dy, direction per edge, y0 < y1. */
+  private _edges: number[] = [];
+  private _minY = Infinity;
+  private _maxY = -Infinity;
+
+  /** Per-row cell accumulators; cell `width` catches pieces at the right edge. */
+  private _cover: Float64Array;
+  private _area:  Float64Array;
+  private _mark:  Uint8Array;
+  private _cells: Int32Array;
+  private _ncells = 0;
+
+  constructor(width: number, height: number) {
+    this.width  = width;
+    this.height = height;
+    this._cover = new Float64Array(width + 1);
+    this._area  = new Float64Array(width + 1);
+    this._mark  = new Uint8Array(width + 1);
+    this._cells = new Int32Array(width + 1);
+  }
+
+  get empty(): boolean { return this._edges.length === 0; }
+
+  reset(): void {
+    this._edges.length = 0;
+    this._minY = Infinity;
+    this._maxY = -Infinity;
+  }
+
+  addEdge(x0: number, y0: number, x1: number, y1: number): void {
+    if (y0 === y1 || !isFinite(x0 + y0 + x1 + y1)) return;   // horizontal, NaN or infinite
+    var dir = 1;
+    if (y0 > y1) { var t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; dir = -1; }
+    this._edges.push(x0, y0, x1, y1, (x1 - x0) / (y1 - y0), dir);
+    if (y0 < this._minY) this._minY = y0;
+    if (y1 > this._maxY) this._maxY = y1;
+  }
+
+  /** Closed polygon, device-space x/y pairs. */
+  addPoly(p: number[]): void {
+    var n = p.length;
+    if (n < 6) return;
+    for (var i = 0; i < n; i += 2) {
+      var j = i + 2 < n ? i + 2 : 0;
+      this.addEdge(p[i], p[i + 1], p[j], p[j + 1]);
+    }
+  }
+
+  /** Every contour of `path`, each implicitly closed as fills require. */
+  addPath(path: FlatPath): void {
+    var p = path.pts, starts = path.starts, total = p.length >> 1;
+    for (var c = 0; c < starts.length; c++) {
+      var a = starts[c], b = c + 1 < starts.length ? starts[c + 1] : total;
+      if (b - a < 2) continue;
+      for (var i = a; i < b; i++) {
+        var j = i + 1 < b ? i + 1 : a;
+        this.addEdge(p[i * 2], p[i * 2 + 1], p[j * 2], p[j * 2 + 1]);
+      }
+    }
+  }
+
+  /** Scan-convert the edges added so far into `out` (appended). */
+  sweep(rule: FillRule, out: SpanBuffer): void {
+    var E = this._edges, ne = E.length / 6;
+    if (!ne) return;
+    var evenOdd = rule === 'evenodd';
+    var order: number[] = [];
+    for (var i = 0; i < ne; i++) order.push(i * 6);
+    order.sort(function(a, b) { return E[a + 1] - E[b + 1]; });
+
+    var y = Math.max(0, Math.floor(this._minY));
+    var yEnd = Math.min(this.height, Math.ceil(this._maxY));
+    var next = 0;
+    var active: number[] = [];
+    for (; y < yEnd; y++) {
+      var yb = y + 1;
+      while (next < ne && E[order[next] + 1] < yb) active.push(order[next++]);
+      var k = 0;
+      for (var ai = 0; ai < active.length; ai++) {
+        var e = active[ai];
+        var ey0 = E[e + 1], ey1 = E[e + 3];
+        if (ey1 <= y) continue;             // finished: drop from the table
+        active[k++] = e;
+        var t0 = ey0 > y ? ey0 : y, t1 = ey1 < yb ? ey1 : yb;
+        if (t1 <= t0) continue;
+        var xa = E[e] + (t0 - ey0) * E[e + 4];
+        var xb = E[e] + (t1 - ey0) * E[e + 4];
+        this._line(xa, t0 - y, xb, t1 - y, E[e + 5]);
+      }
+      active.length = k;
+      if (this._ncells) this._emitRow(y, evenOdd, out);
+    }
+    // Rows past the surface never swept: clear what the last row left
+    this.reset();
+  }
+
+  /**
+   * One edge piece inside a pixel row (y in 0..1).  Pieces left of the
+   * surface act at x = 0 and those right of it are dropped, which keeps
+   * the winding of everything visible intact.
+   */
+  private _line(x0: number, y0: number, x1: number, y1: number, dir: number): void {
+    var w = this.width;
+    if (x0 <= 0 && x1 <= 0) { this._piece(0, y0, 0, y1, dir); return; }
+    if (x0 >= w && x1 >= w) return;
+    if ((x0 < 0) !== (x1 < 0)) {
+      var ym = y0 + (0 - x0) * (y1 - y0) / (x1 - x0);
+      this._line(x0, y0, 0, ym, dir); this._line(0, ym, x1, y1, dir);
+      return;
+    }
+    if ((x0 > w) !== (x1 > w)) {
+      var yw = y0 + (w - x0) * (y1 - y0) / (x1 - x0);
+      this._line(x0, y0, w, yw, dir); this._line(w, yw, x1, y1, dir);
+      return;
+    }
+    // Split at every pixel boundary the piece crosses
+    var xa = x0, ya = y0, b: number;
+    if (x1 > x0) {
+      var sr = (y1 - y0) / (x1 - x0);
+      for (b = Math.floor(x0) + 1; b < x1; b++) {
+        var yr = y0 + (b - x0) * sr;
+        this._piece(xa, ya, b, yr, dir); xa = b; ya = yr;
+      }
+    } else if (x1 < x0) {
+      var sl = (y1 - y0) / (x1 - x0);
+      for (b = Math.ceil(x0) - 1; b > x1; b--) {
+        var yl = y0 + (b - x0) * sl;
+        this._piece(xa, ya, b, yl, dir); xa = b; ya = yl;
+      }
+    }
+    this._piece(xa, ya, x1, y1, dir);
+  }
+
+  /** Deposit a piece lying within one cell: cover is its signed height,
+   *  area that height times the fraction of the cell left of it. */
+  private _piece(xa: number, ya: number, xb: number, yb: number, dir: number): void {
+    var c = Math.floor((xa + xb) * 0.5);
+    if (c >= this.width) return;
+    var d = (yb - ya) * dir;
+    if (d === 0) return;
+    this._cover[c] += d;
+    this._area[c]  += d * (xa + xb - 2 * c) * 0.5;
+    if (!this._mark[c]) { this._mark[c] = 1; this._cells[this._ncells++] = c; }
+  }
+
+  private _emitRow(y: number, evenOdd: boolean, out: SpanBuffer): void {
+    var cells = this._cells.subarray(0, this._ncells).sort();
+    var cover = this._cover, area = this._area, mark = this._mark;
+    var acc = 0, x = 0, cov: number;
+    for (var i = 0; i < cells.length; i++) {
+      var c = cells[i];
+      if (c > x && (cov = coverage(acc, evenOdd))) out.push(y, x, c - x, cov);
+      if ((cov = coverage(acc + cover[c] - area[c], evenOdd))) out.push(y, c, 1, cov);
+      acc += cover[c];
+      cover[c] = 0; area[c] = 0; mark[c] = 0;
+      x = c + 1;
+    }
+    // Shapes running off the right edge leave the run open
+    if (x < this.width && (cov = coverage(acc, evenOdd))) out.push(y, x, this.width - x, cov);
+    this._ncells = 0;
+  }
+}
+
+/** Spans as a width × height coverage mask, multiplied into `prev` if given. */
+export function spansToMask(spans: SpanBuffer, width: number, height: number,
+                            prev: Uint8Array | null): Uint8Array {
+  var m = new Uint8Array(width * height), d = spans.data;
+  for (var i = 0; i < spans.count; i++) {
+    var base = d[i * 4] * width + d[i * 4 + 1], end = base + d[i * 4 + 2], cov = d[i * 4 + 3];
+    if (!prev) { m.fill(cov, base, end); continue; }
+    for (var p = base; p < end; p++) m[p] = ((cov * prev[p] + 127) / 255) | 0;
+  }
+  return m;
+}
+
+// ── Stroking ──────────────────────────────────────────────────────────────────
+
+/** Add `poly` with negative orientation so every stroke piece winds alike. */
+function addOriented(ras: ScanRasterizer, poly: number[]): void {
+  var n = poly.length, area = 0;
+  for (var i = 0; i < n; i += 2) {
+    var j = i + 2 < n ? i + 2 : 0;
+    area += poly[i] * poly[j + 1] - poly[j] * poly[i + 1];
+  }
+  if (area > 0) {
+    var r: number[] = [];
+    for (var k = n - 2; k >= 0; k -= 2) r.push(poly[k], poly[k + 1]);
+    poly = r;
+  }
+  ras.addPoly(poly);
+}
+
+function addDisc(ras: ScanRasterizer, x: number, y: number, r: number): void {
+  var n = arcSegments(r, 2 * Math.PI);
+  if (n < 8) n = 8;
+  var poly: number[] = [];
+  for (var k = 0; k < n; k++) {
+    var t = -2 * Math.PI * k / n;
+    poly.push(x + r * Math.cos(t), y + r * Math.sin(t));
+  }
+  ras.addPoly(poly);
+}
+
+/**
+ * Add the outline of `path` stroked with half-width `hw` (device pixels)
+ * to `ras`; sweep it with 'nonzero'.  Every piece is emitted with the same
+ * orientation, so overlapping segments and joins add up instead of
+ * cancelling.  Closed contours are joined end to start; open ones get caps.
+ */
+export function strokePath(path: FlatPath, ras: ScanRasterizer, hw: number,
+                           join: LineJoin, cap: LineCap, miterLimit: number): void {
+  if (!(hw > 0)) return;
+  var src = path.pts, starts = path.starts, total = src.length >> 1;
+  for (var ci = 0; ci < starts.length; ci++) {
+    var a = starts[ci], b = ci + 1 < starts.length ? starts[ci + 1] : total;
+    var closed = path.closed[ci];
+    // Drop repeated points; they have no direction
+    var P: number[] = [];
+    for (var i = a; i < b; i++) {
+      var px = src[i * 2], py = src[i * 2 + 1], m = P.length;
+      if (m && Math.abs(P[m - 2] - px) < 1e-6 && Math.abs(P[m - 1] - py) < 1e-6) continue;
+      P.push(px, py);
+    }
+    var n = P.length >> 1;
+    if (closed && n > 1 && Math.abs(P[0] - P[n * 2 - 2]) < 1e-6 && Math.abs(P[1] - P[n * 2 - 1]) < 1e-6) {
+      P.length -= 2; n--;
+    }
+    if (n < 2) {
+      // Zero-length subpath: only round and square caps draw anything
+      if (n === 1 && b - a > 1) {
+        if (cap === 'round') addDisc(ras, P[0], P[1], hw);
+        else if (cap === 'square') addOriented(ras, [P[0] - hw, P[1] - hw, P[0] + hw, P[1] - hw, P[0] + hw, P[1] + hw, P[0] - hw, P[1] + hw]);
+      }
+      continue;
+    }
+    var segs = closed ? n : n - 1;
+    for (var s = 0; s < segs; s++) {
+      var s1 = (s + 1) % n;
+      var x0 = P[s * 2], y0 = P[s * 2 + 1], x1 = P[s1 * 2], y1 = P[s1 * 2 + 1];
+      var dx = x1 - x0, dy = y1 - y0, len = Math.sqrt(dx * dx + dy * dy);
+      dx /= len; dy /= len;
+      if (!closed && cap === 'square') {
+        if (s === 0)        { x0 -= dx * hw; y0 -= dy * hw; }
+        if (s === segs - 1) { x1 += dx * hw; y1 += dy * hw; }
+      }
+      var nx = -dy * hw, ny = dx * hw;
+      addOriented(ras, [x0 + nx, y0 + ny, x1 + nx, y1 + ny, x1 - nx, y1 - ny, x0 - nx, y0 - ny]);
+    }
+    // Joins at interior vertices (every vertex of a closed contour)
+    for (var v = closed ? 0 : 1; v < (closed ? n : n - 1); v++) {
+      var pv = (v + n - 1) % n, nv = (v + 1) % n;
+      var vx = P[v * 2], vy = P[v * 2 + 1];
+      var ax = vx - P[pv * 2], ay = vy - P[pv * 2 + 1];
+      var bx = P[nv * 2] - vx, by = P[nv * 2 + 1] - vy;
+      var la = Math.sqrt(ax * ax + ay * ay), lb = Math.sqrt(bx * bx + by * by);
+      ax /= la; ay /= la; bx /= lb; by /= lb;
+      var cross = ax * by - ay * bx, dot = ax * bx + ay * by;
+      // Nearly straight: the segment quads already meet
+      if (dot > 0 && Math.abs(cross) * hw < 0.05) continue;
+      if (join === 'round') { addDisc(ras, vx, vy, hw); continue; }
+      var sg = cross > 0 ? -hw : hw;       // outer side of the turn
+      var o0x = vx - ay * sg, o0y = vy + ax * sg;
+      var o1x = vx - by * sg, o1y = vy + bx * sg;
+      if (join === 'miter' && dot > -0.9999 && 1 / Math.sqrt((1 + dot) / 2) <= miterLimit) {
+        var k = sg / (1 + dot);
+        addOriented(ras, [vx, vy, o0x, o0y, vx - (ay + by) * k, vy + (ax + bx) * k, o1x, o1y]);
+      } else {
+        addOriented(ras, [vx, vy, o0x, o0y, o1x, o1y]);
+      }
+    }
+    if (!closed && cap === 'round') {
+      addDisc(ras, P[0], P[1], hw);
+      addDisc(ras, P[n * 2 - 2], P[n * 2 - 1], hw);
+    }
+  }
+}
+
+// ── Compositing ───────────────────────────────────────────────────────────────
+
+/** Straight-alpha source-over of `rgb` at alpha sa (1-255) onto d. */
+function blendPx(d: number, rgb: number, sa: number): number {
+  if (sa === 255) return (rgb | 0xFF000000) >>> 0;
+  var da = d >>> 24, ia = 255 - sa, out = 0, sh: number;
+  if (da === 255) {
+    for (sh = 0; sh < 24; sh += 8)
+      out |= ((((rgb >>> sh) & 255) * sa + ((d >>> sh) & 255) * ia + 127) / 255 | 0) << sh;
+    return (out | 0xFF000000) >>> 0;
+  }
+  var t = da * ia, o = sa * 255 + t;
+  for (sh = 0; sh < 24; sh += 8)
+    out |= ((((rgb >>> sh) & 255) * sa * 255 + ((d >>> sh) & 255) * t + (o >>> 1)) / o | 0) << sh;
+  return (out | (((o + 127) / 255 | 0) << 24)) >>> 0;
+}
+
+/**
+ * Source-over `spans` onto `dst` (width pixels per row, alpha in the top
+ * byte, other channels in whatever order the source uses).  The source is
+ * `color`, or `paint` with one word per covered pixel in span order; `mask`
+ * scales coverage per pixel.
+ */
+export function blendSpans(dst: Uint32Array, width: number, spans: SpanBuffer, color: number,
+                           paint?: Uint32Array | null, mask?: Uint8Array | null): void {
+  var count = spans.count;
+  if (!count) return;
+  if (typeof kernel !== 'undefined' && kernel.spanBlend) {
+    kernel.spanBlend(dst, width, spans.data, count, color >>> 0, paint || null, mask || null);
+    return;
+  }
+  var d = spans.data, ca = color >>> 24, crgb = color & 0xFFFFFF, pi = 0;
+  for (var i = 0; i < count; i++) {
+    var base = d[i * 4] * width + d[i * 4 + 1], len = d[i * 4 + 2], cov = d[i * 4 + 3];
+    var x: number, sa: number;
+    if (!paint && !mask) {
+      sa = (ca * cov + 127) / 255 | 0;
+      if (!sa) continue;
+      if (sa === 255) { dst.fill((crgb | 0xFF000000) >>> 0, base, base + len); continue; }
+      for (x = base; x < base + len; x++) dst[x] = blendPx(dst[x], crgb, sa);
+      continue;
+    }
+    for (x = base; x < base + len; x++) {
+      var s = paint ? paint[pi++] : color, c = cov;
+      if (mask) c = (c * mask[x] + 127) / 255 | 0;
+      sa = (s >>> 24) * c + 127;
+      sa = sa / 255 | 0;
+      if (sa) dst[x] = blendPx(dst[x], s & 0xFFFFFF, sa);
+    }
+  }
+}
+
+/**
+ * Paint buffer for `spans`: shade(y, x, len, out, off) writes len source
+ * words for the run starting at (x, y) into out[off ..].
+ */
+export function paintSpans(spans: SpanBuffer,
+                           shade: (y: number, x: number, len: number, out: Uint32Array, off: number) => void): Uint32Array {
+  var out = new Uint32Array(spans.pixels()), d = spans.data, off = 0;
+  for (var i = 0; i < spans.count; i++) {
+    shade(d[i * 4], d[i * 4 + 1], d[i * 4 + 2], out, off);
+    off += d[i * 4 + 2];
+  }
+  return out;
+}
+
+// ── Gradients ─────────────────────────────────────────────────────────────────
+
+export interface RampStop { pos: number; color: number; }   // color ARGB, pos 0..1
+
+/**
+ * 256-entry ARGB colour table for stops in order, colours interpolated per
+ * channel, alpha scaled by `opacity`.  A stop placed before an earlier one
+ * moves up to it, as in CSS.  Shaders index it with (t · 255 + 0.5) | 0.
+ */
+export function rampLUT(stops: RampStop[], opacity = 1): Uint32Array {
+  var lut = new Uint32Array(256), n = stops.length;
+  if (!n) return lut;
+  var fixed: RampStop[] = [];
+  for (var s = 0; s < n; s++) {
+    var pos = s && stops[s].pos < fixed[s - 1].pos ? fixed[s - 1].pos : stops[s].pos;
+    fixed.push({ pos: pos, color: stops[s].color });
+  }
+  stops = fixed;
+  var j = 0;
+  for (var i = 0; i < 256; i++) {
+    var t = i / 255, c: number;
+    if (t <= stops[0].pos) c = stops[0].color;
+    else if (t >= stops[n - 1].pos) c = stops[n - 1].color;
+    else {
+      while (j < n - 2 && stops[j + 1].pos < t) j++;
+      var a = stops[j], b = stops[j + 1];
+      var f = (t - a.pos) / (b.pos - a.pos || 1);
+      c = 0;
+      for (var sh = 0; sh < 32; sh += 8) {
+        var ca = (a.color >>> sh) & 255, cb = (b.color >>> sh) & 255;
+        c |= Math.round(ca + (cb - ca) * f) << sh;
+      }
+    }
+    if (opacity < 1) c = (c & 0xFFFFFF) | (Math.round((c >>> 24) * opacity) << 24);
+    lut[i] = c >>> 0;
+  }
+  return lut;
+}
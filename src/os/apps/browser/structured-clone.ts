@@ -0,0 +1,308 @@
+/**
+ * structured-clone.ts — binary structured clone for postMessage
+ *
+ * The wire format behind Worker, MessagePort and BroadcastChannel messages.
+ * It replaces the JSON round trip, which dropped typed arrays, Maps, Sets,
+ * Dates, undefined and NaN, and broke on shared or cyclic references.
+ *
+ * Layout (little-endian):
+ *   u32      magic "SC" + version
+ *   u32      n, the number of transferred ArrayBuffers
+ *   n × i32  transfer ids; -1 = the buffer could not be moved and is copied
+ *            into the inline section instead
+ *   u32      inline section size, then u32 length + bytes per copied buffer
+ *   value    one tagged value, depth first
+ *
+ * Each object takes the next reference number when first written, so a
+ * repeated object (shared subtree or cycle) is written as a REF, and views
+ * keep sharing their buffer.  Transferred buffers are written as XFER slots.
+ * `move` hands them over only after the whole value encoded, so a failed
+ * clone never detaches anything.  Between runtimes, `move` is
+ * kernel.bufferTransfer; the bytes then never pass through the IPC ring.
+ *
+ * cloneCodec() refers to nothing outside itself.  The worker bootstrap ships
+ * it to the child runtime with toString(), as the decode pool does with the
+ * image codecs.
+ */
+
+export interface CloneCodec {
+  /**
+   * Serialise `value`.  ArrayBuffers listed in `transfer` go to `move`
+   * once encoding succeeded; it returns the id `accept` gets on the other
+   * side, or -1 to copy the bytes after all.  Functions, symbols and other
+   * uncloneable values throw an Error named DataCloneError.
+   */
+  encode(value: unknown, transfer?: unknown[] | null,
+         move?: ((ab: ArrayBuffer) => number) | null): Uint8Array;
+  /** Rebuild a value; `accept` claims each transferred buffer by id. */
+  decode(bytes: ArrayBuffer | Uint8Array, accept?: ((id: number) => ArrayBuffer | null) | null): unknown;
+}
+
+export function cloneCodec(): CloneCodec {
+  var MAGIC = 0x00014353;   // "SC" v1
+  var T_UNDEF = 0, T_NULL = 1, T_FALSE = 2, T_TRUE = 3, T_INT = 4, T_NUM = 5,
+      T_STR8 = 6, T_STR16 = 7, T_BIGINT = 8, T_REF = 9, T_ARRAY = 10, T_HOLE = 11,
+      T_OBJECT = 12, T_MAP = 13, T_SET = 14, T_DATE = 15, T_REGEXP = 16,
+      T_BUFFER = 17, T_XFER = 18, T_VIEW = 19, T_ERROR = 20, T_BOXED = 21;
+  // View constructors by wire index; DataView last (its length is in bytes)
+  var VIEWS: any[] = [Int8Array, Uint8Array, Uint8ClampedArray, Int16Array, Uint16Array,
+                      Int32Array, Uint32Array, Float32Array, Float64Array,
+                      typeof BigInt64Array !== 'undefined' ? BigInt64Array : null,
+                      typeof BigUint64Array !== 'undefined' ? BigUint64Array : null, DataView];
+  var DATAVIEW = VIEWS.length - 1;
+  // Child runtimes replace Date with a bare { now } object; dates decode to ms there
+  var DATE: any = typeof Date === 'function' ? Date : null;
+  var ERRORS: { [name: string]: any } = {
+    Error: Error, EvalError: EvalError, RangeError: RangeError, ReferenceError: ReferenceError,
+    SyntaxError: SyntaxError, TypeError: TypeError, URIError: URIError,
+  };
+
+  function cloneError(what: string): Error {
+    var e = new Error(what + ' could not be cloned');
+    e.name = 'DataCloneError';
+    return e;
+  }
+
+  function encode(value: unknown, transfer?: unknown[] | null,
+                  move?: ((ab: ArrayBuffer) => number) | null): Uint8Array {
+    var slots = new Map<ArrayBuffer, number>(), xfer: ArrayBuffer[] = [];
+    if (transfer) {
+      for (var i = 0; i < transfer.length; i++) {
+        var t = transfer[i];
+        if (t instanceof ArrayBuffer && !slots.has(t)) { slots.set(t, xfer.length); xfer.push(t); }
+      }
+    }
+    var head = 12 + 4 * xfer.length;
+    var out = new Uint8Array(Math.max(256, head * 2)), dv = new DataView(out.buffer), pos = head;
+    var refs = new Map<unknown, number>(), nref = 0;
+
+    function room(n: number): void {
+      if (pos + n <= out.length) return;
+      var cap = out.length * 2;
+      while (cap < pos + n) cap *= 2;
+      var o2 = new Uint8Array(cap);
+      o2.set(out.subarray(0, pos));
+      out = o2; dv = new DataView(out.buffer);
+    }
+    function u8(v: number): void { room(1); out[pos++] = v; }
+    function u32(v: number): void { room(4); dv.setUint32(pos, v, true); pos += 4; }
+    function str(s: string): void {
+      var n = s.length, j = 0;
+      while (j < n && s.charCodeAt(j) < 0x100) j++;
+      if (j === n) {
+        room(5 + n);
+        out[pos] = T_STR8; dv.setUint32(pos + 1, n, true); pos += 5;
+        for (j = 0; j < n; j++) out[pos++] = s.charCodeAt(j);
+      } else {
+        room(5 + 2 * n);
+        out[pos] = T_STR16; dv.setUint32(pos + 1, n, true); pos += 5;
+        for (j = 0; j < n; j++) { dv.setUint16(pos, s.charCodeAt(j), true); pos += 2; }
+      }
+    }
+
+    function val(v: any): void {
+      switch (typeof v) {
+        case 'undefined': u8(T_UNDEF); return;
+        case 'boolean':   u8(v ? T_TRUE : T_FALSE); return;
+        case 'number':
+          room(9);
+          if ((v | 0) === v && (v !== 0 || 1 / v > 0)) { out[pos] = T_INT; dv.setInt32(pos + 1, v, true); pos += 5; }
+          else { out[pos] = T_NUM; dv.setFloat64(pos + 1, v, true); pos += 9; }
+          return;
+        case 'string':    str(v); return;
+        case 'bigint':    u8(T_BIGINT); str(v.toString()); return;
+        case 'object':    break;
+        default:          throw cloneError(typeof v);   // function, symbol
+      }
+      if (v === null) { u8(T_NULL); return; }
+      var r = refs.get(v);
+      if (r !== undefined) { u8(T_REF); u32(r); return; }
+      refs.set(v, nref++);
+
+      if (Array.isArray(v)) {
+        u8(T_ARRAY); u32(v.length);
+        for (var k = 0; k < v.length; k++) { if (k in v) val(v[k]); else u8(T_HOLE); }
+      } else if (v instanceof ArrayBuffer) {
+        var slot = slots.get(v);
+        if (slot !== undefined) { u8(T_XFER); u32(slot); return; }
+        var n = v.byteLength;
+        room(5 + n);
+        out[pos] = T_BUFFER; dv.setUint32(pos + 1, n, true); pos += 5;
+        out.set(new Uint8Array(v), pos); pos += n;
+      } else if (ArrayBuffer.isView(v)) {
+        var kind = -1;
+        for (var q = 0; q < VIEWS.length && kind < 0; q++) if (VIEWS[q] && v instanceof VIEWS[q]) kind = q;
+        if (kind < 0) throw cloneError('view');
+        u8(T_VIEW); u8(kind);
+        val(v.buffer);
+        u32(v.byteOffset);
+        u32(kind === DATAVIEW ? v.byteLength : (v as any).length);
+      } else if (v instanceof Map) {
+        u8(T_MAP); u32(v.size);
+        v.forEach(function(x: unknown, key: unknown) { val(key); val(x); });
+      } else if (v instanceof Set) {
+        u8(T_SET); u32(v.size);
+        v.forEach(function(x: unknown) { val(x); });
+      } else if (DATE && v instanceof DATE) {
+        room(9); out[pos] = T_DATE; dv.setFloat64(pos + 1, v.getTime(), true); pos += 9;
+      } else if (v instanceof RegExp) {
+        u8(T_REGEXP); str(v.source); str(v.flags);
+      } else if (v instanceof Error) {
+        u8(T_ERROR); str(String(v.name)); str(String(v.message)); str(v.stack ? String(v.stack) : '');
+      } else if (v instanceof Boolean || v instanceof Number || v instanceof String) {
+        u8(T_BOXED); val(v.valueOf());
+      } else if (v instanceof WeakMap || v instanceof WeakSet || v instanceof Promise) {
+        throw cloneError(Object.prototype.toString.call(v));
+      } else {
+        // Any other object clones as its own enumerable string keys
+        var keys = Object.keys(v);
+        u8(T_OBJECT); u32(keys.length);
+        for (var m = 0; m < keys.length; m++) { str(keys[m]); val(v[keys[m]]); }
+      }
+    }
+
+    val(value);
+
+    // Hand the transfer list over; whatever cannot move is copied inline
+    var ids: number[] = [], copied: ArrayBuffer[] = [], inl = 0;
+    for (var x = 0; x < xfer.length; x++) {
+      var id = move ? move(xfer[x]) : -1;
+      ids.push(id);
+      if (id < 0) { copied.push(xfer[x]); inl += 4 + xfer[x].byteLength; }
+    }
+    var res = out, body = head;
+    if (inl) {
+      res = new Uint8Array(pos + inl);
+      body = head + inl;
+      res.set(out.subarray(head, pos), body);
+      dv = new DataView(res.buffer);
+      var p = head;
+      for (var c = 0; c < copied.length; c++) {
+        dv.setUint32(p, copied[c].byteLength, true);
+        res.set(new Uint8Array(copied[c]), p + 4);
+        p += 4 + copied[c].byteLength;
+      }
+    }
+    dv.setUint32(0, MAGIC, true);
+    dv.setUint32(4, ids.length, true);
+    for (var h = 0; h < ids.length; h++) dv.setInt32(8 + 4 * h, ids[h], true);
+    dv.setUint32(head - 4, inl, true);
+    return res.subarray(0, body + pos - head);
+  }
+
+  function decode(bytes: ArrayBuffer | Uint8Array, accept?: ((id: number) => ArrayBuffer | null) | null): unknown {
+    var u = bytes instanceof Uint8Array ? bytes : new Uint8Array(bytes);
+    var dv = new DataView(u.buffer, u.byteOffset, u.byteLength);
+    if (u.length < 12 || dv.getUint32(0, true) !== MAGIC) throw new Error('structured clone: bad data');
+    var n = dv.getUint32(4, true), pos = 8;
+    // Claim every transferred buffer up front, referenced or not
+    var bufs: ArrayBuffer[] = new Array(n), ids: number[] = new Array(n);
+    for (var i = 0; i < n; i++) { ids[i] = dv.getInt32(pos, true); pos += 4; }
+    var end = pos + 4 + dv.getUint32(pos, true);
+    pos += 4;
+    for (i = 0; i < n; i++) {
+      if (ids[i] >= 0) { bufs[i] = (accept && accept(ids[i])) || new ArrayBuffer(0); continue; }
+      var len = dv.getUint32(pos, true);
+      bufs[i] = u.slice(pos + 4, pos + 4 + len).buffer;
+      pos += 4 + len;
+    }
+    pos = end;
+    var objs: unknown[] = [];
+
+    function u32(): number { var v = dv.getUint32(pos, true); pos += 4; return v; }
+    function str(): string {
+      var wide = u[pos++] === T_STR16, cnt = u32(), parts: string[] = [];
+      // fromCharCode.apply in slices: QuickJS's C stack limits argument count
+      var chunk: number[] = [];
+      for (var j = 0; j < cnt; j++) {
+        if (wide) { chunk.push(dv.getUint16(pos, true)); pos += 2; }
+        else chunk.push(u[pos++]);
+        if (chunk.length === 256) { parts.push(String.fromCharCode.apply(null, chunk)); chunk = []; }
+      }
+      if (chunk.length) parts.push(String.fromCharCode.apply(null, chunk));
+      return parts.join('');
+    }
+
+    function val(): any {
+      var t = u[pos];
+      if (t === T_STR8 || t === T_STR16) return str();
+      pos++;
+      switch (t) {
+        case T_UNDEF:  return undefined;
+        case T_NULL:   return null;
+        case T_FALSE:  return false;
+        case T_TRUE:   return true;
+        case T_INT:    pos += 4; return dv.getInt32(pos - 4, true);
+        case T_NUM:    pos += 8; return dv.getFloat64(pos - 8, true);
+        case T_BIGINT: return BigInt(str());
+        case T_REF:    return objs[u32()];
+      }
+      var o: any, k: number, cnt: number, slot = objs.length;
+      objs.push(null);
+      switch (t) {
+        case T_ARRAY:
+          cnt = u32();
+          o = objs[slot] = new Array(cnt);
+          for (k = 0; k < cnt; k++) {
+            if (u[pos] === T_HOLE) pos++;
+            else o[k] = val();
+          }
+          return o;
+        case T_OBJECT:
+          cnt = u32();
+          o = objs[slot] = {};
+          for (k = 0; k < cnt; k++) {
+            var key = str();
+            // Assigning an own "__proto__" would set the prototype instead
+            if (key === '__proto__') {
+              Object.defineProperty(o, key, { value: val(), writable: true, enumerable: true, configurable: true });
+            } else o[key] = val();
+          }
+          return o;
+        case T_MAP:
+          cnt = u32();
+          o = objs[slot] = new Map();
+          for (k = 0; k < cnt; k++) { var mk = val(); o.set(mk, val()); }
+          return o;
+        case T_SET:
+          cnt = u32();
+          o = objs[slot] = new Set();
+          for (k = 0; k < cnt; k++) o.add(val());
+          return o;
+        case T_DATE:
+          pos += 8;
+          var ms = dv.getFloat64(pos - 8, true);
+          return objs[slot] = DATE ? new DATE(ms) : ms;
+        case T_REGEXP:
+          var src = str();
+          return objs[slot] = new RegExp(src, str());
+        case T_BUFFER:
+          var len = u32();
+          pos += len;
+          return objs[slot] = u.slice(pos - len, pos).buffer;
+        case T_XFER:
+          return objs[slot] = bufs[u32()];
+        case T_VIEW:
+          var kind = u[pos++];
+          var buf = val(), off = u32(), vlen = u32();
+          var C = VIEWS[kind];
+          if (!C) throw new Error('structured clone: unsupported view');
+          return objs[slot] = new C(buf, off, vlen);
+        case T_ERROR:
+          var name = str(), msg = str(), stack = str();
+          var E = ERRORS[name] || Error;
+          o = objs[slot] = new E(msg);
+          if (!ERRORS[name]) o.name = name;
+          if (stack) o.stack = stack;
+          return o;
+        case T_BOXED:
+          return objs[slot] = Object(val());
+      }
+      throw new Error('structured clone: bad tag ' + t);
+    }
+
+    return val();
+  }
+
+  return { encode: encode, decode: decode };
+}
@@ -19,13 +19,19 @@
  * ellipse: cx, cy, rx, ry
  * line: x1, y1, x2, y2
  * polyline/polygon: points
- * path: d (M,m,L,l,H,h,V,v,Z,z,C,c,Q,q,A,a — approximated)
+ * path: d (M,m,L,l,H,h,V,v,Z,z,C,c,S,s,Q,q,T,t,A,a)
  * text/tspan: x, y, font-size, text-anchor, dominant-baseline
  *
+ * Shapes are flattened and filled/stroked by the shared anti-aliased
+ * scanline rasterizer in raster.ts, honouring fill-rule,
+ * stroke-linejoin, stroke-linecap and stroke-miterlimit.
+ *
  * Output: DecodedImage { w, h, data: Uint32Array (0xAARRGGBB) }
  */
 
 import type { DecodedImage } from './types.js';
+import { FlatPath, ScanRasterizer, SpanBuffer, strokePath, blendSpans } from './raster.js';
+import type { FillRule, LineJoin, LineCap } from './raster.js';
 
 // ── Color parsing ─────────────────────────────────────────────────────────────
 
@@ -173,94 +179,31 @@ class PixelBuf {
     this.data[idx] = ((outA & 0xFF) << 24 | (outR & 0xFF) << 16 | (outG & 0xFF) << 8 | (outB & 0xFF)) >>> 0;
   }
 
-  /** Draw a thick point (stroke-width > 1). */
-  plotWide(x: number, y: number, color: number, sw: number): void {
-    if (sw <= 1) { this.plot(x, y, color); return; }
-    var r = sw / 2;
-    for (var dy = -r; dy <= r; dy++) {
-      for (var dx = -r; dx <= r; dx++) {
-        if (dx * dx + dy * dy <= r * r) this.plot(x + dx, y + dy, color);
-      }
-    }
+  private _ras: ScanRasterizer | null = null;
+  private _spans = new SpanBuffer();
+
+  private _raster(): ScanRasterizer {
+    if (!this._ras) this._ras = new ScanRasterizer(this.w, this.h);
+    return this._ras;
   }
 
-  /** Scan-line fill a polygon given vertex lists. */
-  fillPoly(xs: number[], ys: number[], color: number): void {
-    if (xs.length < 3) return;
-    var minY = Math.floor(Math.min(...ys));
-    var maxY = Math.ceil(Math.max(...ys));
-    minY = Math.max(0, minY); maxY = Math.min(this.h - 1, maxY);
-
-    for (var scanY = minY; scanY <= maxY; scanY++) {
-      var intersections: number[] = [];
-      var n = xs.length;
-      for (var i = 0, j = n - 1; i < n; j = i++) {
-        var yi = ys[i]!, yj = ys[j]!;
-        if ((yi <= scanY && yj > scanY) || (yj <= scanY && yi > scanY)) {
-          var xi = xs[i]!, xj = xs[j]!;
-          var t = (scanY - yi) / (yj - yi);
-          intersections.push(xi + t * (xj - xi));
-        }
-      }
-      intersections.sort((a, b) => a - b);
-      for (var k = 0; k + 1 < intersections.length; k += 2) {
-        var x0 = Math.ceil(intersections[k]!);
-        var x1 = Math.floor(intersections[k + 1]!);
-        for (var px = Math.max(0, x0); px <= Math.min(this.w - 1, x1); px++) {
-          this.plot(px, scanY, color);
-        }
-      }
-    }
+  private _composite(rule: FillRule, color: number): void {
+    var spans = this._spans;
+    spans.reset();
+    this._raster().sweep(rule, spans);
+    blendSpans(this.data, this.w, spans, color);
   }
 
-  /** Fill multiple closed sub-paths with even-odd rule (no false connecting edges). */
-  fillMultiPoly(polys: Array<[number[], number[]]>, color: number): void {
-    if (polys.length === 0) return;
-    if (polys.length === 1) { this.fillPoly(polys[0]![0]!, polys[0]![1]!, color); return; }
-    var minY = Infinity, maxY = -Infinity;
-    for (var p0 = 0; p0 < polys.length; p0++) {
-      var pys0 = polys[p0]![1]!;
-      for (var i0 = 0; i0 < pys0.length; i0++) {
-        if (pys0[i0]! < minY) minY = pys0[i0]!;
-        if (pys0[i0]! > maxY) maxY = pys0[i0]!;
-      }
-    }
-    minY = Math.max(0, Math.floor(minY));
-    maxY = Math.min(this.h - 1, Math.ceil(maxY));
-    for (var scanY2 = minY; scanY2 <= maxY; scanY2++) {
-      var ints: number[] = [];
-      for (var p2 = 0; p2 < polys.length; p2++) {
-        var pxs2 = polys[p2]![0]!, pys2 = polys[p2]![1]!;
-        var n2 = pxs2.length;
-        for (var i2 = 0, j2 = n2 - 1; i2 < n2; j2 = i2++) {
-          var yi2 = pys2[i2]!, yj2 = pys2[j2]!;
-          if ((yi2 <= scanY2 && yj2 > scanY2) || (yj2 <= scanY2 && yi2 > scanY2)) {
-            var t2 = (scanY2 - yi2) / (yj2 - yi2);
-            ints.push(pxs2[i2]! + t2 * (pxs2[j2]! - pxs2[i2]!));
-          }
-        }
-      }
-      ints.sort((a, b) => a - b);
-      for (var k2 = 0; k2 + 1 < ints.length; k2 += 2) {
-        var x0 = Math.ceil(ints[k2]!);
-        var x1 = Math.floor(ints[k2 + 1]!);
-        for (var px = Math.max(0, x0); px <= Math.min(this.w - 1, x1); px++) {
-          this.plot(px, scanY2, color);
-        }
-      }
-    }
+  /** Anti-aliased fill of a device-space path. */
+  fillPath(path: FlatPath, color: number, rule: FillRule): void {
+    this._raster().addPath(path);
+    this._composite(rule, color);
   }
 
-  /** Draw a polyline with stroke color and width. */
-  strokeLine(x0: number, y0: number, x1: number, y1: number, color: number, sw: number): void {
-    var dx = x1 - x0, dy = y1 - y0;
-    var len = Math.sqrt(dx * dx + dy * dy);
-    if (len === 0) { this.plotWide(x0, y0, color, sw); return; }
-    var steps = Math.ceil(len * 2);
-    for (var i = 0; i <= steps; i++) {
-      var t2 = i / steps;
-      this.plotWide(x0 + dx * t2, y0 + dy * t2, color, sw);
-    }
+  /** Anti-aliased stroke of a device-space path, half-width hw pixels. */
+  strokePath(path: FlatPath, color: number, hw: number, join: LineJoin, cap: LineCap, miterLimit: number): void {
+    strokePath(path, this._raster(), hw, join, cap, miterLimit);
+    this._composite('nonzero', color);
   }
 }
 
@@ -320,8 +263,14 @@ interface PaintCtx {
   fill:   number;   // 0xAARRGGBB
   stroke: number;   // 0xAARRGGBB
   sw:     number;   // stroke-width
+  rule:   FillRule; // fill-rule
+  join:   LineJoin; // stroke-linejoin
+  cap:    LineCap;  // stroke-linecap
+  miter:  number;   // stroke-miterlimit
 }
 
+const DEFAULT_PAINT: PaintCtx = { fill: 0xFF000000, stroke: 0, sw: 1, rule: 'nonzero', join: 'miter', cap: 'butt', miter: 4 };
+
 function getPaintCtx(attrs: Record<string,string>, style: Record<string,string>, parentCtx: PaintCtx): PaintCtx {
   var opacity  = parseFloat(getAttr(attrs, style, 'opacity', '1'));
   var fillStr  = getAttr(attrs, style, 'fill', '');
@@ -333,7 +282,28 @@ function getPaintCtx(attrs: Record<string,string>, style: Record<string,string>,
   if (!fillStr)   fill   = parentCtx.fill;
   if (!strokeStr) stroke = parentCtx.stroke;
 
-  return { fill, stroke, sw };
+  var rule = getAttr(attrs, style, 'fill-rule', parentCtx.rule);
+  var join = getAttr(attrs, style, 'stroke-linejoin', parentCtx.join);
+  var cap  = getAttr(attrs, style, 'stroke-linecap', parentCtx.cap);
+  var miter = parseFloat(getAttr(attrs, style, 'stroke-miterlimit', '')) || parentCtx.miter;
+
+  return {
+    fill, stroke, sw,
+    rule: rule === 'evenodd' ? 'evenodd' : 'nonzero',
+    join: join === 'round' || join === 'bevel' ? join : 'miter',
+    cap:  cap === 'round' || cap === 'square' ? cap : 'butt',
+    miter: miter < 1 ? 1 : miter,
+  };
+}
+
+/** Fill and stroke a path built through matrix `m`. */
+function paintPath(buf: PixelBuf, fp: FlatPath, ctx: PaintCtx, m: Matrix, fill = true): void {
+  if (fill && ctx.fill) buf.fillPath(fp, ctx.fill, ctx.rule);
+  if (ctx.stroke && ctx.sw > 0) {
+    // Stroke width follows the transform's area scale
+    var hw = ctx.sw / 2 * Math.sqrt(Math.abs(m[0] * m[3] - m[1] * m[2]));
+    buf.strokePath(fp, ctx.stroke, hw, ctx.join, ctx.cap, ctx.miter);
+  }
 }
 
 function renderRect(buf: PixelBuf, attrs: Record<string,string>, style: Record<string,string>, ctx: PaintCtx, m: Matrix): void {
@@ -345,82 +315,43 @@ function renderRect(buf: PixelBuf, attrs: Record<string,string>, style: Record<s
   var ry  = numAttr(attrs, style, 'ry',     rx);
 
   if (rw <= 0 || rh <= 0) return;
-
-  // Fill: create polygon vertices for rounded rect (simplified: just plain rect)
-  if (ctx.fill) {
-    var xs: number[] = [], ys: number[] = [];
-    var steps = 16;
-    for (var qi = 0; qi < steps; qi++) {
-      var ang = (qi / steps) * 2 * Math.PI;
-      var px2 = x + rw / 2 + (rw / 2 - rx) * Math.cos(ang) * (rx > 0 ? 1 : 1);
-      var py2 = y + rh / 2 + (rh / 2 - ry) * Math.sin(ang) * (ry > 0 ? 1 : 1);
-      if (rx === 0 && ry === 0) {
-        // Just use rectangle corners
-        break;
-      }
-      var [px3, py3] = applyMatrix(m, px2, py2);
-      xs.push(px3); ys.push(py3);
-    }
-    if (rx === 0 && ry === 0) {
-      // Plain rectangle
-      var [ax, ay] = applyMatrix(m, x, y);
-      var [bx, by] = applyMatrix(m, x + rw, y);
-      var [cx2, cy2] = applyMatrix(m, x + rw, y + rh);
-      var [dx2, dy2] = applyMatrix(m, x, y + rh);
-      buf.fillPoly([ax, bx, cx2, dx2], [ay, by, cy2, dy2], ctx.fill);
-    } else {
-      buf.fillPoly(xs, ys, ctx.fill);
-    }
-  }
-
-  if (ctx.stroke && ctx.sw > 0) {
-    var corners: [number,number][] = [
-      applyMatrix(m, x, y), applyMatrix(m, x + rw, y),
-      applyMatrix(m, x + rw, y + rh), applyMatrix(m, x, y + rh),
-    ];
-    for (var ci = 0; ci < 4; ci++) {
-      var [x0, y0] = corners[ci]!;
-      var [x1, y1] = corners[(ci + 1) % 4]!;
-      buf.strokeLine(x0, y0, x1, y1, ctx.stroke, ctx.sw);
-    }
+  if (!rx) rx = ry;
+  rx = Math.min(Math.max(0, rx), rw / 2);
+  ry = Math.min(Math.max(0, ry), rh / 2);
+
+  var fp = new FlatPath(m);
+  if (rx > 0 && ry > 0) {
+    var hp = Math.PI / 2;
+    fp.moveTo(x + rx, y);
+    fp.ellipse(x + rw - rx, y + ry,      rx, ry, 0, -hp, 0, false);
+    fp.ellipse(x + rw - rx, y + rh - ry, rx, ry, 0, 0, hp, false);
+    fp.ellipse(x + rx,      y + rh - ry, rx, ry, 0, hp, 2 * hp, false);
+    fp.ellipse(x + rx,      y + ry,      rx, ry, 0, 2 * hp, 3 * hp, false);
+    fp.close();
+  } else {
+    fp.rect(x, y, rw, rh);
   }
+  paintPath(buf, fp, ctx, m);
 }
 
 function renderCircle(buf: PixelBuf, cx: number, cy: number, rx: number, ry: number, ctx: PaintCtx, m: Matrix): void {
   if (rx <= 0 || ry <= 0) return;
-  var steps = Math.max(32, Math.ceil(2 * Math.PI * Math.max(rx, ry)));
-  var xs: number[] = [], ys: number[] = [];
-  for (var i = 0; i < steps; i++) {
-    var ang = (i / steps) * 2 * Math.PI;
-    var [px4, py4] = applyMatrix(m, cx + rx * Math.cos(ang), cy + ry * Math.sin(ang));
-    xs.push(px4); ys.push(py4);
-  }
-  if (ctx.fill) buf.fillPoly(xs, ys, ctx.fill);
-  if (ctx.stroke && ctx.sw > 0) {
-    for (var j = 0; j < xs.length; j++) {
-      buf.strokeLine(xs[j]!, ys[j]!, xs[(j + 1) % xs.length]!, ys[(j + 1) % ys.length]!, ctx.stroke, ctx.sw);
-    }
-  }
+  var fp = new FlatPath(m);
+  fp.ellipse(cx, cy, rx, ry, 0, 0, 2 * Math.PI, false);
+  fp.close();
+  paintPath(buf, fp, ctx, m);
 }
 
 /** SVG path d-attribute parser: M/L/H/V/Z/C/S/Q/T/A with proper number tokenization. */
 function renderPath(buf: PixelBuf, d: string, ctx: PaintCtx, m: Matrix): void {
   var re = /([MLHVZCSQTAmlhvzcsqta])\s*((?:[^MLHVZCSQTAmlhvzcsqta])*)/g;
   var match: RegExpExecArray | null;
+  var fp = new FlatPath(m);
   var curX = 0, curY = 0;
   var startX = 0, startY = 0;
-  var polylines: Array<[number[], number[]]> = [];
-  var curPolyXs: number[] = [], curPolyYs: number[] = [];
   var lastCp2x = 0, lastCp2y = 0; // for S/T smooth bezier reflection
   var prevCmd = '';
 
-  function flush(): void {
-    if (curPolyXs.length > 0) polylines.push([[...curPolyXs], [...curPolyYs]]);
-    curPolyXs = []; curPolyYs = [];
-  }
-
-  function addPt(x: number, y: number): void { curPolyXs.push(x); curPolyYs.push(y); }
-
   while ((match = re.exec(d)) !== null) {
     var rawCmd = match[1]!;
     var cmd = rawCmd.toUpperCase();
@@ -433,40 +364,33 @@ function renderPath(buf: PixelBuf, d: string, ctx: PaintCtx, m: Matrix): void {
         if (i >= nums.length - 1) break;
         var nx = (nums[i++] ?? 0) + (rel ? curX : 0);
         var ny = (nums[i++] ?? 0) + (rel ? curY : 0);
-        if (cmd === 'M') { flush(); startX = nx; startY = ny; cmd = 'L'; }
+        if (cmd === 'M') { fp.moveTo(nx, ny); startX = nx; startY = ny; cmd = 'L'; }
+        else fp.lineTo(nx, ny);
         curX = nx; curY = ny;
         lastCp2x = curX; lastCp2y = curY;
-        addPt(curX, curY);
       } else if (cmd === 'H') {
         if (i >= nums.length) break;
         curX = (nums[i++] ?? 0) + (rel ? curX : 0);
         lastCp2x = curX; lastCp2y = curY;
-        addPt(curX, curY);
+        fp.lineTo(curX, curY);
       } else if (cmd === 'V') {
         if (i >= nums.length) break;
         curY = (nums[i++] ?? 0) + (rel ? curY : 0);
         lastCp2x = curX; lastCp2y = curY;
-        addPt(curX, curY);
+        fp.lineTo(curX, curY);
       } else if (cmd === 'Z') {
-        addPt(startX, startY);
-        flush();
+        fp.close();
         curX = startX; curY = startY;
         break;
       } else if (cmd === 'C') {
         if (i >= nums.length - 5) break;
-        // Bezier: approximate with several line segments
         var cp1x = (nums[i++] ?? 0) + (rel ? curX : 0);
         var cp1y = (nums[i++] ?? 0) + (rel ? curY : 0);
         var cp2x = (nums[i++] ?? 0) + (rel ? curX : 0);
         var cp2y = (nums[i++] ?? 0) + (rel ? curY : 0);
         var ex = (nums[i++] ?? 0) + (rel ? curX : 0);
         var ey = (nums[i++] ?? 0) + (rel ? curY : 0);
-        for (var t = 0; t <= 1; t += 0.1) {
-          var mt = 1 - t;
-          var bx = mt*mt*mt*curX + 3*mt*mt*t*cp1x + 3*mt*t*t*cp2x + t*t*t*ex;
-          var by = mt*mt*mt*curY + 3*mt*mt*t*cp1y + 3*mt*t*t*cp2y + t*t*t*ey;
-          addPt(bx, by);
-        }
+        fp.cubicTo(cp1x, cp1y, cp2x, cp2y, ex, ey);
         lastCp2x = cp2x; lastCp2y = cp2y;
         curX = ex; curY = ey;
       } else if (cmd === 'S') {
@@ -477,23 +401,17 @@ function renderPath(buf: PixelBuf, d: string, ctx: PaintCtx, m: Matrix): void {
         var scp2y = (nums[i++] ?? 0) + (rel ? curY : 0);
         var sex = (nums[i++] ?? 0) + (rel ? curX : 0);
         var sey = (nums[i++] ?? 0) + (rel ? curY : 0);
-        for (var st = 0; st <= 1; st += 0.1) {
-          var smt = 1 - st;
-          addPt(smt*smt*smt*curX + 3*smt*smt*st*scp1x + 3*smt*st*st*scp2x + st*st*st*sex,
-                smt*smt*smt*curY + 3*smt*smt*st*scp1y + 3*smt*st*st*scp2y + st*st*st*sey);
-        }
+        fp.cubicTo(scp1x, scp1y, scp2x, scp2y, sex, sey);
         lastCp2x = scp2x; lastCp2y = scp2y;
         curX = sex; curY = sey;
+        prevCmd = 'S';
       } else if (cmd === 'Q') {
         if (i >= nums.length - 3) break;
         var qcx = (nums[i++] ?? 0) + (rel ? curX : 0);
         var qcy = (nums[i++] ?? 0) + (rel ? curY : 0);
         var qex = (nums[i++] ?? 0) + (rel ? curX : 0);
         var qey = (nums[i++] ?? 0) + (rel ? curY : 0);
-        for (var qt = 0; qt <= 1; qt += 0.1) {
-          var qmt = 1 - qt;
-          addPt(qmt*qmt*curX + 2*qmt*qt*qcx + qt*qt*qex, qmt*qmt*curY + 2*qmt*qt*qcy + qt*qt*qey);
-        }
+        fp.quadTo(qcx, qcy, qex, qey);
         lastCp2x = qcx; lastCp2y = qcy;
         curX = qex; curY = qey;
       } else if (cmd === 'T') {
@@ -502,26 +420,20 @@ function renderPath(buf: PixelBuf, d: string, ctx: PaintCtx, m: Matrix): void {
         var tcpy = (prevCmd === 'Q' || prevCmd === 'T') ? 2 * curY - lastCp2y : curY;
         var tex = (nums[i++] ?? 0) + (rel ? curX : 0);
         var tey = (nums[i++] ?? 0) + (rel ? curY : 0);
-        for (var tt = 0; tt <= 1; tt += 0.1) {
-          var tmt = 1 - tt;
-          addPt(tmt*tmt*curX + 2*tmt*tt*tcpx + tt*tt*tex,
-                tmt*tmt*curY + 2*tmt*tt*tcpy + tt*tt*tey);
-        }
+        fp.quadTo(tcpx, tcpy, tex, tey);
         lastCp2x = tcpx; lastCp2y = tcpy;
         curX = tex; curY = tey;
+        prevCmd = 'T';
       } else if (cmd === 'A') {
         if (i >= nums.length - 6) break;
         var arx = nums[i++] ?? 0;
         var ary = nums[i++] ?? 0;
-        i++; // x-axis-rotation
-        i++; // large-arc-flag
-        i++; // sweep-flag
+        var arot = nums[i++] ?? 0;
+        var large = (nums[i++] ?? 0) !== 0;
+        var sweep = (nums[i++] ?? 0) !== 0;
         var aex = (nums[i++] ?? 0) + (rel ? curX : 0);
         var aey = (nums[i++] ?? 0) + (rel ? curY : 0);
-        // Approximate arc as a line (simplified)
-        for (var at = 0; at <= 1; at += 0.1) {
-          addPt(curX + (aex - curX) * at, curY + (aey - curY) * at);
-        }
+        fp.svgArc(arx, ary, arot, large, sweep, aex, aey);
         lastCp2x = curX; lastCp2y = curY;
         curX = aex; curY = aey;
       } else {
@@ -530,35 +442,8 @@ function renderPath(buf: PixelBuf, d: string, ctx: PaintCtx, m: Matrix): void {
     }
     prevCmd = cmd;
   }
-  flush();
-
-  // Fill each sub-path independently using even-odd rule
-  if (ctx.fill && polylines.length > 0) {
-    var tPolys: Array<[number[], number[]]> = [];
-    for (var pl2 = 0; pl2 < polylines.length; pl2++) {
-      var plXs2 = polylines[pl2]![0]!, plYs2 = polylines[pl2]![1]!;
-      var txs: number[] = [], tys: number[] = [];
-      for (var pi2 = 0; pi2 < plXs2.length; pi2++) {
-        var [px5, py5] = applyMatrix(m, plXs2[pi2]!, plYs2[pi2]!);
-        txs.push(px5); tys.push(py5);
-      }
-      if (txs.length >= 3) tPolys.push([txs, tys]);
-    }
-    if (tPolys.length > 0) buf.fillMultiPoly(tPolys, ctx.fill);
-  }
 
-  // Stroke
-  if (ctx.stroke && ctx.sw > 0) {
-    for (var pl = 0; pl < polylines.length; pl++) {
-      var plXs = polylines[pl]![0]!;
-      var plYs = polylines[pl]![1]!;
-      for (var pk = 0; pk + 1 < plXs.length; pk++) {
-        var [px6, py6] = applyMatrix(m, plXs[pk]!, plYs[pk]!);
-        var [px7, py7] = applyMatrix(m, plXs[pk + 1]!, plYs[pk + 1]!);
-        buf.strokeLine(px6, py6, px7, py7, ctx.stroke, ctx.sw);
-      }
-    }
-  }
+  paintPath(buf, fp, ctx, m);
 }
 
 /** Render text as blocky pixel characters (8×8 pixel font). */
@@ -608,7 +493,7 @@ function renderTokens(
 
     var attrs = tok.attrs;
     var style = parseStyle(attrs['style'] ?? '');
-    var parentCtx = state.ctxStack[state.ctxStack.length - 1] ?? { fill: 0xFF000000, stroke: 0, sw: 1 };
+    var parentCtx = state.ctxStack[state.ctxStack.length - 1] ?? DEFAULT_PAINT;
     var m = state.mStack[state.mStack.length - 1] ?? IDENTITY;
 
     if (tok.type === 'open' || tok.type === 'self') {
@@ -630,26 +515,16 @@ function renderTokens(
         renderCircle(buf, numAttr(attrs, style, 'cx', 0), numAttr(attrs, style, 'cy', 0),
           numAttr(attrs, style, 'rx', 0), numAttr(attrs, style, 'ry', 0), ctx, localM);
       } else if (tok.tag === 'line') {
-        if (ctx.stroke && ctx.sw > 0) {
-          var [lx0, ly0] = applyMatrix(localM, numAttr(attrs, style, 'x1', 0), numAttr(attrs, style, 'y1', 0));
-          var [lx1, ly1] = applyMatrix(localM, numAttr(attrs, style, 'x2', 0), numAttr(attrs, style, 'y2', 0));
-          buf.strokeLine(lx0, ly0, lx1, ly1, ctx.stroke, ctx.sw);
-        }
+        var lfp = new FlatPath(localM);
+        lfp.moveTo(numAttr(attrs, style, 'x1', 0), numAttr(attrs, style, 'y1', 0));
+        lfp.lineTo(numAttr(attrs, style, 'x2', 0), numAttr(attrs, style, 'y2', 0));
+        paintPath(buf, lfp, ctx, localM, false);
       } else if (tok.tag === 'polyline' || tok.tag === 'polygon') {
         var pts = (attrs['points'] ?? '').trim().split(/[\s,]+/).map(Number);
-        var pxs: number[] = [], pys: number[] = [];
-        for (var pi = 0; pi + 1 < pts.length; pi += 2) {
-          var [ppx, ppy] = applyMatrix(localM, pts[pi] ?? 0, pts[pi + 1] ?? 0);
-          pxs.push(ppx); pys.push(ppy);
-        }
-        if (tok.tag === 'polygon' && ctx.fill && pxs.length > 2) buf.fillPoly(pxs, pys, ctx.fill);
-        if (ctx.stroke && ctx.sw > 0) {
-          var polyN = pxs.length;
-          var loopN = tok.tag === 'polygon' ? polyN : polyN - 1;
-          for (var pk2 = 0; pk2 < loopN; pk2++) {
-            buf.strokeLine(pxs[pk2]!, pys[pk2]!, pxs[(pk2 + 1) % polyN]!, pys[(pk2 + 1) % polyN]!, ctx.stroke, ctx.sw);
-          }
-        }
+        var pfp = new FlatPath(localM);
+        for (var pi = 0; pi + 1 < pts.length; pi += 2) pfp.lineTo(pts[pi] ?? 0, pts[pi + 1] ?? 0);
+        if (tok.tag === 'polygon') pfp.close();
+        paintPath(buf, pfp, ctx, localM, tok.tag === 'polygon');
       } else if (tok.tag === 'path') {
         renderPath(buf, attrs['d'] ?? '', ctx, localM);
       } else if (tok.tag === 'text' || tok.tag === 'tspan') {
@@ -748,11 +623,8 @@ function _renderSVG(svgStr: string, maxW: number, maxH: number): DecodedImage |
 
   // Root paint context: read fill from SVG element if specified
   var rootFillStr = getAttr(attrs0, style0, 'fill', '');
-  var rootCtx: PaintCtx = {
-    fill: rootFillStr ? parseColor(rootFillStr) : 0xFF000000,
-    stroke: 0,
-    sw: 1,
-  };
+  var rootCtx: PaintCtx = getPaintCtx(attrs0, style0, DEFAULT_PAINT);
+  rootCtx.fill = rootFillStr ? parseColor(rootFillStr) : 0xFF000000;
   var rootM: Matrix = [scaleX, 0, 0, scaleY, -vbX * scaleX, -vbY * scaleY];
 
   var svgIdx = tokens.indexOf(svgTok);
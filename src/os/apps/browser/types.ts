@@ -325,6 +325,32 @@ export interface DecodedImage {
   data: Uint32Array | null;  // 0xAARRGGBB pixels, null = decode failed
 }
 
+/**
+ * Incremental decoder: push() bytes as they arrive and the
+ * pixels fill in place.  PNG emits rows as IDAT data inflates (Adam7 passes
+ * as blocks that later passes refine), baseline JPEG emits MCU rows,
+ * progressive JPEG repaints after every scan and GIF streams frame 0.
+ */
+export interface ImageStream {
+  /** Decoded size (natural size over the DCT scale); 0 until the header is in. */
+  w:  number;
+  h:  number;
+  /** Natural size. */
+  nw: number;
+  nh: number;
+  /** Pixels, allocated once the header is in. */
+  data: Uint32Array | null;
+  /** Rows [y0, y1) changed since the consumer last zeroed both. */
+  y0: number;
+  y1: number;
+  /** All data decoded, or as much of a truncated file as possible. */
+  done:   boolean;
+  /** Not decodable (bad signature or header, too large). */
+  failed: boolean;
+  /** Append bytes; `last` marks the end of the file. */
+  push(bytes: Uint8Array, last: boolean): void;
+}
+
 // ── HTML tokeniser ────────────────────────────────────────────────────────────
 
 export interface HtmlToken {
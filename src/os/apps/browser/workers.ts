@@ -5,17 +5,48 @@
  * QuickJS runtime (kernel.proc* API).  Each Worker gets its own isolated
  * QuickJS runtime with its own GC heap.
  *
+ * Messages use the binary structured clone in structured-clone.ts:
+ * typed arrays, Maps, Sets, Dates and cyclic graphs survive the trip, and
+ * ArrayBuffers in the transfer list move between runtimes through
+ * kernel.bufferTransfer instead of being copied through the IPC ring.
+ * A worker only runs when it has something to do: postMessage() marks it,
+ * the next frame runs its message pump on an application processor
+ * (kernel.procRunOn), and the host drains a worker's outbox only when the
+ * kernel doorbell says it posted.  Several compute-heavy workers therefore
+ * run in parallel with each other and with the page.
+ *
  * Limitations vs spec:
- *  - Transferable objects not yet supported (postMessage copies via JSON)
- *  - Shared memory via SharedArrayBuffer requires kernel.sharedBufferCreate
+ *  - Transferred buffers are detached in the sender only when they cross
+ *    runtimes; MessagePort and BroadcastChannel stay in-process and hand the
+ *    same ArrayBuffer over
+ *  - SharedArrayBuffer requires kernel.sharedBufferCreate
  *  - importScripts() fetches synchronously via os.fetchAsync
- *  - Maximum 8 concurrent workers (limited by JIT_PROC_SLOTS)
+ *  - At most 16 runtimes (JSPROC_MAX), shared with other proc users
  */
 
 import { os } from '../../core/sdk.js';
+import { cloneCodec } from './structured-clone.js';
 
 declare var kernel: import('../../core/kernel.js').KernelAPI;
 
+var _sc = cloneCodec();
+
+/** postMessage's second argument: a transfer array or { transfer }. */
+type TransferArg = unknown[] | { transfer?: unknown[] } | null | undefined;
+
+function _transferList(t: TransferArg): unknown[] | null {
+  if (!t) return null;
+  return Array.isArray(t) ? t : (t.transfer ?? null);
+}
+
+/** Clone within this runtime; transferred buffers are passed through as-is. */
+function _cloneLocal(data: unknown, transfer: TransferArg): unknown {
+  var held: ArrayBuffer[] = [];
+  var bytes = _sc.encode(data, _transferList(transfer),
+                         function(ab) { held.push(ab); return held.length - 1; });
+  return _sc.decode(bytes, function(i) { return held[i]; });
+}
+
 // ── MessageEvent ─────────────────────────────────────────────────────────────
 
 export class WorkerMessageEvent {
@@ -35,8 +66,8 @@ export class WorkerErrorEvent {
 
 // ── MessageChannel ───────────────────────────────────────────────────────────
 //
-// In-process synchronous message channel.  Unlike the standard which uses
-// structured clone, we use JSON serialisation for cross-runtime compatibility.
+// In-process message channel.  Data is structured-cloned at postMessage time
+// and delivered on a later macrotask.
 
 export class MessagePort {
   private _other:    MessagePort | null = null;
@@ -57,10 +88,9 @@ export class MessagePort {
 
   _pair(other: MessagePort): void { this._other = other; }
 
-  postMessage(data: unknown, _transfer?: unknown[]): void {
-    // Clone via JSON to simulate structured clone
-    var cloned: unknown;
-    try { cloned = JSON.parse(JSON.stringify(data)); } catch (_) { cloned = data; }
+  postMessage(data: unknown, transfer?: TransferArg): void {
+    // Throws DataCloneError like a browser; nothing is queued in that case
+    var cloned = _cloneLocal(data, transfer);
     if (this._other) {
       this._other._enqueue(cloned);
     }
@@ -146,12 +176,12 @@ export class BroadcastChannelImpl {
 
   postMessage(data: unknown): void {
     if (this._closed) return;
-    var cloned: unknown;
-    try { cloned = JSON.parse(JSON.stringify(data)); } catch (_) { cloned = data; }
+    // Serialise once; every receiver decodes its own copy
+    var bytes = _sc.encode(data);
     var siblings = _bcastChannels.get(this.name) ?? [];
     for (var s of siblings) {
       if (s !== this && !s._closed && s.onmessage) {
-        try { s.onmessage(new WorkerMessageEvent(cloned)); } catch (_) {}
+        try { s.onmessage(new WorkerMessageEvent(_sc.decode(bytes))); } catch (_) {}
       }
     }
   }
@@ -177,50 +207,111 @@ export class BroadcastChannelImpl {
 // ── Worker ───────────────────────────────────────────────────────────────────
 //
 // Runs JS code in an isolated QuickJS runtime (kernel.procCreate/procEval).
-// Messages are polled on each tick() call.
+// Data messages travel as structured-clone bytes through the child's IPC
+// rings; control messages (close, error, large-message notes) are JSON.
+
+/** IPC ring size per worker; messages up to half of it go inline. */
+const WORKER_RING_BYTES = 256 * 1024;
+/** Inbox messages one run of the worker's pump delivers. */
+const WORKER_PUMP_MAX   = 64;
+/** Outbox messages drained per worker per frame. */
+const WORKER_DRAIN_MAX  = 64;
+
+/**
+ * Turn encoded clone bytes into a ring message.  Anything over `max` bytes
+ * is copied into a shared region and handed over with kernel.bufferTransfer;
+ * the ring then carries only a { type: 'big' } note.  Also runs inside
+ * worker runtimes (shipped with toString()).
+ */
+function frameMessage(bytes: Uint8Array, max: number): Uint8Array | string {
+  if (bytes.length <= max) return bytes;
+  var shm = kernel.sharedBufferCreate(bytes.length);
+  var ab = shm >= 0 ? kernel.sharedBufferOpen(shm) : null;
+  if (shm >= 0) kernel.sharedBufferRelease(shm);   // the view keeps it alive
+  var id = ab ? (new Uint8Array(ab).set(bytes), kernel.bufferTransfer!(ab)) : -1;
+  if (id < 0) throw new Error('postMessage: no region for a ' + bytes.length + ' byte message');
+  return JSON.stringify({ type: 'big', id: id, len: bytes.length });
+}
+
+/** Inverse of frameMessage: clone bytes, or the parsed control message. */
+function unframeMessage(m: string | ArrayBuffer): any {
+  if (typeof m !== 'string') return new Uint8Array(m);
+  var ev: any;
+  try { ev = JSON.parse(m); } catch (_) { return null; }
+  if (!ev || ev.type !== 'big') return ev;
+  var ab = kernel.bufferAccept!(ev.id);
+  return ab ? new Uint8Array(ab, 0, ev.len) : null;
+}
 
 /** Bootstrap code injected into every worker runtime. */
-const WORKER_BOOTSTRAP = `
-var _workerDispatch = null;
-var _workerMessageQueue = [];
+const WORKER_BOOTSTRAP = 'var _sc = (' + cloneCodec.toString() + ')();\n' +
+  'var frameMessage = ' + frameMessage.toString() + ';\n' +
+  'var unframeMessage = ' + unframeMessage.toString() + ';\n' + `
+var _outQ = [];       // posts the outbox ring had no room for yet
+var _listeners = [];
 
 function onmessage(_ev) {}  // default no-op; script may override
 
+function _post(m) {
+  if (_outQ.length || !kernel.postMessage(m)) _outQ.push(m);
+}
+function _postError(e) {
+  _post(JSON.stringify({ type: 'error', message: String(e && e.message || e) }));
+}
+
 var self = {
   get onmessage() { return onmessage; },
   set onmessage(fn) { onmessage = fn; },
-  postMessage: function(data) {
-    kernel.postMessage(JSON.stringify({ type: 'message', data: data }));
+  postMessage: function(data, transfer) {
+    var xfer = !transfer ? null : Array.isArray(transfer) ? transfer : (transfer.transfer || null);
+    _post(frameMessage(_sc.encode(data, xfer, kernel.bufferTransfer), kernel.maxMessageBytes()));
   },
   addEventListener: function(type, fn) {
-    if (type === 'message') onmessage = fn;
+    if (type === 'message' && _listeners.indexOf(fn) < 0) _listeners.push(fn);
+  },
+  removeEventListener: function(type, fn) {
+    var i = _listeners.indexOf(fn);
+    if (type === 'message' && i >= 0) _listeners.splice(i, 1);
   },
-  removeEventListener: function() {},
   close: function() {
-    kernel.postMessage(JSON.stringify({ type: 'close' }));
+    _post(JSON.stringify({ type: 'close' }));
   },
   importScripts: function() { /* stub */ },
 };
 
 var globalThis = self;
+var postMessage = self.postMessage;
+var addEventListener = self.addEventListener;
+var removeEventListener = self.removeEventListener;
+var close = self.close;
+var importScripts = self.importScripts;
 var console = {
   log: function() { kernel.serialPut('[W] ' + Array.prototype.slice.call(arguments).join(' ')); },
   error: function() { kernel.serialPut('[W:E] ' + Array.prototype.slice.call(arguments).join(' ')); },
   warn: function() { kernel.serialPut('[W:W] ' + Array.prototype.slice.call(arguments).join(' ')); },
 };
-
-function _workerTick() {
-  var msg = kernel.pollMessage();
-  while (msg) {
-    try {
-      var ev = JSON.parse(msg);
-      if (ev && ev.type === 'message') {
-        var msgEv = { type: 'message', data: ev.data };
-        if (typeof onmessage === 'function') onmessage(msgEv);
-      }
-    } catch(_) {}
-    msg = kernel.pollMessage();
+var setTimeout = function(fn, ms) { return kernel.setTimeout(fn, ms || 0); };
+var setInterval = function(fn, ms) { return kernel.setInterval(fn, ms || 0); };
+var clearTimeout = function(t) { kernel.clearTimeout(t); };
+var clearInterval = function(t) { kernel.clearInterval(t); };
+
+// Deliver up to max inbox messages.  Returns the work left over (queued
+// posts plus unread input) so the host knows to run the pump again.
+function _workerTick(max) {
+  while (_outQ.length && kernel.postMessage(_outQ[0])) _outQ.shift();
+  var msgs = kernel.pollMessages(max);
+  for (var i = 0; i < msgs.length; i++) {
+    var bytes = unframeMessage(msgs[i]);
+    if (!(bytes instanceof Uint8Array)) continue;
+    var ev;
+    try { ev = { type: 'message', data: _sc.decode(bytes, kernel.bufferAccept) }; }
+    catch (e) { _postError(e); continue; }
+    try { if (typeof onmessage === 'function') onmessage(ev); } catch (e) { _postError(e); }
+    for (var j = 0; j < _listeners.length; j++) {
+      try { _listeners[j](ev); } catch (e) { _postError(e); }
+    }
   }
+  return _outQ.length + kernel.messagesPending();
 }
 `;
 
@@ -228,13 +319,24 @@ export class WorkerImpl {
   private _id:          number = -1;
   private _ready        = false;
   private _terminated   = false;
+  /** Encoded messages waiting for the script to load or for inbox room. */
+  private _outQ: Array<Uint8Array | string> = [];
+  /** Largest message the inbox ring takes inline. */
+  private _maxMsg       = WORKER_RING_BYTES / 2;
+  /** Script source still to be evaluated in the worker. */
+  private _script: string | null = null;
+  /** The worker has input (or queued output) and its pump should run. */
+  private _wake         = false;
+  /** CPU running the worker right now; 0 when it is back on the BSP. */
+  private _runCpu       = 0;
+  /** The last drain stopped at WORKER_DRAIN_MAX; the doorbell won't ring for the rest. */
+  private _more         = false;
 
   onmessage:      ((ev: WorkerMessageEvent) => void) | null = null;
   onmessageerror: ((ev: WorkerErrorEvent) => void)   | null = null;
   onerror:        ((ev: WorkerErrorEvent) => void)   | null = null;
 
   private _listeners: Map<string, Array<(ev: unknown) => void>> = new Map();
-  private _pendingMsgs: unknown[] = [];
 
   constructor(scriptURL: string, _opts?: { type?: string; name?: string; credentials?: string }) {
     if (!kernel.procCreate) {
@@ -245,32 +347,32 @@ export class WorkerImpl {
     }
 
     try {
-      var id = kernel.procCreate() as number;
+      var id = kernel.procCreate(WORKER_RING_BYTES) as number;
       if (id < 0) {
-        this._dispatchError('No free worker slots (max 8 concurrent workers)');
+        this._dispatchError('No free worker slots (all 16 runtimes in use)');
         return;
       }
       this._id = id;
+      var info = kernel.procRingInfo ? kernel.procRingInfo(id) : null;
+      if (info) this._maxMsg = info.maxMessage;
 
       // Inject bootstrap, then load the script
       kernel.procEval(id, WORKER_BOOTSTRAP);
+      registerWorker(this);
 
       if (scriptURL.startsWith('blob:') || scriptURL.startsWith('data:')) {
         // data: / blob: URL — not supported, run empty worker
         this._ready = true;
       } else {
-        // Fetch and eval the script
+        // Fetch the script; the next tick evaluates it (on an AP when one is free)
         os.fetchAsync(scriptURL, (resp, err) => {
           if (!resp || resp.status !== 200) {
             this._dispatchError('Worker script load failed: ' + (err || resp?.status));
             return;
           }
-          kernel.procEval(this._id, resp.bodyText);
+          this._script = resp.bodyText;
           this._ready = true;
-          // Deliver any pending messages
-          while (this._pendingMsgs.length > 0) {
-            this._sendToWorker(this._pendingMsgs.shift());
-          }
+          this._wake = true;
         });
       }
     } catch (e) {
@@ -278,53 +380,127 @@ export class WorkerImpl {
     }
   }
 
-  postMessage(data: unknown, _transfer?: unknown[]): void {
-    if (this._terminated) return;
-    if (!this._ready) { this._pendingMsgs.push(data); return; }
-    this._sendToWorker(data);
+  postMessage(data: unknown, transfer?: TransferArg): void {
+    if (this._terminated || this._id < 0) return;
+    // Clone now, as the spec requires: later changes to `data` are not seen
+    // and transferred buffers are detached straight away
+    var bytes = _sc.encode(data, _transferList(transfer), kernel.bufferTransfer || null);
+    this._outQ.push(frameMessage(bytes, this._maxMsg));
+    if (this._ready) this._flush();
   }
 
-  private _sendToWorker(data: unknown): void {
-    if (this._id < 0) return;
-    var json: string;
-    try { json = JSON.stringify({ type: 'message', data }); } catch (_) { return; }
-    try { kernel.procSend(this._id, json); } catch (_) {}
+  /** Move queued messages into the inbox ring while it has room. */
+  private _flush(): void {
+    while (this._outQ.length > 0 && kernel.procSend(this._id, this._outQ[0])) {
+      this._outQ.shift();
+      this._wake = true;
+    }
   }
 
   terminate(): void {
     if (this._terminated) return;
     this._terminated = true;
-    if (this._id >= 0 && kernel.procDestroy) {
+    this._outQ = [];
+    this._destroy();
+  }
+
+  /** True once the runtime is gone and the worker can leave the registry. */
+  get destroyed(): boolean { return this._terminated && this._id < 0; }
+
+  private _destroy(): void {
+    if (this._id < 0) return;
+    // A runtime an AP is executing cannot be freed; tick() retries
+    if (this._runCpu > 0 && kernel.procRunResult!(this._id) === null) return;
+    this._runCpu = 0;
+    if (kernel.procDestroy) {
       try { kernel.procDestroy(this._id); } catch (_) {}
     }
     this._id = -1;
   }
 
-  /** Called by tick loop: pump messages from worker outbox to host. */
-  tick(): void {
-    if (this._terminated || this._id < 0 || !this._ready) return;
-    // Pump worker's async tasks
-    try { kernel.procTick(this._id); } catch (_) {}
-    // Also tick the in-worker message pump
-    try { kernel.procEval(this._id, '_workerTick()'); } catch (_) {}
-    // Drain outbox
-    if (!kernel.procRecv) return;
-    var raw: string | null = null;
-    for (var i = 0; i < 16; i++) {
-      try { raw = kernel.procRecv(this._id) as string | null; } catch (_) { break; }
-      if (!raw) break;
-      var ev: any;
-      try { ev = JSON.parse(raw); } catch (_) { continue; }
-      if (ev.type === 'message') {
-        var msgEv = new WorkerMessageEvent(ev.data);
+  /**
+   * Called once per frame by tickAllWorkers.  `bell` is the kernel doorbell
+   * mask (-1 when unknown); the outbox is only read when this worker posted.
+   */
+  tick(bell: number = -1): void {
+    if (this._terminated) { this._destroy(); return; }
+    if (this._id < 0 || !this._ready) return;
+    var id = this._id;
+    var drain = (bell & (1 << id)) !== 0 || this._more;
+
+    if (this._runCpu > 0) {
+      var raw = kernel.procRunResult!(id);
+      if (raw === null) {
+        // Still running; whatever it posted so far can be read meanwhile
+        if (drain) this._drain();
+        return;
+      }
+      this._runCpu = 0;
+      this._ran(raw);
+      drain = true;
+    }
+
+    this._flush();
+    // Promise jobs and timers run on the BSP between pump runs
+    try { kernel.procTick(id); kernel.serviceTimers(id); } catch (_) {}
+
+    if (this._wake) {
+      var code = this._script !== null ? this._script : '_workerTick(' + WORKER_PUMP_MAX + ')';
+      // After the script itself, run the pump for anything posted meanwhile
+      this._wake = this._script !== null;
+      this._script = null;
+      var cpu = kernel.procRunOn ? kernel.procRunOn(id, 0, code, 0) : -1;
+      if (cpu > 0) {
+        this._runCpu = cpu;
+      } else {
+        // No AP free: run it here, as before SMP
+        try { this._ran(kernel.procEval(id, code)); } catch (e) { this._dispatchError(String(e)); }
+        drain = true;
+      }
+    }
+
+    if (drain) this._drain();
+  }
+
+  /** Account for one run: the pump returns the work it left; errors are reported. */
+  private _ran(raw: string): void {
+    if (raw === 'timeout') { this._wake = true; return; }
+    if (raw.indexOf('error:') === 0) { this._dispatchError(raw.slice(6)); return; }
+    if (raw.indexOf('Error') === 0)  { this._dispatchError(raw); return; }
+    var left = parseInt(raw.indexOf('done:') === 0 ? raw.slice(5) : raw, 10);
+    if (left > 0) this._wake = true;
+  }
+
+  /** Deliver what the worker posted. */
+  private _drain(): void {
+    var msgs: Array<string | ArrayBuffer>;
+    if (kernel.procRecvBatch) {
+      msgs = kernel.procRecvBatch(this._id, WORKER_DRAIN_MAX);
+    } else {
+      msgs = [];
+      var m: string | ArrayBuffer | null;
+      while (msgs.length < WORKER_DRAIN_MAX && (m = kernel.procRecv(this._id)) !== null) msgs.push(m);
+    }
+    this._more = msgs.length === WORKER_DRAIN_MAX;
+
+    for (var i = 0; i < msgs.length && !this._terminated; i++) {
+      var ev = unframeMessage(msgs[i]);
+      if (ev instanceof Uint8Array) {
+        var data: unknown;
+        try { data = _sc.decode(ev, kernel.bufferAccept || null); }
+        catch (e) {
+          var errEv = new WorkerErrorEvent(String(e));
+          if (this.onmessageerror) try { this.onmessageerror(errEv); } catch (_) {}
+          this._fireListeners('messageerror', errEv);
+          continue;
+        }
+        var msgEv = new WorkerMessageEvent(data);
         if (this.onmessage) try { this.onmessage(msgEv); } catch (_) {}
         this._fireListeners('message', msgEv);
-      } else if (ev.type === 'close') {
+      } else if (ev && ev.type === 'close') {
         this.terminate();
-        break;
-      } else if (ev.type === 'error') {
+      } else if (ev && ev.type === 'error') {
         this._dispatchError(String(ev.message ?? 'Worker error'));
-        break;
       }
     }
   }
@@ -358,7 +534,9 @@ export class WorkerImpl {
 
 var _activeWorkers: WorkerImpl[] = [];
 
-export function registerWorker(w: WorkerImpl): void  { _activeWorkers.push(w); }
+export function registerWorker(w: WorkerImpl): void {
+  if (_activeWorkers.indexOf(w) < 0) _activeWorkers.push(w);
+}
 export function unregisterWorker(w: WorkerImpl): void {
   var i = _activeWorkers.indexOf(w);
   if (i >= 0) _activeWorkers.splice(i, 1);
@@ -366,11 +544,13 @@ export function unregisterWorker(w: WorkerImpl): void {
 
 /** Called once per frame by BrowserApp to pump all worker message queues. */
 export function tickAllWorkers(): void {
+  if (_activeWorkers.length === 0) return;
+  // One doorbell read covers every worker; without one, drain them all
+  var bell = kernel.procDoorbell ? kernel.procDoorbell() : -1;
   for (var i = _activeWorkers.length - 1; i >= 0; i--) {
     var w = _activeWorkers[i];
-    (w as any)._terminated
-      ? _activeWorkers.splice(i, 1)
-      : w.tick();
+    w.tick(bell);
+    if (w.destroyed) _activeWorkers.splice(i, 1);
   }
 }
 
@@ -412,7 +592,6 @@ export class SharedWorkerImpl {
     if (!entry) {
       // First connection — create the underlying worker
       var w = new WorkerImpl(scriptURL, { name: nameStr });
-      registerWorker(w);
 
       // Host-side port for this SharedWorker entry
       var hostCh = new MessageChannel();
@@ -435,8 +614,8 @@ export class SharedWorkerImpl {
 
     // Intercept postMessage to route to underlying worker
     var origPost = callerPort.postMessage.bind(callerPort);
-    callerPort.postMessage = function(data: unknown, _transfer?: unknown[]) {
-      entry!.worker.postMessage(data);
+    callerPort.postMessage = function(data: unknown, transfer?: TransferArg) {
+      entry!.worker.postMessage(data, transfer);
     };
 
     // Route worker output → caller port onmessage
@@ -11,9 +11,13 @@
  * [904] update-initramfs equivalent: rebuild boot image
  *
  * All installer logic runs in TypeScript. C provides only disk I/O primitives
- * (kernel.ataRead / kernel.ataWrite / kernel.nvmeRead / kernel.nvmeWrite).
+ * (kernel.ataRead / kernel.ataWrite / kernel.nvmeRead / kernel.nvmeWrite,
+ * kernel.atapiPacket for the install CD).
  */
 
+import { openCdrom } from '../../storage/atapi.js';
+import type { ISO9660FS } from '../../fs/iso9660.js';
+
 // ── Disk access ─────────────────────────────────────────────────────────────
 
 interface DiskIO {
@@ -122,12 +126,21 @@ export async function grubInstallMBR(drive: number): Promise<void> {
 
 // ── [Item 899] Copy filesystem to disk ──────────────────────────────────────
 
+/** Root filesystem image on the install medium. */
+const ISO_ROOTFS_IMAGE = '/boot/rootfs.img';
+
 export async function copyFilesystemToDisk(
   drive:        number,
   partition:    Partition,
   onProgress?:  (pct: number) => void,
 ): Promise<void> {
   const k = (globalThis as any).kernel;
+  // Preferred source: the root image on the install CD, streamed
+  const iso = openCdrom('');
+  if (iso && iso.size(ISO_ROOTFS_IMAGE) > 0) {
+    await streamImageFromISO(iso, drive, partition, onProgress);
+    return;
+  }
   // Read source filesystem from the live ISO RAM disk (or kernel provides fs image)
   const srcImage: Uint8Array = k?.getInstallerRootFS?.() ?? new Uint8Array(0);
   if (srcImage.length === 0) {
@@ -147,6 +160,37 @@ export async function copyFilesystemToDisk(
   }
 }
 
+/**
+ * Copy ISO_ROOTFS_IMAGE to the partition through one reused 64 KB buffer:
+ * each chunk is a single ATAPI READ(10) packet straight into the buffer and
+ * one disk write out of it — no per-sector reads, no whole-image copy.
+ */
+async function streamImageFromISO(
+  iso:         ISO9660FS,
+  drive:       number,
+  partition:   Partition,
+  onProgress?: (pct: number) => void,
+): Promise<void> {
+  const k = (globalThis as any).kernel;
+  const io = diskIO();
+  const CHUNK = 128;                    // sectors per write = one 64 KB packet
+  const YIELD_EVERY = 16;               // chunks between UI yields (1 MB)
+  const buf = new Uint8Array(CHUNK * 512);
+  const total = iso.size(ISO_ROOTFS_IMAGE);
+  let chunks = 0;
+  for (let pos = 0; pos < total; pos += buf.length) {
+    const n = iso.readAt(ISO_ROOTFS_IMAGE, pos, buf, 0, Math.min(buf.length, total - pos));
+    if (n <= 0) {
+      k?.serialWrite?.(`[installer] CD read failed at byte ${pos}\n`);
+      return;
+    }
+    if (n < buf.length) buf.fill(0, n);
+    io.ataWrite(drive, partition.start + pos / 512, buf.subarray(0, Math.ceil(n / 512) * 512));
+    onProgress?.(Math.round(((pos + n) / total) * 100));
+    if (++chunks % YIELD_EVERY === 0) await new Promise(resolve => setTimeout(resolve, 0));
+  }
+}
+
 // ── [Item 900] Post-install configuration ───────────────────────────────────
 
 export interface InstallConfig {
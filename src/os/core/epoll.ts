@@ -0,0 +1,372 @@
+/**
+ * JSOS epoll — readiness-list I/O multiplexing
+ *
+ * Every pollable object (pipe rings, message queues, Unix sockets, TCP
+ * sockets, PTYs, channels, other epoll instances) exposes
+ *
+ *   poll():  current readiness as POLLIN/POLLOUT/POLLERR/POLLHUP bits
+ *   watch(): a callback fired by the *producer* when readiness changes
+ *
+ * An Epoll registers one watcher per interest.  When it fires, the item is
+ * linked onto the tail of the ready list (O(1), idempotent) and the wait
+ * queue is woken.  epoll_wait() only ever looks at the ready list, so its
+ * cost is O(ready), not O(registered fds):
+ *
+ *   • level-triggered (default): an item that is still ready after being
+ *     reported goes back on the tail of the list; poll() re-validates it on
+ *     the next wait and drops it once the condition has cleared.
+ *   • EPOLLET: an item is reported once per producer edge; callers must
+ *     drain until EAGAIN.
+ *   • EPOLLONESHOT: reported once, then disarmed until EPOLL_CTL_MOD.
+ *
+ * Objects without watch() still work: they are kept on a separate list and
+ * level-checked on each wakeup (the pre-epoll behaviour), so only legacy
+ * sources pay for scanning.
+ *
+ * Blocking: JSOS threads are cooperative, so a synchronous waiter sleeps in
+ * kernel.sleep(1) steps and re-checks a single generation counter that
+ * producers bump — O(1) per tick.  Subsystems whose producers only run when
+ * somebody pumps them (the NIC) register a wait pump that runs once per
+ * tick, independent of how many fds are watched.  waitAsync() resolves the
+ * Promise straight from the producer's wakeup instead.
+ */
+
+declare var kernel: import('./kernel.js').KernelAPI;
+
+// ── Event bits (Linux values; the low bits match POLLIN/POLLOUT/…) ──────────
+
+export const EPOLLIN      = 0x0001;
+export const EPOLLPRI     = 0x0002;
+export const EPOLLOUT     = 0x0004;
+export const EPOLLERR     = 0x0008;
+export const EPOLLHUP     = 0x0010;
+export const EPOLLRDHUP   = 0x2000;
+export const EPOLLONESHOT = 1 << 30;
+export const EPOLLET      = 1 << 31;
+
+export const EPOLL_CTL_ADD = 1;
+export const EPOLL_CTL_DEL = 2;
+export const EPOLL_CTL_MOD = 3;
+
+/** Bits that are always reported whether or not they were asked for. */
+const EPOLL_ALWAYS = EPOLLERR | EPOLLHUP;
+/** Bits that describe readiness (as opposed to EPOLLET / EPOLLONESHOT). */
+const EPOLL_EVENTS = 0xFFFF;
+
+const ENOENT = 2;
+const EEXIST = 17;
+const EINVAL = 22;
+
+/** Anything epoll can watch. */
+export interface Pollable {
+  /** Current readiness bits; a negative value means the object is gone. */
+  poll(): number;
+  /** Subscribe to readiness changes; returns an unsubscribe function. */
+  watch?(cb: (events: number) => void): () => void;
+}
+
+export interface EpollEvent {
+  events: number;
+  data:   any;
+}
+
+// ── Wait queues ──────────────────────────────────────────────────────────────
+
+/**
+ * Producer-driven wait queue.  Producers call wake(); sleepers either spin
+ * on the generation counter (sleep) or park a resolver (waitAsync).
+ */
+export class WaitQueue {
+  private _gen = 0;
+  private _async: Array<() => void> = [];
+
+  /** Wake every waiter.  Cheap when nobody is waiting. */
+  wake(): void {
+    this._gen++;
+    if (this._async.length === 0) return;
+    var list = this._async;
+    this._async = [];
+    for (var i = 0; i < list.length; i++) {
+      try { list[i](); } catch (_) {}
+    }
+  }
+
+  get generation(): number { return this._gen; }
+
+  /**
+   * Cooperatively sleep until wake() or `deadline` (kernel.getUptime() ms).
+   * Returns true if woken, false on timeout.
+   */
+  sleep(deadline: number): boolean {
+    var gen = this._gen;
+    for (;;) {
+      runWaitPumps();
+      if (this._gen !== gen) return true;
+      if (kernel.getUptime() >= deadline) return false;
+      kernel.sleep(1);
+    }
+  }
+
+  /** Resolve on the next wake(), or with false after `timeoutMs` (<0 = never). */
+  waitAsync(timeoutMs: number = -1): Promise<boolean> {
+    var self = this;
+    return new Promise<boolean>(function(resolve) {
+      var done = false;
+      var fire = function() { if (!done) { done = true; resolve(true); } };
+      self._async.push(fire);
+      if (timeoutMs >= 0) {
+        setTimeout(function() {
+          if (done) return;
+          done = true;
+          var i = self._async.indexOf(fire);
+          if (i >= 0) self._async.splice(i, 1);
+          resolve(false);
+        }, timeoutMs);
+      }
+    });
+  }
+
+  get waiters(): number { return this._async.length; }
+}
+
+// ── Wait pumps ───────────────────────────────────────────────────────────────
+
+var _pumps = new Map<string, () => void>();
+
+/**
+ * Register a per-subsystem pump run once per sleeping tick (e.g. the NIC RX
+ * path, which only delivers packets when polled).  Keyed so re-registering
+ * is a no-op.
+ */
+export function registerWaitPump(key: string, fn: () => void): void {
+  if (!_pumps.has(key)) _pumps.set(key, fn);
+}
+
+export function unregisterWaitPump(key: string): void { _pumps.delete(key); }
+
+export function runWaitPumps(): void {
+  _pumps.forEach(function(fn) { try { fn(); } catch (_) {} });
+}
+
+// ── Epoll ────────────────────────────────────────────────────────────────────
+
+interface EpItem {
+  key:     any;
+  src:     Pollable;
+  events:  number;          // requested bits | EPOLLET | EPOLLONESHOT
+  data:    any;
+  armed:   boolean;         // false after a ONESHOT report
+  queued:  boolean;         // currently on the ready list
+  next:    EpItem | null;   // ready-list link
+  unwatch: (() => void) | null;
+}
+
+export class Epoll {
+  private _items = new Map<any, EpItem>();
+  private _head: EpItem | null = null;
+  private _tail: EpItem | null = null;
+  private _queued = 0;
+  /** Items whose source cannot notify; level-checked on every wakeup. */
+  private _polled: EpItem[] = [];
+  private _watchers: Array<(events: number) => void> = [];
+  readonly wq = new WaitQueue();
+
+  /** Number of registered interests. */
+  get size(): number { return this._items.size; }
+  /** Items currently on the ready list (may include stale level entries). */
+  get readyCount(): number { return this._queued; }
+
+  /**
+   * epoll_ctl.  `key` identifies the interest (an fd number or the object
+   * itself); `data` is handed back in each event (defaults to `key`).
+   * Returns 0 or a negative errno.
+   */
+  ctl(op: number, key: any, src: Pollable | null, events: number = 0, data?: any): number {
+    var it = this._items.get(key);
+    if (op === EPOLL_CTL_ADD) {
+      if (it) return -EEXIST;
+      if (!src) return -EINVAL;
+      it = { key, src, events, data: data === undefined ? key : data,
+             armed: true, queued: false, next: null, unwatch: null };
+      this._items.set(key, it);
+      if (src.watch) it.unwatch = src.watch(this._callback(it));
+      else this._polled.push(it);
+      this._check(it);
+      return 0;
+    }
+    if (op === EPOLL_CTL_MOD) {
+      if (!it) return -ENOENT;
+      it.events = events;
+      if (data !== undefined) it.data = data;
+      it.armed = true;
+      this._check(it);
+      return 0;
+    }
+    if (op === EPOLL_CTL_DEL) {
+      if (!it) return -ENOENT;
+      this._drop(it);
+      return 0;
+    }
+    return -EINVAL;
+  }
+
+  add(key: any, src: Pollable, events: number, data?: any): number { return this.ctl(EPOLL_CTL_ADD, key, src, events, data); }
+  mod(key: any, events: number, data?: any): number { return this.ctl(EPOLL_CTL_MOD, key, null, events, data); }
+  del(key: any): number { return this.ctl(EPOLL_CTL_DEL, key, null); }
+  has(key: any): boolean { return this._items.has(key); }
+
+  /**
+   * Harvest up to `maxEvents` ready events without blocking.  Only items on
+   * the ready list (plus non-notifying sources) are examined.
+   */
+  collect(maxEvents: number): EpollEvent[] {
+    var out: EpollEvent[] = [];
+    // Bound the pass by the current length so level-triggered re-queues are
+    // not visited twice in one call.
+    var n = this._queued;
+    while (n-- > 0 && out.length < maxEvents) {
+      var it = this._dequeue()!;
+      if (!it.armed) continue;
+      var rev = this._revents(it);
+      if (rev < 0) { this._drop(it); continue; }   // source closed under us
+      if (rev === 0) continue;                       // edge already consumed
+      out.push({ events: rev, data: it.data });
+      if (it.events & EPOLLONESHOT) it.armed = false;
+      else if (!(it.events & EPOLLET)) this._enqueue(it);
+    }
+    for (var i = 0; i < this._polled.length && out.length < maxEvents; i++) {
+      var p = this._polled[i];
+      if (!p.armed) continue;
+      var prev = this._revents(p);
+      if (prev < 0) { this._drop(p); i--; continue; }
+      if (prev === 0) continue;
+      out.push({ events: prev, data: p.data });
+      if (p.events & EPOLLONESHOT) p.armed = false;
+    }
+    return out;
+  }
+
+  /**
+   * epoll_wait: block (cooperatively) until at least one event is ready or
+   * `timeoutMs` elapses (0 = non-blocking, <0 = forever).
+   */
+  wait(maxEvents: number = 64, timeoutMs: number = -1): EpollEvent[] {
+    var deadline = timeoutMs < 0 ? Infinity : kernel.getUptime() + timeoutMs;
+    for (;;) {
+      var out = this.collect(maxEvents);
+      if (out.length > 0 || timeoutMs === 0) return out;
+      var now = kernel.getUptime();
+      if (now >= deadline) return out;
+      // Non-notifying sources need a tick-by-tick recheck; otherwise sleep
+      // until a producer wakes us.
+      this.wq.sleep(this._polled.length > 0 ? Math.min(deadline, now + 1) : deadline);
+    }
+  }
+
+  /** Promise flavour of wait(); resolves from the producer's wakeup. */
+  waitAsync(maxEvents: number = 64, timeoutMs: number = -1): Promise<EpollEvent[]> {
+    var self = this;
+    var deadline = timeoutMs < 0 ? Infinity : kernel.getUptime() + timeoutMs;
+    function attempt(): Promise<EpollEvent[]> {
+      var out = self.collect(maxEvents);
+      var left = deadline - kernel.getUptime();
+      if (out.length > 0 || timeoutMs === 0 || left <= 0) return Promise.resolve(out);
+      var slice = self._polled.length > 0 ? Math.min(left, 10) : (deadline === Infinity ? -1 : left);
+      return self.wq.waitAsync(slice).then(attempt);
+    }
+    return attempt();
+  }
+
+  /** An epoll fd is itself pollable: readable while its ready list is non-empty. */
+  poll(): number {
+    return (this._queued > 0 || this._polledReady()) ? EPOLLIN : 0;
+  }
+
+  watch(cb: (events: number) => void): () => void {
+    var list = this._watchers;
+    list.push(cb);
+    return function() {
+      var i = list.indexOf(cb);
+      if (i >= 0) list.splice(i, 1);
+    };
+  }
+
+  /** Drop every interest and unsubscribe from all sources. */
+  close(): void {
+    var self = this;
+    this._items.forEach(function(it) { self._drop(it); });
+    this._items.clear();
+    this._head = this._tail = null;
+    this._queued = 0;
+    this._polled = [];
+    this.wq.wake();
+  }
+
+  // ── internals ─────────────────────────────────────────────────────────────
+
+  private _callback(it: EpItem): (events: number) => void {
+    var self = this;
+    return function(ev: number) {
+      if (!it.armed) return;
+      if ((ev & ((it.events & EPOLL_EVENTS) | EPOLL_ALWAYS)) === 0) return;
+      self._enqueue(it);
+    };
+  }
+
+  private _revents(it: EpItem): number {
+    var r: number;
+    try { r = it.src.poll(); } catch (_) { r = EPOLLERR; }
+    if (r < 0) return r;
+    return r & ((it.events & EPOLL_EVENTS) | EPOLL_ALWAYS);
+  }
+
+  /** Queue `it` if it is ready right now (ADD / MOD semantics). */
+  private _check(it: EpItem): void {
+    if (!it.src.watch) { if (this._polledReady()) this._signal(); return; }
+    if (this._revents(it) !== 0) this._enqueue(it);
+  }
+
+  private _enqueue(it: EpItem): void {
+    if (it.queued) return;
+    it.queued = true;
+    it.next = null;
+    if (this._tail) this._tail.next = it; else this._head = it;
+    this._tail = it;
+    if (this._queued++ === 0) this._signal();
+  }
+
+  private _dequeue(): EpItem | null {
+    var it = this._head;
+    if (!it) return null;
+    this._head = it.next;
+    if (!this._head) this._tail = null;
+    it.next = null;
+    it.queued = false;
+    this._queued--;
+    return it;
+  }
+
+  private _drop(it: EpItem): void {
+    this._items.delete(it.key);
+    it.armed = false;           // a queued entry is skipped by collect()
+    if (it.unwatch) { it.unwatch(); it.unwatch = null; }
+    else {
+      var i = this._polled.indexOf(it);
+      if (i >= 0) this._polled.splice(i, 1);
+    }
+  }
+
+  private _polledReady(): boolean {
+    for (var i = 0; i < this._polled.length; i++) {
+      if (this._polled[i].armed && this._revents(this._polled[i]) !== 0) return true;
+    }
+    return false;
+  }
+
+  private _signal(): void {
+    this.wq.wake();
+    for (var i = 0; i < this._watchers.length; i++) {
+      try { this._watchers[i](EPOLLIN); } catch (_) {}
+    }
+  }
+}
@@ -6,22 +6,23 @@
  */
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
+import { ByteRing, RING_READABLE, RING_WRITABLE, RING_DEFAULT_CAPACITY, type RingWatcher } from './ringbuf.js';
+import { Epoll, type EpollEvent } from './epoll.js';
+import type { FileData } from '../fs/filedata.js';
 
-/** A simple ring-buffer used by pipes. */
-class RingBuffer {
-  private _buf: number[] = [];
+/** errno values returned (negated) by FileDescription read/write paths. */
+const EAGAIN = 11;
+const EBADF  = 9;
+const EINVAL = 22;
+const EPIPE  = 32;
 
-  write(data: number[]): number {
-    for (var i = 0; i < data.length; i++) this._buf.push(data[i]);
-    return data.length;
-  }
+/** fcntl() commands / flags (Linux values). */
+export const F_GETFL    = 3;
+export const F_SETFL    = 4;
+export const O_NONBLOCK = 0x800;
 
-  read(n: number): number[] {
-    return this._buf.splice(0, n);
-  }
-
-  available(): number { return this._buf.length; }
-}
+/** How long a blocking pipe read/write waits for the other end (ticks, 1 s). */
+const PIPE_BLOCK_TICKS = 1000;
 
 /** Abstract file description — every open fd points to one. */
 export interface FileDescription {
@@ -31,8 +32,19 @@ export interface FileDescription {
   close(): void;
   /** Optional device-control call (e.g. DRM ioctls). */
   ioctl?(request: number, arg: number): number;
+  /** Optional zero-array read into a byte buffer.  Returns bytes or -errno. */
+  readInto?(dst: Uint8Array, off: number, len: number): number;
+  /** Optional zero-array write from a byte buffer.  Returns bytes or -errno. */
+  writeFrom?(src: Uint8Array, off: number, len: number): number;
+  /** Optional readiness (POLLIN/POLLOUT/POLLHUP bits); absent = always ready. */
+  poll?(): number;
+  /** Optional readiness edge notification; returns an unsubscribe function. */
+  watch?(cb: RingWatcher): () => void;
+  /** Called when another fd starts sharing this description (dup/fork). */
+  retain?(): void;
+  /** O_NONBLOCK state for descriptions that can block. */
+  nonBlocking?: boolean;
 }
-
 /** Terminal stdin/stdout/stderr shim. */
 class TerminalDescription implements FileDescription {
   private _isRead: boolean;
@@ -55,24 +67,77 @@ class TerminalDescription implements FileDescription {
   close(): void {}
 }
 
-/** Read end of a pipe. */
+/**
+ * Read end of a pipe.  The ring is shared with the write end; `_refs`
+ * counts fds sharing this description so dup()/fork() copies do not hang
+ * the pipe up when one of them closes.
+ */
 class PipeReadDescription implements FileDescription {
-  constructor(private _buf: RingBuffer) {}
+  nonBlocking = false;
+  private _refs = 1;
+  constructor(readonly ring: ByteRing) {}
+
+  read(count: number): number[] { return this.ring.readArray(count); }
+
+  readInto(dst: Uint8Array, off: number, len: number): number {
+    var n = this.ring.read(dst, off, len);
+    if (n > 0 || this.ring.writerClosed) return n;      // data, or EOF
+    if (this.nonBlocking) return -EAGAIN;
+    var deadline = kernel.getTicks() + PIPE_BLOCK_TICKS;
+    while (this.ring.available === 0 && !this.ring.writerClosed) {
+      if (kernel.getTicks() >= deadline) return -EAGAIN;
+      kernel.sleep(1);
+    }
+    return this.ring.read(dst, off, len);
+  }
 
-  read(count: number): number[] { return this._buf.read(count); }
-  write(data: number[]): number { return -1; } // EBADF
+  write(data: number[]): number { return -EBADF; }
+  writeFrom(src: Uint8Array, off: number, len: number): number { return -EBADF; }
   seek(offset: number, whence: number): number { return -1; }
-  close(): void {}
+  poll(): number { return this.ring.poll() & ~RING_WRITABLE; }
+  watch(cb: RingWatcher): () => void { return this.ring.watch(cb); }
+  retain(): void { this._refs++; }
+  close(): void { if (--this._refs === 0) this.ring.closeRead(); }
 }
 
 /** Write end of a pipe. */
 class PipeWriteDescription implements FileDescription {
-  constructor(private _buf: RingBuffer) {}
+  nonBlocking = false;
+  private _refs = 1;
+  constructor(readonly ring: ByteRing) {}
 
   read(count: number): number[] { return []; } // EBADF
-  write(data: number[]): number { return this._buf.write(data); }
+  readInto(dst: Uint8Array, off: number, len: number): number { return -EBADF; }
+
+  write(data: number[]): number { return this._write(data, 0, data.length); }
+  writeFrom(src: Uint8Array, off: number, len: number): number { return this._write(src, off, len); }
+
+  /**
+   * Non-blocking: accept what fits, -EAGAIN if nothing does.
+   * Blocking: yield (kernel.sleep) while the ring is full until everything
+   * is written, the reader goes away (-EPIPE) or it stalls for 1 s, in which
+   * case the partial count is returned.
+   */
+  private _write(src: Uint8Array | number[], off: number, len: number): number {
+    var done = 0;
+    var deadline = kernel.getTicks() + PIPE_BLOCK_TICKS;
+    while (done < len) {
+      var n = this.ring.write(src, off + done, len - done);
+      if (n < 0) return done > 0 ? done : -EPIPE;
+      done += n;
+      if (done === len) break;
+      if (n > 0) deadline = kernel.getTicks() + PIPE_BLOCK_TICKS;
+      if (this.nonBlocking || kernel.getTicks() >= deadline) break;
+      kernel.sleep(1);
+    }
+    return done > 0 || len === 0 ? done : -EAGAIN;
+  }
+
   seek(offset: number, whence: number): number { return -1; }
-  close(): void {}
+  poll(): number { return this.ring.poll() & ~RING_READABLE; }
+  watch(cb: RingWatcher): () => void { return this.ring.watch(cb); }
+  retain(): void { this._refs++; }
+  close(): void { if (--this._refs === 0) this.ring.closeWrite(); }
 }
 
 /** /dev/null */
@@ -114,9 +179,58 @@ class DevUrandomDescription implements FileDescription {
   close(): void {}
 }
 
+/**
+ * A regular file's live chunked body as a file description.
+ * Reads and writes go straight to the FileData at the file offset — no
+ * whole-file copy on open and no rewrite on close.
+ */
+export class FileDataDescription implements FileDescription {
+  private _pos = 0;
+
+  constructor(readonly data: FileData, private _onWrite?: () => void) {}
+
+  get position(): number { return this._pos; }
+
+  read(count: number): number[] {
+    var buf = new Uint8Array(Math.max(0, Math.min(count, this.data.length - this._pos)));
+    var n = this.readInto(buf, 0, buf.length);
+    return Array.from(buf.subarray(0, n));
+  }
+
+  readInto(dst: Uint8Array, off: number, len: number): number {
+    var n = this.data.pread(dst, off, len, this._pos);
+    this._pos += n;
+    return n;
+  }
+
+  write(data: number[]): number {
+    return this.writeFrom(Uint8Array.from(data), 0, data.length);
+  }
+
+  writeFrom(src: Uint8Array, off: number, len: number): number {
+    var n = this.data.pwrite(src, off, len, this._pos);
+    this._pos += n;
+    if (this._onWrite) this._onWrite();
+    return n;
+  }
+
+  /** Advance the position after bytes were consumed elsewhere (sendfile). */
+  advance(n: number): void { this._pos += n; }
+
+  seek(offset: number, whence: number): number {
+    if      (whence === 0) this._pos = offset;                    // SEEK_SET
+    else if (whence === 1) this._pos += offset;                   // SEEK_CUR
+    else if (whence === 2) this._pos = this.data.length + offset; // SEEK_END
+    if (this._pos < 0) this._pos = 0;
+    return this._pos;
+  }
+
+  close(): void {}
+}
+
 /**
  * Wraps a VFS string buffer as a seekable, writable POSIX file description.
- * Created by FDTable.openPath() to give fd semantics to in-memory FS files.
+ * Created by FDTable.openPath() for mounts that only expose text.
  */
 export class VFSFileDescription implements FileDescription {
   private _data: number[];
@@ -202,25 +316,49 @@ export class SocketDescription implements FileDescription {
 
   seek(_offset: number, _whence: number): number { return -1; } // not seekable
   close(): void { this._net.close(this._sock); }
+
+  poll(): number {
+    return this._net.pollSocket ? this._net.pollSocket(this._sock) : (RING_READABLE | RING_WRITABLE);
+  }
+
+  watch(cb: RingWatcher): () => void {
+    return this._net.watchSocket ? this._net.watchSocket(this._sock, cb) : function() {};
+  }
+}
+
+/**
+ * An epoll instance installed as an fd (epoll_create).  It is pollable
+ * itself, so epoll fds can be nested or handed to poll().
+ */
+export class EpollDescription implements FileDescription {
+  readonly ep = new Epoll();
+  read(_count: number): number[] { return []; }
+  write(_data: number[]): number { return -EINVAL; }
+  seek(_offset: number, _whence: number): number { return -1; }
+  close(): void { this.ep.close(); }
+  poll(): number { return this.ep.poll(); }
+  watch(cb: RingWatcher): () => void { return this.ep.watch(cb); }
 }
 
 /**
- * Pipe: a pair of connected read/write file descriptions.
+ * Pipe: a pair of connected read/write file descriptions over one bounded
+ * ByteRing (default 64 KB).
  * Used both as a standalone object and inserted into an FDTable.
  */
 export class Pipe {
-  private _buf: RingBuffer = new RingBuffer();
+  readonly ring: ByteRing;
   readonly reader: PipeReadDescription;
   readonly writer: PipeWriteDescription;
 
-  constructor() {
-    this.reader = new PipeReadDescription(this._buf);
-    this.writer = new PipeWriteDescription(this._buf);
+  constructor(capacity: number = RING_DEFAULT_CAPACITY) {
+    this.ring   = new ByteRing(capacity);
+    this.reader = new PipeReadDescription(this.ring);
+    this.writer = new PipeWriteDescription(this.ring);
   }
 
   write(data: number[]): number { return this.writer.write(data); }
   read(count: number): number[] { return this.reader.read(count); }
-  available(): number { return this._buf.available(); }
+  available(): number { return this.ring.available; }
 }
 
 /**
@@ -255,9 +393,9 @@ export class FDTable {
     return fd;
   }
 
-  /** Create a pipe and return [readFd, writeFd]. */
-  pipe(): [number, number] {
-    var p = new Pipe();
+  /** Create a pipe (capacity in bytes, rounded to a power of two) and return [readFd, writeFd]. */
+  pipe(capacity?: number): [number, number] {
+    var p = new Pipe(capacity);
     var rfd = this.insert(p.reader);
     var wfd = this.insert(p.writer);
     return [rfd, wfd];
@@ -277,6 +415,154 @@ export class FDTable {
     return d ? d.write(data) : -1;
   }
 
+  /**
+   * Read into `dst[off…off+len)` without an intermediate number[] when the
+   * description supports it.  Returns bytes read or a negative errno.
+   */
+  readInto(fd: number, dst: Uint8Array, off: number, len: number): number {
+    var d = this._fds.get(fd);
+    if (!d) return -EBADF;
+    if (d.readInto) return d.readInto(dst, off, len);
+    var data = d.read(len);
+    for (var i = 0; i < data.length; i++) dst[off + i] = data[i];
+    return data.length;
+  }
+
+  /** Write `src[off…off+len)`.  Returns bytes written or a negative errno. */
+  writeFrom(fd: number, src: Uint8Array, off: number, len: number): number {
+    var d = this._fds.get(fd);
+    if (!d) return -EBADF;
+    if (d.writeFrom) return d.writeFrom(src, off, len);
+    var data = new Array<number>(len);
+    for (var i = 0; i < len; i++) data[i] = src[off + i];
+    var n = d.write(data);
+    return n < 0 ? -EBADF : n;
+  }
+
+  /** Readiness of `fd` as POLLIN/POLLOUT/POLLHUP bits; -EBADF if not open. */
+  pollFd(fd: number): number {
+    var d = this._fds.get(fd);
+    if (!d) return -EBADF;
+    return d.poll ? d.poll() : (RING_READABLE | RING_WRITABLE);
+  }
+
+  /** Subscribe to readiness edges on `fd`; null if the fd cannot notify. */
+  watch(fd: number, cb: RingWatcher): (() => void) | null {
+    var d = this._fds.get(fd);
+    return d && d.watch ? d.watch(cb) : null;
+  }
+
+  /** epoll_create: returns the new epoll fd (or -1 when out of fds). */
+  epollCreate(): number {
+    return this.insert(new EpollDescription());
+  }
+
+  /**
+   * epoll_ctl(epfd, op, fd, events): register interest in `fd`.  Readiness
+   * comes from the description's poll(); descriptions with watch() push
+   * themselves onto the ready list, the rest are level-checked on wakeup.
+   * `data` defaults to the fd number.  Returns 0 or a negative errno.
+   */
+  epollCtl(epfd: number, op: number, fd: number, events: number = 0, data?: any): number {
+    var e = this._fds.get(epfd);
+    if (!(e instanceof EpollDescription)) return -EINVAL;
+    var d = this._fds.get(fd);
+    if (!d) return -EBADF;
+    if (d === e) return -EINVAL;
+    var self = this;
+    var src = {
+      poll: function() { return self._fds.get(fd) === d ? (d!.poll ? d!.poll() : (RING_READABLE | RING_WRITABLE)) : -EBADF; },
+      watch: d.watch ? function(cb: RingWatcher) { return d!.watch!(cb); } : undefined,
+    };
+    return e.ep.ctl(op, fd, src, events, data);
+  }
+
+  /**
+   * epoll_wait: up to `maxEvents` ready events, waiting at most `timeoutMs`
+   * (0 = non-blocking, <0 = forever).  Interests whose fd has been closed
+   * are dropped silently, as on Linux.  Returns events or a negative errno.
+   */
+  epollWait(epfd: number, maxEvents: number, timeoutMs: number = -1): EpollEvent[] | number {
+    var e = this._fds.get(epfd);
+    if (!(e instanceof EpollDescription)) return -EINVAL;
+    if (maxEvents <= 0) return -EINVAL;
+    return e.ep.wait(maxEvents, timeoutMs);
+  }
+
+  /** fcntl(F_GETFL / F_SETFL) — only O_NONBLOCK is meaningful here. */
+  fcntl(fd: number, cmd: number, arg: number = 0): number {
+    var d = this._fds.get(fd);
+    if (!d) return -EBADF;
+    if (cmd === F_GETFL) return d.nonBlocking ? O_NONBLOCK : 0;
+    if (cmd === F_SETFL) {
+      if (d.nonBlocking !== undefined) d.nonBlocking = (arg & O_NONBLOCK) !== 0;
+      return 0;
+    }
+    return -EINVAL;
+  }
+
+  /**
+   * splice(2): move up to `len` bytes from `fdIn` to `fdOut`.  Pipe to pipe
+   * is a direct ring-to-ring copy; otherwise bytes go through one Uint8Array
+   * (never a JS number[]).  Returns bytes moved or a negative errno.
+   */
+  splice(fdIn: number, fdOut: number, len: number): number {
+    var din = this._fds.get(fdIn), dout = this._fds.get(fdOut);
+    if (!din || !dout) return -EBADF;
+    if (din instanceof PipeReadDescription && dout instanceof PipeWriteDescription) {
+      var moved = din.ring.spliceTo(dout.ring, len);
+      if (moved < 0) return -EPIPE;
+      return moved === 0 && !din.ring.eof ? -EAGAIN : moved;   // empty source or full sink
+    }
+    if (din instanceof PipeReadDescription) {
+      // Peek first so bytes the destination refuses stay in the pipe.
+      var buf = new Uint8Array(Math.min(len, din.ring.available));
+      din.ring.peek(buf);
+      var w = this.writeFrom(fdOut, buf, 0, buf.length);
+      if (w > 0) din.ring.skip(w);
+      return w;
+    }
+    if (dout instanceof PipeWriteDescription) {
+      var tmp = new Uint8Array(Math.min(len, dout.ring.space));
+      var r = this.readInto(fdIn, tmp, 0, tmp.length);
+      if (r <= 0) return r;
+      return this.writeFrom(fdOut, tmp, 0, r);
+    }
+    return -EINVAL;                       // Linux: one end must be a pipe
+  }
+
+  /**
+   * sendfile(2): copy up to `count` bytes of regular file `fdIn` to `fdOut`
+   * from `offset` (or the file position, which then advances).  The file's
+   * chunks are passed to the destination as views — no intermediate buffer.
+   * Returns bytes sent or a negative errno.
+   */
+  sendfile(fdOut: number, fdIn: number, offset: number | null, count: number): number {
+    var din = this._fds.get(fdIn), dout = this._fds.get(fdOut);
+    if (!din || !dout) return -EBADF;
+    if (!(din instanceof FileDataDescription)) return -EINVAL;
+    var from = offset === null ? din.position : offset;
+    var views = din.data.views(from, count);
+    var sent = 0;
+    for (var i = 0; i < views.length; i++) {
+      var w = this.writeFrom(fdOut, views[i], 0, views[i].length);
+      if (w < 0) return sent > 0 ? sent : w;
+      sent += w;
+      if (w < views[i].length) break;     // destination is full
+    }
+    if (offset === null) din.advance(sent);
+    return sent;
+  }
+
+  /** tee(2): copy up to `len` bytes between two pipes without consuming them. */
+  tee(fdIn: number, fdOut: number, len: number): number {
+    var din = this._fds.get(fdIn), dout = this._fds.get(fdOut);
+    if (!din || !dout) return -EBADF;
+    if (!(din instanceof PipeReadDescription) || !(dout instanceof PipeWriteDescription)) return -EINVAL;
+    var n = din.ring.teeTo(dout.ring, len);
+    return n < 0 ? -EPIPE : n;
+  }
+
   close(fd: number): void {
     var d = this._fds.get(fd);
     if (d) { d.close(); this._fds.delete(fd); }
@@ -285,13 +571,18 @@ export class FDTable {
   dup(fd: number): number {
     var d = this._fds.get(fd);
     if (!d) return -1;
-    return this.insert(d); // shared reference
+    var nfd = this.insert(d); // shared reference
+    if (nfd >= 0 && d.retain) d.retain();
+    return nfd;
   }
 
   /** Clone this table (for fork). */
   clone(): FDTable {
     var t = new FDTable();
-    this._fds.forEach(function(desc, fd) { t._fds.set(fd, desc); });
+    this._fds.forEach(function(desc, fd) {
+      t._fds.set(fd, desc);
+      if (desc.retain) desc.retain();
+    });
     t._nextFd = this._nextFd;
     return t;
   }
@@ -314,10 +605,15 @@ export class FDTable {
 
   /**
    * Open a VFS path through `fsInst` (a FileSystem instance) and return its fd.
-   * The underlying content is read into a VFSFileDescription buffer; writes are
-   * flushed back to the FS on close().  Returns -1 if the path does not exist.
+   * Regular files with a byte body are opened in place (FileDataDescription);
+   * text-only mounts are read into a VFSFileDescription buffer whose writes
+   * are flushed back on close().  Returns -1 if the path does not exist.
    */
   openPath(path: string, fsInst: any): number {
+    var data: FileData | null = fsInst.fileData ? fsInst.fileData(path) : null;
+    if (data) {
+      return this.insert(new FileDataDescription(data, function() { fsInst.markModified(path); }));
+    }
     var content: string | null = fsInst.readFile(path);
     if (content === null) return -1;
     return this.insert(new VFSFileDescription(content, function(data: number[]) {
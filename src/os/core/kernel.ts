@@ -138,12 +138,22 @@ export interface KernelAPI {
    * Returns a flat byte array of length `sectors * 512`, or null on error.
    */
   ataRead(lba: number, sectors: number): number[] | null;
+  /** True if a virtio-blk disk was initialised at boot. */
+  virtioBlkPresent?(): boolean;
   /**
    * Write `sectors` (1-8) sectors starting at `lba`.
    * `data` must be a flat byte array of exactly `sectors * 512` bytes.
    * Returns true on success.
    */
   ataWrite(lba: number, sectors: number, data: number[]): boolean;
+  /** 1 if the primary master is ATAPI (CD/DVD), 0 if ATA, -1 if absent. */
+  ataIsAtapi?(): number;
+  /**
+   * Send a 12-byte ATAPI command packet (READ(10), READ CAPACITY, ...) and
+   * PIO-read its data phase, up to 64 KB, directly into `buf`.
+   * Returns the number of bytes stored, or -1 on error (issue REQUEST SENSE).
+   */
+  atapiPacket?(packet: Uint8Array, buf?: Uint8Array | ArrayBuffer | null): number;
 
   // ─ Framebuffer (Phase 3) ─────────────────────────────────────────────────
   /**
@@ -187,6 +197,13 @@ export interface KernelAPI {
    * resets the counter to zero.  Use this to decide when to call yield().
    */
   schedTick(): number;
+  /**
+   * C kernel threads: thread 0 is the boot stack running QuickJS,
+   * the rest are driver threads (e.g. knetrxd) on guard-flanked stacks.
+   */
+  kthreadList?(): Array<{ id: number; name: string; state: string; stack: number;
+    stackBytes: number; switches: number; wakeups: number; runUs: number;
+    overflowed: boolean }>;
   /**
    * Drain all pending QuickJS Promise microtasks (JS jobs) for the main runtime.
    * Must be called periodically from the JS event loop so that Promise .then()
@@ -238,6 +255,28 @@ export interface KernelAPI {
    */
   enablePaging(): boolean;
 
+  // ─ Bulk page-table primitives ────────────────────────────────────────────
+  // `pd` is 0 for the kernel directory or a cloneAddressSpace() handle.
+  // Ranges are (va, npages), page-aligned; flags are PTE bits (0x2 W, 0x4 U,
+  // 0x10 PCD).  Range calls return pages affected, or -1 when a 4 MB
+  // identity PDE is in the way or memory runs out (partial work undone).
+  /** Map `npages` consecutive physical frames starting at `phys`. */
+  ptMapRange?(pd: number, va: number, phys: number, npages: number, flags: number): number;
+  /** Map `npages` fresh zeroed, refcounted frames. */
+  ptMapAnon?(pd: number, va: number, npages: number, flags: number): number;
+  ptUnmapRange?(pd: number, va: number, npages: number): number;
+  /** Replace W/U/PCD on present pages; COW shares stay read-only until they fault. */
+  ptProtectRange?(pd: number, va: number, npages: number, flags: number): number;
+  /** fork(): share the range into `dstPd`, write-protecting owned frames as COW in both. */
+  ptCloneCow?(dstPd: number, srcPd: number, va: number, npages: number): number;
+  /** Resolve a write fault: 1 copied/reclaimed, 0 not a COW page, -1 OOM. */
+  ptCowFault?(pd: number, va: number): number;
+  /** Raw PTE for `va` (0x200 = COW, 0x400 = owned frame); 0 if unmapped. */
+  ptQuery?(pd: number, va: number): number;
+  /** Present 4 KB pages in the range. */
+  ptCount?(pd: number, va: number, npages: number): number;
+  ptStats?(): { tables: number; frames: number; cowShared: number; cowCopies: number; cowReuses: number };
+
   // ─ Scheduler hook + TSS (Phase 5) ────────────────────────────────────────
   /**
    * Register the TypeScript scheduler tick function.
@@ -258,6 +297,8 @@ export interface KernelAPI {
    * TypeScript treats the return value as an opaque CR3 handle.
    */
   cloneAddressSpace(): number;
+  /** Free a cloneAddressSpace() directory with all its mappings. False while it is in CR3. */
+  freeAddressSpace?(pd: number): boolean;
   /**
    * Switch to ring-3 (user mode) at eip with stack pointer esp.
    * Phase 6 stub: no-op (real ring-3 transition added in Phase 9).
@@ -287,6 +328,11 @@ export interface KernelAPI {
    * Max frame length is 1514 bytes.
    */
   netRecvFrame(): number[] | null;
+  /**
+   * Block until netRecvFrame() has a frame or `ms` pass; true = frame ready.
+   * Sleeps on the NIC's RX interrupt via the knetrxd kernel thread.
+   */
+  netWaitRx?(ms: number): boolean;
   /**
    * Returns the NIC's MAC address as a 6-element number[].
    */
@@ -301,8 +347,12 @@ export interface KernelAPI {
   netDebugQueues(): number;
 
   // ─ Multi-process pool (Phase 10) ───────────────────────────────────
-  /** Allocate a new isolated QuickJS runtime slot. Returns id 0-7, or -1 if all 8 are taken. */
-  procCreate(): number;
+  /**
+   * Allocate a new isolated QuickJS runtime slot. Returns id 0-15, or -1 if all 16 are taken.
+   * ringBytes sizes each IPC ring (default 128 KB, power of two, 4 KB–16 MB);
+   * the largest single message is half a ring.
+   */
+  procCreate(ringBytes?: number): number;
   /** Evaluate code in child runtime synchronously. Returns result string or 'Error:...'. */
   procEval(id: number, code: string): string;
   /**
@@ -312,33 +362,110 @@ export interface KernelAPI {
   procEvalSlice(id: number, code: string, maxMs: number): string;
   /** Pump the child's pending async/Promise job queue. Returns jobs-run count. */
   procTick(id: number): number;
-  /** Push a string message into child inbox ring buffer. Returns false if full (8 slots). */
-  procSend(id: number, msg: string): boolean;
-  /** Pop a string message from child outbox. Returns null when empty. */
-  procRecv(id: number): string | null;
+  /**
+   * Copy a string or binary (ArrayBuffer / typed array) message into the child
+   * inbox ring. Returns false if the ring is full or msg exceeds maxMessage.
+   */
+  procSend(id: number, msg: string | ArrayBuffer | ArrayBufferView): boolean;
+  /** Queue several messages in order; stops at the first that does not fit. Returns the count queued. */
+  procSendBatch?(id: number, msgs: Array<string | ArrayBuffer | ArrayBufferView>): number;
+  /** Pop one message from child outbox (binary arrives as ArrayBuffer). Returns null when empty. */
+  procRecv(id: number): string | ArrayBuffer | null;
+  /** Drain up to max (0 = all) outbox messages in one pass, oldest first. */
+  procRecvBatch?(id: number, max?: number): Array<string | ArrayBuffer>;
+  /** Bitmask of children that posted since the last call (bit i = proc id i); clears it. */
+  procDoorbell?(): number;
+  /** IPC ring geometry and occupancy for one child, or null. */
+  procRingInfo?(id: number): { size: number; maxMessage: number; inCount: number; inBytes: number;
+                               outCount: number; outBytes: number } | null;
   /** Free a child runtime and release the slot. */
   procDestroy(id: number): void;
   /** Returns true if the slot is live. */
   procAlive(id: number): boolean;
-  /** List all live child process slots: [{id, inboxCount, outboxCount}]. */
-  procList(): Array<{ id: number; inboxCount: number; outboxCount: number }>;
+  /** List all live child process slots: [{id, inboxCount, outboxCount, cpu}] (cpu 0 = BSP). */
+  procList(): Array<{ id: number; inboxCount: number; outboxCount: number; cpu?: number }>;
+
+  // ─ Zygote runtimes ─────────────────────────────────────────────────
+  /**
+   * Build a frozen, pre-initialised child runtime from `code` in its own
+   * address space.  Returns a zygote id (0-3), or -1 (paging off, no slot,
+   * or `code` threw).  Start-up code should not post messages or open
+   * shared buffers — that state would be shared by every clone.
+   */
+  zygoteCreate?(code: string): number;
+  /** New child (procCreate id space) sharing the zygote's heap copy-on-write; -1 on failure. */
+  zygoteSpawn?(zid: number, ringBytes?: number): number;
+  /** Drop a zygote; children already spawned are unaffected. */
+  zygoteDestroy?(zid: number): boolean;
+  /** Arena pages shared by each spawn, live heap bytes, spawn count. */
+  zygoteInfo?(zid: number): { pages: number; usedBytes: number; spawns: number } | null;
 
-  // ─ Shared memory buffers (Phase 10) ────────────────────────────────
+  // ─ SMP (item 31) ───────────────────────────────────────────────────
   /**
-   * Allocate a shared BSS buffer (max 256 KB). Returns id 0-7, or -1 if all 8 slots are taken.
-   * The same physical memory is accessible from any runtime via sharedBufferOpen(id).
+   * Queue an eval of `code` in child `id` on application processor `cpu`
+   * (≤ 0 = least-loaded AP).  maxMs > 0 arms the slice deadline.
+   * Returns the CPU index, or -1 if no AP is online or the child is busy.
+   */
+  procRunOn?(id: number, cpu: number, code: string, maxMs?: number): number;
+  /** Result of procRunOn: null while queued/running, else 'done:…' | 'error:…' | 'timeout'. */
+  procRunResult?(id: number): string | null;
+  /** Number of online CPUs, BSP included (1 when booted with `nosmp`). */
+  smpCpuCount?(): number;
+  /** Per-CPU state of every online processor. */
+  smpInfo?(): Array<{ cpu: number; apicId: number; online: boolean; busy: boolean;
+                      ticks: number; jobsDone: number; queued: number }>;
+
+  // ─ Shared memory regions (Phase 10) ────────────────────────────────
+  /**
+   * Allocate an anonymous page-aligned shared region (up to 256 MB, up to 64 live).
+   * Returns an id, or -1. The caller holds one reference; the same physical
+   * memory is accessible from any runtime via sharedBufferOpen(id).
    */
   sharedBufferCreate(size: number): number;
   /**
-   * Get an ArrayBuffer view of shared slot id. Zero-copy — same physical bytes.
+   * Get an ArrayBuffer view of region id. Zero-copy — same physical bytes.
    * Callable from both parent runtime and child kernel.sharedBufferOpen(id).
-   * Returns null if the id is invalid or unallocated.
+   * The view keeps the region alive until it is garbage-collected.
+   * Returns null if the id is invalid or stale.
    */
   sharedBufferOpen(id: number): ArrayBuffer | null;
-  /** Release a shared buffer slot (bytes stay in BSS until reused). */
-  sharedBufferRelease(id: number): void;
-  /** Returns the byte size allocated for a shared buffer slot, or 0. */
+  /** Drop one reference held by this runtime. Returns false if it held none. */
+  sharedBufferRelease(id: number): boolean;
+  /** Returns the byte size of a region, or 0. */
   sharedBufferSize(id: number): number;
+  /** Create a named region (one reference). Returns id, or -1 if the name is taken. */
+  shmCreate?(name: string, size: number): number;
+  /** Take a reference to a named region. Returns id, or -1. */
+  shmOpen?(name: string): number;
+  /** Remove a name; existing references stay valid. */
+  shmUnlink?(name: string): boolean;
+  /** Live regions with their total reference counts. */
+  shmList?(): Array<{ id: number; name: string; size: number; refs: number }>;
+  /**
+   * Detach `buf` in this runtime and return a transfer id for bufferAccept().
+   * Region-backed buffers move without copying; others are copied once. -1 on failure.
+   */
+  bufferTransfer?(buf: ArrayBuffer): number;
+  /** Claim a transferred buffer in this runtime. Null if `id` is not a pending transfer. */
+  bufferAccept?(id: number): ArrayBuffer | null;
+
+  // ─ io_uring SQ/CQ rings — main runtime only ──────────────────────────────
+  /**
+   * Allocate a submission/completion ring pair in one shared region.
+   * `entries` is rounded to a power of two in [8, 4096]; the CQ is twice as
+   * deep.  Map the region with sharedBufferOpen(shm) — never release it.
+   */
+  uringSetup?(entries: number): { ring: number; shm: number; entries: number; sqeOff: number; cqeOff: number } | null;
+  /** Make shared region `shmId` fixed buffer `idx` (0-15); shmId < 0 unregisters. */
+  uringRegisterBuffer?(ring: number, idx: number, shmId: number): boolean;
+  /**
+   * Consume up to `toSubmit` published SQEs and post their CQEs (completion
+   * is polled, so every CQE exists on return).  Returns SQEs consumed, -1 for a bad ring.
+   */
+  uringEnter?(ring: number, toSubmit: number): number;
+  uringInfo?(ring: number): { enters: number; sqes: number; driverCalls: number; sqDropped: number; cqOverflow: number } | null;
+  /** Release the ring and its holds on registered buffers. */
+  uringDestroy?(ring: number): boolean;
 
   // ─ JIT compiler primitives (Phase 11) ─────────────────────────────────────
   /**
@@ -507,10 +634,52 @@ export interface KernelAPI {
 
   // ─ Initramfs (item 168) ───────────────────────────────────────────────────
   /**
-   * Return the embedded CPIO initramfs image as an ArrayBuffer, or null if
-   * no initramfs was embedded in the kernel binary.
+   * The initramfs loaded by GRUB as a Multiboot2 module (gzip, LZ4 or plain
+   * cpio), as a no-copy ArrayBuffer over the module memory, or null when no
+   * module was loaded.  Treat as read-only.
    */
   getInitramfs(): ArrayBuffer | null;
+  /** Physical byte range of that module, or null; physalloc.ts reserves it. */
+  getInitramfsRange?(): { addr: number; len: number } | null;
+  /**
+   * Native LZ4 block codec: compress / decompress `src` into the
+   * caller's `dst`.  Returns the number of bytes written, or -1 when `dst`
+   * is too small or the input is malformed.
+   */
+  lz4Compress?(src: Uint8Array | ArrayBuffer, dst: Uint8Array | ArrayBuffer): number;
+  lz4Decompress?(src: Uint8Array | ArrayBuffer, dst: Uint8Array | ArrayBuffer): number;
+  /**
+   * Native CRC-32C register update: SSE4.2 when the CPU has it,
+   * slicing-by-8 otherwise.  Same convention as fs/crc.ts crc32c().
+   */
+  crc32c?(crc: number, buf: Uint8Array | ArrayBuffer, off?: number, len?: number): number;
+  /**
+   * Image decode kernels, also present in child runtimes so the
+   * browser's decode pool workers use them.  jpegIdct inverse-transforms a
+   * band of blocksW×blocksH natural-order coefficient blocks to n×n samples
+   * (n = 8, 4, 2, 1) and clears `coef`; jpegColor converts Y/Cb/Cr planes
+   * (chroma upsampled by hs×vs) or a grey plane to 0xFFRRGGBB; pngUnfilter
+   * reconstructs `rows` filtered scanlines and returns the source offset
+   * after them; with `cont` the row above dst[dstOff] is the one before it
+   * rather than zero (streaming decode).  img-jpeg.ts / img-png.ts
+   * have identical JS fallbacks.
+   */
+  jpegIdct?(coef: Int16Array, qt: Uint16Array, plane: Uint8Array, planeOff: number,
+            stride: number, blocksW: number, blocksH: number, n: number): void;
+  jpegColor?(out: Uint32Array, outOff: number, w: number, h: number,
+             y: Uint8Array, yStride: number, cb?: Uint8Array, cr?: Uint8Array,
+             cStride?: number, hs?: number, vs?: number): void;
+  pngUnfilter?(src: Uint8Array, srcOff: number, dst: Uint8Array, dstOff: number,
+               stride: number, rows: number, bpp: number, cont?: boolean): number;
+  /**
+   * Span compositing for the browser rasterizer: source-over
+   * `count` spans (Int32 quads y, x, len, coverage 0-255) onto a 32-bit
+   * surface `width` pixels wide, alpha in the top byte.  The source is
+   * `color`, or `paint` words taken in span order; `mask` scales coverage
+   * per surface pixel.  apps/browser/raster.ts has the identical fallback.
+   */
+  spanBlend?(dst: Uint32Array, width: number, spans: Int32Array, count: number,
+             color: number, paint?: Uint32Array | null, mask?: Uint8Array | null): void;
 
   // ─ Zero-copy NIC DMA (item 922) ──────────────────────────────────────────
   /**
@@ -547,6 +716,14 @@ export interface KernelAPI {
    */
   scheduleIdle(fn: () => void): void;
 
+  // ─ ROM image ─────────────────────────────────────────────────────────────
+  /**
+   * The bundled-resource image (build/rom.img) linked into the kernel, as an
+   * ArrayBuffer over the kernel's own memory — no copy, never freed.  Treat
+   * it as read-only.  Null when the kernel was built without one.
+   */
+  romImage?(): ArrayBuffer | null;
+
   // ─ Hardware RNG (item 348) ───────────────────────────────────────────────
   /**
    * Read one 32-bit hardware-random word via the RDRAND CPU instruction.
@@ -17,11 +17,13 @@ import { procFS } from '../fs/proc.js';
 import { net } from '../net/net.js';
 import { fat16 } from '../storage/fat16.js';
 import { fat32 } from '../storage/fat32.js';
+import { CowFS, AtaDiskDevice, mountCowFS } from '../fs/cowfs.js';
 import { physAlloc } from '../process/physalloc.js';
 import { threadManager } from '../process/threads.js';
 import { scheduler }     from '../process/scheduler.js';
 import { devFSMount    } from '../fs/dev.js';
-import { installRomFiles } from '../fs/romfs.js';
+import { mountRom } from '../fs/romfs.js';
+import { openInitramfs } from '../fs/initramfs.js';
 import { createScreenCanvas } from '../ui/canvas.js';
 import { WindowManager, setWM } from '../ui/wm.js';
 import { terminalApp } from '../apps/terminal/index.js';
@@ -133,13 +135,39 @@ function main(): void {
   fs.mountVFS('/proc', procFS);
   fs.mountVFS('/dev',  devFSMount);  // Phase 6: /dev device nodes
 
-  // Install bundled resource files (bible.txt etc.) into the regular filesystem
-  installRomFiles(fs);
+  // Bundled resources (bible.txt etc.): the kernel's ROM image, mounted at
+  // /rom and linked into the tree as zero-copy files
+  var romFiles = mountRom(fs);
+  if (romFiles) kernel.serialPut('[romfs] ' + romFiles + ' file(s) from ROM\n');
+
+  // initramfs module: unpacked a slice per frame as a coroutine, overlapped
+  // with the rest of boot; files are views of the archive until written
+  var initrd = openInitramfs(fs);
+  if (initrd) {
+    threadManager.runCoroutine('initramfs', function() {
+      if (initrd!.step()) return 'pending';
+      var r = initrd!.result;
+      kernel.serialPut('[initramfs] ' + r.filesLoaded + ' files, ' + r.dirsCreated + ' dirs (' +
+        r.format + ', ' + r.archiveBytes + ' bytes)' + (r.errors.length ? ' — ' + r.errors[0] : '') + '\n');
+      return 'done';
+    });
+  }
 
-  // Mount persistent disk — try FAT32 first (large disks), fall back to FAT16
+  // Mount persistent disk — a JSOS CoW filesystem if the disk holds one
+  // (probed first, since the FAT drivers format blank disks), else
+  // FAT32 (large disks), falling back to FAT16.
   // diskFS is whichever driver successfully mounts; exposed to all REPL helpers.
   var diskFS: any = null;
-  if (fat32.mount()) {
+  var cowDisk: CowFS | null = null;
+  if (kernel.ataPresent()) {
+    var ataDev = new AtaDiskDevice();
+    cowDisk = mountCowFS(ataDev, ataDev.sizeBytes, '/disk');
+  }
+  if (cowDisk) {
+    diskFS = cowDisk;
+    kernel.serialPut('CoW filesystem mounted at /disk (generation ' + cowDisk.generation + ')\n');
+    fs.mountVFS('/disk', cowDisk);
+  } else if (fat32.mount()) {
     diskFS = fat32;
     if (fat32.wasAutoFormatted) {
       kernel.serialPut('Blank disk detected. Formatting as FAT32...\n');
@@ -384,6 +412,8 @@ function main(): void {
         try { _wasActive = wmInst.tick(); } catch(e) { kernel.serialPut('[tick] wm error: ' + String(e).slice(0, 100) + '\n'); }
         try { init.tick(kernel.getUptime()); } catch(e) { kernel.serialPut('[tick] init error: ' + String(e).slice(0, 100) + '\n'); }
         try { writebackTimer.tick(kernel.getTicks()); } catch(e) { kernel.serialPut('[tick] wb error: ' + String(e).slice(0, 100) + '\n'); }
+        var _dk = (globalThis as any)._diskFS;
+        if (_dk instanceof CowFS) try { _dk.tick(); } catch(e) { kernel.serialPut('[tick] cowfs error: ' + String(e).slice(0, 100) + '\n'); }
       };
       // Fault storm detection: if guardedRun returns -1 (CPU fault) more than
       // _FAULT_THRESHOLD consecutive times, we assume a coroutine is stuck in a
@@ -0,0 +1,329 @@
+/**
+ * JSOS ByteRing — bounded power-of-two byte ring
+ *
+ * The one byte buffer behind every stream IPC object: fd-table pipes
+ * (core/fdtable.ts), string pipes and FIFOs (ipc/ipc.ts), PTYs.
+ *
+ *   • Storage is a single Uint8Array whose length is a power of two, so
+ *     wrap-around is a mask and every read/write is at most two
+ *     Uint8Array.set() copies — O(bytes moved), never O(bytes buffered).
+ *   • Capacity is fixed: write() accepts what fits and reports how much,
+ *     which is what gives callers EAGAIN / blocking backpressure.
+ *   • Readiness: watchers are told when the ring becomes readable,
+ *     writable, or hung up, so select/poll/epoll need not rescan.
+ *   • splice()/tee() move bytes ring-to-ring without materialising them as
+ *     JS arrays or strings.
+ *
+ * head/tail are free-running byte counters (head - tail = bytes buffered);
+ * they stay exact integers far beyond any realistic uptime.
+ */
+
+/** Readiness bits delivered to watchers (same values as POLLIN/POLLOUT/POLLHUP). */
+export const RING_READABLE = 0x0001;
+export const RING_WRITABLE = 0x0004;
+export const RING_HUP      = 0x0010;
+
+export const RING_DEFAULT_CAPACITY = 65536;   // Linux pipe default
+export const RING_MAX_CAPACITY     = 1 << 24;
+
+export type RingWatcher = (events: number) => void;
+
+export class ByteRing {
+  private _buf:  Uint8Array;
+  private _mask: number;
+  private _head = 0;             // next byte to write
+  private _tail = 0;             // next byte to read
+  private _readerClosed = false;
+  private _writerClosed = false;
+  private _watchers: RingWatcher[] = [];
+
+  constructor(capacity: number = RING_DEFAULT_CAPACITY) {
+    var size = 64;
+    if (capacity > RING_MAX_CAPACITY) capacity = RING_MAX_CAPACITY;
+    while (size < capacity) size <<= 1;
+    this._buf  = new Uint8Array(size);
+    this._mask = size - 1;
+  }
+
+  get capacity(): number  { return this._buf.length; }
+  /** Bytes buffered and ready to read. */
+  get available(): number { return this._head - this._tail; }
+  /** Bytes that can be written without blocking. */
+  get space(): number     { return this._buf.length - (this._head - this._tail); }
+  get readerClosed(): boolean { return this._readerClosed; }
+  get writerClosed(): boolean { return this._writerClosed; }
+
+  /** Current readiness as RING_* bits. */
+  poll(): number {
+    var ev = 0;
+    if (this.available > 0 || this._writerClosed) ev |= RING_READABLE;
+    if (this.space > 0 && !this._readerClosed) ev |= RING_WRITABLE;
+    if (this._writerClosed || this._readerClosed) ev |= RING_HUP;
+    return ev;
+  }
+
+  // ── Producer ──────────────────────────────────────────────────────────────
+
+  /**
+   * Copy up to `len` bytes from `src[off…]`.  Returns the number accepted:
+   * less than `len` when the ring fills up, 0 when full, -1 once the read
+   * side has closed (EPIPE).
+   */
+  write(src: Uint8Array | number[], off: number = 0, len: number = src.length - off): number {
+    if (this._readerClosed) return -1;
+    var n = Math.min(len, this.space);
+    if (n <= 0) return 0;
+    var wasEmpty = this._head === this._tail;
+    var pos = this._head & this._mask;
+    var first = Math.min(n, this._buf.length - pos);
+    if (src instanceof Uint8Array) {
+      this._buf.set(src.subarray(off, off + first), pos);
+      if (n > first) this._buf.set(src.subarray(off + first, off + n), 0);
+    } else {
+      for (var i = 0; i < n; i++) this._buf[(pos + i) & this._mask] = src[off + i] & 0xFF;
+    }
+    this._head += n;
+    if (wasEmpty) this._notify(RING_READABLE);
+    return n;
+  }
+
+  /** UTF-8 encode `s` and write it; all-or-nothing.  Returns bytes, 0 if it does not fit, -1 on EPIPE. */
+  writeString(s: string): number {
+    if (this._readerClosed) return -1;
+    var bytes = utf8Encode(s);
+    if (bytes.length > this.space) return 0;
+    return this.write(bytes, 0, bytes.length);
+  }
+
+  // ── Consumer ──────────────────────────────────────────────────────────────
+
+  /** Copy up to `len` bytes into `dst[off…]` without consuming them. */
+  peek(dst: Uint8Array, off: number = 0, len: number = dst.length - off): number {
+    var n = Math.min(len, this.available);
+    if (n <= 0) return 0;
+    var pos = this._tail & this._mask;
+    var first = Math.min(n, this._buf.length - pos);
+    dst.set(this._buf.subarray(pos, pos + first), off);
+    if (n > first) dst.set(this._buf.subarray(0, n - first), off + first);
+    return n;
+  }
+
+  /** Discard up to `n` buffered bytes.  Returns the number dropped. */
+  skip(n: number): number {
+    n = Math.min(n, this.available);
+    if (n <= 0) return 0;
+    var wasFull = this.space === 0;
+    this._tail += n;
+    if (this._tail === this._head) { this._tail = 0; this._head = 0; }
+    if (wasFull) this._notify(RING_WRITABLE);
+    return n;
+  }
+
+  /** Consume up to `len` bytes into `dst[off…]`.  Returns bytes read (0 = empty). */
+  read(dst: Uint8Array, off: number = 0, len: number = dst.length - off): number {
+    return this.skip(this.peek(dst, off, len));
+  }
+
+  /** Consume up to `n` bytes into a fresh Uint8Array. */
+  readBytes(n: number): Uint8Array {
+    var out = new Uint8Array(Math.min(n, this.available));
+    this.read(out, 0, out.length);
+    return out;
+  }
+
+  /** Consume up to `n` bytes as a number[] (FileDescription.read compatibility). */
+  readArray(n: number): number[] {
+    var bytes = this.readBytes(n);
+    var out = new Array<number>(bytes.length);
+    for (var i = 0; i < bytes.length; i++) out[i] = bytes[i];
+    return out;
+  }
+
+  /**
+   * Consume up to `maxBytes` (default: everything) and UTF-8 decode it.
+   * Never splits a multi-byte sequence: a trailing partial character stays
+   * buffered until the rest of it arrives.  Something is always consumed
+   * when data is buffered — a character longer than `maxBytes` is taken
+   * whole, and a malformed sequence, or a truncated one after closeWrite(),
+   * comes out as U+FFFD — so reading until empty terminates.
+   */
+  readString(maxBytes?: number): string {
+    var avail = this.available;
+    var n = maxBytes !== undefined && maxBytes < avail ? maxBytes : avail;
+    if (n <= 0) return '';
+    var len = Math.min(avail, n + 3);   // room to finish a straddling character
+    var bytes = new Uint8Array(len);
+    this.peek(bytes, 0, len);
+    var end = utf8Take(bytes, n, len, this._writerClosed);
+    this.skip(end);
+    return utf8Decode(bytes, end);
+  }
+
+  /** Decode everything buffered without consuming it. */
+  peekString(): string {
+    var bytes = new Uint8Array(this.available);
+    this.peek(bytes);
+    return utf8Decode(bytes, utf8Boundary(bytes, bytes.length));
+  }
+
+  // ── Ring-to-ring ──────────────────────────────────────────────────────────
+
+  /** Move up to `len` bytes from this ring into `dst` (splice(2)).  Returns bytes moved. */
+  spliceTo(dst: ByteRing, len: number = this.available): number {
+    var n = this._copyTo(dst, len);
+    if (n > 0) this.skip(n);
+    return n;
+  }
+
+  /** Copy up to `len` bytes into `dst` without consuming them (tee(2)). */
+  teeTo(dst: ByteRing, len: number = this.available): number {
+    return this._copyTo(dst, len);
+  }
+
+  private _copyTo(dst: ByteRing, len: number): number {
+    var n = Math.min(len, this.available);
+    if (n <= 0) return 0;
+    var pos = this._tail & this._mask;
+    var first = Math.min(n, this._buf.length - pos);
+    var w = dst.write(this._buf, pos, first);
+    if (w === first && n > first) {
+      var w2 = dst.write(this._buf, 0, n - first);
+      if (w2 > 0) w += w2;
+    }
+    return w;                  // -1 when dst's reader has closed
+  }
+
+  // ── Lifecycle / readiness ─────────────────────────────────────────────────
+
+  /** Writer is gone: readers drain what is left, then see EOF. */
+  closeWrite(): void {
+    if (this._writerClosed) return;
+    this._writerClosed = true;
+    this._notify(RING_READABLE | RING_HUP);
+  }
+
+  /** Reader is gone: further writes fail with EPIPE; buffered bytes are dropped. */
+  closeRead(): void {
+    if (this._readerClosed) return;
+    this._readerClosed = true;
+    this._head = 0; this._tail = 0;
+    this._notify(RING_WRITABLE | RING_HUP);
+  }
+
+  /** True once the writer has closed and every byte has been read. */
+  get eof(): boolean { return this._writerClosed && this._head === this._tail; }
+
+  /**
+   * Register a readiness callback, fired on empty→readable, full→writable
+   * and hang-up edges.  Returns an unsubscribe function.
+   */
+  watch(cb: RingWatcher): () => void {
+    var list = this._watchers;
+    list.push(cb);
+    return function() {
+      var i = list.indexOf(cb);
+      if (i >= 0) list.splice(i, 1);
+    };
+  }
+
+  private _notify(events: number): void {
+    var list = this._watchers;
+    for (var i = 0; i < list.length; i++) {
+      try { list[i](events); } catch (_) {}
+    }
+  }
+}
+
+// ── UTF-8 helpers ────────────────────────────────────────────────────────────
+
+export function utf8Encode(s: string): Uint8Array {
+  var out = new Uint8Array(s.length * 3);
+  var n = 0;
+  for (var i = 0; i < s.length; i++) {
+    var c = s.charCodeAt(i);
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < s.length) {
+      var d = s.charCodeAt(i + 1);
+      if (d >= 0xDC00 && d <= 0xDFFF) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (d - 0xDC00);
+        i++;
+      }
+    }
+    if (c < 0x80) {
+      out[n++] = c;
+    } else if (c < 0x800) {
+      out[n++] = 0xC0 | (c >> 6);
+      out[n++] = 0x80 | (c & 0x3F);
+    } else if (c < 0x10000) {
+      out[n++] = 0xE0 | (c >> 12);
+      out[n++] = 0x80 | ((c >> 6) & 0x3F);
+      out[n++] = 0x80 | (c & 0x3F);
+    } else {
+      out[n++] = 0xF0 | (c >> 18);
+      out[n++] = 0x80 | ((c >> 12) & 0x3F);
+      out[n++] = 0x80 | ((c >> 6) & 0x3F);
+      out[n++] = 0x80 | (c & 0x3F);
+    }
+  }
+  return out.subarray(0, n);
+}
+
+/** Length of the longest prefix of bytes[0…n) that ends on a character boundary. */
+function utf8Boundary(bytes: Uint8Array, n: number): number {
+  // Walk back over at most 3 continuation bytes to the last lead byte.
+  var i = n - 1, back = 0;
+  while (i >= 0 && back < 3 && (bytes[i] & 0xC0) === 0x80) { i--; back++; }
+  if (i < 0) return n;
+  var lead = bytes[i];
+  var need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+  return (n - i < need) ? i : n;
+}
+
+/**
+ * Bytes to take from bytes[0…len) for a read of at most n (1 ≤ n ≤ len):
+ * whole characters only, but never nothing — a first character longer than
+ * n is taken whole, and a malformed sequence (a lead byte plus the
+ * continuation bytes before the next non-continuation byte) is taken as is
+ * for utf8Decode to turn into U+FFFD.  A first character cut short by the
+ * end of the data yields 0 unless `final` says no more bytes will come.
+ */
+export function utf8Take(bytes: Uint8Array, n: number, len: number, final: boolean): number {
+  var end = utf8Boundary(bytes, n);
+  if (end > 0) return end;
+  // bytes[0] is a multi-byte lead whose sequence does not fit in n
+  var b = bytes[0], need = b >= 0xF0 ? 4 : b >= 0xE0 ? 3 : 2;
+  var i = 1;
+  while (i < need && i < len && (bytes[i] & 0xC0) === 0x80) i++;
+  return i === need || i < len || final ? i : 0;
+}
+
+/**
+ * Decode bytes[0…n).  A malformed or truncated sequence — a lead byte and
+ * whatever continuation bytes follow it — becomes one U+FFFD, as does a
+ * stray continuation byte.
+ */
+export function utf8Decode(bytes: Uint8Array, n: number = bytes.length): string {
+  var parts: string[] = [];
+  var codes: number[] = [];
+  var i = 0;
+  while (i < n) {
+    var b = bytes[i++];
+    var c: number;
+    if (b < 0x80) c = b;
+    else if (b < 0xC0) c = 0xFFFD;
+    else {
+      var need = b >= 0xF0 ? 3 : b >= 0xE0 ? 2 : 1, k = 0;
+      c = b & (0x3F >> need);
+      while (k < need && i < n && (bytes[i] & 0xC0) === 0x80) { c = (c << 6) | (bytes[i++] & 0x3F); k++; }
+      if (k < need || c > 0x10FFFF) c = 0xFFFD;
+    }
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      codes.push(0xD800 + (c >> 10), 0xDC00 + (c & 0x3FF));
+    } else {
+      codes.push(c);
+    }
+    if (codes.length >= 4096) { parts.push(String.fromCharCode.apply(null, codes)); codes = []; }
+  }
+  if (codes.length) parts.push(String.fromCharCode.apply(null, codes));
+  return parts.join('');
+}
@@ -34,7 +34,7 @@ import {
   dnsPollReplyAsync,
   dnsCancelAsync,
 } from '../net/dns.js';
-import { parseHttpResponse, cookieJar, HTTP2Connection } from '../net/http.js';
+import { parseHttpResponse, cookieJar, HTTP2Connection, type H2Stream } from '../net/http.js';
 import { httpDecompress } from '../net/deflate.js';
 import { config, getHostname, getDnsServers, getTimezone } from './config.js';
 import { locale } from './locale.js';
@@ -152,6 +152,13 @@ export interface FetchOptions {
   body?:         string | number[];
   /** Maximum redirects to follow (default 5). */
   maxRedirects?: number;
+  /**
+   * Called with each piece of a 2xx body as it arrives, chunked
+   * framing removed; `total` is the Content-Length or -1.  Only bodies
+   * without a Content-Encoding are streamed.  The final callback still gets
+   * the whole response — compare its length with the bytes seen here.
+   */
+  onBody?:       (chunk: Uint8Array, total: number) => void;
 }
 
 export interface FetchResponse {
@@ -254,6 +261,9 @@ interface InFlightFetch {
   headersDone:  boolean;  // true once we've seen \r\n\r\n in raw bytes
   bodyOffset:   number;   // byte offset where body starts (after \r\n\r\n)
   chunked:      boolean;  // true if Transfer-Encoding: chunked
+  bodyFed:      number;   // body bytes passed to opts.onBody; -1 undecided, -2 not streamed
+  chunkState:   number;   // onBody de-framer: 0 size, 1 extension, 2 data, 3 CRLF, 4 last chunk
+  chunkLeft:    number;   // size being parsed (0, 1) or data bytes left (2)
   deadline:     number;
   dnsPort:      number;
   dnsId:        number;
@@ -520,6 +530,7 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
       f.headersDone = false;
       f.bodyOffset = 0;
       f.chunked    = false;
+      _bodyRestart(f);
       f.deadline   = kernel.getTicks() + 30000;  // 30 s hard timeout
       f.stage      = 'receiving';
       return 'pending';
@@ -541,7 +552,8 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
 
         // Parse headers on-the-fly to extract Content-Length / Transfer-Encoding
         if (!f.headersDone) {
-          var _rawSoFar = _bytesToString(f.chunks.length === 1 ? f.chunks[0] : _flattenChunks(f.chunks));
+          var _flatSoFar = f.chunks.length === 1 ? f.chunks[0] : _flattenChunks(f.chunks);
+          var _rawSoFar = _bytesToString(_flatSoFar);
           var _hEnd = _rawSoFar.indexOf('\r\n\r\n');
           if (_hEnd >= 0) {
             f.headersDone = true;
@@ -550,7 +562,13 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
             var _clMatch = _hdrStr.match(/content-length:\s*(\d+)/i);
             if (_clMatch) f.contentLen = parseInt(_clMatch[1], 10);
             if (/transfer-encoding:.*chunked/i.test(_hdrStr)) f.chunked = true;
+            if (f.opts.onBody) {
+              f.bodyFed = /^HTTP\/[\d.]+\s+2\d\d/.test(_hdrStr) && !/\r\ncontent-encoding:/i.test(_hdrStr) ? 0 : -2;
+              if (f.bodyFed === 0) _streamBody(f, _flatSoFar, f.bodyOffset);
+            }
           }
+        } else if (f.bodyFed >= 0) {
+          _streamBody(f, chunk, 0);
         }
 
         // Early termination: Content-Length known → simple arithmetic
@@ -780,6 +798,7 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
         }
         h2.sendData(h2sid, h2body, true);
       }
+      _bodyRestart(f);
       f.deadline = kernel.getTicks() + 30000;  // 30 s timeout
       f.stage = 'h2-receiving';
       return 'pending';
@@ -789,6 +808,7 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
     if (f.stage === 'h2-receiving') {
       var h2r = f.h2conn!;
       var stream = h2r.receive(f.h2streamId, 10);  // short poll, 100ms — don't block coroutine
+      if (f.opts.onBody && f.bodyFed !== -2) _h2StreamBody(f, stream || h2r.peek(f.h2streamId));
       if (stream && (stream.state === 'half_closed_remote' || stream.state === 'closed')) {
         (kernel as any).serialPut('[h2 done] coro=' + f.coroId + ' stream=' + f.h2streamId + ' body=' + stream.body.length + 'B\n');
         var h2status = 200;
@@ -901,6 +921,79 @@ function _buildFetchCoroutine(f: InFlightFetch): CoroutineStep {
   };
 }
 
+// ── Streamed response bodies ───────────────────────────────────────────────
+
+/** Start a new response: nothing of it has been streamed yet. */
+function _bodyRestart(f: InFlightFetch): void {
+  // A retry after bytes went out cannot take them back — stop streaming;
+  // the caller sees the short count and uses the final response instead
+  if (f.bodyFed > 0) f.opts = { ...f.opts, onBody: undefined };
+  f.bodyFed    = -1;
+  f.chunkState = 0;
+  f.chunkLeft  = 0;
+}
+
+/**
+ * Pass body bytes bytes[from..] of an HTTP/1.1 response to opts.onBody,
+ * removing chunked framing.  The de-framer state lives in `f` so a size
+ * line or CRLF may straddle two reads.
+ */
+function _streamBody(f: InFlightFetch, bytes: number[], from: number): void {
+  var out = new Uint8Array(bytes.length - from), n = 0;
+  var i = from;
+  while (i < bytes.length) {
+    if (!f.chunked || f.chunkState === 2) {
+      var run = bytes.length - i;
+      if (f.chunked) run = Math.min(run, f.chunkLeft);
+      else if (f.contentLen >= 0) run = Math.min(run, f.contentLen - f.bodyFed - n);
+      if (run <= 0) break;
+      for (var j = 0; j < run; j++) out[n++] = bytes[i + j];
+      i += run;
+      if (f.chunked && (f.chunkLeft -= run) === 0) f.chunkState = 3;
+      continue;
+    }
+    var b = bytes[i++];
+    if (f.chunkState === 3) {                       // CRLF after the data
+      if (b === 0x0A) { f.chunkState = 0; f.chunkLeft = 0; }
+    } else if (f.chunkState === 4) {                // trailers: ignored
+      break;
+    } else if (b === 0x0A) {                        // end of the size line
+      f.chunkState = f.chunkLeft > 0 ? 2 : 4;
+    } else if (f.chunkState === 0) {
+      var d = b >= 0x30 && b <= 0x39 ? b - 0x30 : (b | 0x20) >= 0x61 && (b | 0x20) <= 0x66 ? (b | 0x20) - 0x57 : -1;
+      if (d >= 0) f.chunkLeft = f.chunkLeft * 16 + d;
+      else if (b !== 0x0D) f.chunkState = 1;        // ";ext" or padding
+    }
+  }
+  if (!n) return;
+  f.bodyFed += n;
+  try { f.opts.onBody!(n === out.length ? out : out.subarray(0, n), f.contentLen); } catch (_e) {}
+}
+
+/** HTTP/2: pass on the DATA received since the last call. */
+function _h2StreamBody(f: InFlightFetch, s: H2Stream | null): void {
+  if (!s) return;
+  if (f.bodyFed === -1) {
+    if (!s.headers.length) return;                  // HEADERS not in yet
+    var ok = false, enc = false;
+    f.contentLen = -1;
+    for (var i = 0; i < s.headers.length; i++) {
+      var h = s.headers[i];
+      if (h[0] === ':status') ok = /^2\d\d$/.test(h[1]);
+      else if (h[0] === 'content-encoding') enc = true;
+      else if (h[0] === 'content-length') f.contentLen = parseInt(h[1], 10);
+    }
+    f.bodyFed = ok && !enc ? 0 : -2;
+    if (f.bodyFed < 0) return;
+  }
+  var n = s.body.length - f.bodyFed;
+  if (n <= 0) return;
+  var out = new Uint8Array(n);
+  for (var j = 0; j < n; j++) out[j] = s.body[f.bodyFed + j];
+  f.bodyFed += n;
+  try { f.opts.onBody!(out, f.contentLen); } catch (_e) {}
+}
+
 /** Flatten chunks into a single contiguous array (O(n)). */
 function _flattenChunks(chunks: number[][]): number[] {
   var total = 0;
@@ -1282,6 +1375,9 @@ function _doFetch(
     headersDone:  false,
     bodyOffset:   0,
     chunked:      false,
+    bodyFed:      -1,
+    chunkState:   0,
+    chunkLeft:    0,
     deadline:     0,
     dnsPort:      0,
     dnsId:        0,
@@ -1813,7 +1909,7 @@ const sdk = {
     close(fd: number): boolean {
       return fs.close(fd);
     },
-    /** Read up to `count` characters from fd. Returns null on error. */
+    /** Read up to `count` bytes from fd, as text. Returns null on error. */
     readFd(fd: number, count: number): string | null {
       return fs.readFd(fd, count);
     },
@@ -2384,6 +2480,18 @@ const sdk = {
       open(id: number): ArrayBuffer | null {
         return (kernel as any).sharedBufferOpen ? (kernel as any).sharedBufferOpen(id) : null;
       },
+      /** Drop this runtime's reference; the memory lives while any view remains. */
+      release(id: number): boolean {
+        return (kernel as any).sharedBufferRelease ? !!(kernel as any).sharedBufferRelease(id) : false;
+      },
+      /** Detach `buf` here and return an id the receiving runtime passes to accept(). */
+      transfer(buf: ArrayBuffer): number {
+        return (kernel as any).bufferTransfer ? (kernel as any).bufferTransfer(buf) : -1;
+      },
+      /** Claim a transferred buffer. */
+      accept(id: number): ArrayBuffer | null {
+        return (kernel as any).bufferAccept ? (kernel as any).bufferAccept(id) : null;
+      },
     },
 
     /** Return the ProcessContext for the current process, or null. */
@@ -7,9 +7,10 @@
  */
 
 import { globalFDTable, VFSFileDescription, SocketDescription } from './fdtable.js';
+import type { EpollEvent } from './epoll.js';
 import { processManager } from '../process/process.js';
 import { scheduler } from '../process/scheduler.js';
-import { vmm } from '../process/vmm.js';
+import { processAddressSpace } from '../process/vmm.js';
 import { physAlloc } from '../process/physalloc.js';
 import { elfLoader } from '../process/elf.js';
 import { signalManager } from '../process/signals.js';
@@ -206,9 +207,11 @@ export class SystemCallInterface {
   }
 
   // ── Memory ────────────────────────────────────────────────────────────────
+  // Allocations go into the calling process's own address space, so fork()
+  // can share them into the child copy-on-write.
 
   brk(addr?: number): SyscallResult<number> {
-    var a = vmm.allocateVirtualMemory(addr || 4096, 'rw');
+    var a = processAddressSpace.vmFor(scheduler.getpid()).allocateVirtualMemory(addr || 4096, 'rw');
     return a !== null
       ? { success: true, value: a }
       : { success: false, errno: Errno.ENOMEM, error: 'ENOMEM' };
@@ -216,14 +219,14 @@ export class SystemCallInterface {
 
   mmap(_addr: number, length: number, _prot: number, _flags: number,
        _fd: number, _offset: number): SyscallResult<number> {
-    var a = vmm.allocateVirtualMemory(length || 4096, 'rw');
+    var a = processAddressSpace.vmFor(scheduler.getpid()).allocateVirtualMemory(length || 4096, 'rw');
     return a !== null
       ? { success: true, value: a }
       : { success: false, errno: Errno.ENOMEM, error: 'ENOMEM' };
   }
 
   munmap(addr: number, length: number): SyscallResult<void> {
-    vmm.freeVirtualMemory(addr, length);
+    processAddressSpace.vmFor(scheduler.getpid()).freeVirtualMemory(addr, length);
     return { success: true };
   }
 
@@ -259,18 +262,25 @@ export class SystemCallInterface {
   }
 
   read(fd: number, buf: Uint8Array, count: number): SyscallResult<number> {
-    var data = globalFDTable.read(fd, count);
-    for (var i = 0; i < data.length; i++) buf[i] = data[i];
-    return { success: true, value: data.length };
+    var n = globalFDTable.readInto(fd, buf, 0, Math.min(count, buf.length));
+    return n >= 0
+      ? { success: true, value: n }
+      : { success: false, errno: -n, error: 'read errno=' + (-n) };
   }
 
   write(fd: number, buf: Uint8Array, count: number): SyscallResult<number> {
-    var data: number[] = [];
-    for (var i = 0; i < count; i++) data.push(buf[i] || 0);
-    var n = globalFDTable.write(fd, data);
+    var n = globalFDTable.writeFrom(fd, buf, 0, Math.min(count, buf.length));
     return n >= 0
       ? { success: true, value: n }
-      : { success: false, errno: Errno.EBADF, error: 'EBADF' };
+      : { success: false, errno: -n, error: 'write errno=' + (-n) };
+  }
+
+  /** fcntl(F_GETFL / F_SETFL) — toggles O_NONBLOCK on pipes. */
+  fcntl(fd: number, cmd: number, arg?: number): SyscallResult<number> {
+    var r = globalFDTable.fcntl(fd, cmd, arg);
+    return r >= 0
+      ? { success: true, value: r }
+      : { success: false, errno: -r, error: 'fcntl errno=' + (-r) };
   }
 
   lseek(fd: number, offset: number, whence: number): SyscallResult<number> {
@@ -336,11 +346,59 @@ export class SystemCallInterface {
 
   // ── IPC / Pipes ───────────────────────────────────────────────────────────
 
-  pipe(): SyscallResult<{ read: number; write: number }> {
-    var pair = globalFDTable.pipe();
+  pipe(capacity?: number): SyscallResult<{ read: number; write: number }> {
+    var pair = globalFDTable.pipe(capacity);
     return { success: true, value: { read: pair[0], write: pair[1] } };
   }
 
+  /** splice: move bytes between fds (one must be a pipe) without a JS array copy. */
+  splice(fdIn: number, fdOut: number, len: number): SyscallResult<number> {
+    var n = globalFDTable.splice(fdIn, fdOut, len);
+    return n >= 0
+      ? { success: true, value: n }
+      : { success: false, errno: -n, error: 'splice errno=' + (-n) };
+  }
+
+  /** sendfile: regular file → fd, passing the file's chunks without a copy. */
+  sendfile(fdOut: number, fdIn: number, offset: number | null, count: number): SyscallResult<number> {
+    var n = globalFDTable.sendfile(fdOut, fdIn, offset, count);
+    return n >= 0
+      ? { success: true, value: n }
+      : { success: false, errno: -n, error: 'sendfile errno=' + (-n) };
+  }
+
+  /** tee: duplicate bytes from one pipe into another without consuming them. */
+  tee(fdIn: number, fdOut: number, len: number): SyscallResult<number> {
+    var n = globalFDTable.tee(fdIn, fdOut, len);
+    return n >= 0
+      ? { success: true, value: n }
+      : { success: false, errno: -n, error: 'tee errno=' + (-n) };
+  }
+
+  /** epoll_create: a readiness-list epoll instance (core/epoll.ts) as an fd. */
+  epoll_create(): SyscallResult<number> {
+    var fd = globalFDTable.epollCreate();
+    return fd >= 0
+      ? { success: true, value: fd }
+      : { success: false, errno: Errno.EMFILE, error: 'EMFILE' };
+  }
+
+  /** epoll_ctl: EPOLL_CTL_ADD / MOD / DEL interest in `fd` (EPOLLET / EPOLLONESHOT honoured). */
+  epoll_ctl(epfd: number, op: number, fd: number, events: number, data?: any): SyscallResult<void> {
+    var r = globalFDTable.epollCtl(epfd, op, fd, events, data);
+    return r === 0
+      ? { success: true }
+      : { success: false, errno: -r, error: 'epoll_ctl errno=' + (-r) };
+  }
+
+  /** epoll_wait: ready events only — cost is O(ready fds), not O(registered fds). */
+  epoll_wait(epfd: number, maxEvents: number, timeoutMs: number): SyscallResult<EpollEvent[]> {
+    var r = globalFDTable.epollWait(epfd, maxEvents, timeoutMs);
+    return typeof r === 'number'
+      ? { success: false, errno: -r, error: 'epoll_wait errno=' + (-r) }
+      : { success: true, value: r };
+  }
+
   // ── Sockets (Phase 7) ─────────────────────────────────────────────────────
 
   /**
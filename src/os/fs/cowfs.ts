@@ -0,0 +1,1630 @@
+/**
+ * JSOS CoW filesystem — btrfs-style copy-on-write storage for /disk
+ *
+ * A native JSOS on-disk format in the mould of btrfs / ZFS, for the
+ * persistent disk.  fs/btrfs.ts and fs/zfs.ts stay as readers of the real
+ * Linux / OpenZFS formats; this is the writable one.
+ *
+ * On disk (4 KB blocks):
+ *   0, 1       superblock slots A / B, written alternately; mount takes the
+ *              valid one with the higher generation
+ *   metadata   B-tree nodes: a root tree of subvolume roots, and one tree
+ *              per subvolume holding inodes, directory entries and file
+ *              extents, all keyed (objectid, type, offset) like btrfs
+ *   refcounts  one 16-bit reference count per block, in checksummed
+ *              refcount blocks found through index blocks listed in the
+ *              superblock; zero = free.  This is both the space map and
+ *              the extent reference count.
+ *   data       file extents of up to 1 MB, each block's crc32c kept in the
+ *              extent item; files of up to 1 KB live inline in their leaf
+ *
+ * Every block — superblock, node, refcount, index, data — carries a
+ * crc32c (fs/crc.ts, which uses the kernel's SSE4.2 CRC when present)
+ * and is verified on read; tree pointers also record the child's
+ * generation, so a lost or misdirected write is caught too.
+ *
+ * Copy-on-write: nothing reachable from the last committed superblock is
+ * ever overwritten.  Changing a node copies it to a free block (and its
+ * parents up to the root), unless it was already copied in the running
+ * transaction.  Blocks freed by a transaction stay reserved until it
+ * commits.  A crash at any point leaves the previous commit intact.
+ *
+ * Snapshots are O(1): a new root item pointing at the same tree root, with
+ * the root's reference count bumped.  Sharing is resolved lazily
+ * (Rodeh's reference-counted B-trees): when a shared node is first copied,
+ * the copy takes a reference on each child (or each data block), so only
+ * the path being modified is ever duplicated.  Deleting a snapshot walks
+ * just the blocks it owned exclusively.
+ *
+ * Transactions batch: operations accumulate in one transaction, committed
+ * when it holds COMMIT_BYTES of new data or is COMMIT_MS old, or on
+ * commit() / fsync() / unmount().  A commit sorts every new block — data,
+ * nodes, refcounts — by address and writes contiguous runs with one
+ * device request each; the allocator hands out blocks sequentially from a
+ * moving cursor, so a transaction lands as a few long sequential writes
+ * (the pattern SSDs like), and the superblock goes last.  fsync() of an
+ * already-committed state costs nothing, and fsyncAsync() callers in the
+ * same tick share one commit.
+ */
+
+import type { VFSMount, FileType } from './filesystem.js';
+import type { Ext4BlockDevice } from './ext4.js';
+import { crc32c } from './crc.js';
+import { utf8Encode, utf8Decode } from '../core/ringbuf.js';
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
+// ── On-disk constants ─────────────────────────────────────────────────────────
+
+const BS            = 4096;
+const SB_MAGIC      = 0x574F434A;   // 'JCOW'
+const NODE_MAGIC    = 0x444E434A;   // 'JCND'
+const REF_MAGIC     = 0x4652434A;   // 'JCRF'
+const IDX_MAGIC     = 0x5849434A;   // 'JCIX'
+const FORMAT_VERSION = 1;
+const FIRST_ALLOC   = 2;            // blocks 0 and 1 are the superblock slots
+
+// Superblock field offsets (csum at 0 covers [4, BS))
+const SB_MAGIC_OFF  = 4;
+const SB_VERSION    = 8;
+const SB_BLOCKSIZE  = 12;
+const SB_GEN        = 16;
+const SB_TOTAL      = 24;
+const SB_ROOT       = 32;
+const SB_DEFAULT    = 40;
+const SB_NEXT_SUBVOL = 48;
+const SB_USED       = 56;
+const SB_NIDX       = 64;
+const SB_LABEL      = 72;           // 64 bytes, NUL padded
+const SB_IDX        = 136;          // index block pointers, u64 each
+const SB_MAX_IDX    = (BS - SB_IDX) >> 3;
+
+const REF_HDR        = 16;          // csum, magic, index, pad
+const REFS_PER_BLOCK = (BS - REF_HDR) >> 1;
+const IDX_HDR        = 16;
+const PTRS_PER_IDX   = (BS - IDX_HDR) >> 3;
+const MAX_REFS       = 0xFFFF;
+
+// B-tree nodes: csum, magic, bytenr, generation, owner, nritems, level
+const NODE_HDR   = 40;
+const KEY_SIZE   = 17;              // objectid u64, type u8, offset u64
+const ITEM_SIZE  = KEY_SIZE + 8;    // key, data offset u32, data size u32
+const PTR_SIZE   = KEY_SIZE + 16;   // key, block u64, generation u64
+const LEAF_SPACE = BS - NODE_HDR;
+const MAX_PTRS   = Math.floor(LEAF_SPACE / PTR_SIZE);
+const MAX_ITEM   = 1900;            // any two items fit in one leaf, so a split always works
+
+// Item types
+const INODE_ITEM  = 1;
+const DIR_ENTRY   = 84;
+const EXTENT_DATA = 108;
+const ROOT_ITEM   = 132;
+
+const ROOT_TREE_ID   = 1;
+const FS_TREE_ID     = 5;           // the first (default) subvolume
+const FIRST_SUBVOL   = 256;
+const ROOT_DIR_INO   = 256;
+const KEY_MAX        = Number.MAX_SAFE_INTEGER;
+
+const S_IFDIR = 0x4000;
+const S_IFREG = 0x8000;
+const FT_REG  = 1;
+const FT_DIR  = 2;
+
+const INODE_SIZE        = 40;
+const INLINE_MAX        = 1024;
+const MAX_EXTENT_BLOCKS = 256;      // 1 MB extents; the item stays under MAX_ITEM
+const SUBVOL_READONLY   = 1;
+
+// Transaction batching
+const COMMIT_BYTES = 8 * 1024 * 1024;
+const COMMIT_MS    = 5000;
+const NODE_CACHE   = 1024;          // parsed clean nodes kept (4 MB of metadata)
+
+/** Directory that exposes snapshots at the top of the mounted tree. */
+const SNAP_DIR = '.snapshots';
+
+// ── Byte helpers ──────────────────────────────────────────────────────────────
+
+function rd16(b: Uint8Array, o: number): number { return b[o] | (b[o + 1] << 8); }
+function rd32(b: Uint8Array, o: number): number {
+  return (b[o] | (b[o + 1] << 8) | (b[o + 2] << 16) | (b[o + 3] << 24)) >>> 0;
+}
+function rd64(b: Uint8Array, o: number): number { return rd32(b, o) + rd32(b, o + 4) * 0x100000000; }
+function wr16(b: Uint8Array, o: number, v: number): void { b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; }
+function wr32(b: Uint8Array, o: number, v: number): void {
+  b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; b[o + 2] = (v >>> 16) & 0xff; b[o + 3] = (v >>> 24) & 0xff;
+}
+function wr64(b: Uint8Array, o: number, v: number): void {
+  wr32(b, o, v >>> 0);
+  wr32(b, o + 4, Math.floor(v / 0x100000000));
+}
+
+/** crc32c of `b[off…BS)`, as stored in every block. */
+function blockCsum(b: Uint8Array, off: number): number {
+  return (crc32c(0xFFFFFFFF, b, off, BS - off) ^ 0xFFFFFFFF) >>> 0;
+}
+
+function nameHash(name: Uint8Array): number {
+  return (crc32c(0xFFFFFFFF, name) ^ 0xFFFFFFFF) >>> 0;
+}
+
+// ── Keys ──────────────────────────────────────────────────────────────────────
+
+interface CowKey { oid: number; type: number; off: number; }
+
+function key(oid: number, type: number, off: number): CowKey { return { oid: oid, type: type, off: off }; }
+
+function cmpKey(a: CowKey, b: CowKey): number {
+  return a.oid - b.oid || a.type - b.type || a.off - b.off;
+}
+
+function readKey(b: Uint8Array, o: number): CowKey {
+  return { oid: rd64(b, o), type: b[o + 8], off: rd64(b, o + 9) };
+}
+
+function writeKey(b: Uint8Array, o: number, k: CowKey): void {
+  wr64(b, o, k.oid);
+  b[o + 8] = k.type;
+  wr64(b, o + 9, k.off);
+}
+
+/** Index of the first key >= k. */
+function lowerBound(keys: CowKey[], k: CowKey): number {
+  var lo = 0, hi = keys.length;
+  while (lo < hi) {
+    var mid = (lo + hi) >> 1;
+    if (cmpKey(keys[mid], k) < 0) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * Child of an internal node that may hold k: the last slot whose key is
+ * <= k.  keys[0] acts as -infinity, so parent keys are only lower bounds
+ * and never need fixing up when a child's first item changes.
+ */
+function childSlot(keys: CowKey[], k: CowKey): number {
+  var i = lowerBound(keys, k);
+  if (i < keys.length && cmpKey(keys[i], k) === 0) return i;
+  return i > 0 ? i - 1 : 0;
+}
+
+// ── Nodes ─────────────────────────────────────────────────────────────────────
+
+interface CowNode {
+  block: number;
+  gen:   number;
+  owner: number;
+  level: number;              // 0 = leaf
+  keys:  CowKey[];
+  /** Leaf item payloads.  Never mutated in place — they may be shared by copies. */
+  items: Uint8Array[];
+  /** Internal node children and the generation each was written in. */
+  ptrs:  number[];
+  gens:  number[];
+}
+
+function leafBytes(n: CowNode): number {
+  var s = 0;
+  for (var i = 0; i < n.items.length; i++) s += ITEM_SIZE + n.items[i].length;
+  return s;
+}
+
+function parseNode(b: Uint8Array, block: number): CowNode | string {
+  if (rd32(b, 4) !== NODE_MAGIC) return 'bad node magic';
+  if (rd32(b, 0) !== blockCsum(b, 4)) return 'node checksum mismatch';
+  if (rd64(b, 8) !== block) return 'node at wrong address';
+  var n: CowNode = {
+    block: block, gen: rd64(b, 16), owner: rd64(b, 24), level: b[36],
+    keys: [], items: [], ptrs: [], gens: [],
+  };
+  var nr = rd32(b, 32);
+  if (n.level === 0) {
+    for (var i = 0; i < nr; i++) {
+      var o = NODE_HDR + i * ITEM_SIZE;
+      n.keys.push(readKey(b, o));
+      var doff = rd32(b, o + 17);
+      n.items.push(b.subarray(doff, doff + rd32(b, o + 21)));
+    }
+  } else {
+    for (var j = 0; j < nr; j++) {
+      var p = NODE_HDR + j * PTR_SIZE;
+      n.keys.push(readKey(b, p));
+      n.ptrs.push(rd64(b, p + 17));
+      n.gens.push(rd64(b, p + 25));
+    }
+  }
+  return n;
+}
+
+function encodeNode(n: CowNode): Uint8Array {
+  var b = new Uint8Array(BS);
+  wr32(b, 4, NODE_MAGIC);
+  wr64(b, 8, n.block);
+  wr64(b, 16, n.gen);
+  wr64(b, 24, n.owner);
+  wr32(b, 32, n.keys.length);
+  b[36] = n.level;
+  if (n.level === 0) {
+    var end = BS;
+    for (var i = 0; i < n.keys.length; i++) {
+      var o = NODE_HDR + i * ITEM_SIZE;
+      var d = n.items[i];
+      end -= d.length;
+      writeKey(b, o, n.keys[i]);
+      b.set(d, end);
+      wr32(b, o + 17, end);
+      wr32(b, o + 21, d.length);
+    }
+  } else {
+    for (var j = 0; j < n.keys.length; j++) {
+      var p = NODE_HDR + j * PTR_SIZE;
+      writeKey(b, p, n.keys[j]);
+      wr64(b, p + 17, n.ptrs[j]);
+      wr64(b, p + 25, n.gens[j]);
+    }
+  }
+  wr32(b, 0, blockCsum(b, 4));
+  return b;
+}
+
+// ── Items ─────────────────────────────────────────────────────────────────────
+
+interface CowInode { size: number; mode: number; nlink: number; mtime: number; ctime: number; gen: number; }
+
+function encodeInode(i: CowInode): Uint8Array {
+  var b = new Uint8Array(INODE_SIZE);
+  wr64(b, 0, i.size); wr32(b, 8, i.mode); wr32(b, 12, i.nlink);
+  wr64(b, 16, i.mtime); wr64(b, 24, i.ctime); wr64(b, 32, i.gen);
+  return b;
+}
+
+function decodeInode(b: Uint8Array): CowInode {
+  return { size: rd64(b, 0), mode: rd32(b, 8), nlink: rd32(b, 12), mtime: rd64(b, 16), ctime: rd64(b, 24), gen: rd64(b, 32) };
+}
+
+interface CowDirent { ino: number; ft: number; name: string; }
+
+/** A DIR_ENTRY item holds every name of a directory that shares its hash. */
+function decodeDirents(b: Uint8Array): CowDirent[] {
+  var out: CowDirent[] = [];
+  for (var o = 0; o + 11 <= b.length;) {
+    var len = rd16(b, o + 9);
+    out.push({ ino: rd64(b, o), ft: b[o + 8], name: utf8Decode(b.subarray(o + 11, o + 11 + len)) });
+    o += 11 + len;
+  }
+  return out;
+}
+
+function encodeDirents(list: CowDirent[]): Uint8Array {
+  var names = list.map(function(e) { return utf8Encode(e.name); });
+  var size = 0;
+  for (var i = 0; i < names.length; i++) size += 11 + names[i].length;
+  var b = new Uint8Array(size);
+  for (var j = 0, o = 0; j < list.length; j++) {
+    wr64(b, o, list[j].ino); b[o + 8] = list[j].ft; wr16(b, o + 9, names[j].length);
+    b.set(names[j], o + 11);
+    o += 11 + names[j].length;
+  }
+  return b;
+}
+
+/** File extent: inline bytes, or `blocks` disk blocks from `disk` with a crc32c each. */
+interface CowExtent { inline: Uint8Array | null; disk: number; blocks: number; csums: Uint32Array | null; }
+
+function decodeExtent(b: Uint8Array): CowExtent {
+  if (b[0] === 0) return { inline: b.subarray(1), disk: 0, blocks: 0, csums: null };
+  var n = rd32(b, 9);
+  var cs = new Uint32Array(n);
+  for (var i = 0; i < n; i++) cs[i] = rd32(b, 13 + i * 4);
+  return { inline: null, disk: rd64(b, 1), blocks: n, csums: cs };
+}
+
+function encodeInline(data: Uint8Array): Uint8Array {
+  var b = new Uint8Array(1 + data.length);
+  b.set(data, 1);
+  return b;
+}
+
+function encodeExtent(disk: number, csums: Uint32Array): Uint8Array {
+  var b = new Uint8Array(13 + csums.length * 4);
+  b[0] = 1;
+  wr64(b, 1, disk);
+  wr32(b, 9, csums.length);
+  for (var i = 0; i < csums.length; i++) wr32(b, 13 + i * 4, csums[i]);
+  return b;
+}
+
+/** A subvolume: one fs tree, named in the root tree. */
+interface Subvol {
+  id:      number;
+  root:    number;
+  gen:     number;
+  lastIno: number;
+  flags:   number;
+  parent:  number;
+  ctime:   number;
+  name:    string;
+  /** Root block or inode counter changed since the root item was written. */
+  dirty:   boolean;
+}
+
+function encodeRoot(s: Subvol): Uint8Array {
+  var name = utf8Encode(s.name);
+  var b = new Uint8Array(46 + name.length);
+  wr64(b, 0, s.root); wr64(b, 8, s.gen); wr64(b, 16, s.lastIno); wr32(b, 24, s.flags);
+  wr64(b, 28, s.parent); wr64(b, 36, s.ctime); wr16(b, 44, name.length);
+  b.set(name, 46);
+  return b;
+}
+
+function decodeRoot(id: number, b: Uint8Array): Subvol {
+  return {
+    id: id, root: rd64(b, 0), gen: rd64(b, 8), lastIno: rd64(b, 16), flags: rd32(b, 24),
+    parent: rd64(b, 28), ctime: rd64(b, 36), name: utf8Decode(b.subarray(46, 46 + rd16(b, 44))), dirty: false,
+  };
+}
+
+/** Loaded refcount block: counts for blocks [index * REFS_PER_BLOCK, …). */
+interface RefBlock { counts: Uint16Array; free: number; dirty: boolean; }
+
+/** Root-to-leaf path of a search: the nodes and the slot taken in each. */
+interface TreePath { nodes: CowNode[]; slots: number[]; found: boolean; }
+
+/** A path resolved inside a subvolume. */
+interface Located { sv: Subvol | null; ino: number; }
+
+export interface CowSnapshotInfo { id: number; name: string; readonly: boolean; generation: number; created: number; }
+
+// ── Filesystem ────────────────────────────────────────────────────────────────
+
+export class CowFS implements VFSMount {
+  private _dev: Ext4BlockDevice;
+  private _mp: string;
+  private _mounted = false;
+
+  private _total = 0;
+  private _gen = 0;                 // last committed generation
+  private _txn = 1;                 // running transaction (= _gen + 1)
+  private _txnStart = 0;
+  private _label = '';
+  private _used = 0;
+  private _defaultId = FS_TREE_ID;
+  private _nextSubvol = FIRST_SUBVOL;
+
+  private _rootTree: Subvol = { id: ROOT_TREE_ID, root: 0, gen: 0, lastIno: 0, flags: 0, parent: 0, ctime: 0, name: '', dirty: false };
+  private _subvols: Map<number, Subvol> = new Map();
+
+  // Space map
+  private _refBlocks: Map<number, RefBlock> = new Map();
+  private _refLoc: number[] = [];   // refcount block index → disk block (0 = all zero)
+  private _idxLoc: number[] = [];   // index block → disk block
+  /** Current homes of refcount and index blocks: not in the refcount table themselves. */
+  private _meta: Set<number> = new Set();
+  /** Freed by the running transaction: still referenced by the last commit. */
+  private _pinned: Set<number> = new Set();
+  /** Allocated by the running transaction: free again at once if released. */
+  private _txnAlloc: Set<number> = new Set();
+  private _cursor = FIRST_ALLOC;
+
+  // Caches and the running transaction
+  private _cache: Map<number, CowNode> = new Map();
+  private _dirty: Map<number, CowNode> = new Map();
+  private _pendingData: Map<number, Uint8Array> = new Map();
+  private _changed = false;
+  private _syncPending: Promise<number> | null = null;
+
+  readonly stats = {
+    commits: 0, blocksWritten: 0, writeRuns: 0, cows: 0, nodeHits: 0, nodeMisses: 0,
+    csumErrors: 0, fsyncs: 0, groupedFsyncs: 0, snapshots: 0,
+  };
+
+  /**
+   * @param dev        sector device (readInto / writeFrom used when present)
+   * @param sizeBytes  usable size of the device
+   * @param mountpoint prefix stripped from VFS paths (e.g. '/disk')
+   */
+  constructor(dev: Ext4BlockDevice, sizeBytes: number, mountpoint: string = '') {
+    this._dev = dev;
+    this._total = Math.floor(sizeBytes / BS);
+    this._mp = mountpoint === '/' ? '' : mountpoint;
+  }
+
+  get mounted(): boolean { return this._mounted; }
+  get generation(): number { return this._gen; }
+  get label(): string { return this._label; }
+
+  // ── Mount / format ──────────────────────────────────────────────────────────
+
+  /** Mount the newest valid superblock.  False if there is no CoW filesystem. */
+  mount(): boolean {
+    var best: Uint8Array | null = null;
+    for (var slot = 0; slot < 2; slot++) {
+      var b = this._readBlock(slot);
+      if (rd32(b, SB_MAGIC_OFF) !== SB_MAGIC || rd32(b, 0) !== blockCsum(b, 4)) continue;
+      if (rd32(b, SB_VERSION) !== FORMAT_VERSION || rd32(b, SB_BLOCKSIZE) !== BS) continue;
+      if (!best || rd64(b, SB_GEN) > rd64(best, SB_GEN)) best = b;
+    }
+    if (!best) return false;
+    this._reset();
+    var sb = best;
+    this._gen = rd64(sb, SB_GEN);
+    this._txn = this._gen + 1;
+    this._total = rd64(sb, SB_TOTAL);
+    this._rootTree.root = rd64(sb, SB_ROOT);
+    this._defaultId = rd64(sb, SB_DEFAULT);
+    this._nextSubvol = rd64(sb, SB_NEXT_SUBVOL);
+    this._used = rd64(sb, SB_USED);
+    this._label = utf8Decode(sb.subarray(SB_LABEL, SB_LABEL + 64)).replace(/\0+$/, '');
+    try {
+      var nidx = rd32(sb, SB_NIDX);
+      for (var i = 0; i < nidx; i++) {
+        var loc = rd64(sb, SB_IDX + i * 8);
+        this._idxLoc.push(loc);
+        this._meta.add(loc);
+        var ib = this._readBlock(loc);
+        if (rd32(ib, 4) !== IDX_MAGIC || rd32(ib, 0) !== blockCsum(ib, 4) || rd32(ib, 8) !== i) {
+          throw new Error('bad refcount index block ' + loc);
+        }
+        for (var j = 0; j < PTRS_PER_IDX; j++) {
+          var r = rd64(ib, IDX_HDR + j * 8);
+          this._refLoc[i * PTRS_PER_IDX + j] = r;
+          if (r) this._meta.add(r);
+        }
+      }
+      var self = this;
+      this._scan(this._rootTree, key(0, 0, 0), key(KEY_MAX, 255, KEY_MAX), function(k, d) {
+        if (k.type === ROOT_ITEM) self._subvols.set(k.oid, decodeRoot(k.oid, d));
+      });
+      if (!this._subvols.has(this._defaultId)) throw new Error('default subvolume missing');
+    } catch (e) {
+      this._log('mount failed: ' + (e as Error).message);
+      return false;
+    }
+    this._mounted = true;
+    this._txnStart = Date.now();
+    return true;
+  }
+
+  /** Make a fresh filesystem on the whole device and mount it. */
+  format(label: string = 'JSDISK'): boolean {
+    if (this._total < 64) return false;
+    this._reset();
+    var zero = new Uint8Array(BS);
+    // Invalidate both slots first so an older filesystem can never win at mount
+    if (this._writeRun(0, zero) < 0 || this._writeRun(1, zero) < 0) return false;
+    this._gen = 0;
+    this._txn = 1;
+    this._label = label.slice(0, 63);
+    this._defaultId = FS_TREE_ID;
+    this._nextSubvol = FIRST_SUBVOL;
+    this._mounted = true;
+    try {
+      this._rootTree.root = this._newNode(0, ROOT_TREE_ID).block;
+      var now = Date.now();
+      var sv: Subvol = {
+        id: FS_TREE_ID, root: this._newNode(0, FS_TREE_ID).block, gen: 0, lastIno: ROOT_DIR_INO,
+        flags: 0, parent: 0, ctime: now, name: 'default', dirty: true,
+      };
+      this._subvols.set(sv.id, sv);
+      this._putInode(sv, ROOT_DIR_INO, { size: 0, mode: S_IFDIR | 0o755, nlink: 1, mtime: now, ctime: now, gen: 1 });
+    } catch (e) {
+      this._mounted = false;
+      this._log('format failed: ' + (e as Error).message);
+      return false;
+    }
+    if (this.commit() < 0) { this._mounted = false; return false; }
+    return true;
+  }
+
+  /** Commit and detach. */
+  unmount(): number {
+    if (!this._mounted) return 0;
+    var err = this.commit();
+    this._mounted = false;
+    return err;
+  }
+
+  private _reset(): void {
+    this._subvols.clear();
+    this._refBlocks.clear();
+    this._refLoc = [];
+    this._idxLoc = [];
+    this._meta.clear();
+    this._pinned.clear();
+    this._txnAlloc.clear();
+    this._cache.clear();
+    this._dirty.clear();
+    this._pendingData.clear();
+    this._changed = false;
+    this._used = 0;
+    this._cursor = FIRST_ALLOC;
+    this._rootTree.root = 0;
+  }
+
+  // ── Transactions ────────────────────────────────────────────────────────────
+
+  /**
+   * Commit the running transaction: root items, then every new block in
+   * address order as sequential runs, then the superblock.  Returns 0, or
+   * a negative errno (the previous commit stays the mounted state on disk).
+   */
+  commit(): number {
+    if (!this._mounted) return -5;
+    if (!this._changed) return 0;
+    var moved: number[] = [];
+    try {
+      for (var sv of this._subvols.values()) {
+        if (!sv.dirty) continue;
+        sv.gen = this._txn;
+        sv.dirty = false;
+        this._insert(this._rootTree, key(sv.id, ROOT_ITEM, 0), encodeRoot(sv));
+      }
+
+      var writes: Array<{ block: number; data: Uint8Array }> = [];
+      // Refcount blocks move to fresh homes (copy-on-write like everything else)
+      var dirtyIdx = new Set<number>();
+      for (var [ri, rb] of this._refBlocks) {
+        if (!rb.dirty) continue;
+        var loc = this._allocMeta();
+        if (this._refLoc[ri]) moved.push(this._refLoc[ri]);
+        this._refLoc[ri] = loc;
+        dirtyIdx.add(Math.floor(ri / PTRS_PER_IDX));
+        writes.push({ block: loc, data: this._encodeRefBlock(ri, rb) });
+      }
+      var nidx = Math.ceil(Math.ceil(this._total / REFS_PER_BLOCK) / PTRS_PER_IDX);
+      if (nidx > SB_MAX_IDX) throw new Error('device too large');
+      for (var x = 0; x < nidx; x++) if (!this._idxLoc[x]) dirtyIdx.add(x);
+      for (var ii of dirtyIdx) {
+        var iloc = this._allocMeta();
+        if (this._idxLoc[ii]) moved.push(this._idxLoc[ii]);
+        this._idxLoc[ii] = iloc;
+        writes.push({ block: iloc, data: this._encodeIdxBlock(ii) });
+      }
+      for (var n of this._dirty.values()) writes.push({ block: n.block, data: encodeNode(n) });
+      for (var [db, dd] of this._pendingData) writes.push({ block: db, data: dd });
+
+      // Ordered: everything the new superblock references is on disk before it
+      if (this._writeSorted(writes) < 0) throw new Error('write failed');
+      var sb = this._encodeSuper(nidx);
+      if (this._writeRun(this._txn & 1, sb) < 0) throw new Error('superblock write failed');
+    } catch (e) {
+      for (var m of moved) this._meta.delete(m);
+      this._log('commit failed: ' + (e as Error).message);
+      return -5; // EIO
+    }
+    for (var old of moved) this._meta.delete(old);
+    for (var rbk of this._refBlocks.values()) rbk.dirty = false;
+    this._pinned.clear();
+    this._txnAlloc.clear();
+    this._dirty.clear();
+    this._pendingData.clear();
+    this._changed = false;
+    this._gen = this._txn++;
+    this._txnStart = Date.now();
+    this.stats.commits++;
+    this._trimCache();
+    return 0;
+  }
+
+  /**
+   * Make everything written so far durable.  Free when nothing changed
+   * since the last commit, so fsyncs that follow a group commit cost nothing.
+   */
+  fsync(path?: string): number {
+    this.stats.fsyncs++;
+    return this._changed ? this.commit() : 0;
+  }
+
+  /** Group commit: every fsyncAsync() issued before the next microtask shares one commit. */
+  fsyncAsync(): Promise<number> {
+    this.stats.fsyncs++;
+    if (this._syncPending) { this.stats.groupedFsyncs++; return this._syncPending; }
+    if (!this._changed) return Promise.resolve(0);
+    var self = this;
+    this._syncPending = Promise.resolve().then(function() {
+      self._syncPending = null;
+      return self.commit();
+    });
+    return this._syncPending;
+  }
+
+  /** Commit a transaction left idle for COMMIT_MS; called from the event loop. */
+  tick(): void {
+    if (this._mounted && this._changed && Date.now() - this._txnStart >= COMMIT_MS) this.commit();
+  }
+
+  /** Commit when the running transaction is large or old enough. */
+  private _maybeCommit(): void {
+    if (this._pendingData.size * BS >= COMMIT_BYTES || this._dirty.size >= NODE_CACHE ||
+        (this._changed && Date.now() - this._txnStart >= COMMIT_MS)) {
+      this.commit();
+    }
+  }
+
+  // ── Snapshots ───────────────────────────────────────────────────────────────
+
+  /**
+   * Snapshot the default subvolume (or snapshot `source`) as `name`: O(1),
+   * one root item and one reference.  Readable at /.snapshots/<name>.
+   */
+  snapshot(name: string, readonly: boolean = true, source?: string): boolean {
+    if (!this._mounted || !name || name.indexOf('/') >= 0 || this._byName(name)) return false;
+    var src = source ? this._byName(source) : this._subvols.get(this._defaultId)!;
+    if (!src || this._ref(src.root) >= MAX_REFS) return false;
+    return this._guard(false, () => {
+      var sv: Subvol = {
+        id: this._nextSubvol++, root: src!.root, gen: this._txn, lastIno: src!.lastIno,
+        flags: readonly ? SUBVOL_READONLY : 0, parent: src!.id, ctime: Date.now(), name: name, dirty: true,
+      };
+      this._setRef(src!.root, this._ref(src!.root) + 1);
+      this._subvols.set(sv.id, sv);
+      this.stats.snapshots++;
+      return this.commit() === 0;
+    });
+  }
+
+  /** Delete snapshot `name`, freeing the blocks only it referenced. */
+  deleteSnapshot(name: string): boolean {
+    var sv = this._byName(name);
+    if (!sv || sv.id === this._defaultId) return false;
+    return this._guard(false, () => {
+      this._dropSubvol(sv!);
+      return this.commit() === 0;
+    });
+  }
+
+  /**
+   * Roll the default subvolume back to snapshot `name` in one atomic
+   * commit: a writable clone of the snapshot replaces it, and what only the
+   * old state referenced is freed.  The snapshot itself is kept.
+   */
+  rollback(name: string): boolean {
+    var snap = this._byName(name);
+    var cur = this._subvols.get(this._defaultId);
+    if (!snap || !cur || snap === cur || this._ref(snap.root) >= MAX_REFS) return false;
+    return this._guard(false, () => {
+      var sv: Subvol = {
+        id: this._nextSubvol++, root: snap!.root, gen: this._txn, lastIno: snap!.lastIno,
+        flags: 0, parent: snap!.id, ctime: Date.now(), name: cur!.name, dirty: true,
+      };
+      this._setRef(snap!.root, this._ref(snap!.root) + 1);
+      this._subvols.set(sv.id, sv);
+      this._defaultId = sv.id;
+      this._dropSubvol(cur!);
+      return this.commit() === 0;
+    });
+  }
+
+  snapshots(): CowSnapshotInfo[] {
+    var out: CowSnapshotInfo[] = [];
+    for (var sv of this._subvols.values()) {
+      if (sv.id === this._defaultId) continue;
+      out.push({ id: sv.id, name: sv.name, readonly: !!(sv.flags & SUBVOL_READONLY), generation: sv.gen, created: sv.ctime });
+    }
+    return out;
+  }
+
+  private _byName(name: string): Subvol | null {
+    for (var sv of this._subvols.values()) if (sv.name === name && sv.id !== this._defaultId) return sv;
+    return null;
+  }
+
+  private _dropSubvol(sv: Subvol): void {
+    this._delete(this._rootTree, key(sv.id, ROOT_ITEM, 0));
+    this._subvols.delete(sv.id);
+    this._decRef(sv.root);
+  }
+
+  // ── VFSMount ────────────────────────────────────────────────────────────────
+
+  read(path: string): string | null {
+    var b = this.readBytes(path);
+    return b ? utf8Decode(b) : null;
+  }
+
+  /** File contents, checksums verified.  Null if missing, a directory, or corrupt. */
+  readBytes(path: string): Uint8Array | null {
+    return this._guard(null, () => {
+      var at = this._locate(path);
+      if (!at || !at.sv) return null;
+      var inode = this._getInode(at.sv, at.ino);
+      if (!inode || (inode.mode & 0xf000) !== S_IFREG) return null;
+      return this._readFile(at.sv, at.ino, inode);
+    });
+  }
+
+  list(path: string): Array<{ name: string; type: FileType; size: number }> {
+    return this._guard([], () => {
+      var out: Array<{ name: string; type: FileType; size: number }> = [];
+      var at = this._locate(path);
+      if (!at) return out;
+      if (!at.sv) {
+        for (var s of this.snapshots()) out.push({ name: s.name, type: 'directory', size: 0 });
+        return out;
+      }
+      var sv = at.sv;
+      var ents: CowDirent[] = [];
+      this._scan(sv, key(at.ino, DIR_ENTRY, 0), key(at.ino, DIR_ENTRY, KEY_MAX), function(k, d) {
+        var list = decodeDirents(d);
+        for (var i = 0; i < list.length; i++) ents.push(list[i]);
+      });
+      for (var e of ents) {
+        var dir = e.ft === FT_DIR;
+        var ino = dir ? null : this._getInode(sv, e.ino);
+        out.push({ name: e.name, type: dir ? 'directory' : 'file', size: ino ? ino.size : 0 });
+      }
+      if (sv.id === this._defaultId && at.ino === ROOT_DIR_INO && this._subvols.size > 1) {
+        out.push({ name: SNAP_DIR, type: 'directory', size: 0 });
+      }
+      return out;
+    });
+  }
+
+  exists(path: string): boolean {
+    return this._guard(false, () => this._locate(path) !== null);
+  }
+
+  isDirectory(path: string): boolean {
+    return this._guard(false, () => {
+      var at = this._locate(path);
+      if (!at) return false;
+      if (!at.sv) return true;
+      var inode = this._getInode(at.sv, at.ino);
+      return !!inode && (inode.mode & 0xf000) === S_IFDIR;
+    });
+  }
+
+  writeFile(path: string, content: string | Uint8Array): boolean {
+    var data = typeof content === 'string' ? utf8Encode(content) : content;
+    return this._guard(false, () => {
+      var f = this._openForWrite(path, true);
+      if (!f) return false;
+      this._punch(f.sv, f.ino, 0, KEY_MAX);
+      f.inode.size = 0;
+      this._writeRange(f.sv, f.ino, f.inode, 0, data);
+      this._finishWrite(f.sv, f.ino, f.inode);
+      return true;
+    });
+  }
+
+  /** Append: only the partial tail block is rewritten; earlier extents are untouched. */
+  appendFile(path: string, content: string | Uint8Array): boolean {
+    var data = typeof content === 'string' ? utf8Encode(content) : content;
+    return this._guard(false, () => {
+      var f = this._openForWrite(path, true);
+      if (!f) return false;
+      this._writeRange(f.sv, f.ino, f.inode, f.inode.size, data);
+      this._finishWrite(f.sv, f.ino, f.inode);
+      return true;
+    });
+  }
+
+  /** Write `data` at byte `offset`, growing the file as needed (a gap becomes a hole). */
+  pwrite(path: string, data: Uint8Array, offset: number): boolean {
+    return this._guard(false, () => {
+      var f = this._openForWrite(path, false);
+      if (!f) return false;
+      this._writeRange(f.sv, f.ino, f.inode, offset, data);
+      this._finishWrite(f.sv, f.ino, f.inode);
+      return true;
+    });
+  }
+
+  deleteFile(path: string): void { this.remove(path); }
+
+  /** Remove a file or an empty directory. */
+  remove(path: string): boolean {
+    return this._guard(false, () => {
+      var p = this._split(path);
+      if (!p) return false;
+      var sv = this._writableSubvol(p.sv);
+      if (!sv) return false;
+      var ent = this._dirLookup(sv, p.dir, p.name);
+      if (!ent) return false;
+      if (ent.ft === FT_DIR) {
+        var empty = true;
+        this._scan(sv, key(ent.ino, DIR_ENTRY, 0), key(ent.ino, DIR_ENTRY, KEY_MAX), function() { empty = false; return true; });
+        if (!empty) return false;
+      } else {
+        this._punch(sv, ent.ino, 0, KEY_MAX);
+      }
+      this._delete(sv, key(ent.ino, INODE_ITEM, 0));
+      this._dirRemove(sv, p.dir, p.name);
+      this._touchDir(sv, p.dir);
+      this._maybeCommit();
+      return true;
+    });
+  }
+
+  rmdir(path: string): boolean { return this.isDirectory(path) && this.remove(path); }
+
+  mkdir(path: string): boolean {
+    return this._guard(false, () => {
+      var p = this._split(path);
+      if (!p) return false;
+      var sv = this._writableSubvol(p.sv);
+      if (!sv || this._dirLookup(sv, p.dir, p.name)) return false;
+      var now = Date.now();
+      var ino = ++sv.lastIno;
+      sv.dirty = true;
+      this._putInode(sv, ino, { size: 0, mode: S_IFDIR | 0o755, nlink: 1, mtime: now, ctime: now, gen: this._txn });
+      this._dirAdd(sv, p.dir, { ino: ino, ft: FT_DIR, name: p.name });
+      this._touchDir(sv, p.dir);
+      this._maybeCommit();
+      return true;
+    });
+  }
+
+  /** Usage in the shape the FAT drivers report (clusters = blocks), plus CoW details. */
+  getStats(): { fsType: string; label: string; totalClusters: number; freeClusters: number; bytesPerCluster: number;
+                freeGB: string; generation: number; subvolumes: number } {
+    var used = this._used + this._meta.size + FIRST_ALLOC;
+    var free = Math.max(0, this._total - used);
+    return {
+      fsType: 'cowfs', label: this._label, totalClusters: this._total, freeClusters: free, bytesPerCluster: BS,
+      freeGB: (free * BS / 1073741824).toFixed(2), generation: this._gen, subvolumes: this._subvols.size,
+    };
+  }
+
+  // ── Paths and directories ───────────────────────────────────────────────────
+
+  private _components(path: string): string[] | null {
+    var p = path;
+    if (this._mp) {
+      if (p === this._mp) p = '/';
+      else if (p.indexOf(this._mp + '/') === 0) p = p.slice(this._mp.length);
+    }
+    var parts = p.split('/').filter(function(s) { return s.length > 0 && s !== '.'; });
+    return parts.indexOf('..') >= 0 ? null : parts;
+  }
+
+  /** Subvolume and inode of a path; sv null for the /.snapshots directory itself. */
+  private _locate(path: string): Located | null {
+    if (!this._mounted) return null;
+    var parts = this._components(path);
+    if (!parts) return null;
+    var sv = this._subvols.get(this._defaultId)!;
+    var i = 0;
+    if (parts.length && parts[0] === SNAP_DIR) {
+      if (parts.length === 1) return { sv: null, ino: 0 };
+      var snap = this._byName(parts[1]);
+      if (!snap) return null;
+      sv = snap;
+      i = 2;
+    }
+    var ino = ROOT_DIR_INO;
+    for (; i < parts.length; i++) {
+      var e = this._dirLookup(sv, ino, parts[i]);
+      if (!e) return null;
+      if (i < parts.length - 1 && e.ft !== FT_DIR) return null;
+      ino = e.ino;
+    }
+    return { sv: sv, ino: ino };
+  }
+
+  /** Parent directory and final name of a path to be created or removed. */
+  private _split(path: string): { sv: Subvol; dir: number; name: string } | null {
+    var parts = this._components(path);
+    if (!parts || !parts.length) return null;
+    var name = parts.pop()!;
+    if (!parts.length && name === SNAP_DIR) return null;
+    var at = this._locate('/' + parts.join('/'));
+    if (!at || !at.sv) return null;
+    var inode = this._getInode(at.sv, at.ino);
+    if (!inode || (inode.mode & 0xf000) !== S_IFDIR) return null;
+    return { sv: at.sv, dir: at.ino, name: name };
+  }
+
+  private _writableSubvol(sv: Subvol): Subvol | null {
+    return sv.flags & SUBVOL_READONLY ? null : sv;
+  }
+
+  private _dirLookup(sv: Subvol, dir: number, name: string): CowDirent | null {
+    var d = this._lookup(sv, key(dir, DIR_ENTRY, nameHash(utf8Encode(name))));
+    if (!d) return null;
+    var list = decodeDirents(d);
+    for (var i = 0; i < list.length; i++) if (list[i].name === name) return list[i];
+    return null;
+  }
+
+  private _dirAdd(sv: Subvol, dir: number, e: CowDirent): void {
+    var k = key(dir, DIR_ENTRY, nameHash(utf8Encode(e.name)));
+    var d = this._lookup(sv, k);
+    var list = d ? decodeDirents(d) : [];
+    list.push(e);
+    this._insert(sv, k, encodeDirents(list));
+  }
+
+  private _dirRemove(sv: Subvol, dir: number, name: string): void {
+    var k = key(dir, DIR_ENTRY, nameHash(utf8Encode(name)));
+    var d = this._lookup(sv, k);
+    if (!d) return;
+    var list = decodeDirents(d).filter(function(e) { return e.name !== name; });
+    if (list.length) this._insert(sv, k, encodeDirents(list));
+    else this._delete(sv, k);
+  }
+
+  private _touchDir(sv: Subvol, dir: number): void {
+    var inode = this._getInode(sv, dir);
+    if (!inode) return;
+    inode.mtime = Date.now();
+    inode.gen = this._txn;
+    this._putInode(sv, dir, inode);
+  }
+
+  private _getInode(sv: Subvol, ino: number): CowInode | null {
+    var d = this._lookup(sv, key(ino, INODE_ITEM, 0));
+    return d ? decodeInode(d) : null;
+  }
+
+  private _putInode(sv: Subvol, ino: number, inode: CowInode): void {
+    this._insert(sv, key(ino, INODE_ITEM, 0), encodeInode(inode));
+  }
+
+  /** Existing regular file at `path`, or (if `create`) a new empty one. */
+  private _openForWrite(path: string, create: boolean): { sv: Subvol; ino: number; inode: CowInode } | null {
+    var p = this._split(path);
+    if (!p) return null;
+    var sv = this._writableSubvol(p.sv);
+    if (!sv) return null;
+    var e = this._dirLookup(sv, p.dir, p.name);
+    if (e) {
+      if (e.ft === FT_DIR) return null;
+      var inode = this._getInode(sv, e.ino);
+      return inode ? { sv: sv, ino: e.ino, inode: inode } : null;
+    }
+    if (!create) return null;
+    var now = Date.now();
+    var ino = ++sv.lastIno;
+    sv.dirty = true;
+    var fresh: CowInode = { size: 0, mode: S_IFREG | 0o644, nlink: 1, mtime: now, ctime: now, gen: this._txn };
+    this._dirAdd(sv, p.dir, { ino: ino, ft: FT_REG, name: p.name });
+    this._touchDir(sv, p.dir);
+    return { sv: sv, ino: ino, inode: fresh };
+  }
+
+  private _finishWrite(sv: Subvol, ino: number, inode: CowInode): void {
+    inode.mtime = Date.now();
+    inode.gen = this._txn;
+    this._putInode(sv, ino, inode);
+    this._maybeCommit();
+  }
+
+  // ── File data ───────────────────────────────────────────────────────────────
+
+  /** Extents of `ino` that can overlap file blocks [b0, b1), with their keys. */
+  private _extentsIn(sv: Subvol, ino: number, b0: number, b1: number): Array<{ k: CowKey; e: CowExtent }> {
+    var out: Array<{ k: CowKey; e: CowExtent }> = [];
+    var lo = Math.max(0, b0 - MAX_EXTENT_BLOCKS + 1) * BS;
+    var hi = b1 >= KEY_MAX / BS ? KEY_MAX : b1 * BS - 1;
+    this._scan(sv, key(ino, EXTENT_DATA, lo), key(ino, EXTENT_DATA, hi), function(k, d) {
+      out.push({ k: k, e: decodeExtent(d) });
+    });
+    return out;
+  }
+
+  private _readFile(sv: Subvol, ino: number, inode: CowInode): Uint8Array {
+    var out = new Uint8Array(inode.size);
+    var exts = this._extentsIn(sv, ino, 0, KEY_MAX);
+    for (var x of exts) {
+      var e = x.e;
+      if (e.inline) { out.set(e.inline.subarray(0, Math.min(e.inline.length, out.length))); continue; }
+      var start = x.k.off;
+      if (start >= out.length) continue;
+      var buf = this._readData(e.disk, e.blocks, e.csums!);
+      out.set(buf.subarray(0, Math.min(buf.length, out.length - start)), start);
+    }
+    return out;
+  }
+
+  /** Read data blocks (pending ones from memory), verifying each block's crc32c. */
+  private _readData(disk: number, n: number, csums: Uint32Array): Uint8Array {
+    var buf = new Uint8Array(n * BS);
+    var pending = false;
+    for (var i = 0; i < n && !pending; i++) if (this._pendingData.has(disk + i)) pending = true;
+    if (!pending) this._readRun(disk, buf, n);
+    else {
+      for (var j = 0; j < n; j++) {
+        var pd = this._pendingData.get(disk + j);
+        if (pd) buf.set(pd, j * BS);
+        else this._readRun(disk + j, buf.subarray(j * BS, (j + 1) * BS), 1);
+      }
+    }
+    for (var c = 0; c < n; c++) {
+      if (blockCsum(buf.subarray(c * BS, (c + 1) * BS), 0) !== csums[c]) {
+        this.stats.csumErrors++;
+        throw new Error('data checksum mismatch in block ' + (disk + c));
+      }
+    }
+    return buf;
+  }
+
+  /** Current contents of file block `fb` into `dst` (zeroes for a hole). */
+  private _readFileBlock(sv: Subvol, ino: number, fb: number, dst: Uint8Array): void {
+    for (var x of this._extentsIn(sv, ino, fb, fb + 1)) {
+      var e = x.e;
+      if (e.inline) { if (fb === 0) dst.set(e.inline.subarray(0, Math.min(BS, e.inline.length))); continue; }
+      var s = x.k.off / BS;
+      if (fb < s || fb >= s + e.blocks) continue;
+      dst.set(this._readData(e.disk + (fb - s), 1, e.csums!.subarray(fb - s, fb - s + 1)));
+    }
+  }
+
+  /**
+   * Write `data` at byte `pos`: whole new blocks for the covered range (the
+   * partial first and last blocks are merged with their old contents), the
+   * overlapped parts of old extents released.  Small files stay inline.
+   */
+  private _writeRange(sv: Subvol, ino: number, inode: CowInode, pos: number, data: Uint8Array): void {
+    if (!data.length) return;
+    var end = pos + data.length;
+    var size = Math.max(inode.size, end);
+    var inlineKey = key(ino, EXTENT_DATA, 0);
+    if (size <= INLINE_MAX) {
+      var body = inode.size ? this._readFile(sv, ino, inode) : new Uint8Array(0);
+      var merged = new Uint8Array(size);
+      merged.set(body.subarray(0, Math.min(body.length, size)));
+      merged.set(data, pos);
+      this._punch(sv, ino, 0, KEY_MAX);
+      if (size) this._insert(sv, inlineKey, encodeInline(merged));
+      inode.size = size;
+      return;
+    }
+    // Growing out of an inline body: move it into a block first
+    var inl = inode.size ? this._lookup(sv, inlineKey) : null;
+    if (inl && inl[0] === 0) {
+      var old = inl.subarray(1, 1 + inode.size).slice();
+      this._delete(sv, inlineKey);
+      this._putBlocks(sv, ino, 0, old);
+    }
+    var b0 = Math.floor(pos / BS), b1 = Math.ceil(end / BS);
+    var buf = new Uint8Array((b1 - b0) * BS);
+    if (pos % BS && b0 * BS < inode.size) this._readFileBlock(sv, ino, b0, buf.subarray(0, BS));
+    if (end % BS && (b1 - 1) * BS < inode.size && (b1 - 1 > b0 || !(pos % BS))) {
+      this._readFileBlock(sv, ino, b1 - 1, buf.subarray((b1 - 1 - b0) * BS));
+    }
+    buf.set(data, pos - b0 * BS);
+    this._putBlocks(sv, ino, b0, buf);
+    inode.size = size;
+  }
+
+  /** Replace file blocks [fb, fb + ceil(len/BS)) by freshly allocated copies of `buf`. */
+  private _putBlocks(sv: Subvol, ino: number, fb: number, buf: Uint8Array): void {
+    var n = Math.ceil(buf.length / BS);
+    this._punch(sv, ino, fb, fb + n);
+    var done = 0;
+    while (done < n) {
+      var run = this._allocRun(Math.min(n - done, MAX_EXTENT_BLOCKS));
+      var csums = new Uint32Array(run.len);
+      for (var j = 0; j < run.len; j++) {
+        var blk = new Uint8Array(BS);
+        var from = (done + j) * BS;
+        blk.set(buf.subarray(from, Math.min(buf.length, from + BS)));
+        csums[j] = blockCsum(blk, 0);
+        this._pendingData.set(run.start + j, blk);
+      }
+      this._insert(sv, key(ino, EXTENT_DATA, (fb + done) * BS), encodeExtent(run.start, csums));
+      done += run.len;
+    }
+  }
+
+  /**
+   * Drop file blocks [b0, b1) from `ino`'s extents: overlapped blocks lose a
+   * reference, extents straddling the edges are trimmed (their remaining
+   * blocks keep their references and checksums).
+   */
+  private _punch(sv: Subvol, ino: number, b0: number, b1: number): void {
+    var exts = this._extentsIn(sv, ino, b0, b1);
+    for (var x of exts) {
+      var e = x.e;
+      if (e.inline) { this._delete(sv, x.k); continue; }
+      var s = x.k.off / BS, t = s + e.blocks;
+      var lo = Math.max(s, b0), hi = Math.min(t, b1);
+      if (lo >= hi) continue;
+      this._delete(sv, x.k);
+      for (var b = lo; b < hi; b++) this._decData(e.disk + (b - s));
+      if (s < lo) this._insert(sv, key(ino, EXTENT_DATA, s * BS), encodeExtent(e.disk, e.csums!.slice(0, lo - s)));
+      if (hi < t) this._insert(sv, key(ino, EXTENT_DATA, hi * BS), encodeExtent(e.disk + (hi - s), e.csums!.slice(hi - s)));
+    }
+  }
+
+  // ── B-tree ──────────────────────────────────────────────────────────────────
+
+  /** Parsed node, through the cache.  `gen` (from the parent pointer) is verified. */
+  private _node(block: number, gen?: number): CowNode {
+    var n = this._cache.get(block);
+    if (n) {
+      this.stats.nodeHits++;
+      if (!this._dirty.has(block)) { this._cache.delete(block); this._cache.set(block, n); }
+    } else {
+      this.stats.nodeMisses++;
+      var parsed = parseNode(this._readBlock(block), block);
+      if (typeof parsed === 'string') {
+        this.stats.csumErrors++;
+        throw new Error(parsed + ' (block ' + block + ')');
+      }
+      n = parsed;
+      this._cache.set(block, n);
+      if (this._cache.size > NODE_CACHE + this._dirty.size) this._trimCache();
+    }
+    if (gen !== undefined && n.gen !== gen) {
+      throw new Error('node ' + block + ' generation ' + n.gen + ', parent expects ' + gen);
+    }
+    return n;
+  }
+
+  private _trimCache(): void {
+    var excess = this._cache.size - NODE_CACHE - this._dirty.size;
+    if (excess <= 0) return;
+    for (var b of this._cache.keys()) {
+      if (this._dirty.has(b)) continue;
+      this._cache.delete(b);
+      if (--excess <= 0) break;
+    }
+  }
+
+  /** New empty node, allocated and dirty in the running transaction. */
+  private _newNode(level: number, owner: number): CowNode {
+    var block = this._allocRun(1).start;
+    var n: CowNode = { block: block, gen: this._txn, owner: owner, level: level, keys: [], items: [], ptrs: [], gens: [] };
+    this._cache.set(block, n);
+    this._dirty.set(block, n);
+    return n;
+  }
+
+  /**
+   * Writable version of `n`: itself if it was created by the running
+   * transaction and is not shared, else a copy.  Copying a shared node gives
+   * its children (or data blocks) one more reference; copying an exclusive
+   * one moves them, and frees the original.
+   */
+  private _cow(n: CowNode, owner: number): CowNode {
+    var refs = this._ref(n.block);
+    if (n.gen === this._txn && refs === 1) return n;
+    var c = this._newNode(n.level, owner);
+    c.keys = n.keys.slice();
+    c.items = n.items.slice();
+    c.ptrs = n.ptrs.slice();
+    c.gens = n.gens.slice();
+    if (refs > 1) {
+      this._refChildren(n, 1);
+      this._setRef(n.block, refs - 1);
+    } else {
+      this._release(n.block);
+    }
+    this.stats.cows++;
+    return c;
+  }
+
+  /** Add (+1) or drop (-1) the references a node holds on its children / data blocks. */
+  private _refChildren(n: CowNode, delta: number): void {
+    if (n.level > 0) {
+      for (var i = 0; i < n.ptrs.length; i++) {
+        if (delta > 0) this._setRef(n.ptrs[i], this._ref(n.ptrs[i]) + 1);
+        else this._decRef(n.ptrs[i]);
+      }
+      return;
+    }
+    for (var j = 0; j < n.keys.length; j++) {
+      if (n.keys[j].type !== EXTENT_DATA || n.items[j][0] === 0) continue;
+      var e = decodeExtent(n.items[j]);
+      for (var b = e.disk; b < e.disk + e.blocks; b++) {
+        if (delta > 0) this._setRef(b, this._ref(b) + 1);
+        else this._decData(b);
+      }
+    }
+  }
+
+  /** Drop one reference to a tree node; the last one frees its subtree. */
+  private _decRef(block: number): void {
+    var r = this._ref(block);
+    if (r > 1) { this._setRef(block, r - 1); return; }
+    this._refChildren(this._node(block), -1);
+    this._release(block);
+  }
+
+  private _decData(block: number): void {
+    var r = this._ref(block);
+    if (r > 1) this._setRef(block, r - 1);
+    else this._release(block);
+  }
+
+  /** Free a block whose last reference is gone (children already dealt with). */
+  private _release(block: number): void {
+    this._setRef(block, 0);
+    this._cache.delete(block);
+    if (this._txnAlloc.delete(block)) {
+      // Never committed: nothing on disk refers to it, reuse at once
+      this._dirty.delete(block);
+      this._pendingData.delete(block);
+    } else {
+      this._pinned.add(block);
+    }
+  }
+
+  /** Search for `k`; with `cow` every node on the path is made writable first. */
+  private _path(t: Subvol, k: CowKey, cow: boolean): TreePath {
+    var nodes: CowNode[] = [], slots: number[] = [];
+    var n = this._node(t.root);
+    if (cow) {
+      n = this._cow(n, t.id);
+      if (n.block !== t.root) { t.root = n.block; t.dirty = true; }
+    }
+    for (;;) {
+      nodes.push(n);
+      if (n.level === 0) {
+        var s = lowerBound(n.keys, k);
+        slots.push(s);
+        return { nodes: nodes, slots: slots, found: s < n.keys.length && cmpKey(n.keys[s], k) === 0 };
+      }
+      var cs = childSlot(n.keys, k);
+      slots.push(cs);
+      var child = this._node(n.ptrs[cs], n.gens[cs]);
+      if (cow) {
+        var w = this._cow(child, t.id);
+        if (w !== child) { n.ptrs[cs] = w.block; n.gens[cs] = w.gen; }
+        child = w;
+      }
+      n = child;
+    }
+  }
+
+  private _lookup(t: Subvol, k: CowKey): Uint8Array | null {
+    var n = this._node(t.root);
+    while (n.level > 0) {
+      var cs = childSlot(n.keys, k);
+      n = this._node(n.ptrs[cs], n.gens[cs]);
+    }
+    var s = lowerBound(n.keys, k);
+    return s < n.keys.length && cmpKey(n.keys[s], k) === 0 ? n.items[s] : null;
+  }
+
+  /** Insert or replace the item at `k`. */
+  private _insert(t: Subvol, k: CowKey, data: Uint8Array): void {
+    if (data.length > MAX_ITEM) throw new Error('item too large');
+    var p = this._path(t, k, true);
+    var li = p.nodes.length - 1;
+    var leaf = p.nodes[li], s = p.slots[li];
+    if (p.found) leaf.items[s] = data;
+    else { leaf.keys.splice(s, 0, k); leaf.items.splice(s, 0, data); }
+    if (leafBytes(leaf) > LEAF_SPACE) this._splitLeaf(t, p);
+  }
+
+  private _splitLeaf(t: Subvol, p: TreePath): void {
+    var li = p.nodes.length - 1;
+    var leaf = p.nodes[li];
+    var n = leaf.keys.length;
+    var total = leafBytes(leaf);
+    var m = 1, left = ITEM_SIZE + leaf.items[0].length;
+    while (m < n - 1 && left + ITEM_SIZE + leaf.items[m].length <= total / 2) { left += ITEM_SIZE + leaf.items[m].length; m++; }
+    while (m < n - 1 && total - left > LEAF_SPACE) { left += ITEM_SIZE + leaf.items[m].length; m++; }
+    var right = this._newNode(0, t.id);
+    right.keys = leaf.keys.splice(m);
+    right.items = leaf.items.splice(m);
+    this._insertPtr(t, p, li - 1, right);
+  }
+
+  /** Link new node `nn` right after path node li + 1 in its parent at level li, splitting upwards. */
+  private _insertPtr(t: Subvol, p: TreePath, li: number, nn: CowNode): void {
+    if (li < 0) {
+      var old = p.nodes[0];
+      var root = this._newNode(old.level + 1, t.id);
+      root.keys = [old.keys[0] || key(0, 0, 0), nn.keys[0]];
+      root.ptrs = [old.block, nn.block];
+      root.gens = [old.gen, nn.gen];
+      t.root = root.block;
+      t.dirty = true;
+      return;
+    }
+    var parent = p.nodes[li], s = p.slots[li] + 1;
+    parent.keys.splice(s, 0, nn.keys[0]);
+    parent.ptrs.splice(s, 0, nn.block);
+    parent.gens.splice(s, 0, nn.gen);
+    if (parent.ptrs.length <= MAX_PTRS) return;
+    var m = parent.ptrs.length >> 1;
+    var right = this._newNode(parent.level, t.id);
+    right.keys = parent.keys.splice(m);
+    right.ptrs = parent.ptrs.splice(m);
+    right.gens = parent.gens.splice(m);
+    this._insertPtr(t, p, li - 1, right);
+  }
+
+  /** Remove the item at `k`.  Returns false if there was none. */
+  private _delete(t: Subvol, k: CowKey): boolean {
+    if (!this._lookup(t, k)) return false;
+    var p = this._path(t, k, true);
+    var li = p.nodes.length - 1;
+    p.nodes[li].keys.splice(p.slots[li], 1);
+    p.nodes[li].items.splice(p.slots[li], 1);
+    this._prune(t, p, li);
+    return true;
+  }
+
+  /** Unlink emptied nodes bottom-up and shrink a single-child root. */
+  private _prune(t: Subvol, p: TreePath, li: number): void {
+    var n = p.nodes[li];
+    if (li === 0) {
+      if (n.level > 0 && n.ptrs.length === 0) { n.level = 0; return; }
+      while (n.level > 0 && n.ptrs.length === 1) {
+        var child = this._node(n.ptrs[0], n.gens[0]);
+        this._release(n.block);
+        t.root = child.block;
+        t.dirty = true;
+        n = child;
+      }
+      return;
+    }
+    if (n.keys.length > 0) return;
+    var parent = p.nodes[li - 1], ps = p.slots[li - 1];
+    parent.keys.splice(ps, 1);
+    parent.ptrs.splice(ps, 1);
+    parent.gens.splice(ps, 1);
+    this._release(n.block);
+    this._prune(t, p, li - 1);
+  }
+
+  /** Visit items lo <= key <= hi in order; `fn` returns true to stop.  The tree must not change meanwhile. */
+  private _scan(t: Subvol, lo: CowKey, hi: CowKey, fn: (k: CowKey, d: Uint8Array) => boolean | void): void {
+    var stack: Array<{ n: CowNode; i: number }> = [];
+    var n = this._node(t.root);
+    while (n.level > 0) {
+      var cs = childSlot(n.keys, lo);
+      stack.push({ n: n, i: cs });
+      n = this._node(n.ptrs[cs], n.gens[cs]);
+    }
+    var i = lowerBound(n.keys, lo);
+    for (;;) {
+      for (; i < n.keys.length; i++) {
+        if (cmpKey(n.keys[i], hi) > 0) return;
+        if (fn(n.keys[i], n.items[i])) return;
+      }
+      while (stack.length) {
+        var top = stack[stack.length - 1];
+        if (++top.i < top.n.ptrs.length) break;
+        stack.pop();
+      }
+      if (!stack.length) return;
+      var up = stack[stack.length - 1];
+      if (cmpKey(up.n.keys[up.i], hi) > 0) return;
+      n = this._node(up.n.ptrs[up.i], up.n.gens[up.i]);
+      while (n.level > 0) {
+        stack.push({ n: n, i: 0 });
+        n = this._node(n.ptrs[0], n.gens[0]);
+      }
+      i = 0;
+    }
+  }
+
+  // ── Space map ───────────────────────────────────────────────────────────────
+
+  private _refBlock(ri: number): RefBlock {
+    var rb = this._refBlocks.get(ri);
+    if (rb) return rb;
+    var counts = new Uint16Array(REFS_PER_BLOCK);
+    var loc = this._refLoc[ri];
+    if (loc) {
+      var b = this._readBlock(loc);
+      if (rd32(b, 4) !== REF_MAGIC || rd32(b, 0) !== blockCsum(b, 4) || rd32(b, 8) !== ri) {
+        this.stats.csumErrors++;
+        throw new Error('bad refcount block ' + loc);
+      }
+      for (var i = 0; i < REFS_PER_BLOCK; i++) counts[i] = rd16(b, REF_HDR + i * 2);
+    }
+    var free = 0;
+    var first = ri * REFS_PER_BLOCK;
+    var lim = Math.min(REFS_PER_BLOCK, this._total - first);
+    for (var j = 0; j < lim; j++) if (!counts[j]) free++;
+    rb = { counts: counts, free: free, dirty: false };
+    this._refBlocks.set(ri, rb);
+    return rb;
+  }
+
+  private _ref(block: number): number {
+    return this._refBlock(Math.floor(block / REFS_PER_BLOCK)).counts[block % REFS_PER_BLOCK];
+  }
+
+  private _setRef(block: number, v: number): void {
+    if (v > MAX_REFS) throw new Error('reference count overflow');
+    var rb = this._refBlock(Math.floor(block / REFS_PER_BLOCK));
+    var i = block % REFS_PER_BLOCK;
+    var was = rb.counts[i];
+    if (was === v) return;
+    if (!was) { rb.free--; this._used++; }
+    else if (!v) { rb.free++; this._used--; }
+    rb.counts[i] = v;
+    rb.dirty = true;
+    if (!this._changed) { this._changed = true; this._txnStart = Date.now(); }
+  }
+
+  private _isFree(b: number): boolean {
+    return this._ref(b) === 0 && !this._pinned.has(b) && !this._meta.has(b);
+  }
+
+  /**
+   * Allocate up to `max` contiguous blocks at the cursor (next-fit), each
+   * with one reference.  Consecutive allocations are consecutive on disk.
+   */
+  private _allocRun(max: number): { start: number; len: number } {
+    var start = this._findFree();
+    var len = 1;
+    while (len < max && start + len < this._total && this._isFree(start + len)) len++;
+    for (var b = start; b < start + len; b++) {
+      this._setRef(b, 1);
+      this._txnAlloc.add(b);
+    }
+    this._cursor = start + len;
+    return { start: start, len: len };
+  }
+
+  /** A home for a refcount or index block (these are not counted in the table). */
+  private _allocMeta(): number {
+    var b = this._findFree();
+    this._meta.add(b);
+    this._cursor = b + 1;
+    return b;
+  }
+
+  private _findFree(): number {
+    var b = this._cursor;
+    for (var scanned = 0; scanned < this._total; ) {
+      if (b >= this._total) b = FIRST_ALLOC;
+      var ri = Math.floor(b / REFS_PER_BLOCK);
+      if (this._refBlock(ri).free === 0) {
+        // Whole refcount block full: skip to the next one
+        var next = (ri + 1) * REFS_PER_BLOCK;
+        scanned += next - b;
+        b = next;
+        continue;
+      }
+      if (this._isFree(b)) return b;
+      b++;
+      scanned++;
+    }
+    throw new Error('no space left on device');
+  }
+
+  private _encodeRefBlock(ri: number, rb: RefBlock): Uint8Array {
+    var b = new Uint8Array(BS);
+    wr32(b, 4, REF_MAGIC);
+    wr32(b, 8, ri);
+    for (var i = 0; i < REFS_PER_BLOCK; i++) wr16(b, REF_HDR + i * 2, rb.counts[i]);
+    wr32(b, 0, blockCsum(b, 4));
+    return b;
+  }
+
+  private _encodeIdxBlock(ii: number): Uint8Array {
+    var b = new Uint8Array(BS);
+    wr32(b, 4, IDX_MAGIC);
+    wr32(b, 8, ii);
+    for (var j = 0; j < PTRS_PER_IDX; j++) wr64(b, IDX_HDR + j * 8, this._refLoc[ii * PTRS_PER_IDX + j] || 0);
+    wr32(b, 0, blockCsum(b, 4));
+    return b;
+  }
+
+  private _encodeSuper(nidx: number): Uint8Array {
+    var b = new Uint8Array(BS);
+    wr32(b, SB_MAGIC_OFF, SB_MAGIC);
+    wr32(b, SB_VERSION, FORMAT_VERSION);
+    wr32(b, SB_BLOCKSIZE, BS);
+    wr64(b, SB_GEN, this._txn);
+    wr64(b, SB_TOTAL, this._total);
+    wr64(b, SB_ROOT, this._rootTree.root);
+    wr64(b, SB_DEFAULT, this._defaultId);
+    wr64(b, SB_NEXT_SUBVOL, this._nextSubvol);
+    wr64(b, SB_USED, this._used);
+    wr32(b, SB_NIDX, nidx);
+    b.set(utf8Encode(this._label).subarray(0, 63), SB_LABEL);
+    for (var i = 0; i < nidx; i++) wr64(b, SB_IDX + i * 8, this._idxLoc[i]);
+    wr32(b, 0, blockCsum(b, 4));
+    return b;
+  }
+
+  // ── Device I/O ──────────────────────────────────────────────────────────────
+
+  private _readBlock(block: number): Uint8Array {
+    var b = new Uint8Array(BS);
+    this._readRun(block, b, 1);
+    return b;
+  }
+
+  private _readRun(block: number, dst: Uint8Array, n: number): void {
+    var off = block * BS, len = n * BS;
+    if (this._dev.readInto) {
+      if (this._dev.readInto(off, dst, 0, len) < 0) throw new Error('read error at block ' + block);
+      return;
+    }
+    for (var o = 0; o < len; o += 512) dst.set(this._dev.readSector(off + o), o);
+  }
+
+  private _writeRun(block: number, src: Uint8Array): number {
+    var off = block * BS;
+    this.stats.writeRuns++;
+    this.stats.blocksWritten += src.length / BS;
+    if (this._dev.writeFrom) return this._dev.writeFrom(off, src, 0, src.length) < 0 ? -5 : 0;
+    for (var o = 0; o < src.length; o += 512) {
+      if (this._dev.writeSector(off + o, src.subarray(o, o + 512)) < 0) return -5;
+    }
+    return 0;
+  }
+
+  /** Write blocks in address order, one device request per contiguous run. */
+  private _writeSorted(writes: Array<{ block: number; data: Uint8Array }>): number {
+    writes.sort(function(a, b) { return a.block - b.block; });
+    for (var i = 0; i < writes.length; ) {
+      var j = i + 1;
+      while (j < writes.length && writes[j].block === writes[j - 1].block + 1) j++;
+      var run: Uint8Array;
+      if (j - i === 1) run = writes[i].data;
+      else {
+        run = new Uint8Array((j - i) * BS);
+        for (var k = i; k < j; k++) run.set(writes[k].data, (k - i) * BS);
+      }
+      if (this._writeRun(writes[i].block, run) < 0) return -5;
+      i = j;
+    }
+    return 0;
+  }
+
+  // ── Errors ──────────────────────────────────────────────────────────────────
+
+  /** Run a VFS operation; corruption or I/O errors are logged and give `fallback`. */
+  private _guard<T>(fallback: T, fn: () => T): T {
+    if (!this._mounted) return fallback;
+    try { return fn(); }
+    catch (e) { this._log((e as Error).message); return fallback; }
+  }
+
+  private _log(msg: string): void {
+    if (typeof kernel !== 'undefined' && kernel.serialPut) kernel.serialPut('[cowfs] ' + msg + '\n');
+  }
+}
+
+// ── Disk device ───────────────────────────────────────────────────────────────
+
+/**
+ * The primary disk as an Ext4BlockDevice, over kernel.ataRead / ataWrite
+ * (at most 8 sectors per request, so runs go out as 4 KB requests).
+ */
+export class AtaDiskDevice implements Ext4BlockDevice {
+  get sizeBytes(): number { return kernel.ataSectorCount() * 512; }
+
+  readSector(byteOffset: number): Uint8Array {
+    var ab = (kernel.ataRead as any)(Math.floor(byteOffset / 512), 1) as ArrayBuffer | null;
+    return ab ? new Uint8Array(ab) : new Uint8Array(512);
+  }
+
+  writeSector(byteOffset: number, data: Uint8Array): number {
+    return (kernel.ataWrite as any)(Math.floor(byteOffset / 512), 1, data.slice(0, 512).buffer) ? 0 : -5;
+  }
+
+  readInto(byteOffset: number, dst: Uint8Array, dstOffset: number, length: number): number {
+    var lba = Math.floor(byteOffset / 512);
+    for (var o = 0; o < length; o += 4096) {
+      var secs = Math.min(8, Math.ceil((length - o) / 512));
+      var ab = (kernel.ataRead as any)(lba + (o >> 9), secs) as ArrayBuffer | null;
+      if (!ab) return -5;
+      dst.set(new Uint8Array(ab, 0, Math.min(secs * 512, length - o)), dstOffset + o);
+    }
+    return length;
+  }
+
+  writeFrom(byteOffset: number, src: Uint8Array, srcOffset: number, length: number): number {
+    var lba = Math.floor(byteOffset / 512);
+    for (var o = 0; o < length; o += 4096) {
+      var n = Math.min(4096, length - o);
+      var secs = Math.ceil(n / 512);
+      var chunk = new Uint8Array(secs * 512);
+      chunk.set(src.subarray(srcOffset + o, srcOffset + o + n));
+      if (!(kernel.ataWrite as any)(lba + (o >> 9), secs, chunk.buffer)) return -5;
+    }
+    return length;
+  }
+}
+
+/** Mount a CoW filesystem on `dev`, or null if it holds none. */
+export function mountCowFS(dev: Ext4BlockDevice, sizeBytes: number, mountpoint: string = ''): CowFS | null {
+  var fs = new CowFS(dev, sizeBytes, mountpoint);
+  return fs.mount() ? fs : null;
+}
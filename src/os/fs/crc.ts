@@ -0,0 +1,87 @@
+/**
+ * JSOS on-disk checksums shared by the filesystem drivers
+ *
+ *   crc32c — Castagnoli CRC-32 (reflected, poly 0x82F63B78), the metadata
+ *            checksum of ext4 (metadata_csum), JBD2 (csum v2/v3) and btrfs.
+ *   crc32  — IEEE CRC-32 (reflected, poly 0xEDB88320), the gzip trailer.
+ *   crc16  — CRC-16/ARC (reflected, poly 0xA001), ext4's older gdt_csum.
+ *
+ * Both are the raw register update used by those formats: the caller passes
+ * the running value (ext4 seeds with ~0) and no final inversion is applied
+ * (gzip stores the inverted register).  The 32-bit CRCs use slicing-by-4
+ * tables built on first use; crc32c goes to the kernel's native CRC-32C
+ * (SSE4.2) for anything but tiny inputs when it is available.
+ */
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
+/** Below this many bytes the call into C costs more than the table loop. */
+const NATIVE_MIN = 64;
+
+var _c32: Uint32Array | null = null;   // 4 × 256 slicing tables, Castagnoli
+var _c32i: Uint32Array | null = null;  // same, IEEE
+var _c16: Uint16Array | null = null;
+
+function c32Tables(): Uint32Array {
+  return _c32 || (_c32 = sliceTables(0x82F63B78));
+}
+
+function sliceTables(poly: number): Uint32Array {
+  var t = new Uint32Array(1024);
+  for (var i = 0; i < 256; i++) {
+    var c = i;
+    for (var k = 0; k < 8; k++) c = c & 1 ? (c >>> 1) ^ poly : c >>> 1;
+    t[i] = c >>> 0;
+  }
+  for (var j = 0; j < 256; j++) {
+    t[256 + j] = (t[t[j] & 0xff] ^ (t[j] >>> 8)) >>> 0;
+    t[512 + j] = (t[t[256 + j] & 0xff] ^ (t[256 + j] >>> 8)) >>> 0;
+    t[768 + j] = (t[t[512 + j] & 0xff] ^ (t[512 + j] >>> 8)) >>> 0;
+  }
+  return t;
+}
+
+/** Update `crc` with `len` bytes of `buf` from `off`. */
+export function crc32c(crc: number, buf: Uint8Array, off: number = 0, len: number = buf.length - off): number {
+  if (len >= NATIVE_MIN && typeof kernel !== 'undefined' && kernel.crc32c) return kernel.crc32c(crc, buf, off, len);
+  return slice4(c32Tables(), crc, buf, off, len);
+}
+
+/** IEEE CRC-32 register update; gzip's value is ~crc32(~0, data). */
+export function crc32(crc: number, buf: Uint8Array, off: number = 0, len: number = buf.length - off): number {
+  return slice4(_c32i || (_c32i = sliceTables(0xEDB88320)), crc, buf, off, len);
+}
+
+function slice4(t: Uint32Array, crc: number, buf: Uint8Array, off: number, len: number): number {
+  var i = off, end = off + len;
+  crc = crc >>> 0;
+  for (; i + 4 <= end; i += 4) {
+    crc ^= buf[i] | (buf[i + 1] << 8) | (buf[i + 2] << 16) | (buf[i + 3] << 24);
+    crc = t[768 + (crc & 0xff)] ^ t[512 + ((crc >>> 8) & 0xff)] ^
+          t[256 + ((crc >>> 16) & 0xff)] ^ t[crc >>> 24];
+  }
+  for (; i < end; i++) crc = t[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  return crc >>> 0;
+}
+
+/** crc32c of a little-endian 32-bit integer (inode numbers, group numbers). */
+export function crc32cU32(crc: number, v: number): number {
+  var b = new Uint8Array(4);
+  b[0] = v & 0xff; b[1] = (v >>> 8) & 0xff; b[2] = (v >>> 16) & 0xff; b[3] = (v >>> 24) & 0xff;
+  return crc32c(crc, b, 0, 4);
+}
+
+/** Update a CRC-16/ARC register with `len` bytes of `buf` from `off`. */
+export function crc16(crc: number, buf: Uint8Array, off: number = 0, len: number = buf.length - off): number {
+  if (!_c16) {
+    _c16 = new Uint16Array(256);
+    for (var i = 0; i < 256; i++) {
+      var c = i;
+      for (var k = 0; k < 8; k++) c = c & 1 ? (c >>> 1) ^ 0xA001 : c >>> 1;
+      _c16[i] = c;
+    }
+  }
+  crc &= 0xffff;
+  for (var j = off, end = off + len; j < end; j++) crc = _c16[(crc ^ buf[j]) & 0xff] ^ (crc >>> 8);
+  return crc;
+}
@@ -0,0 +1,522 @@
+/**
+ * JSOS streaming decompressors for boot images
+ *
+ * Incremental gzip and LZ4 decoders for the initramfs.  Each stream appends
+ * to one growable output buffer and stops after roughly `budget` bytes per
+ * pump(), so the caller can interleave unpacking with other boot work and
+ * consume what has been produced so far (fs/initramfs.ts parses cpio
+ * entries as soon as they are complete).
+ *
+ *   gzip        — RFC 1952 members (concatenated members and trailing zero
+ *                 padding allowed) around RFC 1951 DEFLATE, CRC-32 checked.  The inflater is
+ *                 a generator, so its state between pumps is just the
+ *                 suspended frame; it yields every INFLATE_SLICE bytes.
+ *                 Huffman codes are decoded through flat lookup tables.
+ *   lz4         — LZ4 frame format (magic 0x184D2204), linked or
+ *                 independent blocks, skippable frames.  Independent
+ *                 blocks go through the native decoder when the kernel
+ *                 has one (kernel.lz4Decompress).
+ *   lz4-legacy  — the Linux kernel's legacy LZ4 format (magic 0x184C2102,
+ *                 8 MB blocks), what `lz4 -l` and the kernel build produce.
+ *   none        — uncompressed input: the output *is* the input, no copy.
+ *
+ * Back-references are resolved against the output buffer itself, so there
+ * is no separate window.  The output is sized up front when the format
+ * records the length (gzip ISIZE, LZ4 content size) and doubles otherwise;
+ * views taken before a doubling keep the old buffer alive.
+ */
+
+import { crc32 } from './crc.js';
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
+export type StreamFormat = 'none' | 'gzip' | 'lz4' | 'lz4-legacy';
+
+/** Output bytes produced so far: `buf[0 … len)`. */
+export class OutBuffer {
+  buf: Uint8Array;
+  len = 0;
+  /** How many times `buf` was replaced by a larger copy. */
+  grows = 0;
+
+  constructor(capacity: number) {
+    this.buf = new Uint8Array(Math.max(capacity, 4096));
+  }
+
+  /** Room for `n` more bytes; returns the (possibly new) buffer. */
+  ensure(n: number): Uint8Array {
+    var need = this.len + n;
+    if (need <= this.buf.length) return this.buf;
+    var cap = this.buf.length * 2;
+    while (cap < need) cap *= 2;
+    var nb = new Uint8Array(cap);
+    nb.set(this.buf.subarray(0, this.len));
+    this.buf = nb;
+    this.grows++;
+    return nb;
+  }
+}
+
+export interface DecompressStream {
+  readonly format: StreamFormat;
+  readonly out:    OutBuffer;
+  /** True once the whole input has been decoded. */
+  readonly done:   boolean;
+  /**
+   * Decode about `budget` more output bytes.  Returns false once the input
+   * is exhausted.  Throws Error on corrupt or truncated input.
+   */
+  pump(budget: number): boolean;
+}
+
+/** Pick a decoder by magic number.  Unknown formats pass through as 'none'. */
+export function openDecompressStream(src: Uint8Array): DecompressStream {
+  if (src.length >= 2 && src[0] === 0x1f && src[1] === 0x8b) return new GzipStream(src);
+  if (src.length >= 4) {
+    var m = (src[0] | (src[1] << 8) | (src[2] << 16) | (src[3] << 24)) >>> 0;
+    if (m === LZ4_FRAME_MAGIC) return new Lz4Stream(src, false);
+    if (m === LZ4_LEGACY_MAGIC) return new Lz4Stream(src, true);
+  }
+  return new StoredStream(src);
+}
+
+function u32le(b: Uint8Array, p: number): number {
+  return (b[p] | (b[p + 1] << 8) | (b[p + 2] << 16) | (b[p + 3] << 24)) >>> 0;
+}
+
+// ── Uncompressed ─────────────────────────────────────────────────────────────
+
+class StoredStream implements DecompressStream {
+  readonly format: StreamFormat = 'none';
+  readonly out: OutBuffer;
+  readonly done = true;
+
+  constructor(src: Uint8Array) {
+    this.out = new OutBuffer(0);
+    this.out.buf = src;
+    this.out.len = src.length;
+  }
+
+  pump(_budget: number): boolean { return false; }
+}
+
+// ── DEFLATE ──────────────────────────────────────────────────────────────────
+
+/** Output bytes between generator yields. */
+const INFLATE_SLICE = 16384;
+
+const LEN_BASE   = [3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258];
+const LEN_EXTRA  = [0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0];
+const DIST_BASE  = [1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                    8193, 12289, 16385, 24577];
+const DIST_EXTRA = [0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13];
+const CL_ORDER   = [16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15];
+
+/** Flat decode table: entry = symbol << 4 | code length (0 = invalid code). */
+interface Huff {
+  table: Int32Array;
+  bits:  number;
+  mask:  number;
+}
+
+function buildHuff(lens: Uint8Array, off: number, n: number): Huff {
+  var max = 0;
+  var count = new Int32Array(16);
+  for (var i = 0; i < n; i++) {
+    var l = lens[off + i];
+    count[l]++;
+    if (l > max) max = l;
+  }
+  var size = 1 << max;
+  var table = new Int32Array(size);
+  var next = new Int32Array(16);
+  var code = 0;
+  count[0] = 0;
+  for (var b = 1; b <= max; b++) {
+    code = (code + count[b - 1]) << 1;
+    next[b] = code;
+  }
+  for (var sym = 0; sym < n; sym++) {
+    var len = lens[off + sym];
+    if (!len) continue;
+    var c = next[len]++;
+    var rev = 0;
+    for (var k = 0; k < len; k++) { rev = (rev << 1) | (c & 1); c >>= 1; }
+    for (var j = rev; j < size; j += 1 << len) table[j] = (sym << 4) | len;
+  }
+  return { table: table, bits: max, mask: size - 1 };
+}
+
+var _fixedLit:  Huff | null = null;
+var _fixedDist: Huff | null = null;
+
+function fixedTables(): void {
+  if (_fixedLit) return;
+  var l = new Uint8Array(288);
+  for (var i = 0; i < 288; i++) l[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+  _fixedLit = buildHuff(l, 0, 288);
+  var d = new Uint8Array(30).fill(5);
+  _fixedDist = buildHuff(d, 0, 30);
+}
+
+/** LSB-first bit reader.  Up to 4 bytes past the end read as zero padding. */
+class BitIn {
+  private _src:  Uint8Array;
+  private _pos:  number;
+  private _bb    = 0;
+  private _cnt   = 0;
+  private _over  = 0;
+
+  constructor(src: Uint8Array, pos: number) {
+    this._src = src;
+    this._pos = pos;
+  }
+
+  private _need(n: number): void {
+    while (this._cnt < n) {
+      var b = 0;
+      if (this._pos < this._src.length) b = this._src[this._pos++];
+      else if (++this._over > 4) throw new Error('inflate: truncated input');
+      this._bb |= b << this._cnt;
+      this._cnt += 8;
+    }
+  }
+
+  bits(n: number): number {
+    if (n === 0) return 0;
+    this._need(n);
+    var v = this._bb & ((1 << n) - 1);
+    this._bb >>>= n;
+    this._cnt -= n;
+    return v;
+  }
+
+  decode(h: Huff): number {
+    this._need(h.bits);
+    var e = h.table[this._bb & h.mask];
+    var len = e & 15;
+    if (!len) throw new Error('inflate: bad Huffman code');
+    this._bb >>>= len;
+    this._cnt -= len;
+    return e >> 4;
+  }
+
+  /** Drop bits up to the next byte boundary. */
+  align(): void {
+    var d = this._cnt & 7;
+    this._bb >>>= d;
+    this._cnt -= d;
+  }
+
+  /** Offset of the next unread byte (call after align()). */
+  bytePos(): number { return this._pos + this._over - (this._cnt >> 3); }
+
+  /** Consume `n` whole bytes (after align()) as a view of the input. */
+  take(n: number): Uint8Array {
+    var p = this.bytePos();
+    if (p + n > this._src.length) throw new Error('inflate: truncated stored block');
+    this._bb = this._cnt = this._over = 0;
+    this._pos = p + n;
+    return this._src.subarray(p, p + n);
+  }
+}
+
+/** Inflate one raw DEFLATE stream into `out`, yielding every INFLATE_SLICE bytes. */
+function* inflateRaw(br: BitIn, out: OutBuffer): Generator<void, void, void> {
+  var nextYield = out.len + INFLATE_SLICE;
+  var lens = new Uint8Array(320);
+  for (;;) {
+    var final = br.bits(1);
+    var type  = br.bits(2);
+    if (type === 0) {
+      br.align();
+      var len  = br.bits(16);
+      var nlen = br.bits(16);
+      if ((len ^ nlen) !== 0xffff) throw new Error('inflate: bad stored block');
+      out.ensure(len).set(br.take(len), out.len);
+      out.len += len;
+    } else if (type === 1 || type === 2) {
+      var lit: Huff, dist: Huff;
+      if (type === 1) {
+        fixedTables();
+        lit = _fixedLit!;
+        dist = _fixedDist!;
+      } else {
+        var hlit  = br.bits(5) + 257;
+        var hdist = br.bits(5) + 1;
+        var hclen = br.bits(4) + 4;
+        var cl = new Uint8Array(19);
+        for (var i = 0; i < hclen; i++) cl[CL_ORDER[i]] = br.bits(3);
+        var clh = buildHuff(cl, 0, 19);
+        lens.fill(0);
+        var j = 0;
+        while (j < hlit + hdist) {
+          var s = br.decode(clh);
+          if (s < 16) { lens[j++] = s; continue; }
+          var rep = 0, val = 0;
+          if (s === 16) {
+            if (j === 0) throw new Error('inflate: repeat with no length');
+            val = lens[j - 1];
+            rep = 3 + br.bits(2);
+          } else if (s === 17) {
+            rep = 3 + br.bits(3);
+          } else {
+            rep = 11 + br.bits(7);
+          }
+          if (j + rep > hlit + hdist) throw new Error('inflate: bad code lengths');
+          while (rep-- > 0) lens[j++] = val;
+        }
+        lit  = buildHuff(lens, 0, hlit);
+        dist = buildHuff(lens, hlit, hdist);
+      }
+      for (;;) {
+        var sym = br.decode(lit);
+        if (sym < 256) {
+          out.ensure(1)[out.len++] = sym;
+        } else if (sym === 256) {
+          break;
+        } else {
+          sym -= 257;
+          if (sym >= 29) throw new Error('inflate: bad length symbol');
+          var n = LEN_BASE[sym] + br.bits(LEN_EXTRA[sym]);
+          var ds = br.decode(dist);
+          if (ds >= 30) throw new Error('inflate: bad distance symbol');
+          var d = DIST_BASE[ds] + br.bits(DIST_EXTRA[ds]);
+          if (d > out.len) throw new Error('inflate: distance too far back');
+          var buf = out.ensure(n);
+          var o = out.len, from = o - d;
+          if (d >= n) buf.copyWithin(o, from, from + n);
+          else for (var k = 0; k < n; k++) buf[o + k] = buf[from + k];
+          out.len = o + n;
+        }
+        if (out.len >= nextYield) {
+          yield;
+          nextYield = out.len + INFLATE_SLICE;
+        }
+      }
+    } else {
+      throw new Error('inflate: reserved block type');
+    }
+    if (final) return;
+  }
+}
+
+// ── gzip ─────────────────────────────────────────────────────────────────────
+
+class GzipStream implements DecompressStream {
+  readonly format: StreamFormat = 'gzip';
+  readonly out: OutBuffer;
+  done = false;
+  private _gen: Generator<void, void, void>;
+
+  constructor(src: Uint8Array) {
+    // ISIZE of the last member (mod 2^32) is the usual single-member total
+    var hint = src.length >= 4 ? u32le(src, src.length - 4) : 0;
+    if (hint < src.length || hint > src.length * 64) hint = src.length * 4;
+    this.out = new OutBuffer(hint);
+    this._gen = this._members(src);
+  }
+
+  private *_members(src: Uint8Array): Generator<void, void, void> {
+    var p = 0;
+    do {
+      if (p + 18 > src.length || src[p] !== 0x1f || src[p + 1] !== 0x8b || src[p + 2] !== 8) {
+        throw new Error('gzip: bad member header');
+      }
+      var flg = src[p + 3];
+      var q = p + 10;
+      if (flg & 0x04) q += 2 + (src[q] | (src[q + 1] << 8));      // FEXTRA
+      if (flg & 0x08) { while (q < src.length && src[q]) q++; q++; } // FNAME
+      if (flg & 0x10) { while (q < src.length && src[q]) q++; q++; } // FCOMMENT
+      if (flg & 0x02) q += 2;                                        // FHCRC
+      var start = this.out.len, summed = start, crc = 0xffffffff;
+      var br = new BitIn(src, q);
+      var inf = inflateRaw(br, this.out);
+      for (;;) {
+        var r = inf.next();
+        // checksum each slice while it is still in cache
+        crc = crc32(crc, this.out.buf, summed, this.out.len - summed);
+        summed = this.out.len;
+        if (r.done) break;
+        yield;
+      }
+      br.align();
+      var tail = br.take(8);                                         // CRC32, ISIZE
+      if (u32le(tail, 4) !== ((this.out.len - start) >>> 0)) throw new Error('gzip: length mismatch');
+      if (u32le(tail, 0) !== (~crc >>> 0)) throw new Error('gzip: CRC mismatch');
+      p = br.bytePos();
+      while (p < src.length && src[p] === 0) p++;                    // padding
+    } while (p < src.length);
+  }
+
+  pump(budget: number): boolean {
+    if (this.done) return false;
+    var target = this.out.len + budget;
+    while (this.out.len < target) {
+      if (this._gen.next().done) { this.done = true; return false; }
+    }
+    return true;
+  }
+}
+
+// ── LZ4 ──────────────────────────────────────────────────────────────────────
+
+const LZ4_FRAME_MAGIC  = 0x184D2204;
+const LZ4_LEGACY_MAGIC = 0x184C2102;
+const LZ4_LEGACY_BLOCK = 8 << 20;
+
+/**
+ * Decode one LZ4 block `src[s … e)` into `dst` at `d`, never writing at or
+ * past `dEnd`.  Matches may reach back into earlier output in `dst` (linked
+ * blocks).  Returns the new output position, or -1 on corrupt input.
+ */
+export function lz4DecodeBlock(src: Uint8Array, s: number, e: number,
+                               dst: Uint8Array, d: number, dEnd: number): number {
+  while (s < e) {
+    var token = src[s++];
+    var lit = token >> 4;
+    if (lit === 15) {
+      var b: number;
+      do {
+        if (s >= e) return -1;
+        b = src[s++];
+        lit += b;
+      } while (b === 255);
+    }
+    if (s + lit > e || d + lit > dEnd) return -1;
+    if (lit < 16) for (var i = 0; i < lit; i++) dst[d + i] = src[s + i];
+    else dst.set(src.subarray(s, s + lit), d);
+    s += lit;
+    d += lit;
+    if (s >= e) break;                       // last sequence: literals only
+    if (s + 2 > e) return -1;
+    var off = src[s] | (src[s + 1] << 8);
+    s += 2;
+    if (off === 0 || off > d) return -1;
+    var ml = (token & 15) + 4;
+    if ((token & 15) === 15) {
+      var mb: number;
+      do {
+        if (s >= e) return -1;
+        mb = src[s++];
+        ml += mb;
+      } while (mb === 255);
+    }
+    if (d + ml > dEnd) return -1;
+    var m = d - off;
+    if (off >= ml) dst.copyWithin(d, m, m + ml);
+    else for (var k = 0; k < ml; k++) dst[d + k] = dst[m + k];
+    d += ml;
+  }
+  return d;
+}
+
+class Lz4Stream implements DecompressStream {
+  readonly format: StreamFormat;
+  readonly out: OutBuffer;
+  done = false;
+  private _src: Uint8Array;
+  private _p = 0;
+  /** Inside a frame: its max block size, block/content checksum flags. */
+  private _inFrame  = false;
+  private _blockMax = 0;
+  private _bsum     = false;
+  private _csum     = false;
+  /** Blocks do not reference earlier ones: the native decoder can take them. */
+  private _indep    = false;
+
+  constructor(src: Uint8Array, legacy: boolean) {
+    this._src = src;
+    this.format = legacy ? 'lz4-legacy' : 'lz4';
+    var hint = src.length * 3;
+    if (!legacy && src.length >= 15 && (src[4] & 0x08)) {
+      // Content size field follows FLG/BD (only the low 32 bits matter here)
+      var cs = u32le(src, 6);
+      if (cs >= src.length && u32le(src, 10) === 0) hint = cs;
+    }
+    this.out = new OutBuffer(hint);
+  }
+
+  pump(budget: number): boolean {
+    if (this.done) return false;
+    var src = this._src;
+    var target = this.out.len + budget;
+    while (this.out.len < target) {
+      if (!this._inFrame) {
+        while (this._p < src.length && src[this._p] === 0) this._p++;   // padding
+        if (this._p + 4 > src.length) { this.done = true; return false; }
+        this._frameHeader();
+        continue;
+      }
+      if (this._p + 4 > src.length) {
+        if (this.format === 'lz4-legacy') { this.done = true; return false; }
+        throw new Error('lz4: truncated frame');
+      }
+      var word = u32le(src, this._p);
+      if (this.format === 'lz4-legacy' && word === LZ4_LEGACY_MAGIC) {
+        this._p += 4;                          // next concatenated stream
+        continue;
+      }
+      this._p += 4;
+      if (this.format === 'lz4' && word === 0) {  // EndMark
+        if (this._csum) this._p += 4;
+        this._inFrame = false;
+        continue;
+      }
+      var raw = this.format === 'lz4' && (word & 0x80000000) !== 0;
+      var n = word & 0x7fffffff;
+      if (this._p + n > src.length) throw new Error('lz4: truncated block');
+      var buf = this.out.ensure(raw ? n : this._blockMax);
+      if (raw) {
+        buf.set(src.subarray(this._p, this._p + n), this.out.len);
+        this.out.len += n;
+      } else {
+        var d: number;
+        if (this._indep && typeof kernel !== 'undefined' && kernel.lz4Decompress) {
+          d = kernel.lz4Decompress(src.subarray(this._p, this._p + n),
+                                   buf.subarray(this.out.len, this.out.len + this._blockMax));
+          if (d >= 0) d += this.out.len;
+        } else {
+          d = lz4DecodeBlock(src, this._p, this._p + n, buf, this.out.len, this.out.len + this._blockMax);
+        }
+        if (d < 0) throw new Error('lz4: corrupt block');
+        this.out.len = d;
+      }
+      this._p += n + (this._bsum ? 4 : 0);
+    }
+    return true;
+  }
+
+  private _frameHeader(): void {
+    var src = this._src;
+    var magic = u32le(src, this._p);
+    if (this.format === 'lz4-legacy') {
+      if (magic !== LZ4_LEGACY_MAGIC) throw new Error('lz4: bad legacy magic');
+      this._p += 4;
+      this._blockMax = LZ4_LEGACY_BLOCK;
+      this._indep = true;
+      this._inFrame = true;
+      return;
+    }
+    if ((magic & 0xfffffff0) === 0x184D2A50) {          // skippable frame
+      this._p += 8 + u32le(src, this._p + 4);
+      return;
+    }
+    if (magic !== LZ4_FRAME_MAGIC) throw new Error('lz4: bad frame magic');
+    var flg = src[this._p + 4], bd = src[this._p + 5];
+    if ((flg >> 6) !== 1) throw new Error('lz4: unsupported frame version');
+    if (flg & 0x01) throw new Error('lz4: dictionaries not supported');
+    var bsid = (bd >> 4) & 7;
+    if (bsid < 4) throw new Error('lz4: bad block size');
+    this._blockMax = 1 << (8 + 2 * bsid);                  // 64 KB … 4 MB
+    this._bsum = (flg & 0x10) !== 0;
+    this._csum = (flg & 0x04) !== 0;
+    this._indep = (flg & 0x20) !== 0;
+    this._p += 6 + ((flg & 0x08) ? 8 : 0) + 1;             // + content size, HC
+    this._inFrame = true;
+  }
+}
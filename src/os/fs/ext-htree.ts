@@ -0,0 +1,288 @@
+/**
+ * JSOS ext2/3/4 hashed directories — htree / dir_index
+ *
+ * An indexed directory keeps its entries in ordinary leaf blocks, plus an
+ * index that maps the hash of a name to the leaf holding it:
+ *
+ *   block 0   dx_root — "." and ".." entries (".." spans the block, so a
+ *             linear reader sees nothing else), dx_root_info, then the
+ *             count/limit header and sorted {hash, block} entries.
+ *   dx_node   one empty dirent spanning the block, then count/limit and
+ *             entries — used when indirect_levels > 0.
+ *
+ * Entry 0's hash is implicit (0); an entry covers hashes from its own up to
+ * the next entry's.  A leaf start hash with bit 0 set means the previous
+ * leaf ends with the same hash (a collision run continues).  Block numbers
+ * are logical blocks of the directory.
+ *
+ * This module holds the name hashes (legacy, half-MD4, TEA, each signed or
+ * unsigned), dx block parsing / searching, and a small LRU of parsed index
+ * nodes shared by the ext2 and ext4 drivers.
+ */
+
+export const DX_HASH_LEGACY             = 0;
+export const DX_HASH_HALF_MD4           = 1;
+export const DX_HASH_TEA                = 2;
+export const DX_HASH_LEGACY_UNSIGNED    = 3;
+export const DX_HASH_HALF_MD4_UNSIGNED  = 4;
+export const DX_HASH_TEA_UNSIGNED       = 5;
+
+/** s_flags: which char signedness the hashes of this filesystem assume. */
+export const EXT2_FLAGS_SIGNED_HASH     = 0x0001;
+export const EXT2_FLAGS_UNSIGNED_HASH   = 0x0002;
+
+export const EXT2_FEATURE_COMPAT_DIR_INDEX = 0x0020;
+export const EXT2_INDEX_FL                 = 0x00001000;
+export const EXT4_FEATURE_INCOMPAT_LARGEDIR = 0x4000;
+
+/** Offset of dx_root_info in block 0 (after "." and ".."). */
+export const DX_ROOT_INFO = 0x18;
+/** Size of the metadata_csum tail after the last possible entry. */
+export const DX_TAIL_SIZE = 8;
+
+/** Hash seed / version of a filesystem, from its superblock. */
+export interface DxHashInfo {
+  seed:    Uint32Array;      // s_hash_seed (all zero = use the MD4 IV)
+  defVer:  number;           // s_def_hash_version
+  flags:   number;           // s_flags
+}
+
+/** Read s_hash_seed, s_def_hash_version and s_flags from a raw superblock. */
+export function dxHashInfo(sb: Uint8Array): DxHashInfo {
+  var seed = new Uint32Array(4);
+  for (var i = 0; i < 4; i++) seed[i] = rd32(sb, 0xec + i * 4);
+  return { seed: seed, defVer: sb[0xfc], flags: sb.length >= 0x164 ? rd32(sb, 0x160) : 0 };
+}
+
+/** Hash version to use for a dx_root's hash_version byte. */
+export function dxEffectiveVersion(info: DxHashInfo, rootVer: number): number {
+  if (rootVer <= DX_HASH_TEA && (info.flags & EXT2_FLAGS_UNSIGNED_HASH)) return rootVer + 3;
+  return rootVer;
+}
+
+function rd16(b: Uint8Array, o: number): number { return b[o] | (b[o + 1] << 8); }
+function rd32(b: Uint8Array, o: number): number { return (b[o] | (b[o + 1] << 8) | (b[o + 2] << 16) | (b[o + 3] << 24)) >>> 0; }
+function wr16(b: Uint8Array, o: number, v: number): void { b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; }
+function wr32(b: Uint8Array, o: number, v: number): void {
+  b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; b[o + 2] = (v >>> 16) & 0xff; b[o + 3] = (v >>> 24) & 0xff;
+}
+
+// ── Hashes (fs/ext4/hash.c) ───────────────────────────────────────────────────
+
+function rol(x: number, s: number): number { return ((x << s) | (x >>> (32 - s))) >>> 0; }
+
+function halfMd4(buf: Uint32Array, inp: Uint32Array): void {
+  var a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+  var F = (x: number, y: number, z: number) => z ^ (x & (y ^ z));
+  var G = (x: number, y: number, z: number) => ((x & y) + ((x ^ y) & z)) >>> 0;
+  var H = (x: number, y: number, z: number) => x ^ y ^ z;
+  var K2 = 0x5A827999, K3 = 0x6ED9EBA1;
+  a = rol((a + F(b, c, d) + inp[0]) >>> 0, 3);
+  d = rol((d + F(a, b, c) + inp[1]) >>> 0, 7);
+  c = rol((c + F(d, a, b) + inp[2]) >>> 0, 11);
+  b = rol((b + F(c, d, a) + inp[3]) >>> 0, 19);
+  a = rol((a + F(b, c, d) + inp[4]) >>> 0, 3);
+  d = rol((d + F(a, b, c) + inp[5]) >>> 0, 7);
+  c = rol((c + F(d, a, b) + inp[6]) >>> 0, 11);
+  b = rol((b + F(c, d, a) + inp[7]) >>> 0, 19);
+  a = rol((a + G(b, c, d) + inp[1] + K2) >>> 0, 3);
+  d = rol((d + G(a, b, c) + inp[3] + K2) >>> 0, 5);
+  c = rol((c + G(d, a, b) + inp[5] + K2) >>> 0, 9);
+  b = rol((b + G(c, d, a) + inp[7] + K2) >>> 0, 13);
+  a = rol((a + G(b, c, d) + inp[0] + K2) >>> 0, 3);
+  d = rol((d + G(a, b, c) + inp[2] + K2) >>> 0, 5);
+  c = rol((c + G(d, a, b) + inp[4] + K2) >>> 0, 9);
+  b = rol((b + G(c, d, a) + inp[6] + K2) >>> 0, 13);
+  a = rol((a + H(b, c, d) + inp[3] + K3) >>> 0, 3);
+  d = rol((d + H(a, b, c) + inp[7] + K3) >>> 0, 9);
+  c = rol((c + H(d, a, b) + inp[2] + K3) >>> 0, 11);
+  b = rol((b + H(c, d, a) + inp[6] + K3) >>> 0, 15);
+  a = rol((a + H(b, c, d) + inp[1] + K3) >>> 0, 3);
+  d = rol((d + H(a, b, c) + inp[5] + K3) >>> 0, 9);
+  c = rol((c + H(d, a, b) + inp[0] + K3) >>> 0, 11);
+  b = rol((b + H(c, d, a) + inp[4] + K3) >>> 0, 15);
+  buf[0] += a; buf[1] += b; buf[2] += c; buf[3] += d;
+}
+
+function tea(buf: Uint32Array, inp: Uint32Array): void {
+  var sum = 0, b0 = buf[0], b1 = buf[1];
+  var a = inp[0], b = inp[1], c = inp[2], d = inp[3];
+  for (var n = 0; n < 16; n++) {
+    sum = (sum + 0x9E3779B9) >>> 0;
+    b0 = (b0 + ((((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >>> 5) + b)) >>> 0)) >>> 0;
+    b1 = (b1 + ((((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >>> 5) + d)) >>> 0)) >>> 0;
+  }
+  buf[0] += b0;
+  buf[1] += b1;
+}
+
+/** Pack up to num*4 name bytes into `out` the way str2hashbuf does. */
+function str2hashbuf(name: Uint8Array, off: number, len: number, out: Uint32Array, num: number, unsigned: boolean): void {
+  var pad = (len | (len << 8)) >>> 0;
+  pad = (pad | (pad << 16)) >>> 0;
+  var val = pad, o = 0;
+  if (len > num * 4) len = num * 4;
+  for (var i = 0; i < len; i++) {
+    var c = name[off + i];
+    if (!unsigned && c >= 0x80) c -= 0x100;
+    val = (c + (val << 8)) >>> 0;
+    if ((i & 3) === 3) { out[o++] = val; val = pad; num--; }
+  }
+  if (--num >= 0) out[o++] = val;
+  while (--num >= 0) out[o++] = pad;
+}
+
+function legacyHash(name: Uint8Array, off: number, len: number, unsigned: boolean): number {
+  var h0 = 0x12a3fe2d, h1 = 0x37abe8f9;
+  for (var i = 0; i < len; i++) {
+    var c = name[off + i];
+    if (!unsigned && c >= 0x80) c -= 0x100;
+    var h = (h1 + ((h0 ^ Math.imul(c, 7152373)) >>> 0)) >>> 0;
+    if (h & 0x80000000) h = (h - 0x7fffffff) >>> 0;
+    h1 = h0;
+    h0 = h;
+  }
+  return (h0 << 1) >>> 0;
+}
+
+/**
+ * Major hash of `len` bytes of `name` for hash `version` (already adjusted
+ * for signedness).  Bit 0 is always clear (it is the collision flag).
+ */
+export function dxHash(name: Uint8Array, off: number, len: number, version: number, seed: Uint32Array): number {
+  var buf = new Uint32Array([0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476]);
+  if (seed[0] | seed[1] | seed[2] | seed[3]) buf.set(seed);
+  var inp = new Uint32Array(8);
+  var hash: number;
+  switch (version) {
+    case DX_HASH_LEGACY:
+    case DX_HASH_LEGACY_UNSIGNED:
+      hash = legacyHash(name, off, len, version === DX_HASH_LEGACY_UNSIGNED);
+      break;
+    case DX_HASH_HALF_MD4:
+    case DX_HASH_HALF_MD4_UNSIGNED:
+      for (var p = 0; p < len; p += 32) {
+        str2hashbuf(name, off + p, len - p, inp, 8, version === DX_HASH_HALF_MD4_UNSIGNED);
+        halfMd4(buf, inp);
+      }
+      hash = buf[1];
+      break;
+    case DX_HASH_TEA:
+    case DX_HASH_TEA_UNSIGNED:
+      for (var q = 0; q < len; q += 16) {
+        str2hashbuf(name, off + q, len - q, inp, 4, version === DX_HASH_TEA_UNSIGNED);
+        tea(buf, inp);
+      }
+      hash = buf[0];
+      break;
+    default:
+      return -1;
+  }
+  hash = (hash & ~1) >>> 0;
+  if (hash === 0xfffffffe) hash = 0xfffffffc;   // reserved for end-of-directory
+  return hash;
+}
+
+// ── dx blocks ─────────────────────────────────────────────────────────────────
+
+/** Parsed index block (root or node). */
+export interface DxNode {
+  countOff: number;        // byte offset of the count/limit header
+  limit:    number;
+  hashes:   Uint32Array;   // hashes[0] is implicitly 0
+  blocks:   Uint32Array;   // logical directory blocks
+}
+
+/** dx_root_info of block 0, or null when it is not a usable index. */
+export interface DxRootInfo {
+  hashVersion: number;
+  levels:      number;     // indirect_levels
+  infoLen:     number;
+}
+
+export function parseDxRootInfo(b: Uint8Array, maxLevels: number): DxRootInfo | null {
+  if (b.length < DX_ROOT_INFO + 16) return null;
+  if (rd32(b, DX_ROOT_INFO) !== 0) return null;                 // reserved_zero
+  var ver = b[DX_ROOT_INFO + 4], infoLen = b[DX_ROOT_INFO + 5], levels = b[DX_ROOT_INFO + 6];
+  if (ver > DX_HASH_TEA_UNSIGNED || infoLen !== 8 || levels >= maxLevels) return null;
+  return { hashVersion: ver, levels: levels, infoLen: infoLen };
+}
+
+/** Parse count/limit and entries at `countOff`. */
+export function parseDxNode(b: Uint8Array, countOff: number): DxNode | null {
+  var limit = rd16(b, countOff), count = rd16(b, countOff + 2);
+  if (count === 0 || count > limit || countOff + limit * 8 > b.length) return null;
+  var hashes = new Uint32Array(count), blocks = new Uint32Array(count);
+  for (var i = 0; i < count; i++) {
+    hashes[i] = i ? rd32(b, countOff + i * 8) : 0;
+    blocks[i] = rd32(b, countOff + i * 8 + 4) & 0x0fffffff;
+  }
+  return { countOff: countOff, limit: limit, hashes: hashes, blocks: blocks };
+}
+
+/** Index of the entry whose range holds `hash` (last entry with hashes[i] ≤ hash). */
+export function dxSearch(node: DxNode, hash: number): number {
+  var lo = 1, hi = node.hashes.length - 1;
+  while (lo <= hi) {
+    var m = (lo + hi) >> 1;
+    if (node.hashes[m] > hash) hi = m - 1; else lo = m + 1;
+  }
+  return lo - 1;
+}
+
+/** Entry limit of the root / a node block (one slot fewer room with a csum tail). */
+export function dxRootLimit(bs: number, csum: boolean): number { return ((bs - DX_ROOT_INFO - 8 - (csum ? DX_TAIL_SIZE : 0)) / 8) | 0; }
+export function dxNodeLimit(bs: number, csum: boolean): number { return ((bs - 8 - (csum ? DX_TAIL_SIZE : 0)) / 8) | 0; }
+
+/** Insert {hash, block} at entry `at` of the raw index block (caller checked room). */
+export function dxInsertEntry(b: Uint8Array, countOff: number, at: number, hash: number, block: number): void {
+  var count = rd16(b, countOff + 2);
+  var e = countOff + at * 8;
+  b.copyWithin(e + 8, e, countOff + count * 8);
+  wr32(b, e, hash);
+  wr32(b, e + 4, block);
+  wr16(b, countOff + 2, count + 1);
+}
+
+/** Write an empty count/limit header with entry 0 → `block0`. */
+export function dxInitEntries(b: Uint8Array, countOff: number, limit: number, block0: number): void {
+  wr16(b, countOff, limit);
+  wr16(b, countOff + 2, 1);
+  wr32(b, countOff + 4, block0);
+}
+
+// ── Node cache ────────────────────────────────────────────────────────────────
+
+/**
+ * LRU of parsed index blocks keyed by physical block, so a lookup in a hot
+ * directory costs one leaf block read.  Drivers drop an entry whenever they
+ * modify or free the block.
+ */
+export class DxNodeCache {
+  private _m = new Map<number, DxNode>();
+  private _cap: number;
+  readonly stats = { hits: 0, misses: 0 };
+
+  constructor(capacity: number = 128) { this._cap = capacity; }
+
+  get(blk: number, load: () => DxNode | null): DxNode | null {
+    var n = this._m.get(blk);
+    if (n) {
+      this._m.delete(blk);
+      this._m.set(blk, n);
+      this.stats.hits++;
+      return n;
+    }
+    this.stats.misses++;
+    n = load() || undefined;
+    if (!n) return null;
+    this._m.set(blk, n);
+    if (this._m.size > this._cap) this._m.delete(this._m.keys().next().value as number);
+    return n;
+  }
+
+  invalidate(blk?: number): void {
+    if (blk === undefined) this._m.clear();
+    else this._m.delete(blk);
+  }
+}
@@ -10,6 +10,7 @@
  *  - Inode table lookup
  *  - File data read via direct, single-indirect, double-indirect blocks
  *  - Directory entry iteration (linear scan)
+ *  - Hashed (htree / dir_index) directory lookups via ext-htree.ts
  *  - Path resolution
  *
  * VFSMount interface implemented so it can be mounted with:
@@ -21,6 +22,11 @@
  */
 
 import type { VFSMount, FileType } from './filesystem.js';
+import { utf8Encode } from '../core/ringbuf.js';
+import {
+  type DxHashInfo, type DxNode, DxNodeCache, dxHashInfo, dxEffectiveVersion, dxHash, parseDxRootInfo, parseDxNode,
+  dxSearch, DX_ROOT_INFO, EXT2_FEATURE_COMPAT_DIR_INDEX, EXT2_INDEX_FL,
+} from './ext-htree.js';
 
 // ── Constants ─────────────────────────────────────────────────────────────────
 
@@ -76,6 +82,7 @@ interface Ext2Superblock {
   inodeSize:        number;   // s_inode_size (128 for ext2)
   firstIno:         number;   // s_first_ino
   revLevel:         number;   // s_rev_level (0=orig, 1=dynamic)
+  featuresCompat:   number;   // s_feature_compat
 }
 
 function parseSuperblock(data: Uint8Array): Ext2Superblock | null {
@@ -97,6 +104,7 @@ function parseSuperblock(data: Uint8Array): Ext2Superblock | null {
     inodeSize:      revLevel >= 1 ? u16(dv, 88) : 128,
     firstIno:       revLevel >= 1 ? u32(dv, 84) : 11,
     revLevel,
+    featuresCompat: revLevel >= 1 ? u32(dv, 92) : 0,
   };
 }
 
@@ -133,6 +141,7 @@ interface Ext2Inode {
   uid:      number;   // i_uid
   gid:      number;   // i_gid
   linksCount: number; // i_links_count
+  flags:    number;   // i_flags (EXT2_INDEX_FL for hashed directories)
 }
 
 /** Parse a 128-byte ext2 inode from `data` at `offset`. */
@@ -148,6 +157,7 @@ function parseInode(data: Uint8Array, offset: number): Ext2Inode {
     size:       u32(dv, offset + 4),
     gid:        u16(dv, offset + 26),
     linksCount: u16(dv, offset + 26 + 2),
+    flags:      u32(dv, offset + 32),
     blocks:     blks,
   };
 }
@@ -186,6 +196,9 @@ export class Ext2FS implements VFSMount {
   private _sb:     Ext2Superblock | null = null;
   private _bgdLen: number = 0;
   private _ready:  boolean = false;
+  private _dx:     DxHashInfo | null = null;
+  /** Parsed htree index blocks (the driver is read-only, so never stale). */
+  private _dxCache = new DxNodeCache();
 
   constructor(dev: Ext2BlockDevice) {
     this._dev = dev;
@@ -198,6 +211,7 @@ export class Ext2FS implements VFSMount {
       var sbData = this._readBytes(SUPERBLOCK_OFFSET, SUPERBLOCK_SIZE);
       this._sb   = parseSuperblock(sbData);
       if (!this._sb) return;
+      this._dx = dxHashInfo(sbData);
 
       // Number of block groups
       var groupCount = Math.ceil(this._sb.blocksCount / this._sb.blocksPerGroup);
@@ -314,6 +328,30 @@ export class Ext2FS implements VFSMount {
     return result;
   }
 
+  /** Physical block of logical block `lblk` of a file (0 = hole). */
+  private _bmap(inode: Ext2Inode, lblk: number): number {
+    if (!this._sb) return 0;
+    var ptrs = this._sb.blockSize / 4;
+    if (lblk < EXT2_NDIR_BLOCKS) return inode.blocks[lblk];
+    lblk -= EXT2_NDIR_BLOCKS;
+    var level = 1, span = 1;
+    while (lblk >= span * ptrs) {
+      lblk -= span * ptrs;
+      span *= ptrs;
+      if (++level > 3) return 0;
+    }
+    var blk = inode.blocks[EXT2_NDIR_BLOCKS + level - 1];
+    while (blk && span >= 1) {
+      var data = this._readBlock(blk);
+      var dv   = new DataView(data.buffer, data.byteOffset, data.byteLength);
+      blk  = u32(dv, Math.floor(lblk / span) * 4);
+      lblk = lblk % span;
+      if (span === 1) break;
+      span /= ptrs;
+    }
+    return blk;
+  }
+
   // ── Directory iteration ───────────────────────────────────────────────────
 
   /** Read all directory entries for the given directory inode. */
@@ -332,6 +370,66 @@ export class Ext2FS implements VFSMount {
     return entries;
   }
 
+  /**
+   * Look `name` up through the htree index of `dir`: descend
+   * dx_root / dx_node blocks by the name's hash, then scan one leaf (plus
+   * any leaves continuing a hash collision run).  Returns the inode number,
+   * 0 when absent, or -1 when the index is unusable (caller scans linearly).
+   */
+  private _dxLookup(dir: Ext2Inode, name: string): number {
+    if (!this._sb || !this._dx) return -1;
+    var bs = this._sb.blockSize;
+    var rootBlk = this._bmap(dir, 0);
+    if (!rootBlk) return -1;
+    var root = this._readBlock(rootBlk);
+    var info = parseDxRootInfo(root, 2);
+    if (!info) return -1;
+    var want = utf8Encode(name);
+    var hash = dxHash(want, 0, want.length, dxEffectiveVersion(this._dx, info.hashVersion), this._dx.seed);
+    if (hash < 0) return -1;
+    var frames: Array<{ node: DxNode; at: number }> = [];
+    var node = this._dxCache.get(rootBlk, () => parseDxNode(root, DX_ROOT_INFO + info!.infoLen));
+    while (node) {
+      var at = dxSearch(node, hash);
+      frames.push({ node: node, at: at });
+      if (frames.length > info.levels) break;
+      var child = this._bmap(dir, node.blocks[at]);
+      node = child ? this._dxCache.get(child, () => parseDxNode(this._readBlock(child), 8)) : null;
+    }
+    if (!node) return -1;
+    for (;;) {
+      var f = frames[frames.length - 1];
+      var leaf = this._bmap(dir, f.node.blocks[f.at]);
+      if (!leaf) return -1;
+      var data = this._readBlock(leaf);
+      for (var off = 0; off + 8 <= bs; ) {
+        var recLen  = data[off + 4] | (data[off + 5] << 8);
+        if (recLen < 8 || off + recLen > bs) break;
+        var ino     = (data[off] | (data[off + 1] << 8) | (data[off + 2] << 16) | (data[off + 3] << 24)) >>> 0;
+        var nameLen = data[off + 6];
+        if (ino && nameLen === want.length) {
+          var i = 0;
+          while (i < nameLen && data[off + 8 + i] === want[i]) i++;
+          if (i === nameLen) return ino;
+        }
+        off += recLen;
+      }
+      // Next leaf only while the collision run of this hash continues
+      var p = frames.length - 1;
+      while (p >= 0 && frames[p].at + 1 >= frames[p].node.hashes.length) p--;
+      if (p < 0) return 0;
+      var next = frames[p].node.hashes[frames[p].at + 1];
+      if (!(next & 1) || ((next & ~1) >>> 0) !== hash) return 0;
+      frames[p].at++;
+      for (var q = p + 1; q < frames.length; q++) {
+        var cb = this._bmap(dir, frames[q - 1].node.blocks[frames[q - 1].at]);
+        var cn = cb ? this._dxCache.get(cb, () => parseDxNode(this._readBlock(cb), 8)) : null;
+        if (!cn) return -1;
+        frames[q] = { node: cn, at: 0 };
+      }
+    }
+  }
+
   // ── Path resolution ───────────────────────────────────────────────────────
 
   private _splitPath(path: string): string[] {
@@ -346,10 +444,14 @@ export class Ext2FS implements VFSMount {
       var inode = this._readInode(EXT2_ROOT_INO);
       for (var pi = 0; pi < parts.length; pi++) {
         var part    = parts[pi];
-        var entries = this._readDir(inode);
-        var found   = entries.find(e => e.name === part);
-        if (!found) return null;
-        inode = this._readInode(found.ino);
+        var childIno = (inode.flags & EXT2_INDEX_FL) && (this._sb!.featuresCompat & EXT2_FEATURE_COMPAT_DIR_INDEX)
+          ? this._dxLookup(inode, part) : -1;
+        if (childIno < 0) {
+          var found = this._readDir(inode).find(e => e.name === part);
+          childIno = found ? found.ino : 0;
+        }
+        if (!childIno) return null;
+        inode = this._readInode(childIno);
         // Follow symlink (simple inline symlink via direct blocks)
         if ((inode.mode & 0xF000) === EXT2_S_IFLNK && inode.size < this._sb!.blockSize * 12) {
           var linkTarget = new TextDecoder().decode(this._readFileData(inode));
@@ -0,0 +1,205 @@
+/**
+ * JSOS ext4 multi-block allocator
+ *
+ * Allocates runs of physically contiguous blocks from the per-group block
+ * bitmaps, in the spirit of Linux's mballoc:
+ *
+ *   1. Goal extent — when the caller names a goal (usually the block after
+ *      the file's last allocated block) and enough blocks are free there,
+ *      allocate at the goal so the file's extent simply grows.
+ *   2. Buddy search — each group keeps a buddy summary of its bitmap: for
+ *      every order o, a bitmap of free, 2^o-aligned chunks of 2^o blocks and
+ *      a count per order.  A request for n blocks takes the smallest order
+ *      ≥ ⌈log2 n⌉ that has a chunk (best fit), scanning groups from the goal
+ *      group on and skipping groups whose free count is too low.
+ *   3. Fallback — with no chunk that large anywhere, the largest chunk that
+ *      exists is used and the caller asks again for the rest.
+ *
+ * Whatever chunk is chosen, the allocation then extends over any free blocks
+ * that follow it, up to the requested length.  A group's buddy summary is
+ * rebuilt from its bitmap on the next search after the bitmap changes.
+ */
+
+/** Bitmap access supplied by the filesystem. */
+export interface MbGroupSource {
+  readonly groupCount:     number;
+  readonly blocksPerGroup: number;
+  readonly firstDataBlock: number;
+  readonly blocksCount:    number;
+  /** Live block bitmap of group `g` (bit set = in use). */
+  bitmap(g: number): Uint8Array;
+  /** Free blocks in group `g` according to its descriptor. */
+  freeCount(g: number): number;
+  /** Bits of group `g` changed; `freeDelta` < 0 for an allocation. */
+  changed(g: number, freeDelta: number): void;
+}
+
+export interface MbExtent {
+  start: number;      // first physical block
+  len:   number;
+}
+
+interface MbBuddy {
+  orders: Uint8Array[];     // orders[o] bit i: blocks [i << o, (i + 1) << o) free
+  counts: Int32Array;       // chunks per order
+}
+
+/** Goal runs shorter than this (and shorter than the request) are skipped. */
+const MB_GOAL_MIN = 8;
+
+function testBit(bm: Uint8Array, i: number): boolean { return (bm[i >> 3] & (1 << (i & 7))) !== 0; }
+
+export class MbAllocator {
+  private _src:      MbGroupSource;
+  private _buddy:    Array<MbBuddy | null>;
+  private _maxOrder: number;
+  /** Counters for `df`-style reporting and tests. */
+  readonly stats = { allocs: 0, goalHits: 0, buddyHits: 0, fallbacks: 0, frees: 0 };
+
+  constructor(src: MbGroupSource) {
+    this._src      = src;
+    this._buddy    = new Array(src.groupCount).fill(null);
+    this._maxOrder = Math.min(16, 31 - Math.clz32(src.blocksPerGroup));
+  }
+
+  /** Blocks in group `g` (the last group may be short). */
+  private _groupLen(g: number): number {
+    var s = this._src;
+    var base = s.firstDataBlock + g * s.blocksPerGroup;
+    return Math.max(0, Math.min(s.blocksPerGroup, s.blocksCount - base));
+  }
+
+  /** Forget the buddy summary of `g` (its bitmap was changed elsewhere). */
+  invalidate(g?: number): void {
+    if (g === undefined) this._buddy.fill(null);
+    else this._buddy[g] = null;
+  }
+
+  private _getBuddy(g: number): MbBuddy {
+    var b = this._buddy[g];
+    if (b) return b;
+    var n  = this._groupLen(g);
+    var bm = this._src.bitmap(g);
+    var orders: Uint8Array[] = [];
+    for (var o = 0; o <= this._maxOrder; o++) orders.push(new Uint8Array(((n >> o) + 8) >> 3));
+    var counts = new Int32Array(this._maxOrder + 1);
+    var i = 0;
+    while (i < n) {
+      if (bm[i >> 3] === 0xff && (i & 7) === 0) { i += 8; continue; }
+      if (testBit(bm, i)) { i++; continue; }
+      var e = i + 1;
+      while (e < n && !testBit(bm, e)) e++;
+      // Split the free extent [i, e) into maximal aligned power-of-two chunks
+      while (i < e) {
+        var ord = 0;
+        while (ord < this._maxOrder && (i & ((2 << ord) - 1)) === 0 && i + (2 << ord) <= e) ord++;
+        orders[ord][(i >> ord) >> 3] |= 1 << ((i >> ord) & 7);
+        counts[ord]++;
+        i += 1 << ord;
+      }
+    }
+    return this._buddy[g] = { orders: orders, counts: counts };
+  }
+
+  /** Free blocks at group-relative `i` onward, up to `max`. */
+  private _freeRun(bm: Uint8Array, n: number, i: number, max: number): number {
+    var len = 0;
+    while (len < max && i + len < n && !testBit(bm, i + len)) len++;
+    return len;
+  }
+
+  /**
+   * Allocate up to `count` contiguous blocks, preferably at `goal`
+   * (0 = no preference).  Returns the extent (len ≥ 1), or null when the
+   * filesystem is full.  A shorter extent than requested means no free run
+   * of that length was found; call again for the remainder.
+   */
+  alloc(goal: number, count: number): MbExtent | null {
+    var s = this._src;
+    if (count < 1 || s.groupCount === 0) return null;
+    this.stats.allocs++;
+    var bpg = s.blocksPerGroup;
+
+    // 1. Goal extent
+    var gg = 0;
+    if (goal >= s.firstDataBlock && goal < s.blocksCount) {
+      gg = Math.floor((goal - s.firstDataBlock) / bpg);
+      var gi = goal - s.firstDataBlock - gg * bpg;
+      var run = this._freeRun(s.bitmap(gg), this._groupLen(gg), gi, count);
+      if (run === count || run >= MB_GOAL_MIN) {
+        this.stats.goalHits++;
+        return this._take(gg, gi, run);
+      }
+    }
+
+    // 2. Best-fit buddy chunk, groups scanned from the goal group on
+    var k = 0;
+    while (k < this._maxOrder && (1 << k) < count) k++;
+    var need = 1 << k;
+    for (var step = 0; step < s.groupCount; step++) {
+      var g = (gg + step) % s.groupCount;
+      if (s.freeCount(g) < need) continue;
+      var b = this._getBuddy(g);
+      for (var o = k; o <= this._maxOrder; o++) {
+        if (b.counts[o] > 0) {
+          this.stats.buddyHits++;
+          return this._takeChunk(g, b, o, count);
+        }
+      }
+    }
+
+    // 3. Largest chunk that exists anywhere
+    for (var fo = k - 1; fo >= 0; fo--) {
+      for (var step2 = 0; step2 < s.groupCount; step2++) {
+        var g2 = (gg + step2) % s.groupCount;
+        if (s.freeCount(g2) < (1 << fo)) continue;
+        var b2 = this._getBuddy(g2);
+        if (b2.counts[fo] > 0) {
+          this.stats.fallbacks++;
+          return this._takeChunk(g2, b2, fo, count);
+        }
+      }
+    }
+    return null;
+  }
+
+  /** Allocate the first order-`o` chunk of group `g`, extended up to `count`. */
+  private _takeChunk(g: number, b: MbBuddy, o: number, count: number): MbExtent {
+    var bits = b.orders[o];
+    var idx = 0;
+    while (bits[idx >> 3] === 0) idx += 8;
+    while (!testBit(bits, idx)) idx++;
+    var start = idx << o;
+    var len = this._freeRun(this._src.bitmap(g), this._groupLen(g), start, count);
+    return this._take(g, start, len);
+  }
+
+  private _take(g: number, i: number, len: number): MbExtent {
+    var bm = this._src.bitmap(g);
+    for (var j = i; j < i + len; j++) bm[j >> 3] |= 1 << (j & 7);
+    this._buddy[g] = null;
+    this._src.changed(g, -len);
+    return { start: this._src.firstDataBlock + g * this._src.blocksPerGroup + i, len: len };
+  }
+
+  /** Return blocks [start, start + len) to their groups. */
+  free(start: number, len: number): void {
+    var s = this._src;
+    this.stats.frees++;
+    while (len > 0) {
+      var rel = start - s.firstDataBlock;
+      var g   = Math.floor(rel / s.blocksPerGroup);
+      var i   = rel - g * s.blocksPerGroup;
+      var n   = Math.min(len, s.blocksPerGroup - i);
+      var bm  = s.bitmap(g);
+      var freed = 0;
+      for (var j = i; j < i + n; j++) {
+        if (testBit(bm, j)) { bm[j >> 3] &= ~(1 << (j & 7)); freed++; }
+      }
+      this._buddy[g] = null;
+      s.changed(g, freed);
+      start += n;
+      len   -= n;
+    }
+  }
+}
@@ -4,20 +4,51 @@
  * Implements:
  *  - [Item 178] ext4 read-only: extent tree, large file support (>4 GB)
  *  - [Item 179] ext4 write: journaling (JBD2 metadata journal), metadata write
+ *  -  full write path: create / unlink / mkdir, extent insertion
+ *    and node splitting, multi-block allocation (ext4-mballoc.ts), delayed
+ *    allocation of file data, JBD2 on-disk log with group commit
+ *  -  hashed (htree) directories: indexed lookup, insertion with
+ *    leaf / index splits, conversion of full linear directories
  *
  * Backward-compatible with ext2/ext3 disk images.
  * All logic in TypeScript; C code provides raw block-device I/O only.
  *
  * Key ext4 features handled:
- *   - Extent tree (EXT4_EXTENTS_FL set in i_flags)
+ *   - Extent tree (EXT4_EXTENTS_FL set in i_flags), or ext2/3 direct +
+ *     single/double/triple indirect block maps
+ *   - Per-inode cache of decoded extent runs; contiguous runs are read with
+ *     one multi-block device request, plus sequential readahead
  *   - 64-bit file sizes (i_size_high)
- *   - Flexible block groups (FBC)
- *   - HTree (dir_index) — falls back to linear directory scan
+ *   - Flexible block groups (FBC), uninitialised block / inode groups
+ *   - HTree (dir_index) — lookups descend the index (ext-htree.ts) and
+ *     touch one leaf; a corrupt index falls back to a linear scan
  *   - dir_entry_type_2 (csum after name)
+ *   - metadata_csum / gdt_csum checksums on everything the driver writes
  *   - JBD2 metadata journal for writes
+ *
+ * Write path:
+ *   write  → page cache only (delayed allocation): nothing is allocated
+ *            until writeback, when each run of new logical blocks gets one
+ *            multi-block allocation, so a large file becomes a few large
+ *            extents written with sequential I/O.
+ *   meta   → every metadata block (inodes, bitmaps, descriptors, extent
+ *            and directory blocks, superblock) is modified in the running
+ *            JBD2 transaction, never on disk directly.
+ *   commit → batched: many operations share one transaction, committed when
+ *            it grows large or old, or on commitTransaction() / unmount().
+ *            File data is written before the commit (ordered mode); blocks
+ *            freed in a transaction are not reused until it commits.
  */
 
 import type { VFSMount, FileType } from './filesystem.js';
+import { MbAllocator } from './ext4-mballoc.js';
+import { crc32c, crc32cU32, crc16 } from './crc.js';
+import { utf8Encode, utf8Decode } from '../core/ringbuf.js';
+import {
+  type DxHashInfo, type DxNode, DxNodeCache, dxHashInfo, dxEffectiveVersion, dxHash, parseDxRootInfo,
+  parseDxNode, dxSearch, dxRootLimit, dxNodeLimit, dxInsertEntry, dxInitEntries,
+  DX_ROOT_INFO, DX_TAIL_SIZE, EXT2_FEATURE_COMPAT_DIR_INDEX, EXT4_FEATURE_INCOMPAT_LARGEDIR,
+} from './ext-htree.js';
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
@@ -27,6 +58,8 @@ const EXT4_MAGIC              = 0xef53;
 const SUPERBLOCK_OFFSET       = 1024;
 const SUPERBLOCK_SIZE         = 1024;
 const EXT4_EXTENTS_FL         = 0x00080000;   // i_flags: uses extent tree
+const EXT4_HUGE_FILE_FL       = 0x00040000;   // i_flags: i_blocks in fs blocks
+const EXT4_INDEX_FL           = 0x00001000;   // i_flags: htree directory
 const EXT4_FEATURE_INCOMPAT_EXTENTS = 0x0040;
 const EXT4_FEATURE_INCOMPAT_64BIT   = 0x0080;
 const EXT4_INLINE_DATA_FL    = 0x10000000;   // i_flags: data in inode
@@ -34,6 +67,35 @@ const EXT4_ROOT_INO           = 2;
 const EXT4_FT_REG             = 1;
 const EXT4_FT_DIR             = 2;
 const EXT4_FT_SYMLINK         = 7;
+const EXT4_NDIR_BLOCKS        = 12;           // i_block[0..11] direct, 12/13/14 indirect
+const EXT_INIT_MAX_LEN        = 32768;        // ee_len > this ⇒ uninitialized extent
+const MAP_CACHE_INODES        = 64;           // inodes whose run lists are cached
+const RA_MIN                  = 16 * 1024;    // first readahead window (bytes)
+const RA_MAX                  = 256 * 1024;   // readahead window cap
+
+// Feature bits the write path relies on or must refuse
+const EXT4_FEATURE_COMPAT_HAS_JOURNAL    = 0x0004;
+const EXT4_FEATURE_COMPAT_SPARSE_SUPER2  = 0x0200;
+const EXT4_FEATURE_INCOMPAT_FILETYPE     = 0x0002;
+const EXT4_FEATURE_INCOMPAT_RECOVER      = 0x0004;
+const EXT4_FEATURE_INCOMPAT_CSUM_SEED    = 0x2000;
+const EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER  = 0x0001;
+const EXT4_FEATURE_RO_COMPAT_HUGE_FILE     = 0x0008;
+const EXT4_FEATURE_RO_COMPAT_GDT_CSUM      = 0x0010;
+const EXT4_FEATURE_RO_COMPAT_METADATA_CSUM = 0x0400;
+/** FILETYPE EXTENTS 64BIT FLEX_BG EA_INODE CSUM_SEED LARGEDIR INLINE_DATA ENCRYPT */
+const EXT4_INCOMPAT_WRITABLE  = 0x0002 | 0x0040 | 0x0080 | 0x0200 | 0x0400 | 0x2000 | 0x4000 | 0x8000 | 0x10000;
+/** SPARSE_SUPER LARGE_FILE BTREE_DIR HUGE_FILE GDT_CSUM DIR_NLINK EXTRA_ISIZE METADATA_CSUM */
+const EXT4_RO_COMPAT_WRITABLE = 0x0001 | 0x0002 | 0x0004 | 0x0008 | 0x0010 | 0x0020 | 0x0040 | 0x0400;
+
+const EXT4_BG_INODE_UNINIT    = 0x0001;
+const EXT4_BG_BLOCK_UNINIT    = 0x0002;
+const EXT4_DIRENT_TAIL_FT     = 0xde;          // file_type of the checksum dirent
+
+const BCACHE_BLOCKS           = 256;           // clean metadata blocks kept in memory
+const DELALLOC_MAX_BYTES      = 8 * 1024 * 1024;   // dirty page budget before writeback
+const DELALLOC_EXPIRE_MS      = 30000;         // dirty pages older than this are written back
+const JBD2_COMMIT_INTERVAL_MS = 5000;          // oldest a running transaction may get
 
 // ── DataView helpers ──────────────────────────────────────────────────────────
 
@@ -44,6 +106,22 @@ function i32(dv: DataView, off: number): number { return dv.getInt32(off, true);
 function u64lo(dv: DataView, off: number): number { return dv.getUint32(off, true); }
 function u64hi(dv: DataView, off: number): number { return dv.getUint32(off + 4, true); }
 
+// Byte-array accessors for buffers that are patched in place
+function rd16(b: Uint8Array, o: number): number { return b[o] | (b[o + 1] << 8); }
+function rd32(b: Uint8Array, o: number): number { return (b[o] | (b[o + 1] << 8) | (b[o + 2] << 16) | (b[o + 3] << 24)) >>> 0; }
+function wr16(b: Uint8Array, o: number, v: number): void { b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; }
+function wr32(b: Uint8Array, o: number, v: number): void {
+  b[o] = v & 0xff; b[o + 1] = (v >>> 8) & 0xff; b[o + 2] = (v >>> 16) & 0xff; b[o + 3] = (v >>> 24) & 0xff;
+}
+// JBD2 is big-endian
+function be32(b: Uint8Array, o: number): number { return ((b[o] << 24) | (b[o + 1] << 16) | (b[o + 2] << 8) | b[o + 3]) >>> 0; }
+function wbe32(b: Uint8Array, o: number, v: number): void {
+  b[o] = (v >>> 24) & 0xff; b[o + 1] = (v >>> 16) & 0xff; b[o + 2] = (v >>> 8) & 0xff; b[o + 3] = v & 0xff;
+}
+function wbe16(b: Uint8Array, o: number, v: number): void { b[o] = (v >>> 8) & 0xff; b[o + 1] = v & 0xff; }
+
+function nowSec(): number { return Math.floor(Date.now() / 1000); }
+
 // ── Block device interface ────────────────────────────────────────────────────
 
 export interface Ext4BlockDevice {
@@ -51,6 +129,14 @@ export interface Ext4BlockDevice {
   readSector(byteOffset: number): Uint8Array;
   /** Write a single sector. Returns 0 on success, <0 on error. */
   writeSector(byteOffset: number, data: Uint8Array): number;
+  /**
+   * Optional multi-sector read: copy `length` bytes starting at `byteOffset`
+   * straight into `dst[dstOffset…]` with one device request.  Returns the
+   * byte count, or <0 on error.  Without it the driver loops readSector().
+   */
+  readInto?(byteOffset: number, dst: Uint8Array, dstOffset: number, length: number): number;
+  /** Optional multi-sector write, the counterpart of readInto(). */
+  writeFrom?(byteOffset: number, src: Uint8Array, srcOffset: number, length: number): number;
 }
 
 // ── Superblock ────────────────────────────────────────────────────────────────
@@ -59,11 +145,13 @@ interface Ext4Superblock {
   inodesCount:         number;
   blocksCountLo:       number;
   blocksCountHi:       number;   // valid if FEATURE_INCOMPAT_64BIT
+  blocksCount:         number;
   firstDataBlock:      number;   // s_first_data_block (0 for blocksize>1024, 1 for 1024)
   logBlockSize:        number;
   blockSize:           number;
   blocksPerGroup:      number;
   inodesPerGroup:      number;
+  groupCount:          number;
   magic:               number;
   inodeSize:           number;
   firstIno:            number;
@@ -73,6 +161,9 @@ interface Ext4Superblock {
   featuresRoCompat:    number;
   groupDescSize:       number;  // 32 for ext2/3, 64 for ext4 (FEATURE_64BIT)
   journalIno:          number;  // s_journal_inum
+  reservedGdtBlocks:   number;  // s_reserved_gdt_blocks
+  uuid:                Uint8Array;
+  checksumSeed:        number;  // s_checksum_seed (valid with INCOMPAT_CSUM_SEED)
 }
 
 function parseSuperblock(data: Uint8Array): Ext4Superblock | null {
@@ -89,16 +180,22 @@ function parseSuperblock(data: Uint8Array): Ext4Superblock | null {
   var firstIno     = revLevel >= 1 ? u32(dv, 84)  : 11;
   var gdSize       = (incompat & EXT4_FEATURE_INCOMPAT_64BIT) && data.length >= 264 ? u16(dv, 254) : 32;
   if (gdSize < 32) gdSize = 32;
-  var journalIno   = revLevel >= 1 && data.length >= 220 ? u32(dv, 204) : 0;
+  var journalIno   = revLevel >= 1 && data.length >= 0xe4 ? u32(dv, 0xe0) : 0;
+  var blocksHi     = revLevel >= 1 && (incompat & EXT4_FEATURE_INCOMPAT_64BIT) ? u32(dv, 0x150) : 0;
+  var blocksCount  = blocksHi * 0x100000000 + u32(dv, 4);
+  var firstData    = u32(dv, 20);
+  var bpg          = u32(dv, 32);
   return {
     inodesCount:      u32(dv, 0),
     blocksCountLo:    u32(dv, 4),
-    blocksCountHi:    revLevel >= 1 ? u32(dv, 160) : 0,
-    firstDataBlock:   u32(dv, 20),
+    blocksCountHi:    blocksHi,
+    blocksCount,
+    firstDataBlock:   firstData,
     logBlockSize,
     blockSize:        1024 << logBlockSize,
-    blocksPerGroup:   u32(dv, 32),
+    blocksPerGroup:   bpg,
     inodesPerGroup:   u32(dv, 40),
+    groupCount:       bpg ? Math.ceil((blocksCount - firstData) / bpg) : 0,
     magic,
     inodeSize,
     firstIno,
@@ -108,33 +205,37 @@ function parseSuperblock(data: Uint8Array): Ext4Superblock | null {
     featuresRoCompat: featsRoCom,
     groupDescSize:    gdSize,
     journalIno,
+    reservedGdtBlocks: u16(dv, 0xce),
+    uuid:             data.slice(0x68, 0x78),
+    checksumSeed:     data.length >= 0x274 ? u32(dv, 0x270) : 0,
   };
 }
 
 // ── Block Group Descriptor ────────────────────────────────────────────────────
 
+/** Parsed group descriptor; the counters are kept live in memory. */
 interface Ext4BGD {
-  blockBitmapLo:   number;
-  inodeBitmapLo:   number;
-  inodeTableLo:    number;
-  blockBitmapHi:   number;
-  inodeBitmapHi:   number;
-  inodeTableHi:    number;
+  blockBitmap:     number;
+  inodeBitmap:     number;
+  inodeTable:      number;
   freeBlocksCount: number;
   freeInodesCount: number;
+  usedDirsCount:   number;
+  flags:           number;
+  itableUnused:    number;
 }
 
 function parseBGD(dv: DataView, off: number, gdSize: number): Ext4BGD {
   var hi = gdSize >= 64;
   return {
-    blockBitmapLo:   u32(dv, off +  0),
-    inodeBitmapLo:   u32(dv, off +  4),
-    inodeTableLo:    u32(dv, off +  8),
-    freeBlocksCount: u16(dv, off + 12),
-    freeInodesCount: u16(dv, off + 14),
-    blockBitmapHi:   hi ? u32(dv, off + 32) : 0,
-    inodeBitmapHi:   hi ? u32(dv, off + 36) : 0,
-    inodeTableHi:    hi ? u32(dv, off + 40) : 0,
+    blockBitmap:     bgdPhysBlock(hi ? u32(dv, off + 32) : 0, u32(dv, off + 0)),
+    inodeBitmap:     bgdPhysBlock(hi ? u32(dv, off + 36) : 0, u32(dv, off + 4)),
+    inodeTable:      bgdPhysBlock(hi ? u32(dv, off + 40) : 0, u32(dv, off + 8)),
+    freeBlocksCount: u16(dv, off + 12) + (hi ? u16(dv, off + 0x2c) * 0x10000 : 0),
+    freeInodesCount: u16(dv, off + 14) + (hi ? u16(dv, off + 0x2e) * 0x10000 : 0),
+    usedDirsCount:   u16(dv, off + 16) + (hi ? u16(dv, off + 0x30) * 0x10000 : 0),
+    flags:           u16(dv, off + 18),
+    itableUnused:    u16(dv, off + 28) + (hi ? u16(dv, off + 0x32) * 0x10000 : 0),
   };
 }
 
@@ -151,6 +252,7 @@ interface Ext4Inode {
   flags:      number;   // i_flags (includes EXT4_EXTENTS_FL)
   iBlock:     Uint8Array;  // raw 60 bytes: i_block[15] — used as extent tree root
   linksCount: number;
+  generation: number;   // i_generation (part of the checksum seed)
 }
 
 function parseInode(data: Uint8Array, off: number, inodeSize: number): Ext4Inode {
@@ -166,9 +268,12 @@ function parseInode(data: Uint8Array, off: number, inodeSize: number): Ext4Inode
     flags:      u32(dv, off + 32),
     iBlock:     iblock,
     sizeHi:     i32(dv, off + 108) >>> 0,  // i_size_high (at inode+108)
+    generation: u32(dv, off + 100),
   };
 }
 
+function inodeSize64(inode: Ext4Inode): number { return inode.sizeHi * 0x100000000 + inode.sizeLo; }
+
 // ── Extent tree ────────────────────────────────────────────────────────────────
 
 /** ext4 Extent Header (12 bytes at the start of i_block or an extent block). */
@@ -197,6 +302,70 @@ interface ExtentIndex {
 
 const EXTENT_HEADER_MAGIC = 0xf30a;
 
+/**
+ * A decoded run of the block map: logical blocks [lblk, lblk + len) live at
+ * physical blocks [pblk, pblk + len).  pblk 0 = hole; an uninitialized
+ * extent keeps its blocks but reads as zeroes.
+ */
+interface ExtentRun {
+  lblk:   number;
+  len:    number;
+  pblk:   number;
+  uninit: boolean;
+}
+
+/** Cached per-inode mapping and sequential-read state. */
+interface InodeMap {
+  iBlock: Uint8Array;     // i_block the runs were decoded from (validity check)
+  runs:   ExtentRun[];    // sorted by lblk, non-overlapping, gaps are holes
+  next:   number;         // byte offset just past the previous read
+  raWin:  number;         // current readahead window (bytes)
+  raPos:  number;         // file offset of raBuf[0]
+  raBuf:  Uint8Array | null;
+}
+
+/** A node on a root-to-leaf extent tree path, patched in place. */
+interface ExtNode {
+  buf: Uint8Array;        // inode bytes (root) or the node's block
+  off: number;            // offset of the extent header in buf
+  blk: number;            // physical block (0 = root in the inode)
+  idx: number;            // entry followed towards the leaf
+}
+
+/** One level of an htree lookup path. */
+interface DxFrame {
+  blk:  number;           // physical block of the index block
+  node: DxNode;
+  at:   number;           // entry followed
+}
+
+/** Result of descending a directory's hash index. */
+interface DxPath {
+  hash:   number;
+  frames: DxFrame[];      // root first
+}
+
+/** Delayed-allocation state of a file with unwritten data. */
+interface DirtyFile {
+  size:  number;                    // file size including buffered writes
+  pages: Map<number, Uint8Array>;   // logical block → full block of data
+  since: number;                    // Date.now() of the oldest dirty page
+}
+
+export interface Ext4IOStats {
+  reads:      number;     // readInodeData() calls
+  devReads:   number;     // device requests issued for file data
+  devBytes:   number;     // bytes transferred by those requests
+  raHits:     number;     // reads served (partly) from the readahead buffer
+  mapHits:    number;     // block-map lookups served by the run cache
+  mapDecodes: number;     // block maps decoded from disk
+  writebacks: number;     // files written back from the page cache
+  dataWrites: number;     // device requests issued for file data writes
+  extents:    number;     // extents / block runs inserted into block maps
+  commits:    number;     // journal transactions committed
+  dxLookups:  number;     // directory lookups answered through an htree index
+}
+
 function parseExtentHeader(dv: DataView, off: number): ExtentHeader {
   return {
     magic:      u16(dv, off + 0),
@@ -224,28 +393,93 @@ function parseExtentIndex(dv: DataView, off: number): ExtentIndex {
   };
 }
 
+/** Physical start of the extent (or index child) entry at `e`. */
+function extStart(b: Uint8Array, e: number): number { return rd16(b, e + 6) * 0x100000000 + rd32(b, e + 8); }
+function setExtStart(b: Uint8Array, e: number, p: number): void {
+  wr16(b, e + 6, Math.floor(p / 0x100000000));
+  wr32(b, e + 8, p % 0x100000000);
+}
+function idxChild(b: Uint8Array, e: number): number { return rd16(b, e + 8) * 0x100000000 + rd32(b, e + 4); }
+
+/** Append a run, merging it into the previous one when both are contiguous. */
+function pushRun(runs: ExtentRun[], lblk: number, len: number, pblk: number, uninit: boolean = false): void {
+  var last = runs.length ? runs[runs.length - 1] : null;
+  if (last && last.lblk + last.len === lblk && last.uninit === uninit &&
+      ((last.pblk === 0 && pblk === 0) || (last.pblk !== 0 && pblk !== 0 && last.pblk + last.len === pblk))) {
+    last.len += len;
+    return;
+  }
+  runs.push({ lblk: lblk, len: len, pblk: pblk, uninit: uninit });
+}
+
+function sameBytes(a: Uint8Array, b: Uint8Array): boolean {
+  if (a.length !== b.length) return false;
+  for (var i = 0; i < a.length; i++) if (a[i] !== b[i]) return false;
+  return true;
+}
+
 // ── Ext4FS ────────────────────────────────────────────────────────────────────
 
 /**
- * [Items 178-179] ext4 filesystem driver: read-only + write with journaling.
+ * [Items 178-179] ext4 filesystem driver: read + write with journaling.
  *
  * Extends the ext2 on-disk format with:
  *   - Extent tree block mapping (replaces indirect blocks)
  *   - 64-bit file sizes (i_size_high)
- *   - JBD2 metadata write journal (lightweight: log before apply)
+ *   - JBD2 metadata write journal (log, commit, checkpoint)
  */
 export class Ext4FS implements VFSMount {
   private _dev:   Ext4BlockDevice;
   _sb:    Ext4Superblock | null = null;
   private _ready: boolean = false;
+  /** Why the write path is disabled ('' = writable). */
+  private _roReason = 'not mounted';
+  /** Raw superblock, patched for counters and flags before each commit. */
+  private _sbRaw: Uint8Array = new Uint8Array(0);
+  private _groups: Ext4BGD[] = [];
+  private _csumSeed = 0;
+  private _metaCsum = false;
+  private _gdtCsum  = false;
   // JBD2 journal state (Item 179)
   private _journal:  JBD2Journal | null = null;
+  /** ino → decoded block map; Map order is LRU order (oldest first). */
+  private _maps = new Map<number, InodeMap>();
+  /** Clean metadata blocks (LRU); the running transaction overrides them. */
+  private _bcache = new Map<number, Uint8Array>();
+  // Allocation state
+  private _mballoc: MbAllocator | null = null;
+  private _bbm = new Map<number, Uint8Array>();       // group → live block bitmap
+  private _ibm = new Map<number, Uint8Array>();       // group → live inode bitmap
+  private _dirtyBbm = new Set<number>();
+  private _dirtyIbm = new Set<number>();
+  private _dirtyGroups = new Set<number>();
+  private _pendingFree: Array<[number, number]> = []; // freed this transaction: [start, len]
+  /** Extent / directory blocks changed this transaction → owning inode (for tail checksums). */
+  private _extDirty = new Map<number, number>();
+  private _dirDirty = new Map<number, number>();
+  /** htree index blocks changed this transaction → [owning dir, count offset]. */
+  private _dxDirty = new Map<number, [number, number]>();
+  private _dxInfo: DxHashInfo | null = null;
+  /** Parsed htree index blocks by physical block. */
+  private _dxCache = new DxNodeCache();
+  // Delayed allocation
+  private _dirty = new Map<number, DirtyFile>();
+  private _dirtyBytes = 0;
+  readonly stats: Ext4IOStats = {
+    reads: 0, devReads: 0, devBytes: 0, raHits: 0, mapHits: 0, mapDecodes: 0,
+    writebacks: 0, dataWrites: 0, extents: 0, commits: 0, dxLookups: 0,
+  };
 
   constructor(dev: Ext4BlockDevice) {
     this._dev = dev;
     this._init();
   }
 
+  get blockSize(): number { return this._sb ? this._sb.blockSize : 1024; }
+
+  /** '' when the filesystem accepts writes, else the reason it does not. */
+  get readOnlyReason(): string { return this._roReason; }
+
   // ── Initialisation ──────────────────────────────────────────────────────────
 
   private _init(): void {
@@ -253,38 +487,99 @@ export class Ext4FS implements VFSMount {
       var sbData = this._readBytes(SUPERBLOCK_OFFSET, SUPERBLOCK_SIZE);
       this._sb   = parseSuperblock(sbData);
       if (!this._sb) return;
+      var sb = this._sb;
+      this._sbRaw = sbData;
+      // The group descriptor table follows the superblock's block
+      var gdtBytes = sb.groupCount * sb.groupDescSize;
+      var gdt = this._readBytes((sb.firstDataBlock + 1) * sb.blockSize, gdtBytes);
+      var gdv = new DataView(gdt.buffer, gdt.byteOffset, gdt.byteLength);
+      for (var g = 0; g < sb.groupCount; g++) this._groups.push(parseBGD(gdv, g * sb.groupDescSize, sb.groupDescSize));
+      this._metaCsum = (sb.featuresRoCompat & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM) !== 0;
+      this._gdtCsum  = !this._metaCsum && (sb.featuresRoCompat & EXT4_FEATURE_RO_COMPAT_GDT_CSUM) !== 0;
+      this._dxInfo = dxHashInfo(sbData);
+      this._csumSeed = sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_CSUM_SEED
+        ? sb.checksumSeed : crc32c(0xffffffff, sb.uuid, 0, 16);
       this._ready = true;
-      // Init JBD2 journal if present (Item 179)
-      if (this._sb.journalIno > 0) {
-        this._journal = new JBD2Journal(this);
-      }
+      this._roReason = this._checkWritable();
+      // Init JBD2 journal if present (Item 179); without one, commits
+      // write the changed blocks straight home (ext2 semantics).
+      this._journal = new JBD2Journal(this, sb.journalIno);
+      if (!this._roReason && this._journal.error) this._roReason = this._journal.error;
     } catch (_) { /* hardware not ready */ }
   }
 
+  /** Features the write path cannot maintain make the mount read-only. */
+  private _checkWritable(): string {
+    var sb = this._sb!;
+    if (sb.revLevel < 1) return 'revision 0 filesystem';
+    if (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_RECOVER) return 'journal needs recovery';
+    if (sb.featuresIncompat & ~EXT4_INCOMPAT_WRITABLE) return 'unsupported incompat features 0x' + (sb.featuresIncompat & ~EXT4_INCOMPAT_WRITABLE).toString(16);
+    if (sb.featuresRoCompat & ~EXT4_RO_COMPAT_WRITABLE) return 'unsupported ro_compat features 0x' + (sb.featuresRoCompat & ~EXT4_RO_COMPAT_WRITABLE).toString(16);
+    if (sb.featuresCompat & EXT4_FEATURE_COMPAT_SPARSE_SUPER2) return 'sparse_super2';
+    if ((sb.featuresCompat & EXT4_FEATURE_COMPAT_HAS_JOURNAL) && !sb.journalIno) return 'external journal';
+    if (sb.blockSize > 65536 || sb.blocksPerGroup > sb.blockSize * 8) return 'unsupported geometry';
+    return '';
+  }
+
+  private _writable(): number {
+    if (!this._ready) return -5;     // EIO
+    if (this._roReason) return -30;  // EROFS
+    return 0;
+  }
+
   // ── Low-level I/O ───────────────────────────────────────────────────────────
 
   _readBytes(byteOffset: number, length: number): Uint8Array {
-    var bs = 512;
     var out = new Uint8Array(length);
-    var read = 0;
-    while (read < length) {
-      var sector = this._dev.readSector(byteOffset + read);
-      var copy   = Math.min(bs, length - read);
-      out.set(sector.subarray(0, copy), read);
-      read += bs;
-    }
+    this._readInto(byteOffset, out, 0, length);
     return out;
   }
 
+  /**
+   * Read `length` bytes at `byteOffset` into `dst[dstOff…]`: one request when
+   * the device supports readInto(), else sector by sector with no
+   * intermediate buffers.  Returns 0, or <0 on a device error.
+   */
+  _readInto(byteOffset: number, dst: Uint8Array, dstOff: number, length: number): number {
+    if (length <= 0) return 0;
+    if (this._dev.readInto) {
+      var r = this._dev.readInto(byteOffset, dst, dstOff, length);
+      return r < 0 ? r : 0;
+    }
+    var pos = byteOffset, end = byteOffset + length;
+    while (pos < end) {
+      var base   = pos - (pos % 512);
+      var sector = this._dev.readSector(base);
+      var from   = pos - base;
+      var n      = Math.min(512 - from, end - pos, sector.length - from);
+      if (n <= 0) return -5;  // EIO: short sector
+      dst.set(sector.subarray(from, from + n), dstOff + (pos - byteOffset));
+      pos += n;
+    }
+    return 0;
+  }
+
   _writeBytes(byteOffset: number, data: Uint8Array): number {
-    var bs = 512;
-    var written = 0;
-    while (written < data.length) {
-      var sector = new Uint8Array(bs);
-      sector.set(data.subarray(written, written + bs));
-      var err = this._dev.writeSector(byteOffset + written, sector);
+    return this._writeRange(byteOffset, data, 0, data.length);
+  }
+
+  /**
+   * Write `length` bytes of `src[srcOff…]` at the sector-aligned `byteOffset`:
+   * one request with writeFrom(), else sector by sector (a short last sector
+   * is zero-padded).
+   */
+  _writeRange(byteOffset: number, src: Uint8Array, srcOff: number, length: number): number {
+    if (length <= 0) return 0;
+    if (this._dev.writeFrom) {
+      var r = this._dev.writeFrom(byteOffset, src, srcOff, length);
+      return r < 0 ? r : 0;
+    }
+    for (var done = 0; done < length; done += 512) {
+      var n = Math.min(512, length - done);
+      var sector = n === 512 ? src.subarray(srcOff + done, srcOff + done + 512) : new Uint8Array(512);
+      if (n < 512) sector.set(src.subarray(srcOff + done, srcOff + done + n));
+      var err = this._dev.writeSector(byteOffset + done, sector);
       if (err < 0) return err;
-      written += bs;
     }
     return 0;
   }
@@ -296,150 +591,426 @@ export class Ext4FS implements VFSMount {
 
   _writeBlock(blockNo: number, data: Uint8Array): number {
     if (!this._sb) return -5;
+    this._bcache.delete(blockNo);
     return this._writeBytes(blockNo * this._sb.blockSize, data);
   }
 
-  // ── Block Group Descriptor reading ─────────────────────────────────────────
+  // ── Metadata buffers ────────────────────────────────────────────────────────
+
+  /**
+   * Current contents of metadata block `blk`: the running transaction's copy
+   * if it has one, else the (cached) disk block.  Do not modify the result;
+   * use _metaWrite() for that.
+   */
+  _metaRead(blk: number): Uint8Array {
+    var t = this._journal ? this._journal.get(blk) : undefined;
+    if (t) return t;
+    var c = this._bcache.get(blk);
+    if (c) {
+      this._bcache.delete(blk);
+      this._bcache.set(blk, c);
+      return c;
+    }
+    c = this._readBlock(blk);
+    this._bcache.set(blk, c);
+    if (this._bcache.size > BCACHE_BLOCKS) this._bcache.delete(this._bcache.keys().next().value as number);
+    return c;
+  }
+
+  /** Writable copy of block `blk` in the running transaction. */
+  private _metaWrite(blk: number): Uint8Array {
+    var j = this._journal!;
+    var t = j.get(blk);
+    if (t) return t;
+    var b = this._metaRead(blk).slice();
+    j.put(blk, b);
+    return b;
+  }
+
+  /** Fresh zeroed block `blk` in the running transaction (a new allocation). */
+  private _metaNew(blk: number): Uint8Array {
+    var b = new Uint8Array(this._sb!.blockSize);
+    this._bcache.delete(blk);
+    this._dxCache.invalidate(blk);
+    this._journal!.put(blk, b);
+    return b;
+  }
+
+  /** Drop block `blk` from every metadata cache (it is being freed). */
+  private _forgetMeta(blk: number): void {
+    this._journal!.forget(blk);
+    this._bcache.delete(blk);
+    this._extDirty.delete(blk);
+    this._dirDirty.delete(blk);
+    this._dxDirty.delete(blk);
+    this._dxCache.invalidate(blk);
+  }
+
+  /** A checkpoint wrote `data` home: keep it as the clean copy. */
+  _cacheBlock(blk: number, data: Uint8Array): void {
+    this._bcache.delete(blk);
+    this._bcache.set(blk, data);
+    if (this._bcache.size > BCACHE_BLOCKS) this._bcache.delete(this._bcache.keys().next().value as number);
+  }
+
+  // ── Inode reading / writing ─────────────────────────────────────────────────
 
-  private _bgdTable(groupIndex: number): Ext4BGD | null {
+  private _inodeLoc(ino: number): { blk: number; off: number } | null {
     var sb = this._sb;
-    if (!sb) return null;
-    // BGD table is in the block after the superblock
-    var gdtBlock = sb.firstDataBlock + 1;
-    var gdOffset = gdtBlock * sb.blockSize + groupIndex * sb.groupDescSize;
-    var raw = this._readBytes(gdOffset, sb.groupDescSize);
-    var dv  = new DataView(raw.buffer);
-    return parseBGD(dv, 0, sb.groupDescSize);
+    if (!sb || ino < 1 || ino > sb.inodesCount) return null;
+    var idx = ino - 1;
+    var gd  = this._groups[Math.floor(idx / sb.inodesPerGroup)];
+    if (!gd) return null;
+    var byteOff = (idx % sb.inodesPerGroup) * sb.inodeSize;
+    return { blk: gd.inodeTable + Math.floor(byteOff / sb.blockSize), off: byteOff % sb.blockSize };
   }
 
-  // ── Inode reading ───────────────────────────────────────────────────────────
+  /** Copy of the on-disk inode bytes (s_inode_size long). */
+  private _inodeRaw(ino: number): Uint8Array | null {
+    var loc = this._inodeLoc(ino);
+    if (!loc) return null;
+    return this._metaRead(loc.blk).slice(loc.off, loc.off + this._sb!.inodeSize);
+  }
 
   private _readInode(ino: number): Ext4Inode | null {
-    var sb = this._sb;
-    if (!sb || ino < 1) return null;
-    var idx     = ino - 1;
-    var group   = Math.floor(idx / sb.inodesPerGroup);
-    var local   = idx % sb.inodesPerGroup;
-    var bgd     = this._bgdTable(group);
-    if (!bgd) return null;
-    var tableBlock = bgdPhysBlock(bgd.inodeTableHi, bgd.inodeTableLo);
-    var off = tableBlock * sb.blockSize + local * sb.inodeSize;
-    var raw = this._readBytes(off, sb.inodeSize);
-    return parseInode(raw, 0, sb.inodeSize);
+    var raw = this._inodeRaw(ino);
+    return raw ? parseInode(raw, 0, this._sb!.inodeSize) : null;
+  }
+
+  /** Store inode bytes into the running transaction (checksum updated). */
+  private _putInode(ino: number, raw: Uint8Array): void {
+    var loc = this._inodeLoc(ino)!;
+    if (this._metaCsum) {
+      var hasHi = raw.length > 128 && rd16(raw, 0x80) >= 4;
+      wr16(raw, 0x7c, 0);
+      if (hasHi) wr16(raw, 0x82, 0);
+      var c = crc32c(this._inodeSeed(ino, raw), raw, 0, raw.length);
+      wr16(raw, 0x7c, c & 0xffff);
+      if (hasHi) wr16(raw, 0x82, c >>> 16);
+    }
+    this._metaWrite(loc.blk).set(raw, loc.off);
+  }
+
+  /** metadata_csum seed of an inode: crc32c(fs seed, ino, generation). */
+  private _inodeSeed(ino: number, raw: Uint8Array): number {
+    return crc32cU32(crc32cU32(this._csumSeed, ino), rd32(raw, 0x64));
   }
 
-  // ── Extent tree: map logical block → physical block ──────────────────────────
+  private _rawSize(raw: Uint8Array): number { return rd32(raw, 108) * 0x100000000 + rd32(raw, 4); }
+
+  private _setRawSize(raw: Uint8Array, size: number): void {
+    wr32(raw, 4, size % 0x100000000);
+    wr32(raw, 108, Math.floor(size / 0x100000000));
+  }
+
+  /** Add (or with n < 0, remove) `n` filesystem blocks to i_blocks. */
+  private _addBlocks(raw: Uint8Array, n: number): void {
+    var huge = (this._sb!.featuresRoCompat & EXT4_FEATURE_RO_COMPAT_HUGE_FILE) !== 0;
+    var units = rd32(raw, 32) & EXT4_HUGE_FILE_FL ? n : n * (this._sb!.blockSize / 512);
+    var cur = rd32(raw, 28) + (huge ? rd16(raw, 0x74) * 0x100000000 : 0);
+    var v = Math.max(0, cur + units);
+    wr32(raw, 28, v % 0x100000000);
+    if (huge) wr16(raw, 0x74, Math.floor(v / 0x100000000));
+  }
+
+  private _touch(raw: Uint8Array): void {
+    var t = nowSec();
+    wr32(raw, 12, t);   // ctime
+    wr32(raw, 16, t);   // mtime
+  }
+
+  /** Size including buffered (not yet allocated) writes. */
+  private _fileSize(ino: number, inode: Ext4Inode): number {
+    var df = this._dirty.get(ino);
+    return df ? df.size : inodeSize64(inode);
+  }
+
+  // ── Block map cache ─────────────────────────────────────────────────────────
 
   /**
-   * [Item 178] Walk an extent tree starting at `iBlock` to resolve `logicalBlock`
-   * to a physical block number. Returns 0 if the block is a hole.
+   * Decoded run list of inode `ino`, from the cache when its i_block is
+   * unchanged.  The whole extent tree (or indirect map) is decoded once, so a
+   * lookup afterwards is a binary search with no disk I/O.
    */
-  private _extentLookup(iBlock: Uint8Array, logicalBlock: number): number {
-    var dv = new DataView(iBlock.buffer, iBlock.byteOffset, iBlock.byteLength);
+  private _inodeMap(ino: number, inode: Ext4Inode): InodeMap {
+    var m = this._maps.get(ino);
+    if (m && sameBytes(m.iBlock, inode.iBlock)) {
+      this._maps.delete(ino);           // refresh LRU position
+      this._maps.set(ino, m);
+      this.stats.mapHits++;
+      return m;
+    }
+    this.stats.mapDecodes++;
+    var runs: ExtentRun[] = [];
+    if (inode.flags & EXT4_EXTENTS_FL) this._decodeExtents(inode.iBlock, 0, runs);
+    else if (!(inode.flags & EXT4_INLINE_DATA_FL)) this._decodeIndirect(inode, runs);
+    m = { iBlock: inode.iBlock.slice(), runs: runs, next: -1, raWin: RA_MIN, raPos: 0, raBuf: null };
+    this._maps.delete(ino);
+    this._maps.set(ino, m);
+    if (this._maps.size > MAP_CACHE_INODES) this._maps.delete(this._maps.keys().next().value as number);
+    return m;
+  }
+
+  /** Drop cached maps and readahead data (after blocks were rewritten). */
+  invalidateCaches(ino?: number): void {
+    if (ino === undefined) this._maps.clear();
+    else this._maps.delete(ino);
+  }
+
+  /** [Item 178] Append the leaf extents of the (sub)tree in `node` to `runs`. */
+  private _decodeExtents(node: Uint8Array, level: number, runs: ExtentRun[]): void {
+    var dv  = new DataView(node.buffer, node.byteOffset, node.byteLength);
     var hdr = parseExtentHeader(dv, 0);
-    if (hdr.magic !== EXTENT_HEADER_MAGIC) return 0;
-
-    // Iterative tree descent
-    var data: Uint8Array = iBlock;
-    var depth = hdr.depth;
-
-    while (depth > 0) {
-      dv  = new DataView(data.buffer, data.byteOffset, data.byteLength);
-      hdr = parseExtentHeader(dv, 0);
-      // Find the best index (last index where index.block <= logicalBlock)
-      var child = 0;
-      for (var ii = 0; ii < hdr.entries; ii++) {
-        var idx = parseExtentIndex(dv, 12 + ii * 12);
-        if (idx.block <= logicalBlock) child = idx.leafLo;
-        else break;
+    if (hdr.magic !== EXTENT_HEADER_MAGIC || level > 5) return;  // corrupt / looping tree
+    var n = Math.min(hdr.entries, ((node.length - 12) / 12) | 0);
+    for (var i = 0; i < n; i++) {
+      if (hdr.depth > 0) {
+        var idx = parseExtentIndex(dv, 12 + i * 12);
+        var child = bgdPhysBlock(idx.leafHi, idx.leafLo);
+        if (child) this._decodeExtents(this._metaRead(child), level + 1, runs);
+      } else {
+        var ext = parseExtent(dv, 12 + i * 12);
+        // ee_len ≤ 32768: initialized; above: uninitialized (reads as zeroes)
+        var uninit = ext.len > EXT_INIT_MAX_LEN;
+        var len    = uninit ? ext.len - EXT_INIT_MAX_LEN : ext.len;
+        if (len) pushRun(runs, ext.block, len, bgdPhysBlock(ext.startHi, ext.startLo), uninit);
       }
-      if (child === 0) return 0;
-      data = this._readBlock(child);
-      depth--;
-    }
-
-    // Leaf level: scan extents
-    dv  = new DataView(data.buffer, data.byteOffset, data.byteLength);
-    hdr = parseExtentHeader(dv, 0);
-    for (var ei = 0; ei < hdr.entries; ei++) {
-      var ext = parseExtent(dv, 12 + ei * 12);
-      var realLen = ext.len & 0x7fff;  // bit 15 = uninitialized flag
-      if (logicalBlock >= ext.block && logicalBlock < ext.block + realLen) {
-        var physBase = bgdPhysBlock(ext.startHi, ext.startLo);
-        return physBase + (logicalBlock - ext.block);
+    }
+  }
+
+  /**
+   * ext2/3 block map: 12 direct pointers, then single, double and triple
+   * indirect blocks.  Only blocks below the file size are decoded; physically
+   * contiguous pointers merge into one run.
+   */
+  private _decodeIndirect(inode: Ext4Inode, runs: ExtentRun[]): void {
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    var ptrs = bs >>> 2;
+    var total = Math.ceil(inodeSize64(inode) / bs);
+    var dv = new DataView(inode.iBlock.buffer, inode.iBlock.byteOffset, 60);
+    var lblk = 0;
+    for (var d = 0; d < EXT4_NDIR_BLOCKS && lblk < total; d++, lblk++) {
+      var p = u32(dv, d * 4);
+      if (p) pushRun(runs, lblk, 1, p);
+    }
+    // Walk an indirect tree of `depth` levels rooted at `blk`, mapping from lblk on
+    var walk = (blk: number, depth: number): void => {
+      var span = Math.pow(ptrs, depth);           // logical blocks under one slot
+      if (!blk) { lblk += span * ptrs; return; }
+      var data = this._metaRead(blk);
+      var bdv  = new DataView(data.buffer, data.byteOffset, data.byteLength);
+      for (var i = 0; i < ptrs && lblk < total; i++) {
+        var child = u32(bdv, i * 4);
+        if (depth === 0) {
+          if (child) pushRun(runs, lblk, 1, child);
+          lblk++;
+        } else {
+          walk(child, depth - 1);
+        }
       }
+    };
+    for (var level = 0; level < 3 && lblk < total; level++) {
+      walk(u32(dv, (EXT4_NDIR_BLOCKS + level) * 4), level);
     }
-    return 0;  // hole
+  }
+
+  /** Index of the run containing (or the first run after) logical block `lblk`. */
+  private _findRun(runs: ExtentRun[], lblk: number): number {
+    var lo = 0, hi = runs.length;
+    while (lo < hi) {
+      var mid = (lo + hi) >> 1;
+      if (runs[mid].lblk + runs[mid].len <= lblk) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+  }
+
+  /** Run containing logical block `lblk`, or null for a hole. */
+  private _runAt(runs: ExtentRun[], lblk: number): ExtentRun | null {
+    var r = runs[this._findRun(runs, lblk)];
+    return r && r.lblk <= lblk && r.pblk ? r : null;
+  }
+
+  /** Physical block backing logical block `lblk` of `ino`, or 0 for a hole. */
+  _bmap(ino: number, inode: Ext4Inode, lblk: number): number {
+    var r = this._runAt(this._inodeMap(ino, inode).runs, lblk);
+    return r ? r.pblk + (lblk - r.lblk) : 0;
+  }
+
+  /**
+   * [Item 178] Walk an extent tree starting at `iBlock` to resolve `logicalBlock`
+   * to a physical block number. Returns 0 if the block is a hole.
+   */
+  private _extentLookup(iBlock: Uint8Array, logicalBlock: number): number {
+    var runs: ExtentRun[] = [];
+    this._decodeExtents(iBlock, 0, runs);
+    var r = this._runAt(runs, logicalBlock);
+    return r ? r.pblk + (logicalBlock - r.lblk) : 0;
   }
 
   // ── File data reading ───────────────────────────────────────────────────────
 
+  /**
+   * Copy file bytes [pos, pos + len) into `dst[dstOff…]` following the run
+   * list: each physically contiguous stretch is one device read, holes are
+   * zero-filled.  Returns 0, or <0 on a device error.
+   */
+  private _readMapped(m: InodeMap, pos: number, dst: Uint8Array, dstOff: number, len: number): number {
+    var bs   = this._sb!.blockSize;
+    var runs = m.runs;
+    var end  = pos + len;
+    var ri   = this._findRun(runs, Math.floor(pos / bs));
+    while (pos < end) {
+      var lblk = Math.floor(pos / bs);
+      var r    = runs[ri];
+      var n: number;
+      if (!r || r.lblk > lblk) {
+        // Hole up to the next run (or the end of the request)
+        n = Math.min(end, r ? r.lblk * bs : end) - pos;
+        dst.fill(0, dstOff, dstOff + n);
+      } else {
+        n = Math.min(end, (r.lblk + r.len) * bs) - pos;
+        if (r.pblk && !r.uninit) {
+          var err = this._readInto(r.pblk * bs + (pos - r.lblk * bs), dst, dstOff, n);
+          if (err < 0) return err;
+          this.stats.devReads++;
+          this.stats.devBytes += n;
+        } else {
+          dst.fill(0, dstOff, dstOff + n);
+        }
+        ri++;
+      }
+      pos    += n;
+      dstOff += n;
+    }
+    return 0;
+  }
+
   /**
    * [Item 178] Read `length` bytes from inode `ino` starting at `offset`.
-   * Handles extent trees + inline data.
+   * Handles extent trees, indirect maps + inline data, and sees writes still
+   * buffered in the page cache.
+   *
+   * A read that starts where the previous one on the same inode ended is
+   * sequential: it is widened to the readahead window (doubling per
+   * sequential read, RA_MIN…RA_MAX) and the surplus is kept for the next
+   * call.  Any other access resets the window.
    */
   readInodeData(ino: number, offset: number, length: number): Uint8Array | null {
     var sb = this._sb; if (!sb) return null;
     var inode = this._readInode(ino); if (!inode) return null;
-    var fileSize = inode.sizeHi * 0x100000000 + inode.sizeLo;
+    this.stats.reads++;
+    var diskSize = inodeSize64(inode);
+    var fileSize = this._fileSize(ino, inode);
     if (offset >= fileSize) return new Uint8Array(0);
     var toRead = Math.min(length, fileSize - offset);
     var out = new Uint8Array(toRead);
-    var done = 0;
 
     // Inline data (EXT4_INLINE_DATA_FL — data fits in i_block)
     if (inode.flags & EXT4_INLINE_DATA_FL) {
-      out.set(inode.iBlock.subarray(offset, offset + toRead));
+      out.set(inode.iBlock.subarray(offset, Math.min(60, offset + toRead)));
       return out;
     }
 
-    while (done < toRead) {
-      var fileOff   = offset + done;
-      var logBlock  = Math.floor(fileOff / sb.blockSize);
-      var blockOff  = fileOff % sb.blockSize;
-      var physBlock: number;
+    var fromDisk = Math.min(toRead, diskSize - offset);
+    if (fromDisk > 0 && this._readCached(ino, inode, offset, out, fromDisk) < 0) return null;
+    var df = this._dirty.get(ino);
+    if (df) this._overlay(df, offset, out);
+    return out;
+  }
 
-      if (inode.flags & EXT4_EXTENTS_FL) {
-        physBlock = this._extentLookup(inode.iBlock, logBlock);
-      } else {
-        // Fall back to ext2-compatible indirect block mapping
-        var blkDV = new DataView(inode.iBlock.buffer, inode.iBlock.byteOffset, 60);
-        physBlock = u32(blkDV, logBlock * 4);  // direct blocks only (simplified)
-      }
+  /** Read [offset, offset + len) of the on-disk file through the readahead window. */
+  private _readCached(ino: number, inode: Ext4Inode, offset: number, out: Uint8Array, len: number): number {
+    var m = this._inodeMap(ino, inode);
+    var fileSize = inodeSize64(inode);
+    var sequential = offset === m.next;
+    m.next = offset + len;
+    var done = 0;
 
-      var blockData = physBlock ? this._readBlock(physBlock) : new Uint8Array(sb.blockSize);
-      var copyLen   = Math.min(sb.blockSize - blockOff, toRead - done);
-      out.set(blockData.subarray(blockOff, blockOff + copyLen), done);
-      done += copyLen;
+    // Served from the readahead buffer?
+    var ra = m.raBuf;
+    if (ra && offset >= m.raPos && offset < m.raPos + ra.length) {
+      var from = offset - m.raPos;
+      done = Math.min(len, ra.length - from);
+      out.set(ra.subarray(from, from + done));
+      this.stats.raHits++;
+      if (done === len) return 0;
+    }
+
+    var pos = offset + done;
+    var want = len - done;
+    if (sequential && want < m.raWin && pos + want < fileSize) {
+      // Read a whole window from `pos`; keep what the caller did not ask for
+      var winLen = Math.min(m.raWin, fileSize - pos);
+      var buf = new Uint8Array(winLen);
+      var err = this._readMapped(m, pos, buf, 0, winLen);
+      if (err < 0) return err;
+      out.set(buf.subarray(0, want), done);
+      m.raPos = pos;
+      m.raBuf = buf;
+      if (m.raWin < RA_MAX) m.raWin = Math.min(RA_MAX, m.raWin * 2);
+      return 0;
+    }
+    if (!sequential) { m.raWin = RA_MIN; m.raBuf = null; }
+    return this._readMapped(m, pos, out, done, want);
+  }
+
+  /** Copy buffered pages over `out`, which holds file bytes from `offset`. */
+  private _overlay(df: DirtyFile, offset: number, out: Uint8Array): void {
+    var bs = this._sb!.blockSize;
+    var end = offset + out.length;
+    for (var lb = Math.floor(offset / bs); lb * bs < end; lb++) {
+      var page = df.pages.get(lb);
+      if (!page) continue;
+      var s = Math.max(offset, lb * bs), e = Math.min(end, lb * bs + bs);
+      out.set(page.subarray(s - lb * bs, e - lb * bs), s - offset);
     }
-    return out;
   }
 
   // ── Directory listing ───────────────────────────────────────────────────────
 
+  /**
+   * Walk the entries of directory `ino` (block by block, through the metadata
+   * cache so uncommitted changes are visible).  `fn` returns true to stop.
+   */
+  private _dirWalk(ino: number, fn: (blk: number, buf: Uint8Array, off: number, prev: number,
+                                     eIno: number, nameLen: number, recLen: number) => boolean): void {
+    var sb = this._sb!;
+    var inode = this._readInode(ino); if (!inode) return;
+    var bs = sb.blockSize;
+    var nblocks = Math.ceil(inodeSize64(inode) / bs);
+    var m = this._inodeMap(ino, inode);
+    var ftype = (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
+    for (var lb = 0; lb < nblocks; lb++) {
+      var r = this._runAt(m.runs, lb);
+      if (!r) continue;
+      var blk = r.pblk + (lb - r.lblk);
+      var buf = this._metaRead(blk);
+      var off = 0, prev = -1;
+      while (off + 8 <= bs) {
+        var recLen = rd16(buf, off + 4);
+        if (recLen < 8 || off + recLen > bs) break;
+        var nameLen = ftype ? buf[off + 6] : rd16(buf, off + 6);
+        if (fn(blk, buf, off, prev, rd32(buf, off), nameLen, recLen)) return;
+        prev = off;
+        off += recLen;
+      }
+    }
+  }
+
   private _readDir(ino: number): Array<{ name: string; ino: number; type: number }> {
     var sb = this._sb; if (!sb) return [];
-    var inode = this._readInode(ino); if (!inode) return [];
-    var size  = inode.sizeLo;
-    var raw   = this.readInodeData(ino, 0, size);
-    if (!raw) return [];
+    var ftype = (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
     var entries: Array<{ name: string; ino: number; type: number }> = [];
-    var off = 0;
-    while (off + 8 < raw.length) {
-      var dv     = new DataView(raw.buffer, raw.byteOffset, raw.byteLength);
-      var eIno   = u32(dv, off + 0);
-      var recLen = u16(dv, off + 4);
-      var nameLen = u8(dv, off + 6);
-      var fType  = u8(dv, off + 7);
+    this._dirWalk(ino, function(_blk, buf, off, _prev, eIno, nameLen) {
       if (eIno !== 0 && nameLen > 0) {
-        var _e4nb = raw.slice(off + 8, off + 8 + nameLen); var eName = ''; for (var _e4ni = 0; _e4ni < _e4nb.length; _e4ni++) eName += String.fromCharCode(_e4nb[_e4ni]!);
+        var eName = utf8Decode(buf.subarray(off + 8, off + 8 + nameLen));
         if (eName !== '.' && eName !== '..') {
-          entries.push({ name: eName, ino: eIno, type: fType });
+          entries.push({ name: eName, ino: eIno, type: ftype ? buf[off + 7] : 0 });
         }
       }
-      if (recLen < 8) break;
-      off += recLen;
-    }
+      return false;
+    });
     return entries;
   }
 
@@ -447,35 +1018,145 @@ export class Ext4FS implements VFSMount {
     var parts = path.replace(/^\//, '').split('/').filter(function(p) { return p.length > 0; });
     var curIno = EXT4_ROOT_INO;
     for (var i = 0; i < parts.length; i++) {
-      var entries = this._readDir(curIno);
-      var found = false;
-      for (var ei = 0; ei < entries.length; ei++) {
-        if (entries[ei].name === parts[i]) {
-          curIno = entries[ei].ino;
-          found  = true;
-          break;
-        }
-      }
-      if (!found) return 0;
+      var next = this._dirLookup(curIno, parts[i]);
+      if (!next) return 0;
+      curIno = next;
     }
     return curIno;
   }
 
+  /** Inode of `name` in directory `dir`, or 0. */
+  private _dirLookup(dir: number, name: string): number {
+    var hit = this._dirFind(dir, utf8Encode(name));
+    return hit ? hit.ino : 0;
+  }
+
+  /**
+   * Find `name` in directory `dir`.  Indexed directories are searched
+   * through the htree — the leaf for the name's hash, plus following leaves
+   * while a hash collision run continues — and linearly otherwise.
+   */
+  private _dirFind(dir: number, name: Uint8Array): { blk: number; off: number; prev: number; ino: number } | null {
+    var inode = this._readInode(dir);
+    if (!inode) return null;
+    var path = this._dxIndexed(inode.flags) ? this._dxProbe(dir, inode, name) : null;
+    if (path) {
+      this.stats.dxLookups++;
+      for (;;) {
+        var f = path.frames[path.frames.length - 1];
+        var blk = this._bmap(dir, inode, f.node.blocks[f.at]);
+        var hit = blk ? this._scanBlock(blk, name) : null;
+        if (hit) return hit;
+        if (!this._dxNextLeaf(dir, inode, path)) return null;
+      }
+    }
+    var found: { blk: number; off: number; prev: number; ino: number } | null = null;
+    this._dirWalk(dir, function(blk, buf, off, prev, eIno, nameLen) {
+      if (eIno === 0 || nameLen !== name.length) return false;
+      for (var i = 0; i < nameLen; i++) if (buf[off + 8 + i] !== name[i]) return false;
+      found = { blk: blk, off: off, prev: prev, ino: eIno };
+      return true;
+    });
+    return found;
+  }
+
+  /** Look for `name` in the single directory block `blk`. */
+  private _scanBlock(blk: number, name: Uint8Array): { blk: number; off: number; prev: number; ino: number } | null {
+    var bs = this._sb!.blockSize;
+    var ftype = (this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
+    var buf = this._metaRead(blk);
+    var off = 0, prev = -1;
+    while (off + 8 <= bs) {
+      var recLen = rd16(buf, off + 4);
+      if (recLen < 8 || off + recLen > bs) break;
+      var nameLen = ftype ? buf[off + 6] : rd16(buf, off + 6);
+      var eIno = rd32(buf, off);
+      if (eIno && nameLen === name.length) {
+        var i = 0;
+        while (i < nameLen && buf[off + 8 + i] === name[i]) i++;
+        if (i === nameLen) return { blk: blk, off: off, prev: prev, ino: eIno };
+      }
+      prev = off;
+      off += recLen;
+    }
+    return null;
+  }
+
+  // ── Hashed directories ──────────────────────────────────────────────────────
+
+  private _dxIndexed(flags: number): boolean {
+    return (flags & EXT4_INDEX_FL) !== 0 && (this._sb!.featuresCompat & EXT2_FEATURE_COMPAT_DIR_INDEX) !== 0;
+  }
+
+  private _dxMaxLevels(): number {
+    return this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_LARGEDIR ? 3 : 2;
+  }
+
+  /** Parsed index block at physical `blk` (cached). */
+  private _dxNode(blk: number, countOff: number): DxNode | null {
+    return this._dxCache.get(blk, () => parseDxNode(this._metaRead(blk), countOff));
+  }
+
+  /** Hash of `name` under the directory's index, and the path down to its leaf; null if unusable. */
+  private _dxProbe(dir: number, inode: Ext4Inode, name: Uint8Array): DxPath | null {
+    var rootBlk = this._bmap(dir, inode, 0);
+    if (!rootBlk) return null;
+    var rb = this._metaRead(rootBlk);
+    var info = parseDxRootInfo(rb, this._dxMaxLevels());
+    if (!info) return null;
+    var hash = dxHash(name, 0, name.length, dxEffectiveVersion(this._dxInfo!, info.hashVersion), this._dxInfo!.seed);
+    if (hash < 0) return null;
+    var node = this._dxNode(rootBlk, DX_ROOT_INFO + info.infoLen);
+    var frames: DxFrame[] = [];
+    var blk = rootBlk;
+    for (var level = 0; node; level++) {
+      var at = dxSearch(node, hash);
+      frames.push({ blk: blk, node: node, at: at });
+      if (level === info.levels) return { hash: hash, frames: frames };
+      blk = this._bmap(dir, inode, node.blocks[at]);
+      node = blk ? this._dxNode(blk, 8) : null;
+    }
+    return null;
+  }
+
+  /**
+   * Advance `path` to the next leaf if it continues the collision run of
+   * `path.hash` (its start hash is the same hash with bit 0 set).
+   */
+  private _dxNextLeaf(dir: number, inode: Ext4Inode, path: DxPath): boolean {
+    var fr = path.frames;
+    var p = fr.length - 1;
+    while (p >= 0 && fr[p].at + 1 >= fr[p].node.hashes.length) p--;
+    if (p < 0) return false;
+    var next = fr[p].node.hashes[fr[p].at + 1];
+    if (!(next & 1) || ((next & ~1) >>> 0) !== path.hash) return false;
+    fr[p].at++;
+    for (var q = p + 1; q < fr.length; q++) {
+      var blk = this._bmap(dir, inode, fr[q - 1].node.blocks[fr[q - 1].at]);
+      var node = blk ? this._dxNode(blk, 8) : null;
+      if (!node) return false;
+      fr[q] = { blk: blk, node: node, at: 0 };
+    }
+    return true;
+  }
+
+  /** An index block changed: drop its parsed copy, checksum it at commit. */
+  private _dxTouch(blk: number, dir: number, countOff: number): void {
+    this._dxCache.invalidate(blk);
+    this._dxDirty.set(blk, [dir, countOff]);
+  }
+
   // ── VFSMount interface ──────────────────────────────────────────────────────
 
   read(path: string): string | null {
     if (!this._ready) return null;
     var ino = this._resolvePathIno(path);
     if (!ino) return null;
-    var sb  = this._sb!;
     var inodeData = this._readInode(ino);
     if (!inodeData) return null;
-    var size = inodeData.sizeLo;
-    var raw  = this.readInodeData(ino, 0, Math.min(size, 65536));
+    var raw  = this.readInodeData(ino, 0, this._fileSize(ino, inodeData));
     if (!raw) return null;
-    var text = '';
-    for (var i = 0; i < raw.length; i++) text += String.fromCharCode(raw[i]);
-    return text;
+    return utf8Decode(raw);
   }
 
   list(path: string): Array<{ name: string; type: FileType; size: number }> {
@@ -485,10 +1166,11 @@ export class Ext4FS implements VFSMount {
     var children = this._readDir(ino);
     return children.map((e) => {
       var inode = this._readInode(e.ino);
+      var isDir = e.type === EXT4_FT_DIR || (!!inode && (inode.mode & 0xf000) === 0x4000);
       return {
         name: e.name,
-        type: e.type === EXT4_FT_DIR ? 'directory' as FileType : 'file' as FileType,
-        size: inode ? inode.sizeLo : 0,
+        type: isDir ? 'directory' as FileType : 'file' as FileType,
+        size: inode ? this._fileSize(e.ino, inode) : 0,
       };
     });
   }
@@ -506,106 +1188,1413 @@ export class Ext4FS implements VFSMount {
     return inode ? (inode.mode & 0xf000) === 0x4000 : false;
   }
 
-  // ── Write support (Item 179) ────────────────────────────────────────────────
+  /** Replace the contents of `path`, creating it if needed. */
+  writeFile(path: string, content: string | Uint8Array): void {
+    var err = this.write(path, typeof content === 'string' ? utf8Encode(content) : content, false);
+    if (err < 0) throw new Error('Ext4: cannot write ' + path + ' (' + err + ')');
+  }
+
+  appendFile(path: string, content: string | Uint8Array): void {
+    var err = this.write(path, typeof content === 'string' ? utf8Encode(content) : content, true);
+    if (err < 0) throw new Error('Ext4: cannot append to ' + path + ' (' + err + ')');
+  }
+
+  deleteFile(path: string): void {
+    var err = this.unlink(path);
+    if (err < 0) throw new Error('Ext4: cannot remove ' + path + ' (' + err + ')');
+  }
+
+  mkdir(path: string): void {
+    var err = this.mkdirAt(path);
+    if (err < 0 && err !== -17) throw new Error('Ext4: cannot mkdir ' + path + ' (' + err + ')');
+  }
+
+  // ── Write support (Item 179) ────────────────────────────────────────────────────
 
   /**
-   * [Item 179] Write data to a file inode via the JBD2 journal.
+   * [Item 179] Write data to a file inode.
    *
-   * The write is buffered in the journal log and applied only when
-   * the transaction is committed (commitTransaction).
+   * The data goes into the page cache only (delayed allocation); blocks are
+   * allocated and written at writeback, and the metadata that maps them is
+   * journaled.  Returns 0, or a negative errno.
    */
   writeInodeData(ino: number, offset: number, data: Uint8Array): number {
-    if (!this._ready || !this._journal) return -5;
-    return this._journal.writeData(ino, offset, data);
+    var err = this._writable(); if (err) return err;
+    var sb = this._sb!;
+    var inode = this._readInode(ino); if (!inode) return -2;            // ENOENT
+    if ((inode.mode & 0xf000) !== 0x8000) return -21;                    // EISDIR / not regular
+    if (inode.flags & EXT4_INLINE_DATA_FL) return -95;                   // EOPNOTSUPP
+    if (data.length === 0) return 0;
+    var bs = sb.blockSize;
+    var df = this._dirty.get(ino);
+    if (!df) {
+      df = { size: inodeSize64(inode), pages: new Map(), since: Date.now() };
+      this._dirty.set(ino, df);
+    }
+    var end = offset + data.length;
+    // Extending past a partial last block: load that block so the bytes
+    // between the old end and the write read back as zeroes.
+    if (offset > df.size && df.size % bs) this._dirtyPage(ino, inode, df, Math.floor(df.size / bs));
+    for (var pos = offset; pos < end; ) {
+      var lblk = Math.floor(pos / bs);
+      var boff = pos - lblk * bs;
+      var n    = Math.min(bs - boff, end - pos);
+      var page = n === bs ? df.pages.get(lblk) || this._newPage(df, lblk) : this._dirtyPage(ino, inode, df, lblk);
+      page.set(data.subarray(pos - offset, pos - offset + n), boff);
+      pos += n;
+    }
+    if (end > df.size) df.size = end;
+    return this._balanceDirty();
+  }
+
+  private _newPage(df: DirtyFile, lblk: number): Uint8Array {
+    var page = new Uint8Array(this._sb!.blockSize);
+    df.pages.set(lblk, page);
+    this._dirtyBytes += page.length;
+    return page;
+  }
+
+  /** Page for `lblk`, filled from disk (zero past the on-disk size) when new. */
+  private _dirtyPage(ino: number, inode: Ext4Inode, df: DirtyFile, lblk: number): Uint8Array {
+    var page = df.pages.get(lblk);
+    if (page) return page;
+    page = this._newPage(df, lblk);
+    var bs = this._sb!.blockSize;
+    var avail = Math.min(bs, inodeSize64(inode) - lblk * bs, df.size - lblk * bs);
+    if (avail > 0) this._readMapped(this._inodeMap(ino, inode), lblk * bs, page, 0, avail);
+    return page;
+  }
+
+  /** Write back when the page cache is over budget or old; commit when due. */
+  private _balanceDirty(): number {
+    var err = 0;
+    if (this._dirtyBytes >= DELALLOC_MAX_BYTES) {
+      err = this._writebackAll();
+    } else {
+      var now = Date.now();
+      this._dirty.forEach((df, ino) => {
+        if (!err && now - df.since >= DELALLOC_EXPIRE_MS) err = this._writeback(ino);
+      });
+    }
+    return err || this._maybeCommit();
+  }
+
+  private _writebackAll(): number {
+    var err = 0;
+    var inos = Array.from(this._dirty.keys());
+    for (var i = 0; i < inos.length && !err; i++) err = this._writeback(inos[i]);
+    return err;
+  }
+
+  /**
+   * Writeback of one file: allocate every run of unmapped dirty blocks with
+   * one multi-block request per run (extents grow at the goal when possible),
+   * insert the extents, write the pages — one device request per physically
+   * contiguous stretch — then journal the inode.
+   */
+  private _writeback(ino: number): number {
+    var df = this._dirty.get(ino);
+    if (!df) return 0;
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    var raw = this._inodeRaw(ino);
+    if (!raw) return -2;
+    this.stats.writebacks++;
+    var lblks = Array.from(df.pages.keys()).sort(function(a, b) { return a - b; });
+    // Size first: indirect maps are decoded up to i_size only
+    if (df.size > this._rawSize(raw)) this._setRawSize(raw, df.size);
+    var runs = this._inodeMap(ino, parseInode(raw, 0, sb.inodeSize)).runs;
+    var err = 0;
+
+    // 1. Allocate holes; turn uninitialized extents that get data into real ones
+    for (var i = 0; i < lblks.length && !err; ) {
+      var r = this._runAt(runs, lblks[i]);
+      if (r) {
+        if (r.uninit) {
+          err = this._extMarkInit(ino, raw, lblks[i]);
+          runs = this._reloadRuns(ino, raw);
+        }
+        i++;
+        continue;
+      }
+      var j = i + 1;
+      while (j < lblks.length && lblks[j] === lblks[j - 1] + 1 && !this._runAt(runs, lblks[j])) j++;
+      err = this._allocRange(ino, raw, lblks[i], j - i, this._goalFor(ino, runs, lblks[i]));
+      runs = this._reloadRuns(ino, raw);
+      i = j;
+    }
+
+    // 2. Write pages, coalescing physically contiguous blocks
+    for (var k = 0; k < lblks.length && !err; ) {
+      var p0 = this._runAt(runs, lblks[k]);
+      if (!p0) { err = -5; break; }
+      var pstart = p0.pblk + (lblks[k] - p0.lblk);
+      var e = k + 1;
+      while (e < lblks.length && lblks[e] === lblks[e - 1] + 1) {
+        var pr = this._runAt(runs, lblks[e]);
+        if (!pr || pr.pblk + (lblks[e] - pr.lblk) !== pstart + (e - k)) break;
+        e++;
+      }
+      var buf = e - k === 1 ? df.pages.get(lblks[k])! : new Uint8Array((e - k) * bs);
+      if (e - k > 1) for (var q = k; q < e; q++) buf.set(df.pages.get(lblks[q])!, (q - k) * bs);
+      err = this._writeRange(pstart * bs, buf, 0, buf.length);
+      for (var c = 0; c < e - k; c++) this._bcache.delete(pstart + c);
+      this.stats.dataWrites++;
+      k = e;
+    }
+    if (err) return err;
+
+    this._touch(raw);
+    this._putInode(ino, raw);
+    this._dirtyBytes -= df.pages.size * bs;
+    this._dirty.delete(ino);
+    this.invalidateCaches(ino);
+    return 0;
+  }
+
+  private _reloadRuns(ino: number, raw: Uint8Array): ExtentRun[] {
+    this.invalidateCaches(ino);
+    return this._inodeMap(ino, parseInode(raw, 0, this._sb!.inodeSize)).runs;
+  }
+
+  /** Allocation goal for logical block `lblk`: continue the nearest run before it. */
+  private _goalFor(ino: number, runs: ExtentRun[], lblk: number): number {
+    var i = this._findRun(runs, lblk) - 1;
+    if (i >= 0 && runs[i].pblk) return runs[i].pblk + (lblk - runs[i].lblk);
+    var sb = this._sb!;
+    return sb.firstDataBlock + Math.floor((ino - 1) / sb.inodesPerGroup) * sb.blocksPerGroup;
+  }
+
+  /** Allocate and map `count` blocks from logical block `lblk` on. */
+  private _allocRange(ino: number, raw: Uint8Array, lblk: number, count: number, goal: number): number {
+    var mb = this._mb();
+    while (count > 0) {
+      var ext = mb.alloc(goal, count);
+      if (!ext) return -28;   // ENOSPC
+      this._addBlocks(raw, ext.len);
+      var err = this._mapInsert(ino, raw, lblk, ext.len, ext.start);
+      if (err) return err;
+      lblk  += ext.len;
+      count -= ext.len;
+      goal   = ext.start + ext.len;
+    }
+    return 0;
+  }
+
+  /** Map [lblk, lblk + len) → [pblk, …) in the inode's extent tree or indirect map. */
+  private _mapInsert(ino: number, raw: Uint8Array, lblk: number, len: number, pblk: number): number {
+    this.stats.extents++;
+    this.invalidateCaches(ino);
+    if (rd32(raw, 32) & EXT4_EXTENTS_FL) {
+      while (len > 0) {
+        var n = Math.min(len, EXT_INIT_MAX_LEN);
+        var err = this._extInsert(ino, raw, lblk, n, pblk);
+        if (err) return err;
+        lblk += n; pblk += n; len -= n;
+      }
+      return 0;
+    }
+    for (var i = 0; i < len; i++) {
+      var e2 = this._indSet(ino, raw, lblk + i, pblk + i);
+      if (e2) return e2;
+    }
+    return 0;
+  }
+
+  // ── Extent tree update ──────────────────────────────────────────────────────
+
+  /** Root-to-leaf path towards `lblk`, nodes loaded for writing. */
+  private _extPath(raw: Uint8Array, lblk: number): ExtNode[] {
+    var path: ExtNode[] = [];
+    var node: ExtNode = { buf: raw, off: 40, blk: 0, idx: 0 };
+    for (var level = 0; level < 6; level++) {
+      path.push(node);
+      var depth = rd16(node.buf, node.off + 6);
+      var n = rd16(node.buf, node.off + 2);
+      if (depth === 0 || n === 0) break;
+      var idx = 0;
+      while (idx + 1 < n && rd32(node.buf, node.off + 12 + (idx + 1) * 12) <= lblk) idx++;
+      node.idx = idx;
+      var child = idxChild(node.buf, node.off + 12 + idx * 12);
+      node = { buf: this._metaWrite(child), off: 0, blk: child, idx: 0 };
+    }
+    return path;
+  }
+
+  private _extTouch(ino: number, node: ExtNode): void {
+    if (node.blk) this._extDirty.set(node.blk, ino);
   }
 
   /**
-   * [Item 179] Commit the current journal transaction.
-   * Writes all pending metadata blocks from the journal to their final locations.
+   * Insert the extent [lblk, lblk + len) → pblk (an unmapped range).  It is
+   * merged into a neighbouring extent when both are contiguous; otherwise a
+   * new entry is added, splitting full nodes and growing the tree's depth
+   * when the root in the inode is full.
+   */
+  private _extInsert(ino: number, raw: Uint8Array, lblk: number, len: number, pblk: number): number {
+    var path = this._extPath(raw, lblk);
+    var leaf = path[path.length - 1];
+    var b = leaf.buf, o = leaf.off;
+    var n = rd16(b, o + 2);
+    var pos = 0;
+    while (pos < n && rd32(b, o + 12 + pos * 12) <= lblk) pos++;
+    if (pos > 0) {
+      var pe = o + 12 + (pos - 1) * 12, plen = rd16(b, pe + 4);
+      if (plen <= EXT_INIT_MAX_LEN && plen + len <= EXT_INIT_MAX_LEN &&
+          rd32(b, pe) + plen === lblk && extStart(b, pe) + plen === pblk) {
+        wr16(b, pe + 4, plen + len);
+        this._extTouch(ino, leaf);
+        return 0;
+      }
+    }
+    if (pos < n) {
+      var ne = o + 12 + pos * 12, nlen = rd16(b, ne + 4);
+      if (nlen <= EXT_INIT_MAX_LEN && nlen + len <= EXT_INIT_MAX_LEN &&
+          lblk + len === rd32(b, ne) && pblk + len === extStart(b, ne)) {
+        wr32(b, ne, lblk);
+        wr16(b, ne + 4, nlen + len);
+        setExtStart(b, ne, pblk);
+        this._extTouch(ino, leaf);
+        if (pos === 0) this._extFixKeys(ino, path, path.length - 1);
+        return 0;
+      }
+    }
+    var rec = new Uint8Array(12);
+    wr32(rec, 0, lblk);
+    wr16(rec, 4, len);
+    setExtStart(rec, 0, pblk);
+    return this._extNodeInsert(ino, raw, path, path.length - 1, pos, rec);
+  }
+
+  /** Put `rec` at entry `pos` of a node that has room. */
+  private _extPut(node: ExtNode, pos: number, rec: Uint8Array): void {
+    var b = node.buf, o = node.off;
+    var n = rd16(b, o + 2);
+    var at = o + 12 + pos * 12;
+    b.copyWithin(at + 12, at, o + 12 + n * 12);
+    b.set(rec, at);
+    wr16(b, o + 2, n + 1);
+  }
+
+  private _extNodeInsert(ino: number, raw: Uint8Array, path: ExtNode[], level: number,
+                         pos: number, rec: Uint8Array): number {
+    var node = path[level];
+    var b = node.buf, o = node.off;
+    var n = rd16(b, o + 2), max = rd16(b, o + 4), depth = rd16(b, o + 6);
+    if (n < max) {
+      this._extPut(node, pos, rec);
+      this._extTouch(ino, node);
+      if (pos === 0) this._extFixKeys(ino, path, level);
+      return 0;
+    }
+    var sb = this._sb!;
+    var cap = ((sb.blockSize - 12) / 12) | 0;
+    var nb = this._allocMetaBlock(ino, raw);
+    if (!nb) return -28;
+    var nbuf = this._metaNew(nb);
+    wr16(nbuf, 0, EXTENT_HEADER_MAGIC);
+    wr16(nbuf, 4, cap);
+    wr16(nbuf, 6, depth);
+    var fresh: ExtNode = { buf: nbuf, off: 0, blk: nb, idx: node.idx };
+    this._extTouch(ino, fresh);
+
+    if (level === 0) {
+      // Root (in the inode) is full: its entries move to the new block, which
+      // becomes the root's only child, one level deeper.
+      nbuf.set(b.subarray(o + 12, o + 12 + n * 12), 12);
+      wr16(nbuf, 2, n);
+      b.fill(0, o + 12, o + 12 + max * 12);
+      wr16(b, o + 2, 1);
+      wr16(b, o + 6, depth + 1);
+      wr32(b, o + 12, rd32(nbuf, 12));            // ei_block
+      wr32(b, o + 16, nb % 0x100000000);          // ei_leaf_lo
+      wr16(b, o + 20, Math.floor(nb / 0x100000000));
+      node.idx = 0;
+      path.splice(1, 0, fresh);
+      return this._extNodeInsert(ino, raw, path, 1, pos, rec);
+    }
+
+    // Split: entries from `split` on move to the new right sibling.  An
+    // append (pos === n) moves nothing, so sequential growth leaves full
+    // nodes behind instead of half-empty ones.
+    var split = pos === n ? n : n >> 1;
+    var moved = n - split;
+    nbuf.set(b.subarray(o + 12 + split * 12, o + 12 + n * 12), 12);
+    wr16(nbuf, 2, moved);
+    b.fill(0, o + 12 + split * 12, o + 12 + n * 12);
+    wr16(b, o + 2, split);
+    this._extTouch(ino, node);
+    if (pos < split || (pos === split && split !== n)) {
+      this._extPut(node, pos, rec);
+      if (pos === 0) this._extFixKeys(ino, path, level);
+    } else {
+      this._extPut(fresh, pos - split, rec);
+    }
+    var irec = new Uint8Array(12);
+    wr32(irec, 0, rd32(nbuf, 12));
+    wr32(irec, 4, nb % 0x100000000);
+    wr16(irec, 8, Math.floor(nb / 0x100000000));
+    var parent = path[level - 1];
+    return this._extNodeInsert(ino, raw, path, level - 1, parent.idx + 1, irec);
+  }
+
+  /** The first key of path[level] changed: update index keys above it. */
+  private _extFixKeys(ino: number, path: ExtNode[], level: number): void {
+    for (var l = level; l > 0; l--) {
+      var node = path[l], parent = path[l - 1];
+      var first = rd32(node.buf, node.off + 12);
+      var pe = parent.off + 12 + parent.idx * 12;
+      if (rd32(parent.buf, pe) !== first) {
+        wr32(parent.buf, pe, first);
+        this._extTouch(ino, parent);
+      }
+      if (parent.idx !== 0) break;
+    }
+  }
+
+  /**
+   * Data is being written into the uninitialized extent holding `lblk`:
+   * zero its blocks on disk and mark it initialized.
+   */
+  private _extMarkInit(ino: number, raw: Uint8Array, lblk: number): number {
+    var path = this._extPath(raw, lblk);
+    var leaf = path[path.length - 1];
+    var b = leaf.buf, o = leaf.off;
+    var n = rd16(b, o + 2);
+    for (var i = 0; i < n; i++) {
+      var e = o + 12 + i * 12, len = rd16(b, e + 4);
+      if (len <= EXT_INIT_MAX_LEN) continue;
+      len -= EXT_INIT_MAX_LEN;
+      if (lblk < rd32(b, e) || lblk >= rd32(b, e) + len) continue;
+      var bs = this._sb!.blockSize;
+      var zero = new Uint8Array(Math.min(len, 64) * bs);
+      var start = extStart(b, e);
+      for (var z = 0; z < len; z += 64) {
+        var cnt = Math.min(64, len - z);
+        var err = this._writeRange((start + z) * bs, zero, 0, cnt * bs);
+        if (err < 0) return err;
+      }
+      wr16(b, e + 4, len);
+      this._extTouch(ino, leaf);
+      this.invalidateCaches(ino);
+      return 0;
+    }
+    return 0;
+  }
+
+  /**
+   * One block for tree metadata, counted in i_blocks.  The goal is the start
+   * of the inode's group rather than the end of its data, so index blocks
+   * fill small gaps instead of splitting the file's next extent.
+   */
+  private _allocMetaBlock(ino: number, raw: Uint8Array): number {
+    var ext = this._mb().alloc(this._goalFor(ino, [], 0), 1);
+    if (!ext) return 0;
+    this._addBlocks(raw, 1);
+    return ext.start;
+  }
+
+  /** ext2/3 indirect map: point logical block `lblk` at `pblk`, adding indirect blocks as needed. */
+  private _indSet(ino: number, raw: Uint8Array, lblk: number, pblk: number): number {
+    var ptrs = this._sb!.blockSize >>> 2;
+    if (lblk < EXT4_NDIR_BLOCKS) { wr32(raw, 40 + lblk * 4, pblk); return 0; }
+    var rel = lblk - EXT4_NDIR_BLOCKS, level = 1;
+    if (rel >= ptrs) { rel -= ptrs; level = 2; }
+    if (level === 2 && rel >= ptrs * ptrs) { rel -= ptrs * ptrs; level = 3; }
+    var holder = raw, hoff = 40 + (EXT4_NDIR_BLOCKS - 1 + level) * 4;
+    for (var l = level; l >= 1; l--) {
+      var ptr = rd32(holder, hoff);
+      if (!ptr) {
+        ptr = this._allocMetaBlock(ino, raw);
+        if (!ptr) return -28;
+        this._metaNew(ptr);
+        wr32(holder, hoff, ptr);
+      }
+      var span = Math.pow(ptrs, l - 1);
+      holder = this._metaWrite(ptr);
+      hoff = Math.floor(rel / span) * 4;
+      rel %= span;
+    }
+    wr32(holder, hoff, pblk);
+    return 0;
+  }
+
+  /**
+   * Free every block of the inode (data and mapping metadata) and empty its
+   * block map.  The blocks return to the allocator when the transaction
+   * commits, so nothing can overwrite them before the change is durable.
+   */
+  private _freeAllBlocks(ino: number, raw: Uint8Array): void {
+    var flags = rd32(raw, 32);
+    var ptrs = this._sb!.blockSize >>> 2;
+    var free = (start: number, len: number) => { if (start && len) this._pendingFree.push([start, len]); };
+    if (flags & EXT4_INLINE_DATA_FL) return;
+    if (flags & EXT4_EXTENTS_FL) {
+      var walk = (b: Uint8Array, o: number, level: number): void => {
+        if (rd16(b, o) !== EXTENT_HEADER_MAGIC || level > 5) return;
+        var n = rd16(b, o + 2), depth = rd16(b, o + 6);
+        for (var i = 0; i < n; i++) {
+          var e = o + 12 + i * 12;
+          if (depth > 0) {
+            var child = idxChild(b, e);
+            walk(this._metaRead(child), 0, level + 1);
+            this._forgetMeta(child);
+            free(child, 1);
+          } else {
+            var len = rd16(b, e + 4);
+            free(extStart(b, e), len > EXT_INIT_MAX_LEN ? len - EXT_INIT_MAX_LEN : len);
+          }
+        }
+      };
+      walk(raw, 40, 0);
+      raw.fill(0, 40, 100);
+      wr16(raw, 40, EXTENT_HEADER_MAGIC);
+      wr16(raw, 44, 4);
+    } else {
+      var walkInd = (blk: number, depth: number): void => {
+        if (!blk) return;
+        if (depth > 0) {
+          var b = this._metaRead(blk);
+          for (var i = 0; i < ptrs; i++) walkInd(rd32(b, i * 4), depth - 1);
+          this._forgetMeta(blk);
+        }
+        free(blk, 1);
+      };
+      for (var d = 0; d < EXT4_NDIR_BLOCKS; d++) free(rd32(raw, 40 + d * 4), 1);
+      for (var lv = 0; lv < 3; lv++) walkInd(rd32(raw, 40 + (EXT4_NDIR_BLOCKS + lv) * 4), lv + 1);
+      raw.fill(0, 40, 100);
+      // A file rebuilt from empty can use extents when the filesystem has them
+      if (this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_EXTENTS) {
+        wr32(raw, 32, flags | EXT4_EXTENTS_FL);
+        wr16(raw, 40, EXTENT_HEADER_MAGIC);
+        wr16(raw, 44, 4);
+      }
+    }
+    wr32(raw, 28, 0);
+    wr16(raw, 0x74, 0);
+    this.invalidateCaches(ino);
+  }
+
+  /** Truncate to zero length: drop buffered pages and free all blocks. */
+  private _truncateAll(ino: number, raw: Uint8Array): void {
+    var df = this._dirty.get(ino);
+    if (df) {
+      this._dirtyBytes -= df.pages.size * this._sb!.blockSize;
+      this._dirty.delete(ino);
+    }
+    this._freeAllBlocks(ino, raw);
+    this._setRawSize(raw, 0);
+    this._touch(raw);
+  }
+
+  // ── Block and inode allocation ──────────────────────────────────────────────
+
+  private _mb(): MbAllocator {
+    if (this._mballoc) return this._mballoc;
+    var sb = this._sb!;
+    return this._mballoc = new MbAllocator({
+      groupCount:     sb.groupCount,
+      blocksPerGroup: sb.blocksPerGroup,
+      firstDataBlock: sb.firstDataBlock,
+      blocksCount:    sb.blocksCount,
+      bitmap:    (g: number) => this._blockBitmap(g),
+      freeCount: (g: number) => this._groups[g].freeBlocksCount,
+      changed:   (g: number, delta: number) => {
+        var gd = this._groups[g];
+        gd.freeBlocksCount += delta;
+        gd.flags &= ~EXT4_BG_BLOCK_UNINIT;
+        this._dirtyBbm.add(g);
+        this._dirtyGroups.add(g);
+      },
+    });
+  }
+
+  /** Does group `g` hold a superblock backup (and so a GDT copy)? */
+  private _groupHasSuper(g: number): boolean {
+    if (g <= 1 || !(this._sb!.featuresRoCompat & EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER)) return true;
+    for (var base = 3; base <= 7; base += 2) {
+      var p = base;
+      while (p < g) p *= base;
+      if (p === g) return true;
+    }
+    return false;
+  }
+
+  /** Live block bitmap of group `g`, built in memory for BLOCK_UNINIT groups. */
+  private _blockBitmap(g: number): Uint8Array {
+    var bm = this._bbm.get(g);
+    if (bm) return bm;
+    var sb = this._sb!, gd = this._groups[g];
+    if (gd.flags & EXT4_BG_BLOCK_UNINIT) {
+      // Never written: everything is free except the group's own metadata
+      bm = new Uint8Array(sb.blockSize);
+      var start = sb.firstDataBlock + g * sb.blocksPerGroup;
+      var n = Math.min(sb.blocksPerGroup, sb.blocksCount - start);
+      var mark = (b: number, count: number) => {
+        for (var i = 0; i < count; i++) {
+          var rel = b + i - start;
+          if (rel >= 0 && rel < n) bm![rel >> 3] |= 1 << (rel & 7);
+        }
+      };
+      if (this._groupHasSuper(g)) {
+        mark(start, 1 + Math.ceil(sb.groupCount * sb.groupDescSize / sb.blockSize) + sb.reservedGdtBlocks);
+      }
+      var itBlocks = Math.ceil(sb.inodesPerGroup * sb.inodeSize / sb.blockSize);
+      for (var h = 0; h < this._groups.length; h++) {
+        var hd = this._groups[h];
+        mark(hd.blockBitmap, 1);
+        mark(hd.inodeBitmap, 1);
+        mark(hd.inodeTable, itBlocks);
+      }
+      for (var pad = n; pad < sb.blockSize * 8; pad++) bm[pad >> 3] |= 1 << (pad & 7);
+    } else {
+      bm = this._metaRead(gd.blockBitmap).slice();
+    }
+    this._bbm.set(g, bm);
+    return bm;
+  }
+
+  private _inodeBitmap(g: number): Uint8Array {
+    var bm = this._ibm.get(g);
+    if (bm) return bm;
+    var sb = this._sb!, gd = this._groups[g];
+    if (gd.flags & EXT4_BG_INODE_UNINIT) {
+      bm = new Uint8Array(sb.blockSize);
+      for (var pad = sb.inodesPerGroup; pad < sb.blockSize * 8; pad++) bm[pad >> 3] |= 1 << (pad & 7);
+    } else {
+      bm = this._metaRead(gd.inodeBitmap).slice();
+    }
+    this._ibm.set(g, bm);
+    return bm;
+  }
+
+  /**
+   * Allocate an inode: files next to their parent directory, directories in
+   * the group with the most free inodes (a simplified Orlov spread).
+   */
+  private _allocInode(parent: number, isDir: boolean): number {
+    var sb = this._sb!;
+    var ipg = sb.inodesPerGroup;
+    var start = Math.floor((parent - 1) / ipg);
+    if (isDir) {
+      for (var c = 0; c < this._groups.length; c++) {
+        if (this._groups[c].freeInodesCount > this._groups[start].freeInodesCount) start = c;
+      }
+    }
+    for (var step = 0; step < this._groups.length; step++) {
+      var g = (start + step) % this._groups.length;
+      var gd = this._groups[g];
+      if (gd.freeInodesCount === 0) continue;
+      var bm = this._inodeBitmap(g);
+      for (var i = 0; i < ipg; i++) {
+        var ino = g * ipg + i + 1;
+        if (ino < sb.firstIno || (bm[i >> 3] & (1 << (i & 7)))) continue;
+        bm[i >> 3] |= 1 << (i & 7);
+        gd.freeInodesCount--;
+        if (isDir) gd.usedDirsCount++;
+        gd.flags &= ~EXT4_BG_INODE_UNINIT;
+        if ((this._metaCsum || this._gdtCsum) && i >= ipg - gd.itableUnused) gd.itableUnused = ipg - i - 1;
+        this._dirtyIbm.add(g);
+        this._dirtyGroups.add(g);
+        return ino;
+      }
+    }
+    return 0;
+  }
+
+  private _freeInode(ino: number, isDir: boolean): void {
+    var ipg = this._sb!.inodesPerGroup;
+    var g = Math.floor((ino - 1) / ipg), i = (ino - 1) % ipg;
+    var bm = this._inodeBitmap(g);
+    if (!(bm[i >> 3] & (1 << (i & 7)))) return;
+    bm[i >> 3] &= ~(1 << (i & 7));
+    var gd = this._groups[g];
+    gd.freeInodesCount++;
+    if (isDir) gd.usedDirsCount--;
+    this._dirtyIbm.add(g);
+    this._dirtyGroups.add(g);
+  }
+
+  /** Fresh inode bytes: no blocks, extent root when the fs supports extents. */
+  private _newInodeRaw(mode: number, links: number): Uint8Array {
+    var sb = this._sb!;
+    var raw = new Uint8Array(sb.inodeSize);
+    var t = nowSec();
+    wr16(raw, 0, mode);
+    wr32(raw, 8, t); wr32(raw, 12, t); wr32(raw, 16, t);
+    wr16(raw, 26, links);
+    wr32(raw, 0x64, (Math.random() * 0x100000000) >>> 0);   // i_generation
+    if (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_EXTENTS) {
+      wr32(raw, 32, EXT4_EXTENTS_FL);
+      wr16(raw, 40, EXTENT_HEADER_MAGIC);
+      wr16(raw, 44, 4);
+    }
+    if (sb.inodeSize > 128) {
+      var extra = Math.min(32, sb.inodeSize - 128);
+      wr16(raw, 0x80, extra);
+      if (extra >= 0x14) wr32(raw, 0x90, t);                  // i_crtime
+    }
+    return raw;
+  }
+
+  // ── Directory update ────────────────────────────────────────────────────────
+
+  private _dirTailLen(): number { return this._metaCsum ? 12 : 0; }
+
+  private _putDirent(b: Uint8Array, off: number, ino: number, recLen: number, name: Uint8Array, type: number): void {
+    wr32(b, off, ino);
+    wr16(b, off + 4, recLen);
+    if (this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) {
+      b[off + 6] = name.length;
+      b[off + 7] = type;
+    } else {
+      wr16(b, off + 6, name.length);
+    }
+    b.set(name, off + 8);
+  }
+
+  /**
+   * Add `name` → `ino` to directory `dir`.  Indexed directories insert into
+   * the leaf for the name's hash; linear ones take the first gap that fits,
+   * else a new block — or, when a one-block directory is full and the
+   * filesystem has dir_index, it is converted to an indexed one first.
+   */
+  private _dirAdd(dir: number, name: Uint8Array, ino: number, type: number): number {
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    var draw = this._inodeRaw(dir);
+    if (!draw) return -2;
+    if (this._dxIndexed(rd32(draw, 32))) return this._dxAdd(dir, draw, name, ino, type, 0);
+    var need = (8 + name.length + 3) & ~3;
+    var limit = bs - this._dirTailLen();
+    var slot: { blk: number; off: number; used: number } | null = null;
+    this._dirWalk(dir, function(blk, buf, off, _prev, eIno, nameLen, recLen) {
+      if (off >= limit) return false;                  // checksum tail
+      var used = eIno ? (8 + nameLen + 3) & ~3 : 0;
+      if (recLen - used >= need) { slot = { blk: blk, off: off, used: used }; return true; }
+      return false;
+    });
+    var s = slot as { blk: number; off: number; used: number } | null;
+    if (s) {
+      var b = this._metaWrite(s.blk);
+      var off = s.off, recLen = rd16(b, off + 4);
+      if (s.used) { wr16(b, off + 4, s.used); off += s.used; recLen -= s.used; }
+      this._putDirent(b, off, ino, recLen, name, type);
+      this._dirDirty.set(s.blk, dir);
+    } else if (this._rawSize(draw) === bs && (sb.featuresCompat & EXT2_FEATURE_COMPAT_DIR_INDEX) && this._dxConvert(dir, draw)) {
+      return this._dxAdd(dir, draw, name, ino, type, 0);
+    } else {
+      // Directory is full: append a block
+      var nb = this._dirAppendBlock(dir, draw);
+      if (typeof nb === 'number') return nb;
+      this._putDirent(nb.buf, 0, ino, limit, name, type);
+      this._dirDirty.set(nb.blk, dir);
+    }
+    this._touch(draw);
+    this._putInode(dir, draw);
+    return 0;
+  }
+
+  /** Allocate a new last block for directory `dir` (dirent tail included). */
+  private _dirAppendBlock(dir: number, draw: Uint8Array): { lblk: number; blk: number; buf: Uint8Array } | number {
+    var bs = this._sb!.blockSize;
+    var lblk = Math.ceil(this._rawSize(draw) / bs);
+    this._setRawSize(draw, (lblk + 1) * bs);
+    var err = this._allocRange(dir, draw, lblk, 1, this._goalFor(dir, this._reloadRuns(dir, draw), lblk));
+    if (err) return err;
+    var blk = this._bmap(dir, parseInode(draw, 0, this._sb!.inodeSize), lblk);
+    var buf = this._metaNew(blk);
+    wr16(buf, 4, bs - this._dirTailLen());    // one empty entry spanning the block
+    this._initDirTail(buf);
+    return { lblk: lblk, blk: blk, buf: buf };
+  }
+
+  /** Live entries of directory block `b` (copied), skipping "." / ".." when asked. */
+  private _blockEntries(b: Uint8Array, skipDots: boolean): Array<{ bytes: Uint8Array; nameLen: number }> {
+    var bs = this._sb!.blockSize;
+    var ftype = (this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
+    var out: Array<{ bytes: Uint8Array; nameLen: number }> = [];
+    for (var off = 0; off + 8 <= bs; ) {
+      var recLen = rd16(b, off + 4);
+      if (recLen < 8 || off + recLen > bs) break;
+      var nameLen = ftype ? b[off + 6] : rd16(b, off + 6);
+      var dot = nameLen <= 2 && b[off + 8] === 0x2e && (nameLen === 1 || b[off + 9] === 0x2e);
+      if (rd32(b, off) && nameLen && !(skipDots && dot)) {
+        out.push({ bytes: b.slice(off, off + 8 + nameLen), nameLen: nameLen });
+      }
+      off += recLen;
+    }
+    return out;
+  }
+
+  /** Rewrite directory block `b` to hold exactly `entries`, packed from offset 0. */
+  private _fillBlock(b: Uint8Array, entries: Array<{ bytes: Uint8Array; nameLen: number }>): void {
+    var end = b.length - this._dirTailLen();
+    b.fill(0);
+    var off = 0, last = -1;
+    for (var i = 0; i < entries.length; i++) {
+      var len = (8 + entries[i].nameLen + 3) & ~3;
+      b.set(entries[i].bytes, off);
+      wr16(b, off + 4, len);
+      last = off;
+      off += len;
+    }
+    if (last >= 0) wr16(b, last + 4, end - last);
+    else wr16(b, 4, end);
+    this._initDirTail(b);
+  }
+
+  /** Put `name` into directory block `blk` if it has room. */
+  private _leafInsert(dir: number, blk: number, name: Uint8Array, ino: number, type: number): boolean {
+    var bs = this._sb!.blockSize;
+    var ftype = (this._sb!.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
+    var need = (8 + name.length + 3) & ~3;
+    var limit = bs - this._dirTailLen();
+    var b = this._metaRead(blk);
+    for (var off = 0; off + 8 <= limit; ) {
+      var recLen = rd16(b, off + 4);
+      if (recLen < 8 || off + recLen > bs) return false;
+      var used = rd32(b, off) ? (8 + (ftype ? b[off + 6] : rd16(b, off + 6)) + 3) & ~3 : 0;
+      if (recLen - used >= need) {
+        b = this._metaWrite(blk);
+        if (used) { wr16(b, off + 4, used); off += used; recLen -= used; }
+        this._putDirent(b, off, ino, recLen, name, type);
+        this._dirDirty.set(blk, dir);
+        return true;
+      }
+      off += recLen;
+    }
+    return false;
+  }
+
+  /**
+   * Turn the full one-block directory `dir` into an indexed one: its entries
+   * move to a new leaf (block 1) and block 0 becomes the dx_root with a
+   * single index entry.  The caller's insert then splits the leaf.
+   */
+  private _dxConvert(dir: number, draw: Uint8Array): boolean {
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    var rootBlk = this._bmap(dir, parseInode(draw, 0, sb.inodeSize), 0);
+    var old = this._metaRead(rootBlk);
+    var ftype = (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_FILETYPE) !== 0;
+    // "." must be a 12-byte entry followed by ".."
+    if (rd16(old, 4) !== 12 || (ftype ? old[18] : rd16(old, 18)) !== 2) return false;
+    var entries = this._blockEntries(old, true);
+    var leaf = this._dirAppendBlock(dir, draw);
+    if (typeof leaf === 'number') return false;
+    this._fillBlock(leaf.buf, entries);
+    this._dirDirty.set(leaf.blk, dir);
+
+    var rb = this._metaWrite(rootBlk);
+    rb.fill(0, 24);
+    wr16(rb, 12 + 4, bs - 12);                  // ".." spans the block
+    wr32(rb, DX_ROOT_INFO, 0);
+    rb[DX_ROOT_INFO + 4] = this._dxInfo!.defVer <= 2 ? this._dxInfo!.defVer : 1;
+    rb[DX_ROOT_INFO + 5] = 8;                   // info_length
+    rb[DX_ROOT_INFO + 6] = 0;                   // indirect_levels
+    dxInitEntries(rb, DX_ROOT_INFO + 8, dxRootLimit(bs, this._metaCsum), leaf.lblk);
+    this._dirDirty.delete(rootBlk);
+    this._dxTouch(rootBlk, dir, DX_ROOT_INFO + 8);
+    wr32(draw, 32, rd32(draw, 32) | EXT4_INDEX_FL);
+    this.invalidateCaches(dir);
+    return true;
+  }
+
+  /**
+   * Insert into indexed directory `dir`.  A full leaf is split in two by
+   * hash order (the upper half moves to a new block) and the new block is
+   * added to the lowest index node; a full index node is split, or when the
+   * root is full, the tree grows one level.
+   */
+  private _dxAdd(dir: number, draw: Uint8Array, name: Uint8Array, ino: number, type: number, depth: number): number {
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    var inode = parseInode(draw, 0, sb.inodeSize);
+    var path = this._dxProbe(dir, inode, name);
+    if (!path) return -5;                       // EIO: corrupt index
+    var fr = path.frames;
+    var f = fr[fr.length - 1];
+    var leafBlk = this._bmap(dir, inode, f.node.blocks[f.at]);
+    if (!leafBlk) return -5;
+    if (this._leafInsert(dir, leafBlk, name, ino, type)) {
+      this._touch(draw);
+      this._putInode(dir, draw);
+      return 0;
+    }
+    if (depth > 2) return -28;
+    if (f.node.hashes.length >= f.node.limit) {
+      var err = this._dxMakeRoom(dir, draw, fr);
+      return err || this._dxAdd(dir, draw, name, ino, type, depth + 1);
+    }
+
+    // Split the leaf by hash order
+    var version = dxEffectiveVersion(this._dxInfo!, this._metaRead(fr[0].blk)[DX_ROOT_INFO + 4]);
+    var seed = this._dxInfo!.seed;
+    var entries = this._blockEntries(this._metaRead(leafBlk), false).map(function(e) {
+      return { e: e, hash: dxHash(e.bytes, 8, e.nameLen, version, seed) };
+    });
+    entries.sort(function(a, b) { return a.hash - b.hash; });
+    var total = 0, half = 0, split = entries.length - 1;
+    for (var i = 0; i < entries.length; i++) total += (8 + entries[i].e.nameLen + 3) & ~3;
+    for (var k = 0; k < entries.length; k++) {
+      half += (8 + entries[k].e.nameLen + 3) & ~3;
+      if (half > total / 2) { split = Math.max(1, k); break; }
+    }
+    if (entries.length < 2) return -28;
+    var hash2 = entries[split].hash;
+    var continued = entries[split - 1].hash === hash2 ? 1 : 0;
+    var nb = this._dirAppendBlock(dir, draw);
+    if (typeof nb === 'number') return nb;
+    this._fillBlock(this._metaWrite(leafBlk), entries.slice(0, split).map(function(x) { return x.e; }));
+    this._fillBlock(nb.buf, entries.slice(split).map(function(x) { return x.e; }));
+    this._dirDirty.set(leafBlk, dir);
+    this._dirDirty.set(nb.blk, dir);
+    var ib = this._metaWrite(f.blk);
+    dxInsertEntry(ib, f.node.countOff, f.at + 1, hash2 + continued, nb.lblk);
+    this._dxTouch(f.blk, dir, f.node.countOff);
+    var target = path.hash >= hash2 ? nb.blk : leafBlk;
+    if (!this._leafInsert(dir, target, name, ino, type)) return -28;
+    this._touch(draw);
+    this._putInode(dir, draw);
+    return 0;
+  }
+
+  /**
+   * The lowest index block on `fr` is full.  Split it into a new node whose
+   * entry goes into its parent; a full root instead moves all its entries
+   * into a new node one level down (the tree grows by one level).
+   * Returns ENOSPC when the index has reached its maximum depth.
+   */
+  private _dxMakeRoom(dir: number, draw: Uint8Array, fr: DxFrame[]): number {
+    var bs = this._sb!.blockSize;
+    var csum = this._metaCsum;
+    var level = fr.length - 1;
+    if (level > 0 && fr[level - 1].node.hashes.length < fr[level - 1].node.limit) {
+      // Split node fr[level]: its upper half moves to a new node
+      var f = fr[level], parent = fr[level - 1];
+      var count = f.node.hashes.length, half = count >> 1;
+      var nb = this._dirAppendBlock(dir, draw);
+      if (typeof nb === 'number') return nb;
+      var nbuf = nb.buf;
+      nbuf.fill(0);
+      wr16(nbuf, 4, bs);                        // fake dirent spanning the block
+      var src = this._metaWrite(f.blk);
+      nbuf.set(src.subarray(f.node.countOff + half * 8, f.node.countOff + count * 8), 8);
+      wr16(nbuf, 8, dxNodeLimit(bs, csum));
+      wr16(nbuf, 10, count - half);
+      wr16(src, f.node.countOff + 2, half);
+      src.fill(0, f.node.countOff + half * 8, f.node.countOff + count * 8);
+      this._dxTouch(f.blk, dir, f.node.countOff);
+      this._dxTouch(nb.blk, dir, 8);
+      this._dirDirty.delete(nb.blk);
+      var pb = this._metaWrite(parent.blk);
+      dxInsertEntry(pb, parent.node.countOff, parent.at + 1, f.node.hashes[half], nb.lblk);
+      this._dxTouch(parent.blk, dir, parent.node.countOff);
+      return 0;
+    }
+    // Grow: root entries move into a new node below the root
+    var rootBlk = fr[0].blk;
+    var rb = this._metaWrite(rootBlk);
+    var levels = rb[DX_ROOT_INFO + 6];
+    if (levels + 1 >= this._dxMaxLevels()) return -28;   // index full
+    var rootOff = fr[0].node.countOff, rootCount = fr[0].node.hashes.length;
+    var gb = this._dirAppendBlock(dir, draw);
+    if (typeof gb === 'number') return gb;
+    var gbuf = gb.buf;
+    gbuf.fill(0);
+    wr16(gbuf, 4, bs);
+    gbuf.set(rb.subarray(rootOff, rootOff + rootCount * 8), 8);
+    wr16(gbuf, 8, dxNodeLimit(bs, csum));
+    wr16(gbuf, 10, rootCount);
+    rb.fill(0, rootOff, rootOff + rootCount * 8);
+    dxInitEntries(rb, rootOff, dxRootLimit(bs, csum), gb.lblk);
+    rb[DX_ROOT_INFO + 6] = levels + 1;
+    this._dirDirty.delete(gb.blk);
+    this._dxTouch(gb.blk, dir, 8);
+    this._dxTouch(rootBlk, dir, rootOff);
+    return 0;
+  }
+
+  private _initDirTail(b: Uint8Array): void {
+    if (!this._metaCsum) return;
+    var t = b.length - 12;
+    wr32(b, t, 0);
+    wr16(b, t + 4, 12);
+    b[t + 6] = 0;
+    b[t + 7] = EXT4_DIRENT_TAIL_FT;
+  }
+
+  /** Remove the entry `name` from `dir`; returns its inode or a negative errno. */
+  private _dirRemove(dir: number, name: Uint8Array): number {
+    var draw = this._inodeRaw(dir);
+    if (!draw) return -2;
+    var h = this._dirFind(dir, name);
+    if (!h) return -2;
+    var b = this._metaWrite(h.blk);
+    if (h.prev >= 0) wr16(b, h.prev + 4, rd16(b, h.prev + 4) + rd16(b, h.off + 4));
+    else wr32(b, h.off, 0);
+    this._dirDirty.set(h.blk, dir);
+    this._touch(draw);
+    this._putInode(dir, draw);
+    return h.ino;
+  }
+
+  /** Parent directory inode and encoded leaf name of `path`. */
+  private _splitPath(path: string): { dir: number; name: Uint8Array } | number {
+    var parts = path.replace(/^\//, '').split('/').filter(function(p) { return p.length > 0; });
+    if (parts.length === 0) return -22;                  // EINVAL: the root
+    var name = utf8Encode(parts.pop()!);
+    if (name.length > 255) return -36;                   // ENAMETOOLONG
+    var dir = this._resolvePathIno('/' + parts.join('/'));
+    if (!dir) return -2;
+    var dinode = this._readInode(dir);
+    if (!dinode || (dinode.mode & 0xf000) !== 0x4000) return -20;   // ENOTDIR
+    return { dir: dir, name: name.slice() };
+  }
+
+  // ── Namespace operations ────────────────────────────────────────────────────
+
+  /** Create an empty regular file.  Returns its inode or a negative errno. */
+  create(path: string, mode: number = 0o644): number {
+    var err = this._writable(); if (err) return err;
+    var sp = this._splitPath(path);
+    if (typeof sp === 'number') return sp;
+    if (this._dirLookup(sp.dir, utf8Decode(sp.name))) return -17;    // EEXIST
+    var ino = this._allocInode(sp.dir, false);
+    if (!ino) return -28;
+    this._putInode(ino, this._newInodeRaw(0x8000 | (mode & 0xfff), 1));
+    err = this._dirAdd(sp.dir, sp.name, ino, EXT4_FT_REG);
+    if (err) return err;
+    err = this._maybeCommit();
+    return err || ino;
+  }
+
+  /** Create a directory.  Returns its inode or a negative errno. */
+  mkdirAt(path: string, mode: number = 0o755): number {
+    var err = this._writable(); if (err) return err;
+    var sb = this._sb!;
+    var sp = this._splitPath(path);
+    if (typeof sp === 'number') return sp;
+    if (this._dirLookup(sp.dir, utf8Decode(sp.name))) return -17;
+    var ino = this._allocInode(sp.dir, true);
+    if (!ino) return -28;
+    var raw = this._newInodeRaw(0x4000 | (mode & 0xfff), 2);
+    this._setRawSize(raw, sb.blockSize);
+    this._putInode(ino, raw);                  // mapping code reads it back
+    err = this._allocRange(ino, raw, 0, 1, this._goalFor(sp.dir, [], 0));
+    if (err) return err;
+    var pblk = this._bmap(ino, parseInode(raw, 0, sb.inodeSize), 0);
+    var b = this._metaNew(pblk);
+    var dot = new Uint8Array([0x2e]), dotdot = new Uint8Array([0x2e, 0x2e]);
+    this._putDirent(b, 0, ino, 12, dot, EXT4_FT_DIR);
+    this._putDirent(b, 12, sp.dir, sb.blockSize - this._dirTailLen() - 12, dotdot, EXT4_FT_DIR);
+    this._initDirTail(b);
+    this._dirDirty.set(pblk, ino);
+    this._putInode(ino, raw);
+    err = this._dirAdd(sp.dir, sp.name, ino, EXT4_FT_DIR);
+    if (err) return err;
+    var praw = this._inodeRaw(sp.dir)!;
+    wr16(praw, 26, rd16(praw, 26) + 1);        // '..' links back to the parent
+    this._putInode(sp.dir, praw);
+    err = this._maybeCommit();
+    return err || ino;
+  }
+
+  /** Remove a file, or an empty directory.  Returns 0 or a negative errno. */
+  unlink(path: string): number {
+    var err = this._writable(); if (err) return err;
+    var sp = this._splitPath(path);
+    if (typeof sp === 'number') return sp;
+    var ino = this._dirLookup(sp.dir, utf8Decode(sp.name));
+    if (!ino) return -2;
+    var raw = this._inodeRaw(ino)!;
+    var isDir = (rd16(raw, 0) & 0xf000) === 0x4000;
+    if (isDir && this._readDir(ino).length) return -39;        // ENOTEMPTY
+    var r = this._dirRemove(sp.dir, sp.name);
+    if (r < 0) return r;
+    var links = rd16(raw, 26);
+    if (isDir || links <= 1) {
+      this._truncateAll(ino, raw);
+      wr16(raw, 26, 0);
+      wr32(raw, 20, nowSec());                                 // i_dtime
+      this._putInode(ino, raw);
+      this._freeInode(ino, isDir);
+      if (isDir) {
+        var praw = this._inodeRaw(sp.dir)!;
+        wr16(praw, 26, Math.max(2, rd16(praw, 26) - 1));
+        this._putInode(sp.dir, praw);
+      }
+    } else {
+      wr16(raw, 26, links - 1);
+      this._touch(raw);
+      this._putInode(ino, raw);
+    }
+    return this._maybeCommit();
+  }
+
+  /** Truncate `ino` to zero bytes.  Returns 0 or a negative errno. */
+  truncate(ino: number): number {
+    var err = this._writable(); if (err) return err;
+    var raw = this._inodeRaw(ino);
+    if (!raw) return -2;
+    this._truncateAll(ino, raw);
+    this._putInode(ino, raw);
+    return this._maybeCommit();
+  }
+
+  /** Write `data` to `path` (created if missing), replacing or appending. */
+  write(path: string, data: Uint8Array, append: boolean): number {
+    var err = this._writable(); if (err) return err;
+    var ino = this._resolvePathIno(path);
+    if (!ino) {
+      ino = this.create(path);
+      if (ino < 0) return ino;
+    }
+    var inode = this._readInode(ino)!;
+    if ((inode.mode & 0xf000) !== 0x8000) return -21;
+    var offset = 0;
+    if (append) offset = this._fileSize(ino, inode);
+    else if (this._fileSize(ino, inode) > 0) {
+      err = this.truncate(ino);
+      if (err) return err;
+    }
+    return this.writeInodeData(ino, offset, data);
+  }
+
+  // ── Commit ──────────────────────────────────────────────────────────────────
+
+  /** Commit the running transaction once it is large or old enough (group commit). */
+  private _maybeCommit(): number {
+    var j = this._journal;
+    if (!j || j.size === 0) return 0;
+    if (j.size >= j.capacity() / 2 || Date.now() - j.started >= JBD2_COMMIT_INTERVAL_MS) return this._commit();
+    return 0;
+  }
+
+  /**
+   * Finish the running transaction: release blocks freed in it, store group
+   * descriptors, bitmaps and the superblock with fresh checksums, fill in the
+   * extent / directory block checksums, then log, commit and checkpoint.
+   */
+  private _commit(): number {
+    var j = this._journal;
+    if (!j) return 0;
+    var sb = this._sb!;
+    var bs = sb.blockSize;
+    if (this._pendingFree.length) {
+      var mb = this._mb();
+      for (var f = 0; f < this._pendingFree.length; f++) mb.free(this._pendingFree[f][0], this._pendingFree[f][1]);
+      this._pendingFree = [];
+    }
+    if (j.size === 0 && this._dirtyGroups.size === 0) return 0;
+
+    this._dirtyBbm.forEach((g) => {
+      var bm = this._bbm.get(g)!;
+      this._metaNew(this._groups[g].blockBitmap).set(bm);
+    });
+    this._dirtyIbm.forEach((g) => {
+      var bm = this._ibm.get(g)!;
+      this._metaNew(this._groups[g].inodeBitmap).set(bm);
+    });
+    this._dirtyGroups.forEach((g) => this._storeGroup(g));
+    this._dirtyBbm.clear();
+    this._dirtyIbm.clear();
+    this._dirtyGroups.clear();
+
+    if (this._metaCsum) {
+      this._extDirty.forEach((ino, blk) => {
+        var b = j!.get(blk), raw = this._inodeRaw(ino);
+        if (!b || !raw || rd16(b, 0) !== EXTENT_HEADER_MAGIC) return;
+        var tail = 12 + 12 * rd16(b, 4);
+        if (tail + 4 <= bs) wr32(b, tail, crc32c(this._inodeSeed(ino, raw), b, 0, tail));
+      });
+      this._dirDirty.forEach((ino, blk) => {
+        var b = j!.get(blk), raw = this._inodeRaw(ino);
+        if (!b || !raw) return;
+        var t = bs - 12;
+        if (rd32(b, t) !== 0 || rd16(b, t + 4) !== 12 || b[t + 7] !== EXT4_DIRENT_TAIL_FT) return;
+        wr32(b, bs - 4, crc32c(this._inodeSeed(ino, raw), b, 0, t));
+      });
+    }
+    if (this._metaCsum) {
+      var zero4 = new Uint8Array(4);
+      this._dxDirty.forEach((v, blk) => {
+        var b = j!.get(blk), raw = this._inodeRaw(v[0]);
+        if (!b || !raw) return;
+        var co = v[1], limit = rd16(b, co), count = rd16(b, co + 2);
+        var tail = co + limit * 8;
+        if (tail + DX_TAIL_SIZE > bs) return;
+        var c = crc32c(this._inodeSeed(v[0], raw), b, 0, co + count * 8);
+        c = crc32c(c, b, tail, 4);              // dt_reserved
+        wr32(b, tail + 4, crc32c(c, zero4, 0, 4));
+      });
+    }
+    this._extDirty.clear();
+    this._dirDirty.clear();
+    this._dxDirty.clear();
+
+    // Superblock: free counts, write time, the needs-recovery flag while the
+    // log may hold transactions, checksum.
+    var s = this._sbRaw;
+    var freeBlocks = 0, freeInodes = 0;
+    for (var g = 0; g < this._groups.length; g++) {
+      freeBlocks += this._groups[g].freeBlocksCount;
+      freeInodes += this._groups[g].freeInodesCount;
+    }
+    wr32(s, 0x0c, freeBlocks % 0x100000000);
+    if (sb.featuresIncompat & EXT4_FEATURE_INCOMPAT_64BIT) wr32(s, 0x158, Math.floor(freeBlocks / 0x100000000));
+    wr32(s, 0x10, freeInodes);
+    wr32(s, 0x30, nowSec());
+    var firstLog = j.hasLog && !(rd32(s, 0x60) & EXT4_FEATURE_INCOMPAT_RECOVER);
+    if (j.hasLog) wr32(s, 0x60, rd32(s, 0x60) | EXT4_FEATURE_INCOMPAT_RECOVER);
+    this._sbChecksum();
+    if (firstLog) {
+      // Must be on disk before the first log write, or a mount would wipe the log
+      var err0 = this._writeSuperHome();
+      if (err0) return err0;
+    }
+    var sbBlk = Math.floor(SUPERBLOCK_OFFSET / bs);
+    this._metaWrite(sbBlk).set(s, SUPERBLOCK_OFFSET % bs);
+
+    this.stats.commits++;
+    return j.commit();
+  }
+
+  private _sbChecksum(): void {
+    if (this._metaCsum) wr32(this._sbRaw, 0x3fc, crc32c(0xffffffff, this._sbRaw, 0, 0x3fc));
+  }
+
+  private _writeSuperHome(): number {
+    var bs = this._sb!.blockSize;
+    var sbBlk = Math.floor(SUPERBLOCK_OFFSET / bs);
+    var b = this._metaRead(sbBlk).slice();
+    b.set(this._sbRaw, SUPERBLOCK_OFFSET % bs);
+    var err = this._writeBlock(sbBlk, b);
+    if (!err) this._cacheBlock(sbBlk, b);
+    return err;
+  }
+
+  /** Serialize group descriptor `g` into the GDT block with its checksum. */
+  private _storeGroup(g: number): void {
+    var sb = this._sb!;
+    var ds = sb.groupDescSize, bs = sb.blockSize;
+    var gd = this._groups[g];
+    var blk = sb.firstDataBlock + 1 + Math.floor(g * ds / bs);
+    var b = this._metaWrite(blk);
+    var o = (g * ds) % bs;
+    var hi = ds >= 64;
+    wr16(b, o + 0x0c, gd.freeBlocksCount & 0xffff);
+    wr16(b, o + 0x0e, gd.freeInodesCount & 0xffff);
+    wr16(b, o + 0x10, gd.usedDirsCount & 0xffff);
+    wr16(b, o + 0x12, gd.flags);
+    wr16(b, o + 0x1c, gd.itableUnused & 0xffff);
+    if (hi) {
+      wr16(b, o + 0x2c, Math.floor(gd.freeBlocksCount / 0x10000));
+      wr16(b, o + 0x2e, Math.floor(gd.freeInodesCount / 0x10000));
+      wr16(b, o + 0x30, Math.floor(gd.usedDirsCount / 0x10000));
+      wr16(b, o + 0x32, Math.floor(gd.itableUnused / 0x10000));
+    }
+    if (this._metaCsum) {
+      var bb = this._bbm.get(g);
+      if (bb) {
+        var cb = crc32c(this._csumSeed, bb, 0, sb.blocksPerGroup >> 3);
+        wr16(b, o + 0x18, cb & 0xffff);
+        if (hi) wr16(b, o + 0x38, cb >>> 16);
+      }
+      var ib = this._ibm.get(g);
+      if (ib) {
+        var ci = crc32c(this._csumSeed, ib, 0, sb.inodesPerGroup >> 3);
+        wr16(b, o + 0x1a, ci & 0xffff);
+        if (hi) wr16(b, o + 0x3a, ci >>> 16);
+      }
+      wr16(b, o + 0x1e, 0);
+      var c = crc32c(crc32cU32(this._csumSeed, g), b, o, ds);
+      wr16(b, o + 0x1e, c & 0xffff);
+    } else if (this._gdtCsum) {
+      var le = new Uint8Array(4);
+      wr32(le, 0, g);
+      var c16 = crc16(crc16(crc16(0xffff, sb.uuid, 0, 16), le, 0, 4), b, o, 0x1e);
+      if (ds > 0x20) c16 = crc16(c16, b, o + 0x20, ds - 0x20);
+      wr16(b, o + 0x1e, c16);
+    }
+  }
+
+  /**
+   * [Item 179] Commit the current journal transaction: write back all
+   * buffered file data, then journal and checkpoint the metadata.
    */
   commitTransaction(): number {
-    if (!this._journal) return 0;
-    return this._journal.commit();
+    if (!this._journal || this._roReason) return 0;
+    var err = this._writebackAll();
+    if (err) return err;
+    this.invalidateCaches();            // readahead buffers may hold old blocks
+    return this._commit();
+  }
+
+  /** Flush everything and mark the filesystem clean (journal empty). */
+  unmount(): number {
+    var err = this.commitTransaction();
+    if (err) return err;
+    var s = this._sbRaw;
+    if (this._ready && !this._roReason && rd32(s, 0x60) & EXT4_FEATURE_INCOMPAT_RECOVER) {
+      wr32(s, 0x60, rd32(s, 0x60) & ~EXT4_FEATURE_INCOMPAT_RECOVER);
+      this._sbChecksum();
+      return this._writeSuperHome();
+    }
+    return 0;
+  }
+
+  /** Block / inode totals for df. */
+  statfs(): { blocks: number; freeBlocks: number; inodes: number; freeInodes: number; blockSize: number } {
+    var sb = this._sb;
+    var fb = 0, fi = 0;
+    for (var g = 0; g < this._groups.length; g++) {
+      fb += this._groups[g].freeBlocksCount;
+      fi += this._groups[g].freeInodesCount;
+    }
+    for (var p = 0; p < this._pendingFree.length; p++) fb += this._pendingFree[p][1];
+    return { blocks: sb ? sb.blocksCount : 0, freeBlocks: fb, inodes: sb ? sb.inodesCount : 0, freeInodes: fi, blockSize: this.blockSize };
   }
 }
 
 // ── JBD2 Journal (Item 179) ───────────────────────────────────────────────────
 
+const JBD2_MAGIC            = 0xc03b3998;
+const JBD2_DESCRIPTOR_BLOCK = 1;
+const JBD2_COMMIT_BLOCK     = 2;
+const JBD2_SUPERBLOCK_V1    = 3;
+const JBD2_SUPERBLOCK_V2    = 4;
+const JBD2_FEATURE_INCOMPAT_64BIT   = 0x02;
+const JBD2_FEATURE_INCOMPAT_CSUM_V2 = 0x08;
+const JBD2_FEATURE_INCOMPAT_CSUM_V3 = 0x10;
+/** REVOKE 64BIT ASYNC_COMMIT CSUM_V2 CSUM_V3 FAST_COMMIT */
+const JBD2_INCOMPAT_KNOWN   = 0x3f;
+const JBD2_FLAG_ESCAPE      = 1;
+const JBD2_FLAG_SAME_UUID   = 2;
+const JBD2_FLAG_LAST_TAG    = 8;
+
 /**
- * [Item 179] Lightweight JBD2-compatible metadata journal.
+ * [Item 179] JBD2 metadata journal.
  *
  * Transaction model:
- *   1. Before modifying any metadata block, write it to the journal log.
- *   2. On commit(), write the commit record and then replay all blocks to disk.
- *   3. After successful commit, the journal area can be reclaimed.
+ *   1. Before modifying any metadata block, take its copy in the running
+ *      transaction (Ext4FS._metaWrite); readers see that copy.
+ *   2. On commit(), mark the log live in the journal superblock, write
+ *      descriptor blocks (one tag per block) and the block copies into the
+ *      journal inode, then the commit block.
+ *   3. Checkpoint: write the blocks to their home locations and mark the log
+ *      empty again, so each transaction starts at the head of the log.
  *
- * This implementation stores the journal in memory (zero-copy) and replays
- * on commit.  A real JBD2 would use a circular journal on a dedicated inode.
+ * The log format follows the kernel's jbd2 (big-endian tags, escaping,
+ * csum v2/v3 checksums) so a crash between commit and checkpoint is
+ * replayed by Linux or e2fsck.  Without a journal inode (ext2) commit()
+ * only checkpoints.
  */
 class JBD2Journal {
   private _fs:       Ext4FS;
   private _txn:      Map<number, Uint8Array>;  // blockNo → new data
   private _txnId:    number = 1;
-
-  constructor(fs: Ext4FS) {
+  private _ino:      number;
+  private _jsb:      Uint8Array | null = null;  // journal superblock (whole block)
+  private _first     = 0;
+  private _maxlen    = 0;
+  private _incompat  = 0;
+  private _seed      = 0;
+  /** Date.now() when the running transaction took its first block. */
+  started = 0;
+  /** Non-empty when the log cannot be used safely. */
+  error = '';
+  readonly stats = { commits: 0, logBlocks: 0, checkpointed: 0 };
+
+  constructor(fs: Ext4FS, journalIno: number) {
     this._fs  = fs;
     this._txn = new Map();
+    this._ino = journalIno;
+    if (journalIno) this._load();
   }
 
+  private _load(): void {
+    var fs = this._fs;
+    var inode = fs['_readInode'](this._ino) as Ext4Inode | null;
+    var blk0 = inode ? fs._bmap(this._ino, inode, 0) : 0;
+    if (!blk0) { this.error = 'journal inode unreadable'; return; }
+    var b = fs._readBlock(blk0);
+    if (be32(b, 0) !== JBD2_MAGIC) { this.error = 'bad journal magic'; return; }
+    var type = be32(b, 4);
+    if (type !== JBD2_SUPERBLOCK_V1 && type !== JBD2_SUPERBLOCK_V2) { this.error = 'bad journal superblock'; return; }
+    if (be32(b, 0x0c) !== fs.blockSize) { this.error = 'journal block size mismatch'; return; }
+    this._maxlen   = be32(b, 0x10);
+    this._first    = be32(b, 0x14);
+    this._txnId    = be32(b, 0x18);
+    this._incompat = type === JBD2_SUPERBLOCK_V2 ? be32(b, 0x28) : 0;
+    if (be32(b, 0x1c) !== 0) { this.error = 'journal needs recovery'; return; }
+    if (this._incompat & ~JBD2_INCOMPAT_KNOWN) { this.error = 'unsupported journal features'; return; }
+    this._seed = crc32c(0xffffffff, b, 0x30, 16);
+    this._jsb = b;
+  }
+
+  get hasLog(): boolean { return this._jsb !== null; }
+
+  get size(): number { return this._txn.size; }
+
+  get(blockNo: number): Uint8Array | undefined { return this._txn.get(blockNo); }
+
+  /** Adopt `data` as the transaction's copy of `blockNo` (no copy made). */
+  put(blockNo: number, data: Uint8Array): void {
+    if (this._txn.size === 0) this.started = Date.now();
+    this._txn.set(blockNo, data);
+  }
+
+  forget(blockNo: number): void { this._txn.delete(blockNo); }
+
   /**
    * Buffer a block write in the current transaction.
    * The block is journaled but not yet written to disk.
    */
   journalBlock(blockNo: number, data: Uint8Array): void {
-    this._txn.set(blockNo, new Uint8Array(data));  // copy
+    this.put(blockNo, new Uint8Array(data));  // copy
   }
 
-  /**
-   * Write file data, journaling all affected metadata blocks.
-   * Returns 0 on success, <0 on error.
-   */
-  writeData(ino: number, offset: number, data: Uint8Array): number {
-    var sb = this._fs._sb; if (!sb) return -5;
-    // Read the inode, update size, journal the inode block, then write data blocks
-    var inode  = this._fs['_readInode'](ino);
-    if (!inode) return -2;  // ENOENT
-
-    var newSize = offset + data.length;
-    if (newSize > inode.sizeLo) inode.sizeLo = newSize;  // update in-memory size
-
-    // For simplicity, journal the data directly in the data blocks (no extent allocation)
-    var blockSize = sb.blockSize;
-    var off = 0;
-    while (off < data.length) {
-      var fileOff  = offset + off;
-      var logBlock = Math.floor(fileOff / blockSize);
-      var blockOff = fileOff % blockSize;
-      var physBlock = this._fs['_extentLookup'](inode.iBlock, logBlock);
-      if (!physBlock) {
-        off += Math.min(blockSize - blockOff, data.length - off);
-        continue;  // hole — block not allocated
-      }
-      var existing = this._fs._readBlock(physBlock);
-      var patch    = new Uint8Array(existing);
-      var copyLen  = Math.min(blockSize - blockOff, data.length - off);
-      patch.set(data.subarray(off, off + copyLen), blockOff);
-      this.journalBlock(physBlock, patch);
-      off += copyLen;
-    }
-    return 0;
+  private _csum(): boolean { return (this._incompat & (JBD2_FEATURE_INCOMPAT_CSUM_V2 | JBD2_FEATURE_INCOMPAT_CSUM_V3)) !== 0; }
+
+  private _tagBytes(): number {
+    if (this._incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3) return 16;
+    var sz = 12;
+    if (this._incompat & JBD2_FEATURE_INCOMPAT_CSUM_V2) sz += 2;
+    return this._incompat & JBD2_FEATURE_INCOMPAT_64BIT ? sz : sz - 4;
+  }
+
+  private _tagsPerDesc(): number {
+    var bs = this._fs.blockSize;
+    return Math.floor((bs - 12 - (this._csum() ? 4 : 0) - 16) / this._tagBytes());
+  }
+
+  /** Most metadata blocks one transaction may log. */
+  capacity(): number {
+    if (!this._jsb) return 1024;
+    var tpd = this._tagsPerDesc();
+    return Math.max(1, Math.floor((this._maxlen - this._first - 2) * tpd / (tpd + 1)));
   }
 
   /**
-   * [Item 179] Commit the transaction: write all journaled blocks to disk.
+   * [Item 179] Commit the transaction: log it, then write all journaled
+   * blocks to disk.  Transactions larger than the log are split.
    */
   commit(): number {
+    if (this._txn.size === 0) return 0;
+    var blocks = Array.from(this._txn.keys()).sort(function(a, b) { return a - b; });
+    var cap = this.capacity();
     var err = 0;
-    this._txn.forEach((data, blockNo) => {
-      var result = this._fs._writeBlock(blockNo, data);
-      if (result < 0) err = result;
-    });
+    for (var i = 0; i < blocks.length && !err; i += cap) {
+      var slice = blocks.slice(i, i + cap);
+      if (this._jsb) err = this._writeLog(slice);
+      if (!err) err = this._checkpoint(slice);
+      if (!err && this._jsb) err = this._setStart(0, this._txnId + 1);
+      this._txnId++;
+      this.stats.commits++;
+    }
     this._txn.clear();
-    this._txnId++;
     return err;
   }
 
@@ -613,6 +2602,122 @@ class JBD2Journal {
   abort(): void {
     this._txn.clear();
   }
+
+  /** Journal-relative block `n` → physical block. */
+  private _logBlock(n: number): number {
+    var fs = this._fs;
+    var inode = fs['_readInode'](this._ino) as Ext4Inode | null;
+    return inode ? fs._bmap(this._ino, inode, n) : 0;
+  }
+
+  private _writeLogBlock(n: number, data: Uint8Array): number {
+    var p = this._logBlock(n);
+    if (!p) return -5;
+    this.stats.logBlocks++;
+    return this._fs._writeBlock(p, data);
+  }
+
+  /** Rewrite the journal superblock with s_start / s_sequence. */
+  private _setStart(start: number, seq: number): number {
+    var b = this._jsb!;
+    wbe32(b, 0x18, seq);
+    wbe32(b, 0x1c, start);
+    if (this._csum()) {
+      wbe32(b, 0xfc, 0);
+      wbe32(b, 0xfc, crc32c(0xffffffff, b, 0, 1024));
+    }
+    return this._writeLogBlock(0, b);
+  }
+
+  private _header(b: Uint8Array, type: number): void {
+    wbe32(b, 0, JBD2_MAGIC);
+    wbe32(b, 4, type);
+    wbe32(b, 8, this._txnId);
+  }
+
+  /** Descriptor + data blocks, then the commit block, starting at s_first. */
+  private _writeLog(blocks: number[]): number {
+    var bs = this._fs.blockSize;
+    var csum = this._csum();
+    var v3 = (this._incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3) !== 0;
+    var is64 = (this._incompat & JBD2_FEATURE_INCOMPAT_64BIT) !== 0;
+    var tagBytes = this._tagBytes();
+    var seqBytes = new Uint8Array(4);
+    wbe32(seqBytes, 0, this._txnId);
+    var err = this._setStart(this._first, this._txnId);
+    var pos = this._first;
+    var bi = 0;
+    while (bi < blocks.length && !err) {
+      var desc = new Uint8Array(bs);
+      this._header(desc, JBD2_DESCRIPTOR_BLOCK);
+      var descPos = pos++;
+      var off = 12, lastTag = 12;
+      var datas: Uint8Array[] = [];
+      while (bi < blocks.length) {
+        var first = datas.length === 0;
+        if (off + tagBytes + (first ? 16 : 0) > bs - (csum ? 4 : 0)) break;
+        var blk = blocks[bi];
+        if (!is64 && blk >= 0x100000000) return -27;   // EFBIG: needs a 64-bit journal
+        var data = this._txn.get(blk)!;
+        var flags = first ? 0 : JBD2_FLAG_SAME_UUID;
+        if (be32(data, 0) === JBD2_MAGIC) {
+          data = data.slice();
+          wbe32(data, 0, 0);
+          flags |= JBD2_FLAG_ESCAPE;
+        }
+        var tcs = csum ? crc32c(crc32c(this._seed, seqBytes, 0, 4), data, 0, bs) : 0;
+        wbe32(desc, off, blk % 0x100000000);
+        if (v3) {
+          wbe32(desc, off + 4, flags);
+          wbe32(desc, off + 8, Math.floor(blk / 0x100000000));
+          wbe32(desc, off + 12, tcs);
+        } else {
+          wbe16(desc, off + 4, tcs & 0xffff);
+          wbe16(desc, off + 6, flags);
+          if (is64) wbe32(desc, off + 8, Math.floor(blk / 0x100000000));
+        }
+        lastTag = off;
+        off += tagBytes;
+        if (first) { desc.set(this._jsb!.subarray(0x30, 0x40), off); off += 16; }
+        datas.push(data);
+        bi++;
+      }
+      // Mark the last tag
+      if (v3) wbe32(desc, lastTag + 4, be32(desc, lastTag + 4) | JBD2_FLAG_LAST_TAG);
+      else wbe16(desc, lastTag + 6, ((desc[lastTag + 6] << 8) | desc[lastTag + 7]) | JBD2_FLAG_LAST_TAG);
+      if (csum) wbe32(desc, bs - 4, crc32c(this._seed, desc, 0, bs));
+      err = this._writeLogBlock(descPos, desc);
+      for (var d = 0; d < datas.length && !err; d++) err = this._writeLogBlock(pos++, datas[d]);
+    }
+    if (err) return err;
+    // The commit block goes last: the transaction is durable once it is written
+    var cb = new Uint8Array(bs);
+    this._header(cb, JBD2_COMMIT_BLOCK);
+    var ms = Date.now();
+    wbe32(cb, 0x30, Math.floor(ms / 1000 / 0x100000000));
+    wbe32(cb, 0x34, Math.floor(ms / 1000) % 0x100000000);
+    wbe32(cb, 0x38, (ms % 1000) * 1000000);
+    if (csum) wbe32(cb, 0x10, crc32c(this._seed, cb, 0, bs));
+    return this._writeLogBlock(pos, cb);
+  }
+
+  /** Write blocks home, one request per physically contiguous stretch. */
+  private _checkpoint(blocks: number[]): number {
+    var fs = this._fs;
+    var bs = fs.blockSize;
+    for (var i = 0; i < blocks.length; ) {
+      var j = i + 1;
+      while (j < blocks.length && blocks[j] === blocks[j - 1] + 1) j++;
+      var buf = j - i === 1 ? this._txn.get(blocks[i])! : new Uint8Array((j - i) * bs);
+      if (j - i > 1) for (var k = i; k < j; k++) buf.set(this._txn.get(blocks[k])!, (k - i) * bs);
+      var err = fs._writeRange(blocks[i] * bs, buf, 0, buf.length);
+      if (err < 0) return err;
+      for (var c = i; c < j; c++) fs._cacheBlock(blocks[c], this._txn.get(blocks[c])!);
+      this.stats.checkpointed += j - i;
+      i = j;
+    }
+    return 0;
+  }
 }
 
 /** Simple array-backed block device for testing (same pattern as ext2). */
@@ -635,4 +2740,18 @@ export class SimpleArrayBlockDevice implements Ext4BlockDevice {
     this._data.set(data, byteOffset);
     return 0;
   }
+
+  readInto(byteOffset: number, dst: Uint8Array, dstOffset: number, length: number): number {
+    var end = Math.min(byteOffset + length, this._data.length);
+    var n   = Math.max(0, end - byteOffset);
+    if (n) dst.set(this._data.subarray(byteOffset, end), dstOffset);
+    if (n < length) dst.fill(0, dstOffset + n, dstOffset + length);
+    return length;
+  }
+
+  writeFrom(byteOffset: number, src: Uint8Array, srcOffset: number, length: number): number {
+    if (byteOffset + length > this._data.length) return -28;
+    this._data.set(src.subarray(srcOffset, srcOffset + length), byteOffset);
+    return length;
+  }
 }
@@ -0,0 +1,362 @@
+/**
+ * JSOS file bodies — chunked binary storage
+ *
+ * A FileData holds a regular file's bytes as a list of page-sized
+ * Uint8Array chunks: byte `p` lives in chunk `p >> 12` at `p & 4095`, so a
+ * read or write at any offset touches only the chunks it covers.
+ *
+ *   • append — fills the tail chunk, then adds new ones: O(1) amortised per
+ *     byte, never a copy of what is already stored.  The tail chunk starts
+ *     small and doubles up to a page, so tiny files stay tiny.
+ *   • pread / pwrite — copy just the requested range; writing past the end
+ *     leaves a hole (a null chunk) that reads as zeroes.
+ *   • views — subarray views of the stored chunks for zero-copy sendfile.
+ *   • borrowed bodies — fromView() wraps someone else's bytes (a ROM image)
+ *     without copying, and clone() shares every chunk with the original.
+ *     Copy-on-write is per chunk: a write copies only the pages it touches,
+ *     so changing a few bytes of a large borrowed file costs one page.
+ *
+ * Text is UTF-8.  A file written from a string keeps that string and only
+ * encodes it on its first binary access; the decoded string of a binary
+ * file is cached until the next write, so repeated readFile() calls of an
+ * unchanged file cost nothing.
+ */
+
+import { utf8Encode, utf8Decode } from '../core/ringbuf.js';
+
+export const FILE_CHUNK_SHIFT = 12;
+export const FILE_CHUNK_SIZE  = 1 << FILE_CHUNK_SHIFT;    // 4096
+const CHUNK_MASK    = FILE_CHUNK_SIZE - 1;
+const MIN_TAIL      = 64;                                 // first tail allocation
+
+export class FileData {
+  /** Page chunks; null = hole.  Every chunk but the last has FILE_CHUNK_SIZE bytes. */
+  private _chunks: Array<Uint8Array | null> = [];
+  private _len = 0;
+  /** Text form: authoritative while _chunks is unbuilt, else a decode cache. */
+  private _str: string | null = null;
+  private _built = true;
+  /**
+   * Per-chunk flag: 1 = the chunk aliases memory this body does not own
+   * (fromView, or shared with a clone) and is copied before it is written.
+   * Null when every chunk is private.
+   */
+  private _borrowed: Uint8Array | null = null;
+  /** Bumped by every mutation (see generation). */
+  private _gen = 0;
+
+  static fromString(s: string): FileData {
+    var d = new FileData();
+    if (s.length) {
+      d._str = s;
+      d._built = false;
+      d._len = utf8Length(s);
+    }
+    return d;
+  }
+
+  static fromBytes(src: Uint8Array, off: number = 0, len: number = src.length - off): FileData {
+    var d = new FileData();
+    d.append(src, off, len);
+    return d;
+  }
+
+  /**
+   * Zero-copy body over `src` (e.g. a file in the ROM image): chunks are
+   * subarray views of it.  `src` is never written — the first mutation
+   * gives the file private copies of its chunks.
+   */
+  static fromView(src: Uint8Array): FileData {
+    var d = new FileData();
+    for (var p = 0; p < src.length; p += FILE_CHUNK_SIZE) {
+      d._chunks.push(src.subarray(p, Math.min(src.length, p + FILE_CHUNK_SIZE)));
+    }
+    d._len = src.length;
+    if (d._chunks.length) d._borrowed = new Uint8Array(d._chunks.length).fill(1);
+    return d;
+  }
+
+  get length(): number { return this._len; }
+
+  /**
+   * Mutation counter: changes whenever the contents or length change, so a
+   * holder can tell whether the body was written since it last looked.
+   */
+  get generation(): number { return this._gen; }
+
+  /** Number of chunks holding data (holes excluded) — for du/statfs. */
+  get storedChunks(): number {
+    this._build();
+    var n = 0;
+    for (var i = 0; i < this._chunks.length; i++) if (this._chunks[i]) n++;
+    return n;
+  }
+
+  /** Stored chunks still aliasing borrowed memory (not yet copied on write). */
+  get sharedChunks(): number {
+    var b = this._borrowed;
+    if (!b) return 0;
+    var n = 0;
+    for (var i = 0; i < b.length && i < this._chunks.length; i++) if (b[i] && this._chunks[i]) n++;
+    return n;
+  }
+
+  // ── Text ──────────────────────────────────────────────────────────────────
+
+  toString(): string {
+    if (this._str === null) {
+      this._str = this._len ? utf8Decode(this.toBytes()) : '';
+    }
+    return this._str;
+  }
+
+  appendString(s: string): void {
+    if (s.length === 0) return;
+    if (this._len === 0) {
+      // Empty file: stay in text form until something needs the bytes
+      this._chunks = [];
+      this._borrowed = null;
+      this._str = s;
+      this._built = false;
+      this._len = utf8Length(s);
+      this._gen++;
+      return;
+    }
+    var b = utf8Encode(s);
+    this.append(b, 0, b.length);
+  }
+
+  // ── Bytes ─────────────────────────────────────────────────────────────────
+
+  /** Contiguous copy of the whole file. */
+  toBytes(): Uint8Array {
+    var out = new Uint8Array(this._len);
+    this.pread(out, 0, this._len, 0);
+    return out;
+  }
+
+  /** Append `len` bytes of `src` from `off`.  O(len) — independent of file size. */
+  append(src: Uint8Array, off: number = 0, len: number = src.length - off): void {
+    if (len <= 0) return;
+    this._build();
+    this._str = null;
+    this._gen++;
+    var pos = this._len;
+    var end = pos + len;
+    while (pos < end) {
+      var ci = pos >> FILE_CHUNK_SHIFT;
+      var co = pos & CHUNK_MASK;
+      var n  = Math.min(end - pos, FILE_CHUNK_SIZE - co);
+      var c  = this._tailChunk(ci, co + n);
+      c.set(src.subarray(off, off + n), co);
+      off += n;
+      pos += n;
+    }
+    this._len = end;
+  }
+
+  /**
+   * Copy up to `len` bytes at file offset `pos` into `dst[off…]`.
+   * Returns the number of bytes copied (0 at or past end of file).
+   */
+  pread(dst: Uint8Array, off: number, len: number, pos: number): number {
+    if (pos >= this._len || len <= 0) return 0;
+    this._build();
+    if (len > this._len - pos) len = this._len - pos;
+    var done = 0;
+    while (done < len) {
+      var ci = pos >> FILE_CHUNK_SHIFT;
+      var co = pos & CHUNK_MASK;
+      var n  = Math.min(len - done, FILE_CHUNK_SIZE - co);
+      var c  = this._chunks[ci];
+      if (c) dst.set(c.subarray(co, co + n), off + done);
+      else   dst.fill(0, off + done, off + done + n);
+      done += n;
+      pos  += n;
+    }
+    return len;
+  }
+
+  /**
+   * Write `len` bytes of `src[off…]` at file offset `pos`, growing the file
+   * as needed.  A gap between the old end and `pos` becomes a hole.
+   */
+  pwrite(src: Uint8Array, off: number, len: number, pos: number): number {
+    if (len <= 0) return 0;
+    if (pos === this._len) { this.append(src, off, len); return len; }
+    this._build();
+    this._str = null;
+    this._gen++;
+    var end = pos + len;
+    if (pos > this._len) this._extendTo(pos);
+    var done = 0;
+    while (done < len) {
+      var ci = pos >> FILE_CHUNK_SHIFT;
+      var co = pos & CHUNK_MASK;
+      var n  = Math.min(len - done, FILE_CHUNK_SIZE - co);
+      var c  = ci === this._chunks.length - 1 || ci >= this._chunks.length
+        ? this._tailChunk(ci, co + n)
+        : this._interiorChunk(ci);
+      c.set(src.subarray(off + done, off + done + n), co);
+      done += n;
+      pos  += n;
+    }
+    if (end > this._len) this._len = end;
+    return len;
+  }
+
+  /** Shrink or grow (with a hole) to exactly `len` bytes. */
+  truncate(len: number): void {
+    if (len < 0) len = 0;
+    if (len === this._len) return;
+    this._build();
+    this._str = null;
+    this._gen++;
+    if (len > this._len) { this._extendTo(len); return; }
+    var keep = (len + CHUNK_MASK) >> FILE_CHUNK_SHIFT;
+    this._chunks.length = keep;
+    var tail = len & CHUNK_MASK;
+    if (keep && tail && this._chunks[keep - 1]) {
+      this._own(keep - 1);
+      this._chunks[keep - 1]!.fill(0, tail);    // stale bytes must read as zero later
+    }
+    this._len = len;
+  }
+
+  /**
+   * Zero-copy views of the stored bytes covering [pos, pos + len), in order.
+   * Holes come back as zero-filled arrays.  Views alias the file: a later
+   * write to the file shows through them.
+   */
+  views(pos: number, len: number): Uint8Array[] {
+    var out: Uint8Array[] = [];
+    if (pos >= this._len || len <= 0) return out;
+    this._build();
+    if (len > this._len - pos) len = this._len - pos;
+    var end = pos + len;
+    while (pos < end) {
+      var ci = pos >> FILE_CHUNK_SHIFT;
+      var co = pos & CHUNK_MASK;
+      var n  = Math.min(end - pos, FILE_CHUNK_SIZE - co);
+      var c  = this._chunks[ci];
+      out.push(c ? c.subarray(co, co + n) : new Uint8Array(n));
+      pos += n;
+    }
+    return out;
+  }
+
+  /**
+   * Independent copy in O(chunks): both bodies share every chunk and each
+   * copies a chunk on its own first write to it.
+   */
+  clone(): FileData {
+    var d = new FileData();
+    d._len   = this._len;
+    d._str   = this._str;
+    d._built = this._built;
+    var n = this._chunks.length;
+    if (n) {
+      d._chunks = this._chunks.slice();
+      d._borrowed = new Uint8Array(n).fill(1);
+      this._borrowed = new Uint8Array(n).fill(1);
+    }
+    return d;
+  }
+
+  // ── Internals ─────────────────────────────────────────────────────────────
+
+  /** Encode the pending text form into chunks. */
+  private _build(): void {
+    if (this._built) return;
+    this._built = true;
+    var s = this._str!;
+    var g = this._gen;
+    var b = utf8Encode(s);
+    this._len = 0;
+    this.append(b, 0, b.length);
+    this._str = s;                 // still valid: the bytes are its encoding
+    this._gen = g;                 // same contents, just another form
+  }
+
+  /** Give chunk `ci` a private copy if it is borrowed, before writing it. */
+  private _own(ci: number): void {
+    var b = this._borrowed;
+    if (!b || ci >= b.length || !b[ci]) return;
+    b[ci] = 0;
+    var c = this._chunks[ci];
+    if (c) this._chunks[ci] = c.slice();
+  }
+
+  /** Install a freshly allocated (private) chunk at `ci`. */
+  private _put(ci: number, c: Uint8Array): Uint8Array {
+    this._chunks[ci] = c;
+    var b = this._borrowed;
+    if (b && ci < b.length) b[ci] = 0;
+    return c;
+  }
+
+  /** Writable full-size interior chunk `ci` (a hole gets a zeroed page). */
+  private _interiorChunk(ci: number): Uint8Array {
+    this._own(ci);
+    return this._chunks[ci] || this._put(ci, new Uint8Array(FILE_CHUNK_SIZE));
+  }
+
+  /**
+   * Chunk `ci` with room for at least `need` bytes, allocating it or growing
+   * the (short) tail chunk by doubling.  Filling a page's worth of bytes
+   * through a doubling tail copies < FILE_CHUNK_SIZE bytes in total.
+   */
+  private _tailChunk(ci: number, need: number): Uint8Array {
+    while (this._chunks.length < ci) this._chunks.push(null);
+    var c = this._chunks[ci];
+    if (c && c.length >= need) { this._own(ci); return this._chunks[ci]!; }
+    if (ci < this._chunks.length - 1) {
+      // Interior chunks are always full-size once present
+      return this._put(ci, new Uint8Array(FILE_CHUNK_SIZE));
+    }
+    var used = this._len - (ci << FILE_CHUNK_SHIFT);       // hole bytes already in the file
+    if (need < used) need = used;
+    var cap = c ? c.length : MIN_TAIL;
+    while (cap < need) cap <<= 1;
+    if (cap > FILE_CHUNK_SIZE) cap = FILE_CHUNK_SIZE;
+    var nc = new Uint8Array(cap);
+    if (c) nc.set(c);
+    this._put(ci, nc);
+    // The previous tail becomes interior once a later chunk exists; pad it.
+    if (ci > 0) this._padChunk(ci - 1);
+    return nc;
+  }
+
+  /** Make chunk `ci` full-size (holes stay null). */
+  private _padChunk(ci: number): void {
+    var c = this._chunks[ci];
+    if (c && c.length < FILE_CHUNK_SIZE) {
+      var full = new Uint8Array(FILE_CHUNK_SIZE);
+      full.set(c);
+      this._put(ci, full);
+    }
+  }
+
+  /** Grow to `len` bytes; the new range is a hole. */
+  private _extendTo(len: number): void {
+    var last = this._chunks.length - 1;
+    if (last >= 0) this._padChunk(last);
+    var need = (len + CHUNK_MASK) >> FILE_CHUNK_SHIFT;
+    while (this._chunks.length < need) this._chunks.push(null);
+    this._len = len;
+  }
+}
+
+/** Byte length of the UTF-8 encoding of `s` (as utf8Encode writes it). */
+export function utf8Length(s: string): number {
+  var n = 0;
+  for (var i = 0; i < s.length; i++) {
+    var c = s.charCodeAt(i);
+    if (c < 0x80) n += 1;
+    else if (c < 0x800) n += 2;
+    else if (c >= 0xD800 && c <= 0xDBFF && i + 1 < s.length &&
+             (s.charCodeAt(i + 1) & 0xFC00) === 0xDC00) { n += 4; i++; }
+    else n += 3;
+  }
+  return n;
+}
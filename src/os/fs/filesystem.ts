@@ -8,6 +8,10 @@
  */
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
+import { FileData, utf8Length } from './filedata.js';
+import { utf8Encode, utf8Decode, utf8Take } from '../core/ringbuf.js';
+
+export { FileData };
 
 /** Bare-metal safe timestamp: kernel uptime ms, or 0 before kernel init. */
 function uptime(): number {
@@ -53,12 +57,21 @@ export interface VFSMount {
   list(path: string): Array<{ name: string; type: FileType; size: number }>;
   exists(path: string): boolean;
   isDirectory(path: string): boolean;
+  /** Optional write side: when present, FileSystem writes under the mount go here. */
+  writeFile?(path: string, content: string | Uint8Array): void;
+  appendFile?(path: string, content: string | Uint8Array): void;
+  deleteFile?(path: string): void;
+  mkdir?(path: string): void;
+  /** Live byte store of a file, for fd I/O and sendfile. */
+  fileData?(path: string): FileData | null;
 }
 
 export interface FileEntry {
   name:        string;
   type:        FileType;
-  content:     string;
+  /** File body: chunked bytes.  Empty for symlinks. */
+  data:        FileData;
+  /** Byte length (UTF-8 for text); for symlinks, the target length. */
   size:        number;
   created:     number;
   modified:    number;
@@ -111,12 +124,13 @@ export const LOCK_UN = 8;  // Unlock
 /**
  * [Item 181] TmpFS — a RAM-backed volatile filesystem mounted at /tmp.
  * Files are stored in an in-memory Map and are lost on reboot.
- * Implements VFSMount for read operations; write operations are exposed
- * as dedicated methods and also wired into FileSystem.writeFile/mkdir.
+ * Implements VFSMount, including the optional write side, so
+ * FileSystem.writeFile/appendFile/mkdir/rm under /tmp land here.
+ * File bodies are chunked FileData: appends are O(1) amortised.
  */
 export class TmpFS implements VFSMount {
-  /** Path → content for regular files. */
-  readonly _files = new Map<string, string>();
+  /** Path → body for regular files. */
+  readonly _files = new Map<string, FileData>();
   /** Set of directory paths. */
   readonly _dirs  = new Set<string>();
 
@@ -126,6 +140,11 @@ export class TmpFS implements VFSMount {
   }
 
   read(path: string): string | null {
+    var d = this._files.get(path);
+    return d ? d.toString() : null;
+  }
+
+  fileData(path: string): FileData | null {
     return this._files.get(path) ?? null;
   }
 
@@ -134,11 +153,11 @@ export class TmpFS implements VFSMount {
     var result: Array<{ name: string; type: FileType; size: number }> = [];
     var seen = new Set<string>();
     // Files directly under path
-    for (var [p, content] of this._files) {
+    for (var [p, data] of this._files) {
       if (!p.startsWith(norm + '/')) continue;
       var rest = p.slice(norm.length + 1);
       if (rest.indexOf('/') !== -1) continue; // deeper level
-      if (!seen.has(rest)) { seen.add(rest); result.push({ name: rest, type: 'file', size: content.length }); }
+      if (!seen.has(rest)) { seen.add(rest); result.push({ name: rest, type: 'file', size: data.length }); }
     }
     // Subdirectories
     for (var d of this._dirs) {
@@ -160,9 +179,21 @@ export class TmpFS implements VFSMount {
   }
 
   /** Write a file into the tmpfs. Creates any missing parent directories. */
-  writeFile(path: string, content: string): void {
-    this._files.set(path, content);
-    // Ensure parent directories exist
+  writeFile(path: string, content: string | Uint8Array): void {
+    this._files.set(path, typeof content === 'string'
+      ? FileData.fromString(content) : FileData.fromBytes(content));
+    this._addParents(path);
+  }
+
+  /** Append to a file (creating it), without rewriting what is stored. */
+  appendFile(path: string, content: string | Uint8Array): void {
+    var d = this._files.get(path);
+    if (!d) { this.writeFile(path, content); return; }
+    if (typeof content === 'string') d.appendString(content);
+    else d.append(content);
+  }
+
+  private _addParents(path: string): void {
     var parts = path.split('/');
     for (var i = 1; i < parts.length - 1; i++) {
       var dir = parts.slice(0, i + 1).join('/');
@@ -644,6 +675,11 @@ export class FileSystem {
   /** Create a directory */
   mkdir(path: string): boolean {
     var resolved = this.resolvePath(path);
+    var mvfs = this.findMount(resolved);
+    if (mvfs && mvfs.mkdir && resolved !== this._mountPointOf(resolved)) {
+      mvfs.mkdir(resolved);
+      return true;
+    }
     var parts = resolved.split('/').filter(function(p) { return p.length > 0; });
     var current: DirectoryEntry = this.root;
 
@@ -669,9 +705,25 @@ export class FileSystem {
     return true;
   }
 
-  /** Write content to a file (creates or overwrites) */
-  writeFile(path: string, content: string): boolean {
+  /** Write content to a file (creates or overwrites).  Strings are stored as UTF-8. */
+  writeFile(path: string, content: string | Uint8Array): boolean {
     var resolved = this.resolvePath(path);
+    var vfs = this.findMount(resolved);
+    if (vfs && vfs.writeFile) { vfs.writeFile(resolved, content); return true; }
+    return this._putData(resolved, typeof content === 'string'
+      ? FileData.fromString(content) : FileData.fromBytes(content));
+  }
+
+  /**
+   * Create or replace the root-tree file at `path` with `data` as its body,
+   * without copying it — e.g. a copy-on-write view of the ROM image.
+   */
+  installFileData(path: string, data: FileData): boolean {
+    return this._putData(this.resolvePath(path), data);
+  }
+
+  /** Install `data` as the body of the root-tree file at `resolved`. */
+  private _putData(resolved: string, data: FileData): boolean {
     var parts = resolved.split('/').filter(function(p) { return p.length > 0; });
     if (parts.length === 0) return false;
 
@@ -688,12 +740,19 @@ export class FileSystem {
 
     var now = uptime();
     var existing = parent.children.get(fileName);
-    
+    if (existing && existing.type === 'file') {
+      // Replace the body in place so hard links keep sharing it
+      (existing as FileEntry).data = data;
+      (existing as FileEntry).size = data.length;
+      existing.modified = now;
+      return true;
+    }
+
     var file: FileEntry = {
       name: fileName,
       type: 'file',
-      content: content,
-      size: content.length,
+      data: data,
+      size: data.length,
       created: existing ? (existing as FileEntry).created || now : now,
       modified: now,
       permissions: existing ? (existing as FileEntry).permissions : _filePerms(), // umask (item 932)
@@ -711,16 +770,71 @@ export class FileSystem {
     if (vfs) return vfs.read(resolved);
     var entry = this.navigate(path);
     if (!entry || isDir(entry)) return null;
-    return entry.content;
+    return entry.data.toString();
+  }
+
+  /** Read a file's bytes (a copy).  Null if missing or a directory. */
+  readFileBytes(path: string): Uint8Array | null {
+    var data = this.fileData(path);
+    if (data) return data.toBytes();
+    var text = this.readFile(path);
+    return text === null ? null : utf8Encode(text);
+  }
+
+  /**
+   * Append content to a file (creating it).  O(1) amortised per byte: the
+   * stored body is extended in place, never re-read or rewritten.
+   */
+  appendFile(path: string, content: string | Uint8Array): boolean {
+    var resolved = this.resolvePath(path);
+    var vfs = this.findMount(resolved);
+    if (vfs) {
+      if (vfs.appendFile) { vfs.appendFile(resolved, content); return true; }
+      var old = vfs.read(resolved);
+      if (old === null || typeof content !== 'string') return this.writeFile(path, content);
+      return this.writeFile(path, old + content);
+    }
+    var entry = this._fileEntry(resolved);
+    if (!entry) return this.writeFile(path, content);
+    if (typeof content === 'string') entry.data.appendString(content);
+    else entry.data.append(content);
+    entry.size = entry.data.length;
+    entry.modified = uptime();
+    return true;
+  }
+
+  /**
+   * Live body of a regular file, or null (missing, a directory, or on a
+   * mount without byte access).  Writers must call markModified() after.
+   */
+  fileData(path: string): FileData | null {
+    var resolved = this.resolvePath(path);
+    var vfs = this.findMount(resolved);
+    if (vfs) return vfs.fileData ? vfs.fileData(resolved) : null;
+    var entry = this._fileEntry(resolved);
+    return entry ? entry.data : null;
+  }
+
+  /** Refresh size / mtime after an in-place write through fileData(). */
+  markModified(path: string): void {
+    var entry = this._fileEntry(this.resolvePath(path));
+    if (!entry) return;
+    entry.size = entry.data.length;
+    entry.modified = uptime();
   }
 
-  /** Append content to a file */
-  appendFile(path: string, content: string): boolean {
-    var existing = this.readFile(path);
-    if (existing === null) {
-      return this.writeFile(path, content);
+  /** Regular-file entry of the root tree at a resolved path, or null. */
+  private _fileEntry(resolved: string): FileEntry | null {
+    var e = this.navigate(resolved);
+    return e && !isDir(e) && e.type === 'file' ? e as FileEntry : null;
+  }
+
+  /** Mount point owning a resolved path ('' if none). */
+  private _mountPointOf(resolved: string): string {
+    for (var [mp] of this.mounts) {
+      if (resolved === mp || resolved.indexOf(mp + '/') === 0) return mp;
     }
-    return this.writeFile(path, existing + content);
+    return '';
   }
 
   /** Check if a path exists */
@@ -753,6 +867,12 @@ export class FileSystem {
   rm(path: string): boolean {
     var resolved = this.resolvePath(path);
     if (resolved === '/') return false;
+    var vfs = this.findMount(resolved);
+    if (vfs && vfs.deleteFile) {
+      if (!vfs.exists(resolved) || vfs.isDirectory(resolved)) return false;
+      vfs.deleteFile(resolved);
+      return true;
+    }
 
     var parts = resolved.split('/').filter(function(p) { return p.length > 0; });
     var name = parts[parts.length - 1];
@@ -773,6 +893,9 @@ export class FileSystem {
 
   /** Copy a file */
   cp(src: string, dest: string): boolean {
+    var data = this.fileData(src);
+    var resolvedDest = this.resolvePath(dest);
+    if (data && !this.findMount(resolvedDest)) return this._putData(resolvedDest, data.clone());
     var content = this.readFile(src);
     if (content === null) return false;
     return this.writeFile(dest, content);
@@ -786,6 +909,20 @@ export class FileSystem {
 
   /** Get file/directory info */
   stat(path: string): { type: FileType; size: number; created: number; modified: number; permissions: string } | null {
+    var resolved = this.resolvePath(path);
+    var vfs = this.findMount(resolved);
+    if (vfs) {
+      if (!vfs.exists(resolved)) return null;
+      var vdir = vfs.isDirectory(resolved);
+      var vdata = vdir || !vfs.fileData ? null : vfs.fileData(resolved);
+      var vtext = vdir || vdata ? null : vfs.read(resolved);
+      return {
+        type: vdir ? 'directory' : 'file',
+        size: vdata ? vdata.length : vtext ? utf8Length(vtext) : 0,
+        created: 0, modified: 0,
+        permissions: vdir ? 'rwxrwxrwt' : 'rw-rw-rw-',
+      };
+    }
     var entry = this.navigate(path);
     if (!entry) return null;
 
@@ -844,7 +981,7 @@ export class FileSystem {
     var now = uptime();
     var entry: FileEntry = {
       name, type: 'symlink',
-      content: '', size: target.length,
+      data: new FileData(), size: target.length,
       created: now, modified: now,
       permissions: 'lrwxrwxrwx',
       linkTarget: target,
@@ -884,7 +1021,9 @@ export class FileSystem {
     }
 
     if (trunc && accMode !== O_RDONLY) {
-      this.writeFile(path, '');
+      var tdata = this.fileData(path);
+      if (tdata) { tdata.truncate(0); this.markModified(path); }
+      else this.writeFile(path, '');
     }
 
     var resolved = this.resolvePath(path);
@@ -905,35 +1044,119 @@ export class FileSystem {
     return this.fds.delete(fd);
   }
 
-  /** Read up to `count` bytes from fd at current position. */
+  /**
+   * Read up to `count` bytes from fd at its position, as text.  Positions
+   * are byte offsets; only the requested range is decoded.  The
+   * read stops short of a character split by `count` and the position
+   * advances only past the bytes decoded; a character longer than `count`
+   * is returned whole.
+   */
   readFd(fd: number, count: number): string | null {
     var fde = this.fds.get(fd);
     if (!fde) return null;
     if ((fde.flags & 0x3) === O_WRONLY) return null; // write-only
-    var content = this.readFile(fde.path);
-    if (content === null) return null;
-    var chunk = content.substring(fde.pos, fde.pos + count);
-    fde.pos += chunk.length;
-    return chunk;
+    var data = this.fileData(fde.path);
+    if (!data) {
+      // Mount without byte access: fall back to its text
+      var content = this.readFile(fde.path);
+      if (content === null) return null;
+      data = FileData.fromString(content);
+    }
+    var avail = data.length - fde.pos, want = Math.min(count, avail);
+    if (want <= 0) return '';
+    var buf = new Uint8Array(Math.min(avail, want + 3));
+    var n = data.pread(buf, 0, buf.length, fde.pos);
+    var end = utf8Take(buf, Math.min(want, n), n, fde.pos + n >= data.length);
+    fde.pos += end;
+    return utf8Decode(buf, end);
   }
 
-  /** Write data to fd at current position. */
-  writeFd(fd: number, data: string): boolean {
+  /** Read up to `count` bytes from fd at its position.  Null on a bad fd. */
+  readFdBytes(fd: number, count: number): Uint8Array | null {
+    var fde = this.fds.get(fd);
+    if (!fde || (fde.flags & 0x3) === O_WRONLY) return null;
+    var out = this.pread(fd, count, fde.pos);
+    if (out) fde.pos += out.length;
+    return out;
+  }
+
+  /** Write data to fd at its position (at end of file with O_APPEND). */
+  writeFd(fd: number, data: string | Uint8Array): boolean {
     var fde = this.fds.get(fd);
     if (!fde) return false;
     if ((fde.flags & 0x3) === O_RDONLY) return false; // read-only
-    var content = this.readFile(fde.path) || '';
-
-    var newContent: string;
-    if (fde.flags & O_APPEND) {
-      newContent = content + data;
-      fde.pos    = newContent.length;
-    } else {
-      newContent = content.substring(0, fde.pos) + data +
-                   content.substring(fde.pos + data.length);
-      fde.pos   += data.length;
+    var body = this.fileData(fde.path);
+    if (!body) {
+      if (typeof data !== 'string') return false;
+      // Mount without byte access: splice into its text at the byte position
+      var text = FileData.fromString(this.readFile(fde.path) || '');
+      if (fde.flags & O_APPEND) fde.pos = text.length;
+      var bytes = utf8Encode(data);
+      text.pwrite(bytes, 0, bytes.length, fde.pos);
+      fde.pos += bytes.length;
+      return this.writeFile(fde.path, text.toString());
+    }
+    if (fde.flags & O_APPEND) fde.pos = body.length;
+    var n = this.pwrite(fd, data, fde.pos);
+    if (n < 0) return false;
+    fde.pos += n;
+    return true;
+  }
+
+  /**
+   * Read up to `count` bytes at byte `offset` without moving the fd
+   * position (pread(2)).  Copies only that range.  Null on a bad fd.
+   */
+  pread(fd: number, count: number, offset: number): Uint8Array | null {
+    var fde = this.fds.get(fd);
+    if (!fde || (fde.flags & 0x3) === O_WRONLY) return null;
+    var data = this.fileData(fde.path);
+    if (!data) {
+      var bytes = this.readFileBytes(fde.path);
+      return bytes ? bytes.slice(offset, offset + count) : null;
     }
-    return this.writeFile(fde.path, newContent);
+    var out = new Uint8Array(Math.max(0, Math.min(count, data.length - offset)));
+    data.pread(out, 0, out.length, offset);
+    return out;
+  }
+
+  /**
+   * Write at byte `offset` without moving the fd position (pwrite(2)).
+   * Writing past the end leaves a zero-filled hole.  Returns bytes
+   * written, or -1.
+   */
+  pwrite(fd: number, data: string | Uint8Array, offset: number): number {
+    var fde = this.fds.get(fd);
+    if (!fde || (fde.flags & 0x3) === O_RDONLY || offset < 0) return -1;
+    var body = this.fileData(fde.path);
+    if (!body) return -1;
+    var bytes = typeof data === 'string' ? utf8Encode(data) : data;
+    var n = body.pwrite(bytes, 0, bytes.length, offset);
+    this.markModified(fde.path);
+    return n;
+  }
+
+  /**
+   * sendfile(2): send `count` bytes of fd `inFd` to `dst`, starting at
+   * `offset` (or at the fd position, which then advances).  The file's
+   * chunks are handed to dst.writeBytes() as views — no copy — when the
+   * destination takes bytes.  Returns bytes sent, or -1 on a bad fd.
+   */
+  sendfile(dst: SendfileDest, inFd: number, offset: number | null, count: number): number {
+    var fde = this.fds.get(inFd);
+    if (!fde || (fde.flags & 0x3) === O_WRONLY) return -1;
+    var data = this.fileData(fde.path);
+    var src: SendfileSource;
+    if (data) src = new FileDataSendfileSource(data);
+    else {
+      var bytes = this.readFileBytes(fde.path);
+      if (!bytes) return -1;
+      src = new FileDataSendfileSource(FileData.fromBytes(bytes));
+    }
+    var from = offset === null ? fde.pos : offset;
+    var sent = sendfile(dst, src, from, count);
+    if (offset === null) fde.pos += sent;
+    return sent;
   }
 
   /** Seek to an absolute position within fd. Returns new position or -1. */
@@ -1016,9 +1239,10 @@ export class FileSystem {
 
   /** Helper: return the byte length of a file, or 0. */
   private _fileSize(resolvedPath: string): number {
-    var e = this.navigate(resolvedPath);
-    if (!e || isDir(e)) return 0;
-    return (e as FileEntry).content.length;
+    var data = this.fileData(resolvedPath);
+    if (data) return data.length;
+    var text = this.readFile(resolvedPath);
+    return text === null ? 0 : text.length;
   }
 
   // ── [Item 192] File Locking (flock) ─────────────────────────────────────────
@@ -1443,10 +1667,14 @@ export class SparseFile {
 export interface SendfileSource {
   read(offset: number, length: number): number[];
   readonly size: number;
+  /** Optional zero-copy access: views of the stored bytes. */
+  views?(offset: number, length: number): Uint8Array[];
 }
 
 export interface SendfileDest {
   write(data: number[]): number; // returns bytes written
+  /** Optional byte path; gets the source's views directly.  Returns bytes taken. */
+  writeBytes?(data: Uint8Array): number;
 }
 
 /** In-memory file wrapper for sendfile. */
@@ -1458,6 +1686,18 @@ export class MemFileSendfileSource implements SendfileSource {
   get size(): number { return this._data.length; }
 }
 
+/** Chunked FileData (regular files, TmpFS) for sendfile — exposes views. */
+export class FileDataSendfileSource implements SendfileSource {
+  constructor(private _d: FileData) {}
+  read(offset: number, length: number): number[] {
+    var buf = new Uint8Array(Math.max(0, Math.min(length, this._d.length - offset)));
+    this._d.pread(buf, 0, buf.length, offset);
+    return Array.from(buf);
+  }
+  views(offset: number, length: number): Uint8Array[] { return this._d.views(offset, length); }
+  get size(): number { return this._d.length; }
+}
+
 /** SparseFile wrapper for sendfile. */
 export class SparseSendfileSource implements SendfileSource {
   constructor(private _sf: SparseFile) {}
@@ -1480,6 +1720,19 @@ export function sendfile(
 ): number {
   var sent    = 0;
   var remaining = Math.min(count, src.size - offset);
+  if (src.views && dst.writeBytes) {
+    // Zero-copy: the destination consumes the source's own chunks
+    while (sent < remaining) {
+      var vs = src.views(offset + sent, Math.min(chunkSize, remaining - sent));
+      if (vs.length === 0) break;
+      for (var i = 0; i < vs.length; i++) {
+        var took = dst.writeBytes(vs[i]);
+        sent += took;
+        if (took < vs[i].length) return sent;   // destination is full
+      }
+    }
+    return sent;
+  }
   while (sent < remaining) {
     var toRead  = Math.min(chunkSize, remaining - sent);
     var chunk   = src.read(offset + sent, toRead);
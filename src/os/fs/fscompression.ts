@@ -1,15 +1,26 @@
 /**
  * JSOS Filesystem Compression — Item 205
  *
- * TypeScript implementations of LZ4 block compression and Zstandard (zstd)
- * decompression stubs, plus a CompressedBlockDevice wrapper that transparently
- * handles compressed blocks on top of any block device.
+ * LZ4 block and Zstandard (fs/zstd.ts) codecs, plus CompressedBlockDevice,
+ * which stores any block device's contents transparently compressed.
+ *
+ * The native LZ4 codec (kernel.lz4Compress / kernel.lz4Decompress) is used
+ * when the kernel has it; the TypeScript codec below is the fallback and
+ * produces the same format.
  *
  * LZ4 block format spec: https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
  * Zstd frame format: RFC 8878
  */
 
 import type { BlockDevice } from './blockdev.js';
+import { lz4DecodeBlock } from './decompress-stream.js';
+import { crc32c } from './crc.js';
+import {
+  zstdCompress, zstdDecompress as zstdDecode, zstdDecompressInto, zstdFrameInfo,
+  ZSTD_MAGIC, ZSTD_MIN_LEVEL, ZSTD_MAX_LEVEL,
+} from './zstd.js';
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
 
 // ────────────────────────────────────────────────────────────────────────────
 // LZ4 Block Compression
@@ -20,9 +31,7 @@ const LZ4_HASH_SIZE = 1 << LZ4_HASH_LOG;
 const LZ4_MIN_MATCH = 4;
 const LZ4_WILDCARD  = 8;
 const LZ4_LAST_LITS = 5;
-const LZ4_MF_LIMIT  = LZ4_WILCARD_CONST() + LZ4_LAST_LITS;
-
-function LZ4_WILCARD_CONST() { return LZ4_WILDCARD; }
+const LZ4_MF_LIMIT  = LZ4_WILDCARD + LZ4_LAST_LITS;
 
 function lz4Hash(v: number): number {
   return (Math.imul(v, 0x9e3779b9) >>> (32 - LZ4_HASH_LOG)) >>> 0;
@@ -32,18 +41,36 @@ function lz4Read32(src: Uint8Array, pos: number): number {
   return src[pos] | (src[pos+1] << 8) | (src[pos+2] << 16) | (src[pos+3] << 24);
 }
 
+function hasNativeLz4(): boolean {
+  return typeof kernel !== 'undefined' && typeof kernel.lz4Compress === 'function';
+}
+
+/** Worst-case LZ4 block size for `n` input bytes. */
+export function lz4CompressBound(n: number): number {
+  return n + Math.floor(n / 255) + 16;
+}
+
 /**
- * Compress data using LZ4 block format.
- * Returns the compressed bytes (no frame header — pure block).
+ * Compress `src` as one LZ4 block into `dst`.  Returns the compressed
+ * length, or -1 if `dst` is smaller than lz4CompressBound(src.length) and
+ * the output does not fit.
  */
-export function lz4Compress(src: Uint8Array): Uint8Array {
-  const maxOut = src.length + Math.ceil(src.length / 255) + 16;
-  const out  = new Uint8Array(maxOut);
+export function lz4CompressInto(src: Uint8Array, dst: Uint8Array): number {
+  if (hasNativeLz4()) return kernel.lz4Compress!(src, dst);
+  if (dst.length < lz4CompressBound(src.length)) {
+    var tmp = new Uint8Array(lz4CompressBound(src.length));
+    var n = lz4CompressInto(src, tmp);
+    if (n > dst.length) return -1;
+    dst.set(tmp.subarray(0, n));
+    return n;
+  }
+  const out  = dst;
   const htab = new Int32Array(LZ4_HASH_SIZE).fill(-1);
 
   let si = 0, di = 0, anchor = 0;
   const end = src.length;
   const mflim = end - LZ4_MF_LIMIT;
+  const mlim  = end - LZ4_LAST_LITS;           // the last 5 bytes are always literals
 
   while (si < mflim) {
     const v = lz4Read32(src, si);
@@ -51,20 +78,19 @@ export function lz4Compress(src: Uint8Array): Uint8Array {
     const ref = htab[h];
     htab[h] = si;
 
-    let matchLen = 0;
     if (ref >= 0 && si - ref < 65536 && lz4Read32(src, ref) === v) {
       let mi = ref + LZ4_MIN_MATCH, ii = si + LZ4_MIN_MATCH;
-      while (ii < end && src[mi] === src[ii]) { mi++; ii++; }
-      matchLen = ii - si - LZ4_MIN_MATCH;
+      while (ii < mlim && src[mi] === src[ii]) { mi++; ii++; }
+      const matchLen = ii - si - LZ4_MIN_MATCH;
 
       const litLen = si - anchor;
-      let token = Math.min(litLen, 15) << 4 | Math.min(matchLen, 15);
-      out[di++] = token;
+      out[di++] = Math.min(litLen, 15) << 4 | Math.min(matchLen, 15);
       // Extra literal length bytes
       let rem = litLen - 15;
       while (rem >= 0) { out[di++] = rem >= 255 ? 255 : rem; rem -= 255; }
       // Literals
-      out.set(src.slice(anchor, si), di); di += litLen;
+      for (let k = 0; k < litLen; k++) out[di + k] = src[anchor + k];
+      di += litLen;
       // Offset (LE)
       const offset = si - ref;
       out[di++] = offset & 0xff; out[di++] = (offset >> 8) & 0xff;
@@ -81,13 +107,31 @@ export function lz4Compress(src: Uint8Array): Uint8Array {
 
   // Last literal sequence
   const litLen = end - anchor;
-  let token = Math.min(litLen, 15) << 4;
-  out[di++] = token;
+  out[di++] = Math.min(litLen, 15) << 4;
   let rem = litLen - 15;
   while (rem >= 0) { out[di++] = rem >= 255 ? 255 : rem; rem -= 255; }
-  out.set(src.slice(anchor), di); di += litLen;
+  out.set(src.subarray(anchor), di); di += litLen;
+  return di;
+}
 
-  return out.slice(0, di);
+/**
+ * Compress data using LZ4 block format.
+ * Returns the compressed bytes (no frame header — pure block).
+ */
+export function lz4Compress(src: Uint8Array): Uint8Array {
+  const out = new Uint8Array(lz4CompressBound(src.length));
+  return out.subarray(0, lz4CompressInto(src, out));
+}
+
+/**
+ * Decompress one LZ4 block into `dst`.  Returns the decompressed length,
+ * or -1 on malformed input or if it does not fit.
+ */
+export function lz4DecompressInto(src: Uint8Array, dst: Uint8Array): number {
+  if (typeof kernel !== 'undefined' && typeof kernel.lz4Decompress === 'function') {
+    return kernel.lz4Decompress(src, dst);
+  }
+  return lz4DecodeBlock(src, 0, src.length, dst, 0, dst.length);
 }
 
 /**
@@ -97,42 +141,19 @@ export function lz4Compress(src: Uint8Array): Uint8Array {
  */
 export function lz4Decompress(src: Uint8Array, maxOutput: number): Uint8Array {
   const out = new Uint8Array(maxOutput);
-  let si = 0, di = 0;
-  while (si < src.length) {
-    const token = src[si++];
-    // Literal length
-    let litLen = token >> 4;
-    if (litLen === 15) {
-      let extra: number;
-      do { extra = src[si++]; litLen += extra; } while (extra === 255 && si < src.length);
-    }
-    // Copy literals
-    for (let i = 0; i < litLen && si < src.length && di < maxOutput; i++) out[di++] = src[si++];
-    if (si >= src.length) break;
-    // Match
-    const offset = src[si] | (src[si+1] << 8); si += 2;
-    let matchLen = (token & 0x0f) + LZ4_MIN_MATCH;
-    if (matchLen - LZ4_MIN_MATCH === 15) {
-      let extra: number;
-      do { extra = src[si++]; matchLen += extra; } while (extra === 255 && si < src.length);
-    }
-    let matchPos = di - offset;
-    for (let i = 0; i < matchLen && di < maxOutput; i++, di++, matchPos++) {
-      out[di] = out[matchPos >= 0 ? matchPos : 0];
-    }
-  }
-  return out.slice(0, di);
+  const n = lz4DecompressInto(src, out);
+  if (n < 0) throw new Error('lz4: corrupt block');
+  return out.subarray(0, n);
 }
 
 // ────────────────────────────────────────────────────────────────────────────
-// Zstandard (zstd) — Frame decompression stubs
+// Zstandard (zstd)
 // ────────────────────────────────────────────────────────────────────────────
 
-const ZSTD_MAGIC = 0xfd2fb528;
-
 export interface ZstdFrameHeader {
   magic: number;
   windowSize: number;
+  /** Decompressed size, or -1 when the frame does not record it. */
   contentSize: number;
   hasDict: boolean;
   dictId: number;
@@ -141,54 +162,19 @@ export interface ZstdFrameHeader {
 
 /** Parse Zstd frame header (RFC 8878 §3.1) */
 export function parseZstdFrameHeader(data: Uint8Array): ZstdFrameHeader | null {
-  const dv = new DataView(data.buffer, data.byteOffset, data.byteLength);
-  if (data.length < 4) return null;
-  const magic = dv.getUint32(0, true);
-  if (magic !== ZSTD_MAGIC) return null;
-  const fhd = data[4];  // Frame_Header_Descriptor
-  const fcs_field_size = [0, 2, 4, 8][ (fhd >> 6) & 3];
-  const single_segment  = !!(fhd & 0x20);
-  const has_checksum    = !!(fhd & 0x04);
-  const dict_id_flag    = fhd & 0x03;
-  const dictIdSizes     = [0, 1, 2, 4];
-  const dictIdSize      = dictIdSizes[dict_id_flag];
-  let off = 5;
-  let windowSize = 0;
-  if (!single_segment) {
-    // Window_Descriptor byte
-    const wlog = data[off] >> 3;
-    const wmantissa = data[off] & 0x07;
-    windowSize = ((wmantissa | 8) << wlog) >> 3;
-    off++;
-  }
-  let dictId = 0;
-  for (let i = 0; i < dictIdSize; i++) dictId |= data[off++] << (i * 8);
-  let contentSize = 0;
-  for (let i = 0; i < fcs_field_size; i++) contentSize |= data[off++] << (i * 8);
-  return { magic, windowSize, contentSize, hasDict: dictId !== 0, dictId, hasChecksum: has_checksum };
+  const info = zstdFrameInfo(data);
+  if (!info) return null;
+  return { magic: ZSTD_MAGIC, windowSize: info.windowSize, contentSize: info.contentSize,
+           hasDict: info.dictId !== 0, dictId: info.dictId, hasChecksum: info.hasChecksum };
 }
 
-/**
- * Zstd decompression — STUB.
- *
- * Full Zstd decompression requires implementing:
- *  - Huffman tree decoding (FSE compressed format)
- *  - ANS/FSE bit streams
- *  - Sequence decoding (literals + match lengths + offsets)
- *
- * For JSOS, leverage the native QuickJS runtime's built-in WASM Zstd if available,
- * or the kernel's zstd_decompress() C function via syscall.
- *
- * Returns null if decompression is not yet available.
- */
+/** Decompress zstd frames (fs/zstd.ts).  Returns null on corrupt input. */
 export function zstdDecompress(compressed: Uint8Array): Uint8Array | null {
-  // Check if syscall is available
-  if (typeof (globalThis as unknown as Record<string, unknown>).__zstdDecompress === 'function') {
-    return (globalThis as unknown as Record<string, (...args: unknown[]) => unknown>).__zstdDecompress(compressed) as Uint8Array;
+  try {
+    return zstdDecode(compressed);
+  } catch (_) {
+    return null;
   }
-  // Stub: return null to signal unavailability
-  void compressed;
-  return null;
 }
 
 // ────────────────────────────────────────────────────────────────────────────
@@ -197,72 +183,538 @@ export function zstdDecompress(compressed: Uint8Array): Uint8Array | null {
 
 export type CompressionAlgorithm = 'lz4' | 'zstd' | 'none';
 
-export interface CompressedSectorHeader {
-  algorithm: CompressionAlgorithm;
-  originalSize: number;
-  compressedSize: number;
+/*
+ * On-disk layout (all little-endian, sector = inner.sectorSize):
+ *
+ *   sector 0       superblock (CBD_* offsets below), CRC-32C protected
+ *   index          8 bytes per logical cluster: u32 physical LBA (0 = hole,
+ *                  reads as zeros), u32 stored length | codec << 24
+ *   data           compressed clusters, each in ceil(length / sector) sectors
+ *
+ * A cluster is the unit of compression: a fixed-size run of logical sectors
+ * (64 KB by default).  Each cluster records its own codec, so the algorithm
+ * and level can change from one mount to the next; clusters that do not
+ * shrink by at least a sector are stored raw, all-zero ones as holes.
+ * Free space is not recorded — mount rebuilds it from the index.
+ */
+const CBD_MAGIC        = 0x4442434a;          // 'JCBD'
+const CBD_VERSION      = 1;
+const CBD_ALG          = 6;
+const CBD_LEVEL        = 7;
+const CBD_CLUSTER_LOG  = 8;
+const CBD_LOGICAL_LO   = 12;
+const CBD_LOGICAL_HI   = 16;
+const CBD_INDEX_LBA    = 20;
+const CBD_INDEX_SECTS  = 24;
+const CBD_DATA_LBA     = 28;
+const CBD_GENERATION   = 32;
+const CBD_CRC          = 60;
+
+const CODEC_RAW  = 0;
+const CODEC_LZ4  = 1;
+const CODEC_ZSTD = 2;
+const LEN_MASK   = 0xffffff;
+
+const ALG_IDS: Record<CompressionAlgorithm, number> = { none: CODEC_RAW, lz4: CODEC_LZ4, zstd: CODEC_ZSTD };
+const ALG_NAMES: CompressionAlgorithm[] = ['none', 'lz4', 'zstd'];
+
+export interface CompressedDeviceOptions {
+  /** Codec for clusters written during this mount (default: the format's). */
+  algorithm?: CompressionAlgorithm;
+  /** zstd level 1 … 19 (default 3); ignored by LZ4. */
+  level?: number;
+  /** Bytes per cluster when formatting: power of two, 4 KB … 1 MB (default 64 KB). */
+  clusterSize?: number;
+  /** Byte budget of the decompressed-cluster cache (default 4 MB). */
+  cacheBytes?: number;
+  /** Logical size in sectors when formatting (default: the inner device's). */
+  logicalSectors?: number;
+  /** Format the device if it has no valid superblock (default true). */
+  format?: boolean;
 }
 
-/** Parse a 12-byte sector header prepended by the filesystem layer */
-function parseSectorHeader(sector: Uint8Array): CompressedSectorHeader | null {
-  if (sector.length < 12) return null;
-  const magic = sector[0] | (sector[1] << 8);
-  if (magic !== 0x4c5a /* 'LZ' */ && magic !== 0x5a53 /* 'ZS' */ && magic !== 0x4e4f /* 'NO' */) return null;
-  const algorithm: CompressionAlgorithm = magic === 0x4c5a ? 'lz4' : magic === 0x5a53 ? 'zstd' : 'none';
-  const dv = new DataView(sector.buffer, sector.byteOffset, sector.byteLength);
-  const originalSize   = dv.getUint32(4, true);
-  const compressedSize = dv.getUint32(8, true);
-  return { algorithm, originalSize, compressedSize };
+export interface CompressedDeviceStats {
+  reads: number;
+  writes: number;
+  /** Cluster lookups served from / missed in the cache. */
+  hits: number;
+  misses: number;
+  /** Calls to and bytes moved through the inner device. */
+  innerReads: number;
+  innerWrites: number;
+  bytesRead: number;
+  bytesWritten: number;
+  /** Clusters written back, and how many of them had to be stored raw. */
+  clustersWritten: number;
+  rawClusters: number;
+  evictions: number;
 }
 
+/** A decompressed cluster in the cache. */
+interface Cluster {
+  idx: number;
+  data: Uint8Array;
+  dirty: boolean;
+  /** Requests using it right now; pinned clusters are never evicted. */
+  pins: number;
+}
+
+const DEFAULT_CLUSTER = 64 * 1024;
+const DEFAULT_CACHE   = 4 * 1024 * 1024;
+/** Dirty clusters allowed in the cache before the oldest is written back. */
+const MAX_DIRTY       = 16;
+
 /**
- * A BlockDevice wrapper that transparently decompresses blocks.
+ * A BlockDevice whose sectors are stored compressed on `inner`.
  *
- * Each physical sector starts with a 12-byte CompressedSectorHeader.
- * If algorithm is 'none', the remaining data is returned as-is.
+ * Reads decompress whole clusters into an LRU cache bounded by a byte
+ * budget, so sequential and repeated reads decode each cluster once;
+ * consecutive misses whose extents are adjacent on disk are fetched with
+ * one inner read.  Writes land in the cache and are compressed when the
+ * cluster is evicted or on flush(); flush() also persists the index and
+ * superblock, so callers must flush before the device goes away.
  */
 export class CompressedBlockDevice implements BlockDevice {
   readonly name: string;
   readonly sectorSize: number;
   readonly sectorCount: number;
+  readonly clusterSize: number;
+  /** Codec and zstd level for clusters written through this mount. */
+  algorithm: CompressionAlgorithm;
+  level: number;
+  stats: CompressedDeviceStats = {
+    reads: 0, writes: 0, hits: 0, misses: 0, innerReads: 0, innerWrites: 0,
+    bytesRead: 0, bytesWritten: 0, clustersWritten: 0, rawClusters: 0, evictions: 0,
+  };
+
+  private _spc: number;                       // sectors per cluster
+  private _nclusters: number;
+  private _index: Uint32Array;                // [lba, len | codec << 24] per cluster
+  private _indexLba: number;
+  private _indexDirty = new Set<number>();    // index sectors to persist
+  private _version: Uint32Array;              // bumped whenever a cluster moves
+  private _dataLba: number;
+  private _generation: number;
+  private _free: number[] = [];               // sorted [start, count, start, count, …]
+  private _cache = new Map<number, Cluster>();  // insertion order = LRU order
+  private _maxCached: number;
+  private _writing = new Map<number, Cluster>();
+  private _spare: Uint8Array[] = [];
+  private _scratch: Uint8Array;
+  private _sb: Uint8Array;
+
+  private constructor(private _inner: BlockDevice, sb: Uint8Array, opts: CompressedDeviceOptions) {
+    var dv = new DataView(sb.buffer, sb.byteOffset, sb.byteLength);
+    this.name        = `compressed(${_inner.name})`;
+    this.sectorSize  = _inner.sectorSize;
+    this.clusterSize = 1 << sb[CBD_CLUSTER_LOG];
+    this.sectorCount = dv.getUint32(CBD_LOGICAL_LO, true) + dv.getUint32(CBD_LOGICAL_HI, true) * 4294967296;
+    this.algorithm   = opts.algorithm || ALG_NAMES[sb[CBD_ALG]] || 'lz4';
+    this.level       = Math.max(ZSTD_MIN_LEVEL, Math.min(ZSTD_MAX_LEVEL, opts.level || sb[CBD_LEVEL] || 3));
+    this._spc        = this.clusterSize / this.sectorSize;
+    this._nclusters  = Math.ceil(this.sectorCount / this._spc);
+    this._index      = new Uint32Array(this._nclusters * 2);
+    this._version    = new Uint32Array(this._nclusters);
+    this._indexLba   = dv.getUint32(CBD_INDEX_LBA, true);
+    this._dataLba    = dv.getUint32(CBD_DATA_LBA, true);
+    this._generation = dv.getUint32(CBD_GENERATION, true);
+    this._maxCached  = Math.max(2, Math.floor((opts.cacheBytes || DEFAULT_CACHE) / this.clusterSize));
+    this._scratch    = new Uint8Array(lz4CompressBound(this.clusterSize) + this.sectorSize);
+    this._sb         = sb.slice(0, this.sectorSize);
+  }
+
+  /**
+   * Mount a compressed device on `inner`, formatting it first when it has
+   * no valid superblock (unless `opts.format` is false).
+   */
+  static async open(inner: BlockDevice, opts: CompressedDeviceOptions = {}): Promise<CompressedBlockDevice> {
+    var sb = await inner.readSectors(0, 1);
+    if (!CompressedBlockDevice._validSuperblock(sb)) {
+      if (opts.format === false) throw new Error(`${inner.name}: no compressed-device superblock`);
+      return CompressedBlockDevice.format(inner, opts);
+    }
+    var dev = new CompressedBlockDevice(inner, sb, opts);
+    await dev._loadIndex();
+    return dev;
+  }
+
+  /** Write an empty compressed device (all holes) onto `inner` and mount it. */
+  static async format(inner: BlockDevice, opts: CompressedDeviceOptions = {}): Promise<CompressedBlockDevice> {
+    var ss = inner.sectorSize;
+    var cs = opts.clusterSize || DEFAULT_CLUSTER;
+    if (cs & (cs - 1) || cs < 4096 || cs > (1 << 20) || cs < ss) throw new Error('CompressedBlockDevice: bad cluster size');
+    var logical = opts.logicalSectors || inner.sectorCount;
+    var nclusters = Math.ceil(logical / (cs / ss));
+    var indexSects = Math.ceil(nclusters * 8 / ss);
+    if (1 + indexSects >= inner.sectorCount) throw new Error('CompressedBlockDevice: device too small');
+    var sb = new Uint8Array(ss);
+    var dv = new DataView(sb.buffer);
+    dv.setUint32(0, CBD_MAGIC, true);
+    dv.setUint16(4, CBD_VERSION, true);
+    sb[CBD_ALG] = ALG_IDS[opts.algorithm || 'lz4'];
+    sb[CBD_LEVEL] = opts.level || 3;
+    sb[CBD_CLUSTER_LOG] = 31 - Math.clz32(cs);
+    dv.setUint32(CBD_LOGICAL_LO, logical >>> 0, true);
+    dv.setUint32(CBD_LOGICAL_HI, Math.floor(logical / 4294967296), true);
+    dv.setUint32(CBD_INDEX_LBA, 1, true);
+    dv.setUint32(CBD_INDEX_SECTS, indexSects, true);
+    dv.setUint32(CBD_DATA_LBA, 1 + indexSects, true);
+    dv.setUint32(CBD_CRC, crc32c(0, sb, 0, CBD_CRC), true);
+    // zero the index in cluster-sized writes
+    var zeros = new Uint8Array(Math.min(indexSects, 128) * ss);
+    for (var s = 0; s < indexSects; s += 128) {
+      var n = Math.min(128, indexSects - s);
+      if (await inner.writeSectors(1 + s, n === 128 ? zeros : zeros.subarray(0, n * ss)) < 0) {
+        throw new Error(`${inner.name}: write failed`);
+      }
+    }
+    if (await inner.writeSectors(0, sb) < 0) throw new Error(`${inner.name}: write failed`);
+    var dev = new CompressedBlockDevice(inner, sb, opts);
+    dev._rebuildFreeList();
+    return dev;
+  }
 
-  constructor(private _inner: BlockDevice) {
-    this.name = `compressed(${_inner.name})`;
-    this.sectorSize = _inner.sectorSize;
-    this.sectorCount = _inner.sectorCount;
+  private static _validSuperblock(sb: Uint8Array): boolean {
+    if (sb.length < 64) return false;
+    var dv = new DataView(sb.buffer, sb.byteOffset, sb.byteLength);
+    return dv.getUint32(0, true) === CBD_MAGIC &&
+           dv.getUint16(4, true) === CBD_VERSION &&
+           dv.getUint32(CBD_CRC, true) === crc32c(0, sb, 0, CBD_CRC);
+  }
+
+  private async _loadIndex(): Promise<void> {
+    var ss = this.sectorSize;
+    var sects = Math.ceil(this._nclusters * 8 / ss);
+    var raw = await this._inner.readSectors(this._indexLba, sects);
+    var dv = new DataView(raw.buffer, raw.byteOffset, raw.byteLength);
+    for (var i = 0; i < this._index.length; i++) this._index[i] = dv.getUint32(i * 4, true);
+    this._rebuildFreeList();
+  }
+
+  /** Free extents = the data area minus every cluster's extent. */
+  private _rebuildFreeList(): void {
+    var used: number[][] = [];
+    for (var c = 0; c < this._nclusters; c++) {
+      var lba = this._index[2 * c];
+      if (lba) used.push([lba, this._sectorsFor(this._index[2 * c + 1] & LEN_MASK)]);
+    }
+    used.sort(function(a, b) { return a[0] - b[0]; });
+    this._free = [];
+    var at = this._dataLba;
+    for (var u of used) {
+      if (u[0] > at) this._free.push(at, u[0] - at);
+      at = Math.max(at, u[0] + u[1]);
+    }
+    if (this._inner.sectorCount > at) this._free.push(at, this._inner.sectorCount - at);
+  }
+
+  private _sectorsFor(bytes: number): number {
+    return Math.ceil(bytes / this.sectorSize);
+  }
+
+  /** First-fit allocation of `n` physical sectors; -1 when full. */
+  private _alloc(n: number): number {
+    var f = this._free;
+    for (var i = 0; i < f.length; i += 2) {
+      if (f[i + 1] < n) continue;
+      var lba = f[i];
+      if (f[i + 1] === n) f.splice(i, 2);
+      else { f[i] += n; f[i + 1] -= n; }
+      return lba;
+    }
+    return -1;
+  }
+
+  private _release(lba: number, n: number): void {
+    if (!lba || !n) return;
+    var f = this._free, i = 0;
+    while (i < f.length && f[i] < lba) i += 2;
+    f.splice(i, 0, lba, n);
+    // merge with the following extent, then with the preceding one
+    if (i + 2 < f.length && lba + n === f[i + 2]) { f[i + 1] += f[i + 3]; f.splice(i + 2, 2); }
+    if (i > 0 && f[i - 2] + f[i - 1] === lba) { f[i - 1] += f[i + 1]; f.splice(i, 2); }
+  }
+
+  // ── Cache ──
+
+  private _buffer(): Uint8Array {
+    return this._spare.pop() || new Uint8Array(this.clusterSize);
+  }
+
+  private _lookup(idx: number): Cluster | null {
+    var c = this._cache.get(idx) || this._writing.get(idx);
+    if (!c) return null;
+    this._cache.delete(idx);                  // move to the MRU end
+    this._cache.set(idx, c);
+    this.stats.hits++;
+    return c;
+  }
+
+  /** Insert a freshly loaded cluster unless a writer got there first. */
+  private _insert(c: Cluster): Cluster {
+    var have = this._cache.get(c.idx) || this._writing.get(c.idx);
+    if (have) { this._spare.push(c.data); return have; }
+    this._cache.set(c.idx, c);
+    return c;
+  }
+
+  /**
+   * Write back the oldest dirty clusters beyond MAX_DIRTY, then evict
+   * unpinned clusters from the LRU end down to the byte budget.  Called
+   * once a request is done with its clusters, so the cache may briefly
+   * hold more than the budget.
+   */
+  private async _trim(): Promise<void> {
+    var dirty: Cluster[] = [];
+    this._cache.forEach(function(c) { if (c.dirty) dirty.push(c); });
+    for (var i = 0; i + MAX_DIRTY < dirty.length; i++) await this._writeBack(dirty[i]);
+    while (this._cache.size > this._maxCached) {
+      var victim: Cluster | null = null;
+      for (var c of this._cache.values()) if (!c.pins) { victim = c; break; }
+      if (!victim) return;                    // all in use: over budget for now
+      if (victim.dirty) { await this._writeBack(victim); continue; }   // then look again
+      this._cache.delete(victim.idx);
+      this.stats.evictions++;
+    }
+  }
+
+  /** Decompress a stored cluster into `dst`. */
+  private _decode(idx: number, stored: Uint8Array, dst: Uint8Array): void {
+    var info = this._index[2 * idx + 1];
+    var len = info & LEN_MASK, codec = info >>> 24;
+    var src = stored.subarray(0, len);
+    var n: number;
+    if (codec === CODEC_RAW) { dst.set(src); n = len; }
+    else if (codec === CODEC_LZ4) n = lz4DecompressInto(src, dst);
+    else if (codec === CODEC_ZSTD) n = zstdDecompressInto(src, dst);
+    else n = -1;
+    if (n !== this.clusterSize) throw new Error(`${this.name}: cluster ${idx} is corrupt`);
+  }
+
+  /**
+   * Clusters [first, last] in the cache, loading misses, each pinned for
+   * the caller (who unpins).  Runs of misses whose extents are adjacent on
+   * disk are read with one inner request.
+   */
+  private async _load(first: number, last: number): Promise<Cluster[]> {
+    var out: Cluster[] = [];
+    var idx = first;
+    while (idx <= last) {
+      var hit = this._lookup(idx);
+      if (hit) { hit.pins++; out.push(hit); idx++; continue; }
+      this.stats.misses++;
+      var lba = this._index[2 * idx];
+      if (!lba) {                             // hole
+        var z = this._buffer();
+        z.fill(0);
+        var h = this._insert({ idx: idx, data: z, dirty: false, pins: 0 });
+        h.pins++;
+        out.push(h);
+        idx++;
+        continue;
+      }
+      // extend the run while the next cluster is a miss stored right after
+      var run = [idx], sects = this._sectorsFor(this._index[2 * idx + 1] & LEN_MASK);
+      while (run[run.length - 1] < last && sects < 256) {
+        var nx = run[run.length - 1] + 1;
+        if (this._cache.has(nx) || this._writing.has(nx) || this._index[2 * nx] !== lba + sects) break;
+        run.push(nx);
+        this.stats.misses++;
+        sects += this._sectorsFor(this._index[2 * nx + 1] & LEN_MASK);
+      }
+      var versions = run.map((ci) => this._version[ci]);
+      var raw = await this._inner.readSectors(lba, sects);
+      this.stats.innerReads++;
+      this.stats.bytesRead += raw.length;
+      var at = 0;
+      for (var k = 0; k < run.length; k++) {
+        var ci = run[k];
+        var c: Cluster;
+        if (this._version[ci] !== versions[k]) {
+          // written back while we waited: take the newer copy instead
+          c = (await this._load(ci, ci))[0];
+        } else {
+          c = { idx: ci, data: this._buffer(), dirty: false, pins: 0 };
+          this._decode(ci, raw.subarray(at), c.data);
+          c = this._insert(c);
+          c.pins++;
+        }
+        out.push(c);
+        at += this._sectorsFor(this._index[2 * ci + 1] & LEN_MASK) * this.sectorSize;
+      }
+      idx = run[run.length - 1] + 1;
+    }
+    return out;
+  }
+
+  /** Compress a dirty cluster and write it to (possibly new) disk space. */
+  private async _writeBack(c: Cluster): Promise<void> {
+    if (!c.dirty) return;
+    c.dirty = false;
+    this._writing.set(c.idx, c);
+    try {
+      var data = c.data, cs = this.clusterSize, ss = this.sectorSize;
+      var zero = true;
+      for (var i = 0; i < cs && zero; i += 4) {
+        if (data[i] | data[i + 1] | data[i + 2] | data[i + 3]) zero = false;
+      }
+      var oldLba = this._index[2 * c.idx], oldSects = oldLba ? this._sectorsFor(this._index[2 * c.idx + 1] & LEN_MASK) : 0;
+      if (zero) {
+        this._setIndex(c.idx, 0, 0);
+        this._release(oldLba, oldSects);
+        return;
+      }
+      var codec = ALG_IDS[this.algorithm], len = -1, body: Uint8Array = this._scratch;
+      if (codec === CODEC_LZ4) {
+        len = lz4CompressInto(data, this._scratch);
+      } else if (codec === CODEC_ZSTD) {
+        body = zstdCompress(data, this.level);
+        len = body.length;
+      }
+      if (len < 0 || this._sectorsFor(len) >= cs / ss) { codec = CODEC_RAW; body = data; len = cs; this.stats.rawClusters++; }
+      var sects = this._sectorsFor(len);
+      var lba: number;
+      if (oldLba && sects <= oldSects) {
+        lba = oldLba;                        // fits in place; give back the tail
+        this._release(oldLba + sects, oldSects - sects);
+      } else {
+        lba = this._alloc(sects);
+        if (lba < 0) { c.dirty = true; throw new Error(`${this.name}: out of space`); }
+        this._release(oldLba, oldSects);
+      }
+      // the inner device may hold on to the buffer: never hand it _scratch
+      var buf = body;
+      if (body === this._scratch || len !== sects * ss) {
+        buf = new Uint8Array(sects * ss);
+        buf.set(body.subarray(0, len));
+      } else if (len !== body.length) {
+        buf = body.subarray(0, len);
+      }
+      this._setIndex(c.idx, lba, len | (codec << 24));
+      var r = await this._inner.writeSectors(lba, buf);
+      this.stats.innerWrites++;
+      this.stats.bytesWritten += buf.length;
+      this.stats.clustersWritten++;
+      if (r < 0) { c.dirty = true; throw new Error(`${this.name}: write failed`); }
+    } finally {
+      if (this._writing.get(c.idx) === c) this._writing.delete(c.idx);
+    }
+  }
+
+  private _setIndex(idx: number, lba: number, info: number): void {
+    this._version[idx]++;
+    this._index[2 * idx] = lba;
+    this._index[2 * idx + 1] = info;
+    this._indexDirty.add(Math.floor(idx * 8 / this.sectorSize));
+  }
+
+  // ── BlockDevice ──
+
+  private _check(lba: number, count: number): void {
+    if (lba < 0 || count < 0 || lba + count > this.sectorCount) {
+      throw new Error(`${this.name}: sectors ${lba}+${count} beyond end (${this.sectorCount})`);
+    }
   }
 
   async readSectors(lba: number, count: number): Promise<Uint8Array> {
-    const raw = await this._inner.readSectors(lba, count);
-    return this._decompress(raw);
+    this._check(lba, count);
+    this.stats.reads++;
+    var ss = this.sectorSize, spc = this._spc;
+    var out = new Uint8Array(count * ss);
+    if (!count) return out;
+    var first = Math.floor(lba / spc), last = Math.floor((lba + count - 1) / spc);
+    var clusters = await this._load(first, last);
+    for (var k = 0; k < clusters.length; k++) {
+      var cStart = (first + k) * spc;
+      var from = Math.max(lba, cStart), to = Math.min(lba + count, cStart + spc);
+      out.set(clusters[k].data.subarray((from - cStart) * ss, (to - cStart) * ss), (from - lba) * ss);
+      clusters[k].pins--;
+    }
+    await this._trim();
+    return out;
   }
 
   async writeSectors(lba: number, data: Uint8Array): Promise<number> {
-    const compressed = this._compress('lz4', data);
-    return this._inner.writeSectors(lba, compressed);
+    var ss = this.sectorSize, spc = this._spc;
+    var count = Math.ceil(data.length / ss);
+    this._check(lba, count);
+    this.stats.writes++;
+    var end = lba + count;
+    for (var s = lba; s < end; ) {
+      var idx = Math.floor(s / spc), cStart = idx * spc;
+      var to = Math.min(end, cStart + spc);
+      var c = this._lookup(idx);
+      if (!c && s === cStart && to === cStart + spc) {
+        // whole-cluster overwrite: no need to read the old contents
+        c = { idx: idx, data: this._buffer(), dirty: false, pins: 0 };
+        this._cache.set(idx, c);
+      } else if (!c) {
+        c = (await this._load(idx, idx))[0];
+        c.pins--;                             // modified below without yielding
+      }
+      var src = data.subarray((s - lba) * ss, (to - lba) * ss);
+      c.data.set(src, (s - cStart) * ss);
+      if (src.length < (to - s) * ss) c.data.fill(0, (s - cStart) * ss + src.length, (to - cStart) * ss);
+      c.dirty = true;
+      s = to;
+    }
+    try {
+      await this._trim();
+    } catch (_) {
+      return -1;
+    }
+    return 0;
+  }
+
+  /** Write back dirty clusters, then the changed index sectors and the superblock. */
+  async flush(): Promise<number> {
+    try {
+      for (var c of Array.from(this._cache.values())) if (c.dirty) await this._writeBack(c);
+    } catch (_) {
+      return -1;
+    }
+    if (!this._indexDirty.size) return 0;
+    var ss = this.sectorSize;
+    var sectors = Array.from(this._indexDirty).sort(function(a, b) { return a - b; });
+    this._indexDirty.clear();
+    var buf = new Uint8Array(ss);
+    var dv = new DataView(buf.buffer);
+    var perSector = ss / 4;
+    for (var sec of sectors) {
+      buf.fill(0);
+      for (var i = 0; i < perSector; i++) {
+        var e = sec * perSector + i;
+        if (e < this._index.length) dv.setUint32(i * 4, this._index[e], true);
+      }
+      if (await this._inner.writeSectors(this._indexLba + sec, buf) < 0) return -1;
+      this.stats.innerWrites++;
+    }
+    var sb = this._sb;
+    var sdv = new DataView(sb.buffer, sb.byteOffset, sb.byteLength);
+    sb[CBD_ALG] = ALG_IDS[this.algorithm];
+    sb[CBD_LEVEL] = this.level;
+    sdv.setUint32(CBD_GENERATION, ++this._generation, true);
+    sdv.setUint32(CBD_CRC, crc32c(0, sb, 0, CBD_CRC), true);
+    return this._inner.writeSectors(0, sb);
   }
 
-  private _decompress(data: Uint8Array): Uint8Array {
-    const hdr = parseSectorHeader(data);
-    if (!hdr || hdr.algorithm === 'none') return data.slice(12);
-    const payload = data.slice(12, 12 + hdr.compressedSize);
-    if (hdr.algorithm === 'lz4') return lz4Decompress(payload, hdr.originalSize);
-    if (hdr.algorithm === 'zstd') return zstdDecompress(payload) ?? payload;
-    return payload;
+  /** Drop clean clusters from the cache (dirty ones stay until flush()). */
+  dropCache(): void {
+    var self = this;
+    this._cache.forEach(function(c, idx) { if (!c.dirty) self._cache.delete(idx); });
   }
 
-  private _compress(algorithm: CompressionAlgorithm, data: Uint8Array): Uint8Array {
-    const compressed = algorithm === 'lz4' ? lz4Compress(data) : data;
-    const hdr = new Uint8Array(12);
-    const dv = new DataView(hdr.buffer);
-    const magic = algorithm === 'lz4' ? 0x4c5a : algorithm === 'zstd' ? 0x5a53 : 0x4e4f;
-    dv.setUint16(0, magic, true);
-    dv.setUint16(2, 1, true);  // version
-    dv.setUint32(4, data.length, true);
-    dv.setUint32(8, compressed.length, true);
-    const out = new Uint8Array(12 + compressed.length);
-    out.set(hdr); out.set(compressed, 12);
-    return out;
+  /** Space accounting: logical vs physical bytes of the clusters in use. */
+  usage(): { clusters: number; holes: number; logicalBytes: number; storedBytes: number; ratio: number } {
+    var used = 0, stored = 0;
+    for (var c = 0; c < this._nclusters; c++) {
+      if (!this._index[2 * c]) continue;
+      used++;
+      stored += this._sectorsFor(this._index[2 * c + 1] & LEN_MASK) * this.sectorSize;
+    }
+    var logical = used * this.clusterSize;
+    return { clusters: used, holes: this._nclusters - used, logicalBytes: logical,
+             storedBytes: stored, ratio: stored ? logical / stored : 1 };
   }
 }
 
@@ -271,33 +723,39 @@ export class CompressedBlockDevice implements BlockDevice {
 // ────────────────────────────────────────────────────────────────────────────
 
 interface FSCompression {
-  compress(algorithm: CompressionAlgorithm, data: Uint8Array): Uint8Array;
+  /** Compress with `algorithm`; `level` selects the zstd level (default 3). */
+  compress(algorithm: CompressionAlgorithm, data: Uint8Array, level?: number): Uint8Array;
   decompress(algorithm: CompressionAlgorithm, data: Uint8Array, maxOutput?: number): Uint8Array | null;
-  wrapDevice(dev: BlockDevice): CompressedBlockDevice;
+  /** Mount (formatting if needed) a compressed device on `dev`. */
+  wrapDevice(dev: BlockDevice, opts?: CompressedDeviceOptions): Promise<CompressedBlockDevice>;
   detectAlgorithm(data: Uint8Array): CompressionAlgorithm;
 }
 
 export const fsCompression: FSCompression = {
-  compress(algorithm, data) {
+  compress(algorithm, data, level = 3) {
     if (algorithm === 'lz4') return lz4Compress(data);
-    // zstd compression not yet implemented — fall back to uncompressed
+    if (algorithm === 'zstd') return zstdCompress(data, level);
     return data;
   },
 
   decompress(algorithm, data, maxOutput = data.length * 4) {
-    if (algorithm === 'lz4') return lz4Decompress(data, maxOutput);
+    if (algorithm === 'lz4') {
+      const out = new Uint8Array(maxOutput);
+      const n = lz4DecompressInto(data, out);
+      return n < 0 ? null : out.subarray(0, n);
+    }
     if (algorithm === 'zstd') return zstdDecompress(data);
     return data;
   },
 
-  wrapDevice(dev) { return new CompressedBlockDevice(dev); },
+  wrapDevice(dev, opts) { return CompressedBlockDevice.open(dev, opts); },
 
   detectAlgorithm(data) {
     if (data.length < 4) return 'none';
     const magic32 = (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24)) >>> 0;
     if (magic32 === ZSTD_MAGIC) return 'zstd';
-    // LZ4 frame magic: 0x04224D18
-    if (magic32 === 0x04224d18) return 'lz4';
+    // LZ4 frame magic: 0x184D2204 (bytes 04 22 4D 18)
+    if (magic32 === 0x184d2204) return 'lz4';
     return 'none';
   },
 };
@@ -3,9 +3,17 @@
  *
  * Implements:
  *  - CPIO "newc" archive format parser (item 168)
- *  - Loads files from the embedded initramfs image into the VFS at boot
- *  - The initramfs is embedded in the ISO as a contiguous byte range and
- *    accessible via kernel.readInitramfs(offset, length)
+ *  - Streaming, lazily materialised unpacking:
+ *      · the image comes from the GRUB initramfs module in place
+ *        (kernel.getInitramfs(), no copy) and may be gzip, LZ4 (frame or
+ *        the kernel's legacy format) or plain cpio — decompress-stream.ts;
+ *      · InitramfsLoader.step() decodes a slice of the image and installs
+ *        every cpio entry that is complete, so main.ts runs it as a
+ *        coroutine alongside the rest of boot instead of gating on it;
+ *      · regular files are not copied: each becomes a copy-on-write
+ *        FileData view of the (decompressed) archive, materialised only
+ *        if something writes to it.  Text is decoded on first read.
+ *  - Concatenated archives (as the kernel accepts) and hard links.
  *
  * Format: Linux "newc" CPIO (magic "070701")
  *   Each entry:
@@ -14,13 +22,18 @@
  *     file data (filesize bytes, padded to 4-byte boundary)
  *
  * Usage:
- *   import { loadInitramfs } from './initramfs.js';
- *   loadInitramfs(fs);
+ *   import { openInitramfs } from './initramfs.js';
+ *   var l = openInitramfs(fs);          // null: no module
+ *   while (l && l.step()) { ...other boot work... }
+ *   l.finish();                          // drain the rest synchronously
  *
  * Item 168.
  */
 
 import type { FileSystem } from './filesystem.js';
+import { FileData } from './filedata.js';
+import { utf8Decode } from '../core/ringbuf.js';
+import { type DecompressStream, openDecompressStream } from './decompress-stream.js';
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
@@ -33,6 +46,16 @@ const CPIO_HEADER_LEN = 110;
 /** Sentinel filename that marks end of archive. */
 const CPIO_EOF_NAME = 'TRAILER!!!';
 
+/** Archive bytes decoded (or, uncompressed, walked) per step(). */
+export const INITRAMFS_SLICE = 256 * 1024;
+/** Entries installed per step() at most. */
+const STEP_ENTRIES = 256;
+
+const S_IFMT  = 0o170000;
+const S_IFDIR = 0o040000;
+const S_IFREG = 0o100000;
+const S_IFLNK = 0o120000;
+
 // ── CPIOHeader ────────────────────────────────────────────────────────────────
 
 interface CPIOHeader {
@@ -56,16 +79,19 @@ function parseCpioHeader(buf: Uint8Array, offset: number): CPIOHeader | null {
   if (offset + CPIO_HEADER_LEN > buf.length) return null;
 
   // Magic check
-  var magic = String.fromCharCode(
-    buf[offset], buf[offset+1], buf[offset+2],
-    buf[offset+3], buf[offset+4], buf[offset+5]
-  );
-  if (magic !== CPIO_MAGIC) return null;
+  for (var m = 0; m < 6; m++) {
+    if (buf[offset + m] !== CPIO_MAGIC.charCodeAt(m)) return null;
+  }
 
   // Parse 13 hex fields of 8 chars each, starting at offset+6
   function hex8(pos: number): number {
-    var _ifb = buf.slice(offset + pos, offset + pos + 8); var s = ''; for (var _ifi = 0; _ifi < _ifb.length; _ifi++) s += String.fromCharCode(_ifb[_ifi]!);
-    return parseInt(s, 16) || 0;
+    var v = 0;
+    for (var i = offset + pos; i < offset + pos + 8; i++) {
+      var c = buf[i];
+      var d = c >= 0x30 && c <= 0x39 ? c - 0x30 : (c | 0x20) >= 0x61 && (c | 0x20) <= 0x66 ? (c | 0x20) - 0x57 : 0;
+      v = v * 16 + d;
+    }
+    return v;
   }
 
   return {
@@ -97,72 +123,180 @@ export interface InitramfsResult {
   dirsCreated:  number;
   bytesTotal:   number;
   errors:       string[];
+  /** Container format of the image ('none' = plain cpio). */
+  format?:      string;
+  /** Archive bytes after decompression. */
+  archiveBytes?: number;
 }
 
 /**
- * Parse a CPIO newc archive from `data` and load all files into `fs`.
- * Existing files are overwritten.
- *
- * Item 168: initramfs: embed initial filesystem image in ISO.
+ * Incremental cpio unpacker over a (possibly compressed) image.  Entries
+ * are installed into `fs` as soon as their bytes have been decoded; file
+ * bodies are copy-on-write views of the archive.  Existing files are
+ * overwritten.
  */
-export function parseCpioArchive(data: Uint8Array, fs: FileSystem): InitramfsResult {
-  var result: InitramfsResult = { filesLoaded: 0, dirsCreated: 0, bytesTotal: 0, errors: [] };
-  var pos = 0;
-
-  while (pos < data.length) {
-    // Parse header
-    var hdr = parseCpioHeader(data, pos);
-    if (!hdr) {
-      result.errors.push(`Bad CPIO header at offset ${pos}`);
-      break;
-    }
-    pos += CPIO_HEADER_LEN;
-
-    // Read filename
-    var nameEnd = pos + hdr.namesize;
-    var nameBytes = data.slice(pos, nameEnd);
-    var name = '';
-    for (var i = 0; i < nameBytes.length && nameBytes[i] !== 0; i++) {
-      name += String.fromCharCode(nameBytes[i]);
+export class InitramfsLoader {
+  readonly result: InitramfsResult = { filesLoaded: 0, dirsCreated: 0, bytesTotal: 0, errors: [] };
+  private _fs:      FileSystem;
+  private _stream:  DecompressStream;
+  private _pos      = 0;
+  private _done     = false;
+  /** Between archives: zero padding may follow a trailer. */
+  private _afterTrailer = false;
+  /** Hard links: ino → names seen without data (newc puts data on the last). */
+  private _links = new Map<number, string[]>();
+
+  constructor(image: Uint8Array, fs: FileSystem) {
+    this._fs = fs;
+    this._stream = openDecompressStream(image);
+    this.result.format = this._stream.format;
+  }
+
+  get done(): boolean { return this._done; }
+
+  /**
+   * Decode about `budget` more archive bytes and install what is complete.
+   * Returns true while work remains.
+   */
+  step(budget: number = INITRAMFS_SLICE): boolean {
+    if (this._done) return false;
+    var more: boolean;
+    try {
+      more = this._stream.pump(budget);
+    } catch (e: any) {
+      this.result.errors.push(`Decompression failed: ${e?.message ?? e}`);
+      more = false;
     }
-    pos = alignUp(pos + hdr.namesize, 4);
+    var parsed = this._parse(more ? Infinity : budget);
+    if (!more && !parsed) this._finish();
+    return !this._done;
+  }
 
-    // EOF sentinel
-    if (name === CPIO_EOF_NAME) break;
+  /** Unpack everything that is left. */
+  finish(): InitramfsResult {
+    while (this.step(Infinity)) { /* drain */ }
+    return this.result;
+  }
 
-    // File content
-    var fileData = data.slice(pos, pos + hdr.filesize);
-    pos = alignUp(pos + hdr.filesize, 4);
+  /**
+   * Install complete entries, up to `budget` archive bytes (and
+   * STEP_ENTRIES entries).  Returns true if it stopped on a limit rather
+   * than on missing input.
+   */
+  private _parse(budget: number): boolean {
+    var out = this._stream.out;
+    var limit = this._pos + budget;
+    for (var n = 0; n < STEP_ENTRIES; n++) {
+      if (this._pos >= limit) return true;
+      var buf = out.buf, avail = out.len, pos = this._pos;
+      if (this._afterTrailer) {
+        while (pos < avail && buf[pos] === 0) pos++;
+        this._pos = pos;
+        if (pos >= avail) return false;
+      }
+      if (pos + CPIO_HEADER_LEN > avail) return false;
+      var hdr = parseCpioHeader(buf, pos);
+      if (!hdr) {
+        this.result.errors.push(`Bad CPIO header at offset ${pos}`);
+        this._pos = avail;
+        this._finish();
+        return false;
+      }
+      var nameStart = pos + CPIO_HEADER_LEN;
+      var dataStart = alignUp(nameStart + hdr.namesize, 4);
+      var dataEnd   = dataStart + hdr.filesize;
+      if (dataEnd > avail) return false;
+      this._pos = alignUp(dataEnd, 4);
+      this._afterTrailer = false;
+
+      var nameLen = hdr.namesize;
+      while (nameLen > 0 && buf[nameStart + nameLen - 1] === 0) nameLen--;
+      var name = utf8Decode(buf.subarray(nameStart, nameStart + nameLen));
+      if (name === CPIO_EOF_NAME) {
+        this._flushLinks();
+        this._afterTrailer = true;
+        continue;
+      }
+      this._install(name, hdr, buf.subarray(dataStart, dataEnd));
+    }
+    return true;
+  }
 
+  private _install(name: string, hdr: CPIOHeader, data: Uint8Array): void {
+    if (name.startsWith('./')) name = name.substring(1);
+    if (name === '.' || name === '/' || name === '') return;
     // Ensure leading slash for VFS
     if (!name.startsWith('/')) name = '/' + name;
-
-    // Mode bits: S_IFDIR = 0o40000, S_IFREG = 0o100000
-    var isDir  = (hdr.mode & 0o170000) === 0o040000;
-    var isFile = (hdr.mode & 0o170000) === 0o100000;
-
+    var fs = this._fs;
+    var type = hdr.mode & S_IFMT;
     try {
-      if (isDir) {
+      if (type === S_IFDIR) {
         // Create directory (mkdir -p)
         _mkdirP(fs, name);
-        result.dirsCreated++;
-      } else if (isFile) {
+        this.result.dirsCreated++;
+      } else if (type === S_IFREG) {
         // Ensure parent directory exists
-        var parent = name.substring(0, name.lastIndexOf('/')) || '/';
-        _mkdirP(fs, parent);
-
-        // Decode as UTF-8 text or store raw bytes
-        var text = _decodeUTF8(fileData);
-        fs.writeFile(name, text);
-        result.filesLoaded++;
-        result.bytesTotal += hdr.filesize;
+        _mkdirP(fs, name.substring(0, name.lastIndexOf('/')) || '/');
+        if (hdr.nlink > 1 && hdr.filesize === 0) {
+          var names = this._links.get(hdr.ino);
+          if (!names) this._links.set(hdr.ino, names = []);
+          names.push(name);
+          return;
+        }
+        // Lazy body: a view of the archive, copied only on write
+        fs.installFileData(name, FileData.fromView(data));
+        this.result.filesLoaded++;
+        this.result.bytesTotal += hdr.filesize;
+        if (hdr.nlink > 1) {
+          var others = this._links.get(hdr.ino);
+          this._links.delete(hdr.ino);
+          if (others) for (var i = 0; i < others.length; i++) {
+            if (fs.exists(others[i])) fs.rm(others[i]);
+            if (fs.link(name, others[i])) this.result.filesLoaded++;
+          }
+        }
+      } else if (type === S_IFLNK) {
+        _mkdirP(fs, name.substring(0, name.lastIndexOf('/')) || '/');
+        fs.symlink(utf8Decode(data), name);
       }
+      // Device nodes, FIFOs and sockets have no place in the VFS tree
     } catch (e: any) {
-      result.errors.push(`Failed to install ${name}: ${e?.message ?? e}`);
+      this.result.errors.push(`Failed to install ${name}: ${e?.message ?? e}`);
     }
   }
 
-  return result;
+  /** Hard-link groups whose data never came: install them as empty files. */
+  private _flushLinks(): void {
+    var fs = this._fs, r = this.result;
+    this._links.forEach(function(names) {
+      for (var i = 0; i < names.length; i++) {
+        if (i === 0 ? fs.installFileData(names[0], new FileData()) : fs.link(names[0], names[i])) r.filesLoaded++;
+      }
+    });
+    this._links.clear();
+  }
+
+  private _finish(): void {
+    if (this._done) return;
+    this._flushLinks();
+    var out = this._stream.out;
+    if (!this._afterTrailer && this._pos < out.len && !this.result.errors.length) {
+      this.result.errors.push(`Truncated CPIO archive at offset ${this._pos}`);
+    }
+    this.result.archiveBytes = out.len;
+    this._done = true;
+  }
+}
+
+/**
+ * Parse a CPIO newc archive (optionally gzip / LZ4 compressed) from `data`
+ * and load all files into `fs`, synchronously.  File bodies alias `data`
+ * (copy-on-write).  Existing files are overwritten.
+ *
+ * Item 168: initramfs: embed initial filesystem image in ISO.
+ */
+export function parseCpioArchive(data: Uint8Array, fs: FileSystem): InitramfsResult {
+  return new InitramfsLoader(data, fs).finish();
 }
 
 /** Recursively create directory and all parents. */
@@ -175,25 +309,25 @@ function _mkdirP(fs: FileSystem, dirPath: string): void {
   }
 }
 
-/** Decode a Uint8Array as UTF-8 text. Falls back to Latin-1 if invalid. */
-function _decodeUTF8(bytes: Uint8Array): string {
-  try {
-    if (typeof TextDecoder !== 'undefined') {
-      return new TextDecoder('utf-8', { fatal: false }).decode(bytes);
-    }
-  } catch (_) {}
-  // Fallback: Latin-1 byte-by-byte
-  var s = '';
-  for (var i = 0; i < bytes.length; i++) s += String.fromCharCode(bytes[i]);
-  return s;
-}
-
 // ── Kernel integration ────────────────────────────────────────────────────────
 
 /**
- * Load the embedded initramfs from the kernel's embedded image table.
- * The kernel makes the initramfs available via `kernel.getInitramfs()` which
- * returns a Uint8Array containing the CPIO archive.
+ * Start unpacking the GRUB initramfs module (kernel.getInitramfs(), an
+ * ArrayBuffer over the module in place).  Returns null when none was
+ * loaded.  Nothing is decoded until the first step().
+ *
+ * Item 168.
+ */
+export function openInitramfs(fs: FileSystem): InitramfsLoader | null {
+  if (typeof kernel === 'undefined' || !kernel.getInitramfs) return null;
+  var buf = kernel.getInitramfs();
+  if (!buf || buf.byteLength === 0) return null;
+  return new InitramfsLoader(new Uint8Array(buf), fs);
+}
+
+/**
+ * Load the whole initramfs synchronously (see openInitramfs() for the
+ * incremental form).  No module is not an error.
  *
  * Item 168.
  */
@@ -201,21 +335,10 @@ export function loadInitramfs(fs: FileSystem): InitramfsResult {
   if (typeof kernel === 'undefined') {
     return { filesLoaded: 0, dirsCreated: 0, bytesTotal: 0, errors: ['kernel not available'] };
   }
-
-  var data: Uint8Array | null = null;
-
-  // The kernel exposes the initramfs as an ArrayBuffer if it was embedded in the ISO
-  if (kernel.getInitramfs) {
-    var buf = kernel.getInitramfs();
-    if (buf) data = new Uint8Array(buf);
-  }
-
-  if (!data || data.length === 0) {
-    // No initramfs embedded — silently succeed (optional component)
-    return { filesLoaded: 0, dirsCreated: 0, bytesTotal: 0, errors: [] };
-  }
-
-  return parseCpioArchive(data, fs);
+  var loader = openInitramfs(fs);
+  // No initramfs embedded — silently succeed (optional component)
+  if (!loader) return { filesLoaded: 0, dirsCreated: 0, bytesTotal: 0, errors: [] };
+  return loader.finish();
 }
 
 // ── CPIO Archive builder ──────────────────────────────────────────────────────
@@ -2,21 +2,41 @@
  * JSOS ISO 9660 Read-Only Filesystem Driver
  *
  * [Item 190] ISO 9660 read — boot media access.
+ *  Extent/path-table caching, Rock Ridge and Joliet names,
+ *            multi-sector reads straight into caller buffers.
  *
  * ISO 9660 (also known as ECMA-119 / CD-ROM File System) stores files in
  * fixed-size 2048-byte logical blocks.  The Primary Volume Descriptor (PVD)
  * sits at LBA 16.  Directories are stored as extents of Directory Records.
  *
- * Also supports Rock Ridge extensions (RR) for long filenames and Unix
- * permissions (detected via 'RR', 'SP', 'NM', 'PX' system-use fields).
+ * Names, in order of preference:
+ *   Rock Ridge — SUSP system-use fields on each record (detected via the
+ *                'SP' entry of the root '.' record): NM long names (UTF-8,
+ *                continued across entries and CE continuation areas), PX
+ *                mode bits, SL symlinks, CL/RE relocated deep directories.
+ *   Joliet     — Supplementary Volume Descriptor with escape sequence
+ *                '%/@', '%/C' or '%/E' (UCS-2 levels 1-3); a second
+ *                directory tree with UCS-2BE names.
+ *   ISO 9660   — 8.3 names, ';1' version and trailing '.' stripped, matched
+ *                case-insensitively.
  *
- * Joliet extensions (UCS-2 long filenames) are detected via the Supplementary
- * Volume Descriptor with escape sequence '\x25\x2F\x45' (Level 3 Joliet).
+ * Caching.  Every directory extent is parsed once into a DirNode (records
+ * plus a name index) and kept in an LRU keyed by extent LBA, so a path
+ * lookup is one Map probe per component once its directories are warm.  On
+ * plain and Joliet volumes the path table is loaded at mount and resolves a
+ * file's parent directory without reading any intermediate extents.
+ *
+ * Reads go through ISO9660Device.readSectors() when the device has it
+ * (storage/atapi.ts: one READ(10) packet per 64 KB): whole files and the
+ * sector-aligned middle of a range land directly in the destination buffer;
+ * only unaligned head/tail sectors are bounced.
  *
  * Implements VFSMount so it can be mounted anywhere in the JSOS VFS tree.
  */
 
 import type { VFSMount, FileType } from './filesystem.js';
+import { FileData } from './filedata.js';
+import { utf8Decode } from '../core/ringbuf.js';
 
 // ── Constants ──────────────────────────────────────────────────────────────────
 
@@ -27,52 +47,108 @@ const VD_TYPE_PRIMARY      = 1;
 const VD_TYPE_SUPPLEMENTARY = 2;
 const VD_TYPE_TERMINATOR    = 255;
 
-// Rock Ridge system-use signatures
-const RR_SIG_NM = 0x4d4e; // 'NM' — alternate name
-const RR_SIG_PX = 0x5850; // 'PX' — POSIX attribs
-const RR_SIG_SL = 0x4c53; // 'SL' — symbolic link
+// Directory record file flags
+const FF_DIRECTORY   = 0x02;
+const FF_ASSOCIATED  = 0x04;
+const FF_MULTIEXTENT = 0x80;
+
+// System Use Sharing Protocol / Rock Ridge signatures
+const SU_SIG_SP = 0x5350; // 'SP' — SUSP indicator (root '.' record)
+const SU_SIG_CE = 0x4345; // 'CE' — continuation area
+const SU_SIG_ST = 0x5354; // 'ST' — terminator
+const RR_SIG_NM = 0x4e4d; // 'NM' — alternate name
+const RR_SIG_PX = 0x5058; // 'PX' — POSIX attribs
+const RR_SIG_SL = 0x534c; // 'SL' — symbolic link
+const RR_SIG_CL = 0x434c; // 'CL' — child link (relocated directory)
+const RR_SIG_RE = 0x5245; // 'RE' — relocated directory (hidden)
+
+/** Parsed directories kept in the extent cache. */
+const DIR_CACHE_MAX = 256;
+/** Continuation areas followed per record before giving up (loop guard). */
+const MAX_CE_CHAIN  = 16;
+/** Bounce / staging buffer: one 64 KB packet. */
+const XFER_SECTORS  = 32;
 
 // ── Block device interface ──────────────────────────────────────────────────────
 
 export interface ISO9660Device {
   /** Read one 2048-byte sector at the given LBA (logical block address). */
   readSector(lba: number): Uint8Array;
+  /**
+   * Optional multi-sector read: `count` sectors from `lba` into `dst` at
+   * byte offset `off`.  Returns false on a device error.
+   */
+  readSectors?(lba: number, count: number, dst: Uint8Array, off: number): boolean;
 }
 
 // ── DataView helpers ────────────────────────────────────────────────────────────
 
-function u8  (dv: DataView, off: number): number { return dv.getUint8(off); }
-function u16L(dv: DataView, off: number): number { return dv.getUint16(off, true); }
-function u32L(dv: DataView, off: number): number { return dv.getUint32(off, true); }
+function u16L(d: Uint8Array, off: number): number { return d[off] | (d[off + 1] << 8); }
+function u32L(d: Uint8Array, off: number): number {
+  return (d[off] | (d[off + 1] << 8) | (d[off + 2] << 16) | (d[off + 3] << 24)) >>> 0;
+}
+
+function latin1(d: Uint8Array, off: number, len: number): string {
+  var s = '';
+  for (var i = 0; i < len; i++) s += String.fromCharCode(d[off + i]);
+  return s;
+}
+
+function ucs2be(d: Uint8Array, off: number, len: number): string {
+  var s = '';
+  for (var i = 0; i + 1 < len; i += 2) s += String.fromCharCode((d[off + i] << 8) | d[off + i + 1]);
+  return s;
+}
+
+/** Strip the ';n' version suffix and the trailing '.' of an extensionless name. */
+function cleanIsoName(name: string): string {
+  var semi = name.indexOf(';');
+  if (semi >= 0) name = name.slice(0, semi);
+  if (name.length > 1 && name.charCodeAt(name.length - 1) === 0x2e) name = name.slice(0, -1);
+  return name;
+}
+
+// ── Volume descriptors ─────────────────────────────────────────────────────────
 
-// ── Primary Volume Descriptor ──────────────────────────────────────────────────
+interface VolumeInfo {
+  rootDirLba:       number;   // location of root directory extent
+  rootDirSize:      number;   // size of root directory extent (bytes)
+  logicalBlockSize: number;   // usually 2048
+  volumeId:         string;
+  pathTableLba:     number;   // L-type (little-endian) path table
+  pathTableSize:    number;
+  joliet:           boolean;
+}
 
-interface PVD {
-  rootDirLba:     number;   // location of root directory extent
-  rootDirSize:    number;   // size of root directory extent (bytes)
-  logicalBlockSize: number; // usually 2048
-  volumeId:       string;
+function isCD001(data: Uint8Array): boolean {
+  return data[1] === 0x43 && data[2] === 0x44 && data[3] === 0x30 &&
+         data[4] === 0x30 && data[5] === 0x31;
 }
 
-function decodePVD(data: Uint8Array): PVD | null {
+function decodeVD(data: Uint8Array, joliet: boolean): VolumeInfo | null {
   // Byte 0 = volume descriptor type
   // Bytes 1-5 = 'CD001'
   // Byte 6 = version (always 1)
-  if (data.length < 2048) return null;
-  if (data[1] !== 0x43 || data[2] !== 0x44 || data[3] !== 0x30 ||
-      data[4] !== 0x30 || data[5] !== 0x31) return null;
-  var dv  = new DataView(data.buffer, data.byteOffset, data.byteLength);
-  var vol = '';
-  for (var i = 40; i < 72; i++) {
-    var c = data[i];
-    if (c === 0x20 || c === 0) break;
-    vol += String.fromCharCode(c);
-  }
+  if (data.length < ISO_SECTOR_SIZE || !isCD001(data)) return null;
+  var vol = joliet ? ucs2be(data, 40, 32) : latin1(data, 40, 32);
+  vol = vol.replace(/[\s\0]+$/, '');
   // Root directory record is at offset 156 (34 bytes)
-  var lba     = u32L(dv, 156 + 2);  // location of extent (LE)
-  var size    = u32L(dv, 156 + 10); // data length (LE)
-  var lbSize  = u16L(dv, 128);      // logical block size (LE half)
-  return { rootDirLba: lba, rootDirSize: size, logicalBlockSize: lbSize || 2048, volumeId: vol };
+  return {
+    rootDirLba:       u32L(data, 156 + 2) + data[156 + 1],
+    rootDirSize:      u32L(data, 156 + 10),
+    logicalBlockSize: u16L(data, 128) || ISO_SECTOR_SIZE,
+    volumeId:         vol,
+    pathTableSize:    u32L(data, 132),
+    pathTableLba:     u32L(data, 140),
+    joliet:           joliet,
+  };
+}
+
+/** SVD escape sequences '%/@', '%/C', '%/E' mark Joliet UCS-2 levels 1-3. */
+function isJolietSVD(data: Uint8Array): boolean {
+  if (data[88] !== 0x25 || data[89] !== 0x2f) return false;
+  var l = data[90];
+  return l === 0x40 || l === 0x43 || l === 0x45;
 }
 
 // ── Directory Record ────────────────────────────────────────────────────────────
@@ -83,81 +159,37 @@ interface DirRecord {
   size:     number;
   isDir:    boolean;
   flags:    number;
+  /** Extra [lba, size] pairs of a multi-extent file after the first. */
+  more:     number[] | null;
+  /** Rock Ridge PX st_mode, or 0. */
+  mode:     number;
+  /** Rock Ridge SL target, or null. */
+  symlink:  string | null;
+  /** Recording date, ms since the epoch. */
+  mtime:    number;
 }
 
-/**
- * Parse all directory records from a raw directory sector buffer.
- * ISO 9660 directory entries are variable-length; a record length of 0 means
- * the rest of the current sector is padding — skip to the next sector boundary.
- */
-function parseDirSector(data: Uint8Array, offset: number, sectorSize: number): DirRecord[] {
-  var records: DirRecord[] = [];
-  var end = offset + sectorSize;
-  var pos = offset;
-  while (pos < end) {
-    if (pos >= data.length) break;
-    var recLen = data[pos];
-    if (recLen === 0) {
-      // Padding — skip to next sector
-      var nextSector = (pos - offset + sectorSize) & ~(sectorSize - 1);
-      pos = offset + nextSector;
-      continue;
-    }
-    if (pos + recLen > data.length) break;
-    var dv        = new DataView(data.buffer, data.byteOffset, data.byteLength);
-    var lba       = u32L(dv, pos + 2);
-    var size      = u32L(dv, pos + 10);
-    var fileFlags = data[pos + 25];
-    var isDir     = (fileFlags & 0x02) !== 0;
-    var nameLen   = data[pos + 32];
-    var rawName   = '';
-    for (var ni = 0; ni < nameLen; ni++) rawName += String.fromCharCode(data[pos + 33 + ni]);
-    // Strip version number (';1')
-    var semiIdx = rawName.indexOf(';');
-    var cleanName = semiIdx >= 0 ? rawName.slice(0, semiIdx) : rawName;
-    // Strip trailing dot (ISO 9660 pads filenames with '.')
-    if (cleanName.endsWith('.')) cleanName = cleanName.slice(0, -1);
-
-    // Try Rock Ridge NM extension for alternate name
-    var rrName = parseRockRidgeNM(data, pos + 33 + nameLen, pos + recLen);
-    if (rrName) cleanName = rrName;
-
-    // Skip '.' and '..' entries
-    if (nameLen === 1 && (data[pos + 33] === 0x00 || data[pos + 33] === 0x01)) {
-      pos += recLen;
-      continue;
-    }
-    records.push({ name: cleanName, lba, size, isDir, flags: fileFlags });
-    pos += recLen;
-  }
-  return records;
+interface DirNode {
+  lba:     number;
+  entries: DirRecord[];
+  index:   Map<string, DirRecord>;
 }
 
-/**
- * Scan System Use fields after the file identifier for Rock Ridge NM (alternate name).
- * Returns the alternate name string or null if not found.
- */
-function parseRockRidgeNM(data: Uint8Array, suStart: number, recEnd: number): string | null {
-  // System Use area must be byte-aligned; skip padding byte if file identifier length is even
-  var off = suStart;
-  if ((suStart & 1) !== 0) off++; // for odd-length file identifiers
-  while (off + 3 < recEnd && off < data.length) {
-    var sig    = (data[off] << 8) | data[off + 1];
-    var suLen  = data[off + 2];
-    if (suLen < 4 || off + suLen > recEnd) break;
-    if (sig === RR_SIG_NM) {
-      // NM field: byte 4 = flags, bytes 5..suLen-1 = name component
-      var nameLen = suLen - 5;
-      if (nameLen > 0) {
-        var name = '';
-        for (var i = 0; i < nameLen; i++) name += String.fromCharCode(data[off + 5 + i]);
-        return name;
-      }
-    }
-    if (suLen === 0) break;
-    off += suLen;
-  }
-  return null;
+/** Result of scanning one record's system-use area. */
+interface SUInfo {
+  name:     string | null;
+  mode:     number;
+  symlink:  string | null;
+  childLba: number;      // CL target, or -1
+  hidden:   boolean;     // RE — the relocated copy, reached through CL
+}
+
+/** 7-byte directory record date → ms since the epoch. */
+function recordDate(d: Uint8Array, p: number): number {
+  if (!d[p]) return 0;
+  var t = Date.UTC(1900 + d[p], d[p + 1] - 1, d[p + 2], d[p + 3], d[p + 4], d[p + 5]);
+  var tz = d[p + 6] > 127 ? d[p + 6] - 256 : d[p + 6];   // 15-minute units
+  return t - tz * 15 * 60000;
 }
 
 // ── ISO9660FS class ─────────────────────────────────────────────────────────────
@@ -176,128 +208,498 @@ function parseRockRidgeNM(data: Uint8Array, suStart: number, recEnd: number): st
  *   fs.isDirectory('/boot');            // test directory
  */
 export class ISO9660FS implements VFSMount {
+  readonly writable = false;
   private _dev:   ISO9660Device;
-  private _pvd:   PVD | null = null;
+  private _mp:    string;
+  private _vol:   VolumeInfo | null = null;
   private _ready: boolean = false;
+  private _rr:    boolean = false;
+  private _suSkip = 0;
+  private _fold:  boolean = true;                  // case-insensitive names
+  private _dirs = new Map<number, DirNode>();      // LRU: extent LBA → parsed
+  private _ptLba: number[] | null = null;          // path table: dir # → LBA
+  private _ptIdx: Map<string, number> | null = null; // parent#/NAME → dir #
+  private _bounce = new Uint8Array(XFER_SECTORS * ISO_SECTOR_SIZE);
 
-  constructor(dev: ISO9660Device) {
+  /** Cache statistics. */
+  stats = { dirHits: 0, dirMisses: 0, sectorsRead: 0 };
+
+  /**
+   * `mountpoint` is stripped from the paths the VFS passes in.
+   * Pass `{ joliet: false }` / `{ rockRidge: false }` to ignore an extension.
+   */
+  constructor(dev: ISO9660Device, mountpoint: string = '',
+              opts: { joliet?: boolean; rockRidge?: boolean } = {}) {
     this._dev = dev;
-    this._init();
+    this._mp  = mountpoint === '/' ? '' : mountpoint;
+    this._init(opts.joliet !== false, opts.rockRidge !== false);
   }
 
-  private _init(): void {
+  private _init(useJoliet: boolean, useRR: boolean): void {
+    var pvd: VolumeInfo | null = null, svd: VolumeInfo | null = null;
     try {
       // Scan volume descriptors starting at LBA 16
       for (var lba = PVD_LBA; lba < PVD_LBA + 32; lba++) {
         var data = this._dev.readSector(lba);
-        if (data.length < 8) break;
+        if (data.length < 8 || !isCD001(data)) break;
         var vdType = data[0];
         if (vdType === VD_TYPE_TERMINATOR) break;
-        if (vdType === VD_TYPE_PRIMARY) {
-          this._pvd = decodePVD(data);
-          if (this._pvd) { this._ready = true; break; }
+        if (vdType === VD_TYPE_PRIMARY && !pvd) pvd = decodeVD(data, false);
+        if (vdType === VD_TYPE_SUPPLEMENTARY && useJoliet && !svd && isJolietSVD(data)) {
+          svd = decodeVD(data, true);
         }
       }
     } catch (_) { /* device not ready */ }
+    if (!pvd) return;
+    this._vol   = pvd;
+    this._ready = true;
+    // Rock Ridge wins over Joliet: it carries modes and symlinks as well.
+    if (useRR && this._detectRockRidge(pvd)) {
+      this._rr   = true;
+      this._fold = false;
+    } else if (svd) {
+      this._vol = svd;
+    }
+    if (!this._rr) this._loadPathTable();
   }
 
-  private _readExtent(lba: number, size: number): Uint8Array {
-    var pvd = this._pvd!;
-    var sectors = Math.ceil(size / pvd.logicalBlockSize);
-    var out = new Uint8Array(sectors * pvd.logicalBlockSize);
-    for (var s = 0; s < sectors; s++) {
-      var sdata = this._dev.readSector(lba + s);
-      out.set(sdata.subarray(0, pvd.logicalBlockSize), s * pvd.logicalBlockSize);
+  /** SUSP 'SP' entry at the start of the root '.' record's system-use area. */
+  private _detectRockRidge(v: VolumeInfo): boolean {
+    var s = this._readSectorCopy(v.rootDirLba);
+    if (!s) return false;
+    var len = s[0], nameLen = s[32];
+    var su = 33 + nameLen + ((nameLen & 1) ? 0 : 1);
+    if (len < su + 7) return false;
+    if (((s[su] << 8) | s[su + 1]) !== SU_SIG_SP || s[su + 4] !== 0xbe || s[su + 5] !== 0xef) return false;
+    this._suSkip = s[su + 6];
+    return true;
+  }
+
+  // ── Sector I/O ───────────────────────────────────────────────────────────────
+
+  /** `count` sectors from `lba` into `dst` at `off` (multi-sector when possible). */
+  private _readSectors(lba: number, count: number, dst: Uint8Array, off: number): boolean {
+    this.stats.sectorsRead += count;
+    if (this._dev.readSectors) return this._dev.readSectors(lba, count, dst, off);
+    for (var i = 0; i < count; i++) {
+      var s = this._dev.readSector(lba + i);
+      dst.set(s.length > ISO_SECTOR_SIZE ? s.subarray(0, ISO_SECTOR_SIZE) : s, off + i * ISO_SECTOR_SIZE);
     }
+    return true;
+  }
+
+  private _readSectorCopy(lba: number): Uint8Array | null {
+    var out = new Uint8Array(ISO_SECTOR_SIZE);
+    return this._readSectors(lba, 1, out, 0) ? out : null;
+  }
+
+  /** A whole extent, read with as few device calls as possible. */
+  private _readExtent(lba: number, size: number): Uint8Array | null {
+    var sectors = Math.ceil(size / ISO_SECTOR_SIZE);
+    var out = new Uint8Array(sectors * ISO_SECTOR_SIZE);
+    if (sectors && !this._readSectors(lba, sectors, out, 0)) return null;
     return out.subarray(0, size);
   }
 
-  private _listDir(lba: number, size: number): DirRecord[] {
-    var pvd  = this._pvd!;
-    var data = this._readExtent(lba, size);
+  // ── Path table ───────────────────────────────────────────────────────────────
+
+  /**
+   * Load the L-type path table: every directory's extent LBA, indexed by
+   * parent number and name, so resolving a path skips the directory
+   * extents above the one that holds the file.
+   */
+  private _loadPathTable(): void {
+    var v = this._vol!;
+    if (!v.pathTableSize || v.pathTableSize > 4 * 1024 * 1024) return;
+    var pt = this._readExtent(v.pathTableLba, v.pathTableSize);
+    if (!pt) return;
+    var lbas: number[] = [0];                 // directory numbers are 1-based
+    var idx  = new Map<string, number>();
+    var p = 0;
+    while (p + 8 <= pt.length) {
+      var nameLen = pt[p];
+      if (!nameLen) break;
+      var extLen = pt[p + 1];
+      var lba    = u32L(pt, p + 2) + extLen;
+      var parent = u16L(pt, p + 6);
+      var n = lbas.length;
+      lbas.push(lba);
+      if (n > 1) {
+        var name = v.joliet ? ucs2be(pt, p + 8, nameLen) : latin1(pt, p + 8, nameLen);
+        idx.set(parent + '/' + this._key(cleanIsoName(name)), n);
+      }
+      p += 8 + nameLen + (nameLen & 1);
+    }
+    if (lbas.length > 1 && lbas[1] === v.rootDirLba) {
+      this._ptLba = lbas;
+      this._ptIdx = idx;
+    }
+  }
+
+  /** Extent LBA of the directory `parts[0 … n)` via the path table, or -1. */
+  private _ptResolve(parts: string[], n: number): number {
+    var dir = 1;
+    for (var i = 0; i < n; i++) {
+      var d = this._ptIdx!.get(dir + '/' + this._key(parts[i]));
+      if (d === undefined) return -1;
+      dir = d;
+    }
+    return this._ptLba![dir];
+  }
+
+  // ── Directory cache ──────────────────────────────────────────────────────────
+
+  private _key(name: string): string { return this._fold ? name.toUpperCase() : name; }
+
+  /**
+   * Parsed directory at extent `lba`.  `size` < 0 means unknown (reached
+   * through the path table or a CL link): it comes from the '.' record.
+   */
+  private _dir(lba: number, size: number): DirNode | null {
+    var node = this._dirs.get(lba);
+    if (node) {
+      this._dirs.delete(lba);                  // refresh LRU position
+      this._dirs.set(lba, node);
+      this.stats.dirHits++;
+      return node;
+    }
+    this.stats.dirMisses++;
+    var data: Uint8Array | null;
+    if (size < 0) {
+      var first = this._readSectorCopy(lba);
+      if (!first || !first[0]) return null;
+      size = u32L(first, 10);
+      data = size <= ISO_SECTOR_SIZE ? first.subarray(0, size) : this._readExtent(lba, size);
+    } else {
+      data = this._readExtent(lba, size);
+    }
+    if (!data) return null;
+    node = { lba: lba, entries: this._parseDir(data), index: new Map() };
+    for (var i = 0; i < node.entries.length; i++) {
+      var e = node.entries[i];
+      var k = this._key(e.name);
+      if (!node.index.has(k)) node.index.set(k, e);
+    }
+    if (this._dirs.size >= DIR_CACHE_MAX) {
+      this._dirs.delete(this._dirs.keys().next().value as number);
+    }
+    this._dirs.set(lba, node);
+    return node;
+  }
+
+  /** Drop all cached directories (e.g. after a media change). */
+  invalidate(): void { this._dirs.clear(); }
+
+  /**
+   * Parse all directory records of one extent.  Records never straddle a
+   * sector; a record length of 0 means the rest of the sector is padding.
+   */
+  private _parseDir(data: Uint8Array): DirRecord[] {
     var records: DirRecord[] = [];
+    var prev: DirRecord | null = null;
     var pos = 0;
     while (pos < data.length) {
-      var sectorRecords = parseDirSector(data, pos, pvd.logicalBlockSize);
-      records = records.concat(sectorRecords);
-      pos += pvd.logicalBlockSize;
+      var recLen = data[pos];
+      if (recLen === 0) {
+        pos = (pos + ISO_SECTOR_SIZE) & ~(ISO_SECTOR_SIZE - 1);
+        continue;
+      }
+      if (recLen < 34 || pos + recLen > data.length) break;
+      var nameLen = data[pos + 32];
+      var flags   = data[pos + 25];
+      // Skip '.' and '..' entries
+      if (nameLen === 1 && data[pos + 33] <= 1) { pos += recLen; continue; }
+      if (flags & FF_ASSOCIATED) { pos += recLen; continue; }
+      var lba  = u32L(data, pos + 2) + data[pos + 1];   // + extended attribute record
+      var size = u32L(data, pos + 10);
+
+      var name = this._vol!.joliet ? ucs2be(data, pos + 33, nameLen) : latin1(data, pos + 33, nameLen);
+      name = cleanIsoName(name);
+      var su: SUInfo | null = null;
+      if (this._rr) {
+        var suStart = pos + 33 + nameLen + ((nameLen & 1) ? 0 : 1) + this._suSkip;
+        su = this._parseSU(data, suStart, pos + recLen);
+        if (su.hidden) { pos += recLen; continue; }
+        if (su.name) name = su.name;
+      }
+
+      // Later sections of a multi-extent file follow its first record
+      if (prev && (prev.flags & FF_MULTIEXTENT) && prev.name === name) {
+        (prev.more || (prev.more = [])).push(lba, size);
+        prev.flags = flags;
+        pos += recLen;
+        continue;
+      }
+
+      var rec: DirRecord = {
+        name:    name,
+        lba:     lba,
+        size:    size,
+        isDir:   (flags & FF_DIRECTORY) !== 0,
+        flags:   flags,
+        more:    null,
+        mode:    su ? su.mode : 0,
+        symlink: su ? su.symlink : null,
+        mtime:   recordDate(data, pos + 18),
+      };
+      if (su && su.childLba >= 0) { rec.isDir = true; rec.lba = su.childLba; rec.size = -1; }
+      records.push(rec);
+      prev = rec;
+      pos += recLen;
     }
     return records;
   }
 
   /**
-   * Resolve a path to a DirRecord by walking the directory tree.
-   * Returns null if not found.
+   * Walk the system-use entries of one record, following CE continuation
+   * areas.  NM and SL may be split across several entries (CONTINUE flag).
+   */
+  private _parseSU(data: Uint8Array, off: number, end: number): SUInfo {
+    var info: SUInfo = { name: null, mode: 0, symlink: null, childLba: -1, hidden: false };
+    var nm: number[] | null = null;
+    var sl: string | null = null, slJoin = false;
+    for (var hops = 0; hops <= MAX_CE_CHAIN; hops++) {
+      var ceLba = -1, ceOff = 0, ceLen = 0;
+      while (off + 4 <= end) {
+        var sig = (data[off] << 8) | data[off + 1];
+        var len = data[off + 2];
+        if (len < 4 || off + len > end) break;
+        if (sig === SU_SIG_ST) break;
+        if (sig === SU_SIG_CE && len >= 28) {
+          ceLba = u32L(data, off + 4); ceOff = u32L(data, off + 12); ceLen = u32L(data, off + 20);
+        } else if (sig === RR_SIG_NM && len >= 5) {
+          var fl = data[off + 4];
+          if (!(fl & 0x06)) {                     // not CURRENT/PARENT
+            if (!nm) nm = [];
+            for (var i = off + 5; i < off + len; i++) nm.push(data[i]);
+          }
+        } else if (sig === RR_SIG_PX && len >= 12) {
+          info.mode = u32L(data, off + 4);
+        } else if (sig === RR_SIG_SL && len >= 5) {
+          var r = this._slComponents(data, off + 5, off + len, sl === null ? '' : sl, slJoin);
+          sl = r.path; slJoin = r.join;
+        } else if (sig === RR_SIG_CL && len >= 12) {
+          info.childLba = u32L(data, off + 4);
+        } else if (sig === RR_SIG_RE) {
+          info.hidden = true;
+        }
+        off += len;
+      }
+      if (ceLba < 0) break;
+      var ce = this._readExtent(ceLba, ceOff + ceLen);
+      if (!ce) break;
+      data = ce; off = ceOff; end = ceOff + ceLen;
+    }
+    if (nm && nm.length) info.name = utf8Decode(new Uint8Array(nm));
+    info.symlink = sl;
+    return info;
+  }
+
+  /**
+   * Append the component records of one SL entry to `path`.  `join` says
+   * the previous component was marked CONTINUE (no '/' before the next).
+   */
+  private _slComponents(d: Uint8Array, p: number, end: number, path: string, join: boolean):
+      { path: string; join: boolean } {
+    while (p + 2 <= end) {
+      var cf = d[p], cl = d[p + 1];
+      if (p + 2 + cl > end) break;
+      var part: string;
+      if (cf & 0x08)      part = '/';
+      else if (cf & 0x02) part = '.';
+      else if (cf & 0x04) part = '..';
+      else                part = utf8Decode(d.subarray(p + 2, p + 2 + cl));
+      if (part === '/') path = path ? path + '/' : '/';
+      else if (join || !path || path.charCodeAt(path.length - 1) === 0x2f) path += part;
+      else path += '/' + part;
+      join = (cf & 0x01) !== 0;
+      p += 2 + cl;
+    }
+    return { path: path, join: join };
+  }
+
+  // ── Path resolution ──────────────────────────────────────────────────────────
+
+  private _rootRecord(): DirRecord {
+    var v = this._vol!;
+    return { name: '', lba: v.rootDirLba, size: v.rootDirSize, isDir: true, flags: FF_DIRECTORY,
+             more: null, mode: 0o40555, symlink: null, mtime: 0 };
+  }
+
+  private _parts(path: string): string[] | null {
+    if (this._mp) {
+      if (path === this._mp) return [];
+      if (path.indexOf(this._mp + '/') !== 0) return null;
+      path = path.substring(this._mp.length);
+    }
+    return path.split('/').filter(function(p) { return p.length > 0; });
+  }
+
+  /**
+   * Resolve a path to a DirRecord through the directory cache (and the path
+   * table for the parent chain, when there is one).  Returns null if not found.
    */
   private _resolve(path: string): DirRecord | null {
-    var pvd = this._pvd; if (!pvd) return null;
-    var parts = path.replace(/^\//, '').split('/').filter(function(p) { return p.length > 0; });
-    // Start at root
-    var currentLba  = pvd.rootDirLba;
-    var currentSize = pvd.rootDirSize;
-
-    if (parts.length === 0) {
-      // Root directory itself
-      return { name: '', lba: currentLba, size: currentSize, isDir: true, flags: 2 };
+    if (!this._vol) return null;
+    var parts = this._parts(path);
+    if (!parts) return null;
+    if (parts.length === 0) return this._rootRecord();
+
+    var start = 0;
+    var cur = this._rootRecord();
+    if (this._ptIdx && parts.length > 1) {
+      var plba = this._ptResolve(parts, parts.length - 1);
+      if (plba >= 0) {
+        cur = { name: parts[parts.length - 2], lba: plba, size: -1, isDir: true, flags: FF_DIRECTORY,
+                more: null, mode: 0, symlink: null, mtime: 0 };
+        start = parts.length - 1;
+      }
+    }
+    for (var i = start; i < parts.length; i++) {
+      if (!cur.isDir) return null;
+      var dir = this._dir(cur.lba, cur.size);
+      if (!dir) return null;
+      var found = dir.index.get(this._key(parts[i]));
+      if (!found) return null;
+      cur = found;
     }
+    return cur;
+  }
 
-    for (var i = 0; i < parts.length; i++) {
-      var entries = this._listDir(currentLba, currentSize);
-      var found: DirRecord | null = null;
-      for (var j = 0; j < entries.length; j++) {
-        if (entries[j].name.toUpperCase() === parts[i].toUpperCase()) {
-          found = entries[j];
-          break;
+  // ── File data ────────────────────────────────────────────────────────────────
+
+  /**
+   * Copy `len` bytes of the file starting at byte `pos` into `dst` at `off`.
+   * The sector-aligned middle of each extent is read straight into `dst`;
+   * only partial head/tail sectors go through the bounce buffer.  Returns
+   * the number of bytes copied, or -1 on a device error.
+   */
+  private _readRange(rec: DirRecord, pos: number, dst: Uint8Array, off: number, len: number): number {
+    var ext = [rec.lba, rec.size].concat(rec.more || []);
+    var done = 0, base = 0;
+    for (var x = 0; x < ext.length && done < len; x += 2) {
+      var eLba = ext[x], eSize = ext[x + 1];
+      var lo = Math.max(pos + done, base), hi = Math.min(pos + len, base + eSize);
+      base += eSize;
+      while (lo < hi) {
+        var rel = lo - (base - eSize);
+        var sec = eLba + Math.floor(rel / ISO_SECTOR_SIZE);
+        var inSec = rel % ISO_SECTOR_SIZE;
+        var whole = Math.floor((hi - lo) / ISO_SECTOR_SIZE);
+        var n: number;
+        if (inSec === 0 && whole > 0) {
+          if (!this._readSectors(sec, whole, dst, off + done)) return -1;
+          n = whole * ISO_SECTOR_SIZE;
+        } else {
+          var cnt = Math.min(XFER_SECTORS, Math.ceil((inSec + hi - lo) / ISO_SECTOR_SIZE));
+          if (!this._readSectors(sec, cnt, this._bounce, 0)) return -1;
+          n = Math.min(hi - lo, cnt * ISO_SECTOR_SIZE - inSec);
+          dst.set(this._bounce.subarray(inSec, inSec + n), off + done);
         }
+        lo += n; done += n;
       }
-      if (!found) return null;
-      if (i < parts.length - 1 && !found.isDir) return null;
-      currentLba  = found.lba;
-      currentSize = found.size;
-      if (i === parts.length - 1) return found;
     }
-    return null;
+    return done;
+  }
+
+  private _fileSize(rec: DirRecord): number {
+    var n = rec.size;
+    if (rec.more) for (var i = 1; i < rec.more.length; i += 2) n += rec.more[i];
+    return n;
+  }
+
+  /** Whole file contents, or null. */
+  readFile(path: string): Uint8Array | null {
+    var rec = this._resolve(path);
+    if (!rec || rec.isDir) return null;
+    var size = this._fileSize(rec);
+    if (!rec.more) return this._readExtent(rec.lba, size);
+    var out = new Uint8Array(size);
+    return this._readRange(rec, 0, out, 0, size) === size ? out : null;
+  }
+
+  /**
+   * Streaming read: copy up to `len` bytes at file offset `pos` into `dst`
+   * at `off`.  Returns the byte count (0 at EOF), or -1 if the path is not a
+   * file or the device fails.
+   */
+  readAt(path: string, pos: number, dst: Uint8Array, off: number = 0, len: number = dst.length - off): number {
+    var rec = this._resolve(path);
+    if (!rec || rec.isDir) return -1;
+    var size = this._fileSize(rec);
+    if (pos >= size) return 0;
+    return this._readRange(rec, pos, dst, off, Math.min(len, size - pos));
+  }
+
+  /** File size in bytes, or -1. */
+  size(path: string): number {
+    var rec = this._resolve(path);
+    return rec && !rec.isDir ? this._fileSize(rec) : -1;
+  }
+
+  /** Rock Ridge symlink target, or null. */
+  readlink(path: string): string | null {
+    var rec = this._resolve(path);
+    return rec ? rec.symlink : null;
+  }
+
+  /** Rock Ridge st_mode (0 without Rock Ridge), or -1 if absent. */
+  mode(path: string): number {
+    var rec = this._resolve(path);
+    return rec ? rec.mode : -1;
+  }
+
+  /** Modification time (ms since the epoch), or -1. */
+  mtime(path: string): number {
+    var rec = this._resolve(path);
+    return rec ? rec.mtime : -1;
   }
 
   // ── VFSMount interface ────────────────────────────────────────────────────────
 
   read(path: string): string | null {
     if (!this._ready) return null;
-    var rec = this._resolve(path);
-    if (!rec || rec.isDir) return null;
-    var data = this._readExtent(rec.lba, rec.size);
-    var text = '';
-    for (var i = 0; i < data.length; i++) text += String.fromCharCode(data[i]);
-    return text;
+    var data = this.readFile(path);
+    return data ? utf8Decode(data) : null;
+  }
+
+  /** Binary body for fd I/O and sendfile — read once with multi-sector I/O. */
+  fileData(path: string): FileData | null {
+    if (!this._ready) return null;
+    var data = this.readFile(path);
+    return data ? FileData.fromView(data) : null;
   }
 
   list(path: string): Array<{ name: string; type: FileType; size: number }> {
-    if (!this._ready || !this._pvd) return [];
-    var rec = !path || path === '/'
-      ? { name: '', lba: this._pvd.rootDirLba, size: this._pvd.rootDirSize, isDir: true, flags: 2 }
-      : this._resolve(path);
+    if (!this._ready) return [];
+    var rec = this._resolve(path);
     if (!rec || !rec.isDir) return [];
-    var entries = this._listDir(rec.lba, rec.size);
-    return entries.map(function(e) {
-      return { name: e.name, type: (e.isDir ? 'directory' : 'file') as FileType, size: e.size };
+    var dir = this._dir(rec.lba, rec.size);
+    if (!dir) return [];
+    var self = this;
+    return dir.entries.map(function(e) {
+      var type: FileType = e.symlink !== null ? 'symlink' : e.isDir ? 'directory' : 'file';
+      return { name: e.name, type: type, size: e.isDir ? 0 : self._fileSize(e) };
     });
   }
 
   exists(path: string): boolean {
     if (!this._ready) return false;
-    if (!path || path === '/') return true;
     return this._resolve(path) !== null;
   }
 
   isDirectory(path: string): boolean {
     if (!this._ready) return false;
-    if (!path || path === '/') return true;
     var rec = this._resolve(path);
     return rec ? rec.isDir : false;
   }
 
-  get volumeId(): string { return this._pvd?.volumeId ?? ''; }
+  get volumeId(): string { return this._vol?.volumeId ?? ''; }
   get ready():    boolean { return this._ready; }
+  /** Which name space is in use. */
+  get naming():   'rockridge' | 'joliet' | 'iso9660' {
+    return this._rr ? 'rockridge' : this._vol?.joliet ? 'joliet' : 'iso9660';
+  }
 }
 
 /**
@@ -309,11 +711,17 @@ export class ArrayISO9660Device implements ISO9660Device {
   constructor(data: Uint8Array) { this._data = data; }
 
   readSector(lba: number): Uint8Array {
-    var off = lba * ISO_SECTOR_SIZE;
-    var end = Math.min(off + ISO_SECTOR_SIZE, this._data.length);
-    if (off >= this._data.length) return new Uint8Array(ISO_SECTOR_SIZE);
     var out = new Uint8Array(ISO_SECTOR_SIZE);
-    out.set(this._data.subarray(off, end));
+    this.readSectors(lba, 1, out, 0);
     return out;
   }
+
+  readSectors(lba: number, count: number, dst: Uint8Array, off: number): boolean {
+    var start = lba * ISO_SECTOR_SIZE;
+    var end   = Math.min(start + count * ISO_SECTOR_SIZE, this._data.length);
+    var n     = Math.max(0, end - start);
+    if (n) dst.set(this._data.subarray(start, end), off);
+    dst.fill(0, off + n, off + count * ISO_SECTOR_SIZE);
+    return true;
+  }
 }
@@ -17,11 +17,19 @@
  *   A file named `.wh.<name>` in the upper layer shadows `<name>` from
  *   lower layers.  Opaque directories are marked with `.wh..wh..opq`.
  *
- * The upper layer is represented by OverlayUpperLayer (an in-memory store);
+ * Lookups go through a merged dentry cache: each directory is
+ * merged from its layers once, into a name → layer map plus a hash set of
+ * its whiteouts, and overlay writes update that map in place.  Resolving a
+ * path is then a couple of Map probes — about what the lower layer alone
+ * costs — instead of probing every layer and `.wh.` name per call.
+ *
+ * The upper layer is represented by MemoryUpperLayer (an in-memory store);
  * swap it for an ext4-backed implementation for persistence.
  */
 
 import type { VFSMount, FileType } from './filesystem.js';
+import { FileData, utf8Length } from './filedata.js';
+import { utf8Decode } from '../core/ringbuf.js';
 
 // ── Writable VFS mount interface ─────────────────────────────────────────────
 
@@ -30,94 +38,158 @@ export interface WritableVFSMount extends VFSMount {
   unlink(path: string): number;
   mkdir(path: string): number;
   rmdir(path: string): number;
+  /**
+   * Optional: store `data` itself as the file body (no copy).  Lets the
+   * overlay copy up a file by handing over its copy-on-write clone.
+   */
+  writeData?(path: string, data: FileData): number;
+}
+
+// ── Path helpers ─────────────────────────────────────────────────────────────
+
+/** `/a/b` form: one leading slash, no trailing one.  Already-normal paths are returned as is. */
+function normPath(p: string): string {
+  var n = p.length;
+  if (n > 1 && p.charCodeAt(0) === 47 && p.charCodeAt(n - 1) !== 47) return p;
+  return '/' + p.replace(/^\/+/, '').replace(/\/+$/, '');
+}
+
+function dirOf(p: string): string {
+  var i = p.lastIndexOf('/');
+  return i <= 0 ? '/' : p.slice(0, i);
+}
+
+function baseOf(p: string): string { return p.slice(p.lastIndexOf('/') + 1); }
+
+function joinPath(dir: string, name: string): string {
+  return dir === '/' ? '/' + name : dir + '/' + name;
 }
 
 // ── In-memory upper layer ────────────────────────────────────────────────────
 
 interface UpperEntry {
-  type:    FileType;
-  content: string;  // empty for directories
+  type: FileType;
+  data: FileData | null;  // null for directories
 }
 
 /**
  * Simple in-memory upper layer for OverlayFS.
  *
+ * Bodies are FileData, so a copied-up file shares its unmodified chunks
+ * with the lower layer.  A per-directory name index keeps list() from
+ * scanning every stored path.
+ *
  * Can be replaced with a persistent ext4-backed upper layer.
  */
 export class MemoryUpperLayer implements WritableVFSMount {
   private _files: Map<string, UpperEntry> = new Map();
+  /** Directory path → names of its entries. */
+  private _children: Map<string, Set<string>> = new Map();
 
-  private _norm(p: string): string {
-    return '/' + p.replace(/^\//, '').replace(/\/$/, '');
+  read(path: string): string | null {
+    var e = this._files.get(normPath(path));
+    return e && e.data ? e.data.toString() : null;
   }
 
-  read(path: string): string | null {
-    var e = this._files.get(this._norm(path));
-    if (!e || e.type !== 'file') return null;
-    return e.content;
+  fileData(path: string): FileData | null {
+    var e = this._files.get(normPath(path));
+    return e ? e.data : null;
   }
 
   list(path: string): Array<{ name: string; type: FileType; size: number }> {
-    var base = this._norm(path).replace(/\/$/, '');
+    var base = normPath(path);
     var out: Array<{ name: string; type: FileType; size: number }> = [];
-    this._files.forEach((entry, key) => {
-      if (key === base || !key.startsWith(base + '/')) return;
-      var rela = key.slice(base.length + 1);
-      if (rela.indexOf('/') >= 0) return; // skip nested
-      out.push({ name: rela, type: entry.type, size: entry.content.length });
-    });
+    var names = this._children.get(base);
+    if (!names) return out;
+    for (var name of names) {
+      var e = this._files.get(joinPath(base, name))!;
+      out.push({ name: name, type: e.type, size: e.data ? e.data.length : 0 });
+    }
     return out;
   }
 
-  exists(path: string): boolean { return this._files.has(this._norm(path)); }
+  exists(path: string): boolean {
+    var n = normPath(path);
+    return n === '/' || this._files.has(n);
+  }
 
+  /** The root is always a directory, though it is never stored. */
   isDirectory(path: string): boolean {
-    var e = this._files.get(this._norm(path));
+    var n = normPath(path);
+    if (n === '/') return true;
+    var e = this._files.get(n);
     return !!e && e.type === 'directory';
   }
 
   write(path: string, content: string): number {
-    var n = this._norm(path);
-    // Ensure parent directory exists
-    var parent = n.slice(0, n.lastIndexOf('/')) || '/';
-    if (!this._files.has(parent) && parent !== '/') this.mkdir(parent);
-    this._files.set(n, { type: 'file', content });
+    return this.writeData(path, FileData.fromString(content));
+  }
+
+  writeData(path: string, data: FileData): number {
+    var n = normPath(path);
+    var e = this._files.get(n);
+    if (n === '/' || (e && e.type === 'directory')) return -21; // EISDIR
+    this._ensureDir(dirOf(n));
+    this._add(n, { type: 'file', data: data });
     return 0;
   }
 
   unlink(path: string): number {
-    var n = this._norm(path);
-    if (!this._files.has(n)) return -2; // ENOENT
-    var e = this._files.get(n)!;
+    var n = normPath(path);
+    var e = this._files.get(n);
+    if (!e) return -2; // ENOENT
     if (e.type === 'directory') return -21; // EISDIR
-    this._files.delete(n);
+    this._remove(n);
     return 0;
   }
 
   mkdir(path: string): number {
-    var n = this._norm(path);
-    if (this._files.has(n)) return -17; // EEXIST
-    this._files.set(n, { type: 'directory', content: '' });
+    var n = normPath(path);
+    if (n === '/' || this._files.has(n)) return -17; // EEXIST
+    this._ensureDir(dirOf(n));
+    this._add(n, { type: 'directory', data: null });
     return 0;
   }
 
   rmdir(path: string): number {
-    var n = this._norm(path);
-    if (!this._files.has(n)) return -2;
-    if (!this.isDirectory(path)) return -20; // ENOTDIR
+    var n = normPath(path);
+    var e = this._files.get(n);
+    if (!e) return -2;
+    if (e.type !== 'directory') return -20; // ENOTDIR
     // Only remove if empty
-    var entries = this.list(path);
-    if (entries.length > 0) return -39; // ENOTEMPTY
-    this._files.delete(n);
+    var names = this._children.get(n);
+    if (names && names.size > 0) return -39; // ENOTEMPTY
+    this._children.delete(n);
+    this._remove(n);
     return 0;
   }
 
   /** Snapshot the upper layer for debugging / persistence. */
   snapshot(): Record<string, { type: FileType; content: string }> {
     var out: Record<string, { type: FileType; content: string }> = {};
-    this._files.forEach((v, k) => { out[k] = { type: v.type, content: v.content }; });
+    this._files.forEach((v, k) => { out[k] = { type: v.type, content: v.data ? v.data.toString() : '' }; });
     return out;
   }
+
+  private _ensureDir(d: string): void {
+    if (d === '/' || this._files.has(d)) return;
+    this._ensureDir(dirOf(d));
+    this._add(d, { type: 'directory', data: null });
+  }
+
+  private _add(n: string, e: UpperEntry): void {
+    this._files.set(n, e);
+    var d = dirOf(n);
+    var names = this._children.get(d);
+    if (!names) this._children.set(d, names = new Set());
+    names.add(baseOf(n));
+  }
+
+  private _remove(n: string): void {
+    this._files.delete(n);
+    var names = this._children.get(dirOf(n));
+    if (names) names.delete(baseOf(n));
+  }
 }
 
 // ── OverlayFS ─────────────────────────────────────────────────────────────────
@@ -129,6 +201,38 @@ function whiteoutName(name: string): string { return WHITEOUT_PREFIX + name; }
 function isWhiteout(name: string): boolean  { return name.startsWith(WHITEOUT_PREFIX); }
 function originalName(wh: string): string   { return wh.slice(WHITEOUT_PREFIX.length); }
 
+/** MergedEntry.layer of names supplied by the upper layer. */
+const UPPER = -1;
+
+/** One visible name in a merged directory. */
+interface MergedEntry {
+  /** UPPER, or the index of the lower layer that supplies it. */
+  layer: number;
+  type:  FileType;
+  size:  number;
+  /** Live body when known (the upper file, or a lower file's private copy); its length wins over `size`. */
+  data?: FileData | null;
+}
+
+/** Cached merge of one directory across all layers. */
+interface MergedDir {
+  entries:   Map<string, MergedEntry>;
+  /** Names hidden by a whiteout in the upper copy of this directory. */
+  whiteouts: Set<string>;
+  /** The upper copy is opaque: lower layers are not merged in. */
+  opaque:    boolean;
+}
+
+/** A lower-layer file handed out through fileData() but not yet copied up. */
+interface Shadow {
+  data: FileData;
+  /** data.generation when it was handed out (or last copied up). */
+  gen:  number;
+}
+
+/** Entry returned for the overlay's root directory, which has no parent view. */
+const ROOT_ENTRY: MergedEntry = { layer: UPPER, type: 'directory', size: 0 };
+
 /**
  * [Item 191] OverlayFS: union filesystem.
  *
@@ -136,9 +240,12 @@ function originalName(wh: string): string   { return wh.slice(WHITEOUT_PREFIX.le
  * All JSOS VFS path operations are dispatched through this overlay.
  *
  * Copy-Up:
- *   Before the first write to a file that exists only in a lower layer, OverlayFS
- *   copies the file to the upper layer. Subsequent writes to the upper copy do not
- *   affect lower layers.
+ *   A file that exists only in a lower layer is never copied just to be
+ *   overwritten — write() replaces it in the upper layer outright.  Partial
+ *   writes (fileData(), appendFile()) work on a copy-on-write clone of the
+ *   lower body, so copying up a large file copies only the 4 KB chunks that
+ *   were actually modified; the rest stay shared with the lower layer.
+ *   Bodies written through fileData() are copied up by sync().
  *
  * Deletion:
  *   Deleting a file creates a whiteout in the upper layer.  The file becomes
@@ -147,10 +254,19 @@ function originalName(wh: string): string   { return wh.slice(WHITEOUT_PREFIX.le
  * Opaque Directory:
  *   Creating a new directory on top of a lower directory adds a `.wh..wh..opq`
  *   marker to prevent lower-layer entries from leaking up (used for `rm -rf` then `mkdir`).
+ *
+ * The merged dentry cache assumes every change to the upper layer goes
+ * through the overlay; call invalidate() after touching a layer directly.
  */
 export class OverlayFS implements WritableVFSMount {
   private _upper:  WritableVFSMount;
   private _lower:  VFSMount[];
+  /** Merged dentry cache: directory path → its merged view. */
+  private _dirs:    Map<string, MergedDir> = new Map();
+  private _shadows: Map<string, Shadow> = new Map();
+
+  /** Directory merges, copy-ups, and chunks copied vs left shared by copy-up. */
+  readonly stats = { dirBuilds: 0, copyUps: 0, copiedChunks: 0, sharedChunks: 0 };
 
   /**
    * @param upper Writable upper layer (copy-up target, receives all writes).
@@ -161,189 +277,336 @@ export class OverlayFS implements WritableVFSMount {
     this._lower = lower;
   }
 
-  private _norm(p: string): string {
-    return '/' + p.replace(/^\//, '').replace(/\/$/, '');
+  // ── Merged dentry cache ─────────────────────────────────────────────────────
+
+  /** Merged view of directory `d`, or null if it is not a visible directory. */
+  private _dir(d: string): MergedDir | null {
+    var v = this._dirs.get(d);
+    if (v) return v;
+    var built = this._buildDir(d);
+    if (built) this._dirs.set(d, built);
+    return built;
+  }
+
+  private _buildDir(d: string): MergedDir | null {
+    if (d !== '/') {
+      var pd = dirOf(d);
+      var parent = this._dir(pd);
+      if (parent) {
+        var pe = parent.entries.get(baseOf(d));
+        if (!pe || pe.type !== 'directory') return null;
+      } else if (this._inAnyLayer(pd)) {
+        return null;             // an ancestor is whited out or shadowed by a file
+      }
+      // else: no layer has the parent — `d` is the top of the overlay (its mountpoint)
+    }
+    this.stats.dirBuilds++;
+    var v: MergedDir = { entries: new Map(), whiteouts: new Set(), opaque: false };
+    var found = false;
+    if (this._upper.isDirectory(d)) {
+      found = true;
+      for (var ue of this._upper.list(d)) {
+        if (ue.name === OPAQUE_MARKER) v.opaque = true;
+        else if (isWhiteout(ue.name)) v.whiteouts.add(originalName(ue.name));
+        else v.entries.set(ue.name, { layer: UPPER, type: ue.type, size: ue.size });
+      }
+    }
+    if (!v.opaque) {
+      for (var li = 0; li < this._lower.length; li++) {
+        var lower = this._lower[li];
+        if (!lower.isDirectory(d)) continue;
+        found = true;
+        for (var le of lower.list(d)) {
+          if (v.entries.has(le.name) || v.whiteouts.has(le.name)) continue;
+          var sh = this._shadows.size ? this._shadows.get(joinPath(d, le.name)) : undefined;
+          v.entries.set(le.name, { layer: li, type: le.type, size: le.size, data: sh ? sh.data : null });
+        }
+      }
+    }
+    return found ? v : null;
   }
 
-  private _basename(path: string): string {
-    var n = this._norm(path);
-    var i = n.lastIndexOf('/');
-    return n.slice(i + 1);
+  /** True if some layer has a directory at `d` (merge state aside). */
+  private _inAnyLayer(d: string): boolean {
+    if (this._upper.isDirectory(d)) return true;
+    for (var i = 0; i < this._lower.length; i++) if (this._lower[i].isDirectory(d)) return true;
+    return false;
   }
 
-  private _dirname(path: string): string {
-    var n = this._norm(path);
-    var i = n.lastIndexOf('/');
-    return i === 0 ? '/' : n.slice(0, i);
+  /** Resolve a normalised path to its merged entry: two Map probes once its directory is cached. */
+  private _lookup(p: string): MergedEntry | null {
+    if (p === '/') return this._dir('/') ? ROOT_ENTRY : null;
+    var i = p.lastIndexOf('/');
+    var v = this._dir(i === 0 ? '/' : p.slice(0, i));
+    if (v) return v.entries.get(p.slice(i + 1)) || null;
+    return this._dir(p) ? ROOT_ENTRY : null;
   }
 
-  /** Check if a name is hidden by a whiteout in the upper layer. */
-  private _isHidden(parentPath: string, name: string): boolean {
-    var wh = this._norm(parentPath + '/' + whiteoutName(name));
-    return this._upper.exists(wh);
+  /** Drop cached views of `d` and everything below it. */
+  private _forget(d: string): void {
+    this._dirs.delete(d);
+    var pre = d === '/' ? '/' : d + '/';
+    for (var k of this._dirs.keys()) if (k.startsWith(pre)) this._dirs.delete(k);
   }
 
-  /** Check if a directory is opaque (lower entries should not be merged). */
-  private _isOpaque(dirPath: string): boolean {
-    return this._upper.exists(this._norm(dirPath + '/' + OPAQUE_MARKER));
+  /** True if a lower layer still has `p` visible through directory view `v`. */
+  private _lowerHas(p: string, v: MergedDir | null): boolean {
+    if (v && v.opaque) return false;
+    for (var i = 0; i < this._lower.length; i++) if (this._lower[i].exists(p)) return true;
+    return false;
   }
 
   // ── Copy-Up ────────────────────────────────────────────────────────────────
 
   /**
-   * [Item 191 — copy-up] Copy a file from the first lower layer that has it
-   * to the upper layer.  Called before any write to a lower file.
+   * Make `d` (and its ancestors) a directory in the upper layer.  Fails with
+   * ENOTDIR when `d` or an ancestor is a visible file.
+   */
+  private _ensureDir(d: string): number {
+    if (d === '/' || this._upper.isDirectory(d)) return 0;
+    var e = this._lookup(d);
+    if (e && e.type !== 'directory') return -20; // ENOTDIR
+    var visible = this._dir(d) !== null;
+    var err = this._ensureDir(dirOf(d));
+    if (err < 0) return err;
+    return this._makeDir(d, visible);
+  }
+
+  /**
+   * Create upper directory `d`.  Unless it was already visible (a plain
+   * copy-up of a lower directory) it replaces whatever was hidden there:
+   * its whiteout goes, and a hidden lower directory is masked as opaque.
    */
-  private _copyUp(path: string): void {
-    if (this._upper.exists(path)) return;
-    for (var i = 0; i < this._lower.length; i++) {
-      var content = this._lower[i].read(path);
-      if (content !== null) {
-        // Ensure parent dirs exist in upper
-        var dir = this._dirname(path);
-        if (!this._upper.exists(dir)) this._copyUpDir(dir);
-        this._upper.write(path, content);
-        return;
+  private _makeDir(d: string, wasVisible: boolean): number {
+    var pd = dirOf(d), name = baseOf(d);
+    var err = this._upper.mkdir(d);
+    if (err === -17 && !this._upper.isDirectory(d)) return -20; // ENOTDIR: a file is there
+    if (err < 0 && err !== -17) return err;
+    var pv = this._dir(pd);
+    if (!wasVisible) {
+      if (pv && pv.whiteouts.delete(name)) this._upper.unlink(joinPath(pd, whiteoutName(name)));
+      for (var i = 0; i < this._lower.length; i++) {
+        if (this._lower[i].isDirectory(d)) {
+          this._upper.write(joinPath(d, OPAQUE_MARKER), '');
+          break;
+        }
       }
+      this._forget(d);
+    }
+    if (pv) pv.entries.set(name, { layer: UPPER, type: 'directory', size: 0 });
+    return 0;
+  }
+
+  /** Store a whole new body for file `p` in the upper layer. */
+  private _put(p: string, content: string | Uint8Array | FileData): number {
+    var e = this._lookup(p);
+    if (e && e.type === 'directory') return -21; // EISDIR
+    var dir = dirOf(p), name = baseOf(p);
+    var err = this._ensureDir(dir);
+    if (err < 0) return err;
+    var data: FileData | null = null, size: number;
+    if (this._upper.writeData) {
+      data = content instanceof FileData ? content
+        : typeof content === 'string' ? FileData.fromString(content) : FileData.fromBytes(content);
+      size = data.length;
+      err = this._upper.writeData(p, data);
+    } else {
+      var text = content instanceof FileData ? content.toString()
+        : typeof content === 'string' ? content : utf8Decode(content);
+      size = utf8Length(text);
+      err = this._upper.write(p, text);
+    }
+    if (err < 0) return err;
+    this._shadows.delete(p);
+    var v = this._dir(dir);
+    if (v) {
+      if (v.whiteouts.delete(name)) this._upper.unlink(joinPath(dir, whiteoutName(name)));
+      v.entries.set(name, { layer: UPPER, type: 'file', size: size, data: data });
+    }
+    return 0;
+  }
+
+  /**
+   * Copy up a lower file whose private body was modified.  With a
+   * writeData() upper layer this moves the clone itself — only the chunks
+   * already written were ever copied.
+   */
+  private _promote(p: string, s: Shadow): number {
+    var d = s.data;
+    var shared = d.sharedChunks, copied = d.storedChunks - shared;
+    var err = this._put(p, d);
+    if (err < 0) return err;
+    if (!this._upper.writeData) {
+      // Text-only upper: the body stays authoritative for fds still holding it
+      s.gen = d.generation;
+      this._shadows.set(p, s);
+      var e = this._lookup(p);
+      if (e) e.data = d;
     }
+    this.stats.copyUps++;
+    this.stats.copiedChunks += copied;
+    this.stats.sharedChunks += shared;
+    return 0;
   }
 
-  private _copyUpDir(path: string): void {
-    if (this._upper.exists(path)) return;
-    this._upper.mkdir(path);
+  /**
+   * Copy up every lower file written through fileData() since it was handed
+   * out.  Returns the number copied.
+   */
+  sync(): number {
+    var n = 0;
+    for (var [p, s] of this._shadows) {
+      if (s.data.generation !== s.gen && this._promote(p, s) === 0) n++;
+    }
+    return n;
   }
 
   // ── VFSMount interface ──────────────────────────────────────────────────────
 
   read(path: string): string | null {
-    // Upper layer first
-    if (this._upper.exists(path)) {
-      var content = this._upper.read(path);
-      if (content !== null) return content;
-    }
-    var name = this._basename(path);
-    var dir  = this._dirname(path);
-    if (this._isHidden(dir, name)) return null; // whiteout
-    for (var i = 0; i < this._lower.length; i++) {
-      var data = this._lower[i].read(path);
-      if (data !== null) return data;
-    }
-    return null;
+    var p = normPath(path);
+    var e = this._lookup(p);
+    if (!e || e.type === 'directory') return null;
+    if (e.data) return e.data.toString();
+    return e.layer === UPPER ? this._upper.read(p) : this._lower[e.layer].read(p);
   }
 
-  list(path: string): Array<{ name: string; type: FileType; size: number }> {
-    var seen    = new Set<string>();
-    var hidden  = new Set<string>();
-    var result:  Array<{ name: string; type: FileType; size: number }> = [];
-    var opaque  = this._isOpaque(path);
-
-    // Collect from upper layer
-    var upperEntries = this._upper.list(path);
-    for (var ui = 0; ui < upperEntries.length; ui++) {
-      var uEntry = upperEntries[ui];
-      if (uEntry.name === OPAQUE_MARKER) continue;
-      if (isWhiteout(uEntry.name)) {
-        hidden.add(originalName(uEntry.name));
-        continue;
-      }
-      if (!seen.has(uEntry.name)) {
-        seen.add(uEntry.name);
-        result.push(uEntry);
+  /**
+   * Live body of a file.  A lower-layer file gets a private copy-on-write
+   * clone (no bytes copied) that overrides the lower layer from then on;
+   * only the chunks written through it are ever copied.
+   */
+  fileData(path: string): FileData | null {
+    var p = normPath(path);
+    var e = this._lookup(p);
+    if (!e || e.type !== 'file') return null;
+    if (e.layer === UPPER) {
+      var ud = this._upper.fileData ? this._upper.fileData(p) : null;
+      if (ud) e.data = ud;
+      return ud;
+    }
+    var s = this._shadows.get(p);
+    if (!s) {
+      var lower = this._lower[e.layer];
+      var ld = lower.fileData ? lower.fileData(p) : null;
+      var body: FileData;
+      if (ld) body = ld.clone();
+      else {
+        var text = lower.read(p);
+        if (text === null) return null;
+        body = FileData.fromString(text);
       }
+      s = { data: body, gen: body.generation };
+      this._shadows.set(p, s);
     }
+    e.data = s.data;
+    return s.data;
+  }
 
-    // Stop here if the directory is opaque (no lower passthrough)
-    if (opaque) return result;
-
-    // Merge lower layers (respecting whiteouts)
-    for (var li = 0; li < this._lower.length; li++) {
-      var lowerEntries = this._lower[li].list(path);
-      for (var lj = 0; lj < lowerEntries.length; lj++) {
-        var lEntry = lowerEntries[lj];
-        if (seen.has(lEntry.name) || hidden.has(lEntry.name)) continue;
-        seen.add(lEntry.name);
-        result.push(lEntry);
-      }
+  list(path: string): Array<{ name: string; type: FileType; size: number }> {
+    var result: Array<{ name: string; type: FileType; size: number }> = [];
+    var v = this._dir(normPath(path));
+    if (!v) return result;
+    for (var [name, e] of v.entries) {
+      result.push({ name: name, type: e.type, size: e.data ? e.data.length : e.size });
     }
     return result;
   }
 
   exists(path: string): boolean {
-    if (this._upper.exists(path)) return true;
-    var name = this._basename(path);
-    var dir  = this._dirname(path);
-    if (this._isHidden(dir, name)) return false;
-    for (var i = 0; i < this._lower.length; i++) {
-      if (this._lower[i].exists(path)) return true;
-    }
-    return false;
+    return this._lookup(normPath(path)) !== null;
   }
 
   isDirectory(path: string): boolean {
-    if (this._upper.exists(path)) return this._upper.isDirectory(path);
-    var name = this._basename(path);
-    var dir  = this._dirname(path);
-    if (this._isHidden(dir, name)) return false;
-    for (var i = 0; i < this._lower.length; i++) {
-      if (this._lower[i].exists(path)) return this._lower[i].isDirectory(path);
-    }
-    return false;
+    var e = this._lookup(normPath(path));
+    return !!e && e.type === 'directory';
   }
 
   // ── WritableVFSMount interface ──────────────────────────────────────────────
 
   write(path: string, content: string): number {
-    this._copyUp(path);
-    return this._upper.write(path, content);
+    return this._put(normPath(path), content);
   }
 
-  unlink(path: string): number {
-    var lowerExists = false;
-    var name = this._basename(path);
-    var dir  = this._dirname(path);
-    for (var i = 0; i < this._lower.length; i++) {
-      if (this._lower[i].exists(path)) { lowerExists = true; break; }
+  writeFile(path: string, content: string | Uint8Array): void {
+    this._put(normPath(path), content);
+  }
+
+  /** Append, copying up only the tail chunk of a lower-layer file. */
+  appendFile(path: string, content: string | Uint8Array): void {
+    var p = normPath(path);
+    var e = this._lookup(p);
+    if (!e) { this._put(p, content); return; }
+    if (e.type !== 'file') return;
+    var d = this.fileData(p);
+    if (!d) {
+      var more = typeof content === 'string' ? content : utf8Decode(content);
+      this._put(p, (this.read(p) || '') + more);
+      return;
     }
-    if (this._upper.exists(path)) {
-      var err = this._upper.unlink(path);
+    if (typeof content === 'string') d.appendString(content);
+    else d.append(content);
+    var s = this._shadows.get(p);
+    if (s) this._promote(p, s);
+    else e.size = d.length;
+  }
+
+  deleteFile(path: string): void { this.unlink(path); }
+
+  unlink(path: string): number {
+    var p = normPath(path);
+    var e = this._lookup(p);
+    if (!e) return -2; // ENOENT
+    if (e.type === 'directory') return -21; // EISDIR
+    var dir = dirOf(p), name = baseOf(p);
+    if (e.layer === UPPER) {
+      var err = this._upper.unlink(p);
       if (err < 0 && err !== -2) return err;
     }
+    this._shadows.delete(p);
+    var v = this._dir(dir);
     // If the file exists below, lay down a whiteout
-    if (lowerExists) {
-      var whPath = dir + '/' + whiteoutName(name);
-      this._copyUpDir(dir);
-      return this._upper.write(whPath, '');
+    if (this._lowerHas(p, v)) {
+      this._ensureDir(dir);
+      this._upper.write(joinPath(dir, whiteoutName(name)), '');
+      if (v) v.whiteouts.add(name);
     }
+    if (v) v.entries.delete(name);
     return 0;
   }
 
   mkdir(path: string): number {
-    if (this.exists(path)) return -17; // EEXIST
-    this._copyUpDir(this._dirname(path));
-    var err = this._upper.mkdir(path);
-    if (err < 0) return err;
-    // If lower has the same directory name, mark as opaque so lower entries
-    // don't bleed through after an unlink+mkdir cycle
-    for (var i = 0; i < this._lower.length; i++) {
-      if (this._lower[i].isDirectory(path)) {
-        this._upper.write(path + '/' + OPAQUE_MARKER, '');
-        break;
-      }
-    }
-    return 0;
+    var p = normPath(path);
+    if (this._lookup(p)) return -17; // EEXIST
+    var err = this._ensureDir(dirOf(p));
+    return err < 0 ? err : this._makeDir(p, false);
   }
 
   rmdir(path: string): number {
-    var entries = this.list(path);
-    if (entries.length > 0) return -39; // ENOTEMPTY
-    var name = this._basename(path);
-    var dir  = this._dirname(path);
-    var lowerHas = this._lower.some(function(l) { return l.isDirectory(path); });
-    if (this._upper.exists(path)) this._upper.rmdir(path);
-    if (lowerHas) {
-      this._copyUpDir(dir);
-      this._upper.write(dir + '/' + whiteoutName(name), '');
+    var p = normPath(path);
+    var e = this._lookup(p);
+    if (!e) return -2;
+    if (e.type !== 'directory') return -20; // ENOTDIR
+    var v = this._dir(p);
+    if (v && v.entries.size > 0) return -39; // ENOTEMPTY
+    var dir = dirOf(p), name = baseOf(p);
+    if (this._upper.isDirectory(p)) {
+      // Clear our own markers so the upper directory is really empty
+      if (v) {
+        for (var wh of v.whiteouts) this._upper.unlink(joinPath(p, whiteoutName(wh)));
+        if (v.opaque) this._upper.unlink(joinPath(p, OPAQUE_MARKER));
+      }
+      var err = this._upper.rmdir(p);
+      if (err < 0) return err;
     }
+    var pv = this._dir(dir);
+    if (this._lowerHas(p, pv)) {
+      this._ensureDir(dir);
+      this._upper.write(joinPath(dir, whiteoutName(name)), '');
+      if (pv) pv.whiteouts.add(name);
+    }
+    if (pv) pv.entries.delete(name);
+    this._forget(p);
     return 0;
   }
 
@@ -353,7 +616,13 @@ export class OverlayFS implements WritableVFSMount {
    * Add an additional lower layer below the existing ones.
    * Useful for Docker-style layer stacking where each image layer is pushed.
    */
-  pushLower(layer: VFSMount): void { this._lower.push(layer); }
+  pushLower(layer: VFSMount): void {
+    this._lower.push(layer);
+    this._dirs.clear();
+  }
+
+  /** Drop the merged dentry cache (after a layer was changed behind the overlay's back). */
+  invalidate(): void { this._dirs.clear(); }
 
   get upperLayer(): WritableVFSMount { return this._upper; }
   get lowerLayers(): VFSMount[]      { return this._lower.slice(); }
@@ -0,0 +1,242 @@
+/**
+ * JSOS ROM filesystem — bundled resources, read in place
+ *
+ * scripts/embed-rom.js packs resources/ into build/rom.img, which the kernel
+ * links into its image (romfs_image.s) and hands to JS as one ArrayBuffer
+ * over that memory: kernel.romImage().  Nothing is parsed or copied at boot
+ * beyond a 32-byte header check, so boot time and heap use no longer grow
+ * with the size of the bundled files.
+ *
+ * Image layout (little-endian):
+ *
+ *   0x00  magic 'JSOSROM1'
+ *   0x08  u32 version (1)
+ *   0x0C  u32 entry count
+ *   0x10  u32 entry table offset
+ *   0x14  u32 name table offset
+ *   0x18  u32 name table length
+ *   0x1C  u32 image length
+ *
+ *   entry (24 bytes):
+ *     +0   u32 parent entry index (root: 0)
+ *     +4   u32 name offset in the name table (UTF-8)
+ *     +8   u16 name length    +10 u16 type (1 = file, 2 = directory)
+ *     +12  u32 file: data offset (4 KB aligned) · dir: first child index
+ *     +16  u32 file: byte length              · dir: child count
+ *     +20  u32 mtime (Unix seconds)
+ *
+ * Entry 0 is the root.  Entries are stored breadth-first, so the children of
+ * every directory are contiguous and sorted by name bytes: a path lookup is
+ * one binary search per component and a listing is a slice of the table.
+ *
+ * File bytes come back as subarray views of the image (view(), fileData()),
+ * so reading bible.txt through a file descriptor or sendfile never copies it.
+ * The image is read-only by contract; FileData bodies built over it are
+ * copy-on-write.  mountRom() mounts the image at /rom and installs each file
+ * at its manifest path (e.g. /home/user/bible.txt) as such a body.
+ */
+
+import type { VFSMount, FileType, FileSystem } from './filesystem.js';
+import { FileData } from './filedata.js';
+import { utf8Encode, utf8Decode } from '../core/ringbuf.js';
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
+export const ROM_MAGIC       = 'JSOSROM1';
+export const ROM_VERSION     = 1;
+export const ROM_HEADER_SIZE = 32;
+export const ROM_ENTRY_SIZE  = 24;
+export const ROM_TYPE_FILE   = 1;
+export const ROM_TYPE_DIR    = 2;
+
+export class RomFS implements VFSMount {
+  readonly writable = false;
+  private _img:   Uint8Array;
+  private _dv:    DataView;
+  private _mp:    string;
+  private _count: number;
+  private _ents:  number;
+  private _names: number;
+
+  /**
+   * `image` is the whole ROM; `mountpoint` is stripped from the paths the
+   * VFS passes in.  Throws on a malformed header.
+   */
+  constructor(image: Uint8Array, mountpoint: string = '') {
+    this._img = image;
+    this._dv  = new DataView(image.buffer, image.byteOffset, image.byteLength);
+    this._mp  = mountpoint === '/' ? '' : mountpoint;
+    if (image.length < ROM_HEADER_SIZE) throw new Error('RomFS: image too short');
+    for (var i = 0; i < 8; i++) {
+      if (image[i] !== ROM_MAGIC.charCodeAt(i)) throw new Error('RomFS: bad magic');
+    }
+    var dv = this._dv;
+    if (dv.getUint32(8, true) !== ROM_VERSION) throw new Error('RomFS: unsupported version');
+    this._count = dv.getUint32(12, true);
+    this._ents  = dv.getUint32(16, true);
+    this._names = dv.getUint32(20, true);
+    var len = dv.getUint32(28, true);
+    if (this._count < 1 || len > image.length ||
+        this._ents + this._count * ROM_ENTRY_SIZE > len ||
+        this._names + dv.getUint32(24, true) > len) {
+      throw new Error('RomFS: corrupt header');
+    }
+  }
+
+  // ── Entry table ─────────────────────────────────────────────────────────
+
+  get entryCount(): number { return this._count; }
+
+  private _eo(i: number): number { return this._ents + i * ROM_ENTRY_SIZE; }
+  private _type(i: number): number { return this._dv.getUint16(this._eo(i) + 10, true); }
+  private _a(i: number): number { return this._dv.getUint32(this._eo(i) + 12, true); }
+  private _b(i: number): number { return this._dv.getUint32(this._eo(i) + 16, true); }
+
+  /** Name of entry `i`. */
+  name(i: number): string {
+    var o = this._eo(i);
+    var off = this._names + this._dv.getUint32(o + 4, true);
+    return utf8Decode(this._img.subarray(off, off + this._dv.getUint16(o + 8, true)));
+  }
+
+  /** Compare entry `i`'s name with `key` bytewise (<0, 0, >0). */
+  private _cmp(i: number, key: Uint8Array): number {
+    var o   = this._eo(i);
+    var off = this._names + this._dv.getUint32(o + 4, true);
+    var n   = this._dv.getUint16(o + 8, true);
+    var m   = Math.min(n, key.length);
+    for (var k = 0; k < m; k++) {
+      var d = this._img[off + k] - key[k];
+      if (d) return d;
+    }
+    return n - key.length;
+  }
+
+  /** Child of directory `dir` named `key`, or -1. */
+  private _child(dir: number, key: Uint8Array): number {
+    var lo = this._a(dir), hi = lo + this._b(dir) - 1;
+    while (lo <= hi) {
+      var mid = (lo + hi) >> 1;
+      var c = this._cmp(mid, key);
+      if (c === 0) return mid;
+      if (c < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+  }
+
+  /** Entry index of `path` (absolute, mountpoint included), or -1. */
+  lookup(path: string): number {
+    if (this._mp) {
+      if (path === this._mp) return 0;
+      if (path.indexOf(this._mp + '/') !== 0) return -1;
+      path = path.substring(this._mp.length);
+    }
+    var cur = 0;
+    var parts = path.split('/');
+    for (var i = 0; i < parts.length; i++) {
+      if (!parts[i]) continue;
+      if (this._type(cur) !== ROM_TYPE_DIR) return -1;
+      cur = this._child(cur, utf8Encode(parts[i]));
+      if (cur < 0) return -1;
+    }
+    return cur;
+  }
+
+  /** Zero-copy view of entry `i`'s bytes (file entries only). */
+  entryView(i: number): Uint8Array {
+    var off = this._a(i);
+    return this._img.subarray(off, off + this._b(i));
+  }
+
+  /** Zero-copy view of a file's bytes, or null. */
+  view(path: string): Uint8Array | null {
+    var i = this.lookup(path);
+    return i >= 0 && this._type(i) === ROM_TYPE_FILE ? this.entryView(i) : null;
+  }
+
+  /** Modification time of `path` (ms since the epoch), or -1. */
+  mtime(path: string): number {
+    var i = this.lookup(path);
+    return i < 0 ? -1 : this._dv.getUint32(this._eo(i) + 20, true) * 1000;
+  }
+
+  /**
+   * Call `fn` with the path (relative to the image root, leading '/') and
+   * entry index of every file, in table order.
+   */
+  forEachFile(fn: (path: string, i: number) => void): void {
+    var paths: string[] = new Array(this._count);
+    paths[0] = '';
+    for (var i = 0; i < this._count; i++) {
+      if (this._type(i) === ROM_TYPE_DIR) {
+        var first = this._a(i), n = this._b(i);
+        for (var c = first; c < first + n; c++) paths[c] = paths[i] + '/' + this.name(c);
+      } else {
+        fn(paths[i], i);
+      }
+    }
+  }
+
+  // ── VFSMount ────────────────────────────────────────────────────────────
+
+  read(path: string): string | null {
+    var v = this.view(path);
+    return v ? utf8Decode(v) : null;
+  }
+
+  /** Copy-on-write body over the image — reads and sendfile never copy. */
+  fileData(path: string): FileData | null {
+    var v = this.view(path);
+    return v ? FileData.fromView(v) : null;
+  }
+
+  list(path: string): Array<{ name: string; type: FileType; size: number }> {
+    var out: Array<{ name: string; type: FileType; size: number }> = [];
+    var d = this.lookup(path);
+    if (d < 0 || this._type(d) !== ROM_TYPE_DIR) return out;
+    var first = this._a(d), n = this._b(d);
+    for (var c = first; c < first + n; c++) {
+      var dir = this._type(c) === ROM_TYPE_DIR;
+      out.push({ name: this.name(c), type: dir ? 'directory' : 'file', size: dir ? 0 : this._b(c) });
+    }
+    return out;
+  }
+
+  exists(path: string): boolean { return this.lookup(path) >= 0; }
+
+  isDirectory(path: string): boolean {
+    var i = this.lookup(path);
+    return i >= 0 && this._type(i) === ROM_TYPE_DIR;
+  }
+}
+
+/** The ROM linked into the kernel, or null when there is none (or it is bad). */
+export function openKernelRom(mountpoint: string = '/rom'): RomFS | null {
+  var buf = typeof kernel.romImage === 'function' ? kernel.romImage() : null;
+  if (!buf || buf.byteLength < ROM_HEADER_SIZE) return null;
+  try {
+    return new RomFS(new Uint8Array(buf), mountpoint);
+  } catch (e) {
+    kernel.serialPut('[romfs] ' + e + '\n');
+    return null;
+  }
+}
+
+/**
+ * Mount the kernel ROM at /rom and install each of its files at the same
+ * path in the root tree (the ROM holds /home/user/bible.txt, etc.) as a
+ * zero-copy body.  Existing files are left alone.  Returns the number of
+ * files installed.
+ */
+export function mountRom(fs: FileSystem): number {
+  var rom = openKernelRom('/rom');
+  if (!rom) return 0;
+  fs.mkdir('/rom');
+  fs.mountVFS('/rom', rom);
+  var n = 0;
+  rom.forEachFile(function(path, i) {
+    if (fs.exists(path)) return;
+    if (fs.installFileData(path, FileData.fromView(rom!.entryView(i)))) n++;
+  });
+  return n;
+}
@@ -0,0 +1,1024 @@
+/**
+ * JSOS Zstandard codec
+ *
+ * RFC 8878 frames, in TypeScript.
+ *
+ * Decoder — everything a standard encoder emits without a dictionary: raw,
+ * RLE and compressed blocks; raw, RLE and Huffman literals (1 or 4 streams,
+ * direct or FSE-compressed weights, treeless reuse); predefined, RLE,
+ * FSE-described and repeated sequence tables; repeat offsets; concatenated
+ * and skippable frames.  The optional XXH64 content checksum is skipped,
+ * not verified.
+ *
+ * Encoder — single-segment frames of ≤ 128 KB blocks.  An LZ77 pass over
+ * hash chains (search depth, lazy steps and target length grow with the
+ * level, see ZSTD_LEVELS) produces sequences coded with the predefined FSE
+ * distributions; literals are Huffman coded with direct weights when that
+ * is smaller, and blocks that do not shrink are stored raw.  Ratios land
+ * between LZ4 and reference zstd at the same level, and any zstd decoder
+ * reads the output.
+ */
+
+import { OutBuffer } from './decompress-stream.js';
+
+export const ZSTD_MAGIC = 0xfd2fb528;
+const SKIPPABLE_MASK    = 0xfffffff0;
+const SKIPPABLE_MAGIC   = 0x184d2a50;
+const BLOCK_MAX         = 128 * 1024;
+const WINDOW_LOG        = 23;          // encoder window for multi-segment frames
+const HUF_MAX_BITS      = 11;
+
+// ── Code tables (RFC 8878 §3.1.1.3.2.1) ──────────────────────────────────────
+
+const LL_BASE = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+  8192, 16384, 32768, 65536];
+const LL_BITS = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16];
+const ML_BASE = [3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+  19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+  35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+  4099, 8195, 16387, 32771, 65539];
+const ML_BITS = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16];
+
+const LL_DEFAULT = [4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1];
+const ML_DEFAULT = [1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1];
+const OF_DEFAULT = [1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1];
+
+const LL_MAX = 35, ML_MAX = 52, OF_MAX = 31;
+
+function highbit(v: number): number { return 31 - Math.clz32(v); }
+
+function corrupt(what: string): never { throw new Error('zstd: ' + what); }
+
+// ── FSE tables ───────────────────────────────────────────────────────────────
+
+/** Decoding table: state → symbol, bits to read, next-state base. */
+interface FseTable { log: number; sym: Uint8Array; nb: Uint8Array; base: Uint16Array; }
+
+/** Spread symbols over the table exactly as the encoder does (§4.1.1). */
+function spread(norm: ArrayLike<number>, nsym: number, log: number, out: Uint8Array): number {
+  var size = 1 << log, high = size - 1;
+  for (var s = 0; s < nsym; s++) if (norm[s] === -1) out[high--] = s;
+  var step = (size >> 1) + (size >> 3) + 3, mask = size - 1, pos = 0;
+  for (s = 0; s < nsym; s++) {
+    for (var i = 0; i < norm[s]; i++) {
+      out[pos] = s;
+      do pos = (pos + step) & mask; while (pos > high);
+    }
+  }
+  if (pos !== 0) corrupt('bad FSE distribution');
+  return high;
+}
+
+function buildFse(norm: ArrayLike<number>, nsym: number, log: number): FseTable {
+  var size = 1 << log;
+  var t: FseTable = { log: log, sym: new Uint8Array(size), nb: new Uint8Array(size), base: new Uint16Array(size) };
+  spread(norm, nsym, log, t.sym);
+  var next = new Uint16Array(nsym);
+  for (var s = 0; s < nsym; s++) next[s] = norm[s] === -1 ? 1 : norm[s];
+  for (var u = 0; u < size; u++) {
+    var x = next[t.sym[u]]++;
+    var b = log - highbit(x);
+    t.nb[u] = b;
+    t.base[u] = (x << b) - size;
+  }
+  return t;
+}
+
+function rleTable(sym: number): FseTable {
+  return { log: 0, sym: new Uint8Array([sym]), nb: new Uint8Array(1), base: new Uint16Array(1) };
+}
+
+var _llDef: FseTable | null = null, _mlDef: FseTable | null = null, _ofDef: FseTable | null = null;
+function llDefault(): FseTable { return _llDef || (_llDef = buildFse(LL_DEFAULT, LL_DEFAULT.length, 6)); }
+function mlDefault(): FseTable { return _mlDef || (_mlDef = buildFse(ML_DEFAULT, ML_DEFAULT.length, 6)); }
+function ofDefault(): FseTable { return _ofDef || (_ofDef = buildFse(OF_DEFAULT, OF_DEFAULT.length, 5)); }
+
+/** `n` (≤ 24) bits at little-endian bit offset `bit` of `d[start …]`. */
+function bitsAt(d: Uint8Array, start: number, bit: number, n: number): number {
+  var i = start + (bit >> 3);
+  var v = (d[i] | (d[i + 1] << 8) | (d[i + 2] << 16) | (d[i + 3] << 24)) >>> (bit & 7);
+  return v & ((1 << n) - 1);
+}
+
+/**
+ * Read an FSE table description (§4.1.1) at `d[p]`.  Returns the table and
+ * the number of bytes it occupied.
+ */
+function readFse(d: Uint8Array, p: number, end: number, maxSym: number, maxLog: number):
+    { table: FseTable; size: number } {
+  if (p >= end) corrupt('truncated FSE header');
+  var log = (d[p] & 15) + 5;
+  if (log > maxLog) corrupt('FSE accuracy too high');
+  var bit = 4;
+  var remaining = (1 << log) + 1, threshold = 1 << log, nbBits = log + 1;
+  var norm = new Int16Array(maxSym + 1);
+  var s = 0, prev0 = false;
+  while (remaining > 1 && s <= maxSym) {
+    if (prev0) {
+      var n0 = s;
+      while (bitsAt(d, p, bit, 16) === 0xffff) { n0 += 24; bit += 16; }
+      while (bitsAt(d, p, bit, 2) === 3) { n0 += 3; bit += 2; }
+      n0 += bitsAt(d, p, bit, 2); bit += 2;
+      if (n0 > maxSym) corrupt('FSE symbol overflow');
+      while (s < n0) norm[s++] = 0;
+    }
+    var max = (2 * threshold - 1) - remaining;
+    var v = bitsAt(d, p, bit, nbBits);
+    var count: number;
+    if ((v & (threshold - 1)) < max) { count = v & (threshold - 1); bit += nbBits - 1; }
+    else { count = v & (2 * threshold - 1); if (count >= threshold) count -= max; bit += nbBits; }
+    count--;
+    remaining -= count < 0 ? -count : count;
+    norm[s++] = count;
+    prev0 = count === 0;
+    while (remaining < threshold) { nbBits--; threshold >>= 1; }
+  }
+  var size = (bit + 7) >> 3;
+  if (remaining !== 1 || p + size > end) corrupt('bad FSE header');
+  return { table: buildFse(norm, s, log), size: size };
+}
+
+// ── Backward bit stream ──────────────────────────────────────────────────────
+
+/**
+ * Reader for the reversed bit streams of §4.1: the last byte holds a
+ * 1-bit end marker, and fields are read from the top down.  `pos` is the
+ * number of unread bits; reads past the start return zeros and leave
+ * `pos` negative (the "overflow" the FSE weight decoder relies on).
+ */
+class BackBits {
+  pos: number;
+  constructor(private d: Uint8Array, private start: number, end: number) {
+    if (end <= start || !d[end - 1]) corrupt('bad bit stream');
+    this.pos = (end - 1 - start) * 8 + highbit(d[end - 1]);
+  }
+  peek(n: number): number {
+    var p = this.pos - n;
+    if (p >= 0) return bitsAt(this.d, this.start, p, n);
+    return n + p <= 0 ? 0 : bitsAt(this.d, this.start, 0, n + p) << -p;
+  }
+  read(n: number): number {
+    if (n === 0) return 0;
+    if (n > 24) {
+      var hi = this.read(n - 24);
+      return hi * 16777216 + this.read(24);
+    }
+    var v = this.peek(n);
+    this.pos -= n;
+    return v;
+  }
+}
+
+// ── Huffman literals ─────────────────────────────────────────────────────────
+
+interface HufTable { maxBits: number; sym: Uint8Array; nb: Uint8Array; }
+
+/** Huffman weights (§4.2.1) at `d[p]`; returns the table and bytes used. */
+function readHuf(d: Uint8Array, p: number, end: number): { table: HufTable; size: number } {
+  var hb = d[p];
+  var w = new Uint8Array(256);
+  var n: number, size: number;
+  if (hb >= 128) {
+    n = hb - 127;
+    size = 1 + ((n + 1) >> 1);
+    if (p + size > end) corrupt('truncated Huffman weights');
+    for (var i = 0; i < n; i++) {
+      var b = d[p + 1 + (i >> 1)];
+      w[i] = i & 1 ? b & 15 : b >> 4;
+    }
+  } else {
+    size = 1 + hb;
+    if (p + size > end) corrupt('truncated Huffman weights');
+    var f = readFse(d, p + 1, p + size, 255, 6);
+    var t = f.table;
+    var br = new BackBits(d, p + 1 + f.size, p + size);
+    var s1 = br.read(t.log), s2 = br.read(t.log);
+    n = 0;
+    for (;;) {
+      if (n > 253) corrupt('too many Huffman weights');
+      w[n++] = t.sym[s1]; s1 = t.base[s1] + br.read(t.nb[s1]);
+      if (br.pos < 0) { w[n++] = t.sym[s2]; break; }
+      w[n++] = t.sym[s2]; s2 = t.base[s2] + br.read(t.nb[s2]);
+      if (br.pos < 0) { w[n++] = t.sym[s1]; break; }
+    }
+  }
+  return { table: buildHuf(w, n), size: size };
+}
+
+/** Decoding table from `n` explicit weights (the last one is implied). */
+function buildHuf(w: Uint8Array, n: number): HufTable {
+  var total = 0;
+  for (var i = 0; i < n; i++) {
+    if (w[i] > HUF_MAX_BITS + 1) corrupt('bad Huffman weight');
+    if (w[i]) total += 1 << (w[i] - 1);
+  }
+  if (!total) corrupt('empty Huffman table');
+  var maxBits = highbit(total) + 1;
+  var rest = (1 << maxBits) - total;
+  if (rest & (rest - 1)) corrupt('incomplete Huffman table');
+  if (maxBits > HUF_MAX_BITS) corrupt('Huffman table too deep');
+  w[n] = highbit(rest) + 1;
+  var size = 1 << maxBits;
+  var t: HufTable = { maxBits: maxBits, sym: new Uint8Array(size), nb: new Uint8Array(size) };
+  var pos = 0;
+  for (var wt = 1; wt <= maxBits; wt++) {
+    for (var s = 0; s <= n; s++) {
+      if (w[s] !== wt) continue;
+      var len = 1 << (wt - 1);
+      t.sym.fill(s, pos, pos + len);
+      t.nb.fill(maxBits + 1 - wt, pos, pos + len);
+      pos += len;
+    }
+  }
+  return t;
+}
+
+function hufStream(d: Uint8Array, s: number, e: number, t: HufTable, out: Uint8Array, o: number, count: number): void {
+  var br = new BackBits(d, s, e);
+  var mb = t.maxBits, sym = t.sym, nb = t.nb;
+  for (var i = 0; i < count; i++) {
+    var k = br.peek(mb);
+    out[o + i] = sym[k];
+    br.pos -= nb[k];
+  }
+  if (br.pos !== 0) corrupt('Huffman stream size mismatch');
+}
+
+// ── Decoder ──────────────────────────────────────────────────────────────────
+
+/** State carried across the blocks of one frame. */
+interface FrameState {
+  reps: number[];
+  huf:  HufTable | null;
+  ll:   FseTable | null;
+  of:   FseTable | null;
+  ml:   FseTable | null;
+  lit:  Uint8Array;
+}
+
+/**
+ * Decompress every frame in `src`.  `sizeHint` pre-sizes the output when
+ * the frames do not record their content size.  Throws on corrupt input.
+ */
+export function zstdDecompress(src: Uint8Array, sizeHint: number = 0): Uint8Array {
+  var h = zstdFrameInfo(src);
+  var out = new OutBuffer(Math.max(sizeHint, h && h.contentSize > 0 ? h.contentSize : src.length * 4));
+  var p = 0;
+  while (p < src.length) {
+    if (p + 4 > src.length) corrupt('truncated frame');
+    var magic = (src[p] | (src[p + 1] << 8) | (src[p + 2] << 16) | (src[p + 3] << 24)) >>> 0;
+    if ((magic & SKIPPABLE_MASK) === SKIPPABLE_MAGIC) {
+      var skip = (src[p + 4] | (src[p + 5] << 8) | (src[p + 6] << 16) | (src[p + 7] << 24)) >>> 0;
+      p += 8 + skip;
+      continue;
+    }
+    if (magic !== ZSTD_MAGIC) corrupt('bad magic');
+    p = decodeFrame(src, p, out);
+  }
+  return out.buf.subarray(0, out.len);
+}
+
+/**
+ * Decompress into a caller buffer (e.g. a cache slot).  Returns the number
+ * of bytes written; throws if `dst` is too small or the input is corrupt.
+ */
+export function zstdDecompressInto(src: Uint8Array, dst: Uint8Array): number {
+  var out = new OutBuffer(0);
+  out.buf = dst;
+  var p = 0;
+  while (p < src.length) {
+    var magic = (src[p] | (src[p + 1] << 8) | (src[p + 2] << 16) | (src[p + 3] << 24)) >>> 0;
+    if (magic !== ZSTD_MAGIC) corrupt('bad magic');
+    p = decodeFrame(src, p, out);
+  }
+  if (out.buf !== dst) corrupt('output larger than destination');
+  return out.len;
+}
+
+function decodeFrame(d: Uint8Array, p: number, out: OutBuffer): number {
+  var fhd = d[p + 4];
+  if (fhd & 0x08) corrupt('reserved frame header bit');
+  var single = (fhd & 0x20) !== 0;
+  var q = p + 5 + (single ? 0 : 1);
+  var dictBytes = [0, 1, 2, 4][fhd & 3];
+  var dictId = 0;
+  for (var i = 0; i < dictBytes; i++) dictId |= d[q + i] << (8 * i);
+  if (dictId) corrupt('dictionaries are not supported');
+  q += dictBytes;
+  var fcsFlag = fhd >> 6;
+  q += fcsFlag === 0 ? (single ? 1 : 0) : 1 << fcsFlag;
+  var start = out.len;
+  var st: FrameState = { reps: [1, 4, 8], huf: null, ll: null, of: null, ml: null, lit: new Uint8Array(0) };
+  for (;;) {
+    if (q + 3 > d.length) corrupt('truncated block header');
+    var bh = d[q] | (d[q + 1] << 8) | (d[q + 2] << 16);
+    q += 3;
+    var last = bh & 1, type = (bh >> 1) & 3, size = bh >>> 3;
+    if (type === 0) {
+      if (q + size > d.length) corrupt('truncated raw block');
+      var b = out.ensure(size);
+      b.set(d.subarray(q, q + size), out.len);
+      out.len += size;
+      q += size;
+    } else if (type === 1) {
+      out.ensure(size).fill(d[q], out.len, out.len + size);
+      out.len += size;
+      q += 1;
+    } else if (type === 2) {
+      if (q + size > d.length) corrupt('truncated block');
+      decodeBlock(d, q, q + size, st, out, start);
+      q += size;
+    } else {
+      corrupt('reserved block type');
+    }
+    if (last) break;
+  }
+  if (fhd & 0x04) q += 4;                       // content checksum (not verified)
+  return q;
+}
+
+function decodeBlock(d: Uint8Array, p: number, end: number, st: FrameState, out: OutBuffer, frameStart: number): void {
+  // ── Literals section ──
+  var b0 = d[p], ltype = b0 & 3, sf = (b0 >> 2) & 3;
+  var lit: Uint8Array, nlit: number;
+  if (ltype < 2) {
+    var hdr = sf === 1 ? 2 : sf === 3 ? 3 : 1;
+    nlit = sf === 1 ? (b0 >> 4) + (d[p + 1] << 4)
+         : sf === 3 ? (b0 >> 4) + (d[p + 1] << 4) + (d[p + 2] << 12)
+         : b0 >> 3;
+    p += hdr;
+    if (ltype === 0) {
+      if (p + nlit > end) corrupt('truncated literals');
+      lit = d.subarray(p, p + nlit);
+      p += nlit;
+    } else {
+      if (st.lit.length < nlit) st.lit = new Uint8Array(Math.max(nlit, BLOCK_MAX));
+      lit = st.lit;
+      lit.fill(d[p], 0, nlit);
+      p += 1;
+    }
+  } else {
+    var streams = sf === 0 ? 1 : 4, comp: number;
+    if (sf < 2) {
+      nlit = (b0 >> 4) | ((d[p + 1] & 0x3f) << 4);
+      comp = (d[p + 1] >> 6) | (d[p + 2] << 2);
+      p += 3;
+    } else if (sf === 2) {
+      nlit = (b0 >> 4) | (d[p + 1] << 4) | ((d[p + 2] & 3) << 12);
+      comp = (d[p + 2] >> 2) | (d[p + 3] << 6);
+      p += 4;
+    } else {
+      nlit = (b0 >> 4) | (d[p + 1] << 4) | ((d[p + 2] & 0x3f) << 12);
+      comp = (d[p + 2] >> 6) | (d[p + 3] << 2) | (d[p + 4] << 10);
+      p += 5;
+    }
+    var cend = p + comp;
+    if (cend > end) corrupt('truncated literals');
+    if (ltype === 2) {
+      var h = readHuf(d, p, cend);
+      st.huf = h.table;
+      p += h.size;
+    } else if (!st.huf) {
+      corrupt('treeless literals without a table');
+    }
+    if (st.lit.length < nlit) st.lit = new Uint8Array(Math.max(nlit, BLOCK_MAX));
+    lit = st.lit;
+    if (streams === 1) {
+      hufStream(d, p, cend, st.huf!, lit, 0, nlit);
+    } else {
+      var s1 = d[p] | (d[p + 1] << 8), s2 = d[p + 2] | (d[p + 3] << 8), s3 = d[p + 4] | (d[p + 5] << 8);
+      var seg = (nlit + 3) >> 2;
+      var a = p + 6, bb = a + s1, c = bb + s2, e = c + s3;
+      if (e > cend) corrupt('bad jump table');
+      hufStream(d, a, bb, st.huf!, lit, 0, seg);
+      hufStream(d, bb, c, st.huf!, lit, seg, seg);
+      hufStream(d, c, e, st.huf!, lit, 2 * seg, seg);
+      hufStream(d, e, cend, st.huf!, lit, 3 * seg, nlit - 3 * seg);
+    }
+    p = cend;
+  }
+
+  // ── Sequences section ──
+  if (p >= end) corrupt('missing sequences header');
+  var nseq = d[p++];
+  if (nseq >= 128) {
+    if (nseq === 255) { nseq = d[p] + (d[p + 1] << 8) + 0x7f00; p += 2; }
+    else { nseq = ((nseq - 128) << 8) + d[p++]; }
+  }
+  var buf = out.ensure(nlit);
+  var o = out.len, lp = 0;
+  if (nseq > 0) {
+    var modes = d[p++];
+    st.ll = seqTable(d, p, end, modes >> 6, st.ll, llDefault, LL_MAX, 9); p += _tabBytes;
+    st.of = seqTable(d, p, end, (modes >> 4) & 3, st.of, ofDefault, OF_MAX, 8); p += _tabBytes;
+    st.ml = seqTable(d, p, end, (modes >> 2) & 3, st.ml, mlDefault, ML_MAX, 9); p += _tabBytes;
+    var llT = st.ll!, ofT = st.of!, mlT = st.ml!;
+    var br = new BackBits(d, p, end);
+    var llS = br.read(llT.log), ofS = br.read(ofT.log), mlS = br.read(mlT.log);
+    var reps = st.reps;
+    for (var i = 0; i < nseq; i++) {
+      var ofc = ofT.sym[ofS], mlc = mlT.sym[mlS], llc = llT.sym[llS];
+      if (ofc > OF_MAX || mlc > ML_MAX || llc > LL_MAX) corrupt('bad sequence code');
+      var ofv = (1 << ofc >>> 0) + br.read(ofc);
+      var ml = ML_BASE[mlc] + br.read(ML_BITS[mlc]);
+      var ll = LL_BASE[llc] + br.read(LL_BITS[llc]);
+      var off = applyRep(reps, ofv, ll);
+      if (i + 1 < nseq) {
+        llS = llT.base[llS] + br.read(llT.nb[llS]);
+        mlS = mlT.base[mlS] + br.read(mlT.nb[mlS]);
+        ofS = ofT.base[ofS] + br.read(ofT.nb[ofS]);
+      }
+      // execute: literals, then the match
+      if (lp + ll > nlit) corrupt('literal overrun');
+      if (o + ll + ml > buf.length) { out.len = o; buf = out.ensure(ll + ml); }
+      if (ll > 16) buf.set(lit.subarray(lp, lp + ll), o);
+      else for (var k = 0; k < ll; k++) buf[o + k] = lit[lp + k];
+      o += ll; lp += ll;
+      if (off > o - frameStart || off === 0) corrupt('offset beyond window');
+      var from = o - off;
+      if (off >= ml && ml > 32) buf.copyWithin(o, from, from + ml);
+      else for (k = 0; k < ml; k++) buf[o + k] = buf[from + k];
+      o += ml;
+    }
+    if (br.pos !== 0) corrupt('sequence stream size mismatch');
+  }
+  var rest = nlit - lp;
+  if (o + rest > buf.length) { out.len = o; buf = out.ensure(rest); }
+  buf.set(lit.subarray(lp, nlit), o);
+  out.len = o + rest;
+}
+
+var _tabBytes = 0;
+
+/** Sequence table for one symbol type per its compression mode (§3.1.1.3.2.2). */
+function seqTable(d: Uint8Array, p: number, end: number, mode: number, prev: FseTable | null,
+                  def: () => FseTable, maxSym: number, maxLog: number): FseTable {
+  _tabBytes = 0;
+  if (mode === 0) return def();
+  if (mode === 1) {
+    if (d[p] > maxSym) corrupt('bad RLE symbol');
+    _tabBytes = 1;
+    return rleTable(d[p]);
+  }
+  if (mode === 2) {
+    var f = readFse(d, p, end, maxSym, maxLog);
+    _tabBytes = f.size;
+    return f.table;
+  }
+  if (!prev) corrupt('repeat table without a previous one');
+  return prev;
+}
+
+/**
+ * Resolve an offset value against the repeat-offset history and update it
+ * (§3.1.1.5).  Shared by the decoder and the encoder so both agree.
+ */
+function applyRep(reps: number[], ofv: number, ll: number): number {
+  if (ofv > 3) {
+    reps[2] = reps[1]; reps[1] = reps[0];
+    return reps[0] = ofv - 3;
+  }
+  var idx = ofv - 1 + (ll === 0 ? 1 : 0);
+  if (idx === 0) return reps[0];
+  var off = idx === 3 ? reps[0] - 1 : reps[idx];
+  if (idx !== 1) reps[2] = reps[1];
+  reps[1] = reps[0];
+  return reps[0] = off;
+}
+
+// ── Frame header ─────────────────────────────────────────────────────────────
+
+export interface ZstdFrameInfo {
+  windowSize:  number;
+  /** Decompressed size, or -1 when the frame does not record it. */
+  contentSize: number;
+  dictId:      number;
+  hasChecksum: boolean;
+  headerSize:  number;
+}
+
+/** Parse the frame header at `d[p]` (§3.1.1.1), or null if it is not one. */
+export function zstdFrameInfo(d: Uint8Array, p: number = 0): ZstdFrameInfo | null {
+  if (p + 6 > d.length) return null;
+  var magic = (d[p] | (d[p + 1] << 8) | (d[p + 2] << 16) | (d[p + 3] << 24)) >>> 0;
+  if (magic !== ZSTD_MAGIC) return null;
+  var fhd = d[p + 4];
+  var single = (fhd & 0x20) !== 0;
+  var q = p + 5;
+  var windowSize = 0;
+  if (!single) {
+    var exp = (d[q] >> 3) + 10, mant = d[q] & 7;
+    windowSize = Math.pow(2, exp) + Math.pow(2, exp - 3) * mant;
+    q++;
+  }
+  var dictBytes = [0, 1, 2, 4][fhd & 3], dictId = 0;
+  for (var i = 0; i < dictBytes; i++) dictId += d[q + i] * Math.pow(256, i);
+  q += dictBytes;
+  var fcsFlag = fhd >> 6;
+  var fcsBytes = fcsFlag === 0 ? (single ? 1 : 0) : 1 << fcsFlag;
+  var fcs = -1;
+  if (fcsBytes) {
+    fcs = 0;
+    for (i = 0; i < fcsBytes; i++) fcs += d[q + i] * Math.pow(256, i);
+    if (fcsBytes === 2) fcs += 256;
+  }
+  q += fcsBytes;
+  if (single) windowSize = fcs;
+  return { windowSize: windowSize, contentSize: fcs, dictId: dictId,
+           hasChecksum: (fhd & 0x04) !== 0, headerSize: q - p };
+}
+
+// ── Encoder ──────────────────────────────────────────────────────────────────
+
+/** Match finder parameters per level: chain depth, lazy steps, good-enough length. */
+interface LevelParams { hashLog: number; chainLog: number; depth: number; lazy: number; target: number; }
+
+export const ZSTD_MIN_LEVEL = 1;
+export const ZSTD_MAX_LEVEL = 19;
+
+const ZSTD_LEVELS: LevelParams[] = [
+  { hashLog: 14, chainLog: 0,  depth: 1,   lazy: 0, target: 16 },   // 1
+  { hashLog: 15, chainLog: 15, depth: 2,   lazy: 0, target: 16 },
+  { hashLog: 16, chainLog: 16, depth: 4,   lazy: 1, target: 24 },   // 3 (default)
+  { hashLog: 16, chainLog: 16, depth: 8,   lazy: 1, target: 32 },
+  { hashLog: 17, chainLog: 17, depth: 16,  lazy: 1, target: 48 },
+  { hashLog: 17, chainLog: 17, depth: 32,  lazy: 2, target: 64 },   // 6
+  { hashLog: 17, chainLog: 17, depth: 48,  lazy: 2, target: 96 },
+  { hashLog: 17, chainLog: 18, depth: 64,  lazy: 2, target: 128 },
+  { hashLog: 18, chainLog: 18, depth: 96,  lazy: 2, target: 192 },
+  { hashLog: 18, chainLog: 18, depth: 128, lazy: 2, target: 256 },  // 10
+  { hashLog: 18, chainLog: 19, depth: 192, lazy: 2, target: 256 },
+  { hashLog: 18, chainLog: 19, depth: 256, lazy: 2, target: 384 },
+  { hashLog: 19, chainLog: 19, depth: 384, lazy: 2, target: 512 },
+  { hashLog: 19, chainLog: 20, depth: 512, lazy: 2, target: 768 },
+  { hashLog: 19, chainLog: 20, depth: 768, lazy: 2, target: 1024 }, // 15
+  { hashLog: 20, chainLog: 20, depth: 1024, lazy: 2, target: 2048 },
+  { hashLog: 20, chainLog: 21, depth: 1536, lazy: 2, target: 4096 },
+  { hashLog: 20, chainLog: 21, depth: 2048, lazy: 2, target: 8192 },
+  { hashLog: 20, chainLog: 22, depth: 4096, lazy: 2, target: 65536 }, // 19
+];
+
+/** Encoding side of an FSE table (§4.1.1, tANS). */
+interface FseCTable { log: number; state: Uint16Array; dnb: Int32Array; dfind: Int32Array; }
+
+function buildCTable(norm: number[], log: number): FseCTable {
+  var nsym = norm.length, size = 1 << log;
+  var tsym = new Uint8Array(size);
+  spread(norm, nsym, log, tsym);
+  var cumul = new Int32Array(nsym + 1);
+  for (var s = 0; s < nsym; s++) cumul[s + 1] = cumul[s] + (norm[s] === -1 ? 1 : norm[s]);
+  var state = new Uint16Array(size);
+  for (var u = 0; u < size; u++) state[cumul[tsym[u]]++] = size + u;
+  var t: FseCTable = { log: log, state: state, dnb: new Int32Array(nsym), dfind: new Int32Array(nsym) };
+  var total = 0;
+  for (s = 0; s < nsym; s++) {
+    var c = norm[s];
+    if (c === 0) { t.dnb[s] = ((log + 1) << 16) - size; continue; }
+    if (c === 1 || c === -1) {
+      t.dnb[s] = (log << 16) - size;
+      t.dfind[s] = total - 1;
+      total++;
+    } else {
+      var maxOut = log - highbit(c - 1);
+      t.dnb[s] = (maxOut << 16) - (c << maxOut);
+      t.dfind[s] = total - c;
+      total += c;
+    }
+  }
+  return t;
+}
+
+var _llC: FseCTable | null = null, _mlC: FseCTable | null = null, _ofC: FseCTable | null = null;
+
+/** LSB-first bit writer; the decoder reads what it writes back to front. */
+class BitOut {
+  pos = 0;
+  private acc = 0;
+  private n = 0;
+  constructor(public buf: Uint8Array, start: number) { this.pos = start; }
+  add(v: number, nb: number): void {
+    if (nb > 24) { this.add(v & 0xffffff, 24); this.add(Math.floor(v / 16777216), nb - 24); return; }
+    if (nb === 0) return;
+    this.acc |= (v & ((1 << nb) - 1)) << this.n;
+    this.n += nb;
+    while (this.n >= 8) { this.buf[this.pos++] = this.acc & 255; this.acc >>>= 8; this.n -= 8; }
+  }
+  /** End marker and final partial byte. */
+  close(): number {
+    this.add(1, 1);
+    if (this.n > 0) { this.buf[this.pos++] = this.acc & 255; this.acc = 0; this.n = 0; }
+    return this.pos;
+  }
+}
+
+/** Literal-length code of `ll`. */
+function llCode(ll: number): number {
+  if (ll < 16) return ll;
+  if (ll >= 64) return highbit(ll) + 19;
+  var c = 16;
+  while (c < 24 && LL_BASE[c + 1] <= ll) c++;
+  return c;
+}
+
+/** Match-length code of `ml` (≥ 3). */
+function mlCode(ml: number): number {
+  var b = ml - 3;
+  if (b < 32) return b;
+  if (b >= 128) return highbit(b) + 36;
+  var c = 32;
+  while (c < 42 && ML_BASE[c + 1] <= ml) c++;
+  return c;
+}
+
+/** Per-frame encoder state: match-finder tables and the repeat offsets. */
+class ZstdEncoder {
+  private p: LevelParams;
+  private head: Int32Array;
+  private chain: Int32Array | null;
+  private chainMask: number;
+  private maxDist: number;
+  reps = [1, 4, 8];
+  // sequences of the current block
+  private sLL = new Int32Array(BLOCK_MAX / 3 + 16);
+  private sML = new Int32Array(BLOCK_MAX / 3 + 16);
+  private sOF = new Int32Array(BLOCK_MAX / 3 + 16);
+  private nseq = 0;
+  private lits = new Uint8Array(BLOCK_MAX);
+  private nlit = 0;
+  private nextIns = 0;
+
+  constructor(private src: Uint8Array, level: number, windowSize: number) {
+    this.p = ZSTD_LEVELS[Math.max(ZSTD_MIN_LEVEL, Math.min(ZSTD_MAX_LEVEL, level | 0)) - 1];
+    this.head = new Int32Array(1 << this.p.hashLog).fill(-1);
+    this.chain = this.p.chainLog ? new Int32Array(1 << this.p.chainLog) : null;
+    this.chainMask = (1 << this.p.chainLog) - 1;
+    this.maxDist = this.chain ? Math.min(windowSize, 1 << this.p.chainLog) : windowSize;
+  }
+
+  private hash(i: number): number {
+    var s = this.src;
+    var v = s[i] | (s[i + 1] << 8) | (s[i + 2] << 16) | (s[i + 3] << 24);
+    return Math.imul(v, 0x9e3779b1) >>> (32 - this.p.hashLog);
+  }
+
+  /** Insert every position up to (not including) `to` into the hash chains. */
+  private insertTo(to: number): void {
+    var end = Math.min(to, this.src.length - 3);
+    for (var i = this.nextIns; i < end; i++) {
+      var h = this.hash(i);
+      if (this.chain) this.chain[i & this.chainMask] = this.head[h];
+      this.head[h] = i;
+    }
+    if (end > this.nextIns) this.nextIns = end;
+  }
+
+  /** Longest match at `i` within [i, lim): sets _len / _off. */
+  private _len = 0;
+  private _off = 0;
+  private find(i: number, lim: number, litLen: number): void {
+    var s = this.src, best = 0, bestOff = 0;
+    // repeat offsets first: cheaper to code when litLen > 0
+    if (litLen > 0) {
+      for (var r = 0; r < 3; r++) {
+        var ro = this.reps[r];
+        if (ro > i) continue;
+        var l = 0;
+        while (i + l < lim && s[i + l] === s[i + l - ro]) l++;
+        if (l >= 4 && l > best) { best = l; bestOff = ro; }
+      }
+    }
+    this.insertTo(i);
+    var cand = this.head[this.hash(i)];
+    var depth = this.p.depth, target = this.p.target;
+    while (cand >= 0 && depth-- > 0) {
+      var dist = i - cand;
+      if (dist > this.maxDist || dist <= 0) break;
+      if (s[cand + best] === s[i + best]) {
+        var n = 0;
+        while (i + n < lim && s[cand + n] === s[i + n]) n++;
+        if (n > best + 1 || (n > best && dist !== bestOff)) { best = n; bestOff = dist; }
+        if (best >= target) break;
+      }
+      if (!this.chain) break;
+      var next = this.chain[cand & this.chainMask];
+      if (next >= cand) break;
+      cand = next;
+    }
+    this._len = best >= 4 ? best : 0;
+    this._off = bestOff;
+  }
+
+  /** Parse [bs, be) into sequences + literals. */
+  private parse(bs: number, be: number): void {
+    var s = this.src;
+    this.nseq = 0; this.nlit = 0;
+    var anchor = bs, i = bs;
+    var reps = this.reps.slice();
+    var saved = this.reps;
+    this.reps = reps;                           // find() consults the live copy
+    var lastMatch = be - 4;
+    while (i < lastMatch) {
+      this.find(i, be, i - anchor);
+      var len = this._len, off = this._off;
+      // fast levels step faster through data that keeps missing
+      if (!len) { i += this.p.lazy ? 1 : 1 + ((i - anchor) >> 8); continue; }
+      // lazy evaluation: a longer match one or two bytes on wins
+      for (var step = 0; step < this.p.lazy && i + 1 < lastMatch; step++) {
+        this.find(i + 1, be, i + 1 - anchor);
+        if (this._len > len + 1) { i++; len = this._len; off = this._off; } else break;
+      }
+      // literals
+      var ll = i - anchor;
+      for (var j = 0; j < ll; j++) this.lits[this.nlit + j] = s[anchor + j];
+      this.nlit += ll;
+      // offset value: repeat code when possible
+      var ofv = off + 3;
+      if (ll > 0) {
+        if (off === reps[0]) ofv = 1; else if (off === reps[1]) ofv = 2; else if (off === reps[2]) ofv = 3;
+      }
+      applyRep(reps, ofv, ll);
+      var k = this.nseq++;
+      this.sLL[k] = ll; this.sML[k] = len; this.sOF[k] = ofv;
+      i += len;
+      anchor = i;
+    }
+    this.insertTo(be);
+    this.lits.set(s.subarray(anchor, be), this.nlit);
+    this.nlit += be - anchor;
+    this.reps = saved;
+    this._pendingReps = reps;
+  }
+  private _pendingReps: number[] = [];
+
+  /**
+   * Compressed block body for [bs, be) into `out` at `o`; returns the end
+   * offset, or -1 when it would not be smaller than the raw block.
+   */
+  block(bs: number, be: number, out: Uint8Array, o: number): number {
+    this.parse(bs, be);
+    var start = o;
+    o = encodeLiterals(this.lits, this.nlit, out, o);
+    o = this.encodeSequences(out, o);
+    if (o - start >= be - bs) return -1;
+    this.reps = this._pendingReps;              // only a compressed block moves them
+    return o;
+  }
+
+  /** Index [.., be) without coding it (RLE and tiny raw blocks). */
+  skip(be: number): void { this.insertTo(be); }
+
+  private encodeSequences(out: Uint8Array, o: number): number {
+    var n = this.nseq;
+    if (n < 128) out[o++] = n;
+    else if (n < 0x7f00) { out[o++] = (n >> 8) + 128; out[o++] = n & 255; }
+    else { out[o++] = 255; out[o++] = (n - 0x7f00) & 255; out[o++] = (n - 0x7f00) >> 8; }
+    if (!n) return o;
+    out[o++] = 0;                               // predefined LL, OF, ML tables
+    var llT = _llC || (_llC = buildCTable(LL_DEFAULT, 6));
+    var mlT = _mlC || (_mlC = buildCTable(ML_DEFAULT, 6));
+    var ofT = _ofC || (_ofC = buildCTable(OF_DEFAULT, 5));
+    var bw = new BitOut(out, o);
+    var last = n - 1;
+    var llc = llCode(this.sLL[last]), mlc = mlCode(this.sML[last]), ofc = highbit(this.sOF[last]);
+    var sML = initState(mlT, mlc), sOF = initState(ofT, ofc), sLL = initState(llT, llc);
+    bw.add(this.sLL[last] - LL_BASE[llc], LL_BITS[llc]);
+    bw.add(this.sML[last] - ML_BASE[mlc], ML_BITS[mlc]);
+    bw.add(this.sOF[last] - (1 << ofc), ofc);
+    for (var i = last - 1; i >= 0; i--) {
+      llc = llCode(this.sLL[i]); mlc = mlCode(this.sML[i]); ofc = highbit(this.sOF[i]);
+      sOF = encodeSym(bw, ofT, sOF, ofc);
+      sML = encodeSym(bw, mlT, sML, mlc);
+      sLL = encodeSym(bw, llT, sLL, llc);
+      bw.add(this.sLL[i] - LL_BASE[llc], LL_BITS[llc]);
+      bw.add(this.sML[i] - ML_BASE[mlc], ML_BITS[mlc]);
+      bw.add(this.sOF[i] - (1 << ofc), ofc);
+    }
+    bw.add(sML, mlT.log);
+    bw.add(sOF, ofT.log);
+    bw.add(sLL, llT.log);
+    return bw.close();
+  }
+}
+
+function initState(t: FseCTable, s: number): number {
+  var nb = (t.dnb[s] + (1 << 15)) >> 16;
+  var v = (nb << 16) - t.dnb[s];
+  return t.state[(v >> nb) + t.dfind[s]];
+}
+
+function encodeSym(bw: BitOut, t: FseCTable, state: number, s: number): number {
+  var nb = (state + t.dnb[s]) >> 16;
+  bw.add(state, nb);
+  return t.state[(state >> nb) + t.dfind[s]];
+}
+
+// ── Literals encoding ────────────────────────────────────────────────────────
+
+function rawLiteralsHeader(out: Uint8Array, o: number, n: number, type: number): number {
+  if (n < 32) { out[o++] = (n << 3) | type; }
+  else if (n < 4096) { out[o++] = ((n & 15) << 4) | (1 << 2) | type; out[o++] = n >> 4; }
+  else { out[o++] = ((n & 15) << 4) | (3 << 2) | type; out[o++] = (n >> 4) & 255; out[o++] = n >> 12; }
+  return o;
+}
+
+/** Huffman code lengths (≤ HUF_MAX_BITS) for `freq[0 … nsym)`, complete. */
+function hufLengths(freq: Uint32Array, nsym: number): Uint8Array {
+  var len = new Uint8Array(nsym);
+  var syms: number[] = [];
+  for (var s = 0; s < nsym; s++) if (freq[s]) syms.push(s);
+  syms.sort(function(a, b) { return freq[a] - freq[b] || a - b; });
+  // two-queue Huffman: leaves sorted ascending, internal nodes appear in order
+  var m = syms.length;
+  var w = new Float64Array(2 * m), parent = new Int32Array(2 * m);
+  for (var i = 0; i < m; i++) w[i] = freq[syms[i]];
+  var leaf = 0, node = m, made = m;
+  for (var k = 0; k < m - 1; k++) {
+    var a = (leaf < m && (node >= made || w[leaf] <= w[node])) ? leaf++ : node++;
+    var b = (leaf < m && (node >= made || w[leaf] <= w[node])) ? leaf++ : node++;
+    w[made] = w[a] + w[b];
+    parent[a] = parent[b] = made++;
+  }
+  var depth = new Int32Array(2 * m);
+  for (i = made - 2; i >= 0; i--) depth[i] = depth[parent[i]] + 1;
+  // limit depth, then repair the Kraft sum so the code stays complete
+  var L = HUF_MAX_BITS, cap = 1 << L, kraft = 0;
+  for (i = 0; i < m; i++) {
+    var d = Math.min(depth[i], L);
+    len[syms[i]] = d;
+    kraft += cap >> d;
+  }
+  // over-full: lengthen the rarest symbols that are shorter than L
+  for (i = 0; kraft > cap; i = (i + 1) % m) {
+    var sy = syms[i];
+    if (len[sy] < L) { kraft -= cap >> (len[sy] + 1); len[sy]++; }
+  }
+  // under-full: shorten the most frequent symbols whose gain fits
+  while (kraft < cap) {
+    for (i = m - 1; i >= 0 && kraft < cap; i--) {
+      sy = syms[i];
+      var gain = cap >> len[sy];
+      if (len[sy] > 1 && kraft + gain <= cap) { kraft += gain; len[sy]--; }
+    }
+  }
+  return len;
+}
+
+/**
+ * Literals section for `lits[0 … n)`: Huffman coded (direct weights, one
+ * or four streams) when that beats raw, RLE for a single repeated byte.
+ */
+function encodeLiterals(lits: Uint8Array, n: number, out: Uint8Array, o: number): number {
+  var freq = new Uint32Array(256), maxSym = 0, distinct = 0;
+  for (var i = 0; i < n; i++) freq[lits[i]]++;
+  for (var s = 0; s < 256; s++) if (freq[s]) { distinct++; maxSym = s; }
+  if (distinct === 1 && n > 2) {
+    o = rawLiteralsHeader(out, o, n, 1);
+    out[o++] = lits[0];
+    return o;
+  }
+  var start = o;
+  if (n >= 64 && distinct > 1 && maxSym <= 128) {
+    var r = encodeHuffman(lits, n, freq, maxSym, out, o);
+    if (r > 0 && r - start < n + (n < 32 ? 1 : n < 4096 ? 2 : 3)) return r;
+  }
+  o = rawLiteralsHeader(out, start, n, 0);
+  out.set(lits.subarray(0, n), o);
+  return o + n;
+}
+
+function encodeHuffman(lits: Uint8Array, n: number, freq: Uint32Array, maxSym: number,
+                       out: Uint8Array, o: number): number {
+  var len = hufLengths(freq, maxSym + 1);
+  var maxBits = 0;
+  for (var s = 0; s <= maxSym; s++) if (len[s] > maxBits) maxBits = len[s];
+  // canonical codes in the decoder's table order: by weight, then symbol
+  var code = new Uint16Array(maxSym + 1);
+  var pos = 0;
+  for (var wt = 1; wt <= maxBits; wt++) {
+    for (s = 0; s <= maxSym; s++) {
+      if (!len[s] || maxBits + 1 - len[s] !== wt) continue;
+      code[s] = pos >> (wt - 1);
+      pos += 1 << (wt - 1);
+    }
+  }
+  var streams = n <= 1023 ? 1 : 4;
+  var hdrLen = streams === 1 ? 3 : n < 16384 ? 4 : 5;
+  var q = o + hdrLen;
+  var tree = q;
+  out[q++] = 127 + maxSym;                       // direct weights for symbols 0 … maxSym-1
+  for (s = 0; s < maxSym; s += 2) {
+    var w0 = len[s] ? maxBits + 1 - len[s] : 0;
+    var w1 = s + 1 < maxSym && len[s + 1] ? maxBits + 1 - len[s + 1] : 0;
+    out[q++] = (w0 << 4) | w1;
+  }
+  if (streams === 1) {
+    q = hufEncodeStream(lits, 0, n, code, len, out, q);
+  } else {
+    var seg = (n + 3) >> 2, jump = q;
+    q += 6;
+    for (var k = 0; k < 4; k++) {
+      var a = k * seg, b = Math.min(n, a + seg);
+      var sStart = q;
+      q = hufEncodeStream(lits, a, b, code, len, out, q);
+      if (k < 3) { out[jump + 2 * k] = (q - sStart) & 255; out[jump + 2 * k + 1] = (q - sStart) >> 8; }
+    }
+  }
+  var comp = q - tree;
+  if (streams === 1 && comp > 1023) return -1;
+  var sf = streams === 1 ? 0 : (n <= 1023 && comp <= 1023) ? 1 : (n < 16384 && comp < 16384) ? 2 : 3;
+  if (streams === 4 && (sf === 2 ? 4 : sf === 3 ? 5 : 3) !== hdrLen) {
+    // header size differs from the guess: slide the payload
+    var want = sf === 1 ? 3 : sf === 2 ? 4 : 5;
+    out.copyWithin(o + want, tree, q);
+    q += want - hdrLen;
+    hdrLen = want;
+  }
+  var b0 = ((n & 15) << 4) | (sf << 2) | 2;
+  out[o] = b0;
+  if (hdrLen === 3) {
+    out[o + 1] = (n >> 4) | ((comp & 3) << 6);
+    out[o + 2] = comp >> 2;
+  } else if (hdrLen === 4) {
+    out[o + 1] = (n >> 4) & 255;
+    out[o + 2] = (n >> 12) | ((comp & 63) << 2);
+    out[o + 3] = comp >> 6;
+  } else {
+    out[o + 1] = (n >> 4) & 255;
+    out[o + 2] = ((n >> 12) & 63) | ((comp & 3) << 6);
+    out[o + 3] = (comp >> 2) & 255;
+    out[o + 4] = comp >> 10;
+  }
+  return q;
+}
+
+/** One Huffman stream: symbols written last-to-first so they decode in order. */
+function hufEncodeStream(lits: Uint8Array, a: number, b: number, code: Uint16Array, len: Uint8Array,
+                         out: Uint8Array, o: number): number {
+  var bw = new BitOut(out, o);
+  for (var i = b - 1; i >= a; i--) bw.add(code[lits[i]], len[lits[i]]);
+  return bw.close();
+}
+
+/** Largest output zstdCompress() can produce for `n` input bytes. */
+export function zstdCompressBound(n: number): number {
+  return n + 3 * Math.max(1, Math.ceil(n / BLOCK_MAX)) + 18;
+}
+
+/**
+ * Compress `src` into one zstd frame at `level` (1 … 19, default 3).
+ * The frame records the content size and has no checksum.
+ */
+export function zstdCompress(src: Uint8Array, level: number = 3): Uint8Array {
+  var n = src.length;
+  var out = new Uint8Array(zstdCompressBound(n));
+  var o = 0;
+  out[o++] = 0x28; out[o++] = 0xb5; out[o++] = 0x2f; out[o++] = 0xfd;
+  var single = n <= (1 << WINDOW_LOG);
+  var fcsFlag = n < 256 && single ? 0 : n < 65536 + 256 ? 1 : 2;
+  out[o++] = (fcsFlag << 6) | (single ? 0x20 : 0);
+  if (!single) out[o++] = (WINDOW_LOG - 10) << 3;
+  if (fcsFlag === 0) out[o++] = n;
+  else if (fcsFlag === 1) { out[o++] = (n - 256) & 255; out[o++] = (n - 256) >> 8; }
+  else { out[o++] = n & 255; out[o++] = (n >>> 8) & 255; out[o++] = (n >>> 16) & 255; out[o++] = n >>> 24; }
+
+  var enc = new ZstdEncoder(src, level, single ? Math.max(n, 1) : 1 << WINDOW_LOG);
+  var bs = 0;
+  do {
+    var be = Math.min(n, bs + BLOCK_MAX);
+    var last = be === n ? 1 : 0;
+    var size = be - bs;
+    var rle = size > 16;
+    for (var i = bs + 1; rle && i < be; i++) if (src[i] !== src[bs]) rle = false;
+    if (rle) {
+      writeBlockHeader(out, o, last, 1, size);
+      out[o + 3] = src[bs];
+      o += 4;
+      enc.skip(be);
+    } else {
+      var end = size >= 32 ? enc.block(bs, be, out, o + 3) : (enc.skip(be), -1);
+      if (end > 0) {
+        writeBlockHeader(out, o, last, 2, end - o - 3);
+        o = end;
+      } else {
+        writeBlockHeader(out, o, last, 0, size);
+        out.set(src.subarray(bs, be), o + 3);
+        o += 3 + size;
+      }
+    }
+    bs = be;
+  } while (bs < n);
+  return out.subarray(0, o);
+}
+
+function writeBlockHeader(out: Uint8Array, o: number, last: number, type: number, size: number): void {
+  var h = last | (type << 1) | (size << 3);
+  out[o] = h & 255; out[o + 1] = (h >> 8) & 255; out[o + 2] = (h >> 16) & 255;
+}
@@ -20,53 +20,83 @@
 declare var kernel: import('../core/kernel.js').KernelAPI;
 import { SIG } from '../process/signals.js';
 import { scheduler } from '../process/scheduler.js';
+import { ByteRing, RING_DEFAULT_CAPACITY, utf8Encode } from '../core/ringbuf.js';
+import { Epoll, EPOLLIN, type Pollable } from '../core/epoll.js';
 
 export type SignalNumber = number;
 export type SignalHandler = (signum: SignalNumber) => void;
 
 // ── Pipe ─────────────────────────────────────────────────────────────────────
 
+/**
+ * String pipe over a bounded ByteRing (core/ringbuf.ts, default 64 KB).
+ * Text is stored UTF-8 encoded, so `available` and `maxBytes` count bytes.
+ */
 export class Pipe {
-  private chunks: string[] = [];
-  private _closed = false;
+  readonly ring: ByteRing;
   readonly readFd:  number;
   readonly writeFd: number;
 
-  constructor(readFd: number, writeFd: number) {
+  constructor(readFd: number, writeFd: number, capacity: number = RING_DEFAULT_CAPACITY) {
     this.readFd  = readFd;
     this.writeFd = writeFd;
+    this.ring    = new ByteRing(capacity);
   }
 
-  /** Write data into the pipe. Returns false if pipe is closed. */
+  /**
+   * Write data into the pipe.  When the ring is full this yields
+   * (kernel.sleep) until the reader drains it; returns false if the pipe is
+   * closed or the reader makes no progress for 1 s (the unwritten tail is
+   * dropped).  Use tryWrite() for non-blocking writes.
+   */
   write(data: string): boolean {
-    if (this._closed) return false;
-    this.chunks.push(data);
+    if (this.ring.writerClosed) return false;
+    var bytes = utf8Encode(data);
+    var done = 0;
+    var deadline = kernel.getTicks() + 1000;
+    while (done < bytes.length) {
+      var n = this.ring.write(bytes, done, bytes.length - done);
+      if (n < 0) return false;
+      done += n;
+      if (done === bytes.length) break;
+      if (n > 0) deadline = kernel.getTicks() + 1000;
+      else if (kernel.getTicks() >= deadline) return false;
+      kernel.sleep(1);
+    }
     return true;
   }
 
-  /** Read all (or up to maxBytes) data from the pipe. */
-  read(maxBytes?: number): string {
-    if (this.chunks.length === 0) return '';
-    var all = this.chunks.join('');
-    if (maxBytes !== undefined && all.length > maxBytes) {
-      var chunk = all.slice(0, maxBytes);
-      this.chunks = [all.slice(maxBytes)];
-      return chunk;
-    }
-    this.chunks = [];
-    return all;
+  /**
+   * Non-blocking write of the whole string.
+   * Returns bytes written, -EAGAIN (-11) if it does not fit right now,
+   * -EPIPE (-32) once the pipe is closed.
+   */
+  tryWrite(data: string): number {
+    if (this.ring.writerClosed) return -32;
+    var n = this.ring.writeString(data);
+    return n < 0 ? -32 : (n === 0 && data.length > 0 ? -11 : n);
   }
 
+  /** Read all (or up to maxBytes) data from the pipe. */
+  read(maxBytes?: number): string { return this.ring.readString(maxBytes); }
+
   /** Peek at buffered data without consuming it. */
-  peek(): string { return this.chunks.join(''); }
+  peek(): string { return this.ring.peekString(); }
 
   /** Number of bytes buffered. */
-  get available(): number {
-    return this.chunks.reduce(function(s, c) { return s + c.length; }, 0);
-  }
+  get available(): number { return this.ring.available; }
 
-  close(): void { this._closed = true; }
-  get isClosed(): boolean { return this._closed; }
+  /** Bytes that can be written without blocking. */
+  get space(): number { return this.ring.space; }
+
+  /** Readiness edges (RING_READABLE / RING_WRITABLE / RING_HUP); returns unsubscribe. */
+  watch(cb: (events: number) => void): () => void { return this.ring.watch(cb); }
+
+  /** Current readiness (POLLIN / POLLOUT / POLLHUP bits). */
+  poll(): number { return this.ring.poll(); }
+
+  close(): void { this.ring.closeWrite(); }
+  get isClosed(): boolean { return this.ring.writerClosed; }
 }
 
 // ── Signal Dispatcher ────────────────────────────────────────────────────────
@@ -148,6 +178,8 @@ export class MessageQueue {
   private _rateLimitWindowMs: number = 1000;
   /** Per-sender rate tracking: senderPid → { count, windowStart }. */
   private _senderRate = new Map<number, { count: number; windowStart: number }>();
+  /** Readiness watchers per recipient PID (epoll); fired on empty → non-empty. */
+  private _watchers = new Map<number, Array<(events: number) => void>>();
 
   /** Configure IPC limits.  Any field may be omitted to keep the current value. */
   setLimits(opts: { maxQueueDepth?: number; maxPayloadBytes?: number;
@@ -210,9 +242,10 @@ export class MessageQueue {
     var m: Message = { type: msg.type, from: msg.from, to: msg.to, payload: msg.payload, timestamp: kernel.getUptime() };
     if (m.to === 0) {
       // Broadcast — apply queue depth limit per recipient
-      this.queues.forEach((q) => {
+      this.queues.forEach((q, pid) => {
         if (this._maxQueueDepth > 0 && q.length >= this._maxQueueDepth) return; // skip full queues
         q.push(m);
+        if (q.length === 1) this._notify(pid);
       });
     } else {
       if (!this.queues.has(m.to)) this.queues.set(m.to, []);
@@ -220,10 +253,40 @@ export class MessageQueue {
       // Queue depth limit
       if (this._maxQueueDepth > 0 && q.length >= this._maxQueueDepth) return false;
       q.push(m);
+      if (q.length === 1) this._notify(m.to);
     }
     return true;
   }
 
+  /** Readiness of `pid`'s queue: POLLIN while messages are pending. */
+  poll(pid: number): number {
+    var q = this.queues.get(pid);
+    return q && q.length > 0 ? POLLIN : 0;
+  }
+
+  /** Be told when `pid`'s queue goes from empty to non-empty.  Returns unsubscribe. */
+  watch(pid: number, cb: (events: number) => void): () => void {
+    var list = this._watchers.get(pid);
+    if (!list) { list = []; this._watchers.set(pid, list); }
+    list.push(cb);
+    var watchers = this._watchers;
+    return function() {
+      var l = watchers.get(pid);
+      if (!l) return;
+      var i = l.indexOf(cb);
+      if (i >= 0) l.splice(i, 1);
+      if (l.length === 0) watchers.delete(pid);
+    };
+  }
+
+  private _notify(pid: number): void {
+    var list = this._watchers.get(pid);
+    if (!list) return;
+    for (var i = 0; i < list.length; i++) {
+      try { list[i](POLLIN); } catch (_) {}
+    }
+  }
+
   /** Receive the next message for `pid`, optionally filtered by `type`. */
   recv(pid: number, type?: string): Message | null {
     var q = this.queues.get(pid) || [];
@@ -446,6 +509,7 @@ export class Channel<T> {
   readonly capacity: number;
   private _closed  = false;
   readonly name:   string;
+  private _watchers: Array<(events: number) => void> = [];
 
   constructor(name: string, capacity = 128) {
     this.name     = name;
@@ -458,7 +522,7 @@ export class Channel<T> {
    */
   trySend(item: T): boolean {
     if (this._closed || this.buf.length >= this.capacity) return false;
-    this.buf.push(item);
+    this._push(item);
     return true;
   }
 
@@ -473,7 +537,7 @@ export class Channel<T> {
       kernel.sleep(1);
     }
     if (this._closed) return false;
-    this.buf.push(item);
+    this._push(item);
     return true;
   }
 
@@ -482,7 +546,7 @@ export class Channel<T> {
    * Returns null when the channel is empty.
    */
   tryRecv(): T | null {
-    return this.buf.length > 0 ? this.buf.shift()! : null;
+    return this.buf.length > 0 ? this._shift() : null;
   }
 
   /**
@@ -495,7 +559,7 @@ export class Channel<T> {
       if (kernel.getTicks() >= deadline) return null;
       kernel.sleep(1);
     }
-    return this.buf.length > 0 ? this.buf.shift()! : null;
+    return this.buf.length > 0 ? this._shift() : null;
   }
 
   /** Peek at the next item without removing it. */
@@ -510,14 +574,57 @@ export class Channel<T> {
    * Close the channel.  New sends will be rejected; pending items can still
    * be drained with tryRecv().
    */
-  close(): void { this._closed = true; }
+  close(): void {
+    if (this._closed) return;
+    this._closed = true;
+    this._notify(POLLIN | POLLHUP);
+  }
 
   /** Drain all remaining items (useful after close). */
   drain(): T[] {
     var all = this.buf.slice();
+    var wasFull = this.buf.length >= this.capacity;
     this.buf = [];
+    if (wasFull && all.length) this._notify(POLLOUT);
     return all;
   }
+
+  /** Readiness (POLLIN / POLLOUT / POLLHUP bits) for select/poll/epoll. */
+  poll(): number {
+    var ev = 0;
+    if (this.buf.length > 0 || this._closed) ev |= POLLIN;
+    if (this.buf.length < this.capacity && !this._closed) ev |= POLLOUT;
+    if (this._closed) ev |= POLLHUP;
+    return ev;
+  }
+
+  /** Notified on empty → non-empty, full → not-full and close.  Returns unsubscribe. */
+  watch(cb: (events: number) => void): () => void {
+    var list = this._watchers;
+    list.push(cb);
+    return function() {
+      var i = list.indexOf(cb);
+      if (i >= 0) list.splice(i, 1);
+    };
+  }
+
+  private _push(item: T): void {
+    this.buf.push(item);
+    if (this.buf.length === 1) this._notify(POLLIN);
+  }
+
+  private _shift(): T {
+    var wasFull = this.buf.length >= this.capacity;
+    var item = this.buf.shift()!;
+    if (wasFull) this._notify(POLLOUT);
+    return item;
+  }
+
+  private _notify(events: number): void {
+    for (var i = 0; i < this._watchers.length; i++) {
+      try { this._watchers[i](events); } catch (_) {}
+    }
+  }
 }
 
 // ── Named Pipes / FIFOs by path (item 209) ───────────────────────────────────
@@ -565,33 +672,94 @@ export function listNamedPipes(): string[] {
   return result;
 }
 
-// ── Shared Memory (item 210) ──────────────────────────────────────────────────
+// ── Shared Memory (item 210) ─────────────────────────────────────────────────────
 
-interface SharedMemEntry { buf: number[]; size: number; }
+interface SharedMemEntry { id: number; buf: Uint8Array; size: number; }
 const sharedMem = new Map<string, SharedMemEntry>();
 
 /**
  * Create a named shared memory region.
- * Returns the backing byte array, or null if the name is already taken.
+ * Returns a zero-copy view of it, or null if the name is already taken.
  *
- * QuickJS on bare metal has no real shared memory; we simulate it with a
- * plain number[] that all "processes" (closures) can reference.
+ * The bytes are a kernel region (kernel.shmCreate): child runtimes reach
+ * the same memory with kernel.shmOpen(name) + kernel.sharedBufferOpen(id).
+ * When the kernel has no region support a private Uint8Array stands in,
+ * visible to this runtime only.
  */
-export function shmCreate(name: string, size: number): number[] | null {
+export function shmCreate(name: string, size: number): Uint8Array | null {
   if (sharedMem.has(name)) return null;
-  var buf = new Array<number>(size).fill(0);
-  sharedMem.set(name, { buf, size });
+  var id = -1;
+  var ab: ArrayBuffer | null = null;
+  if (kernel.shmCreate) {
+    id = kernel.shmCreate(name, size);
+    if (id < 0) return null;
+    ab = kernel.sharedBufferOpen(id);
+    if (!ab) { kernel.sharedBufferRelease(id); kernel.shmUnlink!(name); return null; }
+  }
+  var buf = ab ? new Uint8Array(ab, 0, size) : new Uint8Array(size);
+  sharedMem.set(name, { id, buf, size });
   return buf;
 }
 
-/** Open an existing shared memory region.  Returns null if not found. */
-export function shmOpen(name: string): number[] | null {
+/**
+ * Open an existing shared memory region.  Returns null if not found.
+ * Regions created by another runtime are found through the kernel.
+ */
+export function shmOpen(name: string): Uint8Array | null {
   var entry = sharedMem.get(name);
-  return entry ? entry.buf : null;
+  if (entry) return entry.buf;
+  if (!kernel.shmOpen) return null;
+  var id = kernel.shmOpen(name);
+  if (id < 0) return null;
+  var ab = kernel.sharedBufferOpen(id);
+  if (!ab) { kernel.sharedBufferRelease(id); return null; }
+  var buf = new Uint8Array(ab);
+  sharedMem.set(name, { id, buf, size: buf.length });
+  return buf;
 }
 
-/** Destroy a named shared memory region. */
-export function shmUnlink(name: string): boolean { return sharedMem.delete(name); }
+/**
+ * Destroy a named shared memory region.  The name disappears at once; the
+ * memory is returned when the last runtime drops its view.
+ */
+export function shmUnlink(name: string): boolean {
+  var entry = sharedMem.get(name);
+  if (!entry) return kernel.shmUnlink ? kernel.shmUnlink(name) : false;
+  sharedMem.delete(name);
+  if (entry.id >= 0) {
+    kernel.shmUnlink!(name);
+    kernel.sharedBufferRelease(entry.id);
+  }
+  return true;
+}
+
+/**
+ * Move an ArrayBuffer to another runtime without sharing it: `buf` is
+ * detached here and the returned id is claimed with bufferAccept(id) (in
+ * a child: kernel.bufferAccept(id)).  Buffers obtained from
+ * transferableBuffer() move with zero copies.  Returns -1 on failure.
+ */
+export function bufferTransfer(buf: ArrayBuffer): number {
+  return kernel.bufferTransfer ? kernel.bufferTransfer(buf) : -1;
+}
+
+/** Claim a buffer sent with bufferTransfer().  Null if `id` is not pending. */
+export function bufferAccept(id: number): ArrayBuffer | null {
+  return kernel.bufferAccept ? kernel.bufferAccept(id) : null;
+}
+
+/**
+ * Allocate an ArrayBuffer backed by a kernel region, so a later
+ * bufferTransfer() is zero-copy (decoded images, render targets, worker
+ * payloads).  Falls back to an ordinary ArrayBuffer.
+ */
+export function transferableBuffer(size: number): ArrayBuffer {
+  var id = kernel.sharedBufferCreate ? kernel.sharedBufferCreate(size) : -1;
+  if (id < 0) return new ArrayBuffer(size);
+  var ab = kernel.sharedBufferOpen(id);
+  kernel.sharedBufferRelease(id);       // the view alone keeps it alive
+  return ab || new ArrayBuffer(size);
+}
 
 // ── Timer helpers (items 211–212) ────────────────────────────────────────────
 
@@ -842,6 +1010,8 @@ export class UnixSocket {
   private _pendingFds: number[] = [];
   /** PID of the process owning this socket. */
   readonly pid: number;
+  /** Readiness watchers (epoll). */
+  private _watchers: Array<(events: number) => void> = [];
 
   constructor(path: string, pid: number) {
     this.path = path;
@@ -875,6 +1045,7 @@ export class UnixSocket {
         serverSide._peer = client;
         client._peer = serverSide;
         client.state = 'CONNECTED';
+        client._notify(POLLOUT);
         return serverSide;
       }
       kernel.sleep(1);
@@ -891,6 +1062,7 @@ export class UnixSocket {
     var q = unixAcceptQueues.get(path);
     if (!q) return false;
     q.push(this);
+    if (q.length === 1) server._notify(POLLIN);
     // Wait for accept() — cast to avoid TS narrowing false-positive after assignment above
     var deadline = kernel.getTicks() + timeoutTicks;
     const self = this as { state: string };
@@ -905,6 +1077,7 @@ export class UnixSocket {
     if (this.state !== 'CONNECTED' || !this._peer) return false;
     if (this._peer.state !== 'CONNECTED') return false;
     this._peer.rxBuf.push(data);
+    if (this._peer.rxBuf.length === 1) this._peer._notify(POLLIN);
     return true;
   }
 
@@ -937,13 +1110,52 @@ export class UnixSocket {
   }
 
   close(): void {
-    if (this._peer && this._peer.state === 'CONNECTED') this._peer.state = 'CLOSED';
+    if (this._peer && this._peer.state === 'CONNECTED') {
+      this._peer.state = 'CLOSED';
+      this._peer._notify(POLLIN | POLLHUP);
+    }
     this.state = 'CLOSED';
     unixSocketRegistry.delete(this.path);
     unixAcceptQueues.delete(this.path);
+    this._notify(POLLHUP);
   }
 
   get peer(): UnixSocket | null { return this._peer; }
+
+  /** Chunks waiting in the receive buffer. */
+  get pending(): number { return this.rxBuf.length; }
+
+  /**
+   * Readiness: POLLIN when data (or, for a listener, a connection) is
+   * waiting; POLLOUT while connected; POLLHUP once closed.
+   */
+  poll(): number {
+    if (this.state === 'LISTENING') {
+      var q = unixAcceptQueues.get(this.path);
+      return q && q.length > 0 ? POLLIN : 0;
+    }
+    var ev = 0;
+    if (this.rxBuf.length > 0) ev |= POLLIN;
+    if (this.state === 'CONNECTED' && this._peer && this._peer.state === 'CONNECTED') ev |= POLLOUT;
+    if (this.state === 'CLOSED') ev |= POLLIN | POLLHUP;
+    return ev;
+  }
+
+  /** Readiness edge notification for select/poll/epoll.  Returns unsubscribe. */
+  watch(cb: (events: number) => void): () => void {
+    var list = this._watchers;
+    list.push(cb);
+    return function() {
+      var i = list.indexOf(cb);
+      if (i >= 0) list.splice(i, 1);
+    };
+  }
+
+  private _notify(events: number): void {
+    for (var i = 0; i < this._watchers.length; i++) {
+      try { this._watchers[i](events); } catch (_) {}
+    }
+  }
 }
 
 /** Global registry: socket path → listening UnixSocket. */
@@ -974,15 +1186,40 @@ export function socketpair(pid1: number, pid2: number): [UnixSocket, UnixSocket]
  */
 export interface ReadableFd {
   hasData(): boolean;
+  /** Optional: writing now will not block (POLLOUT).  Absent = always writable. */
+  canWrite?(): boolean;
+  /** Optional: readiness edge notification (POLLIN/POLLOUT/POLLHUP bits). */
+  watch?(cb: (events: number) => void): () => void;
+  /** Optional: current readiness bits; preferred over hasData()/canWrite(). */
+  poll?(): number;
   /** Optional: descriptive label for error messages. */
   label?: string;
 }
 
+/**
+ * View a ReadableFd as an epoll source.  Endpoints with watch() push
+ * readiness; the rest are level-checked on each wakeup.
+ */
+export function fdPollable(fd: ReadableFd): Pollable {
+  return {
+    poll(): number {
+      if (fd.poll) return fd.poll();
+      var ev = 0;
+      try { if (fd.hasData()) ev |= POLLIN; } catch (_) { return POLLERR; }
+      try { if (!fd.canWrite || fd.canWrite()) ev |= POLLOUT; } catch (_) {}
+      return ev;
+    },
+    watch: fd.watch ? function(cb: (events: number) => void) { return fd.watch!(cb); } : undefined,
+  };
+}
+
 /**
  * [Item 217] select — wait until at least one fd in the set has data, or timeout.
  *
- * Works in JSOS's cooperative-multitasking model: spins with kernel.sleep(1)
- * between polls so other processes can run.
+ * Built on the epoll ready list (core/epoll.ts): the set is checked once on
+ * entry, after which the caller sleeps until a producer pushes readiness —
+ * wakeups cost O(ready fds), not O(fds).  Endpoints without watch() are
+ * rechecked every tick.
  *
  * @param fds        List of readableFd objects to monitor.
  * @param timeoutMs  Maximum time to wait in milliseconds (0 = non-blocking, -1 = infinite).
@@ -990,21 +1227,13 @@ export interface ReadableFd {
  */
 export function select(fds: ReadableFd[], timeoutMs = -1): ReadableFd[] {
   if (fds.length === 0) return [];
-
-  var deadline = timeoutMs >= 0
-    ? kernel.getTicks() + Math.ceil(timeoutMs / 10)
-    : Infinity;
-
-  while (true) {
-    var ready: ReadableFd[] = [];
-    for (var i = 0; i < fds.length; i++) {
-      try { if (fds[i].hasData()) ready.push(fds[i]); } catch (_) {}
-    }
-    if (ready.length > 0) return ready;
-    if (kernel.getTicks() >= deadline) return [];
-    if (timeoutMs === 0) return [];
-    kernel.sleep(1);
-  }
+  var ep = new Epoll();
+  for (var i = 0; i < fds.length; i++) ep.add(fds[i], fdPollable(fds[i]), EPOLLIN, fds[i]);
+  var evs = ep.wait(fds.length, timeoutMs);
+  ep.close();
+  var ready: ReadableFd[] = [];
+  for (var j = 0; j < evs.length; j++) ready.push(evs[j].data);
+  return ready;
 }
 
 // ── [Item 218] poll() — POSIX-style file descriptor polling ──────────────────
@@ -1028,7 +1257,8 @@ export interface PollFd {
  *
  * Monitors the given file descriptors for the events specified in `events`.
  * Fills in `revents` for each entry and returns the count of descriptors
- * with non-zero revents (or 0 on timeout, -1 on EINVAL).
+ * with non-zero revents (or 0 on timeout, -1 on EINVAL).  Like select(),
+ * it sleeps on the epoll wait queue instead of rescanning every tick.
  *
  * @param fds       Array of PollFd entries to monitor (mutated in-place).
  * @param timeoutMs Timeout ms; -1 = block indefinitely, 0 = non-blocking.
@@ -1037,34 +1267,27 @@ export interface PollFd {
 export function poll(fds: PollFd[], timeoutMs = -1): number {
   if (!fds || fds.length === 0) return -1;
 
-  // Clear revents
-  for (var i = 0; i < fds.length; i++) fds[i].revents = 0;
-
-  var deadline = timeoutMs >= 0
-    ? kernel.getTicks() + Math.ceil(timeoutMs / 10)
-    : Infinity;
-
-  while (true) {
-    var nReady = 0;
-    for (var j = 0; j < fds.length; j++) {
-      var pfd = fds[j];
-      pfd.revents = 0;
-      if (pfd.events & POLLIN) {
-        try {
-          if (pfd.fd.hasData()) { pfd.revents |= POLLIN; nReady++; }
-        } catch (_) {
-          pfd.revents |= POLLERR;
-          nReady++;
-        }
-      }
-      // POLLOUT: always writable for in-memory IPC (no flow control)
-      if (pfd.events & POLLOUT) { pfd.revents |= POLLOUT; nReady++; }
+  // One interest per fd, for the union of what its entries asked for, so a
+  // writable fd polled only for POLLIN does not end the wait.
+  var want = new Map<number, number>();
+  for (var i = 0; i < fds.length; i++) {
+    fds[i].revents = 0;
+    want.set(fds[i].fd, (want.get(fds[i].fd) || 0) | fds[i].events | POLLERR | POLLHUP);
+  }
+  var ep = new Epoll();
+  want.forEach(function(events, fd) { ep.add(fd, fdPollable(fd), events); });
+  var evs = ep.wait(fds.length, timeoutMs);
+  ep.close();
+
+  var nReady = 0;
+  for (var j = 0; j < evs.length; j++) {
+    for (var k = 0; k < fds.length; k++) {
+      if (fds[k].fd !== evs[j].data) continue;
+      fds[k].revents = evs[j].events & (fds[k].events | POLLERR | POLLHUP);
+      if (fds[k].revents) nReady++;
     }
-    if (nReady > 0) return nReady;
-    if (kernel.getTicks() >= deadline) return 0;
-    if (timeoutMs === 0) return 0;
-    kernel.sleep(1);
   }
+  return nReady;
 }
 
 // ── Adapt existing types to ReadableFd ───────────────────────────────────────
@@ -1075,6 +1298,9 @@ export function poll(fds: PollFd[], timeoutMs = -1): number {
 export function pipeAsFd(pipe: Pipe, label?: string): ReadableFd {
   return {
     hasData() { return pipe.available > 0; },
+    canWrite() { return pipe.space > 0 && !pipe.isClosed; },
+    poll() { return pipe.poll(); },
+    watch(cb: (events: number) => void) { return pipe.watch(cb); },
     label: label ?? 'pipe',
   };
 }
@@ -1084,7 +1310,9 @@ export function pipeAsFd(pipe: Pipe, label?: string): ReadableFd {
  */
 export function mqAsFd(mq: MessageQueue, pid: number, label?: string): ReadableFd {
   return {
-    hasData() { return mq.available(pid) > 0; },
+    hasData() { return mq.poll(pid) !== 0; },
+    poll() { return mq.poll(pid) | POLLOUT; },
+    watch(cb: (events: number) => void) { return mq.watch(pid, cb); },
     label: label ?? ('mq[' + pid + ']'),
   };
 }
@@ -1094,11 +1322,27 @@ export function mqAsFd(mq: MessageQueue, pid: number, label?: string): ReadableF
  */
 export function unixSocketAsFd(sock: UnixSocket, label?: string): ReadableFd {
   return {
-    hasData() { return sock.state === 'CONNECTED' && sock.read(1) !== null; },
+    hasData() { return sock.pending > 0; },
+    canWrite() { return (sock.poll() & POLLOUT) !== 0; },
+    poll() { return sock.poll(); },
+    watch(cb: (events: number) => void) { return sock.watch(cb); },
     label: label ?? ('unix:' + sock.path),
   };
 }
 
+/**
+ * Wrap a Channel<T> as a ReadableFd.
+ */
+export function channelAsFd<T>(ch: Channel<T>, label?: string): ReadableFd {
+  return {
+    hasData() { return !ch.isEmpty; },
+    canWrite() { return !ch.isFull && !ch.isClosed; },
+    poll() { return ch.poll(); },
+    watch(cb: (events: number) => void) { return ch.watch(cb); },
+    label: label ?? ('chan:' + ch.name),
+  };
+}
+
 // ── [Item 213] Signal-as-Promise ──────────────────────────────────────────────
 
 /**
@@ -1290,6 +1290,14 @@ export class HTTP2Connection {
     return null;
   }
 
+  /**
+   * The stream as received so far, finished or not — for callers that
+   * consume DATA while it arrives.  Call after receive().
+   */
+  peek(streamId: number): H2Stream | null {
+    return this.streams.get(streamId) || null;
+  }
+
   /** Process all complete H2 frames buffered in rxBuf. */
   private _drainFrames(): void {
     while (this.rxBuf.length >= 9) {
@@ -20,6 +20,8 @@
 
 import { JITChecksum } from '../process/jit-os.js';
 import { pumpCursor } from '../ui/wm.js';
+import { registerWaitPump } from '../core/epoll.js';
+import { POLLIN, POLLOUT, POLLHUP } from '../ipc/ipc.js';
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
 // ── Byte-level helpers ───────────────────────────────────────────────────────
@@ -1122,6 +1124,8 @@ export class NetworkStack {
   private _connIdx    = new Map<string, TCPConnection>(); // "remIP:remPort:locPort" → conn
   private _sockIdx    = new Map<string, Socket>();         // "tcp:remIP:remPort:locPort" → sock
   private _udpSockIdx = new Map<number, Socket>();         // localPort → UDP sock
+  /** Readiness watchers by socket id (epoll); empty = no bookkeeping. */
+  private _sockWatch  = new Map<number, Array<(events: number) => void>>();
   private rxQueue:  number[][] = [];
   /** Raw UDP inbox: port → queue of { from, fromPort, data } */
   private udpRxMap  = new Map<number, Array<{ from: IPv4Address; fromPort: number; data: number[] }>>();
@@ -1482,7 +1486,13 @@ export class NetworkStack {
     if (!seg) return;
     var conn = this._findConn(ip.src, seg.srcPort, seg.dstPort);
     if (conn) {
-      this._tcpStateMachine(conn, ip, seg);
+      if (this._sockWatch.size === 0) {
+        this._tcpStateMachine(conn, ip, seg);
+      } else {
+        var st0 = conn.state, rx0 = conn.recvBuf.length;
+        this._tcpStateMachine(conn, ip, seg);
+        if (conn.state !== st0 || conn.recvBuf.length !== rx0) this._connNotify(conn, st0);
+      }
     } else if (seg.flags & TCP_SYN) {
       var listener = this.listeners.get(seg.dstPort);
       if (listener) this._tcpAccept(listener, ip, seg);
@@ -1502,7 +1512,10 @@ export class NetworkStack {
 
     // Deliver to socket API (string-based).
     var sock = this._findUDPSock(udp.dstPort);
-    if (sock) sock.recvQueue.push(bytesToStr(udp.payload));
+    if (sock) {
+      sock.recvQueue.push(bytesToStr(udp.payload));
+      if (sock.recvQueue.length === 1) this._sockNotify(sock, POLLIN);
+    }
 
     // Deliver to raw UDP inbox (byte-based, for DHCP/DNS/NTP).
     var inbox = this.udpRxMap.get(udp.dstPort);
@@ -1995,6 +2008,18 @@ export class NetworkStack {
     return count;
   }
 
+  /**
+   * Block until the NIC has a frame or `deadline` (ticks) is near, at most
+   * 10 ms so blocking callers still pump the cursor.  With kernel.netWaitRx
+   * the CPU sleeps on the NIC's IRQ instead of a fixed 1 ms nap.
+   */
+  private _waitRx(deadline: number): void {
+    var left = deadline - kernel.getTicks();
+    var ms = left < 1 ? 1 : left > 10 ? 10 : left;
+    if (this.nicReady && kernel.netWaitRx) kernel.netWaitRx(ms);
+    else kernel.sleep(1);  // yield to QEMU so virtio TX/RX BHs can run
+  }
+
   /**
    * Activate the real NIC and update the MAC address from hardware.
    * Called once after kernel.netInit() returns true.
@@ -2041,7 +2066,7 @@ export class NetworkStack {
         this.pollNIC();
         var resolved = this.arpTable.get(targetIP);
         if (resolved) return resolved;
-        kernel.sleep(1);  // yield to QEMU so virtio TX/RX BHs can run
+        this._waitRx(deadline);
       }
       return null;
     }
@@ -2194,7 +2219,7 @@ export class NetworkStack {
           pumpCursor();  // keep cursor alive during TCP connect
           this.pollNIC();
           this.processRxQueue();
-          kernel.sleep(1);  // yield to QEMU for virtio BH processing
+          this._waitRx(deadline);
         }
       } else {
         // Loopback mode: process synchronously
@@ -2289,7 +2314,7 @@ export class NetworkStack {
         return data;
       }
       if (deadline > 0 && kernel.getTicks() >= deadline) break;
-      kernel.sleep(1);  // yield to QEMU for virtio BH processing
+      this._waitRx(deadline);
     } while (deadline > 0);
     return null;
   }
@@ -2391,7 +2416,7 @@ export class NetworkStack {
         this.udpRxMap.delete(localPort);
         return pkt;
       }
-      kernel.sleep(1);  // yield to QEMU for virtio BH processing
+      this._waitRx(deadline);
     }
     this.udpRxMap.delete(localPort);
     return null;
@@ -2427,6 +2452,101 @@ export class NetworkStack {
     this._unindexSock(sock);
     this.sockets.delete(sock.id);
     sock.state = 'closed';
+    this._sockNotify(sock, POLLIN | POLLHUP);
+    this._sockWatch.delete(sock.id);
+  }
+
+  // ── Readiness ─────────────────────────────────────────────────────────────
+
+  /**
+   * Non-blocking accept(): pop the oldest fully-established connection from
+   * a listening socket's queue and return a connected Socket for it, or
+   * null if none is ready.  Half-open (SYN_RECEIVED) entries stay queued.
+   */
+  accept(listener: Socket): Socket | null {
+    var q = listener.pendingConns;
+    for (var i = 0; i < q.length; i++) {
+      var conn = q[i];
+      if (conn.state === 'SYN_RECEIVED') continue;
+      q.splice(i, 1);
+      if (conn.state === 'CLOSED') { i--; continue; }   // reset before accept
+      var s = this.createSocket('tcp');
+      s.localIP    = conn.localIP;
+      s.localPort  = conn.localPort;
+      s.remoteIP   = conn.remoteIP;
+      s.remotePort = conn.remotePort;
+      s.state      = 'connected';
+      this._indexSock(s);
+      return s;
+    }
+    return null;
+  }
+
+  /**
+   * Current readiness of `sock` as POLLIN / POLLOUT / POLLHUP bits.  Does
+   * not touch the NIC — that is the wait pump's job.
+   */
+  pollSocket(sock: Socket): number {
+    if (!this.sockets.has(sock.id)) return POLLIN | POLLHUP;   // closed
+    if (sock.type === 'udp') {
+      var inbox = this.udpRxMap.get(sock.localPort);
+      return ((sock.recvQueue.length > 0 || (inbox && inbox.length > 0)) ? POLLIN : 0) | POLLOUT;
+    }
+    if (sock.state === 'listening') {
+      var q = sock.pendingConns;
+      for (var i = 0; i < q.length; i++) if (q[i].state !== 'SYN_RECEIVED') return POLLIN;
+      return 0;
+    }
+    var conn = this._connForSock(sock);
+    if (!conn) return sock.remoteIP ? POLLIN | POLLHUP : 0;
+    var ev = conn.recvBuf.length > 0 ? POLLIN : 0;
+    if (conn.state === 'ESTABLISHED' || conn.state === 'CLOSE_WAIT') ev |= POLLOUT;
+    if (conn.state !== 'ESTABLISHED' && conn.state !== 'SYN_SENT' && conn.state !== 'SYN_RECEIVED') {
+      ev |= POLLIN | POLLHUP;   // peer finished: reads return EOF
+    }
+    return ev;
+  }
+
+  /**
+   * Subscribe to readiness changes on `sock` (data arrival, connection
+   * established / accepted, FIN, close).  While anything is watched the NIC
+   * is pumped once per tick by sleeping epoll waiters.
+   */
+  watchSocket(sock: Socket, cb: (events: number) => void): () => void {
+    var list = this._sockWatch.get(sock.id);
+    if (!list) { list = []; this._sockWatch.set(sock.id, list); }
+    list.push(cb);
+    var self = this;
+    registerWaitPump('net', function() {
+      if (self._sockWatch.size === 0) return;
+      if (self.nicReady) self.pollNIC();
+      self.processRxQueue();
+    });
+    return function() {
+      var l = self._sockWatch.get(sock.id);
+      if (!l) return;
+      var i = l.indexOf(cb);
+      if (i >= 0) l.splice(i, 1);
+      if (l.length === 0) self._sockWatch.delete(sock.id);
+    };
+  }
+
+  private _sockNotify(sock: Socket | null | undefined, events: number): void {
+    if (!sock) return;
+    var list = this._sockWatch.get(sock.id);
+    if (!list) return;
+    for (var i = 0; i < list.length; i++) {
+      try { list[i](events); } catch (_) {}
+    }
+  }
+
+  /** A connection changed state or received data: tell its socket (or listener). */
+  private _connNotify(conn: TCPConnection, prevState: TCPState): void {
+    var sock = this._findSockForConn(conn);
+    if (sock) { this._sockNotify(sock, this.pollSocket(sock)); return; }
+    if (prevState === 'SYN_RECEIVED' && conn.state === 'ESTABLISHED') {
+      this._sockNotify(this.listeners.get(conn.localPort), POLLIN);
+    }
   }
 
   // ── ICMP ping ─────────────────────────────────────────────────────────────
@@ -13,6 +13,8 @@
  * already in the codebase.  This file implements the state machines.
  */
 
+import { Epoll, EPOLLIN, EPOLLHUP, EPOLLERR } from '../core/epoll.js';
+
 // ── SSH-2 constants ───────────────────────────────────────────────────────────
 
 const SSH_MSG_DISCONNECT                = 1;
@@ -530,6 +532,110 @@ export interface SSHServerTransport {
   close(): void;
 }
 
+/** The parts of net.ts's NetworkStack the TCP transport needs. */
+export interface SSHNetStack {
+  createSocket(type: 'tcp'): any;
+  bind(sock: any, port: number): boolean;
+  listen(sock: any, backlog?: number): boolean;
+  accept(sock: any): any | null;
+  sendBytes(sock: any, bytes: number[]): boolean;
+  recvBytesNB(sock: any): number[] | null;
+  close(sock: any): void;
+  pollSocket(sock: any): number;
+  watchSocket(sock: any, cb: (events: number) => void): () => void;
+}
+
+/**
+ * SSHServerTransport over the TCP stack.  The listener and every session
+ * socket share one epoll instance (core/epoll.ts); sockets push themselves
+ * onto its ready list when data, a connection or a FIN arrives, so each
+ * pump() costs O(active connections) however many sessions are open.
+ */
+export class TCPTransport implements SSHServerTransport {
+  private _net: SSHNetStack;
+  private _ep = new Epoll();
+  private _listener: any = null;
+  private _onConnect: ((send: (d: Uint8Array) => void, recv: (handler: (d: Uint8Array) => void) => void) => void) | null = null;
+  private _handlers = new Map<any, (d: Uint8Array) => void>();
+
+  constructor(netStack: SSHNetStack) { this._net = netStack; }
+
+  listen(port: number, onConnect: (send: (d: Uint8Array) => void, recv: (handler: (d: Uint8Array) => void) => void) => void): void {
+    var n = this._net;
+    var sock = n.createSocket('tcp');
+    if (!n.bind(sock, port) || !n.listen(sock)) throw new Error('sshd: cannot listen on port ' + port);
+    this._listener = sock;
+    this._onConnect = onConnect;
+    this._ep.add(sock, this._source(sock), EPOLLIN);
+  }
+
+  /**
+   * Service ready sockets: accept pending connections and feed received
+   * bytes to their sessions.  Waits up to `timeoutMs` for the first event.
+   * Returns the number of events handled.
+   */
+  pump(timeoutMs: number = 0, maxEvents: number = 64): number {
+    var evs = this._ep.wait(maxEvents, timeoutMs);
+    for (var i = 0; i < evs.length; i++) {
+      var sock = evs[i].data;
+      if (sock === this._listener) { this._acceptAll(); continue; }
+      var data = this._net.recvBytesNB(sock);
+      if (data && data.length) {
+        var h = this._handlers.get(sock);
+        if (h) h(new Uint8Array(data));
+      }
+      if (evs[i].events & (EPOLLHUP | EPOLLERR)) this._drop(sock);
+    }
+    return evs.length;
+  }
+
+  /** Run pump() until close() — for a dedicated sshd thread. */
+  serve(): void {
+    while (this._listener) this.pump(1000);
+  }
+
+  close(): void {
+    var self = this;
+    this._handlers.forEach(function(_h, sock) { self._net.close(sock); });
+    this._handlers.clear();
+    if (this._listener) { this._net.close(this._listener); this._listener = null; }
+    this._ep.close();
+  }
+
+  get connections(): number { return this._handlers.size; }
+
+  private _acceptAll(): void {
+    var c: any;
+    while ((c = this._net.accept(this._listener)) !== null) this._register(c);
+  }
+
+  private _register(sock: any): void {
+    var n = this._net, handlers = this._handlers;
+    handlers.set(sock, function() {});
+    this._ep.add(sock, this._source(sock), EPOLLIN);
+    if (this._onConnect) {
+      this._onConnect(
+        function(d: Uint8Array) { n.sendBytes(sock, Array.prototype.slice.call(d)); },
+        function(handler: (d: Uint8Array) => void) { if (handlers.has(sock)) handlers.set(sock, handler); },
+      );
+    }
+  }
+
+  private _drop(sock: any): void {
+    this._ep.del(sock);
+    this._handlers.delete(sock);
+    this._net.close(sock);
+  }
+
+  private _source(sock: any) {
+    var n = this._net;
+    return {
+      poll: function() { return n.pollSocket(sock); },
+      watch: function(cb: (events: number) => void) { return n.watchSocket(sock, cb); },
+    };
+  }
+}
+
 export class SSHServer {
   private _cfg: SSHServerConfig;
   private _transport: SSHServerTransport | null = null;
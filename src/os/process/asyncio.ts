@@ -7,15 +7,18 @@
  * [Item 218] `poll`/`select` POSIX compat shims for any C-adjacent code that
  *            needs to bridge into the TypeScript async runtime.
  *
- * [Item 219] Async I/O: io_uring concepts expressed as typed Promise APIs.
- *            A SQE (submission queue entry) carries the operation; the CQE
- *            (completion queue entry) resolves a Promise.
+ * [Item 219] Async I/O: io_uring.  A SQE (submission queue entry) carries
+ *            the operation; the CQE (completion queue entry) resolves a
+ *            Promise.  Device I/O goes through a real SQ/CQ ring pair in
+ *            shared memory drained by the kernel dispatcher.
  *
  * All I/O in JSOS is structurally asynchronous — the JavaScript event loop
  * provides the scheduler.  This module builds familiar Unix I/O multiplexing
  * APIs on top of native JS Promises.
  */
 
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
 // ─────────────────────────────────────────────────────────────────────────────
 // [Item 217]  select([...waitables]) — Promise.race wrapper
 // ─────────────────────────────────────────────────────────────────────────────
@@ -172,6 +175,8 @@ export function unregisterPollFd(fd: number): void {
 
 /**
  * io_uring operation codes (subset matching Linux kernel io_uring_op).
+ * READ_FIXED, WRITE_FIXED, FSYNC, RECV, SEND and NOP are understood by the
+ * kernel dispatcher (src/kernel/uring.h uses the same numbers).
  */
 export const enum IoUringOp {
   NOP        = 0,
@@ -190,16 +195,35 @@ export const enum IoUringOp {
   CLOSE      = 13,
 }
 
+/** SQE flag: `fd` names a kernel device (IoUringDev), not a JS handler target. */
+export const IOSQE_FIXED_FILE = 0x01;
+/** SQE flag: the next SQE runs only if this one succeeds; otherwise it completes with -ECANCELED. */
+export const IOSQE_IO_LINK    = 0x04;
+
+/** Fixed file table of the kernel dispatcher (fd with IOSQE_FIXED_FILE). */
+export const enum IoUringDev {
+  ATA        = 0,
+  VIRTIO_BLK = 1,
+  NET        = 2,
+}
+
 /** io_uring Submission Queue Entry (SQE). */
 export interface IoUringSQE {
   op:       IoUringOp;
   /** User-supplied cookie echoed in the CQE for matching. */
   userData: number | string;
   fd:       number;
+  /** Data buffer.  For kernel SQEs, a view into a registerBuffers() buffer. */
   buf?:     Uint8Array;
+  /** Byte offset, or starting sector for block devices. */
   offset?:  number;
   length?:  number;
+  /** IOSQE_* bits. */
   flags?:   number;
+  /** Fixed buffer index (kernel SQEs); derived from `buf` when omitted. */
+  bufIndex?: number;
+  /** Byte offset inside the fixed buffer (with bufIndex). */
+  addr?:    number;
 }
 
 /** io_uring Completion Queue Entry (CQE). */
@@ -216,63 +240,162 @@ export interface IoUringCQE {
  */
 export type IoUringHandler = (sqe: IoUringSQE) => Promise<number>;
 
+/** Dispatcher statistics (kernel.uringInfo) plus JS-side counters. */
+export interface IoUringStats {
+  enters:      number;   // JS→kernel transitions
+  sqes:        number;   // SQEs completed by the kernel
+  driverCalls: number;   // device hand-offs (a merged / batched run counts once)
+  sqDropped:   number;
+  cqOverflow:  number;
+  jsOps:       number;   // SQEs completed by registered JS handlers
+}
+
+const ECANCELED = 125;
+const EFAULT    = 14;
+const EIO       = 5;
+const ENOSYS    = 38;
+
+// Header word indices (uring_hdr_t: SQ half in words 0-15, CQ half in 16-31).
+const H_SQ_HEAD = 0, H_SQ_TAIL = 1;
+const H_CQ_HEAD = 16, H_CQ_TAIL = 17, H_CQ_MASK = 18;
+const SQE_WORDS = 8, CQE_WORDS = 4;
+const MAX_FIXED_BUFS = 16;
+
+interface PendingCqe { userData: number | string; resolve: (cqe: IoUringCQE) => void; }
+
 /**
- * [Item 219] io_uring ring buffer — typed Promise-based async I/O.
+ * [Item 219] io_uring.
+ *
+ * SQEs flagged IOSQE_FIXED_FILE target a kernel device and travel through
+ * a genuine SQ/CQ ring pair in a shared region: submit() writes the SQE
+ * straight into the mapped SQ, and every SQE submitted in the same tick is
+ * published with a single kernel.uringEnter() — one transition per batch,
+ * not per operation.  The dispatcher merges and batches them into the
+ * virtio-blk / ATA / net drivers and posts CQEs, which are reaped from the
+ * mapped CQ without another call (completion is polled: the drivers spin,
+ * so the CQEs are there when uringEnter returns).
+ *
+ * Device SQEs address data through fixed buffers (registerBuffers) whose
+ * physical pages the kernel resolves once at registration.
  *
- * In the Linux kernel, io_uring uses shared memory ring buffers to avoid
- * syscall overhead.  In JSOS the same concept is expressed as a Promise
- * queue: `submit(sqe)` enqueues an I/O operation and returns a Promise that
- * resolves with the CQE when the operation completes.
+ * Any other SQE goes to the handler registered for its op, as before.
  *
  *   const ring = new IoUring();
- *   ring.registerHandler(IoUringOp.RECV, myRecvHandler);
- *   const cqe = await ring.submit({ op: IoUringOp.RECV, userData: 42, fd: 3 });
- *   console.log('received bytes:', cqe.result);
+ *   const [buf] = ring.registerBuffers([64 * 1024]);
+ *   const cqes = await ring.submitBatch([
+ *     { op: IoUringOp.READ_FIXED, userData: 1, fd: IoUringDev.VIRTIO_BLK,
+ *       flags: IOSQE_FIXED_FILE, buf: buf.subarray(0, 4096), offset: 0 },
+ *     { op: IoUringOp.READ_FIXED, userData: 2, fd: IoUringDev.VIRTIO_BLK,
+ *       flags: IOSQE_FIXED_FILE, buf: buf.subarray(4096, 8192), offset: 8 },
+ *   ]);                                          // one uringEnter, one driver kick
  *
- * Batching:
- *   const promises = ops.map(op => ring.submit(op));
- *   const cqes     = await Promise.all(promises);  // all ops in flight simultaneously
+ * IOSQE_IO_LINK chains SQEs: a later entry only runs once its predecessor
+ * succeeded, in the kernel and in submitBatch() for handler SQEs alike.
  */
 export class IoUring {
   private _handlers: Map<IoUringOp, IoUringHandler> = new Map();
   private _pending:  number = 0;
+  private _jsOps:    number = 0;
+
+  // Kernel ring (set up lazily on the first device SQE)
+  private _entries:  number;
+  private _ring:     number = -1;
+  private _noKernel: boolean = false;
+  private _hdr:      Uint32Array | null = null;
+  private _sq:       Uint32Array | null = null;
+  private _cq:       Int32Array  | null = null;
+  private _sqTail:   number = 0;           // local tail; published by flush()
+  private _cookie:   number = 0;
+  private _inflight: Map<number, PendingCqe> = new Map();
+  private _flushQueued: boolean = false;
+  private _bufs:     Uint8Array[] = [];
+
+  /** `entries`: SQ depth of the kernel ring (power of two, 8-4096). */
+  constructor(entries: number = 64) {
+    this._entries = entries;
+  }
 
   /** Register an operation handler. */
   registerHandler(op: IoUringOp, handler: IoUringHandler): void {
     this._handlers.set(op, handler);
   }
 
+  /**
+   * Allocate and register fixed buffers (at most 16).  Returns views the
+   * caller fills / reads; pass subarrays of them as `buf` in device SQEs.
+   * Without kernel rings they are ordinary buffers for handler SQEs.
+   */
+  registerBuffers(sizes: number[]): Uint8Array[] {
+    var out: Uint8Array[] = [];
+    var ring = this._attach();
+    for (var i = 0; i < sizes.length && this._bufs.length < MAX_FIXED_BUFS; i++) {
+      var idx = this._bufs.length;
+      var view: Uint8Array | null = null;
+      if (ring >= 0) {
+        var id = kernel.sharedBufferCreate(sizes[i]);
+        var ab = id >= 0 ? kernel.sharedBufferOpen(id) : null;
+        if (ab && kernel.uringRegisterBuffer!(ring, idx, id)) view = new Uint8Array(ab);
+        // The ring took its own hold and the mapping keeps the bytes alive.
+        if (id >= 0) kernel.sharedBufferRelease(id);
+      }
+      if (!view) view = new Uint8Array(sizes[i]);
+      this._bufs.push(view);
+      out.push(view);
+    }
+    return out;
+  }
+
   /**
    * Submit an I/O operation to the ring.
    * Returns a Promise that resolves with the CQE when the operation completes.
+   * Device SQEs submitted in the same tick share one kernel transition.
    */
-  async submit(sqe: IoUringSQE): Promise<IoUringCQE> {
-    this._pending++;
-    try {
-      var handler = this._handlers.get(sqe.op);
-      var result: number;
-      if (handler) {
-        result = await handler(sqe);
-      } else if (sqe.op === IoUringOp.NOP) {
-        result = 0;
-      } else {
-        result = -38; // ENOSYS
-      }
-      return { userData: sqe.userData, result };
-    } catch (e) {
-      return { userData: sqe.userData, result: -5 }; // EIO
-    } finally {
-      this._pending--;
+  submit(sqe: IoUringSQE): Promise<IoUringCQE> {
+    if (this._kernelBound(sqe)) {
+      var p = this._queue(sqe, false);
+      this._scheduleFlush();
+      return p;
     }
+    return this._runHandler(sqe);
   }
 
   /**
-   * Submit multiple SQEs simultaneously (batched submission).
-   * All entries are submitted before waiting for any completion.
-   * Returns an array of CQEs in the same order as the input SQEs.
+   * Submit multiple SQEs (batched submission).  Consecutive device SQEs are
+   * published together and entered once; handler SQEs run concurrently
+   * unless linked.  Returns CQEs in the same order as the input SQEs.
    */
   async submitBatch(sqes: IoUringSQE[]): Promise<IoUringCQE[]> {
-    return Promise.all(sqes.map((sqe) => this.submit(sqe)));
+    var out: Promise<IoUringCQE>[] = [];
+    var i = 0;
+    while (i < sqes.length) {
+      var linked: Promise<IoUringCQE>;
+      if (this._kernelBound(sqes[i])) {
+        var j = i;
+        while (j < sqes.length && this._kernelBound(sqes[j])) j++;
+        // A link from the last device SQE into a handler SQE is resolved here,
+        // not in the kernel (whose next SQE would be unrelated).
+        for (var k = i; k < j; k++) out.push(this._queue(sqes[k], k === j - 1 && j < sqes.length));
+        this.flush();
+        linked = out[j - 1];
+        i = j;
+      } else {
+        linked = this._runHandler(sqes[i]);
+        out.push(linked);
+        i++;
+      }
+      var prev = sqes[i - 1];
+      if (i < sqes.length && ((prev.flags ?? 0) & IOSQE_IO_LINK)) {
+        if ((await linked).result < 0) {
+          // Cancel through the end of the chain.
+          while (i < sqes.length) {
+            var c = sqes[i++];
+            out.push(Promise.resolve({ userData: c.userData, result: -ECANCELED }));
+            if (!((c.flags ?? 0) & IOSQE_IO_LINK)) break;
+          }
+        }
+      }
+    }
+    return Promise.all(out);
   }
 
   /**
@@ -288,7 +411,178 @@ export class IoUring {
     });
   }
 
+  /**
+   * Publish every queued device SQE with one kernel.uringEnter() and reap
+   * the completions.  Called automatically at the end of the submitting
+   * tick; call it directly to submit now.  Returns SQEs consumed.
+   */
+  flush(): number {
+    this._flushQueued = false;
+    var hdr = this._hdr;
+    if (!hdr) return 0;
+    var total = 0;
+    for (;;) {
+      var want = (this._sqTail - hdr[H_SQ_HEAD]) >>> 0;
+      if (want === 0) break;
+      hdr[H_SQ_TAIL] = this._sqTail;
+      var n = kernel.uringEnter!(this._ring, want);
+      this.reap();
+      if (n <= 0) break;                 // CQ full with nothing to reap, or bad ring
+      total += n;
+    }
+    return total;
+  }
+
+  /** Drain the completion queue, resolving the matching submissions. */
+  reap(): number {
+    var hdr = this._hdr, cq = this._cq;
+    if (!hdr || !cq) return 0;
+    var head = hdr[H_CQ_HEAD], tail = hdr[H_CQ_TAIL], mask = hdr[H_CQ_MASK];
+    var n = 0;
+    while (head !== tail) {
+      var w = (head & mask) * CQE_WORDS;
+      var cookie = cq[w] >>> 0, res = cq[w + 2];
+      head = (head + 1) >>> 0;
+      var p = this._inflight.get(cookie);
+      if (p) {
+        this._inflight.delete(cookie);
+        this._pending--;
+        p.resolve({ userData: p.userData, result: res });
+      }
+      n++;
+    }
+    hdr[H_CQ_HEAD] = head;
+    return n;
+  }
+
+  /** Dispatcher counters, or null before the kernel ring exists. */
+  stats(): IoUringStats | null {
+    if (this._ring < 0 || !kernel.uringInfo) return null;
+    var info = kernel.uringInfo(this._ring);
+    if (!info) return null;
+    return {
+      enters: info.enters, sqes: info.sqes, driverCalls: info.driverCalls,
+      sqDropped: info.sqDropped, cqOverflow: info.cqOverflow, jsOps: this._jsOps,
+    };
+  }
+
+  /** Flush outstanding SQEs and release the kernel ring and fixed buffers. */
+  close(): void {
+    this.flush();
+    if (this._ring >= 0) kernel.uringDestroy!(this._ring);
+    var self = this;
+    this._inflight.forEach(function(p) {
+      self._pending--;
+      p.resolve({ userData: p.userData, result: -ECANCELED });
+    });
+    this._inflight.clear();
+    this._ring = -1;
+    this._hdr = this._sq = null;
+    this._cq = null;
+    this._bufs = [];
+    this._noKernel = true;
+  }
+
   get pendingCount(): number { return this._pending; }
+
+  /** True once SQEs are being served by the kernel ring. */
+  get kernelBacked(): boolean { return this._ring >= 0; }
+
+  // ── Internals ──────────────────────────────────────────────────────────────
+
+  private _kernelBound(sqe: IoUringSQE): boolean {
+    return ((sqe.flags ?? 0) & IOSQE_FIXED_FILE) !== 0 && this._attach() >= 0;
+  }
+
+  /** Set up and map the kernel ring on first use.  Returns the ring id or -1. */
+  private _attach(): number {
+    if (this._ring >= 0 || this._noKernel) return this._ring;
+    this._noKernel = true;
+    if (typeof kernel === 'undefined' || !kernel.uringSetup) return -1;
+    var r = kernel.uringSetup(this._entries);
+    if (!r) return -1;
+    var ab = kernel.sharedBufferOpen(r.shm);
+    if (!ab) { kernel.uringDestroy!(r.ring); return -1; }
+    this._ring    = r.ring;
+    this._entries = r.entries;
+    this._hdr     = new Uint32Array(ab, 0, 32);
+    this._sq      = new Uint32Array(ab, r.sqeOff, r.entries * SQE_WORDS);
+    this._cq      = new Int32Array(ab, r.cqeOff, r.entries * 2 * CQE_WORDS);
+    this._sqTail  = this._hdr[H_SQ_TAIL];
+    this._noKernel = false;
+    return this._ring;
+  }
+
+  /** Resolve an SQE's fixed buffer to [bufIndex, addr, length], or null. */
+  private _fixed(sqe: IoUringSQE): number[] | null {
+    if (sqe.bufIndex !== undefined) {
+      return [sqe.bufIndex, sqe.addr ?? 0, sqe.length ?? 0];
+    }
+    if (!sqe.buf) return [0, 0, sqe.length ?? 0];
+    for (var i = 0; i < this._bufs.length; i++) {
+      var b = this._bufs[i];
+      if (b.buffer === sqe.buf.buffer) {
+        return [i, sqe.buf.byteOffset - b.byteOffset, sqe.length ?? sqe.buf.byteLength];
+      }
+    }
+    return null;
+  }
+
+  /** Write one SQE into the shared SQ.  Flushes first when the SQ is full. */
+  private _queue(sqe: IoUringSQE, stripLink: boolean): Promise<IoUringCQE> {
+    var fx = this._fixed(sqe);
+    if (!fx) return Promise.resolve({ userData: sqe.userData, result: -EFAULT });
+    if (((this._sqTail - this._hdr![H_SQ_HEAD]) >>> 0) >= this._entries) this.flush();
+
+    var flags = (sqe.flags ?? 0) & 0xFF;
+    if (stripLink) flags &= ~IOSQE_IO_LINK;
+    var off = sqe.offset ?? 0;
+    var cookie = this._cookie = (this._cookie + 1) >>> 0;
+    var sq = this._sq!, w = (this._sqTail & (this._entries - 1)) * SQE_WORDS;
+    sq[w]     = (sqe.op & 0xFF) | (flags << 8) | ((fx[0] & 0xFFFF) << 16);
+    sq[w + 1] = sqe.fd;
+    sq[w + 2] = off >>> 0;
+    sq[w + 3] = Math.floor(off / 4294967296) >>> 0;
+    sq[w + 4] = fx[1];
+    sq[w + 5] = fx[2];
+    sq[w + 6] = cookie;
+    sq[w + 7] = 0;
+    this._sqTail = (this._sqTail + 1) >>> 0;
+    this._pending++;
+
+    var self = this;
+    return new Promise<IoUringCQE>(function(resolve) {
+      self._inflight.set(cookie, { userData: sqe.userData, resolve });
+    });
+  }
+
+  private _scheduleFlush(): void {
+    if (this._flushQueued) return;
+    this._flushQueued = true;
+    var self = this;
+    Promise.resolve().then(function() { self.flush(); });
+  }
+
+  private async _runHandler(sqe: IoUringSQE): Promise<IoUringCQE> {
+    this._pending++;
+    try {
+      var handler = this._handlers.get(sqe.op);
+      var result: number;
+      if (handler) {
+        result = await handler(sqe);
+      } else if (sqe.op === IoUringOp.NOP) {
+        result = 0;
+      } else {
+        result = -ENOSYS;
+      }
+      return { userData: sqe.userData, result };
+    } catch (e) {
+      return { userData: sqe.userData, result: -EIO };
+    } finally {
+      this._pending--;
+      this._jsOps++;
+    }
+  }
 }
 
 /** Default process-global io_uring ring. */
@@ -4,8 +4,9 @@
  * Each JSProcess runs in its own fully isolated QuickJS runtime:
  *   • Separate GC and heap (4 MB limit per process)
  *   • Separate global scope — no shared globals with parent
- *   • Message-passing IPC via C-managed ring buffers (8 slots, 2 KB each)
- *   • Up to 8 concurrent child processes
+ *   • Message-passing IPC via lock-free variable-length byte rings (one per
+ *     direction, 128 KB by default; strings or binary, never truncated)
+ *   • Up to 16 concurrent child processes
  *
  * ─── Child runtime kernel API ────────────────────────────────────────────────
  * The child's global `kernel` object exposes:
@@ -15,21 +16,34 @@
  *   kernel.getUptime()         uptime in milliseconds
  *   kernel.sleep(ms)           cooperative sleep
  *   kernel.getMemoryInfo()     { total, used, free } in bytes
- *   kernel.postMessage(s)      send a string to the parent (→ parent's outbox)
- *   kernel.pollMessage()       receive a string from the parent (← parent's inbox)
- *                              returns null when inbox is empty
+ *   kernel.postMessage(m)      send a string / ArrayBuffer / typed array to the
+ *                              parent (→ parent's outbox); false when full
+ *   kernel.postMessages([m…])  send several in order → number sent
+ *   kernel.pollMessage()       receive from the parent (← parent's inbox):
+ *                              string, ArrayBuffer, or null when empty
+ *   kernel.pollMessages(max?)  drain the inbox in one call → [m, …]
+ *   kernel.messagesPending()   messages waiting in the inbox
+ *   kernel.maxMessageBytes()   largest single message the rings accept
  *
  * ─── Parent kernel API ───────────────────────────────────────────────────────
  * Low-level kernel.proc* primitives (use JSProcess class instead):
  *
- *   kernel.procCreate()           allocate new runtime slot → id 0-7, or -1
+ *   kernel.procCreate(ringBytes?) allocate new runtime slot → id 0-15, or -1
  *   kernel.procEval(id, code)     run code in child runtime → result string
  *   kernel.procTick(id)           pump child async jobs → jobs-run count
- *   kernel.procSend(id, msg)      push string into child inbox → bool
- *   kernel.procRecv(id)           pop string from child outbox → string | null
+ *   kernel.procSend(id, msg)      push string/binary into child inbox → bool
+ *   kernel.procSendBatch(id, [m…]) push several → number queued
+ *   kernel.procRecv(id)           pop from child outbox → string | ArrayBuffer | null
+ *   kernel.procRecvBatch(id, max) drain child outbox in one pass → [m, …]
+ *   kernel.procDoorbell()         bitmask of children that posted since last call
+ *   kernel.procRingInfo(id)       ring size / occupancy
  *   kernel.procDestroy(id)        free the child runtime
  *   kernel.procAlive(id)          check if slot is live → bool
- *   kernel.procList()             → [{id, inboxCount, outboxCount}, ...]
+ *   kernel.procList()             → [{id, inboxCount, outboxCount, cpu}, ...]
+ *   kernel.procRunOn(id, cpu, code, maxMs)  queue eval on an AP → cpu | -1
+ *   kernel.procRunResult(id)      AP eval outcome → string | null (still running)
+ *   kernel.zygoteCreate(code)     freeze a pre-initialised runtime → zid | -1
+ *   kernel.zygoteSpawn(zid, ringBytes?) COW clone of a zygote → id | -1
  *
  * ─── Typical REPL usage ──────────────────────────────────────────────────────
  *
@@ -46,15 +60,28 @@
  *   p.eval('kernel.pollMessage()');   // → '{"hello":"world"}'
  *   p.terminate();
  *
+ * ─── Binary messages ──────────────────────────────────────────────────────────────
+ *
+ * send() passes ArrayBuffers and typed arrays through as raw bytes (one copy
+ * into the ring, one copy out); the receiver gets a fresh ArrayBuffer.  All
+ * other values are JSON-encoded.  For bulk data prefer binary messages over
+ * JSON strings — there is no encode/parse step on either side.
+ *
+ *   p.send(new Float32Array(samples));                  // parent → child
+ *   p.eval('new Float32Array(kernel.pollMessage()).length');
+ *
  * ─── Shared memory (zero-copy, no JSON) ─────────────────────────────────────────────
  *
  * JS object references CANNOT be shared between runtimes — each QuickJS
  * runtime has its own GC heap.  Passing an object pointer across runtimes
  * would corrupt both heaps.
  *
- * Binary memory CAN be shared.  A BSS slab (stable physical address, never
- * moved by any GC) is mapped as an ArrayBuffer into every runtime that calls
- * sharedBufferOpen(id).  Both sides see the same bytes instantly:
+ * Binary memory CAN be shared.  A page-aligned kernel region (stable address,
+ * never moved by any GC) is mapped as an ArrayBuffer into every runtime that
+ * calls sharedBufferOpen(id).  Both sides see the same bytes instantly.
+ * Regions are refcounted; a child's references are dropped when it is
+ * destroyed.  kernel.bufferTransfer(ab) / kernel.bufferAccept(id) instead
+ * move a buffer to exactly one other runtime, detaching it at the source:
  *
  *   // Parent
  *   var id = kernel.sharedBufferCreate(1024);
@@ -86,6 +113,27 @@
  *   `);
  *   // WM loop: each frame calls p.evalSlice('step()', 5)
  *   // Mouse stays smooth — each step takes at most 5 ms
+ *
+ * ─── Running on another CPU (SMP) ───────────────────────────────────────────────
+ *
+ * When application processors are online (kernel.smpCpuCount() > 1) a child
+ * can run truly in parallel with the WM.  p.runOn(code) queues the eval on
+ * an AP and returns immediately; the AP also drains the child's Promise jobs.
+ * Poll p.runResult() (tick() does it for you) — until it reports completion
+ * the child belongs to that CPU and eval()/evalSlice()/tick() are refused.
+ *
+ *   if (p.runOn('crunchAll()') < 0) p.evalSlice('crunchAll()', 5);  // no AP
+ *   // … later, each frame:
+ *   var r = p.runResult();   // null while the AP is still working
+ *
+ * ─── Warm start (zygotes) ───────────────────────────────────────────────────────
+ *
+ * JSProcess.spawnWarm(code) evaluates `code` once into a frozen "zygote"
+ * runtime and from then on creates each process by sharing that heap
+ * copy-on-write — nothing is re-evaluated, so launch cost is a page-table
+ * clone.  `code` must be pure set-up (define functions, build tables): any
+ * message it posts or buffer it opens happens once, in the zygote.  Falls
+ * back to spawn() when the kernel cannot build zygotes (paging off).
  */
 
 declare var kernel: any;   // extended with proc* by C runtime
@@ -98,6 +146,12 @@ export class JSProcess {
   /** Count of consecutive procTick faults — too many → auto-kill this child. */
   private _tickFaultCount = 0;
   private static readonly _TICK_FAULT_LIMIT = 3;
+  /** CPU index while an eval queued with runOn() is outstanding, else 0. */
+  private _runCpu = 0;
+  /** Completed runOn() outcome not yet handed out by runResult(). */
+  private _runDone: { status: 'done' | 'timeout' | 'error'; result: string } | null = null;
+  /** terminate() was called while the child was owned by an AP. */
+  private _terminatePending = false;
 
   private constructor(id: number, name: string) {
     this.id     = id;
@@ -111,11 +165,14 @@ export class JSProcess {
    * Spawn a new isolated JS runtime, immediately evaluate `code` inside it,
    * and return the process handle.
    *
-   * Throws if no runtime slots are free (max 8) or if the initial eval throws.
+   * `ringBytes` sizes each IPC ring (default 128 KB); the largest single
+   * message is half of it.
+   *
+   * Throws if no runtime slots are free (max 16) or if the initial eval throws.
    */
-  static spawn(code: string, name?: string): JSProcess {
-    var id: number = kernel.procCreate();
-    if (id < 0) throw new Error('JSProcess: no free runtime slots (max 8 concurrent)');
+  static spawn(code: string, name?: string, ringBytes?: number): JSProcess {
+    var id: number = ringBytes ? kernel.procCreate(ringBytes) : kernel.procCreate();
+    if (id < 0) throw new Error('JSProcess: no free runtime slots (max 16 concurrent)');
     var proc = new JSProcess(id, name || ('proc' + id));
     var result: string = kernel.procEval(id, code);
     // Surface errors from the initial eval
@@ -126,6 +183,32 @@ export class JSProcess {
     return proc;
   }
 
+  /** Zygote id per start-up source (-1 = could not be built; use spawn()). */
+  private static _zygotes = new Map<string, number>();
+
+  /**
+   * Like spawn(), but clones a cached pre-initialised runtime for
+   * `code` instead of evaluating it again.  See "Warm start" above.
+   */
+  static spawnWarm(code: string, name?: string, ringBytes?: number): JSProcess {
+    var zid = JSProcess._zygotes.get(code);
+    if (zid === undefined) {
+      zid = kernel.zygoteCreate ? kernel.zygoteCreate(code) as number : -1;
+      JSProcess._zygotes.set(code, zid);
+    }
+    if (zid >= 0) {
+      var id: number = ringBytes ? kernel.zygoteSpawn(zid, ringBytes) : kernel.zygoteSpawn(zid);
+      if (id >= 0) return new JSProcess(id, name || ('proc' + id));
+    }
+    return JSProcess.spawn(code, name, ringBytes);
+  }
+
+  /** Free every cached zygote (processes already spawned keep running). */
+  static dropZygotes(): void {
+    JSProcess._zygotes.forEach(function(zid) { if (zid >= 0) kernel.zygoteDestroy(zid); });
+    JSProcess._zygotes.clear();
+  }
+
   // ── Lifecycle ──────────────────────────────────────────────────────────────
 
   /** True while the child runtime is allocated and alive. */
@@ -139,6 +222,11 @@ export class JSProcess {
    */
   terminate(): void {
     if (!this._alive) return;
+    if (this._runCpu > 0 && !this._collectRun()) {
+      // The AP still owns the runtime; finish the job on the next tick().
+      this._terminatePending = true;
+      return;
+    }
     kernel.procDestroy(this.id);
     this._alive = false;
   }
@@ -163,6 +251,10 @@ export class JSProcess {
    */
   tick(): number {
     if (!this._alive) return 0;
+    if (this._runCpu > 0) {
+      if (!this._collectRun()) return 0;   // still running on its AP
+      if (this._terminatePending) { this.terminate(); return 0; }
+    }
     var jobs = kernel.procTick(this.id);
     if (jobs === -1) {
       // procTick returned -1 → CPU fault in child runtime.
@@ -178,12 +270,12 @@ export class JSProcess {
       return -1;
     }
     this._tickFaultCount = 0;  // reset on success
-    // Drain outbox and fire callbacks (only if anyone is listening)
+    // Drain outbox in one batch and fire callbacks (only if anyone is listening)
     if (this._onMessageCbs.length > 0) {
-      var msg: any;
-      while ((msg = this.recv()) !== null) {
+      var msgs = this.recvAll();
+      for (var m = 0; m < msgs.length; m++) {
         for (var i = 0; i < this._onMessageCbs.length; i++) {
-          try { this._onMessageCbs[i](msg); } catch (_) {}
+          try { this._onMessageCbs[i](msgs[m]); } catch (_) {}
         }
       }
     }
@@ -209,6 +301,49 @@ export class JSProcess {
     return { status: 'done', result: raw };
   }
 
+  // ── SMP (item 31) ──────────────────────────────────────────────────────────
+
+  /**
+   * Queue `code` on an application processor.  `cpu` ≤ 0 lets the kernel
+   * pick the least-loaded AP; `maxMs` > 0 arms the same interrupt deadline
+   * evalSlice() uses.  Returns the CPU index, or -1 when no AP is online,
+   * the AP's queue is full, or a previous runOn() is still outstanding.
+   */
+  runOn(code: string, cpu: number = 0, maxMs: number = 0): number {
+    if (!this._alive || this._runCpu > 0 || this._terminatePending) return -1;
+    if (typeof kernel.procRunOn !== 'function') return -1;
+    var where: number = kernel.procRunOn(this.id, cpu, code, maxMs);
+    if (where > 0) { this._runCpu = where; this._runDone = null; }
+    return where;
+  }
+
+  /** CPU currently running this child's runOn() work, or 0. */
+  get runningOn(): number { return this._runCpu; }
+
+  /**
+   * Outcome of the last runOn(): null while it is queued or running,
+   * otherwise { status, result } exactly like evalSlice().  Each outcome
+   * is returned once.
+   */
+  runResult(): { status: 'done' | 'timeout' | 'error'; result: string } | null {
+    if (this._runCpu > 0) this._collectRun();
+    var r = this._runDone;
+    this._runDone = null;
+    return r;
+  }
+
+  /** Pull a finished AP result out of the kernel.  True once the child is back on the BSP. */
+  private _collectRun(): boolean {
+    var raw: string | null = kernel.procRunResult(this.id);
+    if (raw === null) return false;
+    this._runCpu = 0;
+    if (raw === 'timeout')                this._runDone = { status: 'timeout', result: '' };
+    else if (raw.indexOf('done:')  === 0) this._runDone = { status: 'done',  result: raw.slice(5) };
+    else if (raw.indexOf('error:') === 0) this._runDone = { status: 'error', result: raw.slice(6) };
+    else                                  this._runDone = { status: 'done',  result: raw };
+    return true;
+  }
+
   /**
    * Register a callback fired each time a message arrives from the child.
    * Called automatically inside tick() after draining the outbox.
@@ -229,37 +364,73 @@ export class JSProcess {
   // ── Message passing ────────────────────────────────────────────────────────
 
   /**
-   * Send a JSON-serialisable value to the child.
-   * The child reads it with kernel.pollMessage() → JSON.parse(...).
-   * Returns false if the inbox is full (8 slot ring buffer).
+   * Send a value to the child.  ArrayBuffers and typed arrays go as raw
+   * bytes (child's kernel.pollMessage() returns an ArrayBuffer); anything
+   * else is JSON-encoded (child does JSON.parse(kernel.pollMessage())).
+   * Returns false if the inbox ring is full (retry after the child drains
+   * it) or the message is larger than maxMessageBytes.
    */
   send(msg: any): boolean {
     if (!this._alive) return false;
-    return kernel.procSend(this.id, JSON.stringify(msg));
+    return kernel.procSend(this.id, JSProcess._encode(msg));
+  }
+
+  /**
+   * Send several values in order with a single kernel call.
+   * Returns how many were queued; the rest did not fit and can be retried.
+   */
+  sendAll(msgs: any[]): number {
+    if (!this._alive) return 0;
+    var enc: any[] = new Array(msgs.length);
+    for (var i = 0; i < msgs.length; i++) enc[i] = JSProcess._encode(msgs[i]);
+    if (typeof kernel.procSendBatch === 'function') return kernel.procSendBatch(this.id, enc);
+    var n = 0;
+    while (n < enc.length && kernel.procSend(this.id, enc[n])) n++;
+    return n;
   }
 
   /**
-   * Receive the next message from the child (child wrote it with
-   * kernel.postMessage(JSON.stringify(data))).
-   * Returns null when the outbox is empty.
-   * Automatically JSON.parses the payload; returns the raw string on parse failure.
+   * Receive the next message from the child (kernel.postMessage(...)).
+   * Returns null when the outbox is empty.  Binary messages arrive as an
+   * ArrayBuffer; strings are JSON.parsed, falling back to the raw string.
    */
   recv(): any {
     if (!this._alive) return null;
-    var s: string | null = kernel.procRecv(this.id);
-    if (s === null) return null;
-    try { return JSON.parse(s); } catch (_) { return s; }
+    return JSProcess._decode(kernel.procRecv(this.id));
   }
 
   /**
-   * Drain all pending messages from the child into an array (oldest first).
-   * Returns [] when the outbox is empty.
+   * Drain all pending messages from the child into an array (oldest first),
+   * in one batched kernel call.  Returns [] when the outbox is empty.
    */
   recvAll(): any[] {
-    var msgs: any[] = [];
-    var m: any;
-    while ((m = this.recv()) !== null) msgs.push(m);
-    return msgs;
+    if (!this._alive) return [];
+    if (typeof kernel.procRecvBatch !== 'function') {
+      var one: any[] = [];
+      var m: any;
+      while ((m = this.recv()) !== null) one.push(m);
+      return one;
+    }
+    var raw: Array<string | ArrayBuffer> = kernel.procRecvBatch(this.id, 0);
+    for (var i = 0; i < raw.length; i++) raw[i] = JSProcess._decode(raw[i]);
+    return raw;
+  }
+
+  /** Largest single message the IPC rings accept for this child (bytes). */
+  get maxMessageBytes(): number {
+    if (!this._alive || typeof kernel.procRingInfo !== 'function') return 0;
+    var info = kernel.procRingInfo(this.id);
+    return info ? info.maxMessage : 0;
+  }
+
+  private static _encode(msg: any): string | ArrayBuffer | ArrayBufferView {
+    if (msg instanceof ArrayBuffer || ArrayBuffer.isView(msg)) return msg;
+    return JSON.stringify(msg);
+  }
+
+  private static _decode(raw: string | ArrayBuffer | null): any {
+    if (raw === null || typeof raw !== 'string') return raw;
+    try { return JSON.parse(raw); } catch (_) { return raw; }
   }
 
   // ── Inspect ────────────────────────────────────────────────────────────────
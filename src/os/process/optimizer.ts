@@ -15,6 +15,9 @@
  * ─── Automatic optimizations ─────────────────────────────────────────────────
  *   • Process starvation: if a ready process hasn't gained CPU time in
  *     STARVATION_FRAMES frames → temporarily boost its priority to 1
+ *     (and lift its kernel thread)
+ *   • Thread feedback:    every sample drives threadManager.rebalance(),
+ *     which re-scores thread interactivity for the MLFQ scheduler
  *   • JIT pool pressure:  logs a rate-limited warning when pool > 80% consumed
  *   • Memory pressure:    logs a rate-limited warning when heap free < MEM_LOW_MB
  *
@@ -33,6 +36,7 @@
  */
 
 import { scheduler } from './scheduler.js';
+import { threadManager } from './threads.js';
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
@@ -191,6 +195,9 @@ export class SystemProfiler {
         this._jitDeopts   = qjsJit.deoptCount    || 0;
       }
 
+      // Kernel threads: decay run/sleep history, re-score interactivity
+      threadManager.rebalance();
+
       // Scheduler: per-process CPU delta + starvation detection
       var procs = scheduler.getLiveProcesses();
       for (var i = 0; i < procs.length; i++) {
@@ -205,6 +212,7 @@ export class SystemProfiler {
           if (idle === STARVATION_FRAMES) {
             var boosted = Math.max(1, p.priority - 10);
             scheduler.setPriority(p.pid, boosted);
+            if (p.threadId >= 0) threadManager.boost(p.threadId);
             kernel.serialPut('[profiler] starvation: pid ' + p.pid +
                              ' (' + p.name + ') priority → ' + boosted + '\n');
           }
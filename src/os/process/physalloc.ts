@@ -8,6 +8,7 @@
  * Design:
  *  - One bit per 4 KB frame; 0 = free, 1 = used.
  *  - Frames 0..KERNEL_END_FRAME-1 are permanently reserved.
+ *  - The GRUB initramfs module stays reserved if it sits above them.
  *  - alloc(n) does a first-fit search for n contiguous free frames.
  *  - free(addr, n) releases n frames starting at addr.
  */
@@ -82,6 +83,22 @@ export class PhysicalAllocator {
     this._freeFrames = this._totalFrames > KERNEL_END_FRAME
       ? this._totalFrames - KERNEL_END_FRAME
       : 0;
+
+    // GRUB may load the initramfs module up here; JS reads it in place.
+    var rd = kernel.getInitramfsRange ? kernel.getInitramfsRange() : null;
+    if (rd) this.reserve(rd.addr, rd.len);
+  }
+
+  /** Mark the frames covering [addr, addr + bytes) used. */
+  reserve(addr: number, bytes: number): void {
+    var first = Math.floor(addr / PAGE_SIZE);
+    var last  = Math.ceil((addr + bytes) / PAGE_SIZE);
+    for (var f = first; f < last && f < this._totalFrames; f++) {
+      if (!this._testBit(f)) {
+        this._setBit(f);
+        this._freeFrames--;
+      }
+    }
   }
 
   // ── Statistics ────────────────────────────────────────────────────────
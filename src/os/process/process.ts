@@ -81,12 +81,11 @@ export class ProcessManager {
       // Item 148: close every open file descriptor.
       try { p.fdTable.closeAll(); } catch (_) { /* ignore I/O errors on shutdown */ }
 
-      // Item 149: release all virtual memory areas (the VMA list is the
-      // TypeScript-level resource; hardware page-table clean-up comes later
-      // once the VMM is integrated per-process in Phase 9).
+      // Item 149: release all virtual memory areas.
       p.vmas.length = 0;
 
-      // [Phase 2.2.1] Release the per-process page directory.
+      // [Phase 2.2.1] Release the per-process page directory together with
+      // every mapping in it (one pass over the hardware tables).
       processAddressSpace.destroyForProcess(pid);
 
       // Mark dead in our own table so subsequent queries see the correct state.
@@ -151,9 +150,9 @@ export class ProcessManager {
       fpuStateAddr:  0,
     });
 
-    // [Phase 2.2.1] Create an isolated page directory for the child process.
-    // This clones the kernel's PD so the child has its own address space.
-    processAddressSpace.createForProcess(child.pid);
+    // [Phase 2.2.1] Create an isolated page directory for the child process
+    // and share the parent's pages into it copy-on-write.
+    processAddressSpace.forkFrom(parent.pid, child.pid);
 
     return child.pid;
   }
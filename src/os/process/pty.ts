@@ -17,6 +17,8 @@
  *   master.onData(chunk => process.stdout.write(chunk));
  */
 
+import { POLLIN, POLLOUT, POLLHUP } from '../ipc/ipc.js';
+
 // ─── Types ────────────────────────────────────────────────────────────────────
 
 export interface PtyOptions {
@@ -53,6 +55,9 @@ class PtyLineDiscipline {
   private _readBuf   = '';
   private _sigHandlers: Array<(sig: string) => void> = [];
   private _dataHandlers: PtyDataHandler[] = [];
+  private _watchers: Array<(events: number) => void> = [];
+  /** Set when the master side hangs up. */
+  hungUp = false;
 
   constructor(echo: boolean, canon: boolean) {
     this.echo  = echo;
@@ -126,7 +131,25 @@ class PtyLineDiscipline {
   }
 
   private _flushRead(data: string): void {
+    var wasEmpty = this._readBuf.length === 0;
     this._readBuf += data;
+    if (wasEmpty) this.notify(POLLIN);
+  }
+
+  /** Slave-side readiness watchers (epoll). */
+  watch(cb: (events: number) => void): () => void {
+    var list = this._watchers;
+    list.push(cb);
+    return function() {
+      var i = list.indexOf(cb);
+      if (i >= 0) list.splice(i, 1);
+    };
+  }
+
+  notify(events: number): void {
+    for (var i = 0; i < this._watchers.length; i++) {
+      try { this._watchers[i](events); } catch (_) {}
+    }
   }
 }
 
@@ -174,6 +197,8 @@ export class PtyMaster {
     this._closed = true;
     this._disc.onSignal(() => {});
     for (var i = 0; i < this._onDataHandlers.length; i++) this._onDataHandlers[i]('\x00');  // HUP sentinel
+    this._disc.hungUp = true;
+    this._disc.notify(POLLIN | POLLHUP);
   }
 
   get isClosed(): boolean { return this._closed; }
@@ -213,6 +238,17 @@ export class PtySlave {
   /** True when data is waiting to be read. */
   get readable(): boolean { return this._disc.hasData; }
 
+  /** Readiness for select/poll/epoll: POLLIN on input, POLLHUP once the master closes. */
+  poll(): number {
+    var ev = this._closed ? 0 : POLLOUT;
+    if (this._disc.hasData) ev |= POLLIN;
+    if (this._disc.hungUp) ev |= POLLIN | POLLHUP;
+    return ev;
+  }
+
+  /** Notified when input becomes available or the master hangs up.  Returns unsubscribe. */
+  watch(cb: (events: number) => void): () => void { return this._disc.watch(cb); }
+
   /** Current terminal size. */
   get winSize(): WinSize { return { ...this._winSize }; }
 
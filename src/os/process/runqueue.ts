@@ -0,0 +1,223 @@
+/**
+ * JSOS run queues — O(1) priority FIFOs and a deadline heap
+ *
+ * PriorityRunQueue: one FIFO per priority level plus a two-level bitmap of
+ * the non-empty levels.  The best level is a find-first-set on the summary
+ * word and then on one level word, so push / pop / remove / has are O(1)
+ * whatever the number of runnable entries.  Lower level = more urgent.
+ *
+ * DeadlineQueue: binary min-heap keyed by wake-up tick.  Each entry knows
+ * its heap slot, so cancelling a sleep (a thread woken early) is O(log n)
+ * and waking the sleepers due at `now` costs O(expired · log n) — never a
+ * scan of every sleeping thread.
+ *
+ * Both are keyed by an integer id (tid / pid) supplied by the caller.
+ */
+
+interface RqNode<T> {
+  item:  T;
+  level: number;
+  prev:  RqNode<T> | null;
+  next:  RqNode<T> | null;
+}
+
+/** Index of the lowest set bit of a non-zero 32-bit word. */
+function ffs(x: number): number {
+  return 31 - Math.clz32(x & -x);
+}
+
+export class PriorityRunQueue<T> {
+  private _heads: Array<RqNode<T> | null>;
+  private _tails: Array<RqNode<T> | null>;
+  private _words: Int32Array;              // bit (l & 31) of word (l >> 5): level l non-empty
+  private _summary = 0;                    // bit w: _words[w] != 0
+  private _nodes = new Map<number, RqNode<T>>();
+  private _key: (item: T) => number;
+  readonly levels: number;
+
+  /** `levels` ≤ 1024 (32 summary bits × 32 level bits). */
+  constructor(levels: number, key: (item: T) => number) {
+    if (levels < 1) levels = 1;
+    if (levels > 1024) levels = 1024;
+    this.levels = levels;
+    this._key   = key;
+    this._heads = new Array(levels).fill(null);
+    this._tails = new Array(levels).fill(null);
+    this._words = new Int32Array((levels + 31) >> 5);
+  }
+
+  get size(): number { return this._nodes.size; }
+
+  has(key: number): boolean { return this._nodes.has(key); }
+
+  /** Level `key` is queued at, or -1. */
+  levelOf(key: number): number {
+    var n = this._nodes.get(key);
+    return n ? n.level : -1;
+  }
+
+  /** Most urgent non-empty level, or -1 when the queue is empty. */
+  highest(): number {
+    if (this._summary === 0) return -1;
+    var w = ffs(this._summary);
+    return (w << 5) + ffs(this._words[w]);
+  }
+
+  /** Append at the tail of `level` (re-queues if already present). */
+  push(item: T, level: number): void {
+    var key = this._key(item);
+    if (this._nodes.has(key)) this.remove(key);
+    level = level < 0 ? 0 : level >= this.levels ? this.levels - 1 : level | 0;
+    var n: RqNode<T> = { item: item, level: level, prev: this._tails[level], next: null };
+    if (n.prev) n.prev.next = n; else this._heads[level] = n;
+    this._tails[level] = n;
+    this._nodes.set(key, n);
+    this._words[level >> 5] |= 1 << (level & 31);
+    this._summary |= 1 << (level >> 5);
+  }
+
+  peek(): T | undefined {
+    var l = this.highest();
+    return l < 0 ? undefined : this._heads[l]!.item;
+  }
+
+  /** Remove and return the head of the most urgent level. */
+  pop(): T | undefined {
+    var l = this.highest();
+    if (l < 0) return undefined;
+    var n = this._heads[l]!;
+    this._unlink(n);
+    this._nodes.delete(this._key(n.item));
+    return n.item;
+  }
+
+  remove(key: number): boolean {
+    var n = this._nodes.get(key);
+    if (!n) return false;
+    this._unlink(n);
+    this._nodes.delete(key);
+    return true;
+  }
+
+  /** First entry, in scheduling order, that satisfies `pred`. */
+  find(pred: (item: T) => boolean): T | undefined {
+    for (var s = this._summary; s !== 0; s &= s - 1) {
+      var w = ffs(s);
+      for (var bits = this._words[w]; bits !== 0; bits &= bits - 1) {
+        for (var n = this._heads[(w << 5) + ffs(bits)]; n; n = n.next) {
+          if (pred(n.item)) return n.item;
+        }
+      }
+    }
+    return undefined;
+  }
+
+  /** All entries in scheduling order. */
+  toArray(): T[] {
+    var out: T[] = [];
+    this.find(function(item) { out.push(item); return false; });
+    return out;
+  }
+
+  private _unlink(n: RqNode<T>): void {
+    var l = n.level;
+    if (n.prev) n.prev.next = n.next; else this._heads[l] = n.next;
+    if (n.next) n.next.prev = n.prev; else this._tails[l] = n.prev;
+    n.prev = n.next = null;
+    if (this._heads[l] === null) {
+      var w = l >> 5;
+      this._words[w] &= ~(1 << (l & 31));
+      if (this._words[w] === 0) this._summary &= ~(1 << w);
+    }
+  }
+}
+
+interface DqEntry<T> {
+  item:     T;
+  key:      number;
+  deadline: number;
+  seq:      number;    // FIFO among equal deadlines
+  slot:     number;
+}
+
+export class DeadlineQueue<T> {
+  private _heap: DqEntry<T>[] = [];
+  private _byKey = new Map<number, DqEntry<T>>();
+  private _seq = 0;
+  private _key: (item: T) => number;
+
+  constructor(key: (item: T) => number) { this._key = key; }
+
+  get size(): number { return this._heap.length; }
+
+  has(key: number): boolean { return this._byKey.has(key); }
+
+  /** Earliest deadline, or Infinity when empty. */
+  nextDeadline(): number { return this._heap.length ? this._heap[0].deadline : Infinity; }
+
+  /** Schedule (or reschedule) `item` to expire at `deadline`. */
+  add(item: T, deadline: number): void {
+    var key = this._key(item);
+    if (this._byKey.has(key)) this.remove(key);
+    var e: DqEntry<T> = { item: item, key: key, deadline: deadline, seq: this._seq++, slot: this._heap.length };
+    this._heap.push(e);
+    this._byKey.set(key, e);
+    this._up(e.slot);
+  }
+
+  remove(key: number): boolean {
+    var e = this._byKey.get(key);
+    if (!e) return false;
+    this._byKey.delete(key);
+    var last = this._heap.pop()!;
+    if (last !== e) {
+      this._heap[e.slot] = last;
+      last.slot = e.slot;
+      this._up(last.slot);
+      this._down(last.slot);
+    }
+    return true;
+  }
+
+  /** Remove and return every entry whose deadline is ≤ `now`, earliest first. */
+  expire(now: number): T[] {
+    var out: T[] = [];
+    while (this._heap.length && this._heap[0].deadline <= now) {
+      var e = this._heap[0];
+      this.remove(e.key);
+      out.push(e.item);
+    }
+    return out;
+  }
+
+  private _less(a: DqEntry<T>, b: DqEntry<T>): boolean {
+    return a.deadline !== b.deadline ? a.deadline < b.deadline : a.seq < b.seq;
+  }
+
+  private _swap(i: number, j: number): void {
+    var h = this._heap, t = h[i];
+    h[i] = h[j]; h[i].slot = i;
+    h[j] = t;    t.slot = j;
+  }
+
+  private _up(i: number): void {
+    while (i > 0) {
+      var p = (i - 1) >> 1;
+      if (!this._less(this._heap[i], this._heap[p])) break;
+      this._swap(i, p);
+      i = p;
+    }
+  }
+
+  private _down(i: number): void {
+    var h = this._heap, n = h.length;
+    for (;;) {
+      var best = i, l = 2 * i + 1, r = l + 1;
+      if (l < n && this._less(h[l], h[best])) best = l;
+      if (r < n && this._less(h[r], h[best])) best = r;
+      if (best === i) break;
+      this._swap(i, best);
+      i = best;
+    }
+  }
+}
@@ -22,102 +22,41 @@
 import { threadManager } from './threads.js';
 import { signalManager } from './signals.js';
 import { processAddressSpace } from './vmm.js';
+import { PriorityRunQueue } from './runqueue.js';
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
-// ── O(log n) run queue — binary min-heap keyed by (priority, seqNo) ─────────
+// ── O(1) run queue — per-priority FIFOs ─────────────────────────────────────
+
+/** Process priorities run 0…255 (setPriority clamps). */
+const PROCESS_PRIORITY_LEVELS = 256;
 
 /**
- * Binary min-heap that orders `ProcessContext` objects by ascending
- * `priority`, breaking ties by ascending insertion-sequence number so that
- * equal-priority processes are served FIFO (round-robin within a class).
- *
- * All core ops are O(log n):
- *   push    – O(log n)
- *   pop     – O(log n)
- *   remove  – O(n) scan + O(log n) sift (acceptable; only on process exit)
- *
- * peek and size are O(1).
+ * Ready processes in one FIFO per priority level, indexed by a bitmap
+ * (see process/runqueue.ts).  Equal-priority processes are served FIFO
+ * (round-robin within a class); push, pop, remove and has are all O(1).
  */
 class RunQueue {
-  private _heap:  ProcessContext[] = [];
-  private _seqNo: Map<number, number> = new Map(); // pid → insertion seqNo
-  private _seq    = 0;
+  private _q = new PriorityRunQueue<ProcessContext>(PROCESS_PRIORITY_LEVELS,
+                                                    function(p) { return p.pid; });
 
-  get size(): number { return this._heap.length; }
+  get size(): number { return this._q.size; }
 
-  push(p: ProcessContext): void {
-    this._seqNo.set(p.pid, this._seq++);
-    this._heap.push(p);
-    this._siftUp(this._heap.length - 1);
-  }
+  push(p: ProcessContext): void { this._q.push(p, p.priority); }
 
   /** Remove and return the highest-priority (lowest numeric priority) process. */
-  pop(): ProcessContext | undefined {
-    if (this._heap.length === 0) return undefined;
-    const top = this._heap[0];
-    const last = this._heap.pop()!;
-    if (this._heap.length > 0) {
-      this._heap[0] = last;
-      this._siftDown(0);
-    }
-    this._seqNo.delete(top.pid);
-    return top;
-  }
+  pop(): ProcessContext | undefined { return this._q.pop(); }
 
-  peek(): ProcessContext | undefined { return this._heap[0]; }
-
-  /** Remove a specific process by pid (O(n) scan + O(log n) sift). */
-  remove(pid: number): boolean {
-    const i = this._heap.findIndex(p => p.pid === pid);
-    if (i === -1) return false;
-    const last = this._heap.pop()!;
-    if (i < this._heap.length) {
-      this._heap[i] = last;
-      this._siftUp(i);
-      this._siftDown(i);
-    }
-    this._seqNo.delete(pid);
-    return true;
-  }
-
-  has(pid: number): boolean {
-    return this._seqNo.has(pid);
-  }
+  peek(): ProcessContext | undefined { return this._q.peek(); }
 
-  toArray(): ProcessContext[] { return [...this._heap]; }
+  remove(pid: number): boolean { return this._q.remove(pid); }
 
-  private _cmp(a: ProcessContext, b: ProcessContext): boolean {
-    // Lower priority number = higher urgency.  Tie-break by seqNo (FIFO).
-    const pa = a.priority, pb = b.priority;
-    if (pa !== pb) return pa < pb;
-    return (this._seqNo.get(a.pid) ?? 0) < (this._seqNo.get(b.pid) ?? 0);
-  }
+  has(pid: number): boolean { return this._q.has(pid); }
 
-  private _siftUp(i: number): void {
-    const heap = this._heap;
-    while (i > 0) {
-      const parent = (i - 1) >> 1;
-      if (this._cmp(heap[i], heap[parent])) {
-        [heap[i], heap[parent]] = [heap[parent], heap[i]];
-        i = parent;
-      } else break;
-    }
-  }
+  /** First queued process, in scheduling order, matching `pred`. */
+  find(pred: (p: ProcessContext) => boolean): ProcessContext | undefined { return this._q.find(pred); }
 
-  private _siftDown(i: number): void {
-    const heap = this._heap;
-    const n = heap.length;
-    for (;;) {
-      let best = i;
-      const l = 2 * i + 1, r = 2 * i + 2;
-      if (l < n && this._cmp(heap[l], heap[best])) best = l;
-      if (r < n && this._cmp(heap[r], heap[best])) best = r;
-      if (best === i) break;
-      [heap[i], heap[best]] = [heap[best], heap[i]];
-      i = best;
-    }
-  }
+  toArray(): ProcessContext[] { return this._q.toArray(); }
 }
 
 // ─────────────────────────────────────────────────────────────────────────────
@@ -180,8 +119,10 @@ export type SchedulingAlgorithm = 'round-robin' | 'priority' | 'real-time';
 
 export class ProcessScheduler {
   private processes     = new Map<number, ProcessContext>();
-  private readyQueue    = new RunQueue();   // O(log n) min-heap
-  private blockedQueue:  ProcessContext[] = [];
+  private readyQueue    = new RunQueue();   // O(1) bitmap-indexed FIFOs
+  private blockedQueue   = new Map<number, ProcessContext>();
+  /** pid → processes blocked in waitForProcess() on it. */
+  private _waiters       = new Map<number, ProcessContext[]>();
   private currentProcess: ProcessContext | null = null;
   private nextPid        = 1;
   private timeSlice      = 3;    // frames (~60 ms at 50 fps)
@@ -360,19 +301,23 @@ export class ProcessScheduler {
     // Clean up signal state (items 157, 158) — masks, pending signals, handlers.
     signalManager.cleanup(pid);
 
-    // Remove from queues — O(n) for readyQueue, O(n) for blocked.
+    // Remove from queues — O(1).
     this.readyQueue.remove(pid);
-    this.blockedQueue = this.blockedQueue.filter(function(p) { return p.pid !== pid; });
-
-    // Wake any process waiting for this one — O(n) scan, acceptable.
-    this.processes.forEach((p) => {
-      if (p.waitingFor === pid) {
+    this.blockedQueue.delete(pid);
+
+    // Wake the processes waiting for this one.
+    var waiters = this._waiters.get(pid);
+    if (waiters) {
+      this._waiters.delete(pid);
+      for (var w = 0; w < waiters.length; w++) {
+        var p = waiters[w];
+        if (p.waitingFor !== pid || p.state === 'terminated') continue;
+        this.blockedQueue.delete(p.pid);
         p.state      = 'ready';
         p.waitingFor = undefined;
-        // Push directly into the heap; no second full-table scan needed.
         if (!this.readyQueue.has(p.pid)) this.readyQueue.push(p);
       }
-    });
+    }
 
     if (this.currentProcess && this.currentProcess.pid === pid) {
       this.currentProcess = null;
@@ -386,7 +331,7 @@ export class ProcessScheduler {
     var process = this.processes.get(pid);
     if (!process || process.state !== 'running') return false;
     process.state = 'blocked';
-    this.blockedQueue.push(process);
+    this.blockedQueue.set(pid, process);
     if (this.currentProcess && this.currentProcess.pid === pid) {
       this.currentProcess = null;
       this.schedule();
@@ -395,15 +340,12 @@ export class ProcessScheduler {
   }
 
   unblockProcess(pid: number): boolean {
-    for (var i = 0; i < this.blockedQueue.length; i++) {
-      if (this.blockedQueue[i].pid === pid) {
-        var process = this.blockedQueue.splice(i, 1)[0];
-        process.state = 'ready';
-        this.readyQueue.push(process);
-        return true;
-      }
-    }
-    return false;
+    var process = this.blockedQueue.get(pid);
+    if (!process) return false;
+    this.blockedQueue.delete(pid);
+    process.state = 'ready';
+    this.readyQueue.push(process);
+    return true;
   }
 
   waitForProcess(pid: number): { success: boolean; error?: string; errno?: number; value?: { pid: number; exitCode: number } } {
@@ -417,7 +359,10 @@ export class ProcessScheduler {
     if (this.currentProcess) {
       this.currentProcess.state      = 'waiting';
       this.currentProcess.waitingFor = pid;
-      this.blockedQueue.push(this.currentProcess);
+      this.blockedQueue.set(this.currentProcess.pid, this.currentProcess);
+      var list = this._waiters.get(pid);
+      if (list) list.push(this.currentProcess);
+      else this._waiters.set(pid, [this.currentProcess]);
     }
     return { success: false, error: 'Process not terminated', errno: 4 };
   }
@@ -488,9 +433,9 @@ export class ProcessScheduler {
       this.readyQueue.push(this.currentProcess);
     }
 
-    // With the RunQueue min-heap the three "algorithm" branches all reduce to
-    // pop() — the heap already orders by priority+seqNo — but we keep the
-    // branch for API compatibility and to allow future policy overrides.
+    // With the per-priority RunQueue the three "algorithm" branches all reduce
+    // to pop() — the queue already orders by priority, FIFO within a level —
+    // but we keep the branch for API compatibility and policy overrides.
     var next: ProcessContext;
     switch (this.algorithm) {
       case 'priority':   next = this._schedulePriority();  break;
@@ -516,19 +461,19 @@ export class ProcessScheduler {
     return next;
   }
 
-  // ── Scheduling algorithms — all O(log n) with RunQueue ───────────────────
+  // ── Scheduling algorithms — O(1) with RunQueue ───────────────────────────
 
   /**
    * Round-robin: pop the process that has been waiting longest among those
-   * sharing the lowest priority number.  O(log n) — RunQueue FIFO tie-break.
+   * sharing the lowest priority number.  O(1) — head of the best FIFO.
    */
   private _scheduleRoundRobin(): ProcessContext {
     return this.readyQueue.pop()!;
   }
 
   /**
-   * Priority: pure highest-priority-first.  O(log n) — RunQueue min-heap.
-   * (Identical to round-robin here because the heap already orders correctly.)
+   * Priority: pure highest-priority-first.  O(1) — bitmap lookup.
+   * (Identical to round-robin here because the queue already orders correctly.)
    */
   private _schedulePriority(): ProcessContext {
     return this.readyQueue.pop()!;
@@ -541,11 +486,10 @@ export class ProcessScheduler {
    * policy is 'real-time', it is promoted regardless of priority.
    */
   private _scheduleRealTime(): ProcessContext {
-    const heapArr = this.readyQueue.toArray();
-    // Processes with explicit RT policy OR priority ≤ 5 are candidates.
-    const rtProc  = heapArr.filter(p =>
-        p.schedPolicy === 'real-time' || (p.schedPolicy === 'inherit' && p.priority <= 5))
-      .sort((a, b) => a.priority - b.priority)[0];
+    // Processes with explicit RT policy OR priority ≤ 5 are candidates; the
+    // queue is walked in priority order, so the first match is the best one.
+    const rtProc = this.readyQueue.find(p =>
+        p.schedPolicy === 'real-time' || (p.schedPolicy === 'inherit' && p.priority <= 5));
     if (rtProc) {
       this.readyQueue.remove(rtProc.pid);
       return rtProc;
@@ -677,7 +621,9 @@ export class ProcessScheduler {
   setPriority(pid: number, priority: number): boolean {
     var p = this.processes.get(pid);
     if (!p) return false;
-    p.priority = Math.max(0, Math.min(255, priority));
+    p.priority = Math.max(0, Math.min(PROCESS_PRIORITY_LEVELS - 1, priority));
+    // A queued process moves to its new level (tail of that FIFO).
+    if (this.readyQueue.has(pid)) this.readyQueue.push(p);
     return true;
   }
 
@@ -4,10 +4,33 @@
  * Implements kernel threads as TypeScript objects.  Each Thread holds the
  * logical CPU state that would be saved/restored during a context switch.
  *
- * Scheduling logic is 100% TypeScript (multi-level priority round-robin).
- * The C layer only provides the hardware primitives (TSS.ESP0, timer ticks).
+ * Scheduling logic is 100% TypeScript: a multi-level feedback queue over 40
+ * priority levels.  The C layer only provides the hardware
+ * primitives (TSS.ESP0, timer ticks).
+ *
+ *   • Ready threads sit in per-level FIFOs indexed by a bitmap
+ *     (PriorityRunQueue), so picking the next thread is O(1).
+ *   • Sleepers sit in a deadline heap (DeadlineQueue); a tick wakes only
+ *     the threads that are due.
+ *   • Feedback: each thread's effective priority is its base priority
+ *     shifted by up to ±THREAD_FEEDBACK_RANGE levels from an interactivity
+ *     score — the ratio of recent sleep to recent run time.  Threads that
+ *     mostly block (UI, I/O) move up; threads that burn whole slices move
+ *     down.  Lower levels get longer slices.
+ *   • rebalance(), driven by the system profiler (process/optimizer.ts),
+ *     decays that history and lifts threads that have waited too long.
+ *
+ * Level 39 is the idle class: no feedback, never boosted.
+ *
+ * These threads all run on the one QuickJS stack, so their saved ESP values
+ * are logical.  Real stack switches happen only between C kernel threads
+ * (src/kernel/kthread.c): the QuickJS stack is kernel thread 0, and
+ * driver work such as network RX runs on its own stack, sleeping on IRQ wait
+ * queues.  kernel.kthreadList() reports them.
  */
 
+import { PriorityRunQueue, DeadlineQueue } from './runqueue.js';
+
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
 export type ThreadState = 'ready' | 'running' | 'blocked' | 'sleeping' | 'dead';
@@ -15,12 +38,23 @@ export type ThreadState = 'ready' | 'running' | 'blocked' | 'sleeping' | 'dead';
 /** A coroutine step function: called once per frame. Returns 'done' when finished. */
 export type CoroutineStep = () => 'done' | 'pending';
 
+export const THREAD_PRIORITY_LEVELS = 40;
+export const THREAD_IDLE_PRIORITY   = 39;
+/** Largest shift the interactivity score applies to a base priority. */
+export const THREAD_FEEDBACK_RANGE  = 5;
+/** Run + sleep history (ticks) kept before rebalance() halves it. */
+const THREAD_HISTORY_TICKS = 500;
+/** Ticks a ready thread may wait before rebalance() lifts it to level 0. */
+const THREAD_STARVE_TICKS  = 100;
+
 export class Thread {
   tid: number;
   name: string;
   state: ThreadState;
-  /** 0 = highest priority, 39 = lowest (idle). Lower number wins. */
+  /** 0 = highest priority, 39 = lowest (idle). Lower number wins.  Effective (feedback-adjusted) level. */
   priority: number;
+  /** Priority the thread was created with / set to; feedback moves `priority` around it. */
+  basePriority: number;
   /** Physical address of the base of this thread's 64 KB kernel stack. */
   kernelStack: number;
   /** Saved ESP value pointing into kernelStack (updated on context switch). */
@@ -31,136 +65,261 @@ export class Thread {
   blockedOn: any;
   /** Per-thread errno (POSIX Phase 6+). */
   errno: number;
+  /** Decayed ticks spent running / blocked or asleep (interactivity history). */
+  runTicks: number;
+  sleepTicks: number;
+  /** Ticks left in the current time slice. */
+  sliceLeft: number;
+  /** Tick the thread last blocked / slept, or became ready. */
+  since: number;
+  /** Total ticks on CPU since creation. */
+  cpuTicks: number;
 
   constructor(tid: number, name: string, priority: number) {
     this.tid = tid;
     this.name = name;
     this.state = 'ready';
     this.priority = priority;
+    this.basePriority = priority;
     this.kernelStack = 0;
     this.savedESP = 0;
     this.sleepUntil = 0;
     this.blockedOn = null;
     this.errno = 0;
+    this.runTicks = 0;
+    this.sleepTicks = 0;
+    this.sliceLeft = 0;
+    this.since = 0;
+    this.cpuTicks = 0;
   }
 }
 
+/**
+ * Interactivity score in [0, 100]: 0 = always sleeping, 100 = never sleeps,
+ * 50 for a thread with no history.
+ */
+export function interactivityScore(run: number, sleep: number): number {
+  if (sleep > run) return 50 * run / sleep;
+  if (run > sleep) return 100 - 50 * sleep / run;
+  return 50;
+}
+
+/** Time slice (ticks) for a level: 1 tick at the top, 5 at the bottom. */
+function sliceFor(priority: number): number {
+  return 1 + (priority >> 3);
+}
+
+export interface ThreadSchedStats {
+  switches:   number;   // context switches made by tick()/yieldThread()
+  wakeups:    number;   // sleepers woken by deadline
+  boosts:     number;   // starvation lifts by rebalance()
+  ready:      number;
+  sleeping:   number;
+}
+
 export class ThreadManager {
-  private _threads: Thread[] = [];
+  private _threads = new Map<number, Thread>();
   private _currentTid: number = 0;
   private _nextTid: number = 0;
+  private _runq   = new PriorityRunQueue<Thread>(THREAD_PRIORITY_LEVELS, function(t) { return t.tid; });
+  private _sleepq = new DeadlineQueue<Thread>(function(t) { return t.tid; });
+  private _clock: () => number;
+  private _switches = 0;
+  private _wakeups  = 0;
+  private _boosts   = 0;
+
+  /** `clock` returns the current tick; defaults to kernel.getTicks (benchmarks pass a virtual one). */
+  constructor(clock?: () => number) {
+    this._clock = clock || function() { return kernel.getTicks(); };
+  }
 
   /**
    * Create a new kernel thread and add it to the ready queue.
    * Returns the new Thread object.
    */
   createThread(name: string, priority: number = 20): Thread {
-    var t = new Thread(this._nextTid++, name, priority);
-    this._threads.push(t);
+    var t = new Thread(this._nextTid++, name, this._clampPriority(priority));
+    this._threads.set(t.tid, t);
+    this._makeReady(t, this._clock());
     return t;
   }
 
   /**
-   * Cooperative scheduler tick.  Called by TypeScript at yield points
-   * (and registered with kernel.registerSchedulerHook so the C layer can
-   * invoke it when separate per-thread kernel stacks are in place).
+   * Preemptive scheduler tick.  Registered with kernel.registerSchedulerHook
+   * so the C layer invokes it at 100 Hz (also callable at yield points).
    *
-   * Wakes any sleeping threads whose deadline has passed, then picks the
-   * highest-priority ready thread (round-robin among equal-priority) and
-   * records it as current.
+   * Wakes the sleepers whose deadline has passed, charges the running
+   * thread one tick, and switches when its slice is used up or a more
+   * urgent thread is ready — round-robin among equal priority.
    *
    * Returns the new thread's savedESP (0 if unchanged or no threads exist).
    */
   tick(): number {
-    var now = kernel.getTicks();
+    var now = this._clock();
 
-    // Wake sleeping threads whose deadline has passed.
-    for (var i = 0; i < this._threads.length; i++) {
-      var t = this._threads[i];
-      if (t.state === 'sleeping' && now >= t.sleepUntil) {
-        t.state = 'ready';
-      }
+    var due = this._sleepq.expire(now);
+    for (var i = 0; i < due.length; i++) {
+      this._wakeups++;
+      this._wake(due[i], now);
     }
 
-    var next = this._schedule();
-    if (next) {
-      this._currentTid = next.tid;
-      return next.savedESP;
+    var cur = this.currentThread();
+    if (cur && cur.state === 'running') {
+      cur.runTicks++;
+      cur.cpuTicks++;
+      cur.sliceLeft--;
     }
-    return 0;
-  }
 
-  /** Pick the next thread to run (multi-level priority round-robin). */
-  private _schedule(): Thread | null {
-    if (this._threads.length === 0) return null;
+    var next = this._schedule(cur, now);
+    return next && next !== cur ? next.savedESP : 0;
+  }
 
+  /** Give up the rest of the current slice (sched_yield). */
+  yieldThread(): number {
     var cur = this.currentThread();
-    var startIdx = 0;
-    if (cur) {
-      var curIdx = this._indexOf(cur.tid);
-      startIdx = (curIdx + 1) % this._threads.length;
-    }
+    if (cur && cur.state === 'running') cur.sliceLeft = 0;
+    var next = this._schedule(cur, this._clock());
+    return next && next !== cur ? next.savedESP : 0;
+  }
 
-    var best: Thread | null = null;
-    for (var i = 0; i < this._threads.length; i++) {
-      var idx = (startIdx + i) % this._threads.length;
-      var th = this._threads[idx];
-      if (th.state === 'ready' || th.state === 'running') {
-        if (best === null || th.priority < best.priority) {
-          best = th;
-        }
+  /** Pick the next thread to run.  O(1): bitmap lookup + FIFO pop. */
+  private _schedule(cur: Thread | null, now: number): Thread | null {
+    var top = this._runq.highest();
+    if (cur && cur.state === 'running') {
+      // A spent slice is re-scored first; then keep running unless something
+      // more urgent is ready, or a peer at the same level is waiting.
+      var spent = cur.sliceLeft <= 0;
+      if (spent) this._feedback(cur);
+      if (top < 0 || top > cur.priority || (top === cur.priority && !spent)) {
+        if (spent) cur.sliceLeft = sliceFor(cur.priority);
+        return cur;
       }
+      this._makeReady(cur, now);
     }
-    return best;
+    var next = this._runq.pop();
+    if (!next) return null;
+    this._run(next);
+    this._switches++;
+    return next;
   }
 
   /** Returns the currently-running Thread, or null. */
   currentThread(): Thread | null {
-    return this._byTid(this._currentTid);
+    return this._threads.get(this._currentTid) || null;
   }
 
   getCurrentTid(): number {
     return this._currentTid;
   }
 
+  /**
+   * Make `tid` the running thread (used by the process scheduler when it
+   * switches processes).  The previous thread goes back on its run queue.
+   */
   setCurrentTid(tid: number): void {
+    var prev = this.currentThread();
     this._currentTid = tid;
+    if (prev && prev.tid !== tid && prev.state === 'running') this._makeReady(prev, this._clock());
+    var t = this._threads.get(tid);
+    if (t && t.state === 'ready') { this._runq.remove(tid); this._run(t); }
   }
 
   blockThread(tid: number, reason: any): void {
-    var t = this._byTid(tid);
-    if (t) { t.state = 'blocked'; t.blockedOn = reason; }
+    var t = this._threads.get(tid);
+    if (!t || t.state === 'dead') return;
+    this._runq.remove(tid);
+    this._sleepq.remove(tid);
+    t.state = 'blocked';
+    t.blockedOn = reason;
+    t.since = this._clock();
   }
 
   unblockThread(tid: number): void {
-    var t = this._byTid(tid);
+    var t = this._threads.get(tid);
     if (t && (t.state === 'blocked' || t.state === 'sleeping')) {
-      t.state = 'ready';
-      t.blockedOn = null;
+      this._sleepq.remove(tid);
+      this._wake(t, this._clock());
     }
   }
 
   sleepThread(tid: number, ms: number): void {
-    var t = this._byTid(tid);
-    if (t) {
-      t.state = 'sleeping';
-      // Timer fires at ~100 Hz → 1 tick ≈ 10 ms.
-      t.sleepUntil = kernel.getTicks() + Math.ceil(ms / 10);
-    }
+    var t = this._threads.get(tid);
+    if (!t || t.state === 'dead') return;
+    var now = this._clock();
+    this._runq.remove(tid);
+    t.state = 'sleeping';
+    t.since = now;
+    // Timer fires at ~100 Hz → 1 tick ≈ 10 ms.
+    t.sleepUntil = now + Math.ceil(ms / 10);
+    this._sleepq.add(t, t.sleepUntil);
   }
 
   exitThread(tid: number, code: number): void {
-    var t = this._byTid(tid);
-    if (t) { t.state = 'dead'; }
+    var t = this._threads.get(tid);
+    if (!t) return;
+    this._runq.remove(tid);
+    this._sleepq.remove(tid);
+    t.state = 'dead';
+  }
+
+  /** Change a thread's base priority (nice); takes effect immediately. */
+  setThreadPriority(tid: number, priority: number): boolean {
+    var t = this._threads.get(tid);
+    if (!t) return false;
+    t.basePriority = this._clampPriority(priority);
+    this._reprioritise(t, this._feedbackLevel(t));
+    return true;
   }
 
-  threadCount(): number { return this._threads.length; }
+  /**
+   * Periodic feedback pass, called by the system profiler (~5 Hz):
+   *   • halves run/sleep history once it exceeds THREAD_HISTORY_TICKS so the
+   *     score follows recent behaviour;
+   *   • recomputes every live thread's effective priority;
+   *   • lifts ready threads that have waited THREAD_STARVE_TICKS to level 0
+   *     for one slice (they drop back at their next feedback).
+   */
+  rebalance(): void {
+    var now = this._clock();
+    var self = this;
+    this._threads.forEach(function(t) {
+      if (t.state === 'dead') return;
+      if (t.runTicks + t.sleepTicks > THREAD_HISTORY_TICKS) {
+        t.runTicks   = t.runTicks   / 2;
+        t.sleepTicks = t.sleepTicks / 2;
+      }
+      var level = self._feedbackLevel(t);
+      if (t.state === 'ready' && t.basePriority < THREAD_IDLE_PRIORITY && now - t.since >= THREAD_STARVE_TICKS) {
+        level = 0;
+        t.since = now;
+        self._boosts++;
+      }
+      self._reprioritise(t, level);
+    });
+  }
+
+  /** Lift one thread to level 0 until its next feedback (profiler starvation hook). */
+  boost(tid: number): void {
+    var t = this._threads.get(tid);
+    if (!t || t.state === 'dead' || t.basePriority >= THREAD_IDLE_PRIORITY) return;
+    this._boosts++;
+    this._reprioritise(t, 0);
+  }
+
+  threadCount(): number { return this._threads.size; }
+
+  stats(): ThreadSchedStats {
+    return { switches: this._switches, wakeups: this._wakeups, boosts: this._boosts,
+             ready: this._runq.size, sleeping: this._sleepq.size };
+  }
 
   /** Return a read-only snapshot of all threads (for ps / top display). */
-  getThreads(): Array<{ tid: number; name: string; state: ThreadState; priority: number }> {
-    return this._threads.map(function(t) {
-      return { tid: t.tid, name: t.name, state: t.state, priority: t.priority };
+  getThreads(): Array<{ tid: number; name: string; state: ThreadState; priority: number; cpuTicks: number }> {
+    var out: Array<{ tid: number; name: string; state: ThreadState; priority: number; cpuTicks: number }> = [];
+    this._threads.forEach(function(t) {
+      out.push({ tid: t.tid, name: t.name, state: t.state, priority: t.priority, cpuTicks: t.cpuTicks });
     });
+    return out;
   }
 
   /** Return a read-only snapshot of all active coroutines. */
@@ -168,18 +327,62 @@ export class ThreadManager {
     return this._coroutines.map(function(c) { return { id: c.id, name: c.name }; });
   }
 
-  private _byTid(tid: number): Thread | null {
-    for (var i = 0; i < this._threads.length; i++) {
-      if (this._threads[i].tid === tid) return this._threads[i];
-    }
-    return null;
+  // ── Queue transitions ──────────────────────────────────────────────────────
+
+  private _clampPriority(p: number): number {
+    p = p | 0;
+    return p < 0 ? 0 : p >= THREAD_PRIORITY_LEVELS ? THREAD_PRIORITY_LEVELS - 1 : p;
   }
 
-  private _indexOf(tid: number): number {
-    for (var i = 0; i < this._threads.length; i++) {
-      if (this._threads[i].tid === tid) return i;
+  private _run(t: Thread): void {
+    t.state = 'running';
+    t.sliceLeft = sliceFor(t.priority);
+    this._currentTid = t.tid;
+  }
+
+  /** Put `t` at the tail of its level — or straight back on CPU if it is current. */
+  private _makeReady(t: Thread, now: number): void {
+    t.blockedOn = null;
+    if (t.tid === this._currentTid && t.state !== 'running' && t.state !== 'ready') {
+      t.state = 'running';
+      return;
     }
-    return 0;
+    t.state = 'ready';
+    t.since = now;
+    this._runq.push(t, t.priority);
+  }
+
+  /** Blocked / sleeping → ready, crediting the time off CPU to its history. */
+  private _wake(t: Thread, now: number): void {
+    t.sleepTicks += now - t.since;
+    t.priority = this._feedbackLevel(t);
+    this._makeReady(t, now);
+  }
+
+  /**
+   * Slice used up: step one level toward the re-scored priority, so a thread
+   * turning CPU-bound sinks gradually.  A starvation lift (below the
+   * feedback band) ends outright.
+   */
+  private _feedback(t: Thread): void {
+    var target = this._feedbackLevel(t);
+    if (t.priority < t.basePriority - THREAD_FEEDBACK_RANGE) t.priority = target;
+    else if (target > t.priority) t.priority++;
+    else if (target < t.priority) t.priority = target;
+  }
+
+  private _feedbackLevel(t: Thread): number {
+    if (t.basePriority >= THREAD_IDLE_PRIORITY) return t.basePriority;
+    var score = interactivityScore(t.runTicks, t.sleepTicks);
+    var shift = Math.round((score - 50) * THREAD_FEEDBACK_RANGE / 50);
+    var p = t.basePriority + shift;
+    return p < 0 ? 0 : p >= THREAD_IDLE_PRIORITY ? THREAD_IDLE_PRIORITY - 1 : p;
+  }
+
+  private _reprioritise(t: Thread, level: number): void {
+    if (level === t.priority) return;
+    t.priority = level;
+    if (t.state === 'ready') this._runq.push(t, level);   // re-queues at the tail
   }
 
   // ── Coroutine scheduler ────────────────────────────────────────────────────
@@ -8,10 +8,15 @@
  * - Page fault handling
  * - Memory-mapped I/O
  * - Phase 4: hardware paging via kernel.setPageEntry / kernel.enablePaging
+ * - Range ops: real x86 page tables edited a range at a time through the bulk
+ *   kernel.pt* primitives (map / unmap / protect / COW clone).  The JS side
+ *   keeps only the VMAs, in an interval tree; per-page state lives in the
+ *   hardware tables, so fork() of a large process is one C call per VMA.
  */
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
 
+/** Decoded view of one page-table entry (see getPageTableEntry). */
 export interface PageTableEntry {
   present: boolean;
   writable: boolean;
@@ -41,19 +46,415 @@ interface StackGuardEntry {
   minStack: number;
 }
 
+// ── PTE bits (match src/kernel/pagetable.h) ──────────────────────────────────
+
+export const PTE_PRESENT  = 0x001;
+export const PTE_WRITE    = 0x002;
+export const PTE_USER     = 0x004;
+export const PTE_PCD      = 0x010;
+export const PTE_ACCESSED = 0x020;
+export const PTE_DIRTY    = 0x040;
+export const PTE_HUGE     = 0x080;
+export const PTE_COW      = 0x200;
+export const PTE_OWNED    = 0x400;
+
+const PAGE_SIZE = 4096;
+/** Dynamic allocations live above the kernel's 4 MB identity maps (≤ 512 MB RAM). */
+const VMM_VA_BASE  = 0x40000000;
+const VMM_VA_LIMIT = 0xA0000000;   // zygote arena window above (zygote.h)
+
+// ── VMA interval tree ────────────────────────────────────────────────────────
+
+interface VmaNode {
+  vma:    MemoryRegion;
+  prio:   number;
+  maxEnd: number;            // max vma.end in this subtree
+  lo:     number;            // min vma.start in this subtree
+  gap:    number;            // largest hole between this subtree's VMAs
+  left:   VmaNode | null;
+  right:  VmaNode | null;
+}
+
+/**
+ * Interval tree of VMAs: a treap keyed by start address, each node
+ * augmented with the largest end in its subtree so containment and overlap
+ * queries prune whole subtrees, and with the largest hole between its VMAs
+ * so first-fit allocation skips subtrees too full to help.  O(log n)
+ * insert / remove / lookup / allocation.
+ */
+export class VmaTree {
+  private _root: VmaNode | null = null;
+  private _size = 0;
+  private _seed = 0x2545F491;
+
+  get size(): number { return this._size; }
+
+  insert(vma: MemoryRegion): void {
+    var node: VmaNode = { vma, prio: this._rand(), maxEnd: vma.end, lo: vma.start, gap: 0, left: null, right: null };
+    this._root = this._insert(this._root, node);
+    this._size++;
+  }
+
+  /** Remove `vma` (by identity).  Returns false if it is not in the tree. */
+  remove(vma: MemoryRegion): boolean {
+    var before = this._size;
+    this._root = this._remove(this._root, vma);
+    return this._size !== before;
+  }
+
+  /** The VMA containing `addr` (the highest-starting one if several do). */
+  find(addr: number): MemoryRegion | null {
+    var n = this._root, best: MemoryRegion | null = null;
+    while (n) {
+      if (n.maxEnd <= addr) break;                 // nothing here reaches addr
+      if (n.vma.start <= addr) {
+        if (addr < n.vma.end && (!best || n.vma.start > best.start)) best = n.vma;
+        // A later-starting container can only be on the right.
+        if (n.right && n.right.maxEnd > addr) { n = n.right; continue; }
+        if (best) break;
+        n = n.left;
+      } else {
+        n = n.left;
+      }
+    }
+    if (best) return best;
+    // Rare: a long VMA hidden in a left subtree behind a short right one.
+    var hits = this.overlapping(addr, addr + 1);
+    return hits.length ? hits[hits.length - 1] : null;
+  }
+
+  /** VMAs intersecting [start, end), in address order. */
+  overlapping(start: number, end: number): MemoryRegion[] {
+    var out: MemoryRegion[] = [];
+    this._collect(this._root, start, end, out);
+    return out;
+  }
+
+  /**
+   * First-fit: the lowest address ≥ lo where `size` bytes fit before `hi`
+   * without touching any VMA, or null.
+   */
+  firstFit(size: number, lo: number, hi: number): number | null {
+    var at = { cur: lo };
+    this._fit(this._root, size, at);
+    return at.cur + size <= hi ? at.cur : null;
+  }
+
+  toArray(): MemoryRegion[] {
+    var out: MemoryRegion[] = [];
+    (function walk(n: VmaNode | null) {
+      if (!n) return;
+      walk(n.left); out.push(n.vma); walk(n.right);
+    })(this._root);
+    return out;
+  }
+
+  private _rand(): number {
+    var x = this._seed;
+    x ^= x << 13; x ^= x >>> 17; x ^= x << 5;
+    this._seed = x >>> 0;
+    return this._seed;
+  }
+
+  private _fix(n: VmaNode): VmaNode {
+    var l = n.left, r = n.right;
+    var m = n.vma.end, gap = 0;
+    if (l) {
+      gap = Math.max(l.gap, n.vma.start - l.maxEnd);
+      if (l.maxEnd > m) m = l.maxEnd;
+    }
+    if (r) {
+      // r.gap ignores VMAs on this side that reach into r; that only
+      // overstates it, which costs _fit a wasted descent, never a wrong answer.
+      gap = Math.max(gap, r.gap, r.lo - m);
+      if (r.maxEnd > m) m = r.maxEnd;
+    }
+    n.maxEnd = m;
+    n.lo = l ? l.lo : n.vma.start;
+    n.gap = gap;
+    return n;
+  }
+
+  private _insert(n: VmaNode | null, x: VmaNode): VmaNode {
+    if (!n) return x;
+    if (x.vma.start < n.vma.start) {
+      n.left = this._insert(n.left, x);
+      if (n.left.prio > n.prio) {             // rotate right
+        var l = n.left; n.left = l.right; l.right = this._fix(n); return this._fix(l);
+      }
+    } else {
+      n.right = this._insert(n.right, x);
+      if (n.right.prio > n.prio) {            // rotate left
+        var r = n.right; n.right = r.left; r.left = this._fix(n); return this._fix(r);
+      }
+    }
+    return this._fix(n);
+  }
+
+  private _remove(n: VmaNode | null, vma: MemoryRegion): VmaNode | null {
+    if (!n) return null;
+    if (n.vma === vma) {
+      this._size--;
+      return this._merge(n.left, n.right);
+    }
+    if (vma.start < n.vma.start) n.left = this._remove(n.left, vma);
+    else {
+      n.right = this._remove(n.right, vma);
+      // Equal starts may sit on either side after rotations.
+      if (vma.start === n.vma.start && n.left) n.left = this._remove(n.left, vma);
+    }
+    return this._fix(n);
+  }
+
+  private _merge(a: VmaNode | null, b: VmaNode | null): VmaNode | null {
+    if (!a) return b;
+    if (!b) return a;
+    if (a.prio > b.prio) { a.right = this._merge(a.right, b); return this._fix(a); }
+    b.left = this._merge(a, b.left);
+    return this._fix(b);
+  }
+
+  /**
+   * In-order first-fit over subtree n.  `at.cur` is the lowest address not
+   * covered by anything visited so far; returns true once `size` bytes fit
+   * at it before the next VMA.  A subtree whose largest hole is too small
+   * is passed over in one step.
+   */
+  private _fit(n: VmaNode | null, size: number, at: { cur: number }): boolean {
+    if (!n || n.maxEnd <= at.cur) return false;
+    if (n.lo >= at.cur + size) return true;
+    if (n.gap < size) { at.cur = n.maxEnd; return false; }
+    if (this._fit(n.left, size, at)) return true;
+    if (n.vma.start >= at.cur + size) return true;
+    if (n.vma.end > at.cur) at.cur = n.vma.end;
+    return this._fit(n.right, size, at);
+  }
+
+  private _collect(n: VmaNode | null, start: number, end: number, out: MemoryRegion[]): void {
+    if (!n || n.maxEnd <= start) return;
+    this._collect(n.left, start, end, out);
+    if (n.vma.start < end && n.vma.end > start) out.push(n.vma);
+    if (n.vma.start < end) this._collect(n.right, start, end, out);
+  }
+}
+
+// ── Page-table backends ──────────────────────────────────────────────────────
+
+/**
+ * Bulk page-table operations on one page directory.  Every call covers a
+ * range of pages; counts are pages affected, -1 on failure.
+ */
+export interface PageTableBackend {
+  readonly hardware: boolean;
+  mapRange(va: number, phys: number, npages: number, flags: number): number;
+  mapAnon(va: number, npages: number, flags: number): number;
+  unmapRange(va: number, npages: number): number;
+  protectRange(va: number, npages: number, flags: number): number;
+  /** Share [va, va+npages) into `child` copy-on-write (fork). */
+  cloneInto(child: PageTableBackend, va: number, npages: number): number;
+  cowFault(va: number): number;
+  query(va: number): number;
+  count(va: number, npages: number): number;
+  /** Owned frames currently allocated by this backend (or globally, for hardware). */
+  frames(): number;
+  release(): void;
+}
+
+/** Real x86 tables through kernel.pt* (pd 0 = kernel directory). */
+class KernelPageTable implements PageTableBackend {
+  readonly hardware = true;
+  constructor(readonly pd: number) {}
+  mapRange(va: number, phys: number, n: number, flags: number): number { return kernel.ptMapRange!(this.pd, va, phys, n, flags); }
+  mapAnon(va: number, n: number, flags: number): number { return kernel.ptMapAnon!(this.pd, va, n, flags); }
+  unmapRange(va: number, n: number): number { return kernel.ptUnmapRange!(this.pd, va, n); }
+  protectRange(va: number, n: number, flags: number): number { return kernel.ptProtectRange!(this.pd, va, n, flags); }
+  cloneInto(child: PageTableBackend, va: number, n: number): number {
+    if (!(child instanceof KernelPageTable)) return -1;
+    return kernel.ptCloneCow!(child.pd, this.pd, va, n);
+  }
+  cowFault(va: number): number { return kernel.ptCowFault!(this.pd, va); }
+  query(va: number): number { return kernel.ptQuery!(this.pd, va) >>> 0; }
+  count(va: number, n: number): number { return kernel.ptCount!(this.pd, va, n); }
+  frames(): number { return kernel.ptStats ? kernel.ptStats().frames : 0; }
+  release(): void { if (this.pd && kernel.freeAddressSpace) kernel.freeAddressSpace(this.pd); }
+}
+
+/**
+ * Same two-level layout simulated with one Uint32Array per page table, for
+ * kernels without the pt* primitives.  Frames are numbered, not backed.
+ */
+class SoftPageTable implements PageTableBackend {
+  readonly hardware = false;
+  private _tables = new Map<number, Uint32Array>();
+  private _shared: Map<number, number>;       // frame → refs, only while > 1
+  private _frameCount = { n: 0 };
+  private _free: number[];
+  private _next: { n: number };
+
+  constructor(private _maxFrames: number, parent?: SoftPageTable) {
+    // Forked tables draw from the same simulated frame pool as their parent.
+    this._shared     = parent ? parent._shared : new Map();
+    this._free       = parent ? parent._free : [];
+    this._next       = parent ? parent._next : { n: 1 };
+    this._frameCount = parent ? parent._frameCount : { n: 0 };
+  }
+
+  private _table(va: number, create: boolean): Uint32Array | null {
+    var pdi = va >>> 22;
+    var t = this._tables.get(pdi) || null;
+    if (!t && create) { t = new Uint32Array(1024); this._tables.set(pdi, t); }
+    return t;
+  }
+
+  private _allocFrame(): number {
+    if (this._free.length) { this._frameCount.n++; return this._free.pop()!; }
+    if (this._next.n >= this._maxFrames) return 0;
+    this._frameCount.n++;
+    return this._next.n++;
+  }
+
+  private _put(pte: number): void {
+    if (!(pte & PTE_PRESENT) || !(pte & PTE_OWNED)) return;
+    var f = pte >>> 12, refs = this._shared.get(f);
+    if (refs !== undefined) {
+      if (refs > 2) this._shared.set(f, refs - 1); else this._shared.delete(f);
+      return;
+    }
+    this._free.push(f);
+    this._frameCount.n--;
+  }
+
+  /** Visit each page table slice of [va, va+n): fn(table|null, firstIndex, count, va). */
+  private _each(va: number, n: number, create: boolean,
+                fn: (t: Uint32Array | null, i: number, cnt: number, v: number) => boolean | void): boolean {
+    var v = va >>> 0;
+    while (n > 0) {
+      var i = (v >>> 12) & 1023, cnt = Math.min(1024 - i, n);
+      if (fn(this._table(v, create), i, cnt, v) === false) return false;
+      v += cnt * PAGE_SIZE; n -= cnt;
+    }
+    return true;
+  }
+
+  mapRange(va: number, phys: number, n: number, flags: number): number {
+    var p = (phys >>> 12), bits = (flags & (PTE_WRITE | PTE_USER | PTE_PCD)) | PTE_PRESENT, self = this;
+    this._each(va, n, true, function(t, i, cnt) {
+      for (var k = 0; k < cnt; k++) { self._put(t![i + k]); t![i + k] = ((p++ << 12) | bits) >>> 0; }
+    });
+    return n;
+  }
+
+  mapAnon(va: number, n: number, flags: number): number {
+    var bits = (flags & (PTE_WRITE | PTE_USER | PTE_PCD)) | PTE_PRESENT | PTE_OWNED, self = this, done = 0;
+    var ok = this._each(va, n, true, function(t, i, cnt) {
+      for (var k = 0; k < cnt; k++, done++) {
+        var f = self._allocFrame();
+        if (!f) return false;
+        self._put(t![i + k]);
+        t![i + k] = ((f << 12) | bits) >>> 0;
+      }
+    });
+    if (!ok) { this.unmapRange(va, done); return -1; }
+    return n;
+  }
+
+  unmapRange(va: number, n: number): number {
+    var done = 0, self = this;
+    this._each(va, n, false, function(t, i, cnt) {
+      if (!t) return;
+      for (var k = 0; k < cnt; k++) {
+        if (!(t[i + k] & PTE_PRESENT)) continue;
+        self._put(t[i + k]); t[i + k] = 0; done++;
+      }
+    });
+    return done;
+  }
+
+  protectRange(va: number, n: number, flags: number): number {
+    var want = flags & (PTE_WRITE | PTE_USER | PTE_PCD), done = 0, self = this;
+    this._each(va, n, false, function(t, i, cnt) {
+      if (!t) return;
+      for (var k = 0; k < cnt; k++) {
+        var e = t[i + k];
+        if (!(e & PTE_PRESENT)) continue;
+        e = (e & ~(PTE_WRITE | PTE_USER | PTE_PCD | PTE_COW)) | want;
+        if ((want & PTE_WRITE) && (e & PTE_OWNED) && self._shared.has(e >>> 12)) e = (e & ~PTE_WRITE) | PTE_COW;
+        t[i + k] = e >>> 0; done++;
+      }
+    });
+    return done;
+  }
+
+  cloneInto(child: PageTableBackend, va: number, n: number): number {
+    if (!(child instanceof SoftPageTable)) return -1;
+    var done = 0, self = this;
+    this._each(va, n, false, function(s, i, cnt, v) {
+      if (!s) return;
+      var d = child._table(v, true)!;
+      for (var k = 0; k < cnt; k++) {
+        var e = s[i + k];
+        if (!(e & PTE_PRESENT)) continue;
+        if (e & PTE_OWNED) {
+          var f = e >>> 12;
+          self._shared.set(f, (self._shared.get(f) || 1) + 1);
+          if (e & PTE_WRITE) { e = ((e & ~PTE_WRITE) | PTE_COW) >>> 0; s[i + k] = e; }
+        }
+        child._put(d[i + k]);
+        d[i + k] = e; done++;
+      }
+    });
+    return done;
+  }
+
+  cowFault(va: number): number {
+    var t = this._table(va, false);
+    if (!t) return 0;
+    var i = (va >>> 12) & 1023, e = t[i];
+    if (!(e & PTE_PRESENT) || !(e & PTE_COW)) return 0;
+    if (!this._shared.has(e >>> 12)) { t[i] = ((e & ~PTE_COW) | PTE_WRITE) >>> 0; return 1; }
+    var f = this._allocFrame();
+    if (!f) return -1;
+    this._put(e);
+    t[i] = ((f << 12) | (e & 0xFFF & ~PTE_COW) | PTE_WRITE) >>> 0;
+    return 1;
+  }
+
+  query(va: number): number {
+    var t = this._table(va, false);
+    return t ? t[(va >>> 12) & 1023] : 0;
+  }
+
+  count(va: number, n: number): number {
+    var c = 0;
+    this._each(va, n, false, function(t, i, cnt) {
+      if (!t) return;
+      for (var k = 0; k < cnt; k++) c += t[i + k] & PTE_PRESENT;
+    });
+    return c;
+  }
+
+  frames(): number { return this._frameCount.n; }
+
+  release(): void {
+    var self = this;
+    this._tables.forEach(function(t) { for (var k = 0; k < 1024; k++) self._put(t[k]); });
+    this._tables.clear();
+  }
+}
+
+function permFlags(permissions: MemoryRegion['permissions'], user: boolean): number {
+  return (permissions.indexOf('w') >= 0 ? PTE_WRITE : 0) | (user ? PTE_USER : 0);
+}
+
 export class VirtualMemoryManager {
-  private pageSize = 4096; // 4KB pages
-  private pageTable = new Map<number, PageTableEntry>();
-  private memoryRegions: MemoryRegion[] = [];
-  private nextVirtualAddress = 0x100000; // Start after kernel space
+  private pageSize = PAGE_SIZE; // 4KB pages
+  /** Every mapped range of this address space; page state is in `_pt`. */
+  private vmas = new VmaTree();
+  private _backend: PageTableBackend | null = null;
   private get physicalMemorySize(): number {
     // Dynamically read from the multiboot2 RAM report instead of a hardcoded value.
     return (kernel.getRamBytes && kernel.getRamBytes()) || (4 * 1024 * 1024 * 1024);
   }
-  private allocatedPhysicalPages = new Set<number>();
-  /** O(1) free-page stack: pop to allocate, push to free. */
-  private freePageStack: number[] = [];
-  private freePageStackInitialized = false;
 
   /**
    * Guard pages for expandable stacks.
@@ -96,24 +497,23 @@ export class VirtualMemoryManager {
    */
   loadFileBacking(virtualAddress: number, data: Uint8Array, fileOffset = 0): void {
     this._fileBacking.set(virtualAddress, { data, fileOffset });
-    // Eagerly fault-in all pages now that we have the data.
-    const totalPages = Math.ceil(data.length / this.pageSize);
-    for (let pg = 0; pg < totalPages; pg++) {
-      const va = virtualAddress + pg * this.pageSize;
-      const pn = Math.floor(va / this.pageSize);
-      const pte = this.pageTable.get(pn);
-      if (pte && !pte.present) {
-        const sliceStart = pg * this.pageSize;
-        const sliceEnd   = Math.min(sliceStart + this.pageSize, data.length);
-        // Allocate physical page and copy file data
-        const phys = this.allocatePhysicalPage();
-        if (phys === null) break;
-        pte.present         = true;
-        pte.physicalAddress = phys * this.pageSize;
-        // Use the write-through path: store data reference for callers that
-        // check kernel.readPhysical() (simulation only).
-        void data.subarray(sliceStart, sliceEnd);   // data resident, no copy needed in TS sim
+    const region = this.vmas.find(virtualAddress);
+    if (!region) return;
+    // Eagerly fault in every page: one mapAnon per run of unmapped pages.
+    const pt = this._pt();
+    const totalPages = Math.ceil(Math.min(data.length, region.end - virtualAddress) / this.pageSize);
+    const flags = permFlags(region.permissions, true);
+    let pg = 0;
+    while (pg < totalPages) {
+      if (pt.query(virtualAddress + pg * this.pageSize) & PTE_PRESENT) { pg++; continue; }
+      let run = 1;
+      while (pg + run < totalPages && !(pt.query(virtualAddress + (pg + run) * this.pageSize) & PTE_PRESENT)) run++;
+      if (pt.mapAnon(virtualAddress + pg * this.pageSize, run, flags) < 0) break;
+      for (let k = pg; k < pg + run; k++) {
+        this._fillPage(virtualAddress + k * this.pageSize,
+                       data.subarray(k * this.pageSize, Math.min((k + 1) * this.pageSize, data.length)));
       }
+      pg += run;
     }
   }
 
@@ -143,7 +543,11 @@ export class VirtualMemoryManager {
     return this.allocateVirtualMemory(size, permissions, false);
   }
 
-  constructor() {
+  /**
+   * @param pd    Page directory handle: 0 = kernel, else cloneAddressSpace().
+   * @param soft  Force the simulated page tables even when kernel.pt* exist.
+   */
+  constructor(readonly pd: number = 0, private _soft: boolean = false) {
     // Initialize kernel memory regions
     this.addMemoryRegion({
       start: 0x00000000,
@@ -163,31 +567,61 @@ export class VirtualMemoryManager {
     });
   }
 
+  /** True when this address space is backed by real x86 page tables. */
+  get hardwareBacked(): boolean { return this._pt().hardware; }
+
+  /** The page-table backend, chosen on first use. */
+  private _pt(): PageTableBackend {
+    if (!this._backend) {
+      this._backend = (!this._soft && typeof kernel !== 'undefined' && kernel.ptMapAnon)
+        ? new KernelPageTable(this.pd)
+        : new SoftPageTable(Math.floor(this.physicalMemorySize / this.pageSize));
+    }
+    return this._backend;
+  }
+
   /**
    * Translate virtual address to physical address
    */
   translateAddress(virtualAddress: number): { physical: number; valid: boolean; permissions: string } {
-    const pageNumber = Math.floor(virtualAddress / this.pageSize);
-    const offset = virtualAddress % this.pageSize;
-
-    const pte = this.pageTable.get(pageNumber);
-    if (!pte || !pte.present) {
+    const pte = this._pt().query(virtualAddress);
+    if (!(pte & PTE_PRESENT)) {
       return { physical: 0, valid: false, permissions: '' };
     }
 
-    const physicalAddress = pte.physicalAddress + offset;
+    const physicalAddress = (pte & PTE_HUGE)
+      ? (pte & 0xFFC00000) + (virtualAddress & 0x3FFFFF)
+      : (pte & 0xFFFFF000) + (virtualAddress & 0xFFF);
 
-    // Check permissions
+    // Check permissions (a COW share is writable — the first write copies it)
     let permissions = 'r';
-    if (pte.writable) permissions += 'w';
+    if (pte & (PTE_WRITE | PTE_COW)) permissions += 'w';
 
     return {
-      physical: physicalAddress,
+      physical: physicalAddress >>> 0,
       valid: true,
       permissions
     };
   }
 
+  /** Decode the PTE mapping `virtualAddress`, or null if it is unmapped. */
+  getPageTableEntry(virtualAddress: number): PageTableEntry | null {
+    const pte = this._pt().query(virtualAddress);
+    if (!(pte & PTE_PRESENT)) return null;
+    const huge = (pte & PTE_HUGE) !== 0;
+    const size = huge ? 0x400000 : this.pageSize;
+    return {
+      present: true,
+      writable: (pte & (PTE_WRITE | PTE_COW)) !== 0,
+      user: (pte & PTE_USER) !== 0,
+      accessed: (pte & PTE_ACCESSED) !== 0,
+      dirty: (pte & PTE_DIRTY) !== 0,
+      physicalAddress: (huge ? pte & 0xFFC00000 : pte & 0xFFFFF000) >>> 0,
+      virtualAddress: virtualAddress - (virtualAddress % size),
+      size,
+    };
+  }
+
   /**
    * Allocate virtual memory.
    *
@@ -208,32 +642,9 @@ export class VirtualMemoryManager {
       return null; // No free virtual space
     }
 
-    // Allocate physical pages
-    const physicalPages: number[] = [];
-    for (let i = 0; i < pagesNeeded; i++) {
-      const physicalPage = this.allocatePhysicalPage();
-      if (physicalPage === null) {
-        // Free already allocated pages
-        physicalPages.forEach(page => this.freePhysicalPage(page));
-        return null;
-      }
-      physicalPages.push(physicalPage);
-    }
-
-    // Create page table entries
-    for (let i = 0; i < pagesNeeded; i++) {
-      const virtualPage = Math.floor((virtualAddress + i * this.pageSize) / this.pageSize);
-      const pte: PageTableEntry = {
-        present: true,
-        writable: permissions.includes('w'),
-        user: userAccessible,
-        accessed: false,
-        dirty: false,
-        physicalAddress: physicalPages[i] * this.pageSize,
-        virtualAddress: virtualPage * this.pageSize,
-        size: this.pageSize,
-      };
-      this.pageTable.set(virtualPage, pte);
+    // One call maps the whole range; it is undone on OOM.
+    if (this._pt().mapAnon(virtualAddress, pagesNeeded, permFlags(permissions, userAccessible)) < 0) {
+      return null;
     }
 
     // Add memory region
@@ -253,26 +664,39 @@ export class VirtualMemoryManager {
    */
   freeVirtualMemory(virtualAddress: number, size: number): boolean {
     const pagesToFree = Math.ceil(size / this.pageSize);
-
-    for (let i = 0; i < pagesToFree; i++) {
-      const virtualPage = Math.floor((virtualAddress + i * this.pageSize) / this.pageSize);
-      const pte = this.pageTable.get(virtualPage);
-
-      if (pte) {
-        // Free physical page
-        const physicalPage = Math.floor(pte.physicalAddress / this.pageSize);
-        this.freePhysicalPage(physicalPage);
-
-        // Remove page table entry
-        this.pageTable.delete(virtualPage);
+    this._pt().unmapRange(virtualAddress, pagesToFree);
+
+    // Remove memory regions wholly inside the range
+    const end = virtualAddress + size;
+    const hits = this.vmas.overlapping(virtualAddress, end);
+    for (let i = 0; i < hits.length; i++) {
+      if (hits[i].start >= virtualAddress && hits[i].end <= end) {
+        this.vmas.remove(hits[i]);
+        this._fileBacking.delete(hits[i].start);
       }
     }
 
-    // Remove memory region
-    this.memoryRegions = this.memoryRegions.filter(
-      region => !(region.start >= virtualAddress && region.end <= virtualAddress + size)
-    );
+    return true;
+  }
 
+  /**
+   * Change the protection of [virtualAddress, +size) — one page-table walk
+   * in C.  Returns false if the range is not fully covered by VMAs.
+   */
+  protectVirtualMemory(virtualAddress: number, size: number, permissions: MemoryRegion['permissions']): boolean {
+    const end = virtualAddress + size;
+    const hits = this.vmas.overlapping(virtualAddress, end);
+    let covered = virtualAddress;
+    for (let i = 0; i < hits.length; i++) {
+      if (hits[i].start > covered) return false;
+      covered = Math.max(covered, hits[i].end);
+    }
+    if (covered < end) return false;
+    const user = !!(this._pt().query(virtualAddress) & PTE_USER);
+    this._pt().protectRange(virtualAddress, Math.ceil(size / this.pageSize), permFlags(permissions, user));
+    for (let i = 0; i < hits.length; i++) {
+      if (hits[i].start >= virtualAddress && hits[i].end <= end) hits[i].permissions = permissions;
+    }
     return true;
   }
 
@@ -285,20 +709,8 @@ export class VirtualMemoryManager {
 
     const pagesNeeded = Math.ceil(size / this.pageSize);
 
-    for (let i = 0; i < pagesNeeded; i++) {
-      const virtualPage = Math.floor((targetVirtual + i * this.pageSize) / this.pageSize);
-      const pte: PageTableEntry = {
-        present: true,
-        writable: true,
-        user: false, // Kernel only
-        accessed: false,
-        dirty: false,
-        physicalAddress: physicalAddress + i * this.pageSize,
-        virtualAddress: virtualPage * this.pageSize,
-        size: this.pageSize
-      };
-      this.pageTable.set(virtualPage, pte);
-    }
+    // Kernel only, uncached
+    if (this._pt().mapRange(targetVirtual, physicalAddress, pagesNeeded, PTE_WRITE | PTE_PCD) < 0) return null;
 
     this.addMemoryRegion({
       start: targetVirtual,
@@ -314,10 +726,8 @@ export class VirtualMemoryManager {
   /**
    * [Item 134] Memory-mapped file I/O with demand-paged file backing.
    *
-   * Unlike the previous anonymous-memory implementation, this version:
-   *  1. Reserves the virtual address range.
-   *  2. Creates PTEs for every page, but marks them *not-present* so that the
-   *     first access triggers a page fault.
+   *  1. Reserves the virtual address range (a file-backed VMA).
+   *  2. Maps nothing: the first access to each page faults.
    *  3. On fault (see `handlePageFault`), the correct file chunk is loaded from
    *     the registered `_fileDataProvider` and the page is made present.
    *
@@ -331,15 +741,12 @@ export class VirtualMemoryManager {
     virtualAddress?: number,
     data?: Uint8Array,
   ): number | null {
-    const targetVirtual = virtualAddress ?? this.findFreeVirtualSpace(size);
-    if (targetVirtual === null) return null;
-
     // Round up to page boundary
     const pageCount = Math.ceil(size / this.pageSize);
+    const targetVirtual = virtualAddress ?? this.findFreeVirtualSpace(pageCount * this.pageSize);
+    if (targetVirtual === null) return null;
 
-    // Don't use allocateVirtualMemory so we can control the exact address.
-    // Instead, manually insert the region and create not-present PTEs.
-    this.memoryRegions.push({
+    this.addMemoryRegion({
       start:          targetVirtual,
       end:            targetVirtual + pageCount * this.pageSize,
       permissions:    'rw',
@@ -349,22 +756,6 @@ export class VirtualMemoryManager {
       fileOffset:     offset,
     });
 
-    // Create not-present PTEs — these will be demand-faulted in.
-    for (let pg = 0; pg < pageCount; pg++) {
-      const va = targetVirtual + pg * this.pageSize;
-      const pn = Math.floor(va / this.pageSize);
-      this.pageTable.set(pn, {
-        present:         false,  // demand paging — not yet in RAM
-        writable:        true,
-        user:            true,
-        accessed:        false,
-        dirty:           false,
-        physicalAddress: 0,
-        virtualAddress:  va,
-        size:            this.pageSize,
-      });
-    }
-
     // If the caller handed us the data, fault in all pages immediately.
     if (data) {
       this.loadFileBacking(targetVirtual, data, offset);
@@ -396,16 +787,16 @@ export class VirtualMemoryManager {
   ): boolean {
     const effectiveRing = forceRing ?? this._currentRing;
     const pageSize = this.pageSize;
+    const pt = this._pt();
     for (let addr = virtualAddress; addr < virtualAddress + size; addr += pageSize) {
-      const pageNumber = Math.floor(addr / pageSize);
-      const pte = this.pageTable.get(pageNumber);
-      if (!pte || !pte.present) return false;
+      const pte = pt.query(addr);
+      if (!(pte & PTE_PRESENT)) return false;
 
       // Privilege check: ring-3 cannot touch kernel-only pages.
-      if (effectiveRing === 3 && !pte.user) return false;
+      if (effectiveRing === 3 && !(pte & PTE_USER)) return false;
 
-      // Write-permission check.
-      if (write && !pte.writable) return false;
+      // Write-permission check (COW shares are writable after the fault).
+      if (write && !(pte & (PTE_WRITE | PTE_COW))) return false;
     }
     return true;
   }
@@ -437,21 +828,7 @@ export class VirtualMemoryManager {
     const stackBase = stackTop - initialSize;      // lowest committed address
 
     // Commit initial pages.
-    for (let offset = 0; offset < initialSize; offset += this.pageSize) {
-      const phys = this.allocatePhysicalPage();
-      if (phys === null) return null; // OOM — partial cleanup omitted for brevity
-      const vpn = Math.floor((stackBase + offset) / this.pageSize);
-      this.pageTable.set(vpn, {
-        present: true,
-        writable: true,
-        user: true,
-        accessed: false,
-        dirty: false,
-        physicalAddress: phys * this.pageSize,
-        virtualAddress: vpn * this.pageSize,
-        size: this.pageSize,
-      });
-    }
+    if (this._pt().mapAnon(stackBase, initialSize / this.pageSize, PTE_WRITE | PTE_USER) < 0) return null;
 
     // Register the guard page (one page below the current stack base).
     const guardVA  = stackBase - this.pageSize;
@@ -459,9 +836,9 @@ export class VirtualMemoryManager {
     const minStack = reserveBase + this.pageSize; // never grow below this
     this.stackGuards.set(guardVPN, { regionStart: stackBase, minStack });
 
-    // Record the committed region.
+    // Record the region, growth area included, so nothing else lands there.
     this.addMemoryRegion({
-      start: stackBase,
+      start: reserveBase,
       end: stackTop,
       permissions: 'rw',
       type: 'stack',
@@ -475,124 +852,112 @@ export class VirtualMemoryManager {
    * Handle page fault.
    *
    * Behaviour:
-   * 1. If the fault is on a registered guard page, commit the page and slide
-   *    the guard down (stack growth). Returns `true` on success.
-   * 2. If the PTE exists but `present` is false (e.g. swapped-out page),
-   *    mark it present and return `true`.
-   * 3. Any other fault returns `false` (caller should panic/kill process).
+   * 1. A write to a copy-on-write share copies (or reclaims) the frame.
+   * 2. If the fault is on a registered guard page, commit the page and slide
+   *    the guard down (stack growth).
+   * 3. A not-present page inside a file-backed VMA is demand-loaded; inside
+   *    an anonymous VMA it is demand-zeroed.
+   * 4. Any other fault returns `false` (caller should panic/kill process).
    */
-  handlePageFault(virtualAddress: number): boolean {
+  handlePageFault(virtualAddress: number, write = false): boolean {
     const pageNumber = Math.floor(virtualAddress / this.pageSize);
-    const pte = this.pageTable.get(pageNumber);
-
-    // ── Case 1: guard-page hit → extend stack downward ──────────────────────
-    if (!pte) {
-      const guard = this.stackGuards.get(pageNumber);
-      if (guard) {
-        const newPageVA = pageNumber * this.pageSize;
-
-        // Enforce the hard floor (prevents infinite stack overflow).
-        if (newPageVA < guard.minStack) {
-          // Stack overflow — cannot grow further.
-          return false;
-        }
+    const pageVA = pageNumber * this.pageSize;
+    const pt = this._pt();
+    const pte = pt.query(virtualAddress);
 
-        // Commit a fresh physical page for this virtual page.
-        const phys = this.allocatePhysicalPage();
-        if (phys === null) return false; // OOM
-
-        this.pageTable.set(pageNumber, {
-          present: true,
-          writable: true,
-          user: true,
-          accessed: false,
-          dirty: false,
-          physicalAddress: phys * this.pageSize,
-          virtualAddress: newPageVA,
-          size: this.pageSize,
-        });
-
-        // Slide the guard page one page lower.
-        this.stackGuards.delete(pageNumber);
-        const nextGuardVPN = pageNumber - 1;
-        if (nextGuardVPN * this.pageSize >= guard.minStack) {
-          this.stackGuards.set(nextGuardVPN, { ...guard, regionStart: newPageVA });
-        }
+    // ── Case 1: write to a COW share ────────────────────────────────────────
+    if (pte & PTE_PRESENT) {
+      return write && (pte & PTE_COW) !== 0 && pt.cowFault(pageVA) === 1;
+    }
 
-        // Expand the recorded stack region to include the newly committed page.
-        const region = this.memoryRegions.find(
-          r => r.type === 'stack' && r.start === guard.regionStart,
-        );
-        if (region) {
-          region.start = newPageVA;
-          guard.regionStart = newPageVA;
-        }
+    // ── Case 2: guard-page hit → extend stack downward ──────────────────────
+    const guard = this.stackGuards.get(pageNumber);
+    if (guard) {
+      // Enforce the hard floor (prevents infinite stack overflow).
+      if (pageVA < guard.minStack) return false;
 
-        return true; // fault handled — retry the faulting instruction
-      }
+      // Commit a fresh physical page for this virtual page.
+      if (pt.mapAnon(pageVA, 1, PTE_WRITE | PTE_USER) < 0) return false; // OOM
 
-      // Not a guard page — true unmapped-memory fault.
-      return false;
+      // Slide the guard page one page lower.
+      this.stackGuards.delete(pageNumber);
+      const nextGuardVPN = pageNumber - 1;
+      if (nextGuardVPN * this.pageSize >= guard.minStack) {
+        this.stackGuards.set(nextGuardVPN, { ...guard, regionStart: pageVA });
+      }
+      return true; // fault handled — retry the faulting instruction
     }
 
-    // ── Case 2: page present in table but marked not-present ────────────────
-    // This is either a demand-paged file-backed page or a swapped-out page.
-    if (!pte.present) {
-      // Find which memory region this page belongs to.
-      const faultVA = virtualAddress;
-      const region  = this.memoryRegions.find(r => r.start <= faultVA && faultVA < r.end);
-
-      // ── [Item 135] File-backed demand paging ──────────────────────────────
-      if (region && region.backingStore === 'file') {
-        const fd         = region.fileDescriptor ?? -1;
-        const baseOffset = region.fileOffset ?? 0;
-        const pageVA     = pageNumber * this.pageSize;
-        const pageIntoRegion = pageVA - region.start;
-        const fileOffset = baseOffset + pageIntoRegion;
-
-        // Try in-memory backing first (already loaded via loadFileBacking).
-        const backing = this._fileBacking.get(region.start);
-        let pageData: Uint8Array | null = null;
-
-        if (backing) {
-          const sliceStart = pageIntoRegion;
-          const sliceEnd   = Math.min(sliceStart + this.pageSize, backing.data.length);
-          if (sliceStart < backing.data.length) {
-            pageData = backing.data.subarray(sliceStart, sliceEnd);
-          }
-        }
-
-        if (!pageData && this._fileDataProvider && fd >= 0) {
-          // [Item 135] Demand-load the page from disk through the provider.
-          pageData = this._fileDataProvider(fd, fileOffset, this.pageSize);
-        }
-
-        // Allocate a physical page, mark present, and (logically) copy data.
-        const phys = this.allocatePhysicalPage();
-        if (phys === null) return false; // OOM
+    // ── Case 3: demand paging inside a VMA ──────────────────────────────────
+    const region = this.vmas.find(virtualAddress);
+    if (!region || region.backingStore === 'physical' || region.type === 'stack') return false;
+
+    // ── [Item 135] File-backed demand paging ────────────────────────────────
+    let pageData: Uint8Array | null = null;
+    if (region.backingStore === 'file') {
+      const fd             = region.fileDescriptor ?? -1;
+      const pageIntoRegion = pageVA - region.start;
+      const fileOffset     = (region.fileOffset ?? 0) + pageIntoRegion;
+
+      // Try in-memory backing first (already loaded via loadFileBacking).
+      const backing = this._fileBacking.get(region.start);
+      if (backing && pageIntoRegion < backing.data.length) {
+        pageData = backing.data.subarray(pageIntoRegion, Math.min(pageIntoRegion + this.pageSize, backing.data.length));
+      }
+      if (!pageData && this._fileDataProvider && fd >= 0) {
+        // [Item 135] Demand-load the page from disk through the provider.
+        pageData = this._fileDataProvider(fd, fileOffset, this.pageSize);
+      }
+    }
 
-        pte.present         = true;
-        pte.physicalAddress = phys * this.pageSize;
-        // In the TypeScript simulation the data is referenced (not byte-copied),
-        // but the PTE is now present so the access proceeds correctly.
-        void pageData; // data available to hardware layer via phys page
+    // Anonymous VMA: demand-zero page (frames come zeroed).
+    if (pt.mapAnon(pageVA, 1, permFlags(region.permissions, true)) < 0) return false; // OOM
+    if (pageData) this._fillPage(pageVA, pageData);
+    return true;
+  }
 
-        return true; // fault handled
+  /**
+   * fork(): a new address space whose VMAs are copies of this one's and
+   * whose pages are shared copy-on-write — one kernel.ptCloneCow() per VMA,
+   * no per-page work in JS.
+   *
+   * @param childPd  The child's page directory (cloneAddressSpace()).
+   */
+  fork(childPd: number): VirtualMemoryManager {
+    const child = new VirtualMemoryManager(childPd, !this.hardwareBacked);
+    child.vmas = new VmaTree();
+    const pt = this._pt();
+    if (!pt.hardware) {
+      child._backend = new SoftPageTable(Math.floor(this.physicalMemorySize / this.pageSize), pt as SoftPageTable);
+    }
+    const cpt = child._pt();
+    const list = this.vmas.toArray();
+    for (let i = 0; i < list.length; i++) {
+      const r = list[i];
+      child.vmas.insert({ ...r });
+      if (r.backingStore !== 'physical' || r.type === 'mmio') {
+        pt.cloneInto(cpt, r.start, Math.ceil((r.end - r.start) / this.pageSize));
       }
-
-      // ── Swap-in path (non-file-backed not-present page) ──────────────────
-      // Allocate a fresh physical page and mark it present.
-      const phys = this.allocatePhysicalPage();
-      if (phys !== null) {
-        pte.present         = true;
-        pte.physicalAddress = phys * this.pageSize;
-      } else {
-        pte.present = true; // best-effort when OOM
+    }
+    this.stackGuards.forEach((g, vpn) => child.stackGuards.set(vpn, { ...g }));
+    this._fileBacking.forEach((b, va) => child._fileBacking.set(va, b));
+    child._fileDataProvider = this._fileDataProvider;
+    return child;
+  }
+
+  /** Tear the address space down (process exit). */
+  destroy(): void {
+    const list = this.vmas.toArray();
+    const pt = this._pt();
+    for (let i = 0; i < list.length; i++) {
+      if (list[i].backingStore !== 'physical') {
+        pt.unmapRange(list[i].start, Math.ceil((list[i].end - list[i].start) / this.pageSize));
       }
-      return true;
     }
-
-    return false;
+    pt.release();
+    this.vmas = new VmaTree();
+    this.stackGuards.clear();
+    this._fileBacking.clear();
   }
 
   /**
@@ -606,14 +971,20 @@ export class VirtualMemoryManager {
     mappedPages: number;
   } {
     const totalPages = Math.floor(this.physicalMemorySize / this.pageSize);
-    const usedPages = this.allocatedPhysicalPages.size;
+    const pt = this._pt();
+    const usedPages = pt.frames();
+    let mapped = 0;
+    const list = this.vmas.toArray();
+    for (let i = 0; i < list.length; i++) {
+      mapped += pt.count(list[i].start, Math.ceil((list[i].end - list[i].start) / this.pageSize));
+    }
 
     return {
       totalPhysical: this.physicalMemorySize,
       usedPhysical: usedPages * this.pageSize,
       freePhysical: (totalPages - usedPages) * this.pageSize,
       totalVirtual: 0xFFFFFFFF, // 4GB address space
-      mappedPages: this.pageTable.size
+      mappedPages: mapped
     };
   }
 
@@ -621,74 +992,31 @@ export class VirtualMemoryManager {
    * Add a memory region
    */
   private addMemoryRegion(region: MemoryRegion): void {
-    this.memoryRegions.push(region);
-    this.memoryRegions.sort((a, b) => a.start - b.start);
+    this.vmas.insert(region);
   }
 
   /**
-   * Find free virtual address space
+   * Find free virtual address space — first fit in the interval tree.
    */
   private findFreeVirtualSpace(size: number): number | null {
-    // Simple first-fit algorithm
-    let current = this.nextVirtualAddress;
-
-    while (current < 0xC0000000) { // Don't go into kernel space
-      const conflict = this.memoryRegions.find(
-        region => (current >= region.start && current < region.end) ||
-                 (current + size > region.start && current + size <= region.end) ||
-                 (current <= region.start && current + size >= region.end)
-      );
-
-      if (!conflict) {
-        this.nextVirtualAddress = current + size;
-        return current;
-      }
-
-      current = conflict.end;
-    }
-
-    return null;
-  }
-
-  /**
-   * Lazily initialise the free-page stack on first allocation.
-   * Pushes all unallocated page numbers so pop() gives O(1) alloc.
-   */
-  private ensureFreePageStack(): void {
-    if (this.freePageStackInitialized) return;
-    this.freePageStackInitialized = true;
-    const totalPages = Math.floor(this.physicalMemorySize / this.pageSize);
-    for (let i = totalPages - 1; i >= 0; i--) {
-      if (!this.allocatedPhysicalPages.has(i)) {
-        this.freePageStack.push(i);
-      }
-    }
+    return this.vmas.firstFit(size, VMM_VA_BASE, VMM_VA_LIMIT);
   }
 
-  /**
-   * Allocate a physical page — O(1) via free-page stack.
-   */
-  private allocatePhysicalPage(): number | null {
-    this.ensureFreePageStack();
-    if (this.freePageStack.length === 0) return null;
-    const page = this.freePageStack.pop()!;
-    this.allocatedPhysicalPages.add(page);
-    return page;
-  }
-
-  /**
-   * Free a physical page — O(1) push back onto stack.
-   */
-  private freePhysicalPage(pageNumber: number): void {
-    this.allocatedPhysicalPages.delete(pageNumber);
-    this.freePageStack.push(pageNumber);
+  /** Copy up to one page of `data` into the frame now mapped at `pageVA`. */
+  private _fillPage(pageVA: number, data: Uint8Array): void {
+    const pte = this._pt().query(pageVA);
+    if (!this._pt().hardware || !(pte & PTE_PRESENT) || !data.length || !kernel.writePhysMem) return;
+    const copy = data.byteOffset === 0 && data.byteLength === data.buffer.byteLength
+      ? data.buffer as ArrayBuffer
+      : data.slice().buffer as ArrayBuffer;
+    kernel.writePhysMem((pte & 0xFFFFF000) >>> 0, copy);
   }
 
   /**
    * Get memory regions
    */
   getMemoryRegions(): MemoryRegion[] {
-    return [...this.memoryRegions];
+    return this.vmas.toArray();
   }
 
   // ── Phase 4: real paging (hardware page table support) ─────────────────
@@ -757,6 +1085,10 @@ export const vmm = new VirtualMemoryManager();
  *   - kernel.cloneAddressSpace() → physAddr of new PD (copies kernel PDEs)
  *   - kernel.setPDPT(physAddr) → writes physAddr to CR3, flushes TLB
  *   - kernel.flushTLB() → invalidates TLB without changing CR3
+ *   - kernel.freeAddressSpace(physAddr) → drops the PD and its mappings
+ *
+ * Each PD has a VirtualMemoryManager (vmFor) and fork() clones the parent's
+ * copy-on-write (forkFrom).
  *
  * Lifetime: created on fork, destroyed on process exit.  Max 32 concurrent
  * address spaces (_user_pds[32] in quickjs_binding.c).
@@ -764,6 +1096,8 @@ export const vmm = new VirtualMemoryManager();
 export class ProcessAddressSpace {
   /** Map from PID → physical address of the process's page directory. */
   private _pdAddrs: Map<number, number> = new Map();
+  /** Map from PID → the VMM managing that directory's VMAs. */
+  private _vms: Map<number, VirtualMemoryManager> = new Map();
   /** The master kernel PD physical address (PID 1). */
   private _kernelPD: number = 0;
   /** Currently active PID (whose PD is loaded in CR3). */
@@ -804,6 +1138,36 @@ export class ProcessAddressSpace {
     return true;
   }
 
+  /**
+   * The VMM for `pid`'s address space, created on first use.  Processes
+   * without their own PD get simulated tables so they never touch the
+   * kernel directory.
+   */
+  vmFor(pid: number): VirtualMemoryManager {
+    var vm = this._vms.get(pid);
+    if (!vm) {
+      var pd = this.getPDPhysAddr(pid);
+      vm = new VirtualMemoryManager(pd, pd === 0);
+      this._vms.set(pid, vm);
+    }
+    return vm;
+  }
+
+  /**
+   * fork(): create the child's PD and share the parent's pages into it
+   * copy-on-write.  The child's VMM is a fork() of the parent's (created
+   * empty if the parent never mapped anything), so a parent on simulated
+   * tables has a simulated child.  Returns false if the child could not get
+   * an address space.
+   */
+  forkFrom(parentPid: number, childPid: number): boolean {
+    var hasPD = this.createForProcess(childPid);
+    var parent = this.vmFor(parentPid);
+    if (parent.hardwareBacked && !hasPD) return false;
+    this._vms.set(childPid, parent.fork(this.getPDPhysAddr(childPid)));
+    return true;
+  }
+
   /**
    * Switch to the process's address space by writing its PD to CR3.
    * If the process has no dedicated PD (PID 1 or paging disabled), this
@@ -822,14 +1186,18 @@ export class ProcessAddressSpace {
   }
 
   /**
-   * Release the address space for a terminated process.
-   * The PD slot in _user_pds[] is freed for reuse.
+   * Release the address space for a terminated process: its VMAs, every
+   * page-table mapping and the PD slot in _user_pds[].
    */
   destroyForProcess(pid: number): void {
+    var vm = this._vms.get(pid);
+    this._vms.delete(pid);
+    var pd = this._pdAddrs.get(pid);
     this._pdAddrs.delete(pid);
-    // NOTE: The C-side _user_pd_used[] flag should also be cleared.
-    // This requires a kernel binding (kernel.freeAddressSpace(pdPhys))
-    // which will be added in a follow-up Phase 9 patch.
+    if (vm) vm.destroy();                      // frees a hardware PD through its backend
+    if ((!vm || !vm.hardwareBacked) && pd && typeof kernel !== 'undefined' && kernel.freeAddressSpace) {
+      kernel.freeAddressSpace(pd);
+    }
   }
 
   /** Return the PD physical address for a process, or 0 if none. */
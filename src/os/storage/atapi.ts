@@ -0,0 +1,136 @@
+/**
+ * JSOS ATAPI CD/DVD device
+ *
+ * Packet command layer over kernel.atapiPacket(), which sends one 12-byte
+ * CDB and PIO-reads its whole data phase — up to 64 KB, i.e. 32 CD sectors,
+ * however many DRQ blocks the drive splits it into — straight into the
+ * caller's buffer.  A long read is therefore one packet per 64 KB instead
+ * of one per sector, with no intermediate copies.
+ *
+ * READ(10) is used first; a drive that answers ILLEGAL REQUEST is switched
+ * to READ(12) for the rest of the session.  UNIT ATTENTION (media change,
+ * reset) is cleared with REQUEST SENSE and the packet retried once.
+ */
+
+import { ISO9660FS, type ISO9660Device } from '../fs/iso9660.js';
+
+declare var kernel: import('../core/kernel.js').KernelAPI;
+
+export const CD_SECTOR_SIZE    = 2048;
+/** Sectors per packet: the kernel moves at most 64 KB per data phase. */
+export const ATAPI_MAX_SECTORS = 32;
+
+const CMD_REQUEST_SENSE  = 0x03;
+const CMD_READ_CAPACITY  = 0x25;
+const CMD_READ_10        = 0x28;
+const CMD_READ_12        = 0xA8;
+
+const SENSE_ILLEGAL_REQUEST = 0x05;
+const SENSE_UNIT_ATTENTION  = 0x06;
+
+export interface AtapiSense { key: number; asc: number; ascq: number; }
+
+export class AtapiDevice implements ISO9660Device {
+  readonly sectorSize = CD_SECTOR_SIZE;
+  /** Last LBA + 1 from READ CAPACITY (0 until readCapacity() succeeds). */
+  sectorCount = 0;
+  /** Sense data of the last failed packet. */
+  lastSense: AtapiSense | null = null;
+  /** Packets sent and data bytes received, for `iostat`-style reporting. */
+  stats = { packets: 0, bytes: 0, errors: 0 };
+
+  private _cdb   = new Uint8Array(12);
+  private _sense = new Uint8Array(18);
+  private _cap   = new Uint8Array(8);
+  private _use12 = false;
+
+  static present(): boolean {
+    return typeof kernel.atapiPacket === 'function' &&
+           typeof kernel.ataIsAtapi === 'function' && kernel.ataIsAtapi() === 1;
+  }
+
+  /** READ CAPACITY: number of sectors on the medium, or 0 (no disc). */
+  readCapacity(): number {
+    // the first packet after a media change reports UNIT ATTENTION
+    for (var attempt = 0; ; attempt++) {
+      if (this._send(this._clear(CMD_READ_CAPACITY), this._cap) >= 8) break;
+      var s = this.requestSense();
+      if (attempt > 0 || !s || s.key !== SENSE_UNIT_ATTENTION) return 0;
+    }
+    var b = this._cap;
+    var last = ((b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3]) >>> 0;
+    return this.sectorCount = last + 1;
+  }
+
+  /**
+   * Read `count` sectors from `lba` into `dst` at byte offset `off`, one
+   * packet per ATAPI_MAX_SECTORS.  Returns false on a device error.
+   */
+  readSectors(lba: number, count: number, dst: Uint8Array, off: number = 0): boolean {
+    while (count > 0) {
+      var n = count < ATAPI_MAX_SECTORS ? count : ATAPI_MAX_SECTORS;
+      var into = dst.subarray(off, off + n * CD_SECTOR_SIZE);
+      if (!this._read(lba, n, into)) return false;
+      lba += n; count -= n; off += n * CD_SECTOR_SIZE;
+    }
+    return true;
+  }
+
+  /** ISO9660Device: one sector in a fresh buffer (zeros on error). */
+  readSector(lba: number): Uint8Array {
+    var out = new Uint8Array(CD_SECTOR_SIZE);
+    this._read(lba, 1, out);
+    return out;
+  }
+
+  private _read(lba: number, n: number, into: Uint8Array): boolean {
+    for (var attempt = 0; attempt < 3; attempt++) {
+      var c = this._clear(this._use12 ? CMD_READ_12 : CMD_READ_10);
+      c[2] = lba >>> 24; c[3] = lba >>> 16; c[4] = lba >>> 8; c[5] = lba;
+      if (this._use12) { c[8] = n >>> 8; c[9] = n; }
+      else             { c[7] = n >>> 8; c[8] = n; }
+      if (this._send(c, into) === n * CD_SECTOR_SIZE) return true;
+      var s = this.requestSense();
+      if (!s) return false;
+      if (s.key === SENSE_ILLEGAL_REQUEST && !this._use12) { this._use12 = true; continue; }
+      if (s.key !== SENSE_UNIT_ATTENTION) return false;
+    }
+    return false;
+  }
+
+  /** REQUEST SENSE after a failed packet; also stored in lastSense. */
+  requestSense(): AtapiSense | null {
+    var c = this._clear(CMD_REQUEST_SENSE);
+    c[4] = this._sense.length;
+    if (kernel.atapiPacket!(c, this._sense) < 14) return null;
+    var b = this._sense;
+    return this.lastSense = { key: b[2] & 0x0f, asc: b[12], ascq: b[13] };
+  }
+
+  private _clear(op: number): Uint8Array {
+    var c = this._cdb;
+    c.fill(0);
+    c[0] = op;
+    return c;
+  }
+
+  private _send(cdb: Uint8Array, buf: Uint8Array): number {
+    var got = kernel.atapiPacket!(cdb, buf);
+    this.stats.packets++;
+    if (got < 0) { this.stats.errors++; return got; }
+    this.stats.bytes += got;
+    return got;
+  }
+}
+
+/**
+ * The disc in the primary ATAPI drive as an ISO 9660 filesystem, or null
+ * when there is no drive, no medium or no ISO 9660 volume.
+ */
+export function openCdrom(mountpoint: string = '/cdrom'): ISO9660FS | null {
+  if (!AtapiDevice.present()) return null;
+  var dev = new AtapiDevice();
+  if (!dev.readCapacity()) return null;
+  var iso = new ISO9660FS(dev, mountpoint);
+  return iso.ready ? iso : null;
+}
@@ -11,10 +11,17 @@
  *   809 — HTML tokeniser / parser
  *   810 — TCP state machine
  *
+ * plus regression cases for poll() over pipe rings, overlayfs root and
+ * file/directory conflicts, and copy-on-write address-space fork.
+ *
  * Run: node build/js/test/suite.js  (after bundling)
  * Or:  import and call runAll() from the OS REPL.
  */
 
+import { Pipe, pipeAsFd, poll, POLLIN } from '../ipc/ipc.js';
+import { OverlayFS, MemoryUpperLayer } from '../fs/overlayfs.js';
+import { ProcessAddressSpace, VmaTree } from '../process/vmm.js';
+
 // ── Micro test harness ──────────────────────────────────────────────────────
 
 let _passed = 0, _failed = 0;
@@ -399,6 +406,94 @@ test('TCP: RST from SYN_SENT', () => {
   expect(s, 'CLOSED', 'RST resets to CLOSED');
 });
 
+// ── poll() ──────────────────────────────────────────────────────────────────
+
+/** Run `fn` against a virtual clock when there is no kernel (node). */
+function withClock(fn: (now: () => number) => void): void {
+  const g = globalThis as any;
+  if (g.kernel) { fn(() => g.kernel.getUptime()); return; }
+  let t = 0;
+  g.kernel = { getUptime: () => t, getTicks: () => t, sleep: (ms: number) => { t += ms; } };
+  try { fn(() => t); } finally { delete g.kernel; }
+}
+
+test('poll: POLLIN on an empty writable pipe waits out the timeout', () => {
+  withClock(now => {
+    const pipe = new Pipe(3, 4);
+    const fds = [{ fd: pipeAsFd(pipe), events: POLLIN, revents: 0 }];
+    const t0 = now();
+    expect(poll(fds, 20), 0, 'nothing ready');
+    expectTrue(now() - t0 >= 20, 'blocked until the timeout');
+    pipe.write('x');
+    expect(poll(fds, 20), 1, 'ready once written');
+    expect(fds[0].revents, POLLIN, 'revents');
+  });
+});
+
+// ── overlayfs ───────────────────────────────────────────────────────────────
+
+test('overlayfs: root-level files in upper and lower layers', () => {
+  const ov = new OverlayFS(new MemoryUpperLayer());
+  expect(ov.write('/x', 'y'), 0, 'write');
+  expect(ov.read('/x'), 'y', 'upper-only read');
+  ov.invalidate();
+  expect(ov.read('/x'), 'y', 'after invalidate');
+  const lower = new MemoryUpperLayer();
+  lower.write('/l', 'low');
+  ov.pushLower(lower);
+  expect(ov.read('/l'), 'low', 'lower root file');
+  expect(ov.list('/').map(e => e.name).sort(), ['l', 'x'], 'merged root');
+});
+
+test('overlayfs: writes below a file fail with ENOTDIR', () => {
+  const lower = new MemoryUpperLayer();
+  lower.write('/f', 'low');
+  const ov = new OverlayFS(new MemoryUpperLayer(), lower);
+  expect(ov.write('/f/g', 'z'), -20, 'write below a lower file');
+  expect(ov.mkdir('/f/d'), -20, 'mkdir below a lower file');
+  ov.write('/u', 'up');
+  expect(ov.write('/u/g', 'z'), -20, 'write below an upper file');
+  expectTrue(!ov.isDirectory('/f') && !ov.isDirectory('/u'), 'still files');
+  expect(ov.read('/f'), 'low', 'lower file intact');
+  ov.invalidate();
+  expect(ov.read('/f'), 'low', 'same after a cold rebuild');
+});
+
+// ── Address spaces ──────────────────────────────────────────────────────────
+
+test('vmm: fork shares mapped pages copy-on-write', () => {
+  withClock(() => {
+    const pas = new ProcessAddressSpace();
+    const parent = pas.vmFor(40);
+    const a = parent.allocateVirtualMemory(3 * 4096, 'rw')!;
+    expectTrue(a !== null, 'parent mmap');
+    expectTrue(pas.forkFrom(40, 41), 'fork');
+    const child = pas.vmFor(41);
+    const p0 = parent.translateAddress(a + 4096), c0 = child.translateAddress(a + 4096);
+    expectTrue(c0.valid, 'child sees the page');
+    expect(c0.physical, p0.physical, 'same frame before a write');
+    expectTrue(child.handlePageFault(a + 4096, true), 'write fault handled');
+    const c1 = child.translateAddress(a + 4096);
+    expectTrue(c1.valid && c1.physical !== p0.physical, 'child got its own copy');
+    expect(parent.translateAddress(a + 4096).physical, p0.physical, 'parent frame unchanged');
+    expect(child.translateAddress(a).physical, parent.translateAddress(a).physical, 'untouched page still shared');
+    pas.destroyForProcess(41);
+    pas.destroyForProcess(40);
+  });
+});
+
+test('vmm: first-fit skips full runs and finds holes', () => {
+  const t = new VmaTree();
+  const region = (start: number, end: number) =>
+    ({ start, end, permissions: 'rw' as const, type: 'heap' as const });
+  for (let i = 0; i < 64; i++) if (i !== 40) t.insert(region(i * 0x1000, (i + 1) * 0x1000));
+  expect(t.firstFit(0x1000, 0, 0x100000), 40 * 0x1000, 'single hole');
+  expect(t.firstFit(0x2000, 0, 0x100000), 64 * 0x1000, 'too small: after the last VMA');
+  expect(t.firstFit(0x1000, 41 * 0x1000, 0x100000), 64 * 0x1000, 'hole below lo is ignored');
+  expect(t.firstFit(0x1000, 0, 64 * 0x1000), 40 * 0x1000, 'within hi');
+  expect(t.firstFit(0x2000, 0, 65 * 0x1000), null, 'no room before hi');
+});
+
 // ── Runner ──────────────────────────────────────────────────────────────────
 
 export function runAll(): void {
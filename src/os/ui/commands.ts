@@ -32,7 +32,7 @@ import { launchImageViewer } from '../apps/image-viewer/index.js';
 import { launchCalendar } from '../apps/calendar/index.js';
 import { wm, getWM, type App } from '../ui/wm.js';
 import { scheduler } from '../process/scheduler.js';
-import { vmm } from '../process/vmm.js';
+import { vmm, VirtualMemoryManager } from '../process/vmm.js';
 import { init } from '../process/init.js';
 import { procFS } from '../fs/proc.js';
 import { users } from '../users/users.js';
@@ -43,14 +43,23 @@ import { fat32 } from '../storage/fat32.js';
 import { globalFDTable } from '../core/fdtable.js';
 import { syscalls } from '../core/syscalls.js';
 import { processManager } from '../process/process.js';
-import { threadManager } from '../process/threads.js';
+import { threadManager, ThreadManager } from '../process/threads.js';
 import { physAlloc } from '../process/physalloc.js';
+import { IoUring, IoUringOp, IoUringDev, IOSQE_FIXED_FILE } from '../process/asyncio.js';
 import { JSProcess, listProcesses } from '../process/jsprocess.js';
 import { os } from '../core/sdk.js';
 import { systemProfiler } from '../process/optimizer.js';
 import { layoutProfiler } from '../apps/browser/layout.js';
 import { JITChecksum, JITMem, JITCRC32, JITOSKernels } from '../process/jit-os.js';
 import { dnsResolve } from '../net/dns.js';
+import { CompressedBlockDevice, type CompressionAlgorithm } from '../fs/fscompression.js';
+import type { BlockDevice } from '../fs/blockdev.js';
+import { OverlayFS, MemoryUpperLayer } from '../fs/overlayfs.js';
+import { FileData } from '../fs/filedata.js';
+import { CowFS, AtaDiskDevice } from '../fs/cowfs.js';
+import { SimpleArrayBlockDevice } from '../fs/ext4.js';
+import { jpegCodec } from '../apps/browser/img-jpeg.js';
+import { pngCodec } from '../apps/browser/img-png.js';
 import { pkgmgr } from '../core/pkgmgr.js';
 
 declare var kernel: import('../core/kernel.js').KernelAPI;
@@ -98,7 +107,7 @@ export function registerCommands(g: any): void {
   g.ipc   = ipc;
   g.net   = net;
 
-  // Persistent disk (FAT32 / FAT16)
+  // Persistent disk (CoW / FAT32 / FAT16)
   g.disk = {
     ls(path?: string) {
       var p = path || '/';
@@ -142,6 +151,25 @@ export function registerCommands(g: any): void {
       terminal.println(ok ? '[disk] Formatted and mounted' : '[disk] Format failed');
       return ok;
     },
+    // CoW filesystem
+    mkcowfs(label?: string) {
+      if (!kernel.ataPresent()) { terminal.println('[disk] No disk attached'); return false; }
+      var dev = new AtaDiskDevice();
+      var cow = new CowFS(dev, dev.sizeBytes, '/disk');
+      if (!cow.format(label || 'JSDISK')) { terminal.println('[disk] mkcowfs failed'); return false; }
+      if (g._diskFS) fs.unmountVFS('/disk');
+      fs.mountVFS('/disk', cow);
+      g._diskFS = cow;
+      terminal.println('[disk] CoW filesystem created and mounted at /disk');
+      return true;
+    },
+    sync() { return g._diskFS instanceof CowFS ? (g._diskFS as CowFS).fsync() : 0; },
+    snapshot(name: string, readonly?: boolean) {
+      return g._diskFS instanceof CowFS ? (g._diskFS as CowFS).snapshot(name, readonly !== false) : false;
+    },
+    snapshots() { return g._diskFS instanceof CowFS ? (g._diskFS as CowFS).snapshots() : []; },
+    rmsnapshot(name: string) { return g._diskFS instanceof CowFS ? (g._diskFS as CowFS).deleteSnapshot(name) : false; },
+    rollback(name: string) { return g._diskFS instanceof CowFS ? (g._diskFS as CowFS).rollback(name) : false; },
   };
 
   // Low-level filesystem API
@@ -627,7 +655,13 @@ export function registerCommands(g: any): void {
     var kthreads = threadManager.getThreads();
     for (var _j = 0; _j < kthreads.length; _j++) {
       var kt = kthreads[_j];
-      results.push({ pid: kt.tid, ppid: 0, name: '[' + kt.name + ']', state: kt.state, priority: kt.priority, type: 'thread', cpuTime: 0 });
+      results.push({ pid: kt.tid, ppid: 0, name: '[' + kt.name + ']', state: kt.state, priority: kt.priority, type: 'thread', cpuTime: kt.cpuTicks });
+    }
+    // C kernel threads with their own stacks; cpuTime in ms
+    var cthreads = kernel.kthreadList ? kernel.kthreadList() : [];
+    for (var _c = 0; _c < cthreads.length; _c++) {
+      var ct = cthreads[_c];
+      results.push({ pid: ct.id, ppid: 0, name: '{' + ct.name + '}', state: ct.state, priority: 0, type: 'kthread', cpuTime: (ct.runUs / 1000) | 0 });
     }
     // Active JSProcess child QuickJS runtimes
     var jsprocs = listProcesses();
@@ -821,7 +855,12 @@ export function registerCommands(g: any): void {
       }
       for (var _j = 0; _j < kthreadsTop.length; _j++) {
         var kt = kthreadsTop[_j];
-        terminal.println('  ' + pad('thread', 7) + ' ' + lpad('' + kt.tid, 4) + '      0  ' + pad('[' + kt.name + ']', 16) + '  ' + pad(kt.state, 10) + '  ' + lpad('' + kt.priority, 3) + '  0');
+        terminal.println('  ' + pad('thread', 7) + ' ' + lpad('' + kt.tid, 4) + '      0  ' + pad('[' + kt.name + ']', 16) + '  ' + pad(kt.state, 10) + '  ' + lpad('' + kt.priority, 3) + '  ' + kt.cpuTicks);
+      }
+      var cthreadsTop = kernel.kthreadList ? kernel.kthreadList() : [];
+      for (var _c = 0; _c < cthreadsTop.length; _c++) {
+        var ct = cthreadsTop[_c];
+        terminal.println('  ' + pad('kthread', 7) + ' ' + lpad('' + ct.id, 4) + '      0  ' + pad('{' + ct.name + '}', 16) + '  ' + pad(ct.state, 10) + '    0  ' + ((ct.runUs / 1000) | 0) + (ct.overflowed ? '  STACK OVERFLOW' : ''));
       }
       for (var _k = 0; _k < jSprocsTop.length; _k++) {
         var jpt = jSprocsTop[_k];
@@ -1270,9 +1309,9 @@ export function registerCommands(g: any): void {
   g.os = os;
 
   /**
-   * Allocate a shared BSS buffer accessible from both parent and child runtimes.
-   * Returns an id (0-7) that both sides pass to openSharedBuffer().
-   * Max size 256 KB.  Up to 8 concurrent shared buffers.
+   * Allocate a shared page-aligned region accessible from both parent and child runtimes.
+   * Returns an id that both sides pass to openSharedBuffer().
+   * Max size 256 MB.  Up to 64 live regions.
    *
    * Example (zero-copy float array):
    *   var id = createSharedBuffer(4096);
@@ -1290,9 +1329,9 @@ export function registerCommands(g: any): void {
     return kernel.sharedBufferOpen(id);
   };
 
-  /** Release a shared buffer slot (frees the id for reuse). */
-  g.releaseSharedBuffer = function(id: number): void {
-    kernel.sharedBufferRelease(id);
+  /** Drop this runtime's reference; memory is freed once no view or holder remains. */
+  g.releaseSharedBuffer = function(id: number): boolean {
+    return kernel.sharedBufferRelease(id);
   };
 
   /**
@@ -1623,7 +1662,8 @@ export function registerCommands(g: any): void {
   // 8C.  SYSTEM INFO COMMANDS (items 729-741)
   // ──────────────────────────────────────────────────────────────────────────
 
-  // item 730: disk() — disk usage per mount point
+  // item 730: disk() — disk usage per mount point; keeps the disk.* API above
+  var _diskApi = g.disk;
   g.disk = function() {
     var diskFS = (g._diskFS as any);
     var diskStats = diskFS && diskFS.getStats ? diskFS.getStats() : null;
@@ -1656,6 +1696,7 @@ export function registerCommands(g: any): void {
       }
     });
   };
+  for (var _dk in _diskApi) g.disk[_dk] = _diskApi[_dk];
 
   // item 731: cpu() — CPU info and utilization
   g.cpu = function() {
@@ -2644,6 +2685,599 @@ export function registerCommands(g: any): void {
 
       return { ttfb, fcp, lcp, tbt, cls, score };
     },
+
+    /** IPC ring throughput between the shell and a child runtime, both directions. */
+    ipc(msgBytes: number = 1024, count: number = 20_000) {
+      if (typeof kernel.procRecvBatch !== 'function') {
+        terminal.colorPrintln('bench.ipc: kernel has no batched IPC rings', Color.YELLOW);
+        return null;
+      }
+      var id = kernel.procCreate(1 << 20);
+      if (id < 0) { terminal.colorPrintln('bench.ipc: no free runtime slot', Color.RED); return null; }
+      // A message larger than the ring's limit never fits; both loops would spin forever.
+      var ring = kernel.procRingInfo ? kernel.procRingInfo(id) : null;
+      if (ring && msgBytes > ring.maxMessage) {
+        terminal.colorPrintln('bench.ipc: ' + msgBytes + ' B exceeds the ring limit, using ' + ring.maxMessage + ' B', Color.YELLOW);
+        msgBytes = ring.maxMessage;
+      }
+      terminal.colorPrintln('JSOS IPC ring benchmark: ' + count.toLocaleString() + ' x ' + msgBytes + ' B', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      var results: Record<string, number> = {};
+
+      function report(name: string, n: number, ms: number) {
+        if (ms <= 0) ms = 1;
+        var perSec = Math.round(n / ms * 1000);
+        results[name] = perSec;
+        terminal.colorPrint('  ' + name.padEnd(24), Color.LIGHT_CYAN);
+        terminal.println(perSec.toLocaleString().padStart(12) + ' msg/s ' +
+                         (n * msgBytes / 1048576 / (ms / 1000)).toFixed(1).padStart(8) + ' MB/s');
+      }
+
+      try {
+        kernel.procEval(id,
+          'function _drain(){return kernel.pollMessages(0).length;}' +
+          'function _flood(k,sz,bin){var p=bin?new Uint8Array(sz):"x".repeat(sz);' +
+          'var s=0;while(s<k&&kernel.postMessage(p))s++;return s;}');
+        [false, true].forEach(function(bin) {
+          var kind = bin ? 'binary' : 'string';
+          var payload: string | Uint8Array = bin ? new Uint8Array(msgBytes) : 'x'.repeat(msgBytes);
+
+          // parent → child: fill the inbox, let the child drain it in one batch
+          var t0 = kernel.getTicks(), sent = 0;
+          while (sent < count) {
+            if (kernel.procSend(id, payload)) sent++;
+            else kernel.procEval(id, '_drain()');
+          }
+          kernel.procEval(id, '_drain()');
+          report('parent->child ' + kind, count, kernel.getTicks() - t0);
+
+          // child → parent: child floods the outbox, parent drains in batches
+          t0 = kernel.getTicks();
+          var got = 0;
+          while (got < count) {
+            kernel.procEval(id, '_flood(' + (count - got) + ',' + msgBytes + ',' + bin + ')');
+            got += kernel.procRecvBatch!(id, 0).length;
+          }
+          report('child->parent ' + kind, count, kernel.getTicks() - t0);
+        });
+      } finally {
+        kernel.procDestroy(id);
+      }
+      return results;
+    },
+
+    /** Readiness cost with `nfds` idle pipes and one busy one: poll() scan vs epoll ready list. */
+    epoll(nfds: number = 2000, rounds: number = 2000) {
+      var fds: number[] = [];
+      for (var i = 0; i < nfds; i++) {
+        var pr = globalFDTable.pipe(4096);
+        fds.push(pr[0], pr[1]);
+      }
+      var hotW = fds[fds.length - 1];
+      var byte = new Uint8Array(1);
+      var results: Record<string, number> = {};
+      terminal.colorPrintln('JSOS readiness benchmark: ' + nfds + ' pipes, 1 active, ' + rounds + ' rounds', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+
+      function report(name: string, ms: number) {
+        if (ms <= 0) ms = 1;
+        var perSec = Math.round(rounds / ms * 1000);
+        results[name] = perSec;
+        terminal.colorPrint('  ' + name.padEnd(24), Color.LIGHT_CYAN);
+        terminal.println(perSec.toLocaleString().padStart(12) + ' wakeups/s');
+      }
+
+      try {
+        // Scan: what select()/poll() did before epoll — test every fd per wakeup.
+        var t0 = kernel.getTicks();
+        for (var r = 0; r < rounds; r++) {
+          globalFDTable.writeFrom(hotW, byte, 0, 1);
+          for (var j = 0; j < fds.length; j += 2) {
+            if (globalFDTable.pollFd(fds[j]) & 1) globalFDTable.readInto(fds[j], byte, 0, 1);
+          }
+        }
+        report('poll scan', kernel.getTicks() - t0);
+
+        var ep = syscalls.epoll_create().value!;
+        for (var m = 0; m < fds.length; m += 2) syscalls.epoll_ctl(ep, 1 /* ADD */, fds[m], 1 /* EPOLLIN */);
+        t0 = kernel.getTicks();
+        for (var r2 = 0; r2 < rounds; r2++) {
+          globalFDTable.writeFrom(hotW, byte, 0, 1);
+          var evs = syscalls.epoll_wait(ep, 64, 0).value || [];
+          for (var e = 0; e < evs.length; e++) globalFDTable.readInto(evs[e].data, byte, 0, 1);
+        }
+        report('epoll ready list', kernel.getTicks() - t0);
+        globalFDTable.close(ep);
+      } finally {
+        for (var c = 0; c < fds.length; c++) globalFDTable.close(fds[c]);
+      }
+      return results;
+    },
+    /**
+     * io_uring transition cost: `count` 4 KB virtio-blk reads (NOPs when no
+     * disk) entered one per SQE vs `batch` SQEs per kernel.uringEnter().
+     */
+    uring(count: number = 1024, batch: number = 64) {
+      var ring = new IoUring(256);
+      var bufs = ring.registerBuffers([batch * 4096]);
+      var results: Record<string, number> = {};
+      if (!ring.kernelBacked) {
+        terminal.colorPrintln('bench.uring: kernel rings unavailable', Color.LIGHT_RED);
+        return results;
+      }
+      var disk = !!(kernel.virtioBlkPresent && kernel.virtioBlkPresent());
+      terminal.colorPrintln('JSOS io_uring benchmark: ' + count + (disk ? ' x 4 KB virtio-blk reads' : ' NOPs (no virtio-blk)') + ', batch ' + batch, Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+
+      function sqe(i: number) {
+        var slot = i % batch;
+        return disk
+          ? { op: IoUringOp.READ_FIXED, userData: i, fd: IoUringDev.VIRTIO_BLK, flags: IOSQE_FIXED_FILE,
+              buf: bufs[0].subarray(slot * 4096, slot * 4096 + 4096), offset: i * 8 }
+          : { op: IoUringOp.NOP, userData: i, fd: IoUringDev.VIRTIO_BLK, flags: IOSQE_FIXED_FILE };
+      }
+      function run(name: string, perEnter: number) {
+        var s0 = ring.stats()!;
+        var t0 = kernel.getTicks();
+        for (var i = 0; i < count; i += perEnter) {
+          for (var k = i; k < i + perEnter && k < count; k++) ring.submit(sqe(k));
+          ring.flush();
+        }
+        var ms = kernel.getTicks() - t0;
+        if (ms <= 0) ms = 1;
+        var s1 = ring.stats()!;
+        results[name] = Math.round(count / ms * 1000);
+        terminal.colorPrint('  ' + name.padEnd(16), Color.LIGHT_CYAN);
+        terminal.println(results[name].toLocaleString().padStart(10) + ' ops/s  ' +
+          (s1.enters - s0.enters) + ' enters, ' + (s1.driverCalls - s0.driverCalls) + ' driver calls');
+      }
+
+      try {
+        run('one per SQE', 1);
+        run('batched', batch);
+      } finally {
+        ring.close();
+      }
+      return results;
+    },
+    /**
+     * fork() cost: map `mb` MB of anonymous memory in a scratch address
+     * space, then share it copy-on-write into a child and tear both down.
+     */
+    fork(mb: number = 100) {
+      var results: Record<string, number> = {};
+      var pd = kernel.cloneAddressSpace ? kernel.cloneAddressSpace() : 0;
+      var parent = new VirtualMemoryManager(pd, !pd);
+      var childPd = pd && kernel.cloneAddressSpace ? kernel.cloneAddressSpace() : 0;
+      terminal.colorPrintln('JSOS fork benchmark: ' + mb + ' MB, ' +
+        (parent.hardwareBacked ? 'hardware page tables' : 'simulated page tables'), Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      function step(name: string, fn: () => void) {
+        var t0 = kernel.getTicks();
+        fn();
+        results[name] = kernel.getTicks() - t0;
+        terminal.colorPrint('  ' + name.padEnd(16), Color.LIGHT_CYAN);
+        terminal.println(String(results[name]).padStart(8) + ' ms');
+      }
+      var child: VirtualMemoryManager | null = null;
+      try {
+        var va: number | null = null;
+        step('map', function() { va = parent.allocateVirtualMemory(mb * 1024 * 1024); });
+        if (va === null) {
+          terminal.colorPrintln('bench.fork: out of memory', Color.LIGHT_RED);
+          return results;
+        }
+        step('fork (COW)', function() { child = parent.fork(childPd); });
+        step('first write', function() { child!.handlePageFault(va!, true); });
+        var st = kernel.ptStats ? kernel.ptStats() : null;
+        if (st) terminal.println('  ' + st.cowShared + ' COW shares, ' + st.cowCopies + ' copies, ' + st.tables + ' tables');
+      } finally {
+        step('teardown', function() {
+          if (child) child.destroy();
+          else if (childPd && kernel.freeAddressSpace) kernel.freeAddressSpace(childPd);
+          parent.destroy();
+        });
+      }
+      return results;
+    },
+    /**
+     * App launch: `count` children started cold (procCreate + eval of the
+     * set-up code) vs cloned from a zygote that ran it once.
+     */
+    spawn(count: number = 8) {
+      var results: Record<string, number> = {};
+      var setup = 'var table=[];for(var i=0;i<50000;i++)table.push({k:"key"+i,v:i*i});' +
+                  'function lookup(n){return table[n].v;}';
+      if (count > 15) count = 15;
+      terminal.colorPrintln('JSOS spawn benchmark: ' + count + ' launches', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      function run(name: string, make: () => number) {
+        var ids: number[] = [];
+        var t0 = kernel.getTicks();
+        for (var i = 0; i < count; i++) {
+          var id = make();
+          if (id < 0) break;
+          kernel.procEval(id, 'lookup(7)');
+          ids.push(id);
+        }
+        var ms = kernel.getTicks() - t0;
+        for (var k = 0; k < ids.length; k++) kernel.procDestroy(ids[k]);
+        if (!ids.length) { terminal.colorPrintln('  ' + name + ': no runtime slots', Color.LIGHT_RED); return; }
+        results[name] = Math.round(ms / ids.length * 100) / 100;
+        terminal.colorPrint('  ' + name.padEnd(16), Color.LIGHT_CYAN);
+        terminal.println(String(results[name]).padStart(8) + ' ms/launch');
+      }
+      run('cold', function() {
+        var id = kernel.procCreate();
+        if (id >= 0) kernel.procEval(id, setup);
+        return id;
+      });
+      var zid = kernel.zygoteCreate ? kernel.zygoteCreate(setup) : -1;
+      if (zid < 0) {
+        terminal.colorPrintln('  zygotes unavailable (paging off?)', Color.YELLOW);
+        return results;
+      }
+      try {
+        run('zygote clone', function() { return kernel.zygoteSpawn!(zid); });
+        var info = kernel.zygoteInfo!(zid);
+        if (info) terminal.println('  zygote: ' + info.pages + ' pages, ' + Math.round(info.usedBytes / 1024) + ' KB live');
+      } finally {
+        kernel.zygoteDestroy!(zid);
+      }
+      return results;
+    },
+    /**
+     * Thread switch cost with `nthreads` runnable kernel threads: the old
+     * scan-every-thread pick vs the MLFQ bitmap queues, then a sleep/wake
+     * mix where each switch puts the outgoing thread to sleep for 1-64 ticks.
+     * Runs on a scratch ThreadManager with a virtual clock.
+     */
+    sched(nthreads: number = 256, switches: number = 20000) {
+      var results: Record<string, number> = {};
+      terminal.colorPrintln('JSOS scheduler benchmark: ' + nthreads + ' threads, ' + switches + ' switches', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      function report(name: string, ms: number, extra?: string) {
+        if (ms <= 0) ms = 1;
+        results[name] = Math.round(ms * 1e6 / switches);
+        terminal.colorPrint('  ' + name.padEnd(20), Color.LIGHT_CYAN);
+        terminal.println(results[name].toLocaleString().padStart(10) + ' ns/switch' + (extra ? '  ' + extra : ''));
+      }
+
+      // Scan: what ThreadManager._schedule() did before the run queues.
+      var prios: number[] = [];
+      for (var i = 0; i < nthreads; i++) prios.push(10 + (i % 4));
+      var cur = 0;
+      var t0 = kernel.getTicks();
+      for (var s = 0; s < switches; s++) {
+        var best = -1;
+        for (var k = 0; k < nthreads; k++) {
+          var idx = (cur + 1 + k) % nthreads;
+          if (best < 0 || prios[idx] < prios[best]) best = idx;
+        }
+        cur = best;
+      }
+      report('linear scan', kernel.getTicks() - t0);
+
+      var now = 0;
+      var tm = new ThreadManager(function() { return now; });
+      for (var j = 0; j < nthreads; j++) tm.createThread('bench' + j, 10 + (j % 4));
+      t0 = kernel.getTicks();
+      for (var s2 = 0; s2 < switches; s2++) tm.yieldThread();
+      report('MLFQ yield', kernel.getTicks() - t0);
+
+      var st0 = tm.stats();
+      var seed = 12345;
+      t0 = kernel.getTicks();
+      for (var s3 = 0; s3 < switches; s3++) {
+        var c = tm.currentThread();
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+        if (c && c.state === 'running') tm.sleepThread(c.tid, 10 * (1 + (seed & 63)));
+        now++;
+        tm.tick();
+      }
+      var st1 = tm.stats();
+      report('MLFQ sleep/wake', kernel.getTicks() - t0,
+        (st1.wakeups - st0.wakeups) + ' wakeups, ' + st1.sleeping + ' asleep');
+      return results;
+    },
+    /**
+     * Compressed block device reads: `mb` MB of text-like data with some
+     * noise on a RAM disk, read directly and through CompressedBlockDevice
+     * (LZ4, zstd).  Sequential reads start cold; random 4 KB reads run on
+     * the warm cache.  "effective" also charges every byte fetched from
+     * the inner device at `diskMBps`, the disk being emulated.
+     */
+    async cblk(mb: number = 4, diskMBps: number = 40) {
+      var results: Record<string, number> = {};
+      var ss = 512, size = mb * 1024 * 1024;
+      terminal.colorPrintln('JSOS compressed block device benchmark: ' + mb + ' MB, disk at ' + diskMBps + ' MB/s' +
+        (kernel.lz4Decompress ? ', native LZ4' : ''), Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+
+      var data = new Uint8Array(size);
+      var vocab = ['kernel', 'sector', 'cluster', 'the', 'of', 'read', 'write', 'buffer', 'cache',
+                   'index', 'function', 'return', 'var', '{', '}', ';\n', '0x1f', 'JSOS'];
+      var seed = 1, p = 0;
+      while (p < size) {
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+        if ((seed & 255) === 0) {              // a run of incompressible bytes
+          for (var r = 0; r < 512 && p < size; r++) { seed = (seed * 1103515245 + 12345) & 0x7fffffff; data[p++] = seed >> 16; }
+          continue;
+        }
+        var w = vocab[(seed >> 8) % vocab.length];
+        for (var i = 0; i < w.length && p < size; i++) data[p++] = w.charCodeAt(i);
+        if (p < size) data[p++] = 32;
+      }
+
+      function ramDisk(sectors: number): BlockDevice & { fetched: number } {
+        var store = new Uint8Array(sectors * ss);
+        return {
+          name: 'ram', sectorSize: ss, sectorCount: sectors, fetched: 0,
+          readSectors(lba: number, n: number) { this.fetched += n * ss; return Promise.resolve(store.slice(lba * ss, (lba + n) * ss)); },
+          writeSectors(lba: number, d: Uint8Array) { store.set(d, lba * ss); return Promise.resolve(0); },
+        };
+      }
+
+      async function run(name: string, algorithm: CompressionAlgorithm | null, level?: number) {
+        var disk = ramDisk(size / ss + 4096);
+        var dev: BlockDevice = disk, cdev: CompressedBlockDevice | null = null;
+        if (algorithm) dev = cdev = await CompressedBlockDevice.format(disk, { algorithm: algorithm, level: level, logicalSectors: size / ss });
+        var chunk = 1024 * 1024;
+        for (var off = 0; off < size; off += chunk) await dev.writeSectors(off / ss, data.subarray(off, off + chunk));
+        if (cdev) { await cdev.flush(); cdev.dropCache(); }
+
+        disk.fetched = 0;
+        var t0 = kernel.getTicks();
+        for (var o = 0; o < size; o += 65536) await dev.readSectors(o / ss, 128);
+        var ms = Math.max(1, kernel.getTicks() - t0);
+        var cpu = Math.round(mb / (ms / 1000));
+        var eff = Math.round(mb / (ms / 1000 + disk.fetched / (diskMBps * 1024 * 1024)));
+
+        var n = 2000, s = 7;
+        t0 = kernel.getTicks();
+        for (var k = 0; k < n; k++) {
+          s = (s * 1103515245 + 12345) & 0x7fffffff;
+          await dev.readSectors((s % (size / 4096)) * 8, 8);
+        }
+        var rms = Math.max(1, kernel.getTicks() - t0);
+        results[name] = eff;
+        terminal.colorPrint('  ' + name.padEnd(12), Color.LIGHT_CYAN);
+        terminal.println(String(cpu).padStart(6) + ' MB/s  ' + String(eff).padStart(5) + ' MB/s effective  ' +
+          String(Math.round(n / rms * 1000)).padStart(7) + ' 4K reads/s' +
+          (cdev ? '  ratio ' + cdev.usage().ratio.toFixed(2) : ''));
+      }
+
+      await run('raw', null);
+      await run('lz4', 'lz4');
+      await run('zstd -3', 'zstd', 3);
+      await run('zstd -9', 'zstd', 9);
+      return results;
+    },
+
+    overlay(files: number = 2000, lookups: number = 200000) {
+      var results: Record<string, number> = {};
+      terminal.colorPrintln('JSOS overlayfs benchmark: ' + files + ' lower files, ' + lookups.toLocaleString() + ' lookups', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      var lower = new MemoryUpperLayer();
+      lower.mkdir('/sys/bin');
+      for (var i = 0; i < files; i++) lower.write('/sys/bin/f' + i, 'x');
+      lower.writeData('/sys/big', FileData.fromBytes(new Uint8Array(4 * 1024 * 1024)));
+      var ov = new OverlayFS(new MemoryUpperLayer(), lower);
+      for (var w = 0; w < 16; w++) ov.write('/sys/bin/new' + w, 'y');
+      ov.unlink('/sys/bin/f0');
+
+      function rate(name: string, layer: { exists(p: string): boolean }) {
+        var t0 = kernel.getTicks();
+        for (var k = 0; k < lookups; k++) layer.exists('/sys/bin/f' + (k % files));
+        var ms = Math.max(1, kernel.getTicks() - t0);
+        results[name] = Math.round(lookups / ms * 1000);
+        terminal.colorPrint('  ' + name.padEnd(12), Color.LIGHT_CYAN);
+        terminal.println(String(results[name]).padStart(10) + ' lookups/s');
+      }
+      rate('lower only', lower);
+      rate('overlay', ov);
+
+      var t0 = kernel.getTicks();
+      for (var r = 0; r < 100; r++) ov.list('/sys/bin');
+      results.readdir = Math.max(1, kernel.getTicks() - t0) / 100;
+      terminal.colorPrint('  ' + 'readdir'.padEnd(12), Color.LIGHT_CYAN);
+      terminal.println(results.readdir.toFixed(2).padStart(10) + ' ms per ' + (files + 15) + ' entries');
+
+      ov.appendFile('/sys/big', 'tail');
+      var d = ov.fileData('/sys/big')!;
+      d.pwrite(new Uint8Array(16), 0, 16, 1024 * 1024);
+      ov.sync();
+      results.copiedChunks = ov.stats.copiedChunks;
+      terminal.colorPrint('  ' + 'copy-up'.padEnd(12), Color.LIGHT_CYAN);
+      terminal.println('4 MB file, append + 16 B write: ' + (d.storedChunks - d.sharedChunks) + ' of ' + d.storedChunks + ' chunks copied');
+      return results;
+    },
+
+    cowfs(files: number = 2000, mb: number = 8) {
+      var results: Record<string, number> = {};
+      terminal.colorPrintln('JSOS CoW filesystem benchmark: ' + files + ' files, ' + mb + ' MB file (RAM device)', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+      var size = (mb * 2 + 32) * 1024 * 1024;
+      var cow = new CowFS(new SimpleArrayBlockDevice(new Uint8Array(size)), size);
+      cow.format('bench');
+      function row(name: string, text: string) {
+        terminal.colorPrint('  ' + name.padEnd(12), Color.LIGHT_CYAN);
+        terminal.println(text);
+      }
+
+      var body = 'x'.repeat(2000);
+      var t0 = kernel.getTicks();
+      cow.mkdir('/d');
+      for (var i = 0; i < files; i++) cow.writeFile('/d/f' + i, body);
+      cow.commit();
+      results.createPerSec = Math.round(files / Math.max(1, kernel.getTicks() - t0) * 1000);
+      row('create', results.createPerSec + ' files/s, ' + cow.stats.blocksWritten + ' blocks in ' + cow.stats.writeRuns + ' write runs');
+
+      t0 = kernel.getTicks();
+      cow.writeFile('/big', new Uint8Array(mb * 1024 * 1024));
+      cow.commit();
+      results.writeMBps = Math.round(mb / Math.max(1, kernel.getTicks() - t0) * 1000);
+      t0 = kernel.getTicks();
+      cow.readBytes('/big');
+      results.readMBps = Math.round(mb / Math.max(1, kernel.getTicks() - t0) * 1000);
+      row('big file', 'write ' + results.writeMBps + ' MB/s, read ' + results.readMBps + ' MB/s (crc32c verified)');
+
+      var cows = cow.stats.cows;
+      t0 = kernel.getTicks();
+      cow.snapshot('s1');
+      results.snapshotMs = kernel.getTicks() - t0;
+      cow.pwrite('/big', new Uint8Array(16), 1024 * 1024);
+      cow.commit();
+      results.cowNodes = cow.stats.cows - cows;
+      row('snapshot', results.snapshotMs + ' ms; 16 B write after it copied ' + results.cowNodes + ' nodes');
+
+      var commits = cow.stats.commits;
+      for (var f = 0; f < 100; f++) cow.fsync();
+      results.idleFsyncCommits = cow.stats.commits - commits;
+      row('fsync', '100 fsyncs on a clean tree: ' + results.idleFsyncCommits + ' commits');
+      return results;
+    },
+    imgdecode(path?: string, reps: number = 4) {
+      var results: Record<string, number> = {};
+      terminal.colorPrintln('JSOS image decode benchmark: megapixels/s, kernel pixel loops vs JS', Color.WHITE);
+      terminal.colorPrintln('-'.repeat(44), Color.DARK_GREY);
+
+      // Fixtures: a 4:2:0 baseline JPEG from a minimal encoder (flat
+      // quantiser, fixed-length Huffman codes) and an RGBA PNG whose rows
+      // cycle through all five filters, stored-block zlib.
+      function synthJPEG(w: number, h: number): Uint8Array {
+        var out: number[] = [0xFF, 0xD8];
+        function seg(marker: number, body: number[]) {
+          out.push(0xFF, marker, (body.length + 2) >> 8, (body.length + 2) & 0xFF);
+          for (var i = 0; i < body.length; i++) out.push(body[i]);
+        }
+        var dqt = [0]; for (var q = 0; q < 64; q++) dqt.push(12);
+        seg(0xDB, dqt);
+        seg(0xC0, [8, h >> 8, h & 0xFF, w >> 8, w & 0xFF, 3, 1, 0x22, 0, 2, 0x11, 0, 3, 0x11, 0]);
+        var acSyms = [0x00, 0xF0];
+        for (var r = 0; r < 16; r++) for (var s = 1; s <= 10; s++) acSyms.push((r << 4) | s);
+        var dht = [0x00, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0];
+        for (var d = 0; d < 12; d++) dht.push(d);
+        dht.push(0x10, 0, 0, 0, 0, 0, 0, 0, acSyms.length, 0, 0, 0, 0, 0, 0, 0, 0);
+        var acCode: number[] = [];
+        for (var a = 0; a < acSyms.length; a++) { dht.push(acSyms[a]); acCode[acSyms[a]] = a; }
+        seg(0xC4, dht);
+        seg(0xDA, [3, 1, 0x00, 2, 0x00, 3, 0x00, 0, 63, 0]);
+
+        var acc = 0, nbits = 0;
+        function put(v: number, n: number) {
+          for (var b = n - 1; b >= 0; b--) {
+            acc = (acc << 1) | ((v >> b) & 1);
+            if (++nbits === 8) { out.push(acc); if (acc === 0xFF) out.push(0); acc = 0; nbits = 0; }
+          }
+        }
+        function bitsOf(v: number) { var n = 0; v = Math.abs(v); while (v) { n++; v >>= 1; } return n; }
+        var ZZ = [0,1,8,16,9,2,3,10,17,24,32,25,18,11,4,5,12,19,26,33,40,48,41,34,27,20,13,6,7,14,21,28,
+                  35,42,49,56,57,50,43,36,29,22,15,23,30,37,44,51,58,59,52,45,38,31,39,46,53,60,61,54,47,55,62,63];
+        var cosT: number[] = [];
+        for (var u = 0; u < 8; u++) for (var x = 0; x < 8; x++)
+          cosT.push((u ? 0.5 : 0.35355339) * Math.cos((2 * x + 1) * u * Math.PI / 16));
+        var tmp = new Float64Array(64), coef = new Int32Array(64), prev = [0, 0, 0];
+        function block(sample: (x: number, y: number) => number, c: number) {
+          for (var v = 0; v < 8; v++) for (var u = 0; u < 8; u++) {
+            var t = 0; for (var x = 0; x < 8; x++) t += cosT[u * 8 + x] * (sample(x, v) - 128); tmp[v * 8 + u] = t;
+          }
+          for (var u2 = 0; u2 < 8; u2++) for (var v2 = 0; v2 < 8; v2++) {
+            var t2 = 0; for (var y = 0; y < 8; y++) t2 += cosT[v2 * 8 + y] * tmp[y * 8 + u2];
+            coef[v2 * 8 + u2] = Math.round(t2 / 12);
+          }
+          var diff = coef[0] - prev[c]; prev[c] = coef[0];
+          var cat = bitsOf(diff);
+          put(cat, 4); if (cat) put(diff < 0 ? diff - 1 : diff, cat);
+          var run = 0;
+          for (var k = 1; k < 64; k++) {
+            var cv = coef[ZZ[k]];
+            if (!cv) { run++; continue; }
+            while (run > 15) { put(acCode[0xF0], 8); run -= 16; }
+            var sz = Math.min(10, bitsOf(cv));
+            put(acCode[(run << 4) | sz], 8); put(cv < 0 ? cv - 1 : cv, sz);
+            run = 0;
+          }
+          if (run) put(acCode[0x00], 8);
+        }
+        function Y(x: number, y: number) { return 128 + 60 * Math.sin(x / 23) * Math.cos(y / 17) + ((x * y) & 31); }
+        function Cb(x: number, y: number) { return 128 + 40 * Math.sin((x + y) / 40); }
+        function Cr(x: number, y: number) { return 128 + 40 * Math.cos((x - y) / 50); }
+        for (var my = 0; my < h; my += 16) for (var mx = 0; mx < w; mx += 16) {
+          for (var by = 0; by < 16; by += 8) for (var bx = 0; bx < 16; bx += 8)
+            block(function(x: number, y: number) { return Y(mx + bx + x, my + by + y); }, 0);
+          block(function(x: number, y: number) { return Cb(mx + 2 * x, my + 2 * y); }, 1);
+          block(function(x: number, y: number) { return Cr(mx + 2 * x, my + 2 * y); }, 2);
+        }
+        if (nbits) put(0x7F, 8 - nbits);
+        out.push(0xFF, 0xD9);
+        return new Uint8Array(out);
+      }
+
+      function synthPNG(w: number, h: number): Uint8Array {
+        var rowLen = w * 4 + 1, raw = new Uint8Array(h * rowLen), seed = 1;
+        for (var i = 0; i < raw.length; i++) { seed = (seed * 1103515245 + 12345) >>> 0; raw[i] = (seed >>> 24) & 0x0F; }
+        for (var r = 0; r < h; r++) raw[r * rowLen] = r % 5;
+        var z: number[] = [0x78, 0x01];
+        for (var o = 0; o < raw.length; o += 65535) {
+          var n = Math.min(65535, raw.length - o);
+          z.push(o + n >= raw.length ? 1 : 0, n & 0xFF, n >> 8, ~n & 0xFF, (~n >> 8) & 0xFF);
+          for (var k = 0; k < n; k++) z.push(raw[o + k]);
+        }
+        z.push(0, 0, 0, 0);   // Adler-32 (unchecked)
+        var out: number[] = [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A];
+        function chunk(type: string, body: number[]) {
+          var n = body.length;
+          out.push(n >>> 24, (n >> 16) & 0xFF, (n >> 8) & 0xFF, n & 0xFF);
+          for (var c = 0; c < 4; c++) out.push(type.charCodeAt(c));
+          for (var b = 0; b < n; b++) out.push(body[b]);
+          out.push(0, 0, 0, 0);   // CRC (unchecked)
+        }
+        chunk('IHDR', [w >>> 24, (w >> 16) & 0xFF, (w >> 8) & 0xFF, w & 0xFF,
+                       h >>> 24, (h >> 16) & 0xFF, (h >> 8) & 0xFF, h & 0xFF, 8, 6, 0, 0, 0]);
+        chunk('IDAT', z);
+        chunk('IEND', []);
+        return new Uint8Array(out);
+      }
+
+      var jpegs = [jpegCodec(), jpegCodec(true)];
+      var pngs = [pngCodec(), pngCodec(true)];
+      var fixtures: { name: string; bytes: Uint8Array; png: boolean }[] = [];
+      if (path) {
+        var data = fs.readFileBytes(path);
+        if (!data) { terminal.colorPrintln('bench.imgdecode: cannot read ' + path, Color.LIGHT_RED); return results; }
+        fixtures.push({ name: path.split('/').pop()!, bytes: data, png: /\.png$/i.test(path) });
+      } else {
+        fixtures.push({ name: 'jpeg 640x480', bytes: synthJPEG(640, 480), png: false });
+        fixtures.push({ name: 'png 512x512', bytes: synthPNG(512, 512), png: true });
+      }
+
+      for (var f = 0; f < fixtures.length; f++) {
+        var fx = fixtures[f];
+        var variants: [string, number][] = fx.png ? [['', 1]] : [['', 1], [' 1/4', 4]];
+        var srcPixels = 0;   // rates count source pixels, so scaled decodes compare directly
+        for (var vi = 0; vi < variants.length; vi++) {
+          var line = '';
+          for (var ci = 0; ci < 2; ci++) {
+            var codec: any = fx.png ? pngs[ci] : jpegs[ci];
+            if (ci === 0 && !codec.native) { line += 'kernel n/a  '; continue; }
+            var decode = fx.png ? codec.decode.bind(null, fx.bytes) : codec.decode.bind(null, fx.bytes, variants[vi][1]);
+            var img = decode();
+            if (!img) { line += 'decode failed  '; continue; }
+            if (!srcPixels) srcPixels = img.w * img.h;
+            var t0 = kernel.getTicks();
+            for (var rep = 0; rep < reps; rep++) decode();
+            var ms = Math.max(1, kernel.getTicks() - t0);
+            var rate = Math.round(srcPixels * reps / ms / 10) / 100;
+            results[fx.name + variants[vi][0] + (ci ? ' js' : ' kernel')] = rate;
+            line += (ci ? 'js ' : 'kernel ') + rate.toFixed(2) + ' MP/s  ';
+          }
+          terminal.colorPrint('  ' + (fx.name + variants[vi][0]).padEnd(18), Color.LIGHT_CYAN);
+          terminal.println(line);
+        }
+      }
+      return results;
+    },
   };
   /** [Item 977] CI benchmark threshold check � fails if regression > threshold% (default 5%). */
   g.bench.ci = function(thresholdPct: number = 5) {
@@ -2697,7 +3331,7 @@ export function registerCommands(g: any): void {
     return true;
   };
 
-  (g as any)._helpDocs['bench'] = 'bench.run()  � full synthetic benchmark suite\nbench.micro(fn, iters?, label?)  � micro-benchmark\nbench.browser(url)  � Core Web Vitals style page benchmark\nbench.ci(threshold?)  � CI regression gate (default 5%)';
+  (g as any)._helpDocs['bench'] = 'bench.run()  � full synthetic benchmark suite\nbench.micro(fn, iters?, label?)  � micro-benchmark\nbench.browser(url)  � Core Web Vitals style page benchmark\nbench.ci(threshold?)  � CI regression gate (default 5%)\nbench.ipc(bytes?, count?)  � parent/child IPC ring throughput\nbench.epoll(nfds?, rounds?)  � poll() scan vs epoll ready-list wakeups\nbench.uring(count?, batch?)  � io_uring one enter per SQE vs per batch\nbench.fork(mb?)  � fork() page-table cost: map, COW clone, first write\nbench.spawn(count?)  � app launch: cold procCreate+eval vs zygote clone\nbench.sched(threads?, switches?)  � thread switch: linear scan vs MLFQ bitmap queues\nbench.cblk(mb?, diskMBps?)  � compressed block device read MB/s: raw vs LZ4 vs zstd\nbench.overlay(files?, lookups?)  � overlayfs lookups/s vs lower layer, readdir, partial copy-up\nbench.cowfs(files?, mb?)  � CoW filesystem creates/s, MB/s, snapshot cost, fsync grouping\nbench.imgdecode(path?, reps?)  � JPEG/PNG decode MP/s: kernel IDCT/colour/unfilter vs JS';
 
   // [Item 685] Terminal session recorder: g.record() / g.stopRecord() / g.replay(name)
   (function() {
@@ -2932,14 +3566,16 @@ export function registerCommands(g: any): void {
     terminal.println('  p.recvAll()               drain all pending messages → array');
     terminal.println('  p.stats()                 queue depths + alive status');
     terminal.println('  p.terminate()             kill process, free runtime');
-    terminal.println('  createSharedBuffer(size?) allocate BSS slab → id  (max 256 KB)');
+    terminal.println('  createSharedBuffer(size?) allocate shared region → id  (max 256 MB)');
     terminal.println('  openSharedBuffer(id)      → ArrayBuffer (zero-copy, any runtime)');
-    terminal.println('  releaseSharedBuffer(id)   free the slot');
+    terminal.println('  releaseSharedBuffer(id)   drop reference (freed when unused)');
     terminal.println('');
     terminal.colorPrintln('  Child kernel API (inside spawned code):', Color.DARK_GREY);
-    terminal.println('    kernel.postMessage(s)        push string to parent outbox');
-    terminal.println('    kernel.pollMessage()         pop string from parent inbox');
+    terminal.println('    kernel.postMessage(m)        push string/ArrayBuffer to parent outbox');
+    terminal.println('    kernel.pollMessage()         pop string/ArrayBuffer from parent inbox');
+    terminal.println('    kernel.pollMessages(max?)    drain the inbox in one call → array');
     terminal.println('    kernel.sharedBufferOpen(id)  zero-copy ArrayBuffer — no stringify');
+    terminal.println('    kernel.bufferAccept(id)      claim a buffer moved with bufferTransfer');
     terminal.println('    kernel.serialPut(s)  kernel.sleep(ms)  kernel.getTicks()');
     terminal.println('');
 
@@ -2952,7 +3588,7 @@ export function registerCommands(g: any): void {
     terminal.println('  passwd(name, pw)     change password');
     terminal.println('');
 
-    terminal.colorPrintln('Disk (FAT32/FAT16 persistent storage):', Color.YELLOW);
+    terminal.colorPrintln('Disk (CoW / FAT32 / FAT16 persistent storage):', Color.YELLOW);
     terminal.println('  disk.ls(path?)       list directory on disk');
     terminal.println('  disk.read(path)      read file from disk');
     terminal.println('  disk.write(path, s)  write/create file on disk');
@@ -2962,6 +3598,12 @@ export function registerCommands(g: any): void {
     terminal.println('  disk.exists(path)    check if path exists');
     terminal.println('  disk.stats()         free/used cluster info');
     terminal.println('  disk.format(label?)  format a blank attached disk');
+    terminal.println('  disk.mkcowfs(label?) format as the CoW filesystem (snapshots)');
+    terminal.println('  disk.snapshot(name)  O(1) snapshot, at /disk/.snapshots/name');
+    terminal.println('  disk.snapshots()     list snapshots');
+    terminal.println('  disk.rollback(name)  make a snapshot the live tree');
+    terminal.println('  disk.rmsnapshot(n)   delete a snapshot');
+    terminal.println('  disk.sync()          commit the running transaction');
     terminal.println('');
 
     terminal.colorPrintln('Networking:', Color.YELLOW);
@@ -95,6 +95,14 @@ export interface AppManifest {
   code: string;
   /** If true, launching a second instance is a no-op (not yet enforced). */
   singleInstance?: boolean;
+  /** Expression evaluated after `code` on every launch (e.g. 'main()'). */
+  start?: string;
+  /**
+   * `code` is pure set-up: run it once into a zygote runtime and
+   * launch each instance as a copy-on-write clone of it; only `start` runs
+   * per launch.
+   */
+  warmStart?: boolean;
 }
 
 // ── ChildProcApp ─────────────────────────────────────────────────────────────
@@ -276,6 +284,9 @@ export class WindowManager {
   // Saved sizes for maximise/restore
   private _savedSizes = new Map<number, { x: number; y: number; w: number; h: number }>();
 
+  // Zygote per warmStart app name (-1 = could not be built; cold start)
+  private _appZygotes = new Map<string, number>();
+
   // Mouse capture — app window that receives all events while button is held
   private _mouseCapture: number | null = null;
   private _clipboard: string = '';
@@ -392,15 +403,25 @@ export class WindowManager {
    * Launch a sandboxed child JS process in a managed window.
    *
    * Steps:
-   *   1. Allocate a QuickJS process slot with `kernel.procCreate()`.
+   *   1. Allocate a QuickJS process slot with `kernel.procCreate()` — or,
+   *      for `warmStart` apps, clone the app's zygote (`kernel.zygoteSpawn`).
    *   2. Tell the C layer the render surface dimensions.
    *   3. Open a WM window backed by a `ChildProcApp` proxy.
-   *   4. Evaluate the app code inside the child runtime.
+   *   4. Evaluate the app code (cold start only), then `start`.
    *
    * @returns The child process id (0–7), or -1 on failure.
    */
   launchApp(manifest: AppManifest): number {
-    var procId = kernel.procCreate();
+    var procId = -1, warm = false;
+    if (manifest.warmStart && kernel.zygoteCreate) {
+      var zid = this._appZygotes.get(manifest.name);
+      if (zid === undefined) {
+        zid = kernel.zygoteCreate(manifest.code);
+        this._appZygotes.set(manifest.name, zid);
+      }
+      if (zid >= 0) { procId = kernel.zygoteSpawn!(zid); warm = procId >= 0; }
+    }
+    if (procId < 0) procId = kernel.procCreate();
     if (procId < 0) { return -1; }
     // Register a 'standard' syscall policy for the child process
     registerPolicy(procId, new SyscallPolicy('standard', procId));
@@ -414,7 +435,8 @@ export class WindowManager {
       app:       new ChildProcApp(procId, manifest.width, manifest.height),
       closeable: manifest.singleInstance !== true,
     });
-    kernel.procEval(procId, manifest.code);
+    if (!warm) kernel.procEval(procId, manifest.code);
+    if (manifest.start) kernel.procEval(procId, manifest.start);
     return procId;
   }
 